@@ -34,6 +34,7 @@
 #endif //precompiled headers
 
 #include <wx/datetime.h>
+#include <wx/stopwatch.h>
 #include <wx/listctrl.h>
 #include <wx/spinctrl.h>
 #include <wx/aui/aui.h>
@@ -82,7 +83,8 @@ typedef enum AIS_Error
     AIS_NMEAVDX_CHECKSUM_BAD,
     AIS_NMEAVDX_BAD,
     AIS_NO_SERIAL,
-    AIS_NO_TCP
+    AIS_NO_TCP,
+    AIS_NO_FILE
 }_AIS_Error;
 
 
@@ -235,20 +237,25 @@ WX_DEFINE_SORTED_ARRAY(AIS_Target_Data *, ArrayOfAISTarget);
 
 
 #define AIS_MAX_MESSAGE_LEN (10 * 82)           // AIS Spec allows up to 9 sentences per message, 82 bytes each
+#define AIS_MAX_BITBYTES ((AIS_MAX_MESSAGE_LEN * 6) / 8 + 8)  // packed payload, plus slack for word reads
+#define AIS_RX_BATCH_SIZE 16384                 // received sentences handed to DecodeBatch() at once
+
 class AIS_Bitstring
 {
 public:
 
     AIS_Bitstring(const char *str);
+    AIS_Bitstring(const char *str, int len);
     unsigned char to_6bit(const char c);
     int GetInt(int sp, int len);
     bool GetStr(int sp, int len, char *dest, int max_len);
 
 
 private:
+    void Load(const char *str, int len);
 
-    unsigned char bitbytes[AIS_MAX_MESSAGE_LEN];
-    int byte_length;
+    unsigned char bitbytes[AIS_MAX_BITBYTES];       // payload bits, packed MSB first
+    int byte_length;                                // payload characters
 };
 
 
@@ -259,19 +266,150 @@ private:
 WX_DECLARE_HASH_MAP( int, AIS_Target_Data*, wxIntegerHash, wxIntegerEqual, AIS_Target_Hash );
 
 
+//---------------------------------------------------------------------------------
+//
+//  AIS CPA/TCPA and Alarm Engine
+//
+//---------------------------------------------------------------------------------
+
+#define AIS_CPA_GRID_DEG          0.5         // Target grid cell size, degrees
+#define AIS_CPA_GRID_MAX_CELLS    400         // Larger search boxes simply recompute all targets
+#define AIS_CPA_REFRESH_BATCH     256         // Approximate number of distant targets refreshed per pass
+
+//    Own ship kinematics, and the alarm parameters in effect
+class AIS_CPA_OwnShip
+{
+public:
+      bool IsSameKinematics(const AIS_CPA_OwnShip &own) const;
+      bool IsSameParams(const AIS_CPA_OwnShip &own) const;
+
+      double            Lat;
+      double            Lon;
+      double            Sog;
+      double            Cog;
+      bool              bGPSValid;
+
+      bool              bCPAWarn;
+      double            CPAWarn_NM;
+      bool              bCPAMax;
+      double            CPAMax_NM;
+      bool              bTCPA_Max;
+      double            TCPA_Max;
+      bool              bShowMoored;
+      double            ShowMoored_Kts;
+      bool              bSuppressMoored;
+};
+
+//    Collision parameters of one target, as posted back to the decoder
+class AIS_CPA_Result
+{
+public:
+      bool IsSame(const AIS_CPA_Result &result) const;
+
+      int               MMSI;
+      bool              bCPA_Valid;
+      double            CPA;
+      double            TCPA;
+      double            Range_NM;
+      double            Brg;
+      ais_alarm_type    n_alarm_state;
+};
+
+//    The engine's own copy of a target
+class AIS_CPA_Target
+{
+public:
+      int               MMSI;
+      double            Lat;
+      double            Lon;
+      double            SOG;
+      double            COG;
+      bool              b_positionValid;
+      bool              b_OwnShip;
+      bool              b_active;
+
+      AIS_CPA_Result    result;
+      bool              b_general_alert;
+      int               grid_key;               // -1 if not in the grid
+      bool              b_dirty;
+};
+
+WX_DECLARE_HASH_MAP( int, AIS_CPA_Target*, wxIntegerHash, wxIntegerEqual, AIS_CPA_Target_Hash );
+WX_DECLARE_HASH_MAP( int, AIS_CPA_Result*, wxIntegerHash, wxIntegerEqual, AIS_CPA_Result_Hash );
+WX_DECLARE_HASH_MAP( int, wxArrayPtrVoid*, wxIntegerHash, wxIntegerEqual, AIS_CPA_Grid_Hash );
+
+class AIS_CPA_Thread;
+
+//    Computes CPA/TCPA and alarm states incrementally.
+//    Only targets that moved, or that are near own ship when own ship moves, are recomputed.
+//    Where the geodesic helpers are thread safe, passes run on a worker thread.
+class AIS_CPA_Engine
+{
+public:
+      AIS_CPA_Engine();
+      ~AIS_CPA_Engine();
+
+      void UpdateTarget(AIS_Target_Data *ptarget);
+      void RemoveTarget(int mmsi);
+      void SetOwnShip(const AIS_CPA_OwnShip &own);
+      AIS_CPA_Result_Hash *FetchResults(bool *pbGeneralAlert);
+
+      bool WaitForWork(void);
+      void RunPass(void);
+
+private:
+      void ApplyPending(void);
+      void MarkOwnShipChange(const AIS_CPA_OwnShip &own_prev);
+      void MarkDirty(AIS_CPA_Target *pt);
+      void MarkCell(int key);
+      int GetGridKey(double lat, double lon);
+      void GridInsert(AIS_CPA_Target *pt);
+      void GridRemove(AIS_CPA_Target *pt);
+      void DeleteTarget(AIS_CPA_Target *pt);
+      void ComputeCPA(AIS_CPA_Target *pt);
+      void ComputeAlarm(AIS_CPA_Target *pt);
+
+      //    Shared with the decoder, guarded by m_mutex
+      wxMutex                 m_mutex;
+      AIS_CPA_Target_Hash     m_pending_updates;
+      wxArrayInt              m_pending_removals;
+      AIS_CPA_OwnShip         m_pending_own;
+      bool                    m_bpending_own;
+      AIS_CPA_Result_Hash     *m_pResults;
+      bool                    m_bGeneralAlert;
+      bool                    m_bstop;
+
+      //    Touched only by the pass
+      AIS_CPA_Target_Hash     m_targets;
+      AIS_CPA_Target_Hash     m_flagged;        // targets alarmed or contributing to the general alert
+      AIS_CPA_Grid_Hash       m_grid;
+      wxArrayPtrVoid          m_dirty;
+      AIS_CPA_OwnShip         m_own;
+      bool                    m_bown_valid;
+      int                     m_n_general;
+      int                     m_npass;
+
+      wxSemaphore             m_semaphore;
+      AIS_CPA_Thread          *m_pThread;
+};
+
+
 
 #define AIS_SOCKET_ID             7
 
 enum
 {
     EVT_AIS_DIRECT,
-    EVT_AIS_PARSE_RX
+    EVT_AIS_PARSE_RX,
+    EVT_AIS_REPLAY_DONE
 };
 
 //----------------------------------------------------------------------------
 // AISEvent
 //----------------------------------------------------------------------------
 
+class OCP_SerialRing;
+
 class OCPN_AISEvent: public wxEvent
 {
       public:
@@ -281,7 +419,10 @@ class OCPN_AISEvent: public wxEvent
             : wxEvent(event),
                 m_NMEAstring(event.m_NMEAstring),
                 m_extra(event.m_extra)
-                { }
+                {
+                      m_pRing = NULL;
+                      SetRing(event.m_pRing);
+                }
 
                 ~OCPN_AISEvent( );
 
@@ -292,12 +433,16 @@ class OCPN_AISEvent: public wxEvent
             void SetExtraLong(long n){ m_extra = n;}
             long GetExtraLong(){ return m_extra;}
 
+            OCP_SerialRing *GetRing() { return m_pRing; }
+            void SetRing(OCP_SerialRing *pRing);
+
     // required for sending with wxPostEvent()
             wxEvent *Clone() const;
 
       private:
-            wxString    m_NMEAstring;
-            long        m_extra;
+            wxString          m_NMEAstring;
+            long              m_extra;
+            OCP_SerialRing    *m_pRing;
 
 };
 
@@ -323,7 +468,8 @@ public:
 
 
     void OnEvtAIS(OCPN_AISEvent& event);
-    AIS_Error Decode(const wxString& str);
+    AIS_Error Decode(const char *str, int len);
+    int DecodeBatch(const char *buffer, int len, int *pn_errors = NULL);
     void Pause(void);
     void UnPause(void);
     void GetSource(wxString& source);
@@ -343,14 +489,17 @@ private:
     void OnTimerAIS(wxTimerEvent& event);
     void OnTimerAISAudio(wxTimerEvent& event);
 
-    bool NMEACheckSumOK(const wxString& str);
+    bool NMEACheckSumOK(const char *str, int len);
     bool Parse_VDXBitstring(AIS_Bitstring *bstr, AIS_Target_Data *ptd);
-    void UpdateAllCPA(void);
-    void UpdateOneCPA(AIS_Target_Data *ptarget);
-    void UpdateAllAlarms(void);
+    void UpdateOwnShipCPA(void);
+    void ApplyCPAResults(void);
+    void UpdateAckTimeout(AIS_Target_Data *ptarget);
     void UpdateAllTracks(void);
     void UpdateOneTrack(AIS_Target_Data *ptarget);
     void Parse_And_Send_Posn(wxString &str_temp_buf);
+    bool ProcessRxSentence(const char *str, int len, AIS_Error *pret = NULL);
+    void DrainRxRing(OCP_SerialRing *pring);
+    void DecodeRxBatch(const char *buffer, int len);
     void ThreadMessage(const wxString &msg);
     void BuildERIShipTypeHash(void);
 
@@ -368,7 +517,8 @@ private:
 
     int               nsentences;
     int               isentence;
-    wxString          sentence_accumulator;
+    char              sentence_accumulator[AIS_MAX_MESSAGE_LEN];
+    int               accumulator_len;
     bool              m_OK;
 
     AIS_Target_Data   *m_pLatestTargetData;
@@ -385,6 +535,14 @@ private:
     bool             m_bGeneralAlert;
     bool             m_bno_erase;
 
+    AIS_CPA_Engine   *m_pCPAEngine;
+    wxArrayInt       m_alarm_mmsi;              // targets last reported in AIS_ALARM_SET state
+
+    bool             m_breplay;                 // a "Replay:" source is playing
+    wxStopWatch      m_replay_sw;               // runs only while replayed sentences decode
+    int              m_n_replay_msgs;
+    int              m_n_replay_errors;
+
 DECLARE_EVENT_TABLE()
 
 
@@ -420,15 +578,10 @@ private:
       AIS_Decoder             *m_pParentEventHandler;
       wxString                *m_pPortName;
       int                     TimeOutInSec;
-      char                    *put_ptr;
-      char                    *tak_ptr;
 
-      char                    *rx_buffer;
-
-      char                    *temp_buf;
+      OCP_SerialRing          *m_pRing;                 // delivery to the GUI thread
 
       unsigned long           error;
-      int                     nl_count;
 
 #ifdef __POSIX__
       termios                 *pttyset;
@@ -443,6 +596,34 @@ private:
 };
 
 
+//-------------------------------------------------------------------------------------------------------------
+//
+//    AIS Replay Thread
+//
+//    Plays a recorded NMEA file into the decoder, as fast as the decoder takes it,
+//    by the same ring and events as the serial input thread
+//
+//-------------------------------------------------------------------------------------------------------------
+
+class OCP_AIS_ReplayThread: public wxThread
+{
+
+public:
+
+      OCP_AIS_ReplayThread(AIS_Decoder *pParent, const wxString& file_name);
+      ~OCP_AIS_ReplayThread(void);
+      void *Entry();
+
+private:
+      void PostRingEvent(long type);
+
+      AIS_Decoder             *m_pParentEventHandler;
+      wxString                m_file_name;
+
+      OCP_SerialRing          *m_pRing;                 // delivery to the GUI thread
+};
+
+
 class AISInfoWin;
 //----------------------------------------------------------------------------------------------------------
 //    AISTargetAlertDialog Specification
@@ -184,6 +184,10 @@ public:
 
       virtual double GetNearestPreferredScalePPM(double target_scale_ppm) = 0;
 
+      //    Approximate heap memory held by this chart, in bytes.
+      //    Used by the chart cache to enforce its memory budget.
+      virtual size_t GetMemoryFootprint(){ return 0; }
+
       virtual int GetCOVREntries(){ return  m_nCOVREntries; }
       virtual int GetCOVRTablePoints(int iTable) { return m_pCOVRTablePoints[iTable]; }
       virtual int  GetCOVRTablenPoints(int iTable){ return m_pCOVRTablePoints[iTable]; }
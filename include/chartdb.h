@@ -91,8 +91,14 @@ public:
       void        *pChart;
       int         RecentTime;
       int         dbIndex;
+      size_t      MemBytes;               // chart footprint as last reported
+      bool        bLocked;                // in the current quilt, so never evicted
+      CacheEntry  *pLRUPrev;              // next more recently used entry
+      CacheEntry  *pLRUNext;              // next less recently used entry
 };
 
+WX_DECLARE_HASH_MAP( int, CacheEntry *, wxIntegerHash, wxIntegerEqual, ChartCacheHash );
+
 
 
 // ----------------------------------------------------------------------------
@@ -121,7 +127,13 @@ public:
       bool SearchForChartDir(wxString &dir);
       ChartBase *OpenStackChartConditional(ChartStack *ps, int start_index, bool bLargest, ChartTypeEnum New_Type, ChartFamilyEnum New_Family_Fallback);
 
-      wxArrayPtrVoid *GetChartCache(void) { return pChartCache; }
+      unsigned int GetChartCacheCount(void) { return m_CacheHash.size(); }
+      size_t GetChartCacheMemory(void) { return m_CacheMemBytes; }
+      size_t GetChartCacheMemoryBudget(void);
+      void UpdateCacheFootprints(void);
+      int  TrimCache(size_t target_bytes, unsigned int max_entries);
+      void LockCacheChart(int dbindex);
+      void UnLockAllCacheCharts(void);
       ArrayOfInts GetCSArray(ChartStack *ps);
 
       int GetStackEntry(ChartStack *ps, wxString fp);
@@ -138,6 +150,7 @@ public:
 
 protected:
       virtual ChartBase *GetChart(const wxChar *theFilePath, ChartClassDescriptor &chart_desc) const;
+      virtual void PrebuildNewCharts(int first_new_index, wxProgressDialog *pprog);
 
 private:
       InitReturn CreateChartTableEntry(wxString full_name, ChartTableEntry *pEntry);
@@ -147,7 +160,18 @@ private:
       bool CheckPositionWithinChart(int index, float lat, float lon);
       ChartBase *OpenChartUsingCache(int dbindex, ChartInitFlag init_flag);
 
-      wxArrayPtrVoid    *pChartCache;
+      CacheEntry *FindCacheEntry(int dbindex);
+      void AddCacheEntry(CacheEntry *pce);
+      void RemoveCacheEntry(CacheEntry *pce);
+      void TouchCacheEntry(CacheEntry *pce);
+      void UpdateCacheEntryFootprint(CacheEntry *pce);
+      void UnlinkCacheEntry(CacheEntry *pce);
+      void DeleteCacheEntryChart(CacheEntry *pce);
+
+      ChartCacheHash    m_CacheHash;            // dbIndex -> cache entry
+      CacheEntry        *m_pCacheMRU;           // head of the LRU list
+      CacheEntry        *m_pCacheLRU;           // tail of the LRU list, first eviction candidate
+      size_t            m_CacheMemBytes;        // sum of entry footprints
 
       MyFrame           *pParent;
 };
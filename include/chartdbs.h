@@ -211,6 +211,35 @@ public:
 WX_DECLARE_OBJARRAY(ChartTableEntry, ChartTable);
 WX_DECLARE_OBJARRAY(ChartClassDescriptor, ArrayOfChartClassDescriptor);
 
+///////////////////////////////////////////////////////////////////////
+// Chart Grid Index
+//    A one degree lat/lon grid over the chart table.
+//    Each cell holds the dbIndex of every chart whose bounding box
+//    touches the cell, sorted by ascending scale.
+///////////////////////////////////////////////////////////////////////
+
+static const int CHART_GRID_NLAT = 180;
+static const int CHART_GRID_NLON = 360;
+
+class ChartGridIndex
+{
+public:
+      ChartGridIndex();
+      ~ChartGridIndex();
+
+      void Clear();
+      void Build(const ChartTable &table);
+      void Remove(int dbIndex, const ChartTableEntry &cte);
+      const wxArrayInt *GetCandidates(float lat, float lon) const;
+      bool IsBuilt() const { return (m_pCells != NULL); }
+
+private:
+      bool GetCellRange(const ChartTableEntry &cte, int *lat_start, int *lat_end, int *lon_start, int *n_lon) const;
+      int  GetLonCell(int ilon) const;
+
+      wxArrayInt  **m_pCells;
+};
+
 class ChartDatabase
 {
 public:
@@ -247,6 +276,10 @@ protected:
     int AddChartDirectory(const wxString &theDir, bool bshow_prog);
     void SetValid(bool valid) { bValid = valid; }
     ChartTableEntry *CreateChartTableEntry(const wxString &filePath, ChartClassDescriptor &chart_desc);
+    const wxArrayInt *GetGridCandidates(float lat, float lon) const { return m_GridIndex.GetCandidates(lat, lon); }
+
+    //  Called after a directory scan has added table entries [first_new_index, GetChartTableEntries())
+    virtual void PrebuildNewCharts(int first_new_index, wxProgressDialog *pprog) {}
 
     ArrayOfChartClassDescriptor    m_ChartClassDescriptorArray;
 
@@ -265,6 +298,7 @@ private:
     ChartTable    chartTable;
 
     ChartTableEntry           m_ChartTableEntryDummy;   // used for return value if database is not valid
+    ChartGridIndex            m_GridIndex;              // spatial index for chart stack building
 
 };
 
@@ -46,9 +46,22 @@
 #define _CHARTIMG_H_
 
 
+#include <wx/thread.h>
+
 #include "chartbase.h"
 #include "georef.h"                 // for GeoRef type
 
+//    On POSIX systems the raster image file is memory mapped, and scanlines
+//    are decoded straight from the mapping instead of through ifs_bitmap
+#ifndef __WXMSW__
+#define ocpnUSE_RASTER_MMAP
+#endif
+
+//    Downsampled renders are split into row bands decoded concurrently,
+//    up to this many threads, and never bands smaller than this many rows
+#define MAX_RASTER_SCALE_THREADS    8
+#define MIN_RASTER_SCALE_BAND       32
+
 typedef enum ScaleTypeEnum
 {
       RENDER_LODEF = 0,
@@ -88,6 +101,7 @@ typedef enum BSB_Color_Capability
 //-----------------------------------------------------------------------------
 
 class ChartKAP;
+class ChartBaseBSBScaleJob;
 class ViewPort;
 class PixelCache;
 class ocpnBitmap;
@@ -146,6 +160,8 @@ class opncpnPalette
 
 class  ChartBaseBSB     :public ChartBase
 {
+      friend class ChartBaseBSBScaleJob;
+
     public:
       //    Public methods
 
@@ -181,6 +197,10 @@ class  ChartBaseBSB     :public ChartBase
 
       void SetVPRasterParms(const ViewPort &vpt);
 
+      virtual size_t GetMemoryFootprint();
+
+      static void ShutdownScaleThreads(void);       // at exit, stop the row band threads
+
 protected:
 //    Methods
 
@@ -208,14 +228,28 @@ protected:
       virtual void InvalidateLineCache();
       virtual bool CreateLineIndex(void);
 
+      bool MapImageFile(const wxString &image_path);
+      void UnmapImageFile(void);
+      unsigned char *BSBSkipScanline(unsigned char *lp, unsigned char *lp_end);
+
+      wxString GetLineIndexFileName(void);
+      bool LoadLineIndex(void);
+      bool ReadLineIndexFile(const wxString &index_name);
+      bool SaveLineIndex(void);
+      bool IsLineIndexValid(const int *ptable);
+      int GetImageFileSize(void);
+
 
       virtual wxBitmap *CreateThumbnail(int tnx, int tny, ColorScheme cs);
-      virtual bool GetChartBits( wxRect& source, unsigned char *pPix, int sub_samp );
-      virtual int BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int xl, int sub_samp);
+      virtual bool GetChartBits( wxRect& source, unsigned char *pPix, int sub_samp, unsigned char *pWorkLine = NULL );
+      virtual int BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int xl, int sub_samp, unsigned char *pWorkLine = NULL );
 
       virtual bool GetAndScaleData(unsigned char *ppn,
                                    wxRect& source, int source_stride, wxRect& dest, int dest_stride,
                                    double scale_factor, ScaleTypeEnum scale_type);
+      bool ScaleRowBand(unsigned char *ppn, wxRect& source, wxRect& dest, int dest_stride,
+                        double scale_factor, ScaleTypeEnum scale_type, int y_start, int y_end, unsigned char *pWorkLine);
+      int GetScaleThreadCount(int n_rows);
 
 
       bool GetViewUsingCache( wxRect& source, wxRect& dest, const wxRegion& Region, ScaleTypeEnum scale_type );
@@ -268,6 +302,9 @@ protected:
       int         *pline_table;           // pointer to Line offset table
 
       CachedLine  *pLineCache;
+      size_t      m_nLineCacheBytes;      // bytes of decoded scanlines held in pLineCache
+      wxMutex     m_LineCacheMutex;       // guards pLineCache while row bands run
+      bool        m_bHasSSE2;
 
       wxFileInputStream     *ifs_hdr;
       wxFileInputStream     *ifss_bitmap;
@@ -275,6 +312,9 @@ protected:
 
       wxString          *pBitmapFilePath;
 
+      unsigned char     *m_pImageMap;           // read-only mapping of the whole raster file, or NULL
+      size_t            m_nImageMapSize;
+
       unsigned char     *ifs_buf;
       unsigned char     *ifs_bufend;
       int               ifs_bufsize;
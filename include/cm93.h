@@ -29,6 +29,7 @@
 #define __CM93CHART_H__
 
 #include <wx/listctrl.h>			// Somehow missing from wx build
+#include <wx/thread.h>
 
 #include    "s57chart.h"
 #include    "cutil.h"               // for types
@@ -38,9 +39,28 @@
 
 #define CM93_ZOOM_FACTOR_MAX_RANGE 5
 
+//    Geometry cache files are mapped, where the platform allows
+#ifndef __WXMSW__
+#define ocpnUSE_CM93_MMAP
+#endif
+
+#define CM93_GEOM_CACHE_MAGIC             "OCPNGC01"
+#define CM93_GEOM_CACHE_MAX_PENDING       16          // cells waiting for the writer thread
+#define CM93_GEOM_CACHE_MAX_BYTES         (256 * 1024 * 1024)
+
+//    Cell prefetching, ahead of the viewport
+#define CM93_PREFETCH_MAX_CELLS           32          // decoded cells held waiting for a load
+#define CM93_PREFETCH_MAX_REQUESTS        24          // cells requested per viewport change
+#define CM93_PREFETCH_PAN_LEAD            1.5         // seconds of panning to look ahead
+#define CM93_PREFETCH_SHIP_LEAD           15.         // minutes of ownship travel to look ahead
+#define CM93_PREFETCH_KEY(cellindex, scale_index)     (((cellindex) * 8) + (scale_index))
+
 //    Static functions
 int Get_CM93_CellIndex(double lat, double lon, int scale);
 void Get_CM93_Cell_Origin(int cellindex, int scale, double *lat, double *lon);
+int Get_CM93_Native_Scale(int scale_index, wxChar *scale_char);
+ArrayOfInts Get_CM93_CellIndexArray(double ll_lat, double ll_lon, double ur_lat, double ur_lon, int native_scale);
+wxString Find_CM93_Cell_File(const wxString &prefix, int cellindex, double dval, const wxString &scalechar, wxChar sub_char);
 
 //    Fwd definitions
 class covr_set;
@@ -205,6 +225,7 @@ typedef struct{
       int                           m_nfeature_records;
       int                           m_n_point3d_records;
       int                           m_n_point2d_records;
+      int                           m_nattribute_bytes;
 
       List_Of_M_COVR_Desc          m_cell_mcovr_list;
       bool                         b_have_offsets;
@@ -284,6 +305,188 @@ class cm93_attr_block
 };
 
 
+//----------------------------------------------------------------------------
+// cm93 decoded cell cache
+//----------------------------------------------------------------------------
+
+//    A position in a decoded cell image
+typedef struct
+{
+      unsigned char     *p;
+      unsigned char     *pend;
+}cm93_cell_cursor;
+
+bool Ingest_CM93_Cell(unsigned char *pimage, int nbytes, Cell_Info_Block *pCIB);
+
+//----------------------------------------------------------------------------
+// cm93 geometry cell
+//    An ingested cell with the object geometry resolved into edge lists and
+//    rings, as cm93chart builds its objects from.  It is a single block of
+//    native-endian records, addressed by byte offsets from its start, so a
+//    cached copy can be used in place.
+//----------------------------------------------------------------------------
+
+typedef struct{
+      char              magic[8];               // CM93_GEOM_CACHE_MAGIC
+      int               cell_file_size;         // of the source cell file
+      int               cell_file_time;
+      int               nbytes;                 // of the whole geometry cell
+      int               n_edges;
+      int               n_objects;
+      int               n_attribute_bytes;
+
+      double            transform_x_rate;
+      double            transform_y_rate;
+      double            transform_x_origin;
+      double            transform_y_origin;
+
+      int               edge_table;             // cm93_geom_edge[n_edges]
+      int               object_table;           // cm93_geom_object[n_objects]
+      int               attribute_block;        // the encoded attributes of all objects
+      int               reserved;
+}cm93_geom_header;
+
+typedef struct{
+      int               n_points;
+      int               points;                 // cm93_point[n_points]
+}cm93_geom_edge;
+
+typedef struct{
+      unsigned char     otype;
+      unsigned char     geotype;
+      unsigned char     n_attributes;
+      signed char       geomtype;               // as resolved, or -1 if not understood
+      int               attributes;             // offset into the attribute block, or -1
+      int               geometry;               // record for geomtype, or 0 for none
+}cm93_geom_object;
+
+//    Area (geomtype 3) and line (geomtype 2) geometry.  Followed by
+//    int edge_index[n_vector_indices], cm93_point vertex[n_max_vertex] and
+//    int contour[n_contours].
+typedef struct{
+      int               n_vector_indices;
+      int               n_contours;
+      int               n_max_vertex;
+      int               n_max_edge_points;
+      int               xmin, xmax, ymin, ymax;
+}cm93_geom_poly;
+
+//    Single points (geomtype 1) are one cm93_point.
+//    Soundings (geomtype 8) are an int count, followed by cm93_point_3d[count].
+
+bool Resolve_CM93_Cell(Cell_Info_Block *pCIB, int cell_file_size, int cell_file_time, unsigned char **ppdata, int *pnbytes);
+bool Validate_CM93_Geom_Cell(unsigned char *pdata, int nbytes);
+
+//    A geometry cell, either mapped from the cache or freshly read and resolved
+class cm93_cell_image
+{
+      public:
+            unsigned char     *pdata;
+            int               nbytes;
+
+            void              *pmap;            // non-NULL if mapped from the cache
+            size_t            map_size;
+            bool              b_from_cache;
+
+            wxString          cell_file;
+};
+
+class CM93CacheWriteJob
+{
+      public:
+            wxString          m_cache_file;
+            unsigned char     *m_pdata;         // geometry cell, owned by the job
+            int               m_nbytes;
+};
+
+WX_DEFINE_ARRAY_PTR(CM93CacheWriteJob *, ArrayOfCM93CacheWriteJobs);
+WX_DEFINE_ARRAY_PTR(cm93_cell_image *, ArrayOfCM93CellImages);
+
+class CM93CellCache;
+
+class CM93CacheWriterThread : public wxThread
+{
+      public:
+            CM93CacheWriterThread(CM93CellCache *pcache);
+            void *Entry();
+
+      private:
+            CM93CellCache     *m_pcache;
+};
+
+class CM93PrefetchThread : public wxThread
+{
+      public:
+            CM93PrefetchThread(CM93CellCache *pcache);
+            void *Entry();
+
+      private:
+            CM93CellCache     *m_pcache;
+};
+
+//    The cm93 cell files are byte-substitution encoded, and were decoded and
+//    their object geometry rebuilt on every load.  Cells are now read whole,
+//    decoded in a single pass and resolved into geometry cells.  These are
+//    kept in g_PrivateDataDir/cm93/geom, keyed by the size and time of the
+//    source cell, and written by a background thread so that chart loading
+//    does not wait on the disk.  Repeat visits map the cached cell.
+//
+//    A second thread loads the cells the composite chart expects to need
+//    next, and holds a bounded number of them in memory for LoadCell().
+class CM93CellCache
+{
+      public:
+            CM93CellCache();
+            ~CM93CellCache();
+
+            bool LoadCell(const wxString &cell_file, cm93_cell_image *pimg);
+            void ReleaseCell(cm93_cell_image *pimg);
+
+            //    Replace the outstanding prefetch requests, as CM93_PREFETCH_KEY()s
+            void RequestPrefetch(const wxString &prefix, const ArrayOfInts &keys);
+            void GetPrefetchStats(int *hits, int *misses, int *unused);
+
+            //    Writer thread interface
+            CM93CacheWriteJob *WaitForJob();
+            bool WriteCacheFile(CM93CacheWriteJob *pjob);
+            void TrimCacheDir();
+
+            //    Prefetch thread interface
+            bool WaitForPrefetch();
+            void ServicePrefetchRequests();
+
+      private:
+            bool LoadCellImage(const wxString &cell_file, cm93_cell_image *pimg);
+            wxString GetCacheFileName(const wxString &cell_file);
+            bool ReadCacheFile(const wxString &cache_file, int file_size, int file_time, cm93_cell_image *pimg);
+            bool QueueWrite(CM93CacheWriteJob *pjob);
+            bool IsPrefetched(const wxString &cell_file);
+            void StorePrefetched(cm93_cell_image *pimg);
+
+            wxString                      m_cache_dir;
+
+            CM93CacheWriterThread         *m_pwriter;
+            ArrayOfCM93CacheWriteJobs     m_jobs;
+            wxSemaphore                   m_semaphore;
+            double                        m_cache_bytes;    // in the cache directory, as far as the writer knows
+
+            int                           m_nhits;
+            int                           m_nmisses;
+
+            wxMutex                       m_mutex;
+            bool                          m_bstop;
+
+            CM93PrefetchThread            *m_pprefetcher;
+            wxSemaphore                   m_prefetch_semaphore;
+            wxString                      m_prefetch_prefix;
+            ArrayOfInts                   m_prefetch_requests;
+            ArrayOfCM93CellImages         m_prefetched;     // oldest first
+
+            int                           m_nprefetch_hits;
+            int                           m_nprefetch_misses;
+            int                           m_nprefetch_unused;
+};
+
 //----------------------------------------------------------------------------
 // cm93 Chart Manager class
 //----------------------------------------------------------------------------
@@ -294,9 +497,11 @@ public:
     ~cm93manager();
     bool Loadcm93Dictionary(wxString name);
     cm93_dictionary *FindAndLoadDict(const wxString &file);
+    CM93CellCache *GetCellCache(void);
 
 
     cm93_dictionary   *m_pcm93Dict;
+    CM93CellCache     *m_pCellCache;
 
     //  Member variables used to record the calling of cm93chart::CreateHeaderDataFromCM93Cell()
     //  for each available scale value.  This allows that routine to return quickly with no error
@@ -344,6 +549,7 @@ class cm93chart : public s57chart
             covr_set *GetCoverSet(){ return m_pcovr_set; }
 
             ArrayOfInts GetVPCellArray(const ViewPort &vpt);
+            bool IsCellLoaded(int cellindex);
 
             Array_Of_M_COVR_Desc_Ptr    m_pcovr_array_loaded;
 
@@ -357,7 +563,8 @@ class cm93chart : public s57chart
       private:
             InitReturn CreateHeaderDataFromCM93Cell(void);
             int read_header_and_populate_cib(header_struct *ph, Cell_Info_Block *pCIB);
-            Extended_Geometry *BuildGeom(Object *pobject, wxFileOutputStream *postream, int iobject);
+            Extended_Geometry *BuildGeom(int iobject);
+            void GetCellObject(int iobject, Object *pobject);
 
             S57Obj *CreateS57Obj( int cell_index, int iobject, int subcell, Object *pobject, cm93_dictionary *pDict, Extended_Geometry *xgeom,
                                              double ref_lat, double ref_lon, double scale);
@@ -382,6 +589,7 @@ class cm93chart : public s57chart
 
 
             Cell_Info_Block   m_CIB;
+            cm93_cell_image   m_cell_image;                 // the (sub)cell being loaded
 
             cm93_dictionary   *m_pDict;
 
@@ -393,8 +601,6 @@ class cm93chart : public s57chart
             ArrayOfInts       m_cells_loaded_array;
 
             int               m_current_cell_vearray_offset;
-            int               *m_pcontour_array;
-            int               m_ncontour_alloc;
             ViewPort          m_vp_current;
             wxChar            m_loadcell_key;
             double            m_dval;
@@ -469,6 +675,7 @@ class cm93compchart : public s57chart
             void SetOffsetDialog(CM93OffsetDialog *dialog){ m_pOffsetDialog = dialog; }
 
             void InvalidateCache();
+            size_t GetMemoryFootprint();
       private:
             bool RenderViewOnDC(wxMemoryDC& dc, const ViewPort& VPoint);
 
@@ -477,6 +684,8 @@ class cm93compchart : public s57chart
             void FillScaleArray(double lat, double lon);
             int PrepareChartScale(const ViewPort &vpt, int cmscale);
             int GetCMScaleFromVP(const ViewPort &vpt);
+            void PrefetchCells(const ViewPort &vpt, int cmscale);
+            void AddPrefetchCells(ArrayOfInts &keys, LLBBox &box, int cmscale);
             bool DoRenderRegionViewOnDC(wxMemoryDC& dc, const ViewPort& VPoint, const wxRegion &Region);
 
 
@@ -500,6 +709,14 @@ class cm93compchart : public s57chart
             int               m_special_offset_y;
             ViewPort          m_vpt;
 
+            //    Viewport motion, for the cell prefetcher
+            wxLongLong        m_prefetch_time;
+            double            m_prefetch_lat;
+            double            m_prefetch_lon;
+            double            m_prefetch_ppm;
+            double            m_pan_vlat;                   // degrees per second
+            double            m_pan_vlon;
+
             CM93OffsetDialog  *m_pOffsetDialog;
 };
 
@@ -46,9 +46,10 @@
 //#include "/usr/include/valgrind/callgrind.h"
 
 //  Chart cacheing policy
-//  n.b. use only one of the following policy options....
+//  The cache is trimmed to a memory budget, with an upper bound on the number of charts
 #define CACHE_N_LIMIT_DEFAULT 20                              // Cache no more than n charts
-//#define CACHE_MEM_LIMIT 60000                             // Free mem threshold for freeing a chart from cache
+#define CACHE_MEM_LIMIT_DEFAULT 0                             // Cache memory budget in MBytes, 0 = half of physical memory
+#define S57_TILE_CACHE_MB_DEFAULT 64                          // Rendered S57 tile cache budget in MBytes, 0 = no tile cache
 
 
 
@@ -205,6 +206,20 @@ static char *cvsid_aw() { return( cvsid_aw() ? ((char *) NULL) : cpl_cvsid ); }
 
 #endif
 
+//      Fix up CPL_THREADLOCAL if not available
+//      This code block taken directly from <cpl_port.h>
+#ifndef CPL_THREADLOCAL
+#if defined(_MSC_VER)
+#  define CPL_THREADLOCAL       __declspec(thread)
+#  define CPL_HAVE_THREADLOCAL
+#elif defined(__GNUC__) && !defined(__APPLE__)
+#  define CPL_THREADLOCAL       __thread
+#  define CPL_HAVE_THREADLOCAL
+#else
+#  define CPL_THREADLOCAL
+#endif
+#endif
+
 
 /***********************************************************************
  * Define __POSIX__ to imply posix thread model compatibility
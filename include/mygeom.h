@@ -216,7 +216,7 @@ class PolyTessGeo
         PolyTessGeo();
         ~PolyTessGeo();
 
-        PolyTessGeo(unsigned char *polybuf, int nrecl, int index);      // Build this from SENC file record
+        PolyTessGeo(SENCTess *ptess, int index);                        // Build this from a checked binary SENC block
 
         PolyTessGeo(OGRPolygon *poly, bool bSENC_SM,
             double ref_lat, double ref_lon,  bool bUseInternalTess);  // Build this from OGRPolygon
@@ -236,7 +236,6 @@ class PolyTessGeo
     private:
         int PolyTessGeoGL(OGRPolygon *poly, bool bSENC_SM, double ref_lat, double ref_lon);
         int PolyTessGeoTri(OGRPolygon *poly, bool bSENC_SM, double ref_lat, double ref_lon);
-        int my_bufgets( char *buf, int buf_len_max );
 
 
 
@@ -251,10 +250,6 @@ class PolyTessGeo
         int             ncnt;
         int             nwkb;
 
-        char           *m_buf_head;
-        char           *m_buf_ptr;                   // used to read passed SENC record
-        int            m_nrecl;
-
         double         m_ref_lat, m_ref_lon;
 
 };
@@ -258,6 +258,85 @@ WX_DECLARE_LIST(Route, RouteList);                    // establish class Route a
 
 #define TIMER_TRACK1           778
 
+//----------------------------------------------------------------------------
+//    Track point store
+//
+//    A track's fixes, kept in fixed size chunks of parallel arrays.
+//    Recorded and loaded tracks hold their plain fixes only here, and get
+//    a RoutePoint only for fixes carrying a mark, see Track::AddFix()
+//----------------------------------------------------------------------------
+
+#define TRACK_CHUNK_POINTS      512
+#define TRACK_DRAW_MIN_PIX      2           // Fixes closer than this on screen are not drawn separately
+
+//    Douglas-Peucker levels of detail, built per chunk
+#define TRACK_LOD_LEVELS        12
+#define TRACK_LOD_BASE_TOL      1.0         // Tolerance of the finest level, Mercator meters
+#define TRACK_LOD_LEVEL_STEP    4.0         // Each level is this much coarser than the one before
+#define TRACK_LOD_KEEP          1.0e30      // Weight of fixes kept at every level
+
+enum {
+      TRACK_STYLE_DEFAULT = 0,
+      TRACK_STYLE_RED,
+      TRACK_STYLE_BLUE,
+      TRACK_STYLE_GREEN
+};
+
+class TrackPointChunk
+{
+public:
+      TrackPointChunk();
+      ~TrackPointChunk();
+
+      void BuildLOD(void);
+      bool IsLODValid(void){ return m_lod_nPoints == m_nPoints; }
+      int GetLODCount(int level){ return m_lod_start[level + 1] - m_lod_start[level]; }
+      unsigned short *GetLODIndex(int level){ return &m_plod_index[m_lod_start[level]]; }
+
+      double            m_lat[TRACK_CHUNK_POINTS];
+      double            m_lon[TRACK_CHUNK_POINTS];
+      time_t            m_time[TRACK_CHUNK_POINTS];
+      unsigned short    m_segno[TRACK_CHUNK_POINTS];
+      unsigned char     m_style[TRACK_CHUNK_POINTS];
+      int               m_nPoints;
+
+      wxBoundingBox     m_bbox;                 // includes the last fix of the previous chunk
+
+private:
+      float             m_lod_weight[TRACK_CHUNK_POINTS];     // largest tolerance at which the fix survives
+      unsigned short    *m_plod_index;                        // fixes kept at each level, finest level first
+      int               m_lod_start[TRACK_LOD_LEVELS + 1];
+      int               m_lod_nPoints;                        // m_nPoints when the levels were built
+};
+
+WX_DEFINE_ARRAY_PTR(TrackPointChunk *, ArrayOfTrackPointChunks);
+
+class TrackPointStore
+{
+public:
+      TrackPointStore();
+      ~TrackPointStore();
+
+      void Append(double lat, double lon, time_t t, int segno, int style);
+      void Clear(void);
+
+      int GetCount(void){ return m_nPoints; }
+      int GetChunkCount(void){ return m_chunks.GetCount(); }
+      TrackPointChunk *GetChunk(int i){ return m_chunks.Item(i); }
+
+      //    Access by fix index, every chunk but the last one is full
+      double GetLat(int i){ return m_chunks.Item(i / TRACK_CHUNK_POINTS)->m_lat[i % TRACK_CHUNK_POINTS]; }
+      double GetLon(int i){ return m_chunks.Item(i / TRACK_CHUNK_POINTS)->m_lon[i % TRACK_CHUNK_POINTS]; }
+      time_t GetTime(int i){ return m_chunks.Item(i / TRACK_CHUNK_POINTS)->m_time[i % TRACK_CHUNK_POINTS]; }
+      int GetSegNo(int i){ return m_chunks.Item(i / TRACK_CHUNK_POINTS)->m_segno[i % TRACK_CHUNK_POINTS]; }
+      void SetTime(int i, time_t t){ m_chunks.Item(i / TRACK_CHUNK_POINTS)->m_time[i % TRACK_CHUNK_POINTS] = t; }
+
+private:
+      ArrayOfTrackPointChunks m_chunks;
+      int               m_nPoints;
+};
+
+
 //----------------------------------------------------------------------------
 //    Track
 //----------------------------------------------------------------------------
@@ -281,10 +360,26 @@ class Track : public wxEvtHandler, public Route
 
             Route *RouteFromTrack(wxProgressDialog *pprog);
 
+            //    Until something needs the whole RoutePoint list, a track keeps
+            //    its plain fixes in m_TrackPoints only
+            void AddFix(double lat, double lon, time_t t, int segno, RoutePoint *prp = NULL);
+            bool IsRealized(void){ return pRoutePointList->GetCount() != 0; }
+            void RealizeTrackPoints(void);
+            void ExtendTrack(Track *psource, int begin, wxString suffix);
+            void AddSelectableTrackSegments(void);
+            void DeleteIconPoints(void);
+            bool IsSameTrack(Track *ptrack);
+            wxDateTime GetStartTime(void);
+            wxDateTime GetEndTime(void);
+            TrackPointStore *GetTrackPoints(void){ SyncTrackPoints(); return &m_TrackPoints; }
+            wxArrayPtrVoid *GetIconPoints(void){ return &m_IconPoints; }
+            wxArrayInt *GetIconPointIndex(void){ return &m_IconPointIndex; }
 
       private:
             void OnTimerTrack(wxTimerEvent& event);
             void AddPointNow(bool do_add_point = false);
+            void SyncTrackPoints(void);
+            void AppendTrackPoint(RoutePoint *prp);
 
             bool              m_bRunning;
             wxTimer           m_TimerTrack;
@@ -301,6 +396,10 @@ class Track : public wxEvtHandler, public Route
             int               m_track_run;
             double            m_minTrackpoint_delta;
 
+            TrackPointStore   m_TrackPoints;
+            wxArrayPtrVoid    m_IconPoints;           // RoutePoints of an unrealized track, one per marked fix
+            wxArrayInt        m_IconPointIndex;       // their fix indices, ascending
+
 
 
 DECLARE_EVENT_TABLE()
@@ -352,7 +451,7 @@ void UpdateRoute(Route *pTentRoute);
 
 GpxWptElement *CreateGPXWpt ( RoutePoint *pr, char * waypoint_type, bool b_props_explicit = false );
 GpxRteElement *CreateGPXRte ( Route *pRoute );
-GpxTrkElement *CreateGPXTrk ( Route *pRoute );
+GpxTrkElement *CreateGPXTrk ( Route *pRoute, bool b_points = true );
 
 bool WptIsInRouteList(RoutePoint *pr);
 RoutePoint *WaypointExists( const wxString& name, double lat, double lon);
@@ -448,12 +547,40 @@ public:
       void  *m_pData2;
       void  *m_pData3;
       int   m_Data4;
+
+      //    Select index bookkeeping
+      int         m_nseq;                             // insertion order
+      int         m_grid_x0, m_grid_y0;               // grid cells indexed under,
+      int         m_grid_x1, m_grid_y1;               // x0 > x1 if kept unindexed
+      void        *m_pnode;                           // node in the select list
+      SelectItem  *m_pnext_same_data;                 // next item of this type with the same m_pData1
 };
 
 
 
 WX_DECLARE_LIST(SelectItem, SelectableItemList);// establish class as list member
 
+//    Select spatial index, one per selectable type
+#define SELECT_GRID_DEG               0.1         // Grid cell size, degrees
+#define SELECT_GRID_MAX_ITEM_CELLS    64          // Items spanning more cells are always tested
+#define SELECT_GRID_MAX_QUERY_CELLS   400         // Wider searches walk the whole select list
+
+WX_DECLARE_HASH_MAP( int, wxArrayPtrVoid*, wxIntegerHash, wxIntegerEqual, SelectGridHash );
+WX_DECLARE_HASH_MAP( void*, SelectItem*, wxPointerHash, wxPointerEqual, SelectDataHash );
+
+class SelectTypeIndex
+{
+public:
+      SelectTypeIndex();
+      ~SelectTypeIndex();
+
+      SelectGridHash    m_grid;
+      wxArrayPtrVoid    m_unindexed;                  // items too large for the grid
+      SelectDataHash    m_data;                       // first item added for each m_pData1
+};
+
+WX_DECLARE_HASH_MAP( int, SelectTypeIndex*, wxIntegerHash, wxIntegerEqual, SelectTypeIndexHash );
+
 
 
 class Select
@@ -487,6 +614,9 @@ public:
 
       bool IsSelectableSegmentSelected(float slat, float slon, float SelectRadius, SelectItem *pFindSel);
 
+      //    Move a point item found by FindSelection(), keeping the index current
+      void ModifySelectableItem(SelectItem *pFindSel, float slat, float slon);
+
 
 //    Generic Point Support
 //      e.g. Tides/Currents and AIS Targets
@@ -503,9 +633,19 @@ public:
       SelectableItemList *GetSelectList(){return pSelectList;}
 
 private:
+      void AddItem(SelectItem *pSelItem);
+      void RemoveItem(SelectItem *pSelItem);
+      SelectTypeIndex *GetTypeIndex(int seltype, bool bcreate);
+      void GridInsert(SelectTypeIndex *pidx, SelectItem *pSelItem);
+      void GridRemove(SelectTypeIndex *pidx, SelectItem *pSelItem);
+      bool GetCandidates(float slat, float slon, int fseltype, float SelectRadius, wxArrayPtrVoid &candidates);
+      bool IsItemSelected(SelectItem *pFindSel, float slat, float slon, float SelectRadius);
 
       SelectableItemList      *pSelectList;
 
+      SelectTypeIndexHash     m_type_index;
+      int                     m_nseq_next;
+
 };
 
 
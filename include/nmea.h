@@ -55,6 +55,9 @@
 #include "wx/socket.h"
 ////////////////////TH100126/////////////////
 #include <wx/datetime.h>
+#include <wx/thread.h>
+
+#include "serialring.h"
 
 
 #include "nmea0183.h"
@@ -134,7 +137,10 @@ class OCPN_NMEAEvent: public wxEvent
             OCPN_NMEAEvent(const OCPN_NMEAEvent & event)
             : wxEvent(event),
               m_NMEAstring(event.m_NMEAstring)
-              { }
+              {
+                    m_pRing = NULL;
+                    SetRing(event.m_pRing);
+              }
 
              ~OCPN_NMEAEvent( );
 
@@ -142,12 +148,17 @@ class OCPN_NMEAEvent: public wxEvent
             wxString GetNMEAString() { return m_NMEAstring; }
             void SetNMEAString(wxString &string) { m_NMEAstring = string; }
 
+            //    Events from serial threads carry the ring to drain, instead of a sentence
+            OCP_SerialRing *GetRing() { return m_pRing; }
+            void SetRing(OCP_SerialRing *pRing);
+
 
     // required for sending with wxPostEvent()
             wxEvent *Clone() const; // { return new OCPN_NMEAEvent(*this); }
 
       private:
-            wxString    m_NMEAstring;
+            wxString          m_NMEAstring;
+            OCP_SerialRing    *m_pRing;
 
 //            DECLARE_DYNAMIC_CLASS(OCPN_NMEAEvent)
 
@@ -288,6 +299,7 @@ public:
 
 private:
       void Parse_And_Send_Posn(wxString &str_temp_buf);
+      void HandleRead(char *buf, int character_count);
       void ThreadMessage(const wxString &msg);          // Send a wxLogMessage to main program event loop
       wxEvtHandler            *m_pMainEventHandler;
       NMEAHandler             *m_launcher;
@@ -301,6 +313,8 @@ private:
       char                    *rx_buffer;
       char                    *temp_buf;
 
+      OCP_SerialRing          *m_pRing;
+
       unsigned long           error;
 
       NMEA0183                m_NMEA0183;
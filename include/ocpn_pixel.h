@@ -343,4 +343,25 @@ class /*WXDLLEXPORT*/ ocpnMemDC : public wxMemoryDC
    DECLARE_DYNAMIC_CLASS(ocpnMemDC)
 };
 
+#include "pixelkernels.h"
+
+//    Fill a pixel rectangle of the given depth (24 or 32) with one colour
+void ocpnFillPixelRect(unsigned char *pdest, int pitch, int width, int height, int depth,
+                       unsigned char r, unsigned char g, unsigned char b);
+
+// ============================================================================
+// Render buffer pool
+// ============================================================================
+
+//    Pixel buffers for transient render canvases.
+//    Buffers are aligned to OCPN_PIXBUF_ALIGN bytes, and are recycled rather than freed,
+//    until ocpnFreePixelBufferPool() is called.
+//    Safe to call from any thread.
+#define OCPN_PIXBUF_ALIGN           64
+#define OCPN_PIXBUF_POOL_MAX        8                 // free buffers kept for reuse
+
+unsigned char *ocpnGetPixelBuffer(size_t size);
+void ocpnReleasePixelBuffer(unsigned char *pbuf);
+void ocpnFreePixelBufferPool(void);                   // at shutdown
+
 #endif  // _OCPN_PIXEL_H_
@@ -0,0 +1,58 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenCPN
+ * Purpose:  Pixel kernels, with SSE2 versions
+ * Author:   David Register
+ *
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register   *
+ *   $EMAIL$   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ *
+ *
+ *
+ *
+ */
+
+
+#ifndef __PIXELKERNELS_H__
+#define __PIXELKERNELS_H__
+
+// ============================================================================
+// Raster scaling kernels
+// ============================================================================
+
+//    SSE2 versions are compiled when the compiler targets SSE2,
+//    and used only if the running CPU reports it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define ocpnUSE_SSE2
+#endif
+
+bool ocpnCPUHasSSE2(void);
+
+//    Store count copies of the 24 bit pixel held in the low bytes of rgbval
+void ocpnFillPixelRun24(unsigned char *pdest, int rgbval, int count);
+void ocpnFillPixelRun24_C(unsigned char *pdest, int rgbval, int count);
+
+//    psum[i] = sum of psrc[i + r * row_bytes] for r in [0, n_rows), i in [0, n_bytes)
+//    n_rows must not exceed 257, so that the sums fit
+void ocpnColumnSum8(const unsigned char *psrc, int row_bytes, int n_rows, int n_bytes, unsigned short *psum);
+void ocpnColumnSum8_C(const unsigned char *psrc, int row_bytes, int n_rows, int n_bytes, unsigned short *psum);
+
+#endif
@@ -61,6 +61,96 @@ WX_DECLARE_LIST(S57Obj, ObjList);
 class ViewPort;
 class PixelCache;
 
+#define PLIB_EDGE_ARRAY_SIZE  2000        // entries in the area fill edge arrays
+
+//    Rule classes drawn by s52plib::_draw()
+//    A tiled s57chart view draws the lines of line and area features per tile,
+//    and all symbols and text once over the whole view.
+#define S52_DRAW_LINES        0x01        // LS, LC
+#define S52_DRAW_SYMBOLS      0x02        // SY, TX, TE, soundings, arcs
+#define S52_DRAW_ALL          (S52_DRAW_LINES | S52_DRAW_SYMBOLS)
+
+//-----------------------------------------------------------------------------
+//    A recorded area fill primitive
+//    The colour, pattern and screen geometry are resolved when recorded, so the fill
+//    can be rasterized later, and from any thread, without touching plib or chart state.
+//-----------------------------------------------------------------------------
+
+class S52AreaFill
+{
+public:
+      S52AreaFill();
+      ~S52AreaFill();
+
+      ObjRazRules             *rzRules;
+      S52color                color;
+      bool                    bpattern;
+      render_canvas_parms     patt_spec;        // copy of the pattern spec, with this object's origin
+
+      //    Screen geometry, projected once
+      wxPoint                 *ppoints;         // triangle primitive vertices in view, or trapezoid segment vertices
+      int                     *pprim_start;     // per triangle primitive, start in ppoints, or -1 if out of view
+      int                     *ptrap_y;         // per trapezoid, top and bottom row
+      int                     ymin;             // rows covered, empty if ymin > ymax
+      int                     ymax;
+};
+
+WX_DEFINE_ARRAY_PTR(S52AreaFill *, ArrayOfAreaFills);
+
+//-----------------------------------------------------------------------------
+//    LUP resolution index
+//    Each LUP attribute code (ATTC) is compiled once into a typed predicate,
+//    and the LUP resolved for a given object class and attribute value set is remembered.
+//-----------------------------------------------------------------------------
+
+class S52AttcPredicate
+{
+public:
+      S52AttcPredicate(const wxString& attc);
+      ~S52AttcPredicate();
+
+      bool Match(S57attVal *v);
+
+      char        m_acronym[7];
+      bool        m_bAnyValue;                // value ' ', any object value matches
+      bool        m_bIntValid;
+      int         m_ival;
+      bool        m_bRealValid;
+      float       m_fval;
+      char        *m_pStrValue;               // UTF-8
+};
+
+WX_DEFINE_ARRAY_PTR(S52AttcPredicate *, ArrayOfAttcPredicates);
+
+class S52LUPCandidate
+{
+public:
+      S52LUPCandidate(LUPrec *pLUP);
+      ~S52LUPCandidate();
+
+      LUPrec                  *m_pLUP;
+      ArrayOfAttcPredicates   m_predicates;
+};
+
+WX_DEFINE_ARRAY_PTR(S52LUPCandidate *, ArrayOfLUPCandidates);
+WX_DECLARE_STRING_HASH_MAP( LUPrec *, LUPSignatureHash );
+
+#define LUP_SIGNATURE_CACHE_MAX     4096        // resolved attribute sets remembered per object class
+
+class S52LUPClassIndex
+{
+public:
+      S52LUPClassIndex(){}
+      ~S52LUPClassIndex();
+
+      ArrayOfLUPCandidates    m_candidates;           // in LUP table order
+      wxArrayPtrVoid          m_acronyms;             // (char *) attributes tested by any candidate
+      LUPSignatureHash        m_resolved;             // attribute value signature -> LUP
+};
+
+WX_DECLARE_STRING_HASH_MAP( S52LUPClassIndex *, LUPClassHash );
+WX_DECLARE_STRING_HASH_MAP( LUPrec *, CSLUPHash );
+
 //-----------------------------------------------------------------------------
 //    s52plib definition
 //-----------------------------------------------------------------------------
@@ -102,8 +192,16 @@ public:
       void PrepareForRender(void);
       void AdjustTextList(int dx, int dy,  int screenw, int screenh);
       void ClearTextList(void);
-      int _draw(wxDC *pdc, ObjRazRules *rzRules, ViewPort *vp);
+      int _draw(wxDC *pdc, ObjRazRules *rzRules, ViewPort *vp, int draw_rules = S52_DRAW_ALL);
       int RenderArea(wxDC *pdc, ObjRazRules *rzRules, ViewPort *vp, render_canvas_parms *pb_spec);
+
+//    Deferred area rendering
+//    Between Begin and End, RenderArea() appends fills to the list rather than rasterizing them.
+//    RenderAreaFillList() may then be called concurrently for disjoint render canvases.
+      void BeginAreaFillList(ArrayOfAreaFills *plist);
+      void EndAreaFillList(void);
+      void RenderAreaFillList(ArrayOfAreaFills *plist, ViewPort *vp, render_canvas_parms *pb_spec);
+      void ClearAreaFillList(ArrayOfAreaFills *plist);
       int SetLineFeaturePriority( ObjRazRules *rzRules, int npriority );
 
  // Accessors
@@ -156,9 +254,13 @@ public:
 
       int RenderToBufferAC(ObjRazRules *rzRules, Rules *rules, ViewPort *vp, render_canvas_parms *pb_spec);
       int RenderToBufferAP(ObjRazRules *rzRules, Rules *rules, ViewPort *vp, render_canvas_parms *pb_spec);
+      void AddAreaFill(ObjRazRules *rzRules, ViewPort *vp, S52color *c, render_canvas_parms *ppatt_spec);
 
       void RenderToBufferFilledPolygon(ObjRazRules *rzRules, S57Obj *obj, S52color *c, wxBoundingBox &BBView,
                render_canvas_parms *pb_spec, render_canvas_parms *patt_spec);
+      void ProjectFilledPolygon(ObjRazRules *rzRules, S57Obj *obj, wxBoundingBox &BBView, S52AreaFill *pfill);
+      void RenderProjectedPolygon(S57Obj *obj, S52AreaFill *pfill, S52color *c,
+               render_canvas_parms *pb_spec, render_canvas_parms *patt_spec);
 
       void draw_lc_poly(wxDC *pdc, wxPoint *ptp, int npt,
                         float sym_len, float sym_factor, Rule *draw_rule, ViewPort *vp);
@@ -183,7 +285,9 @@ public:
 
       wxArrayOfLUPrec *SelectLUPARRAY(LUPname TNAM);
 
-      LUPrec *FindBestLUP(wxArrayPtrVoid *nameMatch,char *objAtt, wxArrayOfS57attVal *objAttVal, bool bStrict);
+      LUPClassHash *GetLUPIndex(LUPname TNAM);
+      void DestroyLUPIndex(void);
+      LUPrec *FindBestLUP(S52LUPClassIndex *pci, const char *objAtt, wxArrayOfS57attVal *objAttVal, bool bStrict);
       Rules *StringToRules(const wxString& str_in);
       void GetAndAddCSRules(ObjRazRules *rzRules, Rules *rules);
 
@@ -239,6 +343,9 @@ public:
       wxArrayOfLUPrec *pointPaperLUPArray;      // points: PAPER_CHART
       wxArrayOfLUPrec *condSymbolLUPArray;      // Dynamic Conditional Symbology
 
+      LUPClassHash    *m_pLUPIndex[LUPNAME_NUM];  // per LUP table, built on first lookup
+      CSLUPHash       *m_pCSLUPHash;              // condSymbolLUPArray, by class, category and instruction
+
       int         m_LUPSequenceNumber;
 
       wxArrayPtrVoid *ColorTableArray;
@@ -256,6 +363,8 @@ public:
       int         *ledge;
       int         *redge;
 
+      ArrayOfAreaFills  *m_pAreaFillList;       // non-NULL while recording area fills
+
       int         m_colortable_index;
       int         m_colortable_index_save;
 
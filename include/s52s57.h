@@ -43,13 +43,112 @@
 
 #include "bbox.h"
 
-#define CURRENT_SENC_FORMAT_VERSION  122
+#define CURRENT_SENC_FORMAT_VERSION  123
+
+//----------------------------------------------------------------------------------
+//    Binary SENC file layout
+//
+//    A SENCFileHeader, followed by a sequence of records.  Each record is a
+//    SENCRecordHeader and record_length bytes of payload, padded to 8 bytes.
+//    Values are in host byte order, since the SENC is a local cache file.
+//
+//    Feature record payload:
+//          SENCFeatureHeader
+//          n_attributes * (SENCAttributeHeader, value padded to 4 bytes)
+//          geometry, by geom_type:
+//            SENC_GEOM_POINT       float easting, northing
+//            SENC_GEOM_MULTIPOINT  int npt, float e/n/depth[npt * 3], float lonmax, lonmin, latmax, latmin
+//            SENC_GEOM_LINE        int npt, float e/n[npt * 2], float lonmax, lonmin, latmax, latmin,
+//                                  int n_lsindex, int lsindex[n_lsindex * 3]
+//            SENC_GEOM_AREA        int tess_bytes, PolyTessGeo block[tess_bytes],
+//                                  int n_lsindex, int lsindex[n_lsindex * 3]
+//
+//    Edge table payload:           int n, n * (int rcid, int npt, double e/n[npt * 2])
+//    Connected node table payload: int n, n * (int rcid, double e, double n)
+//----------------------------------------------------------------------------------
+#define SENC_FILE_MAGIC       "OCPNSENC"
+#define SENC_PAD8(n)          (((n) + 7) & ~7)
+#define SENC_PAD4(n)          (((n) + 3) & ~3)
+
+typedef enum _SENCRecordType{
+    SENC_RECORD_END       = 0,
+    SENC_RECORD_FEATURE,
+    SENC_RECORD_VE_TABLE,
+    SENC_RECORD_VC_TABLE
+}SENCRecordType;
+
+typedef enum _SENCGeomType{
+    SENC_GEOM_NONE        = 0,
+    SENC_GEOM_POINT,
+    SENC_GEOM_MULTIPOINT,
+    SENC_GEOM_LINE,
+    SENC_GEOM_AREA
+}SENCGeomType;
+
+typedef struct _SENCFileHeader{
+      char        magic[8];
+      int         version;
+      int         header_size;
+      int         n_geo_records;                // NOGR of the base cell
+      int         n_features;                   // feature records in this file
+      int         native_scale;
+      int         last_update;                  // last update file applied
+      int         size000;                      // .000 file size, to detect a changed base cell
+      int         extent_valid;
+      float       extent_elon;
+      float       extent_wlon;
+      float       extent_nlat;
+      float       extent_slat;
+      char        name[128];
+      char        date000[16];
+      char        edtn000[16];
+      char        filemod000[16];
+      char        dateupd[16];
+}SENCFileHeader;
+
+typedef struct _SENCRecordHeader{
+      int         record_type;
+      int         record_length;
+}SENCRecordHeader;
+
+typedef struct _SENCFeatureHeader{
+      char        feature_name[8];
+      int         fid;
+      int         prim;                         // S57 PRIM, 1 point, 2 line, 3 area
+      int         geom_type;                    // SENCGeomType
+      int         n_attributes;
+      int         attribute_bytes;
+      int         geometry_bytes;
+      float       ref_lat;                      // reference point of the SM geometry
+      float       ref_lon;
+}SENCFeatureHeader;
+
+typedef struct _SENCAttributeHeader{
+      char        name[8];
+      int         value_type;                   // OGR_INT, OGR_REAL or OGR_STR
+      int         value_bytes;
+}SENCAttributeHeader;
+
+//      Fixed header of a PolyTessGeo block in a binary SENC record, followed by
+//          int contour nvertex[n_contours], padded to 8 bytes
+//          raw contour geometry[n_geom_bytes], padded to 8 bytes
+//          n_triprims * (int type, int nVert, double vertex[nVert * 2], double minx, maxx, miny, maxy)
+typedef struct _SENCPolyTessHeader{
+      double      xmin, ymin, xmax, ymax;       // extents as lat/lon
+      double      ref_lat, ref_lon;
+      int         n_contours;
+      int         n_geom_bytes;
+      int         n_triprims;
+      int         reserved;
+}SENCPolyTessHeader;
 
 //    Fwd Defns
 class wxArrayOfS57attVal;
 class OGREnvelope;
 class OGRGeometry;
 class wxBoundingBox;
+typedef struct _SENCFeature SENCFeature;                // sencparser.h
+typedef struct _SENCTess SENCTess;
 
 // name of the addressed look up table set (fifth letter)
 typedef enum _LUPname{
@@ -290,17 +389,10 @@ public:
       //  Public Methods
       S57Obj();
       ~S57Obj();
-      S57Obj(char *first_line, wxInputStream *fpx, double ref_lat, double ref_lon);
+      S57Obj(SENCFeature *pfeature);                          // from a SENC feature record
 
       wxString GetAttrValueAsString ( char *attr );
 
-
-      // Private Methods
-private:
-      bool IsUsefulAttribute(char *buf);
-      int my_fgets( char *buf, int buf_len_max, wxInputStream& ifs );
-      int my_bufgetl( char *ib_read, char *ib_end, char *buf, int buf_len_max );
-
 public:
       // Instance Data
       char                    FeatureName[8];
@@ -394,6 +486,8 @@ public:
       int                     height;
       int                     depth;
       bool                    b_stagger;
+      int                     *pledge;          // optional edge arrays, for concurrent renders
+      int                     *predge;
 };
 
 //----------------------------------------------------------------------------------
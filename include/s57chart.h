@@ -106,6 +106,11 @@ WX_DECLARE_HASH_MAP( int, int, wxIntegerHash, wxIntegerEqual, VectorHelperHash )
 WX_DECLARE_HASH_MAP( int, VE_Element *, wxIntegerHash, wxIntegerEqual, VE_Hash );
 WX_DECLARE_HASH_MAP( int, VC_Element *, wxIntegerHash, wxIntegerEqual, VC_Hash );
 
+//    Area fills are rasterized in row bands concurrently,
+//    up to this many threads, and never bands smaller than this many rows
+#define MAX_AREA_FILL_THREADS       8
+#define MIN_AREA_FILL_BAND          64
+
 //----------------------------------------------------------------------------
 // s57 Chart object class
 //----------------------------------------------------------------------------
@@ -117,6 +122,10 @@ public:
 
       virtual InitReturn Init( const wxString& name, ChartInitFlag flags );
 
+      //    Create or refresh the SENC file for a .000 cell, without loading it.
+      //    Safe to call from a SENCBuildThread
+      InitReturn PrebuildSENC( const wxString& name );
+
 //    Accessors
 
       virtual ThumbData *GetThumbData(int tnx, int tny, float lat, float lon);
@@ -164,8 +173,6 @@ public:
 
       int BuildRAZFromSENCFile(const wxString& SENCPath);
 
-      int my_fgets( char *buf, int buf_len_max, wxInputStream& ifs );
-
       //    Initialize from an existing SENC file
       bool InitFromSENCMinimal( const wxString& FullPath );
 
@@ -181,6 +188,8 @@ public:
 
       void ClearRenderedTextCache();
 
+      virtual size_t GetMemoryFootprint();
+
 // Public data
 //Todo Accessors here
       //  Object arrays used by S52PLIB TOPMAR rendering logic
@@ -210,15 +219,20 @@ public:
 private:
 
       bool DoRenderViewOnDC(wxMemoryDC& dc, const ViewPort& VPoint, RenderTypeEnum option, bool force_new_view);
+      bool DoRenderTiledViewOnDC(wxMemoryDC& dc, const ViewPort& VPoint, bool force_new_view);
+      PixelCache *RenderTile(const ViewPort& VPoint, int tx, int ty);
 
-      int DCRenderRect(wxMemoryDC& dcinput, const ViewPort& vp, wxRect *rect);
-      bool DCRenderLPB(wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect);
+      //    draw_rules are the S52_DRAW_ classes drawn for line and area features.
+      //    Point features are drawn whole, with the symbols.
+      int DCRenderRect(wxMemoryDC& dcinput, const ViewPort& vp, wxRect *rect, int draw_rules);
+      bool DCRenderLPB(wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect, int draw_rules);
 
       InitReturn PostInit( ChartInitFlag flags, ColorScheme cs );
       InitReturn FindOrCreateSenc( const wxString& name );
       int BuildSENCFile(const wxString& FullPath000, const wxString& SENCFileName);
 
       void  CreateSENCRecord( OGRFeature *pFeature, FILE * fpOut, int mode, S57Reader *poReader );
+      void  CreateSENCEdgeIndexList( OGRFeature *pFeature, S57Reader *poReader, wxOutputStream &ostream );
       void  CreateSENCVectorEdgeTable(FILE * fpOut, S57Reader *poReader);
       void  CreateSENCConnNodeTable(FILE * fpOut, S57Reader *poReader);
 
@@ -249,9 +263,6 @@ private:
       wxString    *m_pcsv_locn;
 
 
-      char        *hdr_buf;
-      char        *mybuf_ptr;
-      int         hdr_len;
       wxFileName  m_SENCFileName;
       ObjRazRules *razRules[PRIO_NUM][LUPNAME_NUM];
 
@@ -295,6 +306,11 @@ private:
       wxRect      m_last_vprect;
 
       long        m_plib_state_hash;
+
+      int         m_tile_x0, m_tile_y0;         // tile grid pixel at the pDIB origin, when composed from tiles
+
+      size_t      m_object_mem_size;            // cached object/geometry footprint, see GetMemoryFootprint()
+      bool        m_bobject_mem_valid;
 };
 
 //----------------------------------------------------------------------------
@@ -310,6 +326,107 @@ public:
 };
 
 
+//----------------------------------------------------------------------------
+//    S57TileCache Definition
+//    A process wide LRU cache of rendered s57chart tiles.
+//    Tiles are square, and aligned to a pixel grid anchored at the chart
+//    reference point, so the same tile is valid wherever it falls in a viewport.
+//    A tile holds only the area fills and the lines of line and area features.
+//    Symbols and text are drawn over the composed view, so they are never cut
+//    or drawn twice at a tile edge, and are decluttered over the whole view.
+//----------------------------------------------------------------------------
+
+#define S57_TILE_SIZE                   256
+#define S57_TILE_GUTTER                 32          // extra margin rendered around each tile, so line
+                                                    // widths and complex line patterns at an edge are drawn
+
+class S57TileKey
+{
+public:
+      s57chart    *pChart;
+      double      scale_ppm;
+      long        plib_state_hash;
+      unsigned long palette_hash;
+      int         tx;
+      int         ty;
+};
+
+class S57TileKeyHash
+{
+public:
+      S57TileKeyHash() {}
+      unsigned long operator()( const S57TileKey& k ) const
+      {
+            unsigned long h = (unsigned long)(wxUIntPtr)k.pChart;
+            h = (h * 31) + (unsigned long)k.tx;
+            h = (h * 31) + (unsigned long)k.ty;
+            h = (h * 31) + (unsigned long)(k.scale_ppm * 1000.);
+            h = (h * 31) + (unsigned long)k.plib_state_hash;
+            h = (h * 31) + k.palette_hash;
+            return h;
+      }
+      S57TileKeyHash& operator=(const S57TileKeyHash&) { return *this; }
+};
+
+class S57TileKeyEqual
+{
+public:
+      S57TileKeyEqual() {}
+      bool operator()( const S57TileKey& a, const S57TileKey& b ) const
+      {
+            return (a.pChart == b.pChart) && (a.tx == b.tx) && (a.ty == b.ty) &&
+                   (a.scale_ppm == b.scale_ppm) && (a.plib_state_hash == b.plib_state_hash) &&
+                   (a.palette_hash == b.palette_hash);
+      }
+      S57TileKeyEqual& operator=(const S57TileKeyEqual&) { return *this; }
+};
+
+class S57TileEntry
+{
+public:
+      S57TileKey        key;
+      PixelCache        *pTile;
+      size_t            MemBytes;
+      S57TileEntry      *pLRUPrev;              // next more recently used entry
+      S57TileEntry      *pLRUNext;              // next less recently used entry
+};
+
+WX_DECLARE_HASH_MAP( S57TileKey, S57TileEntry *, S57TileKeyHash, S57TileKeyEqual, S57TileHash );
+
+class S57TileCache
+{
+public:
+      S57TileCache(size_t budget_bytes);
+      ~S57TileCache();
+
+      //    Returns the cached tile, or NULL.  A hit makes the tile most recently used.
+      PixelCache *Find(const S57TileKey &key);
+
+      //    The cache takes ownership of the tile, and trims itself to budget
+      void Add(const S57TileKey &key, PixelCache *pTile);
+
+      //    Drop all tiles belonging to a chart
+      void PurgeChart(s57chart *pChart);
+      void Clear();
+
+      size_t GetMemBytes(){ return m_MemBytes; }
+      unsigned long GetHits(){ return m_nHits; }
+      unsigned long GetMisses(){ return m_nMisses; }
+
+private:
+      void Unlink(S57TileEntry *pte);
+      void Remove(S57TileEntry *pte);
+
+      S57TileHash       m_TileHash;
+      S57TileEntry      *m_pMRU;                // head of the LRU list
+      S57TileEntry      *m_pLRU;                // tail of the LRU list, first eviction candidate
+      size_t            m_MemBytes;
+      size_t            m_BudgetBytes;
+      unsigned long     m_nHits;
+      unsigned long     m_nMisses;
+};
+
+
 //------------------------------------------------------------------------
 //  s57RegistrarMgr Definition
 //  This is a class holding the ctor and dtor for the global registrar
@@ -322,4 +439,89 @@ class s57RegistrarMgr
             ~s57RegistrarMgr();
 };
 
+
+//------------------------------------------------------------------------
+//  SENCBuildPool Definition
+//  Builds the SENC files for a set of ENC cells on a pool of worker threads
+//------------------------------------------------------------------------
+
+#define MAX_SENC_BUILD_THREADS      8
+
+class SENCBuildJob
+{
+      public:
+            wxString    m_FullPath000;
+            s57chart    *m_pchart;              // created and deleted on the pool owner's thread
+            int         m_result;
+};
+
+WX_DEFINE_ARRAY_PTR(SENCBuildJob *, ArrayOfSENCBuildJobs);
+
+class SENCBuildPool
+{
+      public:
+            SENCBuildPool(int max_threads = -1);
+            ~SENCBuildPool();
+
+            void AddCell(const wxString& FullPath000, int native_scale, Extent &ext);
+            int GetCellCount(){ return m_jobs.GetCount(); }
+
+            //    Build all cells, blocking until done or cancelled.
+            //    Returns the number of SENC files built successfully
+            int Run(wxProgressDialog *pprog);
+
+            bool IsCancelled(){ return m_bcancel; }
+
+            //    Worker interface
+            SENCBuildJob *GetNextJob();
+            void JobDone(SENCBuildJob *pjob);
+            void BuildCell(SENCBuildJob *pjob);
+
+      private:
+            int GetThreadCount();
+
+            ArrayOfSENCBuildJobs    m_jobs;
+            wxMutex                 m_mutex;
+            unsigned int            m_next_job;
+            int                     m_ndone;
+            int                     m_max_threads;
+            volatile bool           m_bcancel;
+};
+
+//    wxLog targets are not thread safe, so while the pool runs, messages
+//    logged on the worker threads are queued here and passed on to the
+//    previous target from the main thread
+class SENCBuildLog : public wxLog
+{
+      public:
+            SENCBuildLog();
+            ~SENCBuildLog();
+
+            void FlushThreadMessages();
+
+      protected:
+            virtual void DoLog(wxLogLevel level, const wxChar *szString, time_t t);
+
+      private:
+            wxLog             *m_pOldLog;
+            wxMutex           m_mutex;
+            wxArrayString     m_messages;
+            wxArrayInt        m_levels;
+            wxArrayLong       m_times;
+};
+
+class SENCBuildThread : public wxThread
+{
+      public:
+            SENCBuildThread(SENCBuildPool *pool);
+
+            SENCBuildPool *GetPool(){ return m_pool; }
+
+      protected:
+            virtual void *Entry();
+
+      private:
+            SENCBuildPool     *m_pool;
+};
+
 #endif
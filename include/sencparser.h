@@ -0,0 +1,113 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenCPN
+ * Purpose:  Binary SENC record reader and parser
+ * Author:   OpenCPN developers
+ *
+ ***************************************************************************
+ *   Copyright (C) by the OpenCPN developers                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ *
+ *
+ *
+ *
+ */
+
+
+#ifndef __SENCPARSER_H__
+#define __SENCPARSER_H__
+
+#include <stdio.h>
+
+#include "s52s57.h"                       // the SENC layout
+
+// ============================================================================
+// Binary SENC records
+//
+//    Every check on a record is made here, once.  The code that builds
+//    chart objects from a checked record then walks it with no checks of
+//    its own.  Values are read with memcpy, so nothing here depends on
+//    the alignment of the buffer.
+// ============================================================================
+
+//    Append one record, header plus padded payload, to a SENC file
+void SENCWriteRecord(FILE *fpOut, int record_type, const void *payload, int length);
+
+//    A whole SENC file held in memory, walked one record at a time
+typedef struct _SENCReader{
+      unsigned char     *pbuf_end;
+      unsigned char     *prec;                  // next record header
+}SENCReader;
+
+typedef enum _SENCReadStatus{
+    SENC_READ_RECORD      = 0,
+    SENC_READ_END,                              // the END record
+    SENC_READ_ERROR                             // truncated record, or no END record
+}SENCReadStatus;
+
+//    Check the file header and set up to read the records after it.
+//    Returns false unless this is a current version binary SENC.
+bool SENCReaderOpen(SENCReader *pr, unsigned char *pbuf, size_t size, SENCFileHeader *phdr);
+
+//    The next record, with its payload left in place.  Returns a SENCReadStatus.
+int SENCReaderNext(SENCReader *pr, SENCRecordHeader *prh, unsigned char **ppayload);
+
+//    A checked PolyTessGeo block
+typedef struct _SENCTess{
+      SENCPolyTessHeader hdr;
+      unsigned char     *pcontours;             // int nvertex[n_contours]
+      unsigned char     *pgeom;                 // n_geom_bytes of raw contour geometry
+      unsigned char     *ptriprims;             // n_triprims, for SENCNextTriPrim()
+}SENCTess;
+
+bool SENCParseTess(unsigned char *polybuf, int nrecl, SENCTess *pt);
+
+//    The triangle primitive at *pp, of a checked block.  Returns its vertices,
+//    and leaves *pp at the next one.  pbbox gets minx, maxx, miny, maxy.
+unsigned char *SENCNextTriPrim(unsigned char **pp, int *ptype, int *pnvert, double *pbbox);
+
+//    A checked feature record.  npt is 0, and the pointers NULL, for any
+//    part the geometry type does not have.
+typedef struct _SENCFeature{
+      SENCFeatureHeader hdr;
+      unsigned char     *pattributes;           // hdr.n_attributes, for SENCNextAttribute()
+      int               npt;
+      unsigned char     *ppoints;               // float e/n[npt * 2], or e/n/depth[npt * 3] for a multipoint
+      unsigned char     *pbbox;                 // float lonmax, lonmin, latmax, latmin
+      bool              btess;                  // false if the area failed to tesselate when the SENC was made
+      SENCTess          tess;
+      int               n_lsindex;
+      unsigned char     *plsindex;              // int lsindex[n_lsindex * 3]
+}SENCFeature;
+
+bool SENCParseFeature(unsigned char *pRecord, int nRecordLength, SENCFeature *pf);
+
+//    The attribute at *pp, of a checked feature.  Returns its value, and
+//    leaves *pp at the next one.
+unsigned char *SENCNextAttribute(unsigned char **pp, SENCAttributeHeader *pah);
+
+//    Edge table and connected node table.  The check returns the element
+//    count and the first element, for SENCNextEdge() or SENCNextNode().
+bool SENCCheckEdgeTable(unsigned char *payload, int length, int *pn, unsigned char **ppfirst);
+unsigned char *SENCNextEdge(unsigned char **pp, int *pindex, int *pnpt);      // returns double e/n[npt * 2]
+
+bool SENCCheckNodeTable(unsigned char *payload, int length, int *pn, unsigned char **ppfirst);
+unsigned char *SENCNextNode(unsigned char **pp, int *pindex);                // returns double e, n
+
+#endif
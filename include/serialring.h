@@ -0,0 +1,95 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenCPN
+ * Purpose:  Serial input ring, from port threads to the GUI thread
+ * Author:   David Register
+ *
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register   *
+ *   $EMAIL$   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ *
+ *
+ *
+ *
+ */
+
+
+#ifndef __SERIALRING_H__
+#define __SERIALRING_H__
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+  #include "wx/wx.h"
+#endif //precompiled headers
+
+#include <wx/thread.h>
+
+
+//----------------------------------------------------------------------------
+// OCP_SerialRing
+//
+//    Byte ring carrying serial input from a port thread to the GUI thread.
+//    There is exactly one producer and one consumer; the producer only advances
+//    the head, the consumer only advances the tail, so no lock is taken.
+//    The producer asks for a notification only when the consumer has none pending,
+//    so one event delivers however many sentences have arrived.
+//    Only whole sentences are published. When the consumer falls behind and a
+//    sentence does not fit, all of it is dropped and counted.
+//----------------------------------------------------------------------------
+
+#define SERIAL_RING_SIZE          65536       // Must be a power of two
+#define SERIAL_READ_CHUNK         4096        // Bytes requested per read()
+#define SERIAL_SENTENCE_MAX       1024        // Longer sentences are discarded
+
+class OCP_SerialRing
+{
+public:
+      OCP_SerialRing(void);
+
+      void Ref(void);
+      void Unref(void);
+
+      //    Producer side, returns true if the consumer should be notified
+      bool Put(const char *buf, int len);
+      int GetFreeSpace(void);                   // bytes not holding published sentences
+
+      //    Consumer side
+      void BeginDrain(void);
+      int GetSentence(char *dest, int max_len);
+      int GetNewDropCount(void);                // sentences dropped since the last call
+
+private:
+      ~OCP_SerialRing(void);
+
+      char                    *m_buf;
+      volatile unsigned int   m_head;           // free running, written only by the producer
+      unsigned int            m_put_head;       // producer only, past m_head by any partial sentence
+      bool                    m_bdropping;      // producer only, skipping to the end of a dropped sentence
+      volatile int            m_ndropped;       // written only by the producer
+      int                     m_ndropped_seen;  // consumer only
+      volatile unsigned int   m_tail;           // free running, written only by the consumer
+      volatile int            m_bnotify_pending;
+
+      int                     m_nref;
+      wxCriticalSection       m_ref_lock;
+};
+
+#endif
@@ -34,6 +34,7 @@
 #ifndef __TCMGR_H__
 #define __TCMGR_H__
 
+#include <wx/thread.h>
 
 // ----------------------------------------------------------------------------
 // external C linkages
@@ -82,6 +83,21 @@ typedef struct {
 #define TIDE_TIME_STEP (TIDE_TIME_PREC)
 #define TIDE_BAD_TIME   ((time_t) -1)
 
+/* TIDE_EXTREMUM_STEP
+ *   Step used to bracket a high or low tide before refining it
+ * on the harmonic derivative.
+ */
+#define TIDE_EXTREMUM_STEP (1800)
+#define TIDE_EXTREMUM_MAX_STEPS (48)
+
+/* Cached per-station tide tables: levels every 15 minutes, and
+ * all the extremes, over a UTC day plus a margin either side.
+ */
+#define TIDE_TABLE_STEP (15 * 60)
+#define TIDE_TABLE_MARGIN (14 * 3600)
+#define TIDE_TABLE_SAMPLES ((86400 + 2 * TIDE_TABLE_MARGIN) / TIDE_TABLE_STEP + 1)
+#define TIDE_TABLE_MAX_EXTREMES (32)
+
 
 //    class/struct declarations
 
@@ -93,6 +109,16 @@ typedef struct {
    char *long_s;
 } abbreviation_entry;
 
+typedef struct {
+   time_t   t_day;                                    // UTC midnight of the day covered
+   time_t   t0;                                       // Time of the first level sample
+   float    level[TIDE_TABLE_SAMPLES];
+   int      n_extremes;
+   time_t   extreme_time[TIDE_TABLE_MAX_EXTREMES];
+   float    extreme_level[TIDE_TABLE_MAX_EXTREMES];
+   bool     extreme_high[TIDE_TABLE_MAX_EXTREMES];
+} tide_day_table;
+
 #define REGION 1
 #define COUNTRY 2
 #define STATE 3
@@ -156,12 +182,15 @@ public:
       float     Value15;
       float     Dir15;
       bool      Ret15;
+      bool      New15;                         // Value15 not yet handed out by GetTideOrCurrent15()
       bool      b_is_secondary;
       char     *IDX_tzname;                    // Timezone name
       int       IDX_ref_file_num;              // # of reference file where reference station is
       char      IDX_reference_name[MAXNAMELEN];// Name of reference station
       int       IDX_ref_dbIndex;               // tcd index of reference station
       Station_Data   *pref_sta_data;           // Pointer to the Reference Station Data
+      tide_day_table *pday_table;              // Cached tide table, NULL until first used
+      struct tide_station_state *pstate;       // Prediction states, one per year, NULL until first used
 };
 
 typedef struct {
@@ -198,6 +227,54 @@ typedef struct{
 } mru_entry;
 
 
+//----------------------------------------------------------------------------
+//   Harmonic Prediction State
+//----------------------------------------------------------------------------
+
+/* Harmonic coefficients of one reference station for one year, laid out
+ * so that the sum over the constituents runs down contiguous arrays.
+ */
+typedef struct {
+      int         year;
+      time_t      epoch;                  // UTC new year of year
+      double      *work;                  // Normalized multipliers, NULL if year is not in the tables
+      double      *phase;                 // Constituent phases at epoch
+} tide_year_coeffs;
+
+#define TIDE_STATE_YEARS (3)              // Last, this and next year, for new year blending
+#define TIDE_STATE_CACHE (4)              // States kept per station, one per year predicted
+
+/* Normalized high and low found around T by time2asecondary() */
+typedef struct {
+      time_t      lowtime;
+      time_t      hightime;
+      double      lowlvl;
+      double      highlvl;
+} tide_secondary_cache;
+
+/* Everything needed to predict the tide at one station, around one year.
+ * Built by TCMgr::GetStationState() and not changed afterwards, except for
+ * secondary, which belongs to the GUI thread API.  Any number of threads may
+ * evaluate one state at once.  The station list and the use count are
+ * guarded by TCMgr::m_state_lock.
+ */
+struct tide_station_state {
+      struct tide_station_state *pnext;   // Next year's state of this station, most recently used first
+      int               n_users;          // Holders, see TCMgr::ReleaseStationState()
+      bool              b_retired;        // No longer listed, freed when the last holder is done
+      IDX_entry         *pIDX;
+      Station_Data      *pmsd;
+      int               have_offsets;
+      double            amplitude;
+      int               num_csts;
+      double            *cst_speeds;      // TCMgr's, shared
+      tide_year_coeffs  coeffs[TIDE_STATE_YEARS];
+      tide_secondary_cache secondary;
+};
+
+#define TIDE_SERIES_RESEED (64)           // Series steps between exact constituent phases
+
+
 //----------------------------------------------------------------------------
 //   TCMgr
 //----------------------------------------------------------------------------
@@ -212,6 +289,14 @@ public:
       bool GetTideOrCurrent15(time_t t, int idx, float &tcvalue, float& dir, bool &bnew_val);
       bool GetTideFlowSens(time_t t, int sch_step, int idx, float &tcvalue_now, float &tcvalue_prev, bool &w_t);
       void GetHightOrLowTide(time_t t, int sch_step_1, int sch_step_2, float tide_val ,bool w_t , int idx, float &tcvalue, time_t &tctime);
+//    Brings the quarter hour values of the stations up to date in one batch, for GetTideOrCurrent15()
+      void UpdateTideOrCurrent15(const wxArrayInt &stations);
+//    The batch calls only touch per station state, and may be made from any thread.
+//    n (station, time) pairs; unuseable stations give 0.  Returns the number evaluated.
+      int GetTideOrCurrentBatch(int n, const int *idx, const time_t *t, float *tcvalue, float *dir, bool *ok = NULL);
+//    n values for one station at t0, t0 + step, ...
+      bool GetTideOrCurrentSeries(time_t t0, int step, int n, int idx, float *tcvalue);
+      bool GetTideNearExtremes(time_t t, int idx, float &nowlev, float &ltlevel, time_t &lttime, float &htlevel, time_t &httime);
       int GetStationTimeOffset(IDX_entry *pIDX);
       int GetStationIDXbyName(wxString prefix, double xlat, double xlong, TCMgr *ptcmgr);
       int GetNextBigEvent(time_t *tm, int idx);
@@ -230,6 +315,19 @@ private:
       void FreeMRU(void);
 
 
+      int GetTideOrCurrent15Time(IDX_entry *pIDX);
+      tide_station_state *GetStationState(IDX_entry *pIDX, time_t t);
+      void ReleaseStationState(tide_station_state *ps);
+      tide_station_state *BuildStationState(IDX_entry *pIDX, Station_Data *psd, int this_year);
+      void RetireStationState(tide_station_state *ps);
+      void RetireStationStates(IDX_entry *pIDX);
+      void FreeStationState(tide_station_state *ps);
+      double time2aslope(time_t t, tide_station_state *ps);
+      bool RefineTideExtremum(time_t ta, time_t tb, tide_station_state *ps, time_t &t_ext);
+      bool FindTideExtremum(time_t t, int dir, bool b_high, tide_station_state *ps, time_t &t_ext, double &level);
+      tide_day_table *GetTideDayTable(time_t t, tide_station_state *ps);
+      double TideTableLevel(tide_day_table *ptable, time_t t);
+
       int build_IDX_entry(IDX_entry *pIDX );
       int init_index_file(int load_index, int hwnd);
       IDX_entry *get_index_data( short int rec_num );
@@ -255,22 +353,21 @@ private:
       void allocate_cst ();
       void fudge_constituents (Station_Data *psd, IDX_entry *pIDX);
       int findunit (const char *unit);
-      void figure_amplitude ();
-      void figure_multipliers ();
-      void happy_new_year (int new_year);
-      void set_epoch (int year, int num_epochs, int first_year);
       int compare_tm (struct tm *a, struct tm *b);
 
 //    TideLib
-      double _time2dt_tide (time_t t, int deriv);
-      double blend_tide (time_t t, int deriv, int first_year, double blend);
-      double time2dt_tide (time_t t, int deriv);
-      int next_big_event (time_t *tm, IDX_entry *pIDX);
-      double time2atide (time_t t, IDX_entry *pIDX);
-      double BOGUS_amplitude(double mpy, IDX_entry *pIDX);
-      double time2tide (time_t t);
-      double time2mean (time_t t);
-      double time2asecondary (time_t t, IDX_entry *pIDX);
+//    Reentrant: all station and year dependent data comes from the state
+      double _time2dt_tide (time_t t, int deriv, tide_year_coeffs *pc, tide_station_state *ps);
+      double blend_tide (time_t t, int deriv, tide_year_coeffs *pc_first, tide_station_state *ps, double blend);
+      double time2dt_tide (time_t t, int deriv, tide_station_state *ps);
+      int next_big_event (time_t *tm, tide_station_state *ps);
+      double time2atide (time_t t, tide_station_state *ps);
+      double BOGUS_amplitude(double mpy, tide_station_state *ps);
+      double time2tide (time_t t, tide_station_state *ps);
+      double time2mean (time_t t, tide_station_state *ps);
+      double time2asecondary (time_t t, tide_station_state *ps, tide_secondary_cache *pcache);
+      void time2asecondary_series (time_t t0, int step, int n, tide_station_state *ps,
+                                   tide_secondary_cache *pcache, float *pval);
 
 //    TimeLib
       int yearoftimet (time_t t);
@@ -286,9 +383,8 @@ private:
       mru_entry   *pmru_next;
 
 
-      double                        amplitude;
-      int                           year;
-      time_t                        epoch;
+      wxCriticalSection             m_state_lock;           // Guards station state lookup, and harmonic loading
+      wxArrayPtrVoid                m_retired_states;       // Replaced states, still in use
 
 
       abbreviation_entry      **abbreviation_list;
@@ -309,17 +405,12 @@ private:
 
       int         num_csts;
       double      *cst_speeds;
-      double      *work;
       int         num_nodes;
       double      **cst_nodes;
       double      **cst_epochs;
       int         num_epochs;
       int         first_year;
 
-      Station_Data      *pmsd;
-
-
-      int   have_offsets;
 
       char  tzfile[80];
 
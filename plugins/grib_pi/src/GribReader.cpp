@@ -31,12 +31,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 GribReader::GribReader()
 {
     ok = false;
+    file = NULL;
+    dataCacheBytes = 0;
+    dataCacheBudget = GRIB_DATA_CACHE_BUDGET;
 	dewpointDataStatus = NO_DATA_IN_FILE;
 }
 //-------------------------------------------------------------------------------
 GribReader::GribReader(const wxString fname)
 {
     ok = false;
+    file = NULL;
+    dataCacheBytes = 0;
+    dataCacheBudget = GRIB_DATA_CACHE_BUDGET;
 	dewpointDataStatus = NO_DATA_IN_FILE;
     if (fname != _T("")) {
         openFile(fname);
@@ -54,6 +60,64 @@ GribReader::~GribReader()
     free(file);
 
 }
+//-------------------------------------------------------------------------------
+// Decoded grid cache
+//
+// Records are indexed when the file is opened and decode their grid the first
+// time a value is asked for.  Grids stay in memory in LRU order until the byte
+// budget is exceeded.  Records created in memory (copies, computed dewpoint)
+// own their grid and are never part of the cache.
+//-------------------------------------------------------------------------------
+void GribReader::setDataCacheBudget(size_t nbytes)
+{
+    dataCacheBudget = nbytes;
+    trimDataCache(NULL);
+}
+//-------------------------------------------------------------------------------
+bool GribReader::loadRecordData(GribRecord *rec)
+{
+    if (rec->isDataLoaded())
+        return true;
+    if (! rec->readGribData(file))
+        return false;
+
+    dataCache.push_front(rec);
+    rec->dataCachePos = dataCache.begin();
+    rec->inDataCache = true;
+    dataCacheBytes += rec->getDataSize();
+
+    trimDataCache(rec);
+    return true;
+}
+//-------------------------------------------------------------------------------
+void GribReader::touchRecordData(GribRecord *rec)
+{
+    if (rec->inDataCache && rec->dataCachePos != dataCache.begin())
+        dataCache.splice(dataCache.begin(), dataCache, rec->dataCachePos);
+}
+//-------------------------------------------------------------------------------
+void GribReader::forgetRecordData(GribRecord *rec)
+{
+    if (! rec->inDataCache)
+        return;
+    dataCache.erase(rec->dataCachePos);
+    rec->inDataCache = false;
+    dataCacheBytes -= rec->getDataSize();
+}
+//-------------------------------------------------------------------------------
+void GribReader::trimDataCache(GribRecord *keep)
+{
+    // The record just loaded always survives, even alone over budget
+    while (dataCacheBytes > dataCacheBudget && !dataCache.empty())
+    {
+        GribRecord *victim = dataCache.back();
+        if (victim == keep)
+            break;
+        forgetRecordData(victim);
+        victim->freeGribData();
+    }
+}
+
 //-------------------------------------------------------------------------------
 void GribReader::clean_all_vectors()
 {
@@ -103,8 +167,9 @@ void GribReader::readAllGribRecords()
 
     do {
         id ++;
-        rec = new GribRecord(file, id);
+        rec = new GribRecord(file, id);       // index only, the grid is decoded on demand
         assert(rec);
+        rec->reader = this;
         if (rec->isOk())
         {
               b_EOF = rec->isEof();
@@ -424,6 +489,16 @@ double  GribReader::getTimeInterpolatedValue(int dataType,int levelType,int leve
 	return get2GribsInterpolatedValueByDate(px, py, date, before, after);
 }
 
+//---------------------------------------------------------------------------
+GribRecord * GribReader::getTimeInterpolatedGribRecord(int dataType,int levelType,int levelValue, time_t date)
+{
+	GribRecord *before, *after;
+	findGribsAroundDate (dataType,levelType,levelValue, date, &before, &after);
+	if (before==NULL || after==NULL)
+		return NULL;
+	return new GribRecord(*before, *after, date);
+}
+
 //------------------------------------------------------------------
 void GribReader::findGribsAroundDate (int dataType,int levelType,int levelValue, time_t date,
 							GribRecord **before, GribRecord **after)
@@ -432,8 +507,10 @@ void GribReader::findGribsAroundDate (int dataType,int levelType,int levelValue,
 	std::vector<GribRecord *> *ls = getListOfGribRecords(dataType,levelType,levelValue);
 	*before = NULL;
 	*after  = NULL;
+	if (ls == NULL)
+		return;
 	zuint nb = ls->size();
-	for (zuint i=0; i<nb && *before==NULL && *after==NULL; i++)
+	for (zuint i=0; i<nb && *after==NULL; i++)
 	{
 		GribRecord *rec = (*ls)[i];
 		if (rec->getRecordCurrentDate() == date) {
@@ -560,6 +637,8 @@ GribRecord * GribReader::getGribRecord(int dataType,int levelType,int levelValue
             if ((*ls)[i]->getRecordCurrentDate() == date)
                 res = (*ls)[i];
         }
+        if (res != NULL)
+            res->touchData();
         return res;
     }
     else {
@@ -630,8 +709,16 @@ void GribReader::openFile(const wxString fname)
     fileName = fname;
     ok = false;
     clean_all_vectors();
+    if (file != NULL) {
+        zu_close(file);
+        free(file);
+        file = NULL;
+    }
     //--------------------------------------------------------
     // Open the file
+    // The compression is recognised from the file signature,
+    // so a single indexing pass is enough.
+    // The file stays open: grids are read from it on demand.
     //--------------------------------------------------------
     file = zu_open((const char *)fname.mb_str(), "rb", ZU_COMPRESS_AUTO);
     if (file == NULL) {
@@ -639,28 +726,5 @@ void GribReader::openFile(const wxString fname)
         return;
     }
     readGribFileContent();
-
-    // Look for compressed files with alternate extensions
- 	if (! ok) {
-    	if (file != NULL)
-			zu_close(file);
-    	file = zu_open((const char *)fname.mb_str(), "rb", ZU_COMPRESS_BZIP);
-    	if (file != NULL)
-    		readGribFileContent();
-    }
- 	if (! ok) {
-    	if (file != NULL)
-			zu_close(file);
-      file = zu_open((const char *)fname.mb_str(), "rb", ZU_COMPRESS_GZIP);
-    	if (file != NULL)
-    		readGribFileContent();
-    }
- 	if (! ok) {
-    	if (file != NULL)
-			zu_close(file);
-      file = zu_open((const char *)fname.mb_str(), "rb", ZU_COMPRESS_NONE);
-    	if (file != NULL)
-    		readGribFileContent();
-    }
 }
 
@@ -36,10 +36,14 @@ Reader for a GRIB file
 #include <vector>
 #include <set>
 #include <map>
+#include <list>
 
 #include "GribRecord.h"
 #include "zuFile.h"
 
+//      Default memory budget for decoded grids, shared by all the records of a file
+#define GRIB_DATA_CACHE_BUDGET      (128*1024*1024)
+
 //===============================================================
 class GribReader
 {
@@ -91,6 +95,13 @@ class GribReader
 
       std::map < std::string, std::vector<GribRecord *>* > * getGribMap(){ return  &mapGribRecords; }              //dsr
 
+      // Decoded grid cache, in LRU order
+      void   setDataCacheBudget(size_t nbytes);
+      size_t getDataCacheBytes()         {return dataCacheBytes;}
+      bool   loadRecordData(GribRecord *rec);
+      void   touchRecordData(GribRecord *rec);
+      void   forgetRecordData(GribRecord *rec);
+
     private:
         bool      ok;
         wxString  fileName;
@@ -101,6 +112,11 @@ class GribReader
 
         std::map < std::string, std::vector<GribRecord *>* >  mapGribRecords;
 
+        std::list<GribRecord *>  dataCache;     // most recently used first
+        size_t    dataCacheBytes;
+        size_t    dataCacheBudget;
+        void      trimDataCache(GribRecord *keep);
+
         void storeRecordInMap(GribRecord *rec);
 
         void   readGribFileContent();
@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //#include <QDateTime>
 
 #include "GribRecord.h"
+#include "GribReader.h"
 
 //-------------------------------------------------------------------------------
 // Adjust data type from different mete center
@@ -122,6 +123,10 @@ GribRecord::GribRecord(ZUFILE* file, int id_)
 //   seekStart = zu_tell(file);           // moved to section 0 read
     data    = NULL;
     BMSbits = NULL;
+    packedData = NULL;
+    dataFactor = 1.0;
+    reader  = NULL;
+    inDataCache = false;
     eof     = false;
     knownData = true;
 
@@ -193,7 +198,50 @@ GribRecord::GribRecord(ZUFILE* file, int id_)
 //-------------------------------------------------------------------------------
 GribRecord::GribRecord(const GribRecord &rec)
 {
+    copyGrid(rec);
+}
+//-------------------------------------------------------------------------------
+// Record interpolated in time, on the grid of rec1.
+// Both records must already hold their grid when called from a worker thread.
+//-------------------------------------------------------------------------------
+GribRecord::GribRecord(const GribRecord &rec1, const GribRecord &rec2, time_t date)
+{
+    copyGrid(rec1);
+    curDate = date;
+    if (!ok || data == NULL || !rec2.loadData()) {
+        return;
+    }
+    time_t t1 = rec1.curDate;
+    time_t t2 = rec2.curDate;
+    if (t1 == t2) {
+        return;
+    }
+    double k  = fabs( (double)(date-t1)/(t2-t1) );
+    bool sameGrid = rec2.Ni==Ni && rec2.Nj==Nj && rec2.Lo1==Lo1 && rec2.La1==La1
+                        && rec2.Di==Di && rec2.Dj==Dj;
+    for (zuint j=0; j<Nj; j++) {
+        for (zuint i=0; i<Ni; i++) {
+            double v1 = data[j*Ni+i];
+            double v2 = sameGrid ? rec2.data[j*Ni+i]
+                                 : rec2.getInterpolatedValue(getX(i), getY(j));
+            if (v1!=GRIB_NOTDEF && v2!=GRIB_NOTDEF)
+                data[j*Ni+i] = (1.0-k)*v1 + k*v2;
+            else
+                data[j*Ni+i] = GRIB_NOTDEF;
+        }
+    }
+}
+//-------------------------------------------------------------------------------
+void GribRecord::copyGrid(const GribRecord &rec)
+{
+    rec.loadData();
     *this = rec;
+    // The copy owns its grid and never goes back to the file
+    this->data = NULL;
+    this->BMSbits = NULL;
+    this->packedData = NULL;
+    this->reader = NULL;
+    this->inDataCache = false;
     // recopie les champs de bits
     if (rec.data != NULL) {
         int size = rec.Ni*rec.Nj;
@@ -230,6 +278,13 @@ std::string GribRecord::makeKey(int dataType,int levelType,int levelValue)
 //-----------------------------------------
 GribRecord::~GribRecord()
 {
+    if (inDataCache && reader) {
+        reader->forgetRecordData(this);
+    }
+    if (packedData) {
+        delete [] packedData;
+        packedData = NULL;
+    }
     if (data) {
         delete [] data;
         data = NULL;
@@ -242,8 +297,91 @@ GribRecord::~GribRecord()
 //if (dataType==GRB_TEMP) printf("record destroyed %s   %d\n", dataKey.mb_str(), (int)curDate/3600);
 }
 
+//-------------------------------------------------------------------------------
+// Lazy access to the grid
+//-------------------------------------------------------------------------------
+bool GribRecord::loadData() const
+{
+    if (data != NULL) {
+        return true;
+    }
+    if (!ok || reader == NULL) {
+        return false;
+    }
+    return reader->loadRecordData(const_cast<GribRecord *>(this));
+}
+//-------------------------------------------------------------------------------
+void GribRecord::touchData() const
+{
+    if (inDataCache && reader) {
+        reader->touchRecordData(const_cast<GribRecord *>(this));
+    }
+}
+//-------------------------------------------------------------------------------
+bool GribRecord::pinData()
+{
+    if (reader == NULL) {
+        return data != NULL;
+    }
+    if (!loadData()) {
+        return false;
+    }
+    if (inDataCache) {
+        reader->forgetRecordData(this);
+    }
+    reader = NULL;
+    if (packedData) {
+        delete [] packedData;
+        packedData = NULL;
+    }
+    return true;
+}
+//-------------------------------------------------------------------------------
+// Read the BDS payload, from memory if it was kept at index time, and decode it
+bool GribRecord::readGribData(ZUFILE* file)
+{
+    if (!ok) {
+        return false;
+    }
+    if (packedData) {
+        return decodeGribData(packedData);
+    }
+    if (file == NULL) {
+        return false;
+    }
+    int datasize = sectionSize4-11;
+    zuchar *buf = new zuchar[datasize+4];
+    if (zu_seek(file, fileOffset4+11, SEEK_SET) != 0
+            || zu_read(file, buf, datasize) != datasize) {
+        erreur("Record %d: data read error",id);
+        ok = false;
+    }
+    else {
+        decodeGribData(buf);
+    }
+    delete [] buf;
+    return ok;
+}
+//-------------------------------------------------------------------------------
+void GribRecord::freeGribData()
+{
+    if (data) {
+        delete [] data;
+        data = NULL;
+    }
+}
+
 //-------------------------------------------------------------------------------
 void  GribRecord::multiplyAllData(double k)
+{
+    // Remembered so that a grid decoded again later gets the same conversion
+    dataFactor *= k;
+    if (data != NULL) {
+        scaleData(k);
+    }
+}
+//-------------------------------------------------------------------------------
+void  GribRecord::scaleData(double k)
 {
 	for (zuint j=0; j<Nj; j++) {
 		for (zuint i=0; i<Ni; i++)
@@ -508,28 +646,32 @@ bool GribRecord::readGribSection4_BDS(ZUFILE* file) {
         return ok;
     }
 
+    // Only the index is built here: a plain file is read again when the grid
+    // is needed, a compressed stream keeps its packed payload in memory.
+    if (file->type != ZU_COMPRESS_NONE) {
+        int  datasize = sectionSize4-11;
+        packedData = new zuchar[datasize+4];  // +4 pour simplifier les décalages ds readPackedBits
+        if (zu_read(file, packedData, datasize) != datasize) {
+            erreur("Record %d: data read error",id);
+            ok = false;
+            eof = true;
+        }
+    }
+    return ok;
+}
+//----------------------------------------------
+// Decode the packed BDS payload (with 4 bytes of padding) into the grid
+//----------------------------------------------
+bool GribRecord::decodeGribData(zuchar *buf) {
     // Allocate memory for the data
     data = new double[Ni*Nj];
     if (!data) {
         erreur("Record %d: out of memory",id);
         ok = false;
+        return ok;
     }
 
     zuint  startbit  = 0;
-    int  datasize = sectionSize4-11;
-    zuchar *buf = new zuchar[datasize+4];  // +4 pour simplifier les décalages ds readPackedBits
-    if (!buf) {
-        erreur("Record %d: out of memory",id);
-        ok = false;
-    }
-    if (zu_read(file, buf, datasize) != datasize) {
-        erreur("Record %d: data read error",id);
-        ok = false;
-        eof = true;
-    }
-    if (!ok) {
-        return ok;
-    }
 
     // Read data in the order given by isAdjacentI
     zuint i, j, x;
@@ -575,9 +717,8 @@ bool GribRecord::readGribSection4_BDS(ZUFILE* file) {
         }
     }
 
-    if (buf) {
-        delete [] buf;
-        buf = NULL;
+    if (dataFactor != 1.0) {
+        scaleData(dataFactor);
     }
     return ok;
 }
@@ -804,9 +945,10 @@ zuint GribRecord::periodSeconds(zuchar unit,zuchar P1,zuchar P2,zuchar range) {
 double GribRecord::getInterpolatedValue(double px, double py, bool numericalInterpolation) const
 {
     double val;
-    if (!ok || Di==0 || Dj==0) {
+    if (!ok || Di==0 || Dj==0 || !loadData()) {
         return GRIB_NOTDEF;
     }
+    touchData();
     if (!isPointInMap(px,py)) {
         px += 360.0;               // tour du monde à droite ?
         if (!isPointInMap(px,py)) {
@@ -26,6 +26,7 @@ Elément de base d'un fichier GRIB
 
 #include <iostream>
 #include <cmath>
+#include <list>
 
 #include "zuFile.h"
 
@@ -117,12 +118,18 @@ class GribCode
 		}
 };
 
+class GribReader;
+
 //----------------------------------------------
 class GribRecord
 {
+    friend class GribReader;
+
     public:
         GribRecord(ZUFILE* file, int id_);
         GribRecord(const GribRecord &rec);
+        // Record at "date", interpolated in time between two records of the same data
+        GribRecord(const GribRecord &rec1, const GribRecord &rec2, time_t date);
         ~GribRecord();
 
         bool  isOk()  const   {return ok;};
@@ -158,13 +165,20 @@ class GribRecord
         double  getDi() const    { return Di; }
         double  getDj() const    { return Dj; }
 
-        // Value at one point of the grid
-        double getValue(int i, int j) const  { return ok ? data[j*Ni+i] : GRIB_NOTDEF;}
+        // Value at one point of the grid (decoded on first use)
+        double getValue(int i, int j) const  { return ok && (data || loadData()) ? data[j*Ni+i] : GRIB_NOTDEF;}
 
+        // Writing a value keeps the grid in memory for the record's lifetime
         void setValue(zuint i, zuint j, double v)
-                        { if (i<Ni && j<Nj)
+                        { if (i<Ni && j<Nj && pinData())
                               data[j*Ni+i] = v; }
 
+        // Records read from a file only carry their index until the grid is needed
+        bool    isDataLoaded() const  { return data != NULL; }
+        bool    loadData() const;
+        void    touchData() const;
+        size_t  getDataSize() const   { return (size_t)Ni*Nj*sizeof(double); }
+
         // Value for one point interpolated
         double  getInterpolatedValue(double px, double py, bool numericalInterpolation=true) const;
 
@@ -264,8 +278,23 @@ class GribRecord
         double refValue;
         zuint  nbBitsInPack;
         double  *data;
+        zuchar  *packedData;    // BDS payload, kept for streams we can't seek back in
+        double  dataFactor;     // unit conversion applied each time the grid is decoded
         // SECTION 5: END SECTION (ES)
 
+        //---------------------------------------------
+        // Lazy grid decoding
+        //---------------------------------------------
+        GribReader *reader;     // owner of the file the grid is read from
+        bool   inDataCache;
+        std::list<GribRecord *>::iterator dataCachePos;
+
+        bool readGribData(ZUFILE* file);
+        bool decodeGribData(zuchar *buf);
+        void freeGribData();
+        bool pinData();
+        void copyGrid(const GribRecord &rec);
+
         //---------------------------------------------
         // Data Access
         //---------------------------------------------
@@ -293,6 +322,7 @@ class GribRecord
         time_t makeDate(zuint year,zuint month,zuint day,zuint hour,zuint min,zuint sec);
         zuint  periodSeconds(zuchar unit, zuchar P1, zuchar P2, zuchar range);
         void   multiplyAllData(double k);
+        void   scaleData(double k);
 
         void   print();
 };
@@ -27,6 +27,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //#include "cutil.h"
 //#include "georef.h"
 #include <wx/graphics.h>
+#include <wx/thread.h>
+
+#include <algorithm>
 
 #include "IsoLine.h"
 
@@ -619,6 +622,347 @@ void IsoLine::extractIsoLine(const GribRecord *rec)
     }
 }
 
+//==================================================================================
+// IsoLineSet
+//==================================================================================
+
+//-----------------------------------------------------------------------
+//    Worker thread for one row band of IsoLineSet
+//-----------------------------------------------------------------------
+class IsoLineBandThread: public wxThread
+{
+public:
+      IsoLineBandThread(const IsoLineSet *pset, int j0, int j1, std::vector<IsoLineLevel> *pband)
+            : wxThread(wxTHREAD_JOINABLE)
+      {
+            m_pset = pset;
+            m_j0 = j0;
+            m_j1 = j1;
+            m_pband = pband;
+      }
+
+      void *Entry()
+      {
+            m_pset->extractBand(m_j0, m_j1, *m_pband);
+            return 0;
+      }
+
+private:
+      const IsoLineSet              *m_pset;
+      int                           m_j0, m_j1;
+      std::vector<IsoLineLevel>     *m_pband;
+};
+
+//---------------------------------------------------------------
+IsoLineSet::IsoLineSet(const GribRecord *rec, double first, double step, int nbLevels)
+{
+    m_rec = rec;
+    m_first = first;
+    m_step = step;
+    W = rec->getNi();
+    H = rec->getNj();
+
+    m_levels.resize(nbLevels);
+    for (int k=0; k<nbLevels; k++) {
+        m_levels[k].value = first + k*step;
+        m_levels[k].nbSegments = 0;
+    }
+
+    //  The grid is decoded on demand, and that is not thread safe:
+    //  make sure it is in memory before the workers start.
+    if (nbLevels < 1 || W < 2 || H < 2 || !rec->loadData())
+        return;
+
+    //  Rows are processed as cells (j-1,j), j from 1 to H-1
+    int n_rows = H - 1;
+    int n_threads = 1;
+    int n_cpu = wxThread::GetCPUCount();
+    if (n_cpu > 1) {
+        n_threads = wxMin(n_cpu, MAX_ISOLINE_THREADS);
+        n_threads = wxMin(n_threads, n_rows / MIN_ISOLINE_BAND);
+        n_threads = wxMax(n_threads, 1);
+    }
+
+    std::vector< std::vector<IsoLineLevel> > bands(n_threads);
+    IsoLineBandThread *pthreads[MAX_ISOLINE_THREADS];
+    int band_height = (n_rows + n_threads - 1) / n_threads;
+
+    //    The calling thread takes the first band
+    for (int it=1; it<n_threads; it++)
+    {
+        pthreads[it] = NULL;
+        int j0 = 1 + it*band_height;
+        int j1 = wxMin(j0 + band_height, H);
+        if (j0 >= j1)
+            continue;
+
+        IsoLineBandThread *pt = new IsoLineBandThread(this, j0, j1, &bands[it]);
+        if ((pt->Create() != wxTHREAD_NO_ERROR) || (pt->Run() != wxTHREAD_NO_ERROR))
+        {
+            delete pt;                    // do it here instead
+            extractBand(j0, j1, bands[it]);
+        }
+        else
+            pthreads[it] = pt;
+    }
+
+    extractBand(1, wxMin(1 + band_height, H), bands[0]);
+
+    for (int it=1; it<n_threads; it++)
+    {
+        if (pthreads[it]) {
+            pthreads[it]->Wait();
+            delete pthreads[it];
+        }
+    }
+
+    //  Merge the bands in grid order, then join the segments of each value
+    for (int k=0; k<nbLevels; k++)
+    {
+        IsoLineLevel &lev = m_levels[k];
+        for (int it=0; it<n_threads; it++)
+        {
+            if ((int)bands[it].size() <= k)
+                continue;
+            IsoLineLevel &part = bands[it][k];
+            lev.segs.insert(lev.segs.end(), part.segs.begin(), part.segs.end());
+            lev.edges.insert(lev.edges.end(), part.edges.begin(), part.edges.end());
+            std::vector<double>().swap(part.segs);
+            std::vector<int>().swap(part.edges);
+        }
+        buildChains(lev);
+    }
+}
+
+//---------------------------------------------------------------
+int IsoLineSet::getNbSegments() const
+{
+    int nb = 0;
+    for (unsigned int k=0; k<m_levels.size(); k++)
+        nb += m_levels[k].nbSegments;
+    return nb;
+}
+
+//-----------------------------------------------------------------------
+// Ajoute le segment qui joint l'arête c1-c2 à l'arête c3-c4 de la case (I,J)
+//   a  b
+//   c  d
+// The intersections are computed as in Segment, and each end remembers
+// the grid edge it lies on, which is what chains are built from.
+//-----------------------------------------------------------------------
+void IsoLineSet::addSegment(IsoLineLevel &lev, int I, int J,
+                            char c1, char c2, char c3, char c4) const
+{
+    char code[4] = {c1, c2, c3, c4};
+    double value = lev.value;
+
+    for (int e=0; e<2; e++)
+    {
+        int i=0,j=0, k=0,l=0;
+        for (int n=0; n<2; n++)
+        {
+            int ci, cj;
+            switch (code[2*e+n]) {
+                case 'a':  ci=I-1;  cj=J-1; break;
+                case 'b':  ci=I  ;  cj=J-1; break;
+                case 'c':  ci=I-1;  cj=J  ; break;
+                default:   ci=I  ;  cj=J  ;
+            }
+            if (n == 0) { i = ci; j = cj; }
+            else        { k = ci; l = cj; }
+        }
+
+        double pa = m_rec->getValue(i,j);
+        double pb = m_rec->getValue(k,l);
+        double dec;
+        if (pb != pa)
+            dec = (value-pa)/(pb-pa);
+        else
+            dec = 0.5;
+        if (fabs(dec)>1)
+            dec = 0.5;
+
+        double a = m_rec->getX(i);
+        double b = m_rec->getX(k);
+        lev.segs.push_back(a+(b-a)*dec);
+        a = m_rec->getY(j);
+        b = m_rec->getY(l);
+        lev.segs.push_back(a+(b-a)*dec);
+
+        // Edge id: horizontal edges even, vertical edges odd
+        if (j == l)
+            lev.edges.push_back(2*(j*W + wxMin(i,k)));
+        else
+            lev.edges.push_back(2*(wxMin(j,l)*W + i) + 1);
+    }
+}
+
+//-----------------------------------------------------------------------
+// Segments of grid rows [j0,j1[ for every value, in one pass.
+// Only reads the GribRecord, so bands can run concurrently.
+//-----------------------------------------------------------------------
+void IsoLineSet::extractBand(int j0, int j1, std::vector<IsoLineLevel> &band) const
+{
+    int nbLevels = m_levels.size();
+    band.resize(nbLevels);
+    for (int k=0; k<nbLevels; k++)
+        band[k].value = m_levels[k].value;
+
+    for (int j=wxMax(j0,1); j<j1; j++)
+    {
+        for (int i=1; i<W; i++)
+        {
+            double a = m_rec->getValue( i-1, j-1 );
+            double b = m_rec->getValue( i,   j-1 );
+            double c = m_rec->getValue( i-1, j   );
+            double d = m_rec->getValue( i,   j   );
+
+            // A value crosses the cell if vmin <= value < vmax
+            double vmin = wxMin(wxMin(a,b), wxMin(c,d));
+            double vmax = wxMax(wxMax(a,b), wxMax(c,d));
+            if (!(vmax > vmin))
+                continue;
+
+            double fk = ceil((vmin-m_first)/m_step);
+            if (fk >= nbLevels)
+                continue;
+            int k0 = fk < 0 ? 0 : (int)fk;
+            while (k0 > 0 && m_first+(k0-1)*m_step >= vmin)
+                k0--;
+            while (k0 < nbLevels && m_first+k0*m_step < vmin)
+                k0++;
+
+            for (int k=k0; k<nbLevels; k++)
+            {
+                IsoLineLevel &lev = band[k];
+                double value = lev.value;
+                if (value >= vmax)
+                    break;
+
+                // Détermine si 1 ou 2 segments traversent la case ab-cd
+                // (same cases as IsoLine::extractIsoLine)
+                //--------------------------------
+                // 1 segment en diagonale
+                //--------------------------------
+                if     ((a<=value && b<=value && c<=value  && d>value)
+                     || (a>value && b>value && c>value  && d<=value))
+                    addSegment(lev, i,j, 'c','d',  'b','d');
+                else if ((a<=value && c<=value && d<=value  && b>value)
+                     || (a>value && c>value && d>value  && b<=value))
+                    addSegment(lev, i,j, 'a','b',  'b','d');
+                else if ((c<=value && d<=value && b<=value  && a>value)
+                     || (c>value && d>value && b>value  && a<=value))
+                    addSegment(lev, i,j, 'a','b',  'a','c');
+                else if ((a<=value && b<=value && d<=value  && c>value)
+                     || (a>value && b>value && d>value  && c<=value))
+                    addSegment(lev, i,j, 'a','c',  'c','d');
+                //--------------------------------
+                // 1 segment H ou V
+                //--------------------------------
+                else if ((a<=value && b<=value   &&  c>value && d>value)
+                     || (a>value && b>value   &&  c<=value && d<=value))
+                    addSegment(lev, i,j, 'a','c',  'b','d');
+                else if ((a<=value && c<=value   &&  b>value && d>value)
+                     || (a>value && c>value   &&  b<=value && d<=value))
+                    addSegment(lev, i,j, 'a','b',  'c','d');
+                //--------------------------------
+                // 2 segments en diagonale
+                //--------------------------------
+                else if  (a<=value && d<=value   &&  c>value && b>value) {
+                    addSegment(lev, i,j, 'a','b',  'b','d');
+                    addSegment(lev, i,j, 'a','c',  'c','d');
+                }
+                else if  (a>value && d>value   &&  c<=value && b<=value) {
+                    addSegment(lev, i,j, 'a','b',  'a','c');
+                    addSegment(lev, i,j, 'b','d',  'c','d');
+                }
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------
+// Join the segments of one value into continuous chains.
+// Two segment ends meet when they lie on the same grid edge, so ends are
+// paired by sorting on the edge id instead of comparing coordinates.
+//-----------------------------------------------------------------------
+void IsoLineSet::buildChains(IsoLineLevel &lev)
+{
+    int nseg = lev.edges.size() / 2;
+    int nends = 2*nseg;
+    lev.nbSegments = nseg;
+    if (nseg == 0)
+        return;
+
+    std::vector< std::pair<int,int> > ends(nends);
+    for (int e=0; e<nends; e++)
+        ends[e] = std::make_pair(lev.edges[e], e);
+    std::sort(ends.begin(), ends.end());
+
+    std::vector<int> partner(nends, -1);
+    for (int e=0; e+1<nends; e++)
+    {
+        if (ends[e].first == ends[e+1].first) {
+            partner[ends[e].second] = ends[e+1].second;
+            partner[ends[e+1].second] = ends[e].second;
+            e++;
+        }
+    }
+
+    std::vector<char> used(nseg, 0);
+    lev.points.reserve(2*(nseg + nseg/4 + 1));
+
+    //  Open chains first, starting from an unpaired end, then closed loops
+    for (int pass=0; pass<2; pass++)
+    {
+        for (int e=0; e<nends; e++)
+        {
+            if (used[e/2] || (pass==0 && partner[e] >= 0))
+                continue;
+
+            int start = lev.points.size()/2;
+            lev.chainStart.push_back(start);
+            lev.points.push_back(lev.segs[2*e]);
+            lev.points.push_back(lev.segs[2*e+1]);
+
+            int cur = e;
+            while (true)
+            {
+                used[cur/2] = 1;
+                int other = cur ^ 1;
+                lev.points.push_back(lev.segs[2*other]);
+                lev.points.push_back(lev.segs[2*other+1]);
+
+                int next = partner[other];
+                if (next < 0 || used[next/2])
+                    break;
+                cur = next;
+            }
+
+            int end = lev.points.size()/2;
+            double lonmin = lev.points[2*start],   lonmax = lonmin;
+            double latmin = lev.points[2*start+1], latmax = latmin;
+            for (int ip=start+1; ip<end; ip++)
+            {
+                lonmin = wxMin(lonmin, lev.points[2*ip]);
+                lonmax = wxMax(lonmax, lev.points[2*ip]);
+                latmin = wxMin(latmin, lev.points[2*ip+1]);
+                latmax = wxMax(latmax, lev.points[2*ip+1]);
+            }
+            lev.chainBox.push_back(lonmin);
+            lev.chainBox.push_back(latmin);
+            lev.chainBox.push_back(lonmax);
+            lev.chainBox.push_back(latmax);
+        }
+    }
+    lev.chainStart.push_back(lev.points.size()/2);
+
+    //  The raw segments are not needed any more
+    std::vector<double>().swap(lev.segs);
+    std::vector<int>().swap(lev.edges);
+}
+
+
 
 // ----------------------------------------------------------------------------
 // splines code lifted from wxWidgets
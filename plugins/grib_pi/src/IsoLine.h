@@ -104,6 +104,59 @@ class IsoLine
         MySegListList   m_SegListList;
 };
 
+//===============================================================
+// All the isolines of a GribRecord for a regular series of values,
+// extracted in a single marching squares pass over the grid.
+// The grid is split in row bands processed on worker threads.
+//===============================================================
+#define MAX_ISOLINE_THREADS     8
+#define MIN_ISOLINE_BAND       16       // grid rows per thread, at least
+
+// One value of an IsoLineSet.
+// Chains are continuous polylines; their (lon,lat) points are stored
+// end to end in "points", chain c being [chainStart[c], chainStart[c+1]).
+class IsoLineLevel
+{
+    public:
+        double               value;
+        std::vector<double>  segs;          // x1,y1,x2,y2 per segment, while extracting
+        std::vector<int>     edges;         // grid edge of each segment end
+        std::vector<double>  points;
+        std::vector<int>     chainStart;
+        std::vector<double>  chainBox;      // lonmin,latmin,lonmax,latmax per chain
+        int                  nbSegments;
+
+        int     getNbChains() const        {return chainStart.size()>0 ? chainStart.size()-1 : 0;}
+        int     getChainSize(int c) const  {return chainStart[c+1]-chainStart[c];}
+        const double *getChainPoints(int c) const  {return &points[2*chainStart[c]];}
+        const double *getChainBox(int c) const     {return &chainBox[4*c];}
+};
+
+class IsoLineSet
+{
+    public:
+        IsoLineSet(const GribRecord *rec, double first, double step, int nbLevels);
+
+        bool    isSameSeries(double first, double step, int nbLevels) const
+                      {return first==m_first && step==m_step && nbLevels==(int)m_levels.size();}
+        int     getNbLevels() const                    {return m_levels.size();}
+        const IsoLineLevel &getLevel(int k) const      {return m_levels[k];}
+        int     getNbSegments() const;
+
+        // Segments of grid rows [j0,j1[, one IsoLineLevel per value (thread safe)
+        void    extractBand(int j0, int j1, std::vector<IsoLineLevel> &band) const;
+
+    private:
+        const GribRecord *m_rec;
+        int     W, H;           // taille de la grille
+        double  m_first, m_step;
+        std::vector<IsoLineLevel> m_levels;
+
+        void    addSegment(IsoLineLevel &lev, int I, int J,
+                           char c1, char c2, char c3, char c4) const;
+        void    buildChains(IsoLineLevel &lev);
+};
+
 
 
 
@@ -39,6 +39,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <time.h>
+#include <vector>
 
 #include "grib_pi.h"
 
@@ -106,6 +107,9 @@ BEGIN_EVENT_TABLE ( GRIBUIDialog, wxDialog )
             EVT_CHECKBOX(ID_CB_SIGHW, GRIBUIDialog::OnCBSigHwClick)
             EVT_CHECKBOX(ID_CB_SEATMP, GRIBUIDialog::OnCBSeatempClick)
             EVT_CHECKBOX(ID_CB_SEATMP, GRIBUIDialog::OnCBSeaCurrentClick)
+            EVT_BUTTON ( ID_ANIMATE, GRIBUIDialog::OnAnimateClick )
+            EVT_CHOICE ( ID_ANIMATIONSTEP, GRIBUIDialog::OnAnimationStepChange )
+            EVT_TIMER ( ID_ANIMATIONTIMER, GRIBUIDialog::OnAnimationTimer )
 
 
 END_EVENT_TABLE()
@@ -134,6 +138,13 @@ void GRIBUIDialog::Init( )
       m_pSigWHTextCtrl     = NULL;
       m_pSeaTmpTextCtrl    = NULL;
       m_pSeaCurrentTextCtrl= NULL;
+
+      m_pCurrentGribFile = NULL;
+      m_pAnimationFrame = NULL;
+      m_pAnimationRestoreSet = NULL;
+      m_pAnimateButton = NULL;
+      m_pAnimationStepChoice = NULL;
+      m_pAnimationStatus = NULL;
 }
 
 
@@ -174,6 +185,8 @@ bool GRIBUIDialog::Create ( wxWindow *parent, grib_pi *ppi, wxWindowID id,
 
       m_pfolder_bitmap = new wxBitmap ( folder );   // comes from XPM include
 
+      m_AnimationTimer.SetOwner(this, ID_ANIMATIONTIMER);
+
       CreateControls();
 
 
@@ -304,6 +317,28 @@ void GRIBUIDialog::CreateControls()
       m_pSeaCurrentTextCtrl = new wxTextCtrl(this, -1, _T(""), wxDefaultPosition, wxDefaultSize, wxTE_READONLY );
       pDataGrid->Add(m_pSeaCurrentTextCtrl, 0, wxALIGN_RIGHT, group_item_spacing);
 
+//      Animation Box
+      wxStaticBox* itemStaticBoxAnimation = new wxStaticBox(this, wxID_ANY, _("Animation"));
+      wxStaticBoxSizer* itemStaticBoxSizerAnimation = new wxStaticBoxSizer(itemStaticBoxAnimation, wxVERTICAL);
+      boxSizer->Add(itemStaticBoxSizerAnimation, 0, wxALL|wxEXPAND, border_size);
+
+      wxBoxSizer *pAnimationControls = new wxBoxSizer(wxHORIZONTAL);
+      itemStaticBoxSizerAnimation->Add(pAnimationControls, 0, wxALL|wxEXPAND, border_size);
+
+      m_pAnimateButton = new wxButton(this, ID_ANIMATE, _("Animate"));
+      pAnimationControls->Add(m_pAnimateButton, 0, wxALIGN_CENTER_VERTICAL|wxALL, group_item_spacing);
+
+      wxStaticText *ps7 = new wxStaticText(this, wxID_ANY, _("Time step"));
+      pAnimationControls->Add(ps7, 0, wxALIGN_CENTER_VERTICAL|wxALL, 5);
+
+      wxString steps[] = { _("10 min"), _("15 min"), _("30 min"), _("1 hour"), _("3 hours") };
+      m_pAnimationStepChoice = new wxChoice(this, ID_ANIMATIONSTEP, wxDefaultPosition, wxDefaultSize, 5, steps);
+      m_pAnimationStepChoice->SetSelection(2);
+      pAnimationControls->Add(m_pAnimationStepChoice, 0, wxALIGN_CENTER_VERTICAL|wxALL, group_item_spacing);
+
+      m_pAnimationStatus = new wxStaticText(this, wxID_ANY, _T("\n"), wxDefaultPosition, wxDefaultSize, wxST_NO_AUTORESIZE);
+      itemStaticBoxSizerAnimation->Add(m_pAnimationStatus, 0, wxALL|wxEXPAND, border_size);
+
 
 // A horizontal box sizer to contain OK
       wxBoxSizer* AckBox = new wxBoxSizer ( wxHORIZONTAL );
@@ -470,6 +505,8 @@ void GRIBUIDialog::UpdateTrackingControls(void)
 
 void GRIBUIDialog::OnClose ( wxCloseEvent& event )
 {
+      StopAnimation(false);
+
       pPlugIn->SetGribDir(m_currentGribDir);
 
 
@@ -518,12 +555,16 @@ void GRIBUIDialog::OnChooseDirClick ( wxCommandEvent& event )
       wxString new_dir  = ::wxDirSelector ( _( "Select GRIB Directory" ), m_currentGribDir );
       if ( !new_dir.empty() )
       {
+            StopAnimation(false);
+            m_pCurrentGribFile = NULL;
+
             m_currentGribDir = new_dir;
             m_pitemCurrentGribDirectoryCtrl->SetValue ( m_currentGribDir );
             m_pitemCurrentGribDirectoryCtrl->SetInsertionPoint(0);
 
             if(m_pRecordTree)
             {
+                  pPlugIn->GetGRIBOverlayFactory()->ClearRecordCaches();       // before the GribRecords go away
                   m_pRecordTree->DeleteAllItems();
                   delete m_pRecordTree->m_file_id_array;
 
@@ -574,6 +615,127 @@ void GRIBUIDialog::OnCBSeaCurrentClick ( wxCommandEvent& event )
       SetFactoryOptions();                     // Reload the visibility options
 }
 
+void GRIBUIDialog::OnAnimateClick ( wxCommandEvent& event )
+{
+      if(m_Animator.IsRunning())
+            StopAnimation(true);
+      else
+            StartAnimation();
+}
+
+void GRIBUIDialog::OnAnimationStepChange ( wxCommandEvent& event )
+{
+      if(m_Animator.IsRunning())
+      {
+            StopAnimation(true);
+            StartAnimation();
+      }
+}
+
+int GRIBUIDialog::GetAnimationStep(void)
+{
+      static const int step_minutes[] = { 10, 15, 30, 60, 180 };
+
+      int sel = m_pAnimationStepChoice->GetSelection();
+      if((sel < 0) || (sel >= 5))
+            sel = 2;
+
+      return step_minutes[sel] * 60;
+}
+
+void GRIBUIDialog::StartAnimation(void)
+{
+      if(!m_pCurrentGribFile)
+            return;
+
+      ArrayOfGribRecordSets *rsa = m_pCurrentGribFile->GetRecordSetArrayPtr();
+      if(rsa->GetCount() < 2)
+            return;
+
+      //    Start at the selected forecast, if it is one of this file
+      time_t first_time = rsa->Item(0).m_Reference_Time;
+      for(unsigned int i = 0 ; i < rsa->GetCount() ; i++)
+            if(&rsa->Item(i) == m_pCurrentGribRecordSet)
+                  first_time = rsa->Item(i).m_Reference_Time;
+
+      m_pAnimationRestoreSet = m_pCurrentGribRecordSet;
+
+      //    The worker colours the field images with the factory's tables
+      GRIBOverlayFactory *pfactory = pPlugIn->GetGRIBOverlayFactory();
+      pfactory->BuildRasterLUTs();
+
+      m_Animator.Start(m_pCurrentGribFile->GetFileName(), first_time, GetAnimationStep(), pfactory,
+                       pfactory->GetAnimationView());
+      m_AnimationTimer.Start(ANIMATION_FRAME_MS);
+
+      m_pAnimateButton->SetLabel(_("Stop"));
+}
+
+void GRIBUIDialog::StopAnimation(bool b_restore)
+{
+      if(!m_Animator.IsRunning() && !m_pAnimationFrame)
+            return;
+
+      m_AnimationTimer.Stop();
+      m_Animator.Stop();
+
+      if(m_pAnimationFrame)
+      {
+            //    The overlay factory must let go of the frame before it is deleted
+            pPlugIn->GetGRIBOverlayFactory()->Reset();
+            pPlugIn->GetGRIBOverlayFactory()->ForgetRecordSet(&m_pAnimationFrame->m_RecordSet);
+            m_pCurrentGribRecordSet = NULL;
+
+            delete m_pAnimationFrame;
+            m_pAnimationFrame = NULL;
+      }
+
+      m_pAnimateButton->SetLabel(_("Animate"));
+      m_pAnimationStatus->SetLabel(_T("\n"));
+
+      if(b_restore)
+            SetGribRecordSet(m_pAnimationRestoreSet);
+      else
+            RequestRefresh(pParent);
+
+      m_pAnimationRestoreSet = NULL;
+}
+
+void GRIBUIDialog::OnAnimationTimer ( wxTimerEvent& event )
+{
+      GRIBOverlayFactory *pfactory = pPlugIn->GetGRIBOverlayFactory();
+
+      //    Frames still to be built are prepared for the current view and options
+      m_Animator.SetView(pfactory->GetAnimationView());
+
+      GribAnimationFrame *pframe = m_Animator.TakeFrame();
+
+      if(pframe)
+      {
+            GribAnimationFrame *pold = m_pAnimationFrame;
+            m_pAnimationFrame = pframe;
+
+            pfactory->AdoptAnimationFrame(pframe);
+            SetGribRecordSet(&pframe->m_RecordSet);
+
+            if(pold)
+            {
+                  pfactory->ForgetRecordSet(&pold->m_RecordSet);
+                  delete pold;
+            }
+      }
+
+      wxString status;
+      if(m_pAnimationFrame)
+      {
+            wxDateTime t ( m_pAnimationFrame->m_RecordSet.m_Reference_Time );
+            status = t.Format ( _T("%a %d-%b-%Y %H:%M "), wxDateTime::UTC );
+            status.Append(_T("GMT\n"));
+      }
+      status.Append(m_Animator.GetStatusText());
+      m_pAnimationStatus->SetLabel(status);
+}
+
 
 void GRIBUIDialog::PopulateTreeControl()
 {
@@ -773,49 +935,193 @@ void GRIBUIDialog::SetFactoryOptions()
 GRIBOverlayFactory::GRIBOverlayFactory()
 {
       m_pGribRecordSet = NULL;
-      m_last_vp_scale = 0.;
 
-      m_pbm_sigwh   = NULL;
-      m_pbm_crain   = NULL;
-      m_pbm_seatemp = NULL;
-      m_pbm_current = NULL;
+      m_RasterCachePixels = 0;
+      for(int i = 0 ; i < GRIB_RASTER_NTYPES ; i++)
+            m_bRasterLUT[i] = false;
 
       m_bReadyToRender = false;
+      m_bLastViewPort = false;
 
 }
 
 GRIBOverlayFactory::~GRIBOverlayFactory()
 {
-      delete m_pbm_sigwh;
-      delete m_pbm_crain;
-      delete m_pbm_seatemp;
-      delete m_pbm_current;
+      ClearRecordCaches();
+}
+void GRIBOverlayFactory::Reset()
+{
+      m_pGribRecordSet = NULL;
 
-      for(unsigned int i = 0 ; i < m_IsobarArray.GetCount() ; i++)
+      //    Isobars and field bitmaps are kept per GribRecord, so stepping
+      //    back to a record set does not build them again.
+
+      m_bReadyToRender = false;
+
+}
+
+//    Must be called before the GribRecords of the caches are deleted
+void GRIBOverlayFactory::ClearRecordCaches()
+{
+      ClearIsobarCache();
+      ClearRasterCache();
+}
+
+//    Must be called before the GribRecords of a record set are deleted
+void GRIBOverlayFactory::ForgetRecordSet(GribRecordSet *pGribRecordSet)
+{
+      for ( unsigned int i=0 ; i < pGribRecordSet->m_GribRecordPtrArray.GetCount() ; i++ )
       {
-            IsoLine *piso = (IsoLine *)m_IsobarArray.Item(i);
-            delete piso;
+            const GribRecord *pGR = pGribRecordSet->m_GribRecordPtrArray.Item ( i );
+
+            std::map<const GribRecord *, IsoLineSet *>::iterator iso = m_IsobarCache.find(pGR);
+            if(iso != m_IsobarCache.end())
+            {
+                  delete iso->second;
+                  m_IsobarCache.erase(iso);
+                  m_IsobarCacheOrder.remove(pGR);
+            }
+
+            std::list<GribRasterCacheEntry>::iterator it = m_RasterCache.begin();
+            while(it != m_RasterCache.end())
+            {
+                  if((it->m_pGR == pGR) || (it->m_pGR2 == pGR))
+                  {
+                        m_RasterCachePixels -= (long)it->m_pbm->GetWidth() * it->m_pbm->GetHeight();
+                        delete it->m_pbm;
+                        it = m_RasterCache.erase(it);
+                  }
+                  else
+                        it++;
+            }
       }
+}
 
-      m_IsobarArray.Empty();
+void GRIBOverlayFactory::ClearIsobarCache()
+{
+      std::map<const GribRecord *, IsoLineSet *>::iterator it;
+      for(it = m_IsobarCache.begin() ; it != m_IsobarCache.end() ; it++)
+            delete it->second;
 
+      m_IsobarCache.clear();
+      m_IsobarCacheOrder.clear();
 }
-void GRIBOverlayFactory::Reset()
+
+void GRIBOverlayFactory::ClearRasterCache()
 {
-      m_pGribRecordSet = NULL;
+      std::list<GribRasterCacheEntry>::iterator it;
+      for(it = m_RasterCache.begin() ; it != m_RasterCache.end() ; it++)
+            delete it->m_pbm;
 
-      ClearCachedData();
+      m_RasterCache.clear();
+      m_RasterCachePixels = 0;
+}
 
-      //    Clear out the cached isobars
-      for(unsigned int i = 0 ; i < m_IsobarArray.GetCount() ; i++)
+//    Isobars every 2 hPa, from 840 to 1118 hPa
+static const double s_isobar_first = 84000.;
+static const double s_isobar_step = 200.;
+static const int s_isobar_levels = 140;
+
+static IsoLineSet *NewIsobars(GribRecord *pGR)
+{
+      return new IsoLineSet(pGR, s_isobar_first, s_isobar_step, s_isobar_levels);
+}
+
+IsoLineSet *GRIBOverlayFactory::GetIsobars(GribRecord *pGR)
+{
+      std::map<const GribRecord *, IsoLineSet *>::iterator it = m_IsobarCache.find(pGR);
+      if(it != m_IsobarCache.end())
       {
-            IsoLine *piso = (IsoLine *)m_IsobarArray.Item(i);
-            delete piso;
+            if(it->second->isSameSeries(s_isobar_first, s_isobar_step, s_isobar_levels))
+                  return it->second;
+
+            delete it->second;
+            m_IsobarCache.erase(it);
+            m_IsobarCacheOrder.remove(pGR);
       }
-      m_IsobarArray.Clear();                            // Will need to rebuild Isobar list
 
-      m_bReadyToRender = false;
+      IsoLineSet *pset = NewIsobars(pGR);
+      CacheIsobars(pGR, pset);
+
+      return pset;
+}
+
+void GRIBOverlayFactory::CacheIsobars(const GribRecord *pGR, IsoLineSet *pset)
+{
+      m_IsobarCache[pGR] = pset;
+      m_IsobarCacheOrder.push_back(pGR);
+
+      while((int)m_IsobarCacheOrder.size() > ISOBAR_CACHE_SIZE)
+      {
+            const GribRecord *pold = m_IsobarCacheOrder.front();
+            m_IsobarCacheOrder.pop_front();
+            delete m_IsobarCache[pold];
+            m_IsobarCache.erase(pold);
+      }
+}
+
+void GRIBOverlayFactory::CacheRaster(const GribRasterCacheEntry &entry)
+{
+      m_RasterCache.push_front(entry);
+      m_RasterCachePixels += (long)entry.m_pbm->GetWidth() * entry.m_pbm->GetHeight();
+
+      //    Drop the least recently drawn bitmaps, but never the new one
+      while((m_RasterCachePixels > RASTER_CACHE_PIXELS) && (m_RasterCache.size() > 1))
+      {
+            wxBitmap *pold = m_RasterCache.back().m_pbm;
+            m_RasterCachePixels -= (long)pold->GetWidth() * pold->GetHeight();
+            delete pold;
+            m_RasterCache.pop_back();
+      }
+}
+
+GribAnimationView GRIBOverlayFactory::GetAnimationView()
+{
+      GribAnimationView view;
+      view.m_bvp = m_bLastViewPort;
+      if(m_bLastViewPort)
+            view.m_vp = m_LastViewPort;
+      view.m_ben_Pressure = m_ben_Pressure;
+      view.m_ben_SigHw = m_ben_SigHw;
+      view.m_ben_Seatmp = m_ben_Seatmp;
+      view.m_ben_SeaCurrent = m_ben_SeaCurrent;
+
+      return view;
+}
+
+//    Take over the isobars and field images built with a frame, so that
+//    rendering the frame finds them in the caches
+void GRIBOverlayFactory::AdoptAnimationFrame(GribAnimationFrame *pframe)
+{
+      std::map<const GribRecord *, IsoLineSet *>::iterator iso;
+      for(iso = pframe->m_Isobars.begin() ; iso != pframe->m_Isobars.end() ; iso++)
+      {
+            if(m_IsobarCache.find(iso->first) == m_IsobarCache.end())
+                  CacheIsobars(iso->first, iso->second);
+            else
+                  delete iso->second;
+      }
+      pframe->m_Isobars.clear();
 
+      std::list<GribAnimationRaster>::iterator it;
+      for(it = pframe->m_Rasters.begin() ; it != pframe->m_Rasters.end() ; it++)
+      {
+            //    Built for a view that has since been zoomed or reprojected
+            if(m_bLastViewPort && ((it->m_scale_ppm != m_LastViewPort.view_scale_ppm) ||
+                                   (it->m_projection != m_LastViewPort.m_projection_type)))
+                  continue;
+
+            GribRasterCacheEntry entry;
+            entry.m_pGR = it->m_pGR;
+            entry.m_pGR2 = it->m_pGR2;
+            entry.m_type = it->m_type;
+            entry.m_scale_ppm = it->m_scale_ppm;
+            entry.m_projection = it->m_projection;
+            entry.m_pbm = new wxBitmap(it->m_image);
+            entry.m_pbm->SetMask(new wxMask(*entry.m_pbm, wxColour(0,0,0)));
+            CacheRaster(entry);
+      }
+      pframe->m_Rasters.clear();
 }
 
 void GRIBOverlayFactory::SetGribRecordSet ( GribRecordSet *pGribRecordSet )
@@ -836,22 +1142,6 @@ void GRIBOverlayFactory::SetGribRecordSet ( GribRecordSet *pGribRecordSet )
       m_bReadyToRender = true;
 
 }
-void GRIBOverlayFactory::ClearCachedData(void)
-{
-      //    Clear out the cached bitmaps
-      delete m_pbm_sigwh;
-      m_pbm_sigwh = NULL;
-
-      delete m_pbm_crain;
-      m_pbm_crain = NULL;
-
-      delete m_pbm_seatemp;
-      m_pbm_seatemp = NULL;
-
-      delete m_pbm_current;
-      m_pbm_current = NULL;
-}
-
 bool GRIBOverlayFactory::RenderGribOverlay ( wxMemoryDC *pmdc, PlugIn_ViewPort *vp )
 {
 //      printf("GRIBOverlayFactory::Render\n");
@@ -859,11 +1149,8 @@ bool GRIBOverlayFactory::RenderGribOverlay ( wxMemoryDC *pmdc, PlugIn_ViewPort *
       if ( !m_pGribRecordSet )
             return false;
 
-      //    If the scale has changed, clear out the cached bitmaps
-      if(vp->view_scale_ppm != m_last_vp_scale)
-            ClearCachedData();
-
-      m_last_vp_scale = vp->view_scale_ppm;
+      m_LastViewPort = *vp;
+      m_bLastViewPort = true;
 
       GribRecord *pGRWindVX = NULL;
       GribRecord *pGRWindVY = NULL;
@@ -881,6 +1168,7 @@ bool GRIBOverlayFactory::RenderGribOverlay ( wxMemoryDC *pmdc, PlugIn_ViewPort *
       for ( unsigned int i=0 ; i < m_pGribRecordSet->m_GribRecordPtrArray.GetCount() ; i++ )
       {
             GribRecord *pGR = m_pGribRecordSet->m_GribRecordPtrArray.Item ( i );
+            pGR->touchData();             // keep the displayed grids at the head of the reader's cache
 
             // Wind
             //    Actually need two records to draw the wind arrows
@@ -1121,123 +1409,8 @@ bool GRIBOverlayFactory::RenderGribSigWh(GribRecord *pGR, wxMemoryDC *pmdc, Plug
 {
 //      printf("renderGRIBSigWh\n");
 
-      wxPoint porg;
-      GetCanvasPixLL(vp,  &porg, pGR->getLatMax(), pGR->getLonMin());
-
-      //    Check two BBoxes....
-      //    TODO Make a better Intersect method
-
-      bool bdraw = false;
-      if(Intersect(vp, pGR->getLatMin(), pGR->getLatMax(), pGR->getLonMin(), pGR->getLonMax(), 0.) != _OUT)
-            bdraw= true;
-      if(Intersect(vp, pGR->getLatMin(), pGR->getLatMax(), pGR->getLonMin() - 360., pGR->getLonMax() - 360., 0.) != _OUT)
-            bdraw= true;
-
-      if(bdraw)
-      {
-
-      // If needed, create the bitmap
-            if(m_pbm_sigwh == NULL)
-            {
-                  wxPoint pmin;
-                  GetCanvasPixLL(vp,  &pmin, pGR->getLatMin(), pGR->getLonMin());
-                  wxPoint pmax;
-                  GetCanvasPixLL(vp,  &pmax, pGR->getLatMax(), pGR->getLonMax());
-
-                  int width = abs(pmax.x - pmin.x);
-                  int height = abs(pmax.y - pmin.y);
-
-
-                  //    Dont try to create enormous GRIB bitmaps
-                  if((width < 2000)  && (height < 2000))
-                  {
-                        //    This could take a while....
-                        ::wxBeginBusyCursor();
-
-                        wxImage gr_image(width, height);
-                        gr_image.InitAlpha();
-
-                        int grib_pixel_size = 4;
-
-                        wxPoint p;
-                        for(int ipix = 0 ; ipix < (width-grib_pixel_size + 1) ; ipix += grib_pixel_size)
-                        {
-                              for(int jpix = 0 ; jpix < (height-grib_pixel_size + 1) ; jpix += grib_pixel_size)
-                              {
-                                    double lat, lon;
-                                    p.x = ipix + porg.x;
-                                    p.y = jpix + porg.y;
-                                    GetCanvasLLPix( vp, p, &lat, &lon);
-
-                                    double  vh = pGR->getInterpolatedValue(lon, lat);
-
-                                    if (vh != GRIB_NOTDEF)
-                                    {
-                                          wxColour c = GetGraphicColor(vh, 12.);
-                                          unsigned char r = c.Red();
-                                          unsigned char g = c.Green();
-                                          unsigned char b = c.Blue();
-
-                                          for(int xp=0 ; xp < grib_pixel_size ; xp++)
-                                                for(int yp=0 ; yp < grib_pixel_size ; yp++)
-                                                {
-                                                      gr_image.SetRGB(ipix + xp, jpix + yp, r,g,b);
-                                                      gr_image.SetAlpha(ipix + xp, jpix + yp, 128);
-
-                                                }
-                                    }
-                                    else
-                                    {
-                                          for(int xp=0 ; xp < grib_pixel_size ; xp++)
-                                                for(int yp=0 ; yp < grib_pixel_size ; yp++)
-                                                {
-//                                                       gr_image.SetRGB(ipix + xp, jpix + yp, 0,0,0);
-                                                       gr_image.SetAlpha(ipix + xp, jpix + yp, 0);
-
-                                                }
-                                    }
-                              }
-                        }
-
-                        wxImage bl_image = (gr_image.Blur(4));
-
-                        //    Create a Bitmap
-                        m_pbm_sigwh = new wxBitmap(bl_image);
-                        wxMask *gr_mask = new wxMask(*m_pbm_sigwh, wxColour(0,0,0));
-                        m_pbm_sigwh->SetMask(gr_mask);
-
-                        ::wxEndBusyCursor();
-
-                  }
-            }
-
-
-            if(m_pbm_sigwh)
-            {
-                  //    Select bm into a memory dc
-//                  wxMemoryDC mdc(*m_pbm_sigwh);
-
-                  //    Blit it onto the dc
- //                 pmdc->Blit(porg.x, porg.y, m_pbm_sigwh->GetWidth(), m_pbm_sigwh->GetHeight(), &mdc, 0, 0, wxCOPY, true);          // with mask
-                  pmdc->DrawBitmap(*m_pbm_sigwh, porg.x, porg.y, true);
-            }
-            else
-            {
-                  wxFont sfont = pmdc->GetFont();
-                  wxFont mfont(15, wxFONTFAMILY_DEFAULT, wxFONTSTYLE_ITALIC, wxFONTWEIGHT_NORMAL);
-                  pmdc->SetFont(mfont);
-
-                  wxString msg = _("Please Zoom or Scale Out to view suppressed HTSGW GRIB");
-                  int w;
-                  pmdc->GetTextExtent(msg, &w, NULL);
-                  pmdc->DrawText(msg, vp->pix_width/2 - w/2, vp->pix_height/2);
-
-                  pmdc->SetFont(sfont);
-            }
-
-      }
-
-      return true;
+      return RenderGribRaster(GRIB_RASTER_SIGWH, pGR, NULL, pmdc, vp,
+                              _("Please Zoom or Scale Out to view suppressed HTSGW GRIB"));
 }
 
 bool GRIBOverlayFactory::RenderGribWvDir(GribRecord *pGR, wxMemoryDC *pmdc, PlugIn_ViewPort *vp)
@@ -1299,127 +1472,228 @@ bool GRIBOverlayFactory::RenderGribCRAIN(GribRecord *pGR, wxMemoryDC *pmdc, Plug
 {
 //      printf("renderGRIBCRAIN\n");
 
+      return RenderGribRaster(GRIB_RASTER_CRAIN, pGR, NULL, pmdc, vp,
+                              _("Please Zoom or Scale Out to view suppressed CRAIN GRIB"));
+}
+
+bool GRIBOverlayFactory::RenderGribSeaTemp(GribRecord *pGR, wxMemoryDC *pmdc, PlugIn_ViewPort *vp)
+{
+//      printf("renderGRIBSeaTemp\n");
+
+      return RenderGribRaster(GRIB_RASTER_SEATEMP, pGR, NULL, pmdc, vp,
+                              _("Please Zoom or Scale Out to view suppressed SEATEMP GRIB"));
+}
+
+
+bool GRIBOverlayFactory::RenderGribCurrent(GribRecord *pGRX, GribRecord *pGRY, wxMemoryDC *pmdc, PlugIn_ViewPort *vp)
+{
+//      printf("renderGRIBCurrent\n");
+
+      return RenderGribRaster(GRIB_RASTER_CURRENT, pGRX, pGRY, pmdc, vp,
+                              _("Please Zoom or Scale Out to view suppressed OCEAN CURRENT GRIB"));
+}
+
+bool GRIBOverlayFactory::RenderGribRaster(int type, GribRecord *pGR, GribRecord *pGR2, wxMemoryDC *pmdc, PlugIn_ViewPort *vp,
+                                          const wxString &msg)
+{
       wxPoint porg;
-      GetCanvasPixLL(vp,  &porg, pGR->getLatMax(), pGR->getLonMin());
+      int width, height;
+      if(!GetRasterExtent(pGR, vp, &porg, &width, &height))
+            return true;
 
-      bool bdraw = false;
-      if(Intersect(vp, pGR->getLatMin(), pGR->getLatMax(), pGR->getLonMin(), pGR->getLonMax(), 0.) != _OUT)
-            bdraw= true;
-      if(Intersect(vp, pGR->getLatMin(), pGR->getLatMax(), pGR->getLonMin() - 360., pGR->getLonMax() - 360., 0.) != _OUT)
-            bdraw= true;
+      //    A bitmap built for these records at this scale and projection
+      //    only moves with the viewport, so pans and ship moves reuse it
+      wxBitmap *pbm = NULL;
+      bool b_cached = false;
 
-      if(bdraw)
+      std::list<GribRasterCacheEntry>::iterator it;
+      for(it = m_RasterCache.begin() ; it != m_RasterCache.end() ; it++)
       {
+            if((it->m_pGR == pGR) && (it->m_pGR2 == pGR2) && (it->m_type == type) &&
+                (it->m_scale_ppm == vp->view_scale_ppm) && (it->m_projection == vp->m_projection_type))
+            {
+                  pbm = it->m_pbm;
+                  m_RasterCache.splice(m_RasterCache.begin(), m_RasterCache, it);
+                  b_cached = true;
+                  break;
+            }
+      }
 
       // If needed, create the bitmap
-            if(m_pbm_crain == NULL)
+      if(!b_cached)
+      {
+            //    Dont try to create enormous GRIB bitmaps
+            if((width < RASTER_MAX_SIZE)  && (height < RASTER_MAX_SIZE))
             {
-                  wxPoint pmin;
-                  GetCanvasPixLL(vp,  &pmin, pGR->getLatMin(), pGR->getLonMin());
-                  wxPoint pmax;
-                  GetCanvasPixLL(vp,  &pmax, pGR->getLatMax(), pGR->getLonMax());
+                  pbm = CreateRasterBitmap(type, pGR, pGR2, vp, porg, width, height);
+
+                  GribRasterCacheEntry entry;
+                  entry.m_pGR = pGR;
+                  entry.m_pGR2 = pGR2;
+                  entry.m_type = type;
+                  entry.m_scale_ppm = vp->view_scale_ppm;
+                  entry.m_projection = vp->m_projection_type;
+                  entry.m_pbm = pbm;
+                  CacheRaster(entry);
+            }
+      }
 
-                  int width = abs(pmax.x - pmin.x);
-                  int height = abs(pmax.y - pmin.y);
+      if(pbm)
+      {
+            pmdc->DrawBitmap(*pbm, porg.x, porg.y, true);
+      }
+      else
+      {
+            wxFont sfont = pmdc->GetFont();
+            wxFont mfont(15, wxFONTFAMILY_DEFAULT, wxFONTSTYLE_ITALIC, wxFONTWEIGHT_NORMAL);
+            pmdc->SetFont(mfont);
 
+            int w;
+            pmdc->GetTextExtent(msg, &w, NULL);
+            pmdc->DrawText(msg, vp->pix_width/2 - w/2, vp->pix_height/2);
 
-                  //    Dont try to create enormous GRIB bitmaps
-                  if((width < 2000)  && (height < 2000))
-                  {
-                        //    This could take a while....
-                              ::wxBeginBusyCursor();
+            pmdc->SetFont(sfont);
+      }
 
-                              wxImage gr_image(width, height);
-                              gr_image.InitAlpha();
+      return true;
+}
 
-                              int grib_pixel_size = 4;
+//----------------------------------------------------------------------------------------------------------
+//    Grid cells of the block columns and rows of a field bitmap.
+//    The viewport is Mercator, so a column has one longitude and a row one latitude,
+//    and the cell and the interpolation weights are found once per column and per row.
+//----------------------------------------------------------------------------------------------------------
+class GribRasterGrid
+{
+      public:
+            GribRasterGrid(const GribRecord *pGR, const std::vector<double> &lons, const std::vector<double> &lats);
 
-                              wxPoint p;
-                              for(int ipix = 0 ; ipix < (width-grib_pixel_size + 1) ; ipix += grib_pixel_size)
-                              {
-                                    for(int jpix = 0 ; jpix < (height-grib_pixel_size + 1) ; jpix += grib_pixel_size)
-                                    {
-                                          double lat, lon;
-                                          p.x = ipix + porg.x;
-                                          p.y = jpix + porg.y;
-                                          GetCanvasLLPix( vp, p, &lat, &lon);
-
-                                          double  vh = pGR->getInterpolatedValue(lon, lat);
-
-                                          if (vh == GRIB_NOTDEF)
-                                          {
-                                                wxColour c((unsigned char)vh * 255, 0, 0);
-                                                unsigned char r = c.Red();
-                                                unsigned char g = c.Green();
-                                                unsigned char b = c.Blue();
-
-                                                for(int xp=0 ; xp < grib_pixel_size ; xp++)
-                                                      for(int yp=0 ; yp < grib_pixel_size ; yp++)
-                                                {
-                                                      gr_image.SetRGB(ipix + xp, jpix + yp, r,g,b);
-                                                      gr_image.SetAlpha(ipix + xp, jpix + yp, 128);
-
-                                                }
-                                          }
-                                          else
-                                          {
-                                                for(int xp=0 ; xp < grib_pixel_size ; xp++)
-                                                      for(int yp=0 ; yp < grib_pixel_size ; yp++)
-                                                {
-                                                      gr_image.SetAlpha(ipix + xp, jpix + yp, 0);
-                                                }
-                                          }
-                                    }
-                              }
+            void InterpolateRow(int row, double *values) const;
 
-                              wxImage bl_image = (gr_image.Blur(4));
+      private:
+            const GribRecord              *m_pGR;
+            const std::vector<double>     &m_lons;
+            const std::vector<double>     &m_lats;
 
-                        //    Create a Bitmap
-                              m_pbm_crain = new wxBitmap(bl_image);
-                              wxMask *gr_mask = new wxMask(*m_pbm_crain, wxColour(0,0,0));
-                              m_pbm_crain->SetMask(gr_mask);
+            std::vector<int>              m_i0;       // cell of each column, -1 if outside the grid
+            std::vector<double>           m_wx;       // weight of the i0+1 side
+            std::vector<int>              m_j0;
+            std::vector<double>           m_wy;
+};
 
-                              ::wxEndBusyCursor();
+GribRasterGrid::GribRasterGrid(const GribRecord *pGR, const std::vector<double> &lons, const std::vector<double> &lats)
+      : m_pGR(pGR), m_lons(lons), m_lats(lats),
+        m_i0(lons.size(), -1), m_wx(lons.size(), 0.), m_j0(lats.size(), -1), m_wy(lats.size(), 0.)
+{
+      int ni = pGR->getNi();
+      int nj = pGR->getNj();
+      double di = pGR->getDi();
+      double dj = pGR->getDj();
+
+      if((ni < 2) || (nj < 2) || (di == 0.) || (dj == 0.) || !pGR->loadData())
+            return;
+
+      double lo1 = pGR->getX(0);
+      double la1 = pGR->getY(0);
 
+      //    Same wrapping and pseudo hermite weights as GribRecord::getInterpolatedValue()
+      for(unsigned int c = 0 ; c < lons.size() ; c++)
+      {
+            double px = lons[c];
+            if(!pGR->isXInMap(px))
+            {
+                  px += 360.;
+                  if(!pGR->isXInMap(px))
+                  {
+                        px -= 2*360.;
+                        if(!pGR->isXInMap(px))
+                              continue;
                   }
             }
 
+            double pi = (px - lo1) / di;
+            int i0 = wxMin((int)pi, ni - 2);
+            double dx = wxMin(pi - i0, 1.);
+            m_i0[c] = i0;
+            m_wx[c] = (3.0 - 2.0*dx)*dx*dx;
+      }
 
-            if(m_pbm_crain)
-            {
-                  //    Select bm into a memory dc
-//                  wxMemoryDC mdc(*m_pbm_sigwh);
+      for(unsigned int r = 0 ; r < lats.size() ; r++)
+      {
+            if(!pGR->isYInMap(lats[r]))
+                  continue;
+
+            double pj = (lats[r] - la1) / dj;
+            int j0 = wxMin((int)pj, nj - 2);
+            double dy = wxMin(pj - j0, 1.);
+            m_j0[r] = j0;
+            m_wy[r] = (3.0 - 2.0*dy)*dy*dy;
+      }
+}
 
-                  //    Blit it onto the dc
- //                 pmdc->Blit(porg.x, porg.y, m_pbm_sigwh->GetWidth(), m_pbm_sigwh->GetHeight(), &mdc, 0, 0, wxCOPY, true);          // with mask
-                  pmdc->DrawBitmap(*m_pbm_crain, porg.x, porg.y, true);
-            }
-            else
-            {
-                  wxFont sfont = pmdc->GetFont();
-                  wxFont mfont(15, wxFONTFAMILY_DEFAULT, wxFONTSTYLE_ITALIC, wxFONTWEIGHT_NORMAL);
-                  pmdc->SetFont(mfont);
+void GribRasterGrid::InterpolateRow(int row, double *values) const
+{
+      int ncols = m_i0.size();
+      int j0 = m_j0[row];
 
-                  wxString msg = _("Please Zoom or Scale Out to view suppressed CRAIN GRIB");
-                  int w;
-                  pmdc->GetTextExtent(msg, &w, NULL);
-                  pmdc->DrawText(msg, vp->pix_width/2 - w/2, vp->pix_height/2);
+      if(j0 < 0)
+      {
+            for(int c = 0 ; c < ncols ; c++)
+                  values[c] = GRIB_NOTDEF;
+            return;
+      }
+
+      double wy = m_wy[row];
 
-                  pmdc->SetFont(sfont);
+      for(int c = 0 ; c < ncols ; c++)
+      {
+            int i0 = m_i0[c];
+            if(i0 < 0)
+            {
+                  values[c] = GRIB_NOTDEF;
+                  continue;
             }
 
-      }
+            double x00 = m_pGR->getValue(i0,   j0);
+            double x10 = m_pGR->getValue(i0+1, j0);
+            double x01 = m_pGR->getValue(i0,   j0+1);
+            double x11 = m_pGR->getValue(i0+1, j0+1);
 
-      return true;
+            if((x00 != GRIB_NOTDEF) && (x10 != GRIB_NOTDEF) && (x01 != GRIB_NOTDEF) && (x11 != GRIB_NOTDEF))
+            {
+                  double wx = m_wx[c];
+                  double x1 = (1.0-wx)*x00 + wx*x10;
+                  double x2 = (1.0-wx)*x01 + wx*x11;
+                  values[c] = (1.0-wy)*x1 + wy*x2;
+            }
+            else
+                  //    Coastal cells: the record interpolates within the valid triangle
+                  values[c] = m_pGR->getInterpolatedValue(m_lons[c], m_lats[row]);
+      }
 }
 
-bool GRIBOverlayFactory::RenderGribSeaTemp(GribRecord *pGR, wxMemoryDC *pmdc, PlugIn_ViewPort *vp)
+static void FillRasterBlock(unsigned char *rgb, unsigned char *alpha, int width, int x, int y, int size,
+                            const unsigned char *colour, unsigned char a)
 {
-//      printf("renderGRIBSeaTemp\n");
-
-      wxPoint porg;
-      GetCanvasPixLL(vp,  &porg, pGR->getLatMax(), pGR->getLonMin());
+      for(int yp=0 ; yp < size ; yp++)
+      {
+            int offset = (y + yp) * width + x;
+            for(int xp=0 ; xp < size ; xp++)
+            {
+                  if(colour)
+                  {
+                        rgb[3*(offset + xp)]     = colour[0];
+                        rgb[3*(offset + xp) + 1] = colour[1];
+                        rgb[3*(offset + xp) + 2] = colour[2];
+                  }
+                  alpha[offset + xp] = a;
+            }
+      }
+}
 
+//    Top left corner and size of the bitmap of a field.  False if it is out of view.
+bool GRIBOverlayFactory::GetRasterExtent(GribRecord *pGR, PlugIn_ViewPort *vp, wxPoint *porg, int *pwidth, int *pheight)
+{
       //    Check two BBoxes....
       //    TODO Make a better Intersect method
       bool bdraw = false;
@@ -1428,226 +1702,184 @@ bool GRIBOverlayFactory::RenderGribSeaTemp(GribRecord *pGR, wxMemoryDC *pmdc, Pl
       if(Intersect(vp, pGR->getLatMin(), pGR->getLatMax(), pGR->getLonMin() - 360., pGR->getLonMax() - 360., 0.) != _OUT)
             bdraw= true;
 
-      if(bdraw)
-      {
-
-      // If needed, create the bitmap
-            if(m_pbm_seatemp == NULL)
-            {
-                  wxPoint pmin;
-                  GetCanvasPixLL(vp,  &pmin, pGR->getLatMin(), pGR->getLonMin());
-                  wxPoint pmax;
-                  GetCanvasPixLL(vp,  &pmax, pGR->getLatMax(), pGR->getLonMax());
-
-                  int width = abs(pmax.x - pmin.x);
-                  int height = abs(pmax.y - pmin.y);
-
-
-                  //    Dont try to create enormous GRIB bitmaps
-                  if((width < 2000)  && (height < 2000))
-                  {
-                        //    This could take a while....
-                              ::wxBeginBusyCursor();
+      if(!bdraw)
+            return false;
 
-                              wxImage gr_image(width, height);
-                              gr_image.InitAlpha();
+      GetCanvasPixLL(vp,  porg, pGR->getLatMax(), pGR->getLonMin());
 
-                              int grib_pixel_size = 4;
+      wxPoint pmin;
+      GetCanvasPixLL(vp,  &pmin, pGR->getLatMin(), pGR->getLonMin());
+      wxPoint pmax;
+      GetCanvasPixLL(vp,  &pmax, pGR->getLatMax(), pGR->getLonMax());
 
-                              wxPoint p;
-                              for(int ipix = 0 ; ipix < (width-grib_pixel_size + 1) ; ipix += grib_pixel_size)
-                              {
-                                    for(int jpix = 0 ; jpix < (height-grib_pixel_size + 1) ; jpix += grib_pixel_size)
-                                    {
-                                          double lat, lon;
-                                          p.x = ipix + porg.x;
-                                          p.y = jpix + porg.y;
-                                          GetCanvasLLPix( vp, p, &lat, &lon);
-
-                                          double  vh = pGR->getInterpolatedValue(lon, lat);
-
-                                          if (vh != GRIB_NOTDEF)
-                                          {
-                                                wxColour c = GetSeaTempGraphicColor(vh, 12.);
-                                                unsigned char r = c.Red();
-                                                unsigned char g = c.Green();
-                                                unsigned char b = c.Blue();
-
-                                                for(int xp=0 ; xp < grib_pixel_size ; xp++)
-                                                      for(int yp=0 ; yp < grib_pixel_size ; yp++)
-                                                {
-                                                      gr_image.SetRGB(ipix + xp, jpix + yp, r,g,b);
-                                                      gr_image.SetAlpha(ipix + xp, jpix + yp, 128);
-
-                                                }
-                                          }
-                                          else
-                                          {
-                                                for(int xp=0 ; xp < grib_pixel_size ; xp++)
-                                                      for(int yp=0 ; yp < grib_pixel_size ; yp++)
-                                                {
-//                                                       gr_image.SetRGB(ipix + xp, jpix + yp, 0,0,0);
-                                                      gr_image.SetAlpha(ipix + xp, jpix + yp, 0);
-
-                                                }
-                                          }
-                                    }
-                              }
+      *pwidth = abs(pmax.x - pmin.x);
+      *pheight = abs(pmax.y - pmin.y);
 
-                              wxImage bl_image = (gr_image.Blur(4));
+      return true;
+}
 
-                        //    Create a Bitmap
-                              m_pbm_seatemp = new wxBitmap(bl_image);
-                              wxMask *gr_mask = new wxMask(*m_pbm_seatemp, wxColour(0,0,0));
-                              m_pbm_seatemp->SetMask(gr_mask);
+wxBitmap *GRIBOverlayFactory::CreateRasterBitmap(int type, GribRecord *pGR, GribRecord *pGR2, PlugIn_ViewPort *vp,
+                                                 wxPoint porg, int width, int height)
+{
+      //    This could take a while....
+      ::wxBeginBusyCursor();
 
-                              ::wxEndBusyCursor();
+      if(!m_bRasterLUT[type])
+            BuildRasterLUT(type);
 
-                  }
-            }
+      wxImage bl_image = CreateRasterImage(type, pGR, pGR2, vp, porg, width, height);
 
+      //    Create a Bitmap
+      wxBitmap *pbm = new wxBitmap(bl_image);
+      wxMask *gr_mask = new wxMask(*pbm, wxColour(0,0,0));
+      pbm->SetMask(gr_mask);
 
-            if(m_pbm_seatemp)
-            {
-                  pmdc->DrawBitmap(*m_pbm_seatemp, porg.x, porg.y, true);
-            }
-            else
-            {
-                  wxFont sfont = pmdc->GetFont();
-                  wxFont mfont(15, wxFONTFAMILY_DEFAULT, wxFONTSTYLE_ITALIC, wxFONTWEIGHT_NORMAL);
-                  pmdc->SetFont(mfont);
+      ::wxEndBusyCursor();
 
-                  wxString msg = _("Please Zoom or Scale Out to view suppressed SEATEMP GRIB");
-                  int w;
-                  pmdc->GetTextExtent(msg, &w, NULL);
-                  pmdc->DrawText(msg, vp->pix_width/2 - w/2, vp->pix_height/2);
+      return pbm;
+}
 
-                  pmdc->SetFont(sfont);
-            }
+//    The blurred field image.  No GUI calls, so the animation worker uses it too,
+//    once the colour table of the type is built.
+wxImage GRIBOverlayFactory::CreateRasterImage(int type, GribRecord *pGR, GribRecord *pGR2, PlugIn_ViewPort *vp,
+                                              wxPoint porg, int width, int height)
+{
+      const unsigned char *lut = m_RasterLUT[type];
 
-      }
+      unsigned char alpha = (type == GRIB_RASTER_CURRENT) ? 220 : 128;
 
+      //    CRAIN historically marks the points without data
+      unsigned char crain_rgb[3] = { (unsigned char)((unsigned char)GRIB_NOTDEF * 255), 0, 0 };
 
-      return true;
-}
+      wxImage gr_image(width, height);
+      gr_image.InitAlpha();
+      unsigned char *rgb_data = gr_image.GetData();
+      unsigned char *alpha_data = gr_image.GetAlpha();
 
+      int grib_pixel_size = 4;
 
-bool GRIBOverlayFactory::RenderGribCurrent(GribRecord *pGRX, GribRecord *pGRY, wxMemoryDC *pmdc, PlugIn_ViewPort *vp)
-{
-//      printf("renderGRIBCurrent\n");
+      int ncols = (width >= grib_pixel_size) ? (width - grib_pixel_size) / grib_pixel_size + 1 : 0;
+      int nrows = (ncols && (height >= grib_pixel_size)) ? (height - grib_pixel_size) / grib_pixel_size + 1 : 0;
 
+      //    Position of the top left pixel of each block
+      std::vector<double> lons(ncols), lats(nrows);
+      double lat, lon;
+      for(int c = 0 ; c < ncols ; c++)
+      {
+            GetCanvasLLPix( vp, wxPoint(porg.x + c * grib_pixel_size, porg.y), &lat, &lon);
+            lons[c] = lon;
+      }
+      for(int r = 0 ; r < nrows ; r++)
+      {
+            GetCanvasLLPix( vp, wxPoint(porg.x, porg.y + r * grib_pixel_size), &lat, &lon);
+            lats[r] = lat;
+      }
 
-      wxPoint porg;
-      GetCanvasPixLL(vp,  &porg, pGRX->getLatMax(), pGRX->getLonMin());
+      GribRasterGrid grid(pGR, lons, lats);
+      GribRasterGrid *pgrid2 = pGR2 ? new GribRasterGrid(pGR2, lons, lats) : NULL;
 
-      //    Check two BBoxes....
-      //    TODO Make a better Intersect method
-      bool bdraw = false;
-      if(Intersect(vp, pGRX->getLatMin(), pGRX->getLatMax(), pGRX->getLonMin(), pGRX->getLonMax(), 0.) != _OUT)
-            bdraw= true;
-      if(Intersect(vp, pGRX->getLatMin(), pGRX->getLatMax(), pGRX->getLonMin() - 360., pGRX->getLonMax() - 360., 0.) != _OUT)
-            bdraw= true;
+      std::vector<double> row(ncols), row2(ncols);
 
-      if(bdraw)
+      for(int r = 0 ; r < nrows ; r++)
       {
+            grid.InterpolateRow(r, &row[0]);
+            if(pgrid2)
+                  pgrid2->InterpolateRow(r, &row2[0]);
 
-      // If needed, create the bitmap
-            if(m_pbm_current == NULL)
+            for(int c = 0 ; c < ncols ; c++)
             {
-                  wxPoint pmin;
-                  GetCanvasPixLL(vp,  &pmin, pGRX->getLatMin(), pGRX->getLonMin());
-                  wxPoint pmax;
-                  GetCanvasPixLL(vp,  &pmax, pGRX->getLatMax(), pGRX->getLonMax());
-
-                  int width = abs(pmax.x - pmin.x);
-                  int height = abs(pmax.y - pmin.y);
+                  double vh = row[c];
 
-
-                  //    Dont try to create enormous GRIB bitmaps
-                  if((width < 2000)  && (height < 2000))
+                  //    Position of the value on the colour scale, < 0 if not shown
+                  double val = -1.;
+                  switch(type)
                   {
-                        //    This could take a while....
-                              ::wxBeginBusyCursor();
-
-                              wxImage gr_image(width, height);
-                              gr_image.InitAlpha();
-
-                              int grib_pixel_size = 4;
+                        case GRIB_RASTER_SIGWH:
+                              if((vh != GRIB_NOTDEF) && (vh > 0.))
+                                    val = vh;
+                              break;
 
-                              wxPoint p;
-                              for(int ipix = 0 ; ipix < (width-grib_pixel_size + 1) ; ipix += grib_pixel_size)
+                        case GRIB_RASTER_SEATEMP:
+                              if(vh != GRIB_NOTDEF)
                               {
-                                    for(int jpix = 0 ; jpix < (height-grib_pixel_size + 1) ; jpix += grib_pixel_size)
-                                    {
-                                          double lat, lon;
-                                          p.x = ipix + porg.x;
-                                          p.y = jpix + porg.y;
-                                          GetCanvasLLPix( vp, p, &lat, &lon);
-
-                                          double vx = pGRX->getInterpolatedValue(lon, lat);
-                                          double vy = pGRY->getInterpolatedValue(lon, lat);
-
-                                          if ((vx != GRIB_NOTDEF) && (vy != GRIB_NOTDEF))
-                                          {
-                                                double  vkn = sqrt(vx*vx+vy*vy)*3.6/1.852;
-                                                wxColour c = GetSeaCurrentGraphicColor(vkn);
-                                                unsigned char r = c.Red();
-                                                unsigned char g = c.Green();
-                                                unsigned char b = c.Blue();
-
-                                                for(int xp=0 ; xp < grib_pixel_size ; xp++)
-                                                      for(int yp=0 ; yp < grib_pixel_size ; yp++)
-                                                {
-                                                      gr_image.SetRGB(ipix + xp, jpix + yp, r,g,b);
-                                                      gr_image.SetAlpha(ipix + xp, jpix + yp, 220);
-
-                                                }
-                                          }
-                                          else
-                                          {
-                                                for(int xp=0 ; xp < grib_pixel_size ; xp++)
-                                                      for(int yp=0 ; yp < grib_pixel_size ; yp++)
-                                                {
-                                                      gr_image.SetAlpha(ipix + xp, jpix + yp, 0);
-                                                }
-                                          }
-                                    }
+                                    val = (vh - 273. - 15.) * 50. / 15.;
+                                    if(!(val > 0.))
+                                          val = 0.;
                               }
+                              break;
 
-                              wxImage bl_image = (gr_image.Blur(4));
-
-                        //    Create a Bitmap
-                              m_pbm_current = new wxBitmap(bl_image);
-                              wxMask *gr_mask = new wxMask(*m_pbm_current, wxColour(0,0,0));
-                              m_pbm_current->SetMask(gr_mask);
+                        case GRIB_RASTER_CURRENT:
+                              if((vh != GRIB_NOTDEF) && (row2[c] != GRIB_NOTDEF))
+                              {
+                                    double  vkn = sqrt(vh*vh+row2[c]*row2[c])*3.6/1.852;
+                                    val = vkn * 50. / 2.;
+                                    if(!(val > 0.))
+                                          val = 0.;
+                              }
+                              break;
 
-                              ::wxEndBusyCursor();
+                        case GRIB_RASTER_CRAIN:
+                              if(vh == GRIB_NOTDEF)
+                                    FillRasterBlock(rgb_data, alpha_data, width, c * grib_pixel_size, r * grib_pixel_size,
+                                                    grib_pixel_size, crain_rgb, alpha);
+                              else
+                                    FillRasterBlock(rgb_data, alpha_data, width, c * grib_pixel_size, r * grib_pixel_size,
+                                                    grib_pixel_size, NULL, 0);
+                              continue;
+                  }
 
+                  if(val >= 0.)
+                  {
+                        int index = (int)wxMin(val * RASTER_LUT_STEPS, (double)(RASTER_LUT_SIZE - 1));
+                        FillRasterBlock(rgb_data, alpha_data, width, c * grib_pixel_size, r * grib_pixel_size,
+                                        grib_pixel_size, &lut[3 * index], alpha);
                   }
+                  else
+                        FillRasterBlock(rgb_data, alpha_data, width, c * grib_pixel_size, r * grib_pixel_size,
+                                        grib_pixel_size, NULL, 0);
             }
+      }
 
+      delete pgrid2;
 
-            if(m_pbm_current)
-            {
-                  pmdc->DrawBitmap(*m_pbm_current, porg.x, porg.y, true);
-            }
-            else
-            {
-                  wxFont sfont = pmdc->GetFont();
-                  wxFont mfont(15, wxFONTFAMILY_DEFAULT, wxFONTSTYLE_ITALIC, wxFONTWEIGHT_NORMAL);
-                  pmdc->SetFont(mfont);
+      return gr_image.Blur(4);
+}
+
+void GRIBOverlayFactory::BuildRasterLUTs()
+{
+      for(int i = 0 ; i < GRIB_RASTER_NTYPES ; i++)
+            if(!m_bRasterLUT[i])
+                  BuildRasterLUT(i);
+}
 
-                  wxString msg = _("Please Zoom or Scale Out to view suppressed OCEAN CURRENT GRIB");
-                  int w;
-                  pmdc->GetTextExtent(msg, &w, NULL);
-                  pmdc->DrawText(msg, vp->pix_width/2 - w/2, vp->pix_height/2);
+//    Colours of the raster types, sampled in the middle of each step of the colour scale.
+//    The NOAA WW3 bands all start on whole units, so a step never straddles two colours.
+void GRIBOverlayFactory::BuildRasterLUT(int type)
+{
+      for(int i = 0 ; i < RASTER_LUT_SIZE ; i++)
+      {
+            double val = (i + 0.5) / RASTER_LUT_STEPS;
 
-                  pmdc->SetFont(sfont);
+            wxColour c;
+            switch(type)
+            {
+                  case GRIB_RASTER_SEATEMP:
+                        c = GetSeaTempGraphicColor(val * 15. / 50. + 273. + 15., 12.);
+                        break;
+                  case GRIB_RASTER_CURRENT:
+                        c = GetSeaCurrentGraphicColor(val * 2. / 50.);
+                        break;
+                  default:
+                        c = GetGraphicColor(val, 12.);
+                        break;
             }
 
+            m_RasterLUT[type][3*i]     = c.Red();
+            m_RasterLUT[type][3*i + 1] = c.Green();
+            m_RasterLUT[type][3*i + 2] = c.Blue();
       }
 
-      return true;
+      m_bRasterLUT[type] = true;
 }
 
 
@@ -1788,36 +2020,60 @@ wxColour GRIBOverlayFactory::GetSeaCurrentGraphicColor(double val_in)
 
 bool GRIBOverlayFactory::RenderGribPressure(GribRecord *pGR, wxMemoryDC *pmdc, PlugIn_ViewPort *vp)
 {
-#if 0
-      //    Initialize the array of Isobars if necessary
-      if(!m_IsobarArray.GetCount())
+      IsoLineSet *pIsobars = GetIsobars(pGR);
+      if(!pIsobars)
+            return false;
+
+      int gr = 80;
+      wxColour colour(gr,gr,gr);
+      wxPen pen(colour, 2);
+      pmdc->SetPen(pen);
+      pmdc->SetTextForeground(colour);
+
+      int n_points_max = 0;
+      wxPoint *pPoints = NULL;
+
+      for(int k = 0 ; k < pIsobars->getNbLevels() ; k++)
       {
-            IsoLine *piso;
-            for (double press=840; press<1120; press += 2/*isobarsStep*/)
+            const IsoLineLevel &lev = pIsobars->getLevel(k);
+
+            for(int c = 0 ; c < lev.getNbChains() ; c++)
             {
-                  piso = new IsoLine(press*100, pGR);
-                  m_IsobarArray.Add(piso);
-            }
-      }
+                  int np = lev.getChainSize(c);
+                  if(np < 2)
+                        continue;
 
-      //    Draw the Isobars
-      for(unsigned int i = 0 ; i < m_IsobarArray.GetCount() ; i++)
-      {
-            IsoLine *piso = (IsoLine *)m_IsobarArray.Item(i);
-            piso->drawIsoLine(pmdc, vp, true, g_bGRIBUseHiDef);
+                  //    Skip chains entirely off screen, on either side of the date line
+                  const double *box = lev.getChainBox(c);
+                  if((Intersect(vp, box[1], box[3], box[0], box[2], 0.) == _OUT) &&
+                      (Intersect(vp, box[1], box[3], box[0] - 360., box[2] - 360., 0.) == _OUT))
+                        continue;
 
-            /*
-            int gr = 80;
-            wxColour color = wxColour(gr,gr,gr);
-            int density = 40;
-            int first = 0;
+                  if(np > n_points_max)
+                  {
+                        delete[] pPoints;
+                        n_points_max = np;
+                        pPoints = new wxPoint[n_points_max];
+                  }
+
+                  const double *pp = lev.getChainPoints(c);
+                  for(int ip = 0 ; ip < np ; ip++)
+                        GetCanvasPixLL(vp, &pPoints[ip], pp[2*ip+1], pp[2*ip]);
 
-            double coef = .01;
-            piso->drawIsoLineLabels(pmdc, color, vp, density, first, coef);
-            */
+                  pmdc->DrawLines(np, pPoints);
 
+                  //    Label the middle of the longer chains, in hPa
+                  if(np > 16)
+                  {
+                        wxString label;
+                        label.Printf(_T("%d"), (int)(lev.value*.01+0.5));
+                        pmdc->DrawText(label, pPoints[np/2].x, pPoints[np/2].y);
+                  }
+            }
       }
-#endif
+
+      delete[] pPoints;
+
       return true;
 }
 
@@ -2053,6 +2309,8 @@ void GribRecordTree::OnItemSelectChange ( wxTreeEvent& event )
       if ( !pdata )
             return;
 
+      m_parent->StopAnimation(false);
+
       switch ( pdata->m_type )
       {
             case GRIB_FILE_TYPE:
@@ -2077,11 +2335,15 @@ void GribRecordTree::OnItemSelectChange ( wxTreeEvent& event )
                               }
                         }
                   }
+                  m_parent->SetCurrentGribFile ( pdata->m_pGribFile );
                   break;
             }
 
             case GRIB_RECORD_SET_TYPE:
             {
+                  GribTreeItemData *pfile_data = ( GribTreeItemData * ) GetItemData ( GetItemParent ( event.GetItem() ) );
+                  m_parent->SetCurrentGribFile ( pfile_data ? pfile_data->m_pGribFile : NULL );
+
                   m_parent->SetGribRecordSet ( pdata->m_pGribRecordSet );
                   break;
             }
@@ -2113,6 +2375,8 @@ GribTreeItemData::~GribTreeItemData ()
 GRIBFile::GRIBFile ( const wxString file_name )
 {
       m_bOK = true;           // Assume ok until proven otherwise
+      m_FileName = file_name;
+      m_pGribReader = NULL;
 
       if ( !::wxFileExists ( file_name ) )
       {
@@ -2180,6 +2444,395 @@ GRIBFile::~GRIBFile ()
 }
 
 
+//----------------------------------------------------------------------------------------------------------
+//          GRIB Animation Implementation
+//----------------------------------------------------------------------------------------------------------
+
+GribAnimationFrame::~GribAnimationFrame()
+{
+      //    The isobars refer to the records
+      std::map<const GribRecord *, IsoLineSet *>::iterator it;
+      for(it = m_Isobars.begin() ; it != m_Isobars.end() ; it++)
+            delete it->second;
+
+      for ( unsigned int i=0 ; i < m_RecordSet.m_GribRecordPtrArray.GetCount() ; i++ )
+            delete m_RecordSet.m_GribRecordPtrArray.Item ( i );
+}
+
+class GribAnimationThread: public wxThread
+{
+public:
+      GribAnimationThread(GribAnimator *panimator)
+            : wxThread(wxTHREAD_JOINABLE)
+      {
+            m_panimator = panimator;
+      }
+
+      void *Entry()
+      {
+            m_panimator->BuildFrames();
+            return 0;
+      }
+
+private:
+      GribAnimator      *m_panimator;
+};
+
+GribAnimator::GribAnimator()
+{
+      m_pfactory = NULL;
+      m_first_time = 0;
+      m_step = 1;
+      m_pFile = NULL;
+      m_first_set = 0;
+      m_next_set = 0;
+      m_paired_set = -1;
+      m_next_time = 0;
+      m_pthread = NULL;
+      m_bstop = false;
+      m_bfailed = false;
+      m_view.m_bvp = false;
+      m_view.m_ben_Pressure = false;
+      m_view.m_ben_SigHw = false;
+      m_view.m_ben_Seatmp = false;
+      m_view.m_ben_SeaCurrent = false;
+      m_ring_bytes = 0;
+
+      m_nshown = 0;
+      m_nstalls = 0;
+      m_peak_bytes = 0;
+}
+
+GribAnimator::~GribAnimator()
+{
+      Stop();
+}
+
+void GribAnimator::Start(const wxString &file_name, time_t first_time, int step_seconds,
+                         GRIBOverlayFactory *pfactory, const GribAnimationView &view)
+{
+      Stop();
+
+      m_pfactory = pfactory;
+      m_view = view;
+      m_file_name = file_name;
+      m_first_time = first_time;
+      m_step = wxMax(step_seconds, 1);
+
+      m_bstop = false;
+      m_bfailed = false;
+      m_nshown = 0;
+      m_nstalls = 0;
+      m_peak_bytes = 0;
+      m_watch.Start();
+
+      //    Without a worker, TakeFrame() builds the frames itself
+      m_pthread = new GribAnimationThread(this);
+      if((m_pthread->Create() != wxTHREAD_NO_ERROR) || (m_pthread->Run() != wxTHREAD_NO_ERROR))
+      {
+            delete m_pthread;
+            m_pthread = NULL;
+      }
+}
+
+void GribAnimator::Stop()
+{
+      if(m_pthread)
+      {
+            {
+                  wxMutexLocker lock(m_mutex);
+                  m_bstop = true;
+            }
+            m_semaphore.Post();
+            m_pthread->Wait();
+            delete m_pthread;
+            m_pthread = NULL;
+      }
+
+      std::list<GribAnimationFrame *>::iterator itf;
+      for(itf = m_ring.begin() ; itf != m_ring.end() ; itf++)
+            delete *itf;
+      m_ring.clear();
+      m_ring_bytes = 0;
+
+      m_Before.Clear();
+      m_After.Clear();
+      delete m_pFile;
+      m_pFile = NULL;
+
+      if(m_pfactory && m_nshown)
+      {
+            wxString msg(_T("GRIB animation: "));
+            msg.Append(GetStatusText());
+            msg.Append(wxString::Format(_T(", %d stalls, %.1f MB peak"), m_nstalls, m_peak_bytes / (1024. * 1024.)));
+            wxLogMessage(msg);
+      }
+
+      m_pfactory = NULL;
+}
+
+void GribAnimator::SetView(const GribAnimationView &view)
+{
+      wxMutexLocker lock(m_mutex);
+      m_view = view;
+}
+
+bool GribAnimator::IsRingFull()
+{
+      //    m_mutex is held by the caller
+      if(m_ring.empty())
+            return false;
+      return ((int)m_ring.size() >= ANIMATION_RING_FRAMES) || (m_ring_bytes >= ANIMATION_RING_BYTES);
+}
+
+//    Read the file again, for the frame builder alone, and find the first frame
+bool GribAnimator::OpenFile()
+{
+      m_pFile = new GRIBFile(m_file_name);
+
+      ArrayOfGribRecordSets *rsa = m_pFile->GetRecordSetArrayPtr();
+      int n_sets = rsa->GetCount();
+      if(!m_pFile->IsOK() || (n_sets < 2))
+      {
+            delete m_pFile;
+            m_pFile = NULL;
+            return false;
+      }
+
+      m_first_set = 0;
+      for(int i = 0 ; i < n_sets ; i++)
+            if(rsa->Item(i).m_Reference_Time == m_first_time)
+                  m_first_set = i;
+      if(m_first_set + 1 >= n_sets)
+            m_first_set = 0;                        // the last forecast, start from the beginning
+
+      m_next_set = m_first_set;
+      m_next_time = rsa->Item(m_first_set).m_Reference_Time;
+      m_paired_set = -1;
+
+      return true;
+}
+
+//    Worker thread body
+void GribAnimator::BuildFrames()
+{
+      for(;;)
+      {
+            int result = BuildNextFrame();
+            if(result < 0)
+                  break;
+            if(result == 0)
+                  m_semaphore.Wait();             // for room in the ring, or stop
+      }
+}
+
+//    Interpolate the next frame, with its isobars and field images, into the ring.
+//    Returns 1 if a frame was added, 0 if there is nothing to do now, -1 when stopping.
+int GribAnimator::BuildNextFrame()
+{
+      GribAnimationView view;
+      {
+            wxMutexLocker lock(m_mutex);
+            if(m_bstop)
+                  return -1;
+            if(m_bfailed || IsRingFull())
+                  return 0;
+            view = m_view;
+      }
+
+      if(!m_pFile && !OpenFile())
+      {
+            wxMutexLocker lock(m_mutex);
+            m_bfailed = true;
+            return 0;
+      }
+
+      ArrayOfGribRecordSets *rsa = m_pFile->GetRecordSetArrayPtr();
+      int n_sets = rsa->GetCount();
+
+      //    The interval of the next frame: [t1, t2), and t2 too at the end of the file,
+      //    after which the animation loops
+      for(;;)
+      {
+            bool b_last = (m_next_set + 2 == n_sets);
+            time_t t2 = rsa->Item(m_next_set + 1).m_Reference_Time;
+            if((m_next_time < t2) || (b_last && (m_next_time == t2)))
+                  break;
+
+            if(b_last)
+            {
+                  m_next_set = m_first_set;
+                  m_next_time = rsa->Item(m_first_set).m_Reference_Time;
+            }
+            else
+                  m_next_set++;
+      }
+
+      if(m_paired_set != m_next_set)
+      {
+            //    Only data present at both ends can be interpolated
+            GribRecordSet &before = rsa->Item(m_next_set);
+            GribRecordSet &after = rsa->Item(m_next_set + 1);
+
+            m_Before.Clear();
+            m_After.Clear();
+            for ( unsigned int i=0 ; i < before.m_GribRecordPtrArray.GetCount() ; i++ )
+            {
+                  GribRecord *pGR1 = before.m_GribRecordPtrArray.Item ( i );
+                  for ( unsigned int j=0 ; j < after.m_GribRecordPtrArray.GetCount() ; j++ )
+                  {
+                        GribRecord *pGR2 = after.m_GribRecordPtrArray.Item ( j );
+                        if(pGR2->getKey() == pGR1->getKey())
+                        {
+                              m_Before.Add(pGR1);
+                              m_After.Add(pGR2);
+                              break;
+                        }
+                  }
+            }
+            m_paired_set = m_next_set;
+      }
+
+      time_t t = m_next_time;
+      m_next_time += m_step;
+
+      GribAnimationFrame *pframe = new GribAnimationFrame;
+      pframe->m_RecordSet.m_Reference_Time = t;
+      pframe->m_nbytes = 0;
+
+      for ( unsigned int i=0 ; i < m_Before.GetCount() ; i++ )
+      {
+            GribRecord *pGR = new GribRecord(*m_Before.Item ( i ), *m_After.Item ( i ), t);
+            pframe->m_RecordSet.m_GribRecordPtrArray.Add ( pGR );
+            pframe->m_nbytes += pGR->getDataSize();
+      }
+
+      PrepareFrame(pframe, view);
+
+      wxMutexLocker lock(m_mutex);
+
+      m_ring.push_back(pframe);
+      m_ring_bytes += pframe->m_nbytes;
+      m_peak_bytes = wxMax(m_peak_bytes, m_ring_bytes);
+
+      return 1;
+}
+
+//    Build what the overlay factory would build on the main thread to render the frame
+void GribAnimator::PrepareFrame(GribAnimationFrame *pframe, GribAnimationView &view)
+{
+      GribRecord *pGRCurrentVX = NULL;
+      GribRecord *pGRCurrentVY = NULL;
+
+      for ( unsigned int i=0 ; i < pframe->m_RecordSet.m_GribRecordPtrArray.GetCount() ; i++ )
+      {
+            GribRecord *pGR = pframe->m_RecordSet.m_GribRecordPtrArray.Item ( i );
+
+            if ( view.m_ben_Pressure && (pGR->getDataType()==GRB_PRESSURE ))
+            {
+                  IsoLineSet *pset = NewIsobars(pGR);
+                  pframe->m_Isobars[pGR] = pset;
+
+                  for(int k = 0 ; k < pset->getNbLevels() ; k++)
+                        pframe->m_nbytes += pset->getLevel(k).points.size() * sizeof(double);
+            }
+
+            //    The fields are drawn to the scale of the view
+            if(!view.m_bvp)
+                  continue;
+
+            if ( view.m_ben_SigHw && (pGR->getDataType()==GRB_HTSGW ))
+                  PrepareRaster(pframe, &view.m_vp, GRIB_RASTER_SIGWH, pGR, NULL);
+
+            if ( view.m_ben_Seatmp && (pGR->getDataType()==GRB_WTMP ))
+                  PrepareRaster(pframe, &view.m_vp, GRIB_RASTER_SEATEMP, pGR, NULL);
+
+            if ( view.m_ben_SeaCurrent && (pGR->getDataType()==GRB_UOGRD ))
+                  pGRCurrentVX = pGR;
+            if ( view.m_ben_SeaCurrent && (pGR->getDataType()==GRB_VOGRD ))
+                  pGRCurrentVY = pGR;
+      }
+
+      if(pGRCurrentVX && pGRCurrentVY)
+            PrepareRaster(pframe, &view.m_vp, GRIB_RASTER_CURRENT, pGRCurrentVX, pGRCurrentVY);
+}
+
+void GribAnimator::PrepareRaster(GribAnimationFrame *pframe, PlugIn_ViewPort *vp, int type,
+                                 GribRecord *pGR, GribRecord *pGR2)
+{
+      wxPoint porg;
+      int width, height;
+      if(!GRIBOverlayFactory::GetRasterExtent(pGR, vp, &porg, &width, &height))
+            return;
+      if((width >= RASTER_MAX_SIZE) || (height >= RASTER_MAX_SIZE))
+            return;
+
+      GribAnimationRaster raster;
+      raster.m_pGR = pGR;
+      raster.m_pGR2 = pGR2;
+      raster.m_type = type;
+      raster.m_scale_ppm = vp->view_scale_ppm;
+      raster.m_projection = vp->m_projection_type;
+      raster.m_image = m_pfactory->CreateRasterImage(type, pGR, pGR2, vp, porg, width, height);
+
+      pframe->m_Rasters.push_back(raster);
+      pframe->m_nbytes += (size_t)width * height * 4;
+}
+
+//    Playback: the next frame in time order, which now belongs to the caller
+GribAnimationFrame *GribAnimator::TakeFrame()
+{
+      if(!m_pfactory)
+            return NULL;
+
+      if(!m_pthread)
+            BuildNextFrame();
+
+      GribAnimationFrame *pframe = NULL;
+      {
+            wxMutexLocker lock(m_mutex);
+            if(!m_ring.empty())
+            {
+                  pframe = m_ring.front();
+                  m_ring.pop_front();
+                  m_ring_bytes -= pframe->m_nbytes;
+            }
+      }
+
+      if(pframe)
+      {
+            m_nshown++;
+            m_semaphore.Post();                 // there is room in the ring again
+      }
+      else
+            m_nstalls++;
+
+      return pframe;
+}
+
+wxString GribAnimator::GetStatusText()
+{
+      int n_ready;
+      size_t ring_bytes;
+      bool bfailed;
+      {
+            wxMutexLocker lock(m_mutex);
+            n_ready = m_ring.size();
+            ring_bytes = m_ring_bytes;
+            bfailed = m_bfailed;
+      }
+
+      if(bfailed)
+            return _("The GRIB file could not be read again");
+
+      double seconds = m_watch.Time() / 1000.;
+      double fps = (seconds > 0.) ? m_nshown / seconds : 0.;
+
+      return wxString::Format(_("%.1f frames/s, %d frames ready, %.1f MB"),
+                              fps, n_ready, ring_bytes / (1024. * 1024.));
+}
+
+
 // Calculates if two boxes intersect. If so, the function returns _ON.
 // If they do not intersect, two scenario's are possible:
 // other is outside this -> return _OUT
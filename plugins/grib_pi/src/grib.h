@@ -39,15 +39,32 @@
 #include <wx/treectrl.h>
 #include <wx/fileconf.h>
 #include <wx/notebook.h>
+#include <wx/thread.h>
 
 
 #include "GribReader.h"
 #include "GribRecord.h"
 #include "IsoLine.h"
 
+#include <map>
+#include <list>
+
 #define ID_OK                       10001
 #define ID_GRIBRECORDREECTRL        10002
 #define ID_CHOOSEGRIBDIR            10003
+#define ID_ANIMATE                  10004
+#define ID_ANIMATIONSTEP            10005
+#define ID_ANIMATIONTIMER           10006
+
+#define ISOBAR_CACHE_SIZE           48          // GribRecords whose isobars are kept
+#define RASTER_CACHE_PIXELS         (12*1024*1024)    // total size of the cached field bitmaps
+#define RASTER_LUT_SIZE             256         // colour steps of a field colour table
+#define RASTER_LUT_STEPS            4           // colour steps per unit of the colour scale
+#define RASTER_MAX_SIZE             2000        // widest or tallest field bitmap, in pixels
+
+#define ANIMATION_FRAME_MS          100         // playback period
+#define ANIMATION_RING_FRAMES       32          // interpolated frames kept ready ahead of playback
+#define ANIMATION_RING_BYTES        (128*1024*1024)   // ...and their grids and images, at most
 
 #ifndef PI
 #define PI        3.1415926535897931160E0      /* pi */
@@ -65,6 +82,16 @@ enum {
 
 enum OVERLAP {_IN,_ON,_OUT};
 
+//    Fields rendered as a coloured bitmap
+enum GribRasterType
+{
+      GRIB_RASTER_SIGWH,
+      GRIB_RASTER_CRAIN,
+      GRIB_RASTER_SEATEMP,
+      GRIB_RASTER_CURRENT,
+      GRIB_RASTER_NTYPES
+};
+
 class GRIBFile;
 class GRIBRecord;
 class GribRecordTree;
@@ -83,6 +110,17 @@ OVERLAP Intersect(PlugIn_ViewPort *vp,
 bool PointInLLBox(PlugIn_ViewPort *vp, double x, double y);
 
 
+class GribRasterCacheEntry
+{
+      public:
+            const GribRecord        *m_pGR;
+            const GribRecord        *m_pGR2;          // second component of vector fields, or NULL
+            int                     m_type;
+            double                  m_scale_ppm;
+            int                     m_projection;
+            wxBitmap                *m_pbm;
+};
+
 class GribRecordSet
 {
       public:
@@ -93,6 +131,111 @@ class GribRecordSet
 
 
 
+//----------------------------------------------------------------------------------------------------------
+//    GRIB Animation Specification
+//----------------------------------------------------------------------------------------------------------
+
+//    A field bitmap built ahead for a frame, still as an image: bitmaps can
+//    only be made on the main thread
+class GribAnimationRaster
+{
+      public:
+            const GribRecord        *m_pGR;
+            const GribRecord        *m_pGR2;
+            int                     m_type;
+            double                  m_scale_ppm;
+            int                     m_projection;
+            wxImage                 m_image;
+};
+
+//    One interpolated instant of a GRIB file.  The frame owns its GribRecords,
+//    and the isobars and field images built for them, until they are handed
+//    to the overlay factory.
+class GribAnimationFrame
+{
+      public:
+            ~GribAnimationFrame();
+
+            GribRecordSet           m_RecordSet;
+            std::map<const GribRecord *, IsoLineSet *>      m_Isobars;
+            std::list<GribAnimationRaster>                  m_Rasters;
+            size_t                  m_nbytes;
+};
+
+//    What the overlay shows, so that the frames are prepared to match
+class GribAnimationView
+{
+      public:
+            PlugIn_ViewPort         m_vp;
+            bool                    m_bvp;            // m_vp is that of a rendered overlay
+            bool                    m_ben_Pressure;
+            bool                    m_ben_SigHw;
+            bool                    m_ben_Seatmp;
+            bool                    m_ben_SeaCurrent;
+};
+
+//    Interpolates the frames of a GRIB file at a fixed time step on a worker thread,
+//    into a bounded ring of ready frames.  Playback takes them in time order, and
+//    the animation loops at the end of the file.
+//    The worker reads its own copy of the file, so the records of the dialog, and
+//    the grid cache of their reader, are never touched off the main thread.
+class GribAnimator
+{
+      public:
+            GribAnimator();
+            ~GribAnimator();
+
+            void Start(const wxString &file_name, time_t first_time, int step_seconds,
+                       GRIBOverlayFactory *pfactory, const GribAnimationView &view);
+            void Stop();
+            bool IsRunning(){ return m_pfactory != NULL; }
+            void SetView(const GribAnimationView &view);
+
+            GribAnimationFrame *TakeFrame();          // NULL if the next frame is not ready yet
+            wxString GetStatusText();
+
+            void BuildFrames();                       // worker thread body
+
+      private:
+            int BuildNextFrame();
+            bool OpenFile();
+            void PrepareFrame(GribAnimationFrame *pframe, GribAnimationView &view);
+            void PrepareRaster(GribAnimationFrame *pframe, PlugIn_ViewPort *vp, int type,
+                               GribRecord *pGR, GribRecord *pGR2);
+            bool IsRingFull();
+
+            GRIBOverlayFactory      *m_pfactory;
+            wxString                m_file_name;
+            time_t                  m_first_time;
+            int                     m_step;
+
+            //    Used only by the thread that builds the frames
+            GRIBFile                *m_pFile;
+            int                     m_first_set;
+            int                     m_next_set;       // frames of [m_next_set, m_next_set+1] are next
+            int                     m_paired_set;     // interval of m_Before and m_After
+            time_t                  m_next_time;
+            ArrayOfGribRecordPtrs   m_Before;         // records of the interval present at both ends
+            ArrayOfGribRecordPtrs   m_After;          // same data as m_Before, item by item
+
+            wxThread                *m_pthread;
+            wxMutex                 m_mutex;          // guards everything below
+            wxSemaphore             m_semaphore;      // room in the ring, or stop
+            bool                    m_bstop;
+            bool                    m_bfailed;        // the file could not be read again
+            GribAnimationView       m_view;
+            std::list<GribAnimationFrame *>     m_ring;     // ready frames, oldest first
+            size_t                  m_ring_bytes;
+
+            //    Playback statistics
+            wxStopWatch             m_watch;
+            int                     m_nshown;
+            int                     m_nstalls;
+            size_t                  m_peak_bytes;
+};
+
+
+
 enum GribTreeItemType
 {
       GRIB_FILE_TYPE,
@@ -125,6 +268,9 @@ class GRIBUIDialog: public wxDialog
 
            void SetCursorLatLon(double lat, double lon);
 
+           void SetCurrentGribFile(GRIBFile *pgribfile){ m_pCurrentGribFile = pgribfile; }
+           void StopAnimation(bool b_restore);
+
       private:
             void OnClose(wxCloseEvent& event);
             void OnIdOKClick( wxCommandEvent& event );
@@ -141,6 +287,12 @@ class GRIBUIDialog: public wxDialog
             void OnCBSigHwClick ( wxCommandEvent& event );
             void OnCBSeatempClick ( wxCommandEvent& event );
             void OnCBSeaCurrentClick ( wxCommandEvent& event );
+            void OnAnimateClick ( wxCommandEvent& event );
+            void OnAnimationStepChange ( wxCommandEvent& event );
+            void OnAnimationTimer ( wxTimerEvent& event );
+
+            void StartAnimation(void);
+            int GetAnimationStep(void);
 
 
             //    Data
@@ -176,6 +328,17 @@ class GRIBUIDialog: public wxDialog
 
             int               m_sequence_active;
 
+            GRIBFile          *m_pCurrentGribFile;          // file of the selected record set
+
+            //    Animation
+            GribAnimator      m_Animator;
+            GribAnimationFrame *m_pAnimationFrame;          // frame given to the overlay factory
+            GribRecordSet     *m_pAnimationRestoreSet;      // selection to show again when stopped
+            wxTimer           m_AnimationTimer;
+            wxButton          *m_pAnimateButton;
+            wxChoice          *m_pAnimationStepChoice;
+            wxStaticText      *m_pAnimationStatus;
+
             double            m_cursor_lat, m_cursor_lon;
 
             int               m_RS_Idx_WIND_VX;             // These are indexes into the m_pCurrentGribRecordSet
@@ -203,6 +366,16 @@ class GRIBOverlayFactory
             bool RenderGribOverlay( wxMemoryDC *pmdc, PlugIn_ViewPort *vp );
             bool IsReadyToRender(){ return m_bReadyToRender; }
             void Reset();
+            void ClearRecordCaches();
+            void ForgetRecordSet(GribRecordSet *pGribRecordSet);
+
+            //    Animation
+            GribAnimationView GetAnimationView();
+            void AdoptAnimationFrame(GribAnimationFrame *pframe);
+            void BuildRasterLUTs();
+            static bool GetRasterExtent(GribRecord *pGR, PlugIn_ViewPort *vp, wxPoint *porg, int *pwidth, int *pheight);
+            wxImage CreateRasterImage(int type, GribRecord *pGR, GribRecord *pGR2, PlugIn_ViewPort *vp,
+                                  wxPoint porg, int width, int height);     // any thread, once the LUTs are built
 
             GribRecordSet           *m_pGribRecordSet;
 
@@ -222,6 +395,11 @@ class GRIBOverlayFactory
             bool RenderGribCRAIN(GribRecord *pGR, wxMemoryDC *pmdc, PlugIn_ViewPort *vp);
             bool RenderGribSeaTemp(GribRecord *pGR, wxMemoryDC *pmdc, PlugIn_ViewPort *vp);
             bool RenderGribCurrent(GribRecord *pGRX, GribRecord *pGRY, wxMemoryDC *pmdc, PlugIn_ViewPort *vp);
+            bool RenderGribRaster(int type, GribRecord *pGR, GribRecord *pGR2, wxMemoryDC *pmdc, PlugIn_ViewPort *vp,
+                                  const wxString &msg);
+            wxBitmap *CreateRasterBitmap(int type, GribRecord *pGR, GribRecord *pGR2, PlugIn_ViewPort *vp,
+                                  wxPoint porg, int width, int height);
+            void BuildRasterLUT(int type);
 
             void drawWindArrowWithBarbs(wxMemoryDC *pmdc, int x, int y, double vx, double vy, bool south, wxColour arrowColor);
             void drawWaveArrow(wxMemoryDC *pmdc, int i, int j, double dir, wxColour arrowColor);
@@ -237,15 +415,25 @@ class GRIBOverlayFactory
             wxColour GetSeaCurrentGraphicColor(double val_in);
             wxColour GetSeaTempGraphicColor(double val, double val_max);
 
-            void ClearCachedData(void);
+            void ClearIsobarCache();
+            void ClearRasterCache();
+
+            IsoLineSet *GetIsobars(GribRecord *pGR);
+            void CacheIsobars(const GribRecord *pGR, IsoLineSet *pset);
+            void CacheRaster(const GribRasterCacheEntry &entry);
 
-            double                  m_last_vp_scale;
-            wxArrayPtrVoid          m_IsobarArray;
+            //    Isobars of the most recently shown pressure records, oldest first in the list
+            std::map<const GribRecord *, IsoLineSet *>      m_IsobarCache;
+            std::list<const GribRecord *>                   m_IsobarCacheOrder;
 
-            wxBitmap                *m_pbm_sigwh;
-            wxBitmap                *m_pbm_crain;
-            wxBitmap                *m_pbm_seatemp;
-            wxBitmap                *m_pbm_current;
+            //    Field bitmaps, most recently drawn first.  A bitmap only depends on
+            //    the records, the scale and the projection, so it survives panning.
+            std::list<GribRasterCacheEntry>                 m_RasterCache;
+            long                                            m_RasterCachePixels;
+
+            //    RGB colour tables of the raster types, built on first use
+            unsigned char           m_RasterLUT[GRIB_RASTER_NTYPES][RASTER_LUT_SIZE * 3];
+            bool                    m_bRasterLUT[GRIB_RASTER_NTYPES];
 
 #if wxUSE_GRAPHICS_CONTEXT
             wxGraphicsContext       *m_pgc;
@@ -260,7 +448,8 @@ class GRIBOverlayFactory
 
             bool              m_bReadyToRender;
 
-
+            PlugIn_ViewPort   m_LastViewPort;               // of the last rendered overlay
+            bool              m_bLastViewPort;
 };
 
 
@@ -326,6 +515,7 @@ class GRIBFile
             ~GRIBFile();
 
             bool IsOK(void){ return m_bOK; }
+            wxString GetFileName(void){ return m_FileName; }
             wxString GetLastErrorMessage(void){ return m_last_error_message; }
             ArrayOfGribRecordSets *GetRecordSetArrayPtr(void){ return &m_GribRecordSetArray; }
 
@@ -333,6 +523,7 @@ class GRIBFile
       private:
 
             bool        m_bOK;
+            wxString    m_FileName;
             wxString    m_last_error_message;
             GribReader  *m_pGribReader;
 
@@ -283,7 +283,10 @@ void grib_pi::OnGribDialogClose()
 {
       m_pGribDialog = NULL;
       if(m_pGRIBOverlayFactory)
+      {
             m_pGRIBOverlayFactory->Reset();
+            m_pGRIBOverlayFactory->ClearRecordCaches();
+      }
       SaveConfig();
 }
 
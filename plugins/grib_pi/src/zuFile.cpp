@@ -32,6 +32,29 @@ int    zu_can_read_file(const char *fname)
     }
 }
 
+//----------------------------------------------------
+// Recognise the compression from the first bytes of the file.
+// Returns ZU_COMPRESS_AUTO if the file can't be read.
+int    zu_detect_type(const char *fname)
+{
+    unsigned char sig[3];
+    int nb;
+    FILE *ftmp = fopen(fname, "rb");
+    if (!ftmp) {
+        return ZU_COMPRESS_AUTO;
+    }
+    nb = fread(sig, 1, 3, ftmp);
+    fclose(ftmp);
+
+    if (nb >= 2 && sig[0] == 0x1f && sig[1] == 0x8b) {
+        return ZU_COMPRESS_GZIP;
+    }
+    if (nb == 3 && sig[0] == 'B' && sig[1] == 'Z' && sig[2] == 'h') {
+        return ZU_COMPRESS_BZIP;
+    }
+    return ZU_COMPRESS_NONE;
+}
+
 //----------------------------------------------------
 ZUFILE * zu_open(const char *fname, const char *mode, int type)
 {
@@ -49,6 +72,11 @@ ZUFILE * zu_open(const char *fname, const char *mode, int type)
     f->pos = 0;
     f->fname = strdup(fname);
 
+	if (type == ZU_COMPRESS_AUTO)
+	{
+		type = zu_detect_type(f->fname);
+	}
+
 	if (type == ZU_COMPRESS_AUTO)
 	{
 		char *p = strrchr(f->fname, '.');
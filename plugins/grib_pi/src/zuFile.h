@@ -59,6 +59,8 @@ int    zu_close(ZUFILE *f);
 
 int    zu_can_read_file(const char *fname);
 
+int    zu_detect_type(const char *fname);
+
 int    zu_read(ZUFILE *f, void *buf, long len);
 
 long   zu_tell(ZUFILE *f);
@@ -46,6 +46,8 @@
 #include "wx/datetime.h"
 #include "wx/sound.h"
 #include <wx/wfstream.h>
+#include <wx/file.h>
+#include <wx/stopwatch.h>
 #include <wx/imaglist.h>
 
 #include <stdlib.h>
@@ -355,11 +357,23 @@ DEFINE_EVENT_TYPE(wxEVT_OCPN_AIS)
 OCPN_AISEvent::OCPN_AISEvent( wxEventType commandType, int id )
       :wxEvent(id, commandType)
 {
+      m_pRing = NULL;
 }
 
 
 OCPN_AISEvent::~OCPN_AISEvent( )
 {
+      if(m_pRing)
+            m_pRing->Unref();
+}
+
+void OCPN_AISEvent::SetRing(OCP_SerialRing *pRing)
+{
+      if(pRing)
+            pRing->Ref();
+      if(m_pRing)
+            m_pRing->Unref();
+      m_pRing = pRing;
 }
 
 wxEvent* OCPN_AISEvent::Clone() const
@@ -401,6 +415,7 @@ AIS_Target_Data::AIS_Target_Data()
 
     CPA = 100;                // Large values avoid false alarms
     TCPA = 100;
+    bCPA_Valid = false;
 
     Range_NM = 1.;
     Brg = 0;
@@ -959,12 +974,40 @@ wxString AIS_Target_Data::Get_class_string(bool b_short)
 //---------------------------------------------------------------------------------
 AIS_Bitstring::AIS_Bitstring(const char *str)
 {
-    byte_length = strlen(str);
+    Load(str, strlen(str));
+}
+
+AIS_Bitstring::AIS_Bitstring(const char *str, int len)
+{
+    Load(str, len);
+}
+
+//  Pack the 6 bit symbols into a byte array, MSB first,
+//  so that fields can be extracted a word at a time.
+//  Bits beyond the end of the payload read as zero.
+void AIS_Bitstring::Load(const char *str, int len)
+{
+    byte_length = wxMin(len, AIS_MAX_MESSAGE_LEN);
+
+    memset(bitbytes, 0, sizeof(bitbytes));
+
+    unsigned int acc = 0;
+    int nbits = 0;
+    unsigned char *pd = bitbytes;
 
     for(int i=0 ; i<byte_length ; i++)
     {
-        bitbytes[i] = to_6bit(str[i]);
+        acc = (acc << 6) | (to_6bit(str[i]) & 0x3f);
+        nbits += 6;
+        if(nbits >= 8)
+        {
+            nbits -= 8;
+            *pd++ = (unsigned char)(acc >> nbits);
+        }
     }
+
+    if(nbits)
+        *pd = (unsigned char)(acc << (8 - nbits));
 }
 
 
@@ -993,57 +1036,35 @@ unsigned char AIS_Bitstring::to_6bit(const char c)
 
 int AIS_Bitstring::GetInt(int sp, int len)
 {
-    int acc = 0;
     int s0p = sp-1;                          // to zero base
 
-    int cp, cx, c0, cs;
+    if((s0p < 0) || (len <= 0) || (len > 32) || (s0p / 8 + 8 > AIS_MAX_BITBYTES))
+        return 0;
 
+    //  Load the 64 bits covering the field, then shift it into place
+    const unsigned char *p = &bitbytes[s0p / 8];
+    wxUint64 word = 0;
+    for(int i=0 ; i<8 ; i++)
+        word = (word << 8) | p[i];
 
-    for(int i=0 ; i<len ; i++)
-    {
-        acc  = acc << 1;
-        cp = (s0p + i) / 6;
-        cx = bitbytes[cp];		// what if cp >= byte_length?
-        cs = 5 - ((s0p + i) % 6);
-        c0 = (cx >> (5 - ((s0p + i) % 6))) & 1;
-        acc |= c0;
-    }
-
-    return acc;
+    word <<= (s0p % 8);
 
+    return (int)(word >> (64 - len));
 }
 
 bool AIS_Bitstring::GetStr(int sp, int len, char *dest, int max_len)
 {
     char temp_str[85];
 
-    char acc = 0;
-    int s0p = sp-1;                          // to zero base
-
     int k=0;
-    int cp, cx, c0, cs;
-
-    int i = 0;
-    while(i < len)
+    for(int i=0 ; (i < len) && (k < 84) ; i += 6)
     {
-         acc=0;
-         for(int j=0 ; j<6 ; j++)
-         {
-            acc  = acc << 1;
-            cp = (s0p + i) / 6;
-            cx = bitbytes[cp];		// what if cp >= byte_length?
-            cs = 5 - ((s0p + i) % 6);
-            c0 = (cx >> (5 - ((s0p + i) % 6))) & 1;
-            acc |= c0;
-
-            i++;
-         }
-         temp_str[k] = (char)(acc & 0x3f);
+         char acc = (char)GetInt(sp + i, 6);
+         temp_str[k] = acc;
 
          if(acc < 32)
              temp_str[k] += 0x40;
          k++;
-
     }
 
     temp_str[k] = 0;
@@ -1103,6 +1124,11 @@ AIS_Decoder::AIS_Decoder(int handler_id, wxFrame *pParent, const wxString& AISDa
       m_n_targets = 0;
       m_bno_erase = false;
 
+      accumulator_len = 0;
+
+      m_bGeneralAlert = false;
+      m_pCPAEngine = new AIS_CPA_Engine;
+
       OpenDataSource(pParent, AISDataSource);
 
       //  Create/connect a dynamic event handler slot for OCPN_AISEvent(s) coming from AIS thread
@@ -1112,7 +1138,7 @@ AIS_Decoder::AIS_Decoder(int handler_id, wxFrame *pParent, const wxString& AISDa
 
 AIS_Decoder::~AIS_Decoder(void)
 {
-      if(pAIS_Thread)
+      if(pAIS_Thread || m_breplay)
       {
             wxLogMessage(_T("Stopping AIS Secondary Thread"));
 
@@ -1133,6 +1159,7 @@ AIS_Decoder::~AIS_Decoder(void)
             pAIS_Thread = NULL;
       }
 
+    delete m_pCPAEngine;
 
     AIS_Target_Hash::iterator it;
     AIS_Target_Hash *current_targets = GetTargetList();
@@ -1252,44 +1279,118 @@ void AIS_Decoder::OnEvtAIS(OCPN_AISEvent& event)
 //              wxDateTime now = wxDateTime::Now();
 //              printf("AIS Event at %ld\n", now.GetTicks());
 
-            wxString message = event.GetNMEAString();
+            //  Handle every complete sentence now waiting in the ring
+            OCP_SerialRing *pring = event.GetRing();
+            if(pring)
+                  DrainRxRing(pring);
+            break;
+        }       //case
 
-            int nr = 0;
-            if(!message.IsEmpty())
+        case EVT_AIS_REPLAY_DONE:
+        {
+            OCP_SerialRing *pring = event.GetRing();
+            if(pring)
+                  DrainRxRing(pring);
+
+            long msec = m_replay_sw.Time();
+            wxString msg;
+            msg.Printf(_T("   AIS replay: %d messages decoded, %d errors, %d targets, in %ld msec of decoding (%.0f msg/sec)"),
+                       m_n_replay_msgs, m_n_replay_errors, m_n_targets, msec, (m_n_replay_msgs * 1000.) / wxMax(msec, 1L));
+            wxLogMessage(msg);
+
+            m_breplay = false;
+            break;
+        }
+    }           // switch
+}
+
+//    Decode every complete sentence waiting in the ring, a block at a time
+void AIS_Decoder::DrainRxRing(OCP_SerialRing *pring)
+{
+      char batch[AIS_RX_BATCH_SIZE];
+      int nbatch = 0;
+      int len;
+
+      pring->BeginDrain();
+      while(true)
+      {
+            if(nbatch > AIS_RX_BATCH_SIZE - SERIAL_SENTENCE_MAX)
             {
-                  if(message.Mid(3,3).IsSameAs(_T("VDM")) || message.Mid(3,3).IsSameAs(_T("VDO")))
-                  {
-                        nr = Decode(message);
-                        if(message.Mid(3,3).IsSameAs(_T("VDO")))
-                        {
-                              //    This is an ownship message, presumably from a transponder
-                              //    Simulate an ownship GPS position report upstream
+                  DecodeRxBatch(batch, nbatch);
+                  nbatch = 0;
+            }
 
-                              if(m_pLatestTargetData && (nr == AIS_NoError) && g_bGPSAISMux && m_pLatestTargetData->b_positionValid)
-                              {
-                                    AISPositionData.kLat = m_pLatestTargetData->Lat;
-                                    AISPositionData.kLon = m_pLatestTargetData->Lon;
-                                    AISPositionData.kCog = m_pLatestTargetData->COG;
-                                    AISPositionData.kSog = m_pLatestTargetData->SOG;
-
-//                                    printf("ownship Lat %g\n",AISPositionData.kLat);
-                                    wxCommandEvent event( EVT_NMEA,  m_handler_id );
-                                    event.SetEventObject( (wxObject *)this );
-                                    event.SetExtraLong(EVT_NMEA_DIRECT);
-                                    event.SetClientData(&AISPositionData);
-                                    m_pMainEventHandler->AddPendingEvent(event);
-                              }
-                        }
-                  }
-                  else
+            if((len = pring->GetSentence(batch + nbatch, SERIAL_SENTENCE_MAX)) <= 0)
+                  break;
+            nbatch += len;
+      }
+
+      if(nbatch)
+            DecodeRxBatch(batch, nbatch);
+
+      int n_dropped = pring->GetNewDropCount();
+      if(n_dropped)
+      {
+            wxString msg;
+            msg.Printf(_T("AIS serial input overrun, %d sentences dropped"), n_dropped);
+            wxLogMessage(msg);
+      }
+}
+
+void AIS_Decoder::DecodeRxBatch(const char *buffer, int len)
+{
+      if(!m_breplay)
+      {
+            DecodeBatch(buffer, len);
+            return;
+      }
+
+      int n_errors = 0;
+      m_replay_sw.Resume();
+      m_n_replay_msgs += DecodeBatch(buffer, len, &n_errors);
+      m_replay_sw.Pause();
+      m_n_replay_errors += n_errors;
+}
+
+//    Returns true if the sentence was AIS VDM/VDO, with the Decode() result in *pret
+bool AIS_Decoder::ProcessRxSentence(const char *str, int len, AIS_Error *pret)
+{
+      if((len > 6) && (!strncmp(str + 3, "VDM", 3) || !strncmp(str + 3, "VDO", 3)))
+      {
+            AIS_Error nr = Decode(str, len);
+            if(pret)
+                  *pret = nr;
+
+            if(!strncmp(str + 3, "VDO", 3))
+            {
+                  //    This is an ownship message, presumably from a transponder
+                  //    Simulate an ownship GPS position report upstream
+
+                  if(m_pLatestTargetData && (nr == AIS_NoError) && g_bGPSAISMux && m_pLatestTargetData->b_positionValid)
                   {
-                        if(g_bGPSAISMux)
-                              Parse_And_Send_Posn(message);
+                        AISPositionData.kLat = m_pLatestTargetData->Lat;
+                        AISPositionData.kLon = m_pLatestTargetData->Lon;
+                        AISPositionData.kCog = m_pLatestTargetData->COG;
+                        AISPositionData.kSog = m_pLatestTargetData->SOG;
+
+                        wxCommandEvent event( EVT_NMEA,  m_handler_id );
+                        event.SetEventObject( (wxObject *)this );
+                        event.SetExtraLong(EVT_NMEA_DIRECT);
+                        event.SetClientData(&AISPositionData);
+                        m_pMainEventHandler->AddPendingEvent(event);
                   }
             }
-            break;
-        }       //case
-    }           // switch
+            return true;
+      }
+      else
+      {
+            if(g_bGPSAISMux)
+            {
+                  wxString message(str, wxConvUTF8, len);
+                  Parse_And_Send_Posn(message);
+            }
+            return false;
+      }
 }
 
 void AIS_Decoder::ThreadMessage(const wxString &msg)
@@ -1330,21 +1431,62 @@ void AIS_Decoder::Parse_And_Send_Posn(wxString &message)
 
 
 //----------------------------------------------------------------------------------
-//      Decode NMEA VDM/VDO sentence to AIS Target(s)
+//      Decode a block of NMEA sentences, separated by CR and/or LF
+//      Each goes through ProcessRxSentence(), as sentences from the ports do.
+//      Returns the number of sentences which completed an AIS message
+//----------------------------------------------------------------------------------
+int AIS_Decoder::DecodeBatch(const char *buffer, int len, int *pn_errors)
+{
+    int n_decoded = 0;
+    int n_errors = 0;
+
+    const char *p = buffer;
+    const char *pend = buffer + len;
+
+    while(p < pend)
+    {
+        const char *pline = p;
+        while((p < pend) && (*p != '\r') && (*p != '\n'))
+            p++;
+
+        int text_len = p - pline;
+
+        while((p < pend) && ((*p == '\r') || (*p == '\n')))
+            p++;
+
+        if(!text_len)
+            continue;
+
+        //  The sentence keeps its terminator, like one from the serial ring
+        AIS_Error ret;
+        if(ProcessRxSentence(pline, p - pline, &ret))
+        {
+            if(AIS_NoError == ret)
+                n_decoded++;
+            else if(AIS_Partial != ret)
+                n_errors++;
+        }
+    }
+
+    if(pn_errors)
+        *pn_errors = n_errors;
+
+    return n_decoded;
+}
+
+//----------------------------------------------------------------------------------
+//      Decode one NMEA VDM/VDO sentence, not necessarily NUL terminated
 //----------------------------------------------------------------------------------
-AIS_Error AIS_Decoder::Decode(const wxString& str)
+AIS_Error AIS_Decoder::Decode(const char *str, int len)
 {
     AIS_Error ret;
-    wxString string_to_parse;
 
     //  Make some simple tests for validity
 
-//    int nlen = str.Len();
-
-    if(str.Len() > 100)
+    if(len > 100)
         return AIS_NMEAVDX_TOO_LONG;
 
-    if(!NMEACheckSumOK(str))
+    if(!NMEACheckSumOK(str, len))
     {
 //          printf("Checksum error at n_msgs:%d\n", n_msgs);
 
@@ -1352,76 +1494,88 @@ AIS_Error AIS_Decoder::Decode(const wxString& str)
             {
                   g_total_NMEAerror_messages++;
                   wxString msg(_T("   AIS checksum bad, continuing..."));
-                  msg.Append(str);
+                  msg.Append(wxString(str, wxConvUTF8, len));
                   ThreadMessage(msg);
             }
             else
             return AIS_NMEAVDX_CHECKSUM_BAD;
     }
 
-    if(!str.Mid(3,2).IsSameAs(_T("VD")))
+    if((len < 6) || strncmp(str + 3, "VD", 2))
     {
           return AIS_NMEAVDX_BAD;
     }
 
     //  OK, looks like the sentence is OK
 
-    //  Use a tokenizer to pull out the first 4 fields
-    wxString string(str);
-    wxStringTokenizer tkz(string, _T(","));
-
-    wxString token;
-    token = tkz.GetNextToken();         // !xxVDx
+    //  Locate the first six fields
+    //  !xxVDx,nsentences,isentence,sequence_id,channel,data,fill*hh
+    const char *field[6];
+    int nfields = 1;
+    field[0] = str;
 
-    token = tkz.GetNextToken();
-    nsentences = atoi(token.mb_str());
-
-    token = tkz.GetNextToken();
-    isentence = atoi(token.mb_str());
+    const char *pend = str + len;
+    for(const char *p = str ; (p < pend) && (nfields < 6) ; p++)
+    {
+        if(*p == ',')
+            field[nfields++] = p + 1;
+    }
 
-    token = tkz.GetNextToken();
-    long lsequence_id = 0;
-    token.ToLong(&lsequence_id);
+    nsentences = (nfields > 1) ? atoi(field[1]) : 0;
+    isentence = (nfields > 2) ? atoi(field[2]) : 0;
 
-    token = tkz.GetNextToken();
-    long lchannel;
-    token.ToLong(&lchannel);
+    //  The encapsulated data runs to the next field separator
+    const char *data = NULL;
+    int data_len = 0;
+    if(nfields == 6)
+    {
+        data = field[5];
+        const char *p = data;
+        while((p < pend) && (*p != ','))
+            p++;
+        data_len = p - data;
+    }
 
     //  Now, some decisions
 
-    string_to_parse.Clear();
+    const char *string_to_parse = NULL;
+    int parse_len = 0;
 
     //  Simple case first
     //  First and only part of a one-part sentence
     if((1 == nsentences) && (1 == isentence))
     {
-        string_to_parse = tkz.GetNextToken();         // the encapsulated data
+        string_to_parse = data;
+        parse_len = data_len;
     }
 
     else if(nsentences > 1)
     {
         if(1 == isentence)
-        {
-            sentence_accumulator = tkz.GetNextToken();         // the encapsulated data
-        }
+            accumulator_len = 0;
 
-        else
+        //  An overlong message is remembered as such, and rejected when complete
+        if(accumulator_len + data_len < AIS_MAX_MESSAGE_LEN)
         {
-            sentence_accumulator += tkz.GetNextToken();
+            memcpy(&sentence_accumulator[accumulator_len], data, data_len);
+            accumulator_len += data_len;
         }
+        else
+            accumulator_len = AIS_MAX_MESSAGE_LEN;
 
         if(isentence == nsentences)
         {
             string_to_parse = sentence_accumulator;
+            parse_len = accumulator_len;
         }
      }
 
 
-     if(!string_to_parse.IsEmpty() && (string_to_parse.Len() < AIS_MAX_MESSAGE_LEN))
+     if((parse_len > 0) && (parse_len < AIS_MAX_MESSAGE_LEN))
      {
 
         //  Create the bit accessible string
-        AIS_Bitstring strbit(string_to_parse.mb_str());
+        AIS_Bitstring strbit(string_to_parse, parse_len);
 
         //  Extract the MMSI
         int mmsi = strbit.GetInt(9, 30);
@@ -1475,7 +1629,7 @@ AIS_Error AIS_Decoder::Decode(const wxString& str)
 
         m_pLatestTargetData = pTargetData;
 
-        if(str.Mid(3,3).IsSameAs(_T("VDO")))
+        if(!strncmp(str + 3, "VDO", 3))
               pTargetData->b_OwnShip = true;
 
         bool bdecode_result = Parse_VDXBitstring(&strbit, pTargetData);            // Parse the new data
@@ -1493,7 +1647,7 @@ AIS_Error AIS_Decoder::Decode(const wxString& str)
               //     Update the most recent report period
               pTargetData->RecentPeriod = pTargetData->ReportTicks - last_report_ticks;
 
-              //  If this is not an ownship message, update the AIS Target in the Selectable list, and update the CPA info
+              //  If this is not an ownship message, update the AIS Target in the Selectable list
               if(!pTargetData->b_OwnShip)
               {
                     if(pTargetData->b_positionValid)
@@ -1502,13 +1656,13 @@ AIS_Error AIS_Decoder::Decode(const wxString& str)
                           pSel->SetUserData(mmsi);
                     }
 
-            //    Calculate CPA info for this target immediately
-                    UpdateOneCPA(pTargetData);
-
             //    Update this target's track
                     if(g_bAISShowTracks)
                         UpdateOneTrack(pTargetData);
               }
+
+              //  Queue the target for CPA and alarm evaluation
+              m_pCPAEngine->UpdateTarget(pTargetData);
         }
         else
         {
@@ -1934,59 +2088,37 @@ bool AIS_Decoder::Parse_VDXBitstring(AIS_Bitstring *bstr, AIS_Target_Data *ptd)
 
 
 
-bool AIS_Decoder::NMEACheckSumOK(const wxString& str_in)
+bool AIS_Decoder::NMEACheckSumOK(const char *str, int len)
 {
+   const char *pstar = (const char *)memchr(str, '*', len);
+   if(NULL == pstar)
+         return false;                          // '*' not found at all, no checksum
 
    unsigned char checksum_value = 0;
-   int sentence_hex_sum;
-
-   char str_ascii[AIS_MAX_MESSAGE_LEN];
-   strncpy(str_ascii, str_in.mb_str(), AIS_MAX_MESSAGE_LEN);
-
-   int string_length = strlen(str_ascii);
+   for(const char *p = str + 1 ; p < pstar ; p++)     // Skip over the $ at the begining of the sentence
+         checksum_value ^= *p;
 
-   int payload_length = 0;                       // pjotrc 2010.02.07
-   while ((payload_length<string_length) && (str_ascii[payload_length]!='*')) // look for '*'
-	payload_length++;
+   if(pstar + 2 >= str + len)
+         return false;
 
-   if (payload_length == string_length) return false; // '*' not found at all, no checksum
-
-   int index = 1; // Skip over the $ at the begining of the sentence
-
-   while( index < payload_length )                 // pjotrc 2010.02.07
-   {                                               // pjotrc 2010.02.07
-         checksum_value ^= str_ascii[ index ];
-         index++;
-   }
-
-   if(string_length > 4)
+   int sentence_hex_sum = 0;
+   for(int i=1 ; i<3 ; i++)
    {
-        char scanstr[3];
-        scanstr[0] = str_ascii[payload_length+1];       // pjotrc 2010.02.07
-        scanstr[1] = str_ascii[payload_length+2];       // pjotrc 2010.02.07
-        scanstr[2] = 0;
-        sscanf(scanstr, "%2x", &sentence_hex_sum);
-
-        if(sentence_hex_sum == checksum_value)
-            return true;
+         char c = pstar[i];
+         int nibble;
+         if((c >= '0') && (c <= '9'))
+               nibble = c - '0';
+         else if((c >= 'A') && (c <= 'F'))
+               nibble = c - 'A' + 10;
+         else if((c >= 'a') && (c <= 'f'))
+               nibble = c - 'a' + 10;
+         else
+               return false;
+
+         sentence_hex_sum = (sentence_hex_sum << 4) | nibble;
    }
 
-   return false;
-}
-
-void AIS_Decoder::UpdateAllCPA(void)
-{
-      //    Iterate thru all the targets
-      AIS_Target_Hash::iterator it;
-      AIS_Target_Hash *current_targets = GetTargetList();
-
-      for( it = (*current_targets).begin(); it != (*current_targets).end(); ++it )
-      {
-            AIS_Target_Data *td = it->second;
-
-            if(NULL != td)
-                  UpdateOneCPA(td);
-      }
+   return (sentence_hex_sum == checksum_value);
 }
 
 void AIS_Decoder::UpdateAllTracks(void)
@@ -2043,155 +2175,568 @@ void AIS_Decoder::UpdateOneTrack(AIS_Target_Data *ptarget)
 
 
 
-void AIS_Decoder::UpdateAllAlarms(void)
+//---------------------------------------------------------------------------------
+//
+//  AIS CPA/TCPA and Alarm Engine Implementation
+//
+//---------------------------------------------------------------------------------
+
+bool AIS_CPA_OwnShip::IsSameKinematics(const AIS_CPA_OwnShip &own) const
 {
-      bool bshould_alert = false;
-      m_bGeneralAlert    = false;                // no alerts yet
+      if(bGPSValid != own.bGPSValid)
+            return false;
 
+      //    NaN SOG/COG compare unequal to themselves, so test for them explicitly
+      bool bnan = wxIsNaN(Sog) || wxIsNaN(Cog);
+      bool bnan_own = wxIsNaN(own.Sog) || wxIsNaN(own.Cog);
+      if(bnan != bnan_own)
+            return false;
+      if(!bnan && ((Sog != own.Sog) || (Cog != own.Cog)))
+            return false;
 
-           //    Iterate thru all the targets
-      AIS_Target_Hash::iterator it;
-      AIS_Target_Hash *current_targets = GetTargetList();
+      return (Lat == own.Lat) && (Lon == own.Lon);
+}
 
-      for( it = (*current_targets).begin(); it != (*current_targets).end(); ++it )
+bool AIS_CPA_OwnShip::IsSameParams(const AIS_CPA_OwnShip &own) const
+{
+      return (bCPAWarn == own.bCPAWarn) && (CPAWarn_NM == own.CPAWarn_NM) &&
+             (bCPAMax == own.bCPAMax) && (CPAMax_NM == own.CPAMax_NM) &&
+             (bTCPA_Max == own.bTCPA_Max) && (TCPA_Max == own.TCPA_Max) &&
+             (bShowMoored == own.bShowMoored) && (ShowMoored_Kts == own.ShowMoored_Kts) &&
+             (bSuppressMoored == own.bSuppressMoored);
+}
+
+bool AIS_CPA_Result::IsSame(const AIS_CPA_Result &result) const
+{
+      return (bCPA_Valid == result.bCPA_Valid) && (CPA == result.CPA) && (TCPA == result.TCPA) &&
+             (Range_NM == result.Range_NM) && (Brg == result.Brg) &&
+             (n_alarm_state == result.n_alarm_state);
+}
+
+
+class AIS_CPA_Thread: public wxThread
+{
+public:
+      AIS_CPA_Thread(AIS_CPA_Engine *pEngine) : wxThread(wxTHREAD_JOINABLE)
       {
-            AIS_Target_Data *td = it->second;
+            m_pEngine = pEngine;
+      }
 
-            if(NULL != td)
+      void *Entry()
+      {
+            while(m_pEngine->WaitForWork())
+                  m_pEngine->RunPass();
+            return 0;
+      }
+
+private:
+      AIS_CPA_Engine    *m_pEngine;
+};
+
+
+AIS_CPA_Engine::AIS_CPA_Engine()
+      : m_semaphore(0, 1)
+{
+      m_pResults = new AIS_CPA_Result_Hash;
+      m_bpending_own = false;
+      m_bGeneralAlert = false;
+      m_bstop = false;
+
+      m_bown_valid = false;
+      m_n_general = 0;
+      m_npass = 0;
+
+      m_pThread = NULL;
+
+#ifdef CPL_HAVE_THREADLOCAL
+      //    The geodesic helpers keep per-thread state only where the compiler supports it.
+      //    Otherwise, passes run on the caller's thread from SetOwnShip().
+      m_pThread = new AIS_CPA_Thread(this);
+      if(m_pThread->Create() != wxTHREAD_NO_ERROR)
+      {
+            delete m_pThread;
+            m_pThread = NULL;
+      }
+      else
+            m_pThread->Run();
+#endif
+}
+
+AIS_CPA_Engine::~AIS_CPA_Engine()
+{
+      if(m_pThread)
+      {
             {
-                  //    Quick check on basic condition
-                  if((td->CPA < g_CPAWarn_NM) && (td->TCPA > 0))
-                        bshould_alert = true;
+                  wxMutexLocker lock(m_mutex);
+                  m_bstop = true;
+            }
+            m_semaphore.Post();
+            m_pThread->Wait();
+            delete m_pThread;
+      }
 
-                  ais_alarm_type this_alarm = AIS_NO_ALARM;
-                  if(g_bCPAWarn && td->b_active && td->b_positionValid)
-                  {
-                        //      Skip anchored/moored(interpreted as low speed) targets if requested
-//                        if((!g_bShowMoored) && ((td->NavStatus == MOORED) || (td->NavStatus == AT_ANCHOR)) && (td->SOG <= g_ShowMoored_Kts))        // pjotrc 2010.01.31
-                        if((!g_bShowMoored) && (td->SOG <= g_ShowMoored_Kts))        // dsr
-                        {
-                              td->n_alarm_state = AIS_NO_ALARM;
-                              continue;
-                        }
+      AIS_CPA_Target_Hash::iterator it;
+      for( it = m_pending_updates.begin(); it != m_pending_updates.end(); ++it )
+            delete it->second;
 
-                        //    No Alert on moored(interpreted as low speed) targets if so requested
-//                        if(g_bAIS_CPA_Alert_Suppress_Moored &&
-//                           ((td->NavStatus == MOORED) || (td->NavStatus == AT_ANCHOR)) && (td->SOG <= g_ShowMoored_Kts))                 // pjotrc 2010.01.31
-                        if(g_bAIS_CPA_Alert_Suppress_Moored && (td->SOG <= g_ShowMoored_Kts))                 // dsr
-                        {
+      for( it = m_targets.begin(); it != m_targets.end(); ++it )
+            delete it->second;
 
-                              td->n_alarm_state = AIS_NO_ALARM;
-                              continue;
-                        }
+      AIS_CPA_Grid_Hash::iterator itg;
+      for( itg = m_grid.begin(); itg != m_grid.end(); ++itg )
+            delete itg->second;
+
+      AIS_CPA_Result_Hash::iterator itr;
+      for( itr = m_pResults->begin(); itr != m_pResults->end(); ++itr )
+            delete itr->second;
+      delete m_pResults;
+}
 
+void AIS_CPA_Engine::UpdateTarget(AIS_Target_Data *ptarget)
+{
+      {
+            wxMutexLocker lock(m_mutex);
 
-                        //    Skip distant targets if requested
-                        if(g_bCPAMax)
-                        {
-                              if( td->Range_NM > g_CPAMax_NM)
-                              {
-                                    td->n_alarm_state = AIS_NO_ALARM;
-                                    continue;
-                              }
-                        }
+            //    Later reports replace any still waiting for a pass
+            AIS_CPA_Target *pt;
+            AIS_CPA_Target_Hash::iterator it = m_pending_updates.find(ptarget->MMSI);
+            if(it != m_pending_updates.end())
+                  pt = it->second;
+            else
+            {
+                  pt = new AIS_CPA_Target;
+                  m_pending_updates[ptarget->MMSI] = pt;
+            }
 
-                        if((td->CPA < g_CPAWarn_NM) && (td->TCPA > 0))
-                        {
-                              if(g_bTCPA_Max)
-                              {
-                                    if(td->TCPA < g_TCPA_Max)
-                                          this_alarm = AIS_ALARM_SET;
-                              }
-                        else
-                              this_alarm = AIS_ALARM_SET;
-                        }
-                  }
+            pt->MMSI = ptarget->MMSI;
+            pt->Lat = ptarget->Lat;
+            pt->Lon = ptarget->Lon;
+            pt->SOG = ptarget->SOG;
+            pt->COG = ptarget->COG;
+            pt->b_positionValid = ptarget->b_positionValid;
+            pt->b_OwnShip = ptarget->b_OwnShip;
+            pt->b_active = ptarget->b_active;
+
+            //    Current values seed the engine's copy of a new target
+            pt->result.MMSI = ptarget->MMSI;
+            pt->result.bCPA_Valid = ptarget->bCPA_Valid;
+            pt->result.CPA = ptarget->CPA;
+            pt->result.TCPA = ptarget->TCPA;
+            pt->result.Range_NM = ptarget->Range_NM;
+            pt->result.Brg = ptarget->Brg;
+            pt->result.n_alarm_state = ptarget->n_alarm_state;
+      }
 
-                  //    Maintain the timer for in_ack flag
-                  if(g_bAIS_ACK_Timeout)
-                  {
-                        if(td->b_in_ack_timeout)
-                        {
-                              wxTimeSpan delta = wxDateTime::Now() - td->m_ack_time;
-                              if(delta.GetMinutes() > g_AckTimeout_Mins)
-                                   td->b_in_ack_timeout = false;
-                        }
-                  }
-                  else
-                        td->b_in_ack_timeout = false;
+      if(m_pThread)
+            m_semaphore.Post();
+}
 
+void AIS_CPA_Engine::RemoveTarget(int mmsi)
+{
+      wxMutexLocker lock(m_mutex);
 
-/*
-                  //          If the target is in_ack state, we can only turn it off
-                  if(td->b_in_ack_timeout)
-                  {
-                        if(AIS_NO_ALARM == this_alarm)
-                              td->n_alarm_state = AIS_NO_ALARM;
-                  }
-                  else
-                        td->n_alarm_state = this_alarm;
-*/
+      AIS_CPA_Target_Hash::iterator it = m_pending_updates.find(mmsi);
+      if(it != m_pending_updates.end())
+      {
+            delete it->second;
+            m_pending_updates.erase(it);
+      }
+
+      m_pending_removals.Add(mmsi);
+}
+
+void AIS_CPA_Engine::SetOwnShip(const AIS_CPA_OwnShip &own)
+{
+      {
+            wxMutexLocker lock(m_mutex);
+            m_pending_own = own;
+            m_bpending_own = true;
+      }
+
+      if(m_pThread)
+            m_semaphore.Post();
+      else
+            RunPass();
+}
+
+AIS_CPA_Result_Hash *AIS_CPA_Engine::FetchResults(bool *pbGeneralAlert)
+{
+      AIS_CPA_Result_Hash *pnew = new AIS_CPA_Result_Hash;
+
+      wxMutexLocker lock(m_mutex);
+
+      AIS_CPA_Result_Hash *presults = m_pResults;
+      m_pResults = pnew;
+
+      if(pbGeneralAlert)
+            *pbGeneralAlert = m_bGeneralAlert;
+
+      return presults;
+}
+
+bool AIS_CPA_Engine::WaitForWork(void)
+{
+      m_semaphore.Wait();
+
+      wxMutexLocker lock(m_mutex);
+      return !m_bstop;
+}
+
+int AIS_CPA_Engine::GetGridKey(double lat, double lon)
+{
+      int ncols = (int)(360. / AIS_CPA_GRID_DEG);
+
+      int iy = (int)floor((lat + 90.) / AIS_CPA_GRID_DEG);
+      int ix = (int)floor((lon + 180.) / AIS_CPA_GRID_DEG);
+      ix = ((ix % ncols) + ncols) % ncols;
+
+      return (iy * ncols) + ix;
+}
+
+void AIS_CPA_Engine::GridInsert(AIS_CPA_Target *pt)
+{
+      pt->grid_key = -1;
+      if(!pt->b_positionValid)
+            return;
+
+      if((pt->Lat < -90.) || (pt->Lat > 90.) || (pt->Lon < -180.) || (pt->Lon > 180.))
+            return;
+
+      pt->grid_key = GetGridKey(pt->Lat, pt->Lon);
+
+      wxArrayPtrVoid *pcell;
+      AIS_CPA_Grid_Hash::iterator it = m_grid.find(pt->grid_key);
+      if(it != m_grid.end())
+            pcell = it->second;
+      else
+      {
+            pcell = new wxArrayPtrVoid;
+            m_grid[pt->grid_key] = pcell;
+      }
+
+      pcell->Add(pt);
+}
 
-                  td->n_alarm_state = this_alarm;
+void AIS_CPA_Engine::GridRemove(AIS_CPA_Target *pt)
+{
+      if(pt->grid_key < 0)
+            return;
 
+      AIS_CPA_Grid_Hash::iterator it = m_grid.find(pt->grid_key);
+      if(it != m_grid.end())
+      {
+            wxArrayPtrVoid *pcell = it->second;
+            pcell->Remove(pt);
+            if(pcell->IsEmpty())
+            {
+                  delete pcell;
+                  m_grid.erase(it);
             }
       }
 
-      if(bshould_alert)
-            m_bGeneralAlert = true;                // an alert
+      pt->grid_key = -1;
 }
 
+void AIS_CPA_Engine::MarkDirty(AIS_CPA_Target *pt)
+{
+      if(!pt->b_dirty)
+      {
+            pt->b_dirty = true;
+            m_dirty.Add(pt);
+      }
+}
 
-void AIS_Decoder::UpdateOneCPA(AIS_Target_Data *ptarget)
+void AIS_CPA_Engine::MarkCell(int key)
 {
-      if(!ptarget->b_positionValid)
+      AIS_CPA_Grid_Hash::iterator it = m_grid.find(key);
+      if(it == m_grid.end())
+            return;
+
+      wxArrayPtrVoid *pcell = it->second;
+      for(unsigned int i=0 ; i < pcell->GetCount() ; i++)
+            MarkDirty((AIS_CPA_Target *)pcell->Item(i));
+}
+
+void AIS_CPA_Engine::DeleteTarget(AIS_CPA_Target *pt)
+{
+      GridRemove(pt);
+
+      if(pt->b_dirty)
+            m_dirty.Remove(pt);
+
+      if(pt->b_general_alert)
+            m_n_general--;
+
+      m_flagged.erase(pt->MMSI);
+      m_targets.erase(pt->MMSI);
+
+      delete pt;
+}
+
+void AIS_CPA_Engine::ApplyPending(void)
+{
+      AIS_CPA_Target_Hash updates;
+      wxArrayInt removals;
+      AIS_CPA_OwnShip own;
+      bool bown = false;
+
+      {
+            wxMutexLocker lock(m_mutex);
+
+            updates = m_pending_updates;
+            m_pending_updates.clear();
+
+            removals = m_pending_removals;
+            m_pending_removals.Clear();
+
+            if(m_bpending_own)
+            {
+                  own = m_pending_own;
+                  bown = true;
+                  m_bpending_own = false;
+            }
+      }
+
+      //    Removals were queued before any update still pending for the same target
+      for(unsigned int i=0 ; i < removals.GetCount() ; i++)
+      {
+            AIS_CPA_Target_Hash::iterator it = m_targets.find(removals.Item(i));
+            if(it != m_targets.end())
+                  DeleteTarget(it->second);
+      }
+
+      AIS_CPA_Target_Hash::iterator itu;
+      for( itu = updates.begin(); itu != updates.end(); ++itu )
+      {
+            AIS_CPA_Target *pnew = itu->second;
+
+            AIS_CPA_Target_Hash::iterator it = m_targets.find(pnew->MMSI);
+            if(it == m_targets.end())
+            {
+                  pnew->b_general_alert = false;
+                  pnew->b_dirty = false;
+                  m_targets[pnew->MMSI] = pnew;
+                  GridInsert(pnew);
+                  MarkDirty(pnew);
+                  continue;
+            }
+
+            AIS_CPA_Target *pt = it->second;
+
+            //    Reports that leave the kinematics unchanged need no work
+            if((pt->Lat != pnew->Lat) || (pt->Lon != pnew->Lon) ||
+               (pt->SOG != pnew->SOG) || (pt->COG != pnew->COG) ||
+               (pt->b_positionValid != pnew->b_positionValid) ||
+               (pt->b_OwnShip != pnew->b_OwnShip) || (pt->b_active != pnew->b_active))
+            {
+                  GridRemove(pt);
+
+                  pt->Lat = pnew->Lat;
+                  pt->Lon = pnew->Lon;
+                  pt->SOG = pnew->SOG;
+                  pt->COG = pnew->COG;
+                  pt->b_positionValid = pnew->b_positionValid;
+                  pt->b_OwnShip = pnew->b_OwnShip;
+                  pt->b_active = pnew->b_active;
+
+                  GridInsert(pt);
+                  MarkDirty(pt);
+            }
+
+            delete pnew;
+      }
+
+      if(bown)
+      {
+            AIS_CPA_OwnShip own_prev = m_own;
+            bool bprev_valid = m_bown_valid;
+
+            m_own = own;
+            m_bown_valid = true;
+
+            if(!bprev_valid || !own_prev.IsSameParams(own))
+            {
+                  AIS_CPA_Target_Hash::iterator it;
+                  for( it = m_targets.begin(); it != m_targets.end(); ++it )
+                        MarkDirty(it->second);
+            }
+            else if(!own_prev.IsSameKinematics(own))
+                  MarkOwnShipChange(own_prev);
+      }
+}
+
+void AIS_CPA_Engine::MarkOwnShipChange(const AIS_CPA_OwnShip &own_prev)
+{
+      //    Without a range limit, every target may alarm, so all are recomputed
+      if(!m_own.bCPAMax)
+      {
+            AIS_CPA_Target_Hash::iterator it;
+            for( it = m_targets.begin(); it != m_targets.end(); ++it )
+                  MarkDirty(it->second);
+            return;
+      }
+
+      //    Otherwise, recompute targets in grid cells within alarm range of the old or new own ship position
+      double dlat = m_own.CPAMax_NM / 60.;
+      double lat_min = wxMin(own_prev.Lat, m_own.Lat) - dlat;
+      double lat_max = wxMax(own_prev.Lat, m_own.Lat) + dlat;
+
+      double coslat = cos(wxMax(fabs(lat_min), fabs(lat_max)) * PI / 180.);
+      double dlon = (coslat > 1e-3) ? dlat / coslat : 360.;
+
+      int ncols = (int)(360. / AIS_CPA_GRID_DEG);
+      int nrows = (int)(180. / AIS_CPA_GRID_DEG) + 1;
+
+      int iy0 = wxMax((int)floor((lat_min + 90.) / AIS_CPA_GRID_DEG), 0);
+      int iy1 = wxMin((int)floor((lat_max + 90.) / AIS_CPA_GRID_DEG), nrows - 1);
+
+      int ix0 = (int)floor((wxMin(own_prev.Lon, m_own.Lon) - dlon + 180.) / AIS_CPA_GRID_DEG);
+      int ix1 = (int)floor((wxMax(own_prev.Lon, m_own.Lon) + dlon + 180.) / AIS_CPA_GRID_DEG);
+      if((ix1 - ix0 + 1) > ncols)
+      {
+            ix0 = 0;
+            ix1 = ncols - 1;
+      }
+
+      if(((iy1 - iy0 + 1) * (ix1 - ix0 + 1)) > AIS_CPA_GRID_MAX_CELLS)
+      {
+            AIS_CPA_Target_Hash::iterator it;
+            for( it = m_targets.begin(); it != m_targets.end(); ++it )
+                  MarkDirty(it->second);
+            return;
+      }
+
+      for(int iy = iy0 ; iy <= iy1 ; iy++)
+      {
+            for(int ix = ix0 ; ix <= ix1 ; ix++)
+                  MarkCell((iy * ncols) + (((ix % ncols) + ncols) % ncols));
+      }
+
+      //    Alarmed targets are always recomputed, so that alarms clear as own ship leaves them behind
+      AIS_CPA_Target_Hash::iterator itf;
+      for( itf = m_flagged.begin(); itf != m_flagged.end(); ++itf )
+            MarkDirty(itf->second);
+
+      //    Distant targets are refreshed a slice of cells at a time, so their range and bearing stay current
+      int nslices = wxMax((int)(m_targets.size() / AIS_CPA_REFRESH_BATCH), 1);
+      int slice = m_npass % nslices;
+
+      AIS_CPA_Grid_Hash::iterator itg;
+      for( itg = m_grid.begin(); itg != m_grid.end(); ++itg )
+      {
+            if((itg->first % nslices) == slice)
+                  MarkCell(itg->first);
+      }
+}
+
+void AIS_CPA_Engine::RunPass(void)
+{
+      ApplyPending();
+
+      m_npass++;
+
+      if(!m_bown_valid)
+            return;
+
+      AIS_CPA_Result_Hash changed;
+
+      for(unsigned int i=0 ; i < m_dirty.GetCount() ; i++)
+      {
+            AIS_CPA_Target *pt = (AIS_CPA_Target *)m_dirty.Item(i);
+            pt->b_dirty = false;
+
+            AIS_CPA_Result prev = pt->result;
+
+            ComputeCPA(pt);
+            ComputeAlarm(pt);
+
+            //    Quick check on basic condition, for the general alert
+            bool bgeneral = (pt->result.CPA < m_own.CPAWarn_NM) && (pt->result.TCPA > 0);
+            if(bgeneral != pt->b_general_alert)
+            {
+                  m_n_general += bgeneral ? 1 : -1;
+                  pt->b_general_alert = bgeneral;
+            }
+
+            if(bgeneral || (AIS_ALARM_SET == pt->result.n_alarm_state))
+                  m_flagged[pt->MMSI] = pt;
+            else
+                  m_flagged.erase(pt->MMSI);
+
+            if(!prev.IsSame(pt->result))
+                  changed[pt->MMSI] = &pt->result;
+      }
+
+      m_dirty.Clear();
+
+      //    Post only the changes
+      wxMutexLocker lock(m_mutex);
+
+      AIS_CPA_Result_Hash::iterator itc;
+      for( itc = changed.begin(); itc != changed.end(); ++itc )
+      {
+            AIS_CPA_Result_Hash::iterator itr = m_pResults->find(itc->first);
+            if(itr != m_pResults->end())
+                  *(itr->second) = *(itc->second);
+            else
+                  (*m_pResults)[itc->first] = new AIS_CPA_Result(*(itc->second));
+      }
+
+      m_bGeneralAlert = (m_n_general > 0);
+}
+
+void AIS_CPA_Engine::ComputeCPA(AIS_CPA_Target *pt)
+{
+      AIS_CPA_Result *pr = &pt->result;
+
+      if(!pt->b_positionValid)
             return;
 
       //    There can be no collision between ownship and itself....
       //    This can happen if AIVDO messages are received, and there is another source of ownship position, like NMEA GLL
       //    The two positions are always temporally out of sync, and one will always be exactly in front of the other one.
-      if(ptarget->b_OwnShip)
+      if(pt->b_OwnShip)
       {
-            ptarget->CPA = 100;
-            ptarget->TCPA = -100;
+            pr->CPA = 100;
+            pr->TCPA = -100;
             return;
       }
 
-      if(!bGPSValid)
+      if(!m_own.bGPSValid)
       {
-            ptarget->bCPA_Valid = false;
+            pr->bCPA_Valid = false;
 
             //    Compute the current Range/Brg to the target, even though ownship position may not be valid
             double brg, dist;
-            DistanceBearingMercator(ptarget->Lat, ptarget->Lon, gLat, gLon, &brg, &dist);
-            ptarget->Range_NM = dist;
-            ptarget->Brg = brg;
+            DistanceBearingMercator(pt->Lat, pt->Lon, m_own.Lat, m_own.Lon, &brg, &dist);
+            pr->Range_NM = dist;
+            pr->Brg = brg;
 
             return;
       }
 
-      if(wxIsNaN(gSog) || wxIsNaN(gCog))
+      if(wxIsNaN(m_own.Sog) || wxIsNaN(m_own.Cog))
       {
-            ptarget->bCPA_Valid = false;
+            pr->bCPA_Valid = false;
             return;
       }
 
-      if((ptarget->COG == 360.0) || (ptarget->SOG >102.2))
+      if((pt->COG == 360.0) || (pt->SOG >102.2))
       {
-            ptarget->bCPA_Valid = false;
+            pr->bCPA_Valid = false;
             return;
       }
 
       //    Express the SOGs as meters per hour
-      double v0 = gSog         * 1852.;
-      double v1 = ptarget->SOG * 1852.;
+      double v0 = m_own.Sog * 1852.;
+      double v1 = pt->SOG   * 1852.;
 
       if((v0 < 1e-6) && (v1 < 1e-6))
       {
-            ptarget->TCPA = 0.;
-            ptarget->CPA = 0.;
+            pr->TCPA = 0.;
+            pr->CPA = 0.;
 
-            ptarget->bCPA_Valid = false;
+            pr->bCPA_Valid = false;
       }
       else
       {
@@ -2200,17 +2745,17 @@ void AIS_Decoder::UpdateOneCPA(AIS_Target_Data *ptarget)
             //    Working on a Reduced Lat/Lon orthogonal plotting sheet....
             //    Get easting/northing to target,  in meters
 
-            double east1 = (ptarget->Lon - gLon) * 60 * 1852;
-            double north1 = (ptarget->Lat - gLat) * 60 * 1852;
+            double east1 = (pt->Lon - m_own.Lon) * 60 * 1852;
+            double north1 = (pt->Lat - m_own.Lat) * 60 * 1852;
 
-            double east = east1 * (cos(gLat * PI / 180));;
+            double east = east1 * (cos(m_own.Lat * PI / 180));
             double north = north1;
 
             //    Convert COGs trigonometry to standard unit circle
-            double cosa = cos((90. - gCog) * PI / 180.);
-            double sina = sin((90. - gCog) * PI / 180.);
-            double cosb = cos((90. - ptarget->COG) * PI / 180.);
-            double sinb = sin((90. - ptarget->COG) * PI / 180.);
+            double cosa = cos((90. - m_own.Cog) * PI / 180.);
+            double sina = sin((90. - m_own.Cog) * PI / 180.);
+            double cosb = cos((90. - pt->COG) * PI / 180.);
+            double sinb = sin((90. - pt->COG) * PI / 180.);
 
 
             //    These will be useful
@@ -2228,30 +2773,147 @@ void AIS_Decoder::UpdateOneCPA(AIS_Target_Data *ptarget)
                   tcpa = ((fc * east) + (fs * north)) / d;
 
             //    Convert to minutes
-            ptarget->TCPA = tcpa * 60.;
+            pr->TCPA = tcpa * 60.;
 
             //    Calculate CPA
             //    Using TCPA, predict ownship and target positions
 
             double OwnshipLatCPA, OwnshipLonCPA, TargetLatCPA, TargetLonCPA;
 
-            ll_gc_ll(gLat,         gLon,         gCog,         gSog * tcpa,         &OwnshipLatCPA, &OwnshipLonCPA);
-            ll_gc_ll(ptarget->Lat, ptarget->Lon, ptarget->COG, ptarget->SOG * tcpa, &TargetLatCPA,  &TargetLonCPA);
+            ll_gc_ll(m_own.Lat, m_own.Lon, m_own.Cog, m_own.Sog * tcpa, &OwnshipLatCPA, &OwnshipLonCPA);
+            ll_gc_ll(pt->Lat,   pt->Lon,   pt->COG,   pt->SOG * tcpa,   &TargetLatCPA,  &TargetLonCPA);
 
             //   And compute the distance
-            ptarget->CPA = DistGreatCircle(OwnshipLatCPA, OwnshipLonCPA, TargetLatCPA, TargetLonCPA);
+            pr->CPA = DistGreatCircle(OwnshipLatCPA, OwnshipLonCPA, TargetLatCPA, TargetLonCPA);
 
-            ptarget->bCPA_Valid = true;
+            pr->bCPA_Valid = true;
 
-            if(ptarget->TCPA  < 0)
-                  ptarget->bCPA_Valid = false;
+            if(pr->TCPA  < 0)
+                  pr->bCPA_Valid = false;
       }
 
       //    Compute the current Range/Brg to the target
       double brg, dist;
-      DistanceBearingMercator(ptarget->Lat, ptarget->Lon, gLat, gLon, &brg, &dist);
-      ptarget->Range_NM = dist;
-      ptarget->Brg = brg;
+      DistanceBearingMercator(pt->Lat, pt->Lon, m_own.Lat, m_own.Lon, &brg, &dist);
+      pr->Range_NM = dist;
+      pr->Brg = brg;
+}
+
+void AIS_CPA_Engine::ComputeAlarm(AIS_CPA_Target *pt)
+{
+      AIS_CPA_Result *pr = &pt->result;
+
+      pr->n_alarm_state = AIS_NO_ALARM;
+
+      if(!m_own.bCPAWarn || !pt->b_active || !pt->b_positionValid)
+            return;
+
+      //      Skip anchored/moored(interpreted as low speed) targets if requested
+      if((!m_own.bShowMoored) && (pt->SOG <= m_own.ShowMoored_Kts))        // dsr
+            return;
+
+      //    No Alert on moored(interpreted as low speed) targets if so requested
+      if(m_own.bSuppressMoored && (pt->SOG <= m_own.ShowMoored_Kts))       // dsr
+            return;
+
+      //    Skip distant targets if requested
+      if(m_own.bCPAMax && (pr->Range_NM > m_own.CPAMax_NM))
+            return;
+
+      if((pr->CPA < m_own.CPAWarn_NM) && (pr->TCPA > 0))
+      {
+            if(m_own.bTCPA_Max)
+            {
+                  if(pr->TCPA < m_own.TCPA_Max)
+                        pr->n_alarm_state = AIS_ALARM_SET;
+            }
+            else
+                  pr->n_alarm_state = AIS_ALARM_SET;
+      }
+}
+
+
+//---------------------------------------------------------------------------------
+//
+//  AIS_Decoder CPA and Alarm Support
+//
+//---------------------------------------------------------------------------------
+
+void AIS_Decoder::UpdateOwnShipCPA(void)
+{
+      AIS_CPA_OwnShip own;
+
+      own.Lat = gLat;
+      own.Lon = gLon;
+      own.Sog = gSog;
+      own.Cog = gCog;
+      own.bGPSValid = bGPSValid;
+
+      own.bCPAWarn = g_bCPAWarn;
+      own.CPAWarn_NM = g_CPAWarn_NM;
+      own.bCPAMax = g_bCPAMax;
+      own.CPAMax_NM = g_CPAMax_NM;
+      own.bTCPA_Max = g_bTCPA_Max;
+      own.TCPA_Max = g_TCPA_Max;
+      own.bShowMoored = g_bShowMoored;
+      own.ShowMoored_Kts = g_ShowMoored_Kts;
+      own.bSuppressMoored = g_bAIS_CPA_Alert_Suppress_Moored;
+
+      m_pCPAEngine->SetOwnShip(own);
+}
+
+void AIS_Decoder::ApplyCPAResults(void)
+{
+      bool bgeneral_alert;
+      AIS_CPA_Result_Hash *presults = m_pCPAEngine->FetchResults(&bgeneral_alert);
+
+      AIS_CPA_Result_Hash::iterator it;
+      for( it = presults->begin(); it != presults->end(); ++it )
+      {
+            AIS_CPA_Result *pr = it->second;
+
+            AIS_Target_Data *td = Get_Target_Data_From_MMSI(pr->MMSI);
+            if(td)
+            {
+                  td->bCPA_Valid = pr->bCPA_Valid;
+                  td->CPA = pr->CPA;
+                  td->TCPA = pr->TCPA;
+                  td->Range_NM = pr->Range_NM;
+                  td->Brg = pr->Brg;
+                  td->n_alarm_state = pr->n_alarm_state;
+
+                  int index = m_alarm_mmsi.Index(pr->MMSI);
+                  if(AIS_ALARM_SET == pr->n_alarm_state)
+                  {
+                        if(wxNOT_FOUND == index)
+                              m_alarm_mmsi.Add(pr->MMSI);
+                  }
+                  else if(wxNOT_FOUND != index)
+                        m_alarm_mmsi.RemoveAt(index);
+            }
+
+            delete pr;
+      }
+
+      delete presults;
+
+      m_bGeneralAlert = bgeneral_alert;
+}
+
+void AIS_Decoder::UpdateAckTimeout(AIS_Target_Data *ptarget)
+{
+      //    Maintain the timer for in_ack flag
+      if(g_bAIS_ACK_Timeout)
+      {
+            if(ptarget->b_in_ack_timeout)
+            {
+                  wxTimeSpan delta = wxDateTime::Now() - ptarget->m_ack_time;
+                  if(delta.GetMinutes() > g_AckTimeout_Mins)
+                        ptarget->b_in_ack_timeout = false;
+            }
+      }
+      else
+            ptarget->b_in_ack_timeout = false;
 }
 
 
@@ -2269,6 +2931,7 @@ AIS_Error AIS_Decoder::OpenDataSource(wxFrame *pParent, const wxString& AISDataS
       pAIS_Thread = NULL;
       m_sock = NULL;
       m_OK = false;
+      m_breplay = false;
 
       TimerAIS.SetOwner(this, TIMER_AIS1);
       TimerAIS.Stop();
@@ -2406,6 +3069,32 @@ AIS_Error AIS_Decoder::OpenDataSource(wxFrame *pParent, const wxString& AISDataS
             m_OK = true;
       }
 
+//    AIS Data Source is a recorded NMEA file, played once on a thread,
+//    as fast as the decoder takes it.  The decode throughput is logged at the end.
+      else if(m_data_source_string.StartsWith(_T("Replay:")))
+      {
+            wxString file_name = m_data_source_string.AfterFirst(':');
+            if(!wxFileExists(file_name))
+            {
+                  wxString msg(_T("   Could not open AIS replay file "));
+                  msg.Append(file_name);
+                  wxLogMessage(msg);
+                  return AIS_NO_FILE;
+            }
+
+            m_breplay = true;
+            m_n_replay_msgs = 0;
+            m_n_replay_errors = 0;
+            m_replay_sw.Start();
+            m_replay_sw.Pause();
+
+            m_Thread_run_flag = 1;
+            OCP_AIS_ReplayThread *pthread = new OCP_AIS_ReplayThread(this, file_name);
+            pthread->Run();
+
+            m_OK = true;
+      }
+
       if(m_OK)
           TimerAIS.Start(TIMER_AIS_MSEC,wxTIMER_CONTINUOUS);
 
@@ -2575,6 +3264,7 @@ void AIS_Decoder::OnTimerAIS(wxTimerEvent& event)
 
           if(NULL == td)                        // This should never happen, but I saw it once....
           {
+                m_pCPAEngine->RemoveTarget(it->first);
                 current_targets->erase(it);
                 break;                          // leave the loop
           }
@@ -2585,8 +3275,11 @@ void AIS_Decoder::OnTimerAIS(wxTimerEvent& event)
           //      Mark lost targets if specified
           if(g_bMarkLost)
           {
-                  if(target_age > g_MarkLost_Mins * 60)
+                  if((target_age > g_MarkLost_Mins * 60) && td->b_active)
+                  {
                         td->b_active = false;
+                        m_pCPAEngine->UpdateTarget(td);
+                  }
           }
 
           //      Remove lost targets if specified
@@ -2596,6 +3289,9 @@ void AIS_Decoder::OnTimerAIS(wxTimerEvent& event)
                 if(target_age > removelost_Mins * 60)
                 {
                       pSelectAIS->DeleteSelectablePoint((void *)td->MMSI, SELTYPE_AISTARGET);
+                      m_pCPAEngine->RemoveTarget(td->MMSI);
+                      if(wxNOT_FOUND != m_alarm_mmsi.Index(td->MMSI))
+                            m_alarm_mmsi.Remove(td->MMSI);
                       current_targets->erase(it);
                       delete td;
                       break;        // kill only one per tick, since iterator becomes invalid...
@@ -2616,14 +3312,16 @@ void AIS_Decoder::OnTimerAIS(wxTimerEvent& event)
               istr++;
               if(istr > 23)
                   istr = 0;
-              Decode(str);
+              Decode(str, strlen(str));
           }
       }
 #endif
 
-      UpdateAllCPA();
+      //    Hand the engine the latest own ship state,
+      //    and collect the CPA and alarm changes it has posted
+      UpdateOwnShipCPA();
 
-      UpdateAllAlarms();
+      ApplyCPAResults();
 
       //    Update the general suppression flag
       m_bSuppressed = false;
@@ -2650,13 +3348,14 @@ void AIS_Decoder::OnTimerAIS(wxTimerEvent& event)
                   double tcpa_min = 1e6;             // really long
                   AIS_Target_Data *palarm_target = NULL;
 
-                  for( it = (*current_targets).begin(); it != (*current_targets).end(); ++it )
+                  for(unsigned int i=0 ; i < m_alarm_mmsi.GetCount() ; i++)
                   {
-                        AIS_Target_Data *td = it->second;
+                        AIS_Target_Data *td = Get_Target_Data_From_MMSI(m_alarm_mmsi.Item(i));
                         if(td)
                         {
                               if(td->b_active)
                               {
+                                    UpdateAckTimeout(td);
                                     if((AIS_ALARM_SET == td->n_alarm_state) && !td->b_in_ack_timeout)
                                     {
                                           if(td->TCPA < tcpa_min)
@@ -2695,6 +3394,7 @@ void AIS_Decoder::OnTimerAIS(wxTimerEvent& event)
 
                   if(palert_target)
                   {
+                        UpdateAckTimeout(palert_target);
                         if((AIS_ALARM_SET == palert_target->n_alarm_state) && !palert_target->b_in_ack_timeout)
                         {
                               g_pais_alert_dialog_active->UpdateText();
@@ -2801,12 +3501,7 @@ OCP_AIS_Thread::OCP_AIS_Thread(AIS_Decoder *pParent, const wxString& PortName)
 
       m_pPortName = new wxString(PortName);
 
-      rx_buffer = new char[RX_BUFFER_SIZE + 1];
-      temp_buf = new char[RX_BUFFER_SIZE + 1];
-
-      put_ptr = rx_buffer;
-      tak_ptr = rx_buffer;
-      nl_count = 0;
+      m_pRing = new OCP_SerialRing;
 
       Create();
 }
@@ -2814,8 +3509,8 @@ OCP_AIS_Thread::OCP_AIS_Thread(AIS_Decoder *pParent, const wxString& PortName)
 OCP_AIS_Thread::~OCP_AIS_Thread(void)
 {
       delete m_pPortName;
-      delete rx_buffer;
-      delete temp_buf;
+
+      m_pRing->Unref();                         // pending events may still hold it
 
 }
 
@@ -2827,99 +3522,18 @@ void OCP_AIS_Thread::OnExit(void)
 
 bool OCP_AIS_Thread::HandleRead(char *buf, int character_count)
 {
-    // Copy the characters into circular buffer
+    // Hand the characters to the GUI thread through the ring
+    // One event covers every sentence completed until the decoder drains the ring
 
-    char *bp = buf;
-    int ichar = character_count;
-    while(ichar)
+    if(m_pRing->Put(buf, character_count))
     {
-     // keep track of how many nl in the buffer
-        if(0x0a == *bp)
-            nl_count++;
-
-        *put_ptr++ = *bp++;
-        if((put_ptr - rx_buffer) > RX_BUFFER_SIZE)
-            put_ptr = rx_buffer;
-
-        ichar--;
+        OCPN_AISEvent event(wxEVT_OCPN_AIS , ID_AIS_WINDOW );
+        event.SetEventObject( (wxObject *)this );
+        event.SetExtraLong(EVT_AIS_PARSE_RX);
+        event.SetRing(m_pRing);
+        m_pParentEventHandler->AddPendingEvent(event);
     }
 
-///    wxString msg;
-///    msg.Printf(_T("(put_ptr-tak_ptr): %d      character_count: %d        nl_count: %d"), (int)(put_ptr-tak_ptr), character_count, nl_count);
-///    wxLogMessage(msg);
-
-    if(nl_count < 0)                // "This will never happen..."
-        nl_count = 0;
-
-    // If there are any nl's in the buffer
-    // There is at least one sentences in the buffer,
-    // plus maybe a partial
-    // Try hard to send multiple sentences
-
-    if(nl_count)
-    {
-        bool bmore_data = true;
-
-        while((bmore_data) && (nl_count))
-        {
-            if(put_ptr != tak_ptr)
-            {
-                //copy the buffer, looking for nl
-                char *tptr;
-                char *ptmpbuf;
-
-                tptr = tak_ptr;
-                ptmpbuf = temp_buf;
-
-                while((*tptr != 0x0a) && (tptr != put_ptr))
-                {
-                    *ptmpbuf++ = *tptr++;
-
-                    if((tptr - rx_buffer) > RX_BUFFER_SIZE)
-                        tptr = rx_buffer;
-                }
-
-                if((*tptr == 0x0a) && (tptr != put_ptr))                // well formed sentence
-                {
-                    *ptmpbuf++ = *tptr++;
-                    if((tptr - rx_buffer) > RX_BUFFER_SIZE)
-                        tptr = rx_buffer;
-
-                    *ptmpbuf = 0;
-
-                    tak_ptr = tptr;
-
-    //    Signal the parent program thread
-
-                    OCPN_AISEvent event(wxEVT_OCPN_AIS , ID_AIS_WINDOW );
-                    event.SetEventObject( (wxObject *)this );
-                    event.SetExtraLong(EVT_AIS_PARSE_RX);
-                    event.SetNMEAString(wxString(temp_buf,  wxConvUTF8));
-                    m_pParentEventHandler->AddPendingEvent(event);
-
-///     msg.Printf(_T("         removing: %d,   (put_ptr-tak_ptr): %d,   nl_count:%d"), strlen(temp_buf), (int)(put_ptr-tak_ptr), nl_count);
-///     wxLogMessage(msg);
-
-                    nl_count--;
-                }   // if good sentence
-                else                                 // partial sentence
-                {
-                    bmore_data = false;
-///                    msg.Printf(_T("         partial...   nl_count:%d"), nl_count);
-///                    wxLogMessage(msg);
-                }
-
-            }   // if data
-            else
-            {
-                bmore_data = false;                  // no more data in buffer
-///                msg.Printf(_T("         no data...   nl_count:%d"), nl_count);
-///                wxLogMessage(msg);
-            }
-
-        }       // while
-    }       // if nl
-
     return true;
 }
 
@@ -3093,7 +3707,7 @@ void *OCP_AIS_Thread::Entry()
 port_ready:
 
     bool not_done = true;
-    char next_byte = 0;
+    char read_buf[SERIAL_READ_CHUNK];
     ssize_t newdata = 0;
 
 //    The main loop
@@ -3107,18 +3721,6 @@ port_ready:
             not_done = false;                               // smooth exit
         }
 
-//#define oldway 1
-#ifdef oldway
-//    Blocking, timeout protected read of one character at a time
-//    Timeout value is set by c_cc[VTIME]
-//    Storing incoming characters in circular buffer
-//    And watching for new line character
-//     On new line character, send notification to parent
-
-
-        newdata = read(m_ais_fd, &next_byte, 1);            // blocking read of one char
-                                                            // return (-1) if no data available, timeout
-#else
 //      Kernel I/O multiplexing provides a cheap way to wait for chars
 
         fd_set rfds;
@@ -3133,18 +3735,16 @@ port_ready:
         tv.tv_usec = 0;
 
         newdata = 0;
-        next_byte = 0;
 
 //      wait for a read available on m_ais_fd, we don't care about write or exceptions
-        retval = select(FD_SETSIZE, &rfds, NULL, NULL, &tv);
+        retval = select(m_ais_fd + 1, &rfds, NULL, NULL, &tv);
 
-        if(FD_ISSET(m_ais_fd, &rfds) && (retval != -1) && retval)
-            newdata = read(m_ais_fd, &next_byte, 1);            // blocking read of one char
-                                                                // bound to succeed
-#endif
+        if((retval > 0) && FD_ISSET(m_ais_fd, &rfds))
+            newdata = read(m_ais_fd, read_buf, sizeof(read_buf));    // whatever is available, in one block
+                                                                    // bound to succeed
 
         if(newdata > 0)
-            HandleRead(&next_byte, 1);
+            HandleRead(read_buf, newdata);
 
     }           // the big while
 
@@ -3356,6 +3956,66 @@ fail_point:
 #endif            //__WXMSW__
 
 
+
+//-------------------------------------------------------------------------------------------------------------
+//    OCP_AIS_ReplayThread Implementation
+//-------------------------------------------------------------------------------------------------------------
+
+OCP_AIS_ReplayThread::OCP_AIS_ReplayThread(AIS_Decoder *pParent, const wxString& file_name)
+{
+      m_pParentEventHandler = pParent;
+      m_file_name = wxString(file_name.c_str());          // not shared with the main thread
+
+      m_pRing = new OCP_SerialRing;
+
+      Create();
+}
+
+OCP_AIS_ReplayThread::~OCP_AIS_ReplayThread(void)
+{
+      m_pRing->Unref();                         // pending events may still hold it
+}
+
+void OCP_AIS_ReplayThread::PostRingEvent(long type)
+{
+      OCPN_AISEvent event(wxEVT_OCPN_AIS , ID_AIS_WINDOW );
+      event.SetEventObject( (wxObject *)this );
+      event.SetExtraLong(type);
+      event.SetRing(m_pRing);
+      m_pParentEventHandler->AddPendingEvent(event);
+}
+
+void *OCP_AIS_ReplayThread::Entry()
+{
+      wxFile f;
+      if(f.Open(m_file_name))
+      {
+            char read_buf[SERIAL_READ_CHUNK];
+            ssize_t newdata;
+
+            while((m_pParentEventHandler->m_Thread_run_flag > 0) && !TestDestroy()
+                   && ((newdata = f.Read(read_buf, sizeof(read_buf))) > 0))
+            {
+                  //    Unlike a serial port, a file can wait for the decoder to catch up.
+                  //    Leave room for a sentence left partial by the last read, too.
+                  while((m_pRing->GetFreeSpace() < newdata + SERIAL_SENTENCE_MAX)
+                         && (m_pParentEventHandler->m_Thread_run_flag > 0))
+                        wxMilliSleep(1);
+
+                  if(m_pRing->Put(read_buf, newdata))
+                        PostRingEvent(EVT_AIS_PARSE_RX);
+            }
+      }
+
+      if(m_pParentEventHandler->m_Thread_run_flag > 0)
+            PostRingEvent(EVT_AIS_REPLAY_DONE);
+
+      m_pParentEventHandler->m_Thread_run_flag = -1;
+
+      return 0;
+}
+
+
 //---------------------------------------------------------------------------------------
 //          AISTargetAlertDialog Implementation
 //---------------------------------------------------------------------------------------
@@ -81,6 +81,7 @@
 #include "cpl_error.h"
 #include "ais.h"
 #include "chartimg.h"               // for ChartBaseBSB
+#include "ocpn_pixel.h"             // for ocpnFreePixelBufferPool
 #include "routeprop.h"
 #include "cm93.h"
 
@@ -304,6 +305,7 @@ int             g_SkewCompUpdatePeriod;
 s52plib           *ps52plib;
 S57ClassRegistrar *g_poRegistrar;
 s57RegistrarMgr   *m_pRegistrarMan;
+S57TileCache      *g_pS57TileCache;
 #endif
 
 #ifdef USE_WIFI_CLIENT
@@ -372,6 +374,9 @@ bool             g_bUseRMC;
 bool             g_bUseGLL;
 
 int              g_nCacheLimit;
+int              g_nCacheMemLimitMB;
+int              g_nSENCBuildThreads;
+int              g_nS57TileCacheMB;
 bool             g_bGDAL_Debug;
 
 double           g_VPRotate;                   // Viewport rotation angle, used on "Course Up" mode
@@ -1366,6 +1371,10 @@ bool MyApp::OnInit()
         if(ps52plib->m_bOK)
               m_pRegistrarMan = new s57RegistrarMgr(*g_pcsv_locn, flog);
 
+//  Rendered vector chart tiles, shared by all open s57 charts
+        if(ps52plib->m_bOK && (g_nS57TileCacheMB > 0))
+              g_pS57TileCache = new S57TileCache((size_t)g_nS57TileCacheMB * 1024 * 1024);
+
 
 #endif  // S57
 
@@ -1788,8 +1797,8 @@ bool MyApp::OnInit()
 //      Start up the ViewPort Rotation angle Averaging Timer....
         gFrame->FrameCOGTimer.Start(10, wxTIMER_CONTINUOUS);
 
-//        gFrame->MemFootTimer.Start(wxMax(g_MemFootSec * 1000, 60 * 1000), wxTIMER_CONTINUOUS);
-//        gFrame->MemFootTimer.Start(1000, wxTIMER_CONTINUOUS);
+//      Start up the chart cache memory manager
+        gFrame->MemFootTimer.Start(wxMax(g_MemFootSec, 10) * 1000, wxTIMER_CONTINUOUS);
 
 //debug
 //        g_COGAvg = 45.0;
@@ -1870,6 +1879,9 @@ int MyApp::OnExit()
 
         delete pDummyChart;
 
+        ChartBaseBSB::ShutdownScaleThreads();
+        ocpnFreePixelBufferPool();
+
         if(ptcmgr)
                 delete ptcmgr;
 
@@ -1911,6 +1923,9 @@ int MyApp::OnExit()
 #ifdef USE_S57
         delete m_pRegistrarMan;
         CSVDeaccess(NULL);
+
+        delete g_pS57TileCache;
+        g_pS57TileCache = NULL;
 #endif
 
 #ifdef USE_S57
@@ -4764,81 +4779,33 @@ void MyFrame::DoStackUp(void)
 
 
 //    Manage the application memory footprint on a periodic schedule
+//    The chart cache is trimmed here, away from the chart open path, down to
+//    a low water mark below its budget so that opening the next chart seldom
+//    has to evict anything.
 void MyFrame::OnMemFootTimer(wxTimerEvent& event)
 {
       MemFootTimer.Stop();
 
-      int memsize = GetApplicationMemoryUse();
-
-      g_MemFootMB = 100;
-      printf("Memsize: %d  \n", memsize);
-      // The application memory usage has exceeded the target, so try to manage it down....
-      if(memsize > (g_MemFootMB * 1000))
+      if(ChartData && cc1)
       {
-            if(ChartData && cc1)
-            {
-                  //    Get a local copy of the cache info
-                  wxArrayPtrVoid *pCache = ChartData->GetChartCache();
-                  unsigned int nCache = pCache->GetCount();
-                  CacheEntry *pcea = new CacheEntry[nCache];
-
-                  for(unsigned int i=0 ; i<nCache ; i++)
-                  {
-                        CacheEntry *pce = (CacheEntry *)(pCache->Item(i));
-                        pcea[i] = *pce;//ChartBase *Ch = (ChartBase *)pce->pChart;
-                  }
-
-                  if(nCache > 1)
-                  {
-                  //    Bubble Sort the local cache entry array
-                        bool b_cont = true;
-                        while(b_cont)
-                        {
-                              b_cont = false;
-                              for(unsigned int i=0 ; i<nCache-1 ; i++)
-                              {
-                                    if(pcea[i].RecentTime > pcea[i+1].RecentTime)
-                                    {
-                                          CacheEntry tmp = pcea[i];
-                                          pcea[i] = pcea[i+1];
-                                          pcea[i+1] = tmp;
-                                          b_cont = true;
-                                          break;
-                                    }
-                              }
-                        }
-
-                        //    Free up some chart cache entries until the memory footprint target is realized
-
-                        unsigned int idelete = 0;                 // starting at top. which is oldest
-                        unsigned int idelete_max = pCache->GetCount();
-
-                        //    How many can be deleted?
-                        unsigned int minimum_cache = 1;
-                        if(cc1->GetQuiltMode())
-                              minimum_cache = cc1->GetQuiltChartCount();
-
-                        while((memsize > (g_MemFootMB * 1000)) && (pCache->GetCount() > minimum_cache) && (idelete < idelete_max))
-                        {
-                              int memsizeb = memsize;
-
-                              ChartData->DeleteCacheChart((ChartBase *)pcea[idelete].pChart);
-                              idelete++;
-                              memsize = GetApplicationMemoryUse();
-                              printf("delete, before: %d  after: %d\n", memsizeb, memsize);
-                        }
-
-                  }
+            size_t budget = ChartData->GetChartCacheMemoryBudget();
 
+            //    Charts grow while they are displayed, so look again at all of them
+            ChartData->UpdateCacheFootprints();
 
+            if(ChartData->GetChartCacheMemory() > (budget / 4) * 3)
+            {
+                  //    The charts of the current quilt are locked in the cache by Quilt::Compose()
+                  size_t mem_before = ChartData->GetChartCacheMemory();
+                  int n_deleted = ChartData->TrimCache((budget / 4) * 3, (unsigned int)g_nCacheLimit);
 
-                  delete[] pcea;
+                  if(n_deleted)
+                        wxLogMessage(_T("Chart cache trimmed %d charts, %d KB -> %d KB"), n_deleted,
+                                     (int)(mem_before / 1024), (int)(ChartData->GetChartCacheMemory() / 1024));
             }
-
       }
 
-//      MemFootTimer.Start(wxMax(g_MemFootSec * 1000, 60 * 1000), wxTIMER_CONTINUOUS);
-      MemFootTimer.Start(9000, wxTIMER_CONTINUOUS);
+      MemFootTimer.Start(wxMax(g_MemFootSec, 10) * 1000, wxTIMER_CONTINUOUS);
 }
 
 
@@ -6858,6 +6825,34 @@ void MyFrame::OnEvtTHREADMSG(wxCommandEvent & event)
 
 void MyFrame::OnEvtOCPN_NMEA(OCPN_NMEAEvent & event)
 {
+      //    Events from the serial threads carry a ring, not a sentence
+      //    Handle every complete sentence now waiting in it, one at a time
+      OCP_SerialRing *pring = event.GetRing();
+      if(pring)
+      {
+            char sentence[SERIAL_SENTENCE_MAX];
+            int len;
+
+            pring->BeginDrain();
+            while((len = pring->GetSentence(sentence, sizeof(sentence))) > 0)
+            {
+                  wxString str(sentence, wxConvUTF8, len);
+
+                  OCPN_NMEAEvent Nevent(wxEVT_OCPN_NMEA, 0);
+                  Nevent.SetNMEAString(str);
+                  OnEvtOCPN_NMEA(Nevent);
+            }
+
+            int n_dropped = pring->GetNewDropCount();
+            if(n_dropped)
+            {
+                  wxString msg;
+                  msg.Printf(_T("NMEA serial input overrun, %d sentences dropped"), n_dropped);
+                  wxLogMessage(msg);
+            }
+            return;
+      }
+
       wxString sfixtime;
       bool bshow_tick = false;
       bool bis_recognized_sentence = true; //PL
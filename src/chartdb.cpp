@@ -57,6 +57,8 @@
 extern ChartBase    *Current_Ch;
 extern ThumbWin     *pthumbwin;
 extern int          g_nCacheLimit;
+extern int          g_nCacheMemLimitMB;
+extern int          g_nSENCBuildThreads;
 
 
 bool G_FloatPtInPolygon(MyFlPoint *rgpts, int wnumpts, float x, float y) ;
@@ -119,7 +121,10 @@ bool ChartStack::DoesStackContaindbIndex(int db_index)
 ChartDB::ChartDB(MyFrame *parent)
 {
       pParent = parent;
-      pChartCache = new wxArrayPtrVoid;
+
+      m_pCacheMRU = NULL;
+      m_pCacheLRU = NULL;
+      m_CacheMemBytes = 0;
 
       SetValid(false);                           // until loaded or created
 }
@@ -129,22 +134,189 @@ ChartDB::~ChartDB()
 {
 //    Empty the cache
       PurgeCache();
-
-      delete pChartCache;
 }
 
 void ChartDB::PurgeCache()
 {
 //    Empty the cache
-      unsigned int nCache = pChartCache->GetCount();
-      for(unsigned int i=0 ; i<nCache ; i++)
+      CacheEntry *pce = m_pCacheMRU;
+      while(pce)
       {
-            CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
+            CacheEntry *pnext = pce->pLRUNext;
             ChartBase *Ch = (ChartBase *)pce->pChart;
             delete Ch;
             delete pce;
+            pce = pnext;
+      }
+
+      m_CacheHash.clear();
+      m_pCacheMRU = NULL;
+      m_pCacheLRU = NULL;
+      m_CacheMemBytes = 0;
+}
+
+//-------------------------------------------------------------------------------------------------------
+//      Chart cache management
+//      Entries are found by dbIndex through a hash map, and kept on a doubly linked
+//      list ordered by recent use, so that lookup, touch and eviction are all O(1).
+//-------------------------------------------------------------------------------------------------------
+
+CacheEntry *ChartDB::FindCacheEntry(int dbindex)
+{
+      ChartCacheHash::iterator it = m_CacheHash.find(dbindex);
+      if(it == m_CacheHash.end())
+            return NULL;
+      return it->second;
+}
+
+void ChartDB::UnlinkCacheEntry(CacheEntry *pce)
+{
+      if(pce->pLRUPrev)
+            pce->pLRUPrev->pLRUNext = pce->pLRUNext;
+      else
+            m_pCacheMRU = pce->pLRUNext;
+
+      if(pce->pLRUNext)
+            pce->pLRUNext->pLRUPrev = pce->pLRUPrev;
+      else
+            m_pCacheLRU = pce->pLRUPrev;
+
+      pce->pLRUPrev = NULL;
+      pce->pLRUNext = NULL;
+}
+
+void ChartDB::TouchCacheEntry(CacheEntry *pce)
+{
+      pce->RecentTime = wxDateTime::Now().GetTicks();
+
+      if(pce == m_pCacheMRU)
+            return;
+
+      UnlinkCacheEntry(pce);
+
+      pce->pLRUNext = m_pCacheMRU;
+      if(m_pCacheMRU)
+            m_pCacheMRU->pLRUPrev = pce;
+      m_pCacheMRU = pce;
+      if(NULL == m_pCacheLRU)
+            m_pCacheLRU = pce;
+}
+
+void ChartDB::AddCacheEntry(CacheEntry *pce)
+{
+      pce->pLRUPrev = NULL;
+      pce->pLRUNext = NULL;
+      pce->MemBytes = 0;
+      pce->bLocked = false;
+
+      m_CacheHash[pce->dbIndex] = pce;
+      TouchCacheEntry(pce);
+      UpdateCacheEntryFootprint(pce);
+}
+
+void ChartDB::RemoveCacheEntry(CacheEntry *pce)
+{
+      UnlinkCacheEntry(pce);
+      m_CacheHash.erase(pce->dbIndex);
+      m_CacheMemBytes -= pce->MemBytes;
+}
+
+//    Charts grow after Init() (line caches, render bitmaps, cm93 cells), so re-query on each use
+void ChartDB::UpdateCacheEntryFootprint(CacheEntry *pce)
+{
+      ChartBase *Ch = (ChartBase *)pce->pChart;
+      size_t bytes = Ch ? Ch->GetMemoryFootprint() : 0;
+
+      m_CacheMemBytes -= pce->MemBytes;
+      m_CacheMemBytes += bytes;
+      pce->MemBytes = bytes;
+}
+
+//    Delete the chart owned by an entry which has already been removed from the cache
+void ChartDB::DeleteCacheEntryChart(CacheEntry *pce)
+{
+      ChartBase *pDeleteCandidate = (ChartBase *)pce->pChart;
+
+      //  If this chart should happen to be in the thumbnail window....
+      if(pthumbwin)
+      {
+            if(pthumbwin->pThumbChart == pDeleteCandidate)
+                  pthumbwin->pThumbChart = NULL;
+      }
+
+      delete pDeleteCandidate;
+      delete pce;
+}
+
+size_t ChartDB::GetChartCacheMemoryBudget(void)
+{
+      if(g_nCacheMemLimitMB > 0)
+            return (size_t)g_nCacheMemLimitMB * 1024 * 1024;
+
+      //    No explicit budget, so allow the cache half of physical memory
+      static size_t s_auto_budget;
+      if(0 == s_auto_budget)
+      {
+            int mem_total = 0;
+            int mem_used = 0;
+            if(pParent && pParent->GetMemoryStatus(mem_total, mem_used) && (mem_total > 0))
+                  s_auto_budget = ((size_t)mem_total / 2) * 1024;             // mem_total is in KBytes
+            else
+                  s_auto_budget = (size_t)512 * 1024 * 1024;
+      }
+
+      return s_auto_budget;
+}
+
+//    Re-query the footprint of every cached chart
+void ChartDB::UpdateCacheFootprints(void)
+{
+      for(CacheEntry *pce = m_pCacheMRU ; pce ; pce = pce->pLRUNext)
+            UpdateCacheEntryFootprint(pce);
+}
+
+//-------------------------------------------------------------------
+//    Evict least recently used charts until the cache holds no more than
+//    target_bytes and max_entries.
+//    Current_Ch and the locked charts of the current quilt are never evicted.
+//    Returns the number of charts deleted.
+//-------------------------------------------------------------------
+int ChartDB::TrimCache(size_t target_bytes, unsigned int max_entries)
+{
+      int n_deleted = 0;
+
+      UpdateCacheFootprints();
+
+      CacheEntry *pce = m_pCacheLRU;
+      while(pce && ((m_CacheMemBytes > target_bytes) || (m_CacheHash.size() > max_entries)))
+      {
+            CacheEntry *pprev = pce->pLRUPrev;
+
+            if(!pce->bLocked && ((ChartBase *)(pce->pChart) != Current_Ch))
+            {
+                  RemoveCacheEntry(pce);
+                  DeleteCacheEntryChart(pce);
+                  n_deleted++;
+            }
+
+            pce = pprev;
       }
-      pChartCache->Clear();
+
+      return n_deleted;
+}
+
+//    Protect a cached chart from eviction, until the next UnLockAllCacheCharts()
+void ChartDB::LockCacheChart(int dbindex)
+{
+      CacheEntry *pce = FindCacheEntry(dbindex);
+      if(pce)
+            pce->bLocked = true;
+}
+
+void ChartDB::UnLockAllCacheCharts(void)
+{
+      for(CacheEntry *pce = m_pCacheMRU ; pce ; pce = pce->pLRUNext)
+            pce->bLocked = false;
 }
 
 
@@ -193,12 +365,58 @@ ChartBase *ChartDB::GetChart(const wxChar *theFilePath, ChartClassDescriptor &ch
       return pch;
 }
 
+//-------------------------------------------------------------------------------------------------------
+//      Build the SENC files for ENC cells just added to the database,
+//      so the first open of each cell does not pay for the ingest.
+//-------------------------------------------------------------------------------------------------------
+
+void ChartDB::PrebuildNewCharts(int first_new_index, wxProgressDialog *pprog)
+{
+      if(!g_nSENCBuildThreads)                        // disabled, SENCs are built on first open
+            return;
+
+      SENCBuildPool pool(g_nSENCBuildThreads);
+      wxArrayString names;
+
+      for(int i=first_new_index ; i < GetChartTableEntries() ; i++)
+      {
+            const ChartTableEntry &cte = GetChartTableEntry(i);
+            if(cte.GetChartType() != CHART_TYPE_S57)
+                  continue;
+
+            wxFileName fn(wxString(cte.GetpFullPath(), wxConvUTF8));
+            if(fn.GetExt().Upper() != _T("000"))
+                  continue;
+
+            //    Working update files are staged in the SENC directory by cell name,
+            //    so a cell name may be built only once per pass
+            if(names.Index(fn.GetFullName().Upper()) != wxNOT_FOUND)
+                  continue;
+            names.Add(fn.GetFullName().Upper());
+
+            Extent ext;
+            ext.NLAT = cte.GetLatMax();
+            ext.SLAT = cte.GetLatMin();
+            ext.ELON = cte.GetLonMax();
+            ext.WLON = cte.GetLonMin();
+
+            pool.AddCell(fn.GetFullPath(), cte.GetScale(), ext);
+      }
+
+      if(!pool.GetCellCount())
+            return;
+
+      if(pprog)
+            pprog->SetTitle(_("OpenCPN SENC Build...."));
+
+      pool.Run(pprog);
+}
+
 
 
 
 int ChartDB::BuildChartStack(ChartStack * cstk, float lat, float lon)
 {
-      int i=0;
       int j=0;
 
       if(!IsValid())
@@ -207,57 +425,33 @@ int ChartDB::BuildChartStack(ChartStack * cstk, float lat, float lon)
       if(!cstk)
             return 0;                           // Chartstack not ready yet
 
-      int nEntry = GetChartTableEntries();
+      //    The grid index yields only those charts whose bounding box touches
+      //    the one-degree cell containing lat/lon, already sorted on scale
+      const wxArrayInt *pcand = GetGridCandidates(lat, lon);
 
-      for(int db_index=0 ; db_index<nEntry ; db_index++)
+      if(pcand)
       {
+            for(unsigned int i=0 ; (i < pcand->GetCount()) && (j < MAXSTACK) ; i++)
+            {
+                  int db_index = pcand->Item(i);
+                  const ChartTableEntry &cte = GetChartTableEntry(db_index);
 
-            ChartTableEntry *pt = (ChartTableEntry *)&GetChartTableEntry(db_index);
+                  bool b_add = CheckPositionWithinChart(db_index, lat, lon);
 
-            if(CheckPositionWithinChart(db_index, lat, lon)  &&  (j < MAXSTACK) )
-            {
-                  j++;
-                  cstk->nEntry = j;
-                  cstk->SetDBIndex(j-1, db_index);
-            }
+                  //    Check the special case where chart spans the international dateline
+                  if(!b_add && (cte.GetLonMax() > 180.) && (cte.GetLonMin() < 180.))
+                        b_add = CheckPositionWithinChart(db_index, lat, lon + 360.);
 
-            //    Check the special case where chart spans the international dateline
-            else if( (pt->GetLonMax() > 180.) && (pt->GetLonMin() < 180.) )
-            {
-                  if(CheckPositionWithinChart(db_index, lat, lon + 360.)  &&  (j < MAXSTACK) )
+                  if(b_add)
                   {
                         j++;
                         cstk->nEntry = j;
                         cstk->SetDBIndex(j-1, db_index);
-
                   }
             }
       }
 
       cstk->nEntry = j;
-
-//    Sort the stack on scale
-      int swap = 1;
-      int ti;
-      while(swap == 1)
-      {
-            swap = 0;
-            for(i=0 ; i<j-1 ; i++)
-            {
-                  const ChartTableEntry &m = GetChartTableEntry(cstk->GetDBIndex(i));
-                  const ChartTableEntry &n = GetChartTableEntry(cstk->GetDBIndex(i+1));
-
-
-                  if(n.GetScale() < m.GetScale())
-                  {
-                        ti = cstk->GetDBIndex(i);
-                        cstk->SetDBIndex(i, cstk->GetDBIndex(i+1));
-                        cstk->SetDBIndex(i+1, ti);
-                        swap = 1;
-                  }
-            }
-      }
-
       cstk->b_valid = true;
 
       return j;
@@ -461,39 +655,7 @@ ArrayOfInts ChartDB::GetCSArray(ChartStack *ps)
 
 bool ChartDB::IsChartInCache(int dbindex)
 {
-/*
-      bool bInCache = false;
-      const ChartTableEntry &cte = GetChartTableEntry(dbindex);
-      wxString ChartFullPath(cte.GetpFullPath(), wxConvUTF8 );
-
-//    Search the cache
-
-      unsigned int nCache = pChartCache->GetCount();
-      for(unsigned int i=0 ; i<nCache ; i++)
-      {
-            CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
-            if(pce->FullPath == ChartFullPath)
-            {
-                  bInCache = true;
-                  break;
-            }
-      }
-*/
-      bool bInCache = false;
-
-//    Search the cache
-      unsigned int nCache = pChartCache->GetCount();
-      for(unsigned int i=0 ; i<nCache ; i++)
-      {
-            CacheEntry *pce = (CacheEntry *)(pChartCache->Item(i));
-            if(pce->dbIndex == dbindex)
-            {
-                  bInCache = true;
-                  break;
-            }
-      }
-
-      return bInCache;
+      return (NULL != FindCacheEntry(dbindex));
 }
 
 
@@ -524,206 +686,43 @@ ChartBase *ChartDB::OpenChartUsingCache(int dbindex, ChartInitFlag init_flag)
       ChartTypeEnum chart_type = (ChartTypeEnum)cte.GetChartType();
 
       ChartBase *Ch = NULL;
-      CacheEntry *pce;
-
-      wxDateTime now = wxDateTime::Now();                   // get time for LRU use
-
-      bool bInCache = false;
 
-//    Search the cache
+      CacheEntry *pce = FindCacheEntry(dbindex);
 
-      unsigned int nCache = pChartCache->GetCount();
-      for(unsigned int i=0 ; i<nCache ; i++)
+      if(pce)
       {
-            pce = (CacheEntry *)(pChartCache->Item(i));
-            if(pce->FullPath == ChartFullPath)
-            {
-                  Ch = (ChartBase *)pce->pChart;
-                  bInCache = true;
-                  break;
-            }
-      }
+          Ch = (ChartBase *)pce->pChart;
 
-      if(bInCache)
-      {
           if(FULL_INIT == init_flag)                            // asking for full init?
           {
               if(Ch->IsReadyToRender())
               {
-                    pce->RecentTime = now.GetTicks();           // chart is OK
+                    TouchCacheEntry(pce);                       // chart is OK
+                    UpdateCacheEntryFootprint(pce);
                     return Ch;
               }
               else
               {
-                    delete Ch;                                  // chart is not useable
-                    pChartCache->Remove(pce);                   // so remove it
-                    delete pce;
-                    bInCache = false;
+                    RemoveCacheEntry(pce);                      // chart is not useable
+                    DeleteCacheEntryChart(pce);                 // so remove it
+                    pce = NULL;
               }
           }
           else                                                  // assume if in cache, the chart can do thumbnails
           {
-               pce->RecentTime = now.GetTicks();
+               TouchCacheEntry(pce);
                return Ch;
           }
 
       }
 
-      if(!bInCache)                    // not in cache
+      if(NULL == pce)                  // not in cache
       {
-
-//#ifndef __WXMSW__       // for MSW, we assume the cache upper size limit is unbounded,
-                        // and so NEVER remove a chart from the cache
-
-#ifdef CACHE_MEM_LIMIT
-#define MEM_FREE_THRESHOLD    CACHE_MEM_LIMIT             // in KBytes
-
-          //    Check memory status to see if enough room to open another chart
-            int omem_total, omem_used;
-            pParent->GetMemoryStatus(omem_total, omem_used);
-            int omem_free = omem_total - omem_used;
-            if(omem_free < MEM_FREE_THRESHOLD)
-            {
-                  // Search the cache for oldest entry that is not Current_Ch
-                  unsigned int nCache = pChartCache->GetCount();
-                  if(nCache > 2)
-                  {
-                      wxLogMessage(_T("Searching chart cache for oldest entry"));
-                        int LRUTime = now.GetTicks();
-                        int iOldest = 0;
-                        for(unsigned int i=0 ; i<nCache ; i++)
-                        {
-                              pce = (CacheEntry *)(pChartCache->Item(i));
-                              if((ChartBase *)(pce->pChart) != Current_Ch)
-                              {
-                                    if(pce->RecentTime < LRUTime)
-                                    {
-                                          LRUTime = pce->RecentTime;
-                                          iOldest = i;
-                                    }
-                              }
-                        }
-                      int dt = now.GetTicks() - LRUTime;
-                      wxLogMessage(_T("Oldest cache index is %d, delta t is %d"), iOldest, dt);
-
-                        pce = (CacheEntry *)(pChartCache->Item(iOldest));
-                        ChartBase *pDeleteCandidate =  (ChartBase *)(pce->pChart);
-
-                        if(Current_Ch == pDeleteCandidate)
-                        {
-                            wxLogMessage(_T("...However, it is Current_Ch"));
-                        }
-                        else
-                        {
-                            wxLogMessage(_T("Deleting/Removing oldest chart from cache"));
-//                            wxLogMessage(_T("oMem_Free before chart removal is %d"), omem_free);
-
-                              //  If this chart should happen to be in the thumbnail window....
-                              if(pthumbwin)
-                              {
-                                    if(pthumbwin->pThumbChart == pDeleteCandidate)
-                                          pthumbwin->pThumbChart = NULL;
-                              }
-
-                              //    Delete the chart
-                              delete pDeleteCandidate;
-
-                              //remove the cache entry
-                              pChartCache->Remove(pce);
-
-                              pParent->GetMemoryStatus(omem_total, omem_used);
-//                            int omem_free = omem_total - omem_used;
-//                            wxLogMessage(_T("oMem_Free after chart removal is %d"), omem_free);
-
-                        }
-                  }
-            }
-
-#endif      //CACHE_MEM_LIMIT
-
-#ifdef CACHE_N_LIMIT_DEFAULT
-//#define N_CACHE CACHE_N_LIMIT
-
-//      Limit cache to n charts, tossing out the oldest when space is needed
-            unsigned int nCache = pChartCache->GetCount();
-            if(nCache >= (unsigned int)g_nCacheLimit)
-            {
-
- ///                  wxLogMessage("Searching chart cache for oldest entry");
-                  int LRUTime = now.GetTicks();
-                  int iOldest = 0;
-                  for(unsigned int i=0 ; i<nCache ; i++)
-                  {
-                        pce = (CacheEntry *)(pChartCache->Item(i));
-                        if((ChartBase *)(pce->pChart) != Current_Ch)
-                        {
-                              if(pce->RecentTime < LRUTime)
-                              {
-                                    LRUTime = pce->RecentTime;
-                                    iOldest = i;
-                              }
-                        }
-                  }
-
-                  pce = (CacheEntry *)(pChartCache->Item(iOldest));
-                  ChartBase *pDeleteCandidate =  (ChartBase *)(pce->pChart);
-
-/*
-                  // Discard the smallest scale chart
-                  int i_smallest_scale = nCache-1;
-                  int scale_highest = 0;
-                  for(unsigned int i=0 ; i<nCache ; i++)
-                  {
-                        pce = (CacheEntry *)(pChartCache->Item(i));
-                        if((ChartBase *)(pce->pChart) != Current_Ch)
-                        {
-                              ChartBase *pc = (ChartBase *)pce->pChart;
-                              if(pc)
-                              {
-                                    if(pc->GetNativeScale() > scale_highest)
-                                    {
-                                          i_smallest_scale = i;
-                                          scale_highest = pc->GetNativeScale();
-                                    }
-                              }
-                        }
-                  }
-
-                  pce = (CacheEntry *)(pChartCache->Item(i_smallest_scale));
-                  ChartBase *pDeleteCandidate =  (ChartBase *)(pce->pChart);
-
-*/
-                  if(Current_Ch != pDeleteCandidate)
-                  {
-///                      wxLogMessage("Deleting/Removing oldest chart from cache");
-///                      wxLogMessage("oMem_Free before chart removal is %d", omem_free);
-
-                    //  If this chart should happen to be in the thumbnail window....
-                        if(pthumbwin)
-                        {
-                              if(pthumbwin->pThumbChart == pDeleteCandidate)
-                                    pthumbwin->pThumbChart = NULL;
-                        }
-
-                   //    Delete the chart
-                        delete pDeleteCandidate;
-
-                   //remove the cache entry
-                        pChartCache->Remove(pce);
-
-                        if(pthumbwin)
-                        {
-                              if(pthumbwin->pThumbChart == pDeleteCandidate)
-                                    pthumbwin->pThumbChart = NULL;
-                        }
-
-                  }
-            }
-#endif      //CACHE_N_LIMIT
-
-
-
-//#endif      // ndef __WXMSW__
+            //    Make room for the new chart.
+            //    Normally the memory footprint timer keeps the cache below its budget,
+            //    so this only has work to do when charts are opened faster than that.
+            unsigned int max_entries = (unsigned int)wxMax(g_nCacheLimit - 1, 1);
+            TrimCache(GetChartCacheMemoryBudget(), max_entries);
 
             if(chart_type == CHART_TYPE_KAP)
                   Ch = new ChartKAP();
@@ -878,9 +877,8 @@ ChartBase *ChartDB::OpenChartUsingCache(int dbindex, ChartInitFlag init_flag)
                               pce->FullPath = ChartFullPath;
                               pce->pChart = Ch;
                               pce->dbIndex = dbindex;
-                              pce->RecentTime = now.GetTicks();
 
-                              pChartCache->Add((void *)pce);
+                              AddCacheEntry(pce);
                         }
                   }
                   else if(INIT_FAIL_REMOVE == ir)                 // some problem in chart Init()
@@ -936,36 +934,18 @@ bool ChartDB::DeleteCacheChart(ChartBase *pDeleteCandidate)
       {
 
             // Find the chart in the cache
-            CacheEntry *pce = NULL;
-            for(unsigned int i=0 ; i< pChartCache->GetCount() ; i++)
+            CacheEntry *pce = m_pCacheMRU;
+            while(pce)
             {
-                  pce = (CacheEntry *)(pChartCache->Item(i));
                   if((ChartBase *)(pce->pChart) == pDeleteCandidate)
-                  {
                         break;
-                  }
+                  pce = pce->pLRUNext;
             }
 
             if(pce)
             {
-                        //  If this chart should happen to be in the thumbnail window....
-                  if(pthumbwin)
-                  {
-                        if(pthumbwin->pThumbChart == pDeleteCandidate)
-                              pthumbwin->pThumbChart = NULL;
-                  }
-
-                        //    Delete the chart
-                  delete pDeleteCandidate;
-
-                        //remove the cache entry
-                  pChartCache->Remove(pce);
-
-                  if(pthumbwin)
-                  {
-                        if(pthumbwin->pThumbChart == pDeleteCandidate)
-                              pthumbwin->pThumbChart = NULL;
-                  }
+                  RemoveCacheEntry(pce);
+                  DeleteCacheEntryChart(pce);
 
                   return true;
             }
@@ -978,18 +958,15 @@ bool ChartDB::DeleteCacheChart(ChartBase *pDeleteCandidate)
 */
 void ChartDB::ApplyColorSchemeToCachedCharts(ColorScheme cs)
 {
-      ChartBase *Ch;
-      CacheEntry *pce;
-     //    Search the cache
-
-      unsigned int nCache = pChartCache->GetCount();
-      for(unsigned int i=0 ; i<nCache ; i++)
+     //    Walk the cache
+      CacheEntry *pce = m_pCacheMRU;
+      while(pce)
       {
-            pce = (CacheEntry *)(pChartCache->Item(i));
-            Ch = (ChartBase *)pce->pChart;
+            ChartBase *Ch = (ChartBase *)pce->pChart;
             if(Ch)
                   Ch->SetColorScheme(cs, true);
 
+            pce = pce->pLRUNext;
       }
 }
 
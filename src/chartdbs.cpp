@@ -38,6 +38,8 @@
 #include <wx/regex.h>
 #include <wx/progdlg.h>
 
+#include <math.h>
+
 #include "chartdbs.h"
 #include "chartbase.h"
 #include "pluginmanager.h"
@@ -525,6 +527,165 @@ void ChartTableEntry::Disable()
 WX_DEFINE_OBJARRAY(ChartTable);
 WX_DEFINE_OBJARRAY(ArrayOfChartClassDescriptor);
 
+///////////////////////////////////////////////////////////////////////
+// ChartGridIndex
+///////////////////////////////////////////////////////////////////////
+
+typedef struct {
+      int   scale;
+      int   dbIndex;
+} ChartScaleSortItem;
+
+static int CompareChartScaleSortItem(const void *p1, const void *p2)
+{
+      const ChartScaleSortItem *a = (const ChartScaleSortItem *)p1;
+      const ChartScaleSortItem *b = (const ChartScaleSortItem *)p2;
+
+      if(a->scale != b->scale)
+            return (a->scale < b->scale) ? -1 : 1;
+
+      //    Equal scales keep database order, same as the old bubble sort
+      return a->dbIndex - b->dbIndex;
+}
+
+ChartGridIndex::ChartGridIndex()
+{
+      m_pCells = NULL;
+}
+
+ChartGridIndex::~ChartGridIndex()
+{
+      Clear();
+}
+
+void ChartGridIndex::Clear()
+{
+      if(m_pCells)
+      {
+            for(int i=0 ; i < CHART_GRID_NLAT * CHART_GRID_NLON ; i++)
+                  delete m_pCells[i];
+            delete[] m_pCells;
+            m_pCells = NULL;
+      }
+}
+
+int ChartGridIndex::GetLonCell(int ilon) const
+{
+      //    Wrap into 0..359, with cell 0 at -180 degrees
+      int cell = (ilon + 180) % CHART_GRID_NLON;
+      if(cell < 0)
+            cell += CHART_GRID_NLON;
+      return cell;
+}
+
+bool ChartGridIndex::GetCellRange(const ChartTableEntry &cte, int *lat_start, int *lat_end, int *lon_start, int *n_lon) const
+{
+      float lat_min = cte.GetLatMin();
+      float lat_max = cte.GetLatMax();
+
+      //    Disabled charts carry an absurd latitude range, and are never indexed
+      if((lat_min > 90.) || (lat_max < -90.) || (lat_min > lat_max))
+            return false;
+
+      int la0 = (int)floor(wxMax(lat_min, -90.)) + 90;
+      int la1 = (int)floor(wxMin(lat_max, 90.)) + 90;
+      *lat_start = wxMax(0, wxMin(la0, CHART_GRID_NLAT - 1));
+      *lat_end   = wxMax(0, wxMin(la1, CHART_GRID_NLAT - 1));
+
+      //    Charts spanning the dateline (LonMax > 180) simply wrap around the grid
+      int lo0 = (int)floor(cte.GetLonMin());
+      int lo1 = (int)floor(cte.GetLonMax());
+      if(lo1 < lo0)
+            return false;
+
+      *lon_start = lo0;
+      *n_lon = wxMin(lo1 - lo0 + 1, CHART_GRID_NLON);
+
+      return true;
+}
+
+void ChartGridIndex::Build(const ChartTable &table)
+{
+      Clear();
+
+      m_pCells = new wxArrayInt *[CHART_GRID_NLAT * CHART_GRID_NLON];
+      memset(m_pCells, 0, CHART_GRID_NLAT * CHART_GRID_NLON * sizeof(wxArrayInt *));
+
+      int nEntry = table.GetCount();
+      if(0 == nEntry)
+            return;
+
+      //    Insert in scale order, so that every cell list comes out sorted
+      ChartScaleSortItem *psort = new ChartScaleSortItem[nEntry];
+      for(int i=0 ; i < nEntry ; i++)
+      {
+            psort[i].scale = table[i].GetScale();
+            psort[i].dbIndex = i;
+      }
+      qsort(psort, nEntry, sizeof(ChartScaleSortItem), CompareChartScaleSortItem);
+
+      for(int i=0 ; i < nEntry ; i++)
+      {
+            int dbIndex = psort[i].dbIndex;
+            int lat_start, lat_end, lon_start, n_lon;
+            if(!GetCellRange(table[dbIndex], &lat_start, &lat_end, &lon_start, &n_lon))
+                  continue;
+
+            for(int ilat = lat_start ; ilat <= lat_end ; ilat++)
+            {
+                  for(int k=0 ; k < n_lon ; k++)
+                  {
+                        int icell = (ilat * CHART_GRID_NLON) + GetLonCell(lon_start + k);
+                        if(NULL == m_pCells[icell])
+                              m_pCells[icell] = new wxArrayInt;
+                        m_pCells[icell]->Add(dbIndex);
+                  }
+            }
+      }
+
+      delete[] psort;
+}
+
+void ChartGridIndex::Remove(int dbIndex, const ChartTableEntry &cte)
+{
+      if(!m_pCells)
+            return;
+
+      int lat_start, lat_end, lon_start, n_lon;
+      if(!GetCellRange(cte, &lat_start, &lat_end, &lon_start, &n_lon))
+            return;
+
+      for(int ilat = lat_start ; ilat <= lat_end ; ilat++)
+      {
+            for(int k=0 ; k < n_lon ; k++)
+            {
+                  wxArrayInt *pcell = m_pCells[(ilat * CHART_GRID_NLON) + GetLonCell(lon_start + k)];
+                  if(pcell && (pcell->Index(dbIndex) != wxNOT_FOUND))
+                        pcell->Remove(dbIndex);
+            }
+      }
+}
+
+//    Returns the scale-sorted list of charts which may contain lat/lon, or NULL if none
+const wxArrayInt *ChartGridIndex::GetCandidates(float lat, float lon) const
+{
+      if(!m_pCells)
+            return NULL;
+
+      int ilat = (int)floor(lat) + 90;
+      if((ilat < 0) || (ilat > CHART_GRID_NLAT))
+            return NULL;
+      if(ilat == CHART_GRID_NLAT)                     // exactly at the pole
+            ilat--;
+
+      return m_pCells[(ilat * CHART_GRID_NLON) + GetLonCell((int)floor(lon))];
+}
+
+
+///////////////////////////////////////////////////////////////////////
+// ChartDatabase
+///////////////////////////////////////////////////////////////////////
+
 ChartDatabase::ChartDatabase()
 {
       m_ChartTableEntryDummy.Clear();
@@ -632,6 +793,7 @@ bool ChartDatabase::Read(const wxString &filePath)
         chartTable.Add(entry);
 
     entry.Clear();
+    m_GridIndex.Build(chartTable);
     bValid = true;
     return true;
 
@@ -933,6 +1095,9 @@ bool ChartDatabase::Update(ArrayOfCDI& dir_array, bool bForce, wxProgressDialog
       for(unsigned int i=0 ; i<chartTable.GetCount() ; i++)
             chartTable[i].SetEntryOffset( i );
 
+      //    dbIndex values may have moved, so rebuild the spatial index
+      m_GridIndex.Build(chartTable);
+
 
       bValid = true;
       return true;
@@ -970,6 +1135,7 @@ int ChartDatabase::DisableChart(wxString& PathToDisable)
             if(PathToDisable.IsSameAs(wxString(chartTable[i].GetpFullPath(), wxConvUTF8)))
             {
                   ChartTableEntry *pentry = &chartTable[i];
+                  m_GridIndex.Remove(i, *pentry);
                   pentry->Disable();
 
                   return 1;
@@ -1298,6 +1464,7 @@ int ChartDatabase::SearchDirAndAddCharts(wxString& dir_name_base,
 
 
       int nDirEntry = 0;
+      int first_new_index = chartTable.GetCount();
 
       //    Check to see if there are any charts in the DB which refer to this directory
       //    If none at all, there is no need to scan the DB for fullpath match of each potential addition
@@ -1429,6 +1596,9 @@ int ChartDatabase::SearchDirAndAddCharts(wxString& dir_name_base,
             }
       }
 
+      if(nDirEntry)
+            PrebuildNewCharts(first_new_index, pprog);
+
       return nDirEntry;
 }
 
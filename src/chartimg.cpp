@@ -58,6 +58,12 @@
 #include "chartimg.h"
 #include "ocpn_pixel.h"
 
+#ifdef ocpnUSE_RASTER_MMAP
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #ifndef __WXMSW__
 #include <signal.h>
 #include <setjmp.h>
@@ -97,6 +103,8 @@ class MyConfig;
 extern MyConfig        *pConfig;
 #endif
 
+extern wxString        g_SENCPrefix;
+
 typedef struct  {
       float y;
       float x;
@@ -1341,6 +1349,9 @@ ChartBaseBSB::ChartBaseBSB()
 
       pBitmapFilePath = NULL;
 
+      m_pImageMap = NULL;
+      m_nImageMapSize = 0;
+
       pline_table = NULL;
       ifs_buf = NULL;
 
@@ -1362,6 +1373,9 @@ ChartBaseBSB::ChartBaseBSB()
       pPixCache = NULL;
 
       pLineCache = NULL;
+      m_nLineCacheBytes = 0;
+
+      m_bHasSSE2 = ocpnCPUHasSSE2();
 
       m_bilinear_limit = 8;         // bilinear scaling only up to n
 
@@ -1416,6 +1430,8 @@ ChartBaseBSB::~ChartBaseBSB()
       free(pRefTable);
 //      free(pPlyTable);
 
+      UnmapImageFile();
+
       delete ifs_bitmap;
       delete ifs_hdr;
       delete ifss_bitmap;
@@ -1618,66 +1634,105 @@ InitReturn ChartBaseBSB::PostInit(void)
       ifs_file_offset = -ifs_bufsize;
 
 
+      //    Map the raster image, if possible.
+      //    Failure is not fatal, we just fall back to stream access
+      if(pBitmapFilePath)
+            MapImageFile(*pBitmapFilePath);
+      else
+            MapImageFile(m_FullPath);
+
       //    Create and load the line offset index table
       pline_table = NULL;
       pline_table = (int *)malloc((Size_Y+1) * sizeof(int) );               //Ugly....
       if(!pline_table)
             return INIT_FAIL_REMOVE;
 
-      ifs_bitmap->SeekI((Size_Y+1) * -4, wxFromEnd);                 // go to Beginning of offset table
-      pline_table[Size_Y] = ifs_bitmap->TellI();                     // fill in useful last table entry
+      if(m_pImageMap)
+      {
+            if((size_t)((Size_Y+1) * 4) > m_nImageMapSize)
+                  return INIT_FAIL_REMOVE;
 
-      int offset;
-      for(int ifplt=0 ; ifplt<Size_Y ; ifplt++)
+            unsigned char *pt = m_pImageMap + m_nImageMapSize - ((Size_Y+1) * 4);   // Beginning of offset table
+            pline_table[Size_Y] = pt - m_pImageMap;                                 // fill in useful last table entry
+
+            for(int ifplt=0 ; ifplt<Size_Y ; ifplt++)
+            {
+                  pline_table[ifplt] = (pt[0] << 24) + (pt[1] << 16) + (pt[2] << 8) + pt[3];
+                  pt += 4;
+            }
+      }
+      else
       {
-          offset = 0;
-          offset += (unsigned char)ifs_bitmap->GetC() * 256 * 256 * 256;
-          offset += (unsigned char)ifs_bitmap->GetC() * 256 * 256 ;
-          offset += (unsigned char)ifs_bitmap->GetC() * 256 ;
-          offset += (unsigned char)ifs_bitmap->GetC();
+            ifs_bitmap->SeekI((Size_Y+1) * -4, wxFromEnd);                 // go to Beginning of offset table
+            pline_table[Size_Y] = ifs_bitmap->TellI();                     // fill in useful last table entry
+
+            int offset;
+            for(int ifplt=0 ; ifplt<Size_Y ; ifplt++)
+            {
+                offset = 0;
+                offset += (unsigned char)ifs_bitmap->GetC() * 256 * 256 * 256;
+                offset += (unsigned char)ifs_bitmap->GetC() * 256 * 256 ;
+                offset += (unsigned char)ifs_bitmap->GetC() * 256 ;
+                offset += (unsigned char)ifs_bitmap->GetC();
 
-          pline_table[ifplt] = offset;
+                pline_table[ifplt] = offset;
+            }
       }
 
       //    Try to validate the line index
 
-      bool bline_index_ok = true;
+      bool bline_index_ok = IsLineIndexValid(pline_table);
       m_nLineOffset = 0;
 
-      for(int iplt=0 ; iplt<Size_Y - 1 ; iplt++)
+      for(int iplt=0 ; bline_index_ok && (iplt < Size_Y) ; iplt++)
       {
-            if( wxInvalidOffset == ifs_bitmap->SeekI(pline_table[iplt], wxFromStart))
+            int thisline_size = pline_table[iplt+1] - pline_table[iplt] ;
+            unsigned char *lp;
+
+            if(m_pImageMap)
             {
-                  wxString msg(_("   Chart File corrupt in PostInit() on chart "));
-                  msg.Append(m_FullPath);
-                  wxLogMessage(msg);
+                  //    An offset outside of the file means a damaged index, not damaged data
+                  if((thisline_size <= 0) || (pline_table[iplt] < 0) || ((size_t)pline_table[iplt+1] > m_nImageMapSize))
+                  {
+                        bline_index_ok = false;
+                        break;
+                  }
 
-                  return INIT_FAIL_REMOVE;
+                  lp = m_pImageMap + pline_table[iplt];
             }
+            else
+            {
+                  if( wxInvalidOffset == ifs_bitmap->SeekI(pline_table[iplt], wxFromStart))
+                  {
+                        wxString msg(_("   Chart File corrupt in PostInit() on chart "));
+                        msg.Append(m_FullPath);
+                        wxLogMessage(msg);
 
-            int thisline_size = pline_table[iplt+1] - pline_table[iplt] ;
+                        return INIT_FAIL_REMOVE;
+                  }
 
-            if(thisline_size < 0)
-            {
-                  wxString msg(_("   Chart File corrupt in PostInit() on chart "));
-                  msg.Append(m_FullPath);
-                  wxLogMessage(msg);
+                  if(thisline_size < 0)
+                  {
+                        wxString msg(_("   Chart File corrupt in PostInit() on chart "));
+                        msg.Append(m_FullPath);
+                        wxLogMessage(msg);
 
-                  return INIT_FAIL_REMOVE;
-            }
+                        return INIT_FAIL_REMOVE;
+                  }
 
-            if(thisline_size > ifs_bufsize)
-            {
-                  wxString msg(_T("   ifs_bufsize too small PostInit() on chart "));
-                  msg.Append(m_FullPath);
-                  wxLogMessage(msg);
+                  if(thisline_size > ifs_bufsize)
+                  {
+                        wxString msg(_T("   ifs_bufsize too small PostInit() on chart "));
+                        msg.Append(m_FullPath);
+                        wxLogMessage(msg);
 
-                  return INIT_FAIL_REMOVE;
-            }
+                        return INIT_FAIL_REMOVE;
+                  }
 
-            ifs_bitmap->Read(ifs_buf, thisline_size);
+                  ifs_bitmap->Read(ifs_buf, thisline_size);
 
-            unsigned char *lp = ifs_buf;
+                  lp = ifs_buf;
+            }
 
             unsigned char byNext;
             int nLineMarker = 0;
@@ -1715,7 +1770,8 @@ InitReturn ChartBaseBSB::PostInit(void)
       }
 */
         // Recreate the scan line index if the embedded version seems corrupt
-      if(!bline_index_ok)
+        // A previously recreated index may be waiting in the sidecar file
+      if(!bline_index_ok && !LoadLineIndex())
       {
           wxString msg(_("   Line Index corrupt, recreating Index for chart "));
           msg.Append(m_FullPath);
@@ -1727,6 +1783,8 @@ InitReturn ChartBaseBSB::PostInit(void)
                 wxLogMessage(msg);
                 return INIT_FAIL_REMOVE;
           }
+
+          SaveLineIndex();
       }
 
 
@@ -1790,6 +1848,20 @@ InitReturn ChartBaseBSB::PostInit(void)
 
 bool ChartBaseBSB::CreateLineIndex()
 {
+    if(m_pImageMap)
+    {
+          unsigned char *lp = m_pImageMap + nFileOffsetDataStart;
+          unsigned char *lp_end = m_pImageMap + m_nImageMapSize;
+
+          for(int iplt=0 ; iplt<Size_Y ; iplt++)
+          {
+                pline_table[iplt] = lp - m_pImageMap;
+                lp = BSBSkipScanline(lp, lp_end);
+          }
+
+          return true;
+    }
+
     //  Assumes file stream ifs_bitmap is currently open
 
 //    wxBufferedInputStream *pbis = new wxBufferedInputStream(*ifss_bitmap);
@@ -1853,6 +1925,24 @@ void ChartBaseBSB::InvalidateLineCache(void)
                   }
             }
       }
+
+      m_nLineCacheBytes = 0;
+}
+
+size_t ChartBaseBSB::GetMemoryFootprint()
+{
+      size_t size = m_nLineCacheBytes;
+
+      if(pLineCache)
+            size += Size_Y * sizeof(CachedLine);
+
+      if(pline_table)
+            size += (Size_Y + 1) * sizeof(int);
+
+      if(pPixCache)
+            size += pPixCache->GetLinePitch() * pPixCache->GetHeight();
+
+      return size;
 }
 
 bool ChartBaseBSB::GetChartExtent(Extent *pext)
@@ -3567,173 +3657,226 @@ bool ChartBaseBSB::GetView( wxRect& source, wxRect& dest, ScaleTypeEnum scale_ty
 }
 
 
-bool ChartBaseBSB::GetAndScaleData(unsigned char *ppn, wxRect& source, int source_stride,
-                                   wxRect& dest, int dest_stride, double scale_factor, ScaleTypeEnum scale_type)
+class ChartBaseBSBScaleThread;
+
+//-----------------------------------------------------------------------
+//    One row band of a ChartBaseBSB::GetAndScaleData() downsample
+//-----------------------------------------------------------------------
+class ChartBaseBSBScaleJob
 {
+public:
+      void Run()
+      {
+            m_pchart->ScaleRowBand(m_ppn, m_source, m_dest, m_dest_stride, m_scale_factor, m_scale_type,
+                                   m_y_start, m_y_end, m_pWorkLine);
+      }
 
-      unsigned char *s_data = NULL;
+      ChartBaseBSB      *m_pchart;
+      unsigned char     *m_ppn;
+      wxRect            m_source;
+      wxRect            m_dest;
+      int               m_dest_stride;
+      double            m_scale_factor;
+      ScaleTypeEnum     m_scale_type;
+      int               m_y_start;
+      int               m_y_end;
+      unsigned char     *m_pWorkLine;
+};
 
-      double factor = scale_factor;
-      int Factor =  (int)factor;
+//-----------------------------------------------------------------------
+//    Row band threads, shared by all raster charts
+//    Started on the first banded render, and kept until
+//    ChartBaseBSB::ShutdownScaleThreads() at exit.
+//    Jobs are only ever submitted from the GUI thread.
+//-----------------------------------------------------------------------
+class ChartBaseBSBScalePool
+{
+public:
+      ChartBaseBSBScalePool();
+      ~ChartBaseBSBScalePool();
 
-      int target_width = (int)wxRound((double)source.width  / factor) ;
-      int target_height = (int)wxRound((double)source.height / factor);
+      int GetThreadCount(){ return m_nthreads; }
 
+      //    Run pjobs[1..n_jobs-1] on the pool and pjobs[0] here, and wait for all of them
+      void RunJobs(ChartBaseBSBScaleJob *pjobs, int n_jobs);
 
-      if((target_height == 0) || (target_width == 0))
-            return false;
+      //    Worker thread interface
+      ChartBaseBSBScaleJob *WaitForJob();
+      void JobDone(){ m_done_semaphore.Post(); }
 
-      unsigned char *target_data = ppn;
-      unsigned char *data = ppn;
+private:
+      ChartBaseBSBScaleThread *m_pthreads[MAX_RASTER_SCALE_THREADS];
+      int               m_nthreads;
 
-      if(factor > 1)                // downsampling
+      wxMutex           m_mutex;
+      wxSemaphore       m_job_semaphore;
+      wxSemaphore       m_done_semaphore;
+      ChartBaseBSBScaleJob *m_pjobs[MAX_RASTER_SCALE_THREADS];
+      int               m_njobs;                // jobs waiting for a thread
+      bool              m_bstop;
+};
+
+class ChartBaseBSBScaleThread: public wxThread
+{
+public:
+      ChartBaseBSBScaleThread(ChartBaseBSBScalePool *ppool)
+            : wxThread(wxTHREAD_JOINABLE)
       {
+            m_ppool = ppool;
+      }
 
-            if(scale_type == RENDER_HIDEF)
+      void *Entry()
+      {
+            ChartBaseBSBScaleJob *pjob;
+            while((pjob = m_ppool->WaitForJob()) != NULL)
             {
-//    Allocate a working buffer based on scale factor
-                  int blur_factor = wxMax(2, Factor);
-                  int wb_size = (source.width) * (blur_factor * 2) * BPP/8 ;
-                  s_data = (unsigned char *) malloc( wb_size ); // work buffer
-                  unsigned char *pixel;
-                  int y_offset;
+                  pjob->Run();
+                  m_ppool->JobDone();
+            }
+            return 0;
+      }
 
-                  for (int y = dest.y; y < (dest.y + dest.height); y++)
-                  {
-                  //    Read "blur_factor" lines
+private:
+      ChartBaseBSBScalePool   *m_ppool;
+};
 
-                        wxRect s1;
-                        s1.x = source.x;
-                        s1.y = source.y  + (int)(y * factor);
-                        s1.width = source.width;
-                        s1.height = blur_factor;
-                        GetChartBits(s1, s_data, 1);
+static ChartBaseBSBScalePool *s_pScalePool;
 
-                        target_data = data + (y * dest_stride * BPP/8);
+ChartBaseBSBScalePool::ChartBaseBSBScalePool()
+{
+      m_nthreads = 0;
+      m_njobs = 0;
+      m_bstop = false;
 
-                        for (int x = 0; x < target_width; x++)
-                        {
-                              unsigned int avgRed = 0 ;
-                              unsigned int avgGreen = 0;
-                              unsigned int avgBlue = 0;
-                              unsigned int pixel_count = 0;
-                              unsigned char *pix0 = s_data +  BPP/8 * ((int)( x * factor )) ;
-                              y_offset = 0;
+      //    The submitting thread always takes a band itself
+      int n_wanted = wxMin(wxThread::GetCPUCount(), MAX_RASTER_SCALE_THREADS) - 1;
 
-                              if((x * Factor) < (Size_X - source.x))
-                              {
-            // determine average
-                                    for ( int y1 = 0 ; y1 < blur_factor ; ++y1 )
-                                    {
-                                        pixel = pix0 + (BPP/8 * y_offset ) ;
-                                        for ( int x1 = 0 ; x1 < blur_factor ; ++x1 )
-                                        {
-                                            avgRed   += pixel[0] ;
-                                            avgGreen += pixel[1] ;
-                                            avgBlue  += pixel[2] ;
-
-                                            pixel += BPP/8;
-
-                                            pixel_count++;
-                                        }
-                                        y_offset += source.width ;
-                                    }
+      for(int it=0 ; it < n_wanted ; it++)
+      {
+            ChartBaseBSBScaleThread *pt = new ChartBaseBSBScaleThread(this);
+            if((pt->Create() != wxTHREAD_NO_ERROR) || (pt->Run() != wxTHREAD_NO_ERROR))
+            {
+                  delete pt;
+                  break;
+            }
+            m_pthreads[m_nthreads++] = pt;
+      }
+}
 
-                                    target_data[0] = avgRed / pixel_count;     // >> scounter;
-                                    target_data[1] = avgGreen / pixel_count;   // >> scounter;
-                                    target_data[2] = avgBlue / pixel_count;    // >> scounter;
-                                    target_data += BPP/8;
-                              }
-                              else
-                              {
-                                    target_data[0] = 0;
-                                    target_data[1] = 0;
-                                    target_data[2] = 0;
-                                    target_data += BPP/8;
-                              }
+ChartBaseBSBScalePool::~ChartBaseBSBScalePool()
+{
+      {
+            wxMutexLocker lock(m_mutex);
+            m_bstop = true;
+      }
 
-                        }  // for x
+      for(int it=0 ; it < m_nthreads ; it++)
+            m_job_semaphore.Post();
 
-                  }  // for y
+      for(int it=0 ; it < m_nthreads ; it++)
+      {
+            m_pthreads[it]->Wait();
+            delete m_pthreads[it];
+      }
+}
 
-            }           // SCALE_BILINEAR
+void ChartBaseBSBScalePool::RunJobs(ChartBaseBSBScaleJob *pjobs, int n_jobs)
+{
+      {
+            wxMutexLocker lock(m_mutex);
+            for(int i=1 ; i < n_jobs ; i++)
+                  m_pjobs[m_njobs++] = &pjobs[i];
+      }
 
-            else if (scale_type == RENDER_LODEF)
-            {
-                        int get_bits_submap = 1;
+      for(int i=1 ; i < n_jobs ; i++)
+            m_job_semaphore.Post();
 
-                        int scaler = 16;
+      pjobs[0].Run();
 
-                        if(source.width > 32767)                  // High underscale can exceed signed math bits
-                              scaler = 8;
+      for(int i=1 ; i < n_jobs ; i++)
+            m_done_semaphore.Wait();
+}
 
-                        int wb_size = (Size_X) * ((/*Factor +*/ 1) * 2) * BPP/8 ;
-                        s_data = (unsigned char *) malloc( wb_size ); // work buffer
+//    Blocks until there is a job, or returns NULL when stopping
+ChartBaseBSBScaleJob *ChartBaseBSBScalePool::WaitForJob()
+{
+      m_job_semaphore.Wait();
 
-                        long x_delta = (source.width<<scaler) / target_width;
-                        long y_delta = (source.height<<scaler) / target_height;
+      wxMutexLocker lock(m_mutex);
+      if(m_bstop || !m_njobs)
+            return NULL;
 
-                        int y = dest.y;                // starting here
-                        long ys = dest.y * y_delta;
+      return m_pjobs[--m_njobs];
+}
 
-                        while ( y < dest.y + dest.height)
-                        {
-                        //    Read 1 line at the right place from the source
+void ChartBaseBSB::ShutdownScaleThreads(void)
+{
+      delete s_pScalePool;
+      s_pScalePool = NULL;
+}
 
-                              wxRect s1;
-                              s1.x = 0;
-                              s1.y = source.y + (ys >> scaler);
-                              s1.width = Size_X;
-                              s1.height = 1;
-                              GetChartBits(s1, s_data, get_bits_submap);
 
-                              target_data = data + (y * dest_stride * BPP/8) + (dest.x * BPP / 8);
 
-                              long x = (source.x << scaler) + (dest.x * x_delta);
-                              long sizex16 = Size_X << scaler;
-                              int xt = dest.x;
+bool ChartBaseBSB::GetAndScaleData(unsigned char *ppn, wxRect& source, int source_stride,
+                                   wxRect& dest, int dest_stride, double scale_factor, ScaleTypeEnum scale_type)
+{
 
-                              while((xt < dest.x + dest.width) && (x < 0))
-                              {
-                                    target_data[0] = 0;
-                                    target_data[1] = 0;
-                                    target_data[2] = 0;
+      unsigned char *s_data = NULL;
 
-                                    target_data += BPP/8;
-                                    x += x_delta;
-                                    xt++;
-                              }
+      double factor = scale_factor;
+
+      int target_width = (int)wxRound((double)source.width  / factor) ;
+      int target_height = (int)wxRound((double)source.height / factor);
 
-                              while ((xt < dest.x + dest.width) && ( x < sizex16))
-                              {
 
-                                    unsigned char* src_pixel = &s_data[(x>>scaler)*BPP/8];
+      if((target_height == 0) || (target_width == 0))
+            return false;
 
-                                    target_data[0] = src_pixel[0];
-                                    target_data[1] = src_pixel[1];
-                                    target_data[2] = src_pixel[2];
+      unsigned char *target_data = ppn;
 
-                                    target_data += BPP/8;
-                                    x += x_delta;
-                                    xt++;
-                              }
+      if(factor > 1)                // downsampling
+      {
+            int n_threads = GetScaleThreadCount(dest.height);
 
-                              while(xt < dest.x + dest.width)
-                              {
-                                    target_data[0] = 0;
-                                    target_data[1] = 0;
-                                    target_data[2] = 0;
+            if(n_threads > 1)
+            {
+                  //    Split the destination into row bands, one per thread.
+                  //    Each band has its own work buffers, so the result is the
+                  //    same as the serial path, row for row.
+                  ChartBaseBSBScaleJob jobs[MAX_RASTER_SCALE_THREADS];
+                  int n_jobs = 0;
 
-                                    target_data += BPP/8;
-                                    xt++;
-                              }
+                  int band_height = (dest.height + n_threads - 1) / n_threads;
 
-                              y++;
-                              ys += y_delta;
-                        }
+                  for(int it=0 ; it < n_threads ; it++)
+                  {
+                        int y_start = dest.y + (it * band_height);
+                        int y_end = wxMin(y_start + band_height, dest.y + dest.height);
+
+                        if(y_start >= y_end)
+                              break;
 
-            }     // SCALE_SUBSAMP
+                        ChartBaseBSBScaleJob *pjob = &jobs[n_jobs++];
+                        pjob->m_pchart = this;
+                        pjob->m_ppn = ppn;
+                        pjob->m_source = source;
+                        pjob->m_dest = dest;
+                        pjob->m_dest_stride = dest_stride;
+                        pjob->m_scale_factor = factor;
+                        pjob->m_scale_type = scale_type;
+                        pjob->m_y_start = y_start;
+                        pjob->m_y_end = y_end;
+                        pjob->m_pWorkLine = (unsigned char *)malloc(Size_X);
+                  }
 
+                  s_pScalePool->RunJobs(jobs, n_jobs);
+
+                  for(int it=0 ; it < n_jobs ; it++)
+                        free(jobs[it].m_pWorkLine);
+            }
+            else
+                  ScaleRowBand(ppn, source, dest, dest_stride, factor, scale_type,
+                               dest.y, dest.y + dest.height, NULL);
       }
       else  //factor < 1, overzoom
       {
@@ -3854,7 +3997,249 @@ bool ChartBaseBSB::GetAndScaleData(unsigned char *ppn, wxRect& source, int sourc
 
 
 
-bool ChartBaseBSB::GetChartBits(wxRect& source, unsigned char *pPix, int sub_samp)
+//-----------------------------------------------------------------------
+//    Downsample rows [y_start, y_end) of dest
+//    pWorkLine, if not NULL, is a private Size_X scanline buffer, and the
+//    shared line cache is then only touched under m_LineCacheMutex, so that
+//    bands may run concurrently
+//-----------------------------------------------------------------------
+bool ChartBaseBSB::ScaleRowBand(unsigned char *ppn, wxRect& source, wxRect& dest, int dest_stride,
+                                double scale_factor, ScaleTypeEnum scale_type, int y_start, int y_end,
+                                unsigned char *pWorkLine)
+{
+      unsigned char *s_data = NULL;
+
+      double factor = scale_factor;
+      int Factor =  (int)factor;
+
+      int target_width = (int)wxRound((double)source.width  / factor) ;
+      int target_height = (int)wxRound((double)source.height / factor);
+
+      unsigned char *target_data = ppn;
+      unsigned char *data = ppn;
+
+      if(scale_type == RENDER_HIDEF)
+      {
+//    Allocate a working buffer based on scale factor
+            int blur_factor = wxMax(2, Factor);
+            int wb_size = (source.width) * (blur_factor * 2) * BPP/8 ;
+            s_data = (unsigned char *) malloc( wb_size ); // work buffer
+            unsigned char *pixel;
+            int y_offset;
+
+            //    With SSE2, sum the "blur_factor" lines vertically first,
+            //    then each output pixel only needs one row of column sums.
+            //    The column sums cover exactly the bytes the box loop reads.
+            unsigned short *col_sum = NULL;
+            if(m_bHasSSE2 && (blur_factor <= 257))
+            {
+                  int n_col_bytes = ((int)((target_width - 1) * factor) + blur_factor) * BPP/8;
+                  col_sum = (unsigned short *) malloc( n_col_bytes * sizeof(unsigned short) );
+            }
+
+            for (int y = y_start; y < y_end; y++)
+            {
+            //    Read "blur_factor" lines
+
+                  wxRect s1;
+                  s1.x = source.x;
+                  s1.y = source.y  + (int)(y * factor);
+                  s1.width = source.width;
+                  s1.height = blur_factor;
+                  GetChartBits(s1, s_data, 1, pWorkLine);
+
+                  target_data = data + (y * dest_stride * BPP/8);
+
+                  if(col_sum)
+                  {
+                        int n_col_bytes = ((int)((target_width - 1) * factor) + blur_factor) * BPP/8;
+                        ocpnColumnSum8(s_data, source.width * BPP/8, blur_factor, n_col_bytes, col_sum);
+
+                        unsigned int pixel_count = blur_factor * blur_factor;
+
+                        for (int x = 0; x < target_width; x++)
+                        {
+                              if((x * Factor) < (Size_X - source.x))
+                              {
+                                    unsigned int avgRed = 0 ;
+                                    unsigned int avgGreen = 0;
+                                    unsigned int avgBlue = 0;
+                                    unsigned short *ps = col_sum + BPP/8 * ((int)( x * factor ));
+
+                                    for ( int x1 = 0 ; x1 < blur_factor ; ++x1 )
+                                    {
+                                          avgRed   += ps[0] ;
+                                          avgGreen += ps[1] ;
+                                          avgBlue  += ps[2] ;
+                                          ps += BPP/8;
+                                    }
+
+                                    target_data[0] = avgRed / pixel_count;
+                                    target_data[1] = avgGreen / pixel_count;
+                                    target_data[2] = avgBlue / pixel_count;
+                              }
+                              else
+                              {
+                                    target_data[0] = 0;
+                                    target_data[1] = 0;
+                                    target_data[2] = 0;
+                              }
+                              target_data += BPP/8;
+                        }
+
+                        continue;
+                  }
+
+                  for (int x = 0; x < target_width; x++)
+                  {
+                        unsigned int avgRed = 0 ;
+                        unsigned int avgGreen = 0;
+                        unsigned int avgBlue = 0;
+                        unsigned int pixel_count = 0;
+                        unsigned char *pix0 = s_data +  BPP/8 * ((int)( x * factor )) ;
+                        y_offset = 0;
+
+                        if((x * Factor) < (Size_X - source.x))
+                        {
+      // determine average
+                              for ( int y1 = 0 ; y1 < blur_factor ; ++y1 )
+                              {
+                                  pixel = pix0 + (BPP/8 * y_offset ) ;
+                                  for ( int x1 = 0 ; x1 < blur_factor ; ++x1 )
+                                  {
+                                      avgRed   += pixel[0] ;
+                                      avgGreen += pixel[1] ;
+                                      avgBlue  += pixel[2] ;
+
+                                      pixel += BPP/8;
+
+                                      pixel_count++;
+                                  }
+                                  y_offset += source.width ;
+                              }
+
+                              target_data[0] = avgRed / pixel_count;     // >> scounter;
+                              target_data[1] = avgGreen / pixel_count;   // >> scounter;
+                              target_data[2] = avgBlue / pixel_count;    // >> scounter;
+                              target_data += BPP/8;
+                        }
+                        else
+                        {
+                              target_data[0] = 0;
+                              target_data[1] = 0;
+                              target_data[2] = 0;
+                              target_data += BPP/8;
+                        }
+
+                  }  // for x
+
+            }  // for y
+
+            free(col_sum);
+
+      }           // SCALE_BILINEAR
+
+      else if (scale_type == RENDER_LODEF)
+      {
+                  int get_bits_submap = 1;
+
+                  int scaler = 16;
+
+                  if(source.width > 32767)                  // High underscale can exceed signed math bits
+                        scaler = 8;
+
+                  int wb_size = (Size_X) * ((/*Factor +*/ 1) * 2) * BPP/8 ;
+                  s_data = (unsigned char *) malloc( wb_size ); // work buffer
+
+                  long x_delta = (source.width<<scaler) / target_width;
+                  long y_delta = (source.height<<scaler) / target_height;
+
+                  int y = y_start;               // starting here
+                  long ys = y_start * y_delta;
+
+                  while ( y < y_end)
+                  {
+                  //    Read 1 line at the right place from the source
+
+                        wxRect s1;
+                        s1.x = 0;
+                        s1.y = source.y + (ys >> scaler);
+                        s1.width = Size_X;
+                        s1.height = 1;
+                        GetChartBits(s1, s_data, get_bits_submap, pWorkLine);
+
+                        target_data = data + (y * dest_stride * BPP/8) + (dest.x * BPP / 8);
+
+                        long x = (source.x << scaler) + (dest.x * x_delta);
+                        long sizex16 = Size_X << scaler;
+                        int xt = dest.x;
+
+                        while((xt < dest.x + dest.width) && (x < 0))
+                        {
+                              target_data[0] = 0;
+                              target_data[1] = 0;
+                              target_data[2] = 0;
+
+                              target_data += BPP/8;
+                              x += x_delta;
+                              xt++;
+                        }
+
+                        while ((xt < dest.x + dest.width) && ( x < sizex16))
+                        {
+
+                              unsigned char* src_pixel = &s_data[(x>>scaler)*BPP/8];
+
+                              target_data[0] = src_pixel[0];
+                              target_data[1] = src_pixel[1];
+                              target_data[2] = src_pixel[2];
+
+                              target_data += BPP/8;
+                              x += x_delta;
+                              xt++;
+                        }
+
+                        while(xt < dest.x + dest.width)
+                        {
+                              target_data[0] = 0;
+                              target_data[1] = 0;
+                              target_data[2] = 0;
+
+                              target_data += BPP/8;
+                              xt++;
+                        }
+
+                        y++;
+                        ys += y_delta;
+                  }
+
+      }     // SCALE_SUBSAMP
+
+      free(s_data);
+
+      return true;
+}
+
+//-----------------------------------------------------------------------
+//    Number of row bands to use for a downsample of n_rows
+//    Bands are only worthwhile if scanlines can be decoded concurrently,
+//    i.e. straight from the memory mapped image.
+//-----------------------------------------------------------------------
+int ChartBaseBSB::GetScaleThreadCount(int n_rows)
+{
+      if(!m_pImageMap)
+            return 1;
+
+      if(!s_pScalePool)
+            s_pScalePool = new ChartBaseBSBScalePool;
+
+      int n_threads = s_pScalePool->GetThreadCount() + 1;
+      n_threads = wxMin(n_threads, n_rows / MIN_RASTER_SCALE_BAND);
+
+      return wxMax(n_threads, 1);
+}
+
+bool ChartBaseBSB::GetChartBits(wxRect& source, unsigned char *pPix, int sub_samp, unsigned char *pWorkLine)
 {
       int iy;
 #define FILL_BYTE 0
@@ -3879,13 +4264,13 @@ bool ChartBaseBSB::GetChartBits(wxRect& source, unsigned char *pPix, int sub_sam
                                 else
                                 {
 
-                                        BSBGetScanline( pCP,  iy, source.x, Size_X, sub_samp);
+                                        BSBGetScanline( pCP,  iy, source.x, Size_X, sub_samp, pWorkLine);
                                         memset(pCP + (Size_X - source.x) * BPP/8, FILL_BYTE,
                                                (source.x + source.width - Size_X) * BPP/8);
                                 }
                             }
                             else
-                                BSBGetScanline( pCP, iy, source.x, source.x + source.width, sub_samp);
+                                BSBGetScanline( pCP, iy, source.x, source.x + source.width, sub_samp, pWorkLine);
                     }
                     else
                     {
@@ -3897,7 +4282,7 @@ bool ChartBaseBSB::GetChartBits(wxRect& source, unsigned char *pPix, int sub_sam
                                 int xfill_corrected = -source.x + (source.x % sub_samp);    //+ve
                                 memset(pCP, FILL_BYTE, (xfill_corrected * BPP/8));
                                 BSBGetScanline( pCP + (xfill_corrected * BPP/8),  iy, 0,
-                                        source.width + source.x , sub_samp);
+                                        source.width + source.x , sub_samp, pWorkLine);
 
                             }
                             else
@@ -4073,12 +4458,262 @@ int   ChartBaseBSB::BSBScanScanline(wxInputStream *pinStream )
       return nLineMarker;
 }
 
+//-----------------------------------------------------------------------
+//    Skip over one BSB Scan Line held in memory
+//      Returns a pointer to the start of the next line
+//-----------------------------------------------------------------------
+unsigned char *ChartBaseBSB::BSBSkipScanline(unsigned char *lp, unsigned char *lp_end)
+{
+      int iPixel = 0;
+      unsigned char byNext;
+
+//      Skip the line number.
+      do
+      {
+            if(lp >= lp_end)
+                  return lp_end;
+            byNext = *lp++;
+      } while( (byNext & 0x80) != 0 );
+
+      unsigned char byCountMask = (1 << (7 - nColorSize)) - 1;
+
+//      Simulate expansion of runs.
+      while( (lp < lp_end) && ((byNext = *lp++) != 0 ) && (iPixel < Size_X))
+      {
+            int nRunCount = byNext & byCountMask;
+
+            while( ((byNext & 0x80) != 0) && (lp < lp_end) )
+            {
+                  byNext = *lp++;
+                  nRunCount = nRunCount * 128 + (byNext & 0x7f);
+            }
+
+            if( iPixel + nRunCount + 1 > Size_X )
+                  nRunCount = Size_X - iPixel - 1;
+
+            iPixel += nRunCount+1;
+      }
+
+      return lp;
+}
+
+
+//-----------------------------------------------------------------------
+//    Raster file memory mapping
+//-----------------------------------------------------------------------
+bool ChartBaseBSB::MapImageFile(const wxString &image_path)
+{
+#ifdef ocpnUSE_RASTER_MMAP
+      UnmapImageFile();
+
+      int fd = open(image_path.fn_str(), O_RDONLY);
+      if(fd == -1)
+            return false;
+
+      struct stat st;
+      if((fstat(fd, &st) != 0) || (st.st_size <= 0))
+      {
+            close(fd);
+            return false;
+      }
+
+      void *pmap = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);                                      // the mapping holds its own reference
+
+      if(pmap == MAP_FAILED)
+      {
+            wxString msg(_T("   Could not map raster file, using stream access for "));
+            msg.Append(image_path);
+            wxLogMessage(msg);
+            return false;
+      }
+
+      //    Scanlines are read roughly in order while panning
+      madvise(pmap, st.st_size, MADV_WILLNEED);
+
+      m_pImageMap = (unsigned char *)pmap;
+      m_nImageMapSize = st.st_size;
+
+      return true;
+#else
+      return false;
+#endif
+}
+
+void ChartBaseBSB::UnmapImageFile(void)
+{
+#ifdef ocpnUSE_RASTER_MMAP
+      if(m_pImageMap)
+            munmap(m_pImageMap, m_nImageMapSize);
+#endif
+      m_pImageMap = NULL;
+      m_nImageMapSize = 0;
+}
+
+//-----------------------------------------------------------------------
+//    Sidecar line index
+//    Charts with a damaged embedded line index have the recreated index
+//    saved beside the SENC files, so the full file scan happens only once.
+//-----------------------------------------------------------------------
+#define LINE_INDEX_MAGIC      "OCPNLIX1"
+
+wxString ChartBaseBSB::GetLineIndexFileName(void)
+{
+      wxFileName fn(m_FullPath);
+
+      wxString index_name = g_SENCPrefix;
+      if(index_name.IsEmpty())
+            return index_name;
+
+      if(index_name.Last() != wxFileName::GetPathSeparator())
+            index_name.Append(wxFileName::GetPathSeparator());
+      index_name.Append(fn.GetFullName());
+      index_name.Append(_T(".lix"));
+
+      return index_name;
+}
+
+//    Size of the raster image file, which is not the header file for GEO/NOS charts
+int ChartBaseBSB::GetImageFileSize(void)
+{
+      if(m_pImageMap)
+            return (int)m_nImageMapSize;
+
+      wxFileName fn(pBitmapFilePath ? *pBitmapFilePath : m_FullPath);
+      return (int)fn.GetSize().GetLo();
+}
+
+//    Every scanline must start inside the image file and after the one before,
+//    and the end of the last one, ptable[Size_Y], must not be past the end of the file
+bool ChartBaseBSB::IsLineIndexValid(const int *ptable)
+{
+      int file_size = GetImageFileSize();
+
+      for(int iplt=0 ; iplt < Size_Y ; iplt++)
+      {
+            if((ptable[iplt] <= 0) || (ptable[iplt] >= file_size) || (ptable[iplt+1] <= ptable[iplt]))
+                  return false;
+      }
+
+      return (ptable[Size_Y] <= file_size);
+}
+
+//    A saved index which cannot be used is deleted, so that the caller
+//    recreates it by scanning, and saves a good one in its place
+bool ChartBaseBSB::LoadLineIndex(void)
+{
+      wxString index_name = GetLineIndexFileName();
+      if(index_name.IsEmpty() || !wxFileName::FileExists(index_name))
+            return false;
+
+      if(ReadLineIndexFile(index_name))
+            return true;
+
+      wxString msg(_T("   Discarding saved Line Index for chart "));
+      msg.Append(m_FullPath);
+      wxLogMessage(msg);
+
+      wxRemoveFile(index_name);
+
+      return false;
+}
+
+bool ChartBaseBSB::ReadLineIndexFile(const wxString &index_name)
+{
+      wxFileName fn(m_FullPath);
+      int file_size = (int)fn.GetSize().GetLo();
+      int file_time = (int)fn.GetModificationTime().GetTicks();
+
+      wxFileInputStream ifs(index_name);
+      if(!ifs.Ok())
+            return false;
+
+      char magic[8];
+      int index_size_y, index_file_size, index_file_time, path_len;
+
+      ifs.Read(magic, 8);
+      ifs.Read(&index_size_y, sizeof(int));
+      ifs.Read(&index_file_size, sizeof(int));
+      ifs.Read(&index_file_time, sizeof(int));
+      ifs.Read(&path_len, sizeof(int));
+      if(ifs.Eof() || strncmp(magic, LINE_INDEX_MAGIC, 8))
+            return false;
+
+      //    The index must belong to this very file, unchanged since it was written
+      if((index_size_y != Size_Y) || (index_file_size != file_size) || (index_file_time != file_time))
+            return false;
+
+      if((path_len <= 0) || (path_len > 4096))
+            return false;
+
+      char *path_buf = (char *)malloc(path_len + 1);
+      ifs.Read(path_buf, path_len);
+      path_buf[path_len] = 0;
+      wxString index_path(path_buf, wxConvUTF8);
+      free(path_buf);
+
+      if(!index_path.IsSameAs(m_FullPath))
+            return false;
+
+      int *ptable = (int *)malloc((Size_Y+1) * sizeof(int));
+      if(!ptable)
+            return false;
+
+      ifs.Read(ptable, (Size_Y+1) * sizeof(int));
+      if((ifs.LastRead() != (Size_Y+1) * sizeof(int)) || !IsLineIndexValid(ptable))
+      {
+            free(ptable);
+            return false;
+      }
+
+      memcpy(pline_table, ptable, (Size_Y+1) * sizeof(int));
+      free(ptable);
+
+      wxString msg(_T("   Using saved Line Index for chart "));
+      msg.Append(m_FullPath);
+      wxLogMessage(msg);
+
+      return true;
+}
+
+bool ChartBaseBSB::SaveLineIndex(void)
+{
+      wxString index_name = GetLineIndexFileName();
+      if(index_name.IsEmpty())
+            return false;
+
+      wxFileName fn(m_FullPath);
+      int file_size = (int)fn.GetSize().GetLo();
+      int file_time = (int)fn.GetModificationTime().GetTicks();
+
+      wxFileName index_fn(index_name);
+      if(!index_fn.DirExists() && !wxFileName::Mkdir(index_fn.GetPath(), 0755, wxPATH_MKDIR_FULL))
+            return false;
+
+      wxFileOutputStream ofs(index_name);
+      if(!ofs.Ok())
+            return false;
+
+      wxCharBuffer path_buf = m_FullPath.mb_str(wxConvUTF8);
+      int path_len = strlen(path_buf.data());
+
+      ofs.Write(LINE_INDEX_MAGIC, 8);
+      ofs.Write(&Size_Y, sizeof(int));
+      ofs.Write(&file_size, sizeof(int));
+      ofs.Write(&file_time, sizeof(int));
+      ofs.Write(&path_len, sizeof(int));
+      ofs.Write(path_buf.data(), path_len);
+      ofs.Write(pline_table, (Size_Y+1) * sizeof(int));
+
+      return ofs.IsOk();
+}
+
 
 
 //-----------------------------------------------------------------------
 //    Get a BSB Scan Line Using Cache and scan line index if available
 //-----------------------------------------------------------------------
-int   ChartBaseBSB::BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int xl, int sub_samp)
+int   ChartBaseBSB::BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int xl, int sub_samp, unsigned char *pWorkLine)
 
 {
       int nLineMarker, nValueShift, iPixel = 0;
@@ -4090,25 +4725,52 @@ int   ChartBaseBSB::BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int
       unsigned char *lp;
       unsigned char *xtemp_line;
       register int ix = xs;
+      bool b_decode;
+
+      if(pWorkLine)
+      {
+//    Called from a row band, maybe concurrently with others.
+//    A line not yet cached is decoded into pWorkLine, and copied into the cache below.
+            if(!m_pImageMap)
+                  return 0;
 
-      if(bUseLineCache && pLineCache)
+            xtemp_line = pWorkLine;
+            b_decode = true;
+
+            if(bUseLineCache && pLineCache)
+            {
+                  wxMutexLocker lock(m_LineCacheMutex);
+                  if(pLineCache[y].bValid)
+                  {
+                        xtemp_line = pLineCache[y].pPix;
+                        b_decode = false;
+                  }
+            }
+      }
+      else if(bUseLineCache && pLineCache)
       {
 //    Is the requested line in the cache, and valid?
             pt = &pLineCache[y];
             if(!pt->bValid)                                 // not valid, so get it
             {
-                  if(pt->pPix)
-                        free(pt->pPix);
-                  pt->pPix = (unsigned char *)malloc(Size_X);
+                  if(!pt->pPix)
+                  {
+                        pt->pPix = (unsigned char *)malloc(Size_X);
+                        m_nLineCacheBytes += Size_X;
+                  }
             }
 
             xtemp_line = pt->pPix;
+            b_decode = !pt->bValid;
       }
       else
+      {
             xtemp_line = (unsigned char *)malloc(Size_X);
+            b_decode = true;
+      }
 
 
-      if((bUseLineCache && !pt->bValid) || (!bUseLineCache))
+      if(b_decode)
       {
           if(pline_table[y] == 0)
               return 0;
@@ -4118,14 +4780,27 @@ int   ChartBaseBSB::BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int
 
             int thisline_size = pline_table[y+1] - pline_table[y] ;
 
-            if(thisline_size > ifs_bufsize)
-                ifs_buf = (unsigned char *)realloc(ifs_buf, thisline_size);
+            if(m_pImageMap)
+            {
+                  //    Decode in place, the page cache does the buffering
+                  if((thisline_size <= 0) || ((size_t)pline_table[y+1] > m_nImageMapSize))
+                        return 0;
 
-            if( wxInvalidOffset == ifs_bitmap->SeekI(pline_table[y], wxFromStart))
-                  return 0;
+                  lp = m_pImageMap + pline_table[y];
+            }
+            else
+            {
+                  if(thisline_size > ifs_bufsize)
+                      ifs_buf = (unsigned char *)realloc(ifs_buf, thisline_size);
+
+                  if( wxInvalidOffset == ifs_bitmap->SeekI(pline_table[y], wxFromStart))
+                        return 0;
+
+                  ifs_bitmap->Read(ifs_buf, thisline_size);
+                  lp = ifs_buf;
+            }
 
-            ifs_bitmap->Read(ifs_buf, thisline_size);
-            lp = ifs_buf;
+            unsigned char *lp_end = lp + thisline_size;
 
 //    At this point, the unexpanded, raw line is at *lp, and the expansion destination is xtemp_line
 
@@ -4146,7 +4821,7 @@ int   ChartBaseBSB::BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int
 
             pCL = xtemp_line;
 
-            while( ((byNext = *lp++) != 0 ) && (iPixel < Size_X))
+            while( (lp < lp_end) && ((byNext = *lp++) != 0 ) && (iPixel < Size_X))
             {
                   int   nPixValue;
                   int nRunCount;
@@ -4154,7 +4829,7 @@ int   ChartBaseBSB::BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int
 
                   nRunCount = byNext & byCountMask;
 
-                  while( (byNext & 0x80) != 0 )
+                  while( ((byNext & 0x80) != 0) && (lp < lp_end) )
                   {
                         byNext = *lp++;
                         nRunCount = nRunCount * 128 + (byNext & 0x7f);
@@ -4174,8 +4849,24 @@ int   ChartBaseBSB::BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int
             }
       }
 
-      if(bUseLineCache)
+      if(pt)
             pt->bValid = true;
+      else if(pWorkLine && b_decode && bUseLineCache && pLineCache)
+      {
+            wxMutexLocker lock(m_LineCacheMutex);
+
+            CachedLine *pc = &pLineCache[y];
+            if(!pc->bValid)                           // another band may have got here first
+            {
+                  if(!pc->pPix)
+                  {
+                        pc->pPix = (unsigned char *)malloc(Size_X);
+                        m_nLineCacheBytes += Size_X;
+                  }
+                  memcpy(pc->pPix, pWorkLine, Size_X);
+                  pc->bValid = true;
+            }
+      }
 
 #if 0
       //    Here is some test code, using full RGB line buffers in LineCache
@@ -4244,6 +4935,21 @@ int   ChartBaseBSB::BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int
             {
                   unsigned char cur_by = *pCL;
                   rgbval = (int)(pPalette[cur_by]);
+
+                  if(m_bHasSSE2)
+                  {
+                        //    Measure the run, and fill it in one go
+                        int run = 0;
+                        while((ix + run < xl-1) && (pCL[run] == cur_by))
+                              run++;
+
+                        ocpnFillPixelRun24(prgb, rgbval, run);
+                        prgb += run * 3;
+                        pCL += run;
+                        ix += run;
+                        continue;
+                  }
+
                   while((ix < xl-1))
                   {
                         if(cur_by != *pCL)
@@ -4293,7 +4999,7 @@ int   ChartBaseBSB::BSBGetScanline( unsigned char *pLineBuf, int y, int xs, int
         *prgb_last = a;
       }
 
-      if(!bUseLineCache)
+      if(!pt && !pWorkLine)
           free (xtemp_line);
 
       return 1;
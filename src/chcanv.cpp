@@ -1747,11 +1747,17 @@ bool Quilt::Compose(const ViewPort &vp_in)
 
       //    Finally, iterate thru the quilt and preload all of the required charts.
       //    For dynamic S57 SENC creation, this is where SENC creation happens first.....
+      //    Each chart is locked in the cache as it is loaded, so that loading the
+      //    rest of the quilt, or the memory footprint timer, cannot evict it.
+      ChartData->UnLockAllCacheCharts();
       for( ir=0 ; ir<m_pcandidate_array->GetCount() ; ir++)
       {
             QuiltCandidate *pqc = m_pcandidate_array->Item(ir);
             if((pqc->b_include) && (!pqc->b_eclipsed))
+            {
                   ChartData->OpenChartFromDB(pqc->dbIndex, FULL_INIT);
+                  ChartData->LockCacheChart(pqc->dbIndex);
+            }
       }
 
 
@@ -1775,6 +1781,7 @@ bool Quilt::Compose(const ViewPort &vp_in)
 
       m_quilt_depth_unit = _T("");
       ChartBase *pc = ChartData->OpenChartFromDB(m_refchart_dbIndex, FULL_INIT);
+      ChartData->LockCacheChart(m_refchart_dbIndex);
       if(pc)
       {
             m_quilt_depth_unit =  pc->GetDepthUnits();
@@ -3104,6 +3111,10 @@ void ChartCanvas::SetQuiltMode(bool b_quilt)
 {
       VPoint.b_quilt = b_quilt;
       VPoint.b_FullScreenQuilt = g_bFullScreenQuilt;
+
+      //    Out of quilt mode, only Current_Ch is kept from eviction
+      if(!b_quilt && ChartData)
+            ChartData->UnLockAllCacheCharts();
 }
 
 bool ChartCanvas::GetQuiltMode(void)
@@ -6845,8 +6856,7 @@ void ChartCanvas::MouseEvent ( wxMouseEvent& event )
 
                         m_pRoutePointEditTarget->m_lat = m_cursor_lat;     // update the RoutePoint entry
                         m_pRoutePointEditTarget->m_lon = m_cursor_lon;
-                        m_pFoundPoint->m_slat = m_cursor_lat;             // update the SelectList entry
-                        m_pFoundPoint->m_slon = m_cursor_lon;
+                        pSelect->ModifySelectableItem ( m_pFoundPoint, m_cursor_lat, m_cursor_lon );   // update the SelectList entry
 
                         if ( CheckEdgePan ( x, y ) )
                         {
@@ -6854,8 +6864,7 @@ void ChartCanvas::MouseEvent ( wxMouseEvent& event )
                                 GetCanvasPixPoint ( x, y, new_cursor_lat, new_cursor_lon );
                                 m_pRoutePointEditTarget->m_lat = new_cursor_lat;     // update the RoutePoint entry
                                 m_pRoutePointEditTarget->m_lon = new_cursor_lon;
-                                m_pFoundPoint->m_slat = new_cursor_lat;             // update the SelectList entry
-                                m_pFoundPoint->m_slon = new_cursor_lon;
+                                pSelect->ModifySelectableItem ( m_pFoundPoint, new_cursor_lat, new_cursor_lon );   // update the SelectList entry
                         }
 
 
@@ -6932,8 +6941,7 @@ void ChartCanvas::MouseEvent ( wxMouseEvent& event )
 
                         m_pRoutePointEditTarget->m_lat = m_cursor_lat;     // update the RoutePoint entry
                         m_pRoutePointEditTarget->m_lon = m_cursor_lon;
-                        m_pFoundPoint->m_slat = m_cursor_lat;             // update the SelectList entry
-                        m_pFoundPoint->m_slon = m_cursor_lon;
+                        pSelect->ModifySelectableItem ( m_pFoundPoint, m_cursor_lat, m_cursor_lon );   // update the SelectList entry
 
                         //    Update the MarkProperties Dialog, if currently shown
                         if ( ( NULL != pMarkPropDialog ) && ( pMarkPropDialog->IsShown() ) )
@@ -10216,52 +10224,16 @@ void ChartCanvas::DrawAllTidesInBBox ( wxDC& dc, LLBBox& BBox,
                                           {
                                                 if ( bforce_redraw_tides )
                                                 {
-                                                            float val, nowlev;
+                                                            float nowlev;
                                                             float ltleve = 0.;
                                                             float htleve = 0.;
-                                                            time_t tctime;
                                                             time_t lttime = 0;
                                                             time_t httime = 0;
-                                                            bool wt;
-      //define if flood or edd in the last ten minutes and verify if data are useable
-                                                            if  ( ptcmgr->GetTideFlowSens( t_this_now, BACKWARD_TEN_MINUTES_STEP,
-                                                                        pIDX->IDX_rec_num, nowlev, val, wt) )
+      //get level "now" and the HW and LW either side of it, from the station's cached tide table
+                                                            if  ( ptcmgr->GetTideNearExtremes( t_this_now, pIDX->IDX_rec_num,
+                                                                        nowlev, ltleve, lttime, htleve, httime ) )
                                                             {
 
-      //search forward the first HW or LW near "now" ( starting at "now" - ten minutes )
-                                                                  ptcmgr->GetHightOrLowTide( t_this_now + BACKWARD_TEN_MINUTES_STEP ,
-                                                                              FORWARD_TEN_MINUTES_STEP, FORWARD_ONE_MINUTES_STEP,
-                                                                              val, wt, pIDX->IDX_rec_num, val, tctime);
-                                                                  if ( wt )
-                                                                  {
-                                                                        httime = tctime ;
-                                                                        htleve = val ;
-                                                                  }
-                                                                  else
-                                                                  {
-                                                                        lttime = tctime ;
-                                                                        ltleve = val ;
-                                                                  }
-                                                                  wt = !wt;
-
-      //then search opposite tide near "now"
-                                                                  if ( tctime > t_this_now )          // search backward
-                                                                        ptcmgr->GetHightOrLowTide( t_this_now, BACKWARD_TEN_MINUTES_STEP,
-                                                                                    BACKWARD_ONE_MINUTES_STEP, nowlev, wt, pIDX->IDX_rec_num, val, tctime);
-                                                                  else                                      // or search forward
-                                                                        ptcmgr->GetHightOrLowTide( t_this_now, FORWARD_TEN_MINUTES_STEP,
-                                                                                    FORWARD_ONE_MINUTES_STEP, nowlev, wt, pIDX->IDX_rec_num, val, tctime);
-                                                                  if ( wt )
-                                                                  {
-                                                                        httime = tctime ;
-                                                                        htleve = val ;
-                                                                  }
-                                                                  else
-                                                                  {
-                                                                        lttime = tctime ;
-                                                                        ltleve = val ;
-                                                                  }
-
       //process tide state  ( %height and flow sens )
                                                                   float ts = 1 - ( ( nowlev - ltleve ) / ( htleve - ltleve ) );
                                                                   int hs = ( httime > lttime ) ? -5 : 5 ;
@@ -10394,6 +10366,17 @@ void ChartCanvas::DrawAllCurrentsInBBox ( wxDC& dc, LLBBox& BBox, double skew_an
 //     if(1/*BBox.GetValid()*/)
         {
 
+//    Bring the values of the stations in view up to date in one batch
+                wxArrayInt stations;
+                for ( int i=1 ; i<ptcmgr->Get_max_IDX() +1 ; i++ )
+                {
+                        IDX_entry *pIDX = ptcmgr->GetIDX_entry ( i );
+                        char type = pIDX->IDX_type;
+                        if ( (( type == 'c' ) ||  ( type == 'C' )) && BBox.PointInBox ( pIDX->IDX_lon, pIDX->IDX_lat, 0 ) )
+                                stations.Add ( i );
+                }
+                ptcmgr->UpdateTideOrCurrent15 ( stations );
+
                 for ( int i=1 ; i<ptcmgr->Get_max_IDX() +1 ; i++ )
                 {
                         IDX_entry *pIDX = ptcmgr->GetIDX_entry ( i );
@@ -10921,7 +10904,6 @@ void TCWin::OnPaint ( wxPaintEvent& event )
                 if ( !btc_valid )
                 {
 
-                        float dir;
                         tcmax = -10;
                         tcmin = 10;
                                     float val;
@@ -10934,10 +10916,12 @@ void TCWin::OnPaint ( wxPaintEvent& event )
                                     // get tide flow sens ( flood or ebb ? )
                                     ptcmgr->GetTideFlowSens(m_t_graphday_00_at_station, BACKWARD_ONE_HOUR_STEP, pIDX->IDX_rec_num, tcv[0], val, wt);
 
+                                    // hourly values for the whole graph in one pass
+                                    ptcmgr->GetTideOrCurrentSeries(m_t_graphday_00_at_station, FORWARD_ONE_HOUR_STEP, 26, pIDX->IDX_rec_num, tcv);
+
                         for ( i=0 ; i<26 ; i++ )
                         {
                                 int tt = m_t_graphday_00_at_station + ( i * FORWARD_ONE_HOUR_STEP );
-                                ptcmgr->GetTideOrCurrent ( tt, pIDX->IDX_rec_num, tcv[i], dir );
                                 if ( tcv[i] > tcmax )
                                         tcmax = tcv[i];
 
@@ -52,6 +52,16 @@
 #include "ocpn_pixel.h"                         // for ocpnUSE_DIBSECTION
 
 #include <stdio.h>
+#include <limits.h>
+#include <wx/file.h>
+#include <wx/timer.h>
+
+#ifdef ocpnUSE_CM93_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 
 #ifdef __MSVC__
@@ -73,6 +83,7 @@ extern CM93DSlide       *pCM93DetailSlider;
 extern int              g_cm93detail_dialog_x, g_cm93detail_dialog_y;
 extern bool             g_bShowCM93DetailSlider;
 extern wxString         g_PrivateDataDir;
+extern double           gLat, gLon, gCog, gSog;
 
 // Flav add for CM93Offset manual setup
 extern double           g_CM93Maps_Offset_x;
@@ -1144,6 +1155,44 @@ int read_and_decode_ushort(FILE *stream, unsigned short *p)
 
 
 
+//    Decode a block of cm93 bytes in place
+void decode_cm93_bytes(unsigned char *p, int nbytes)
+{
+      for(int i=0 ; i < nbytes ; i++)
+            p[i] = Decode_table[p[i]];
+}
+
+//    Readers over an already decoded cell image in memory.
+//    Like the stream readers above, they return 0 if the data runs out.
+int read_cell_bytes(cm93_cell_cursor *pc, void *p, int nbytes)
+{
+      if(0 == nbytes)                     // declare victory if no bytes requested
+            return 1;
+
+      if((nbytes < 0) || (nbytes > pc->pend - pc->p))
+            return 0;
+
+      memcpy(p, pc->p, nbytes);
+      pc->p += nbytes;
+      return 1;
+}
+
+int read_cell_double(cm93_cell_cursor *pc, double *p)
+{
+      return read_cell_bytes(pc, p, sizeof(double));
+}
+
+int read_cell_int(cm93_cell_cursor *pc, int *p)
+{
+      return read_cell_bytes(pc, p, sizeof(int));
+}
+
+int read_cell_ushort(cm93_cell_cursor *pc, unsigned short *p)
+{
+      return read_cell_bytes(pc, p, sizeof(unsigned short));
+}
+
+
 //    Calculate the CM93 CellIndex integer for a given Lat/Lon, at a given scale
 
 int Get_CM93_CellIndex(double lat, double lon, int scale)
@@ -1310,8 +1359,130 @@ int get_dval(int native_scale)
       return dval;
 }
 
+//    Native scale and file extension character of a cm93 scale index (0..7 is Z, A..G)
+int Get_CM93_Native_Scale(int scale_index, wxChar *scale_char)
+{
+      int scale;
+      switch (scale_index)
+      {
+            case 0: scale =  20000000; *scale_char = 'Z'; break;         // Z
+            case 1: scale =   3000000; *scale_char = 'A'; break;         // A
+            case 2: scale =   1000000; *scale_char = 'B'; break;         // B
+            case 3: scale =    200000; *scale_char = 'C'; break;         // C
+            case 4: scale =    100000; *scale_char = 'D'; break;         // D
+            case 5: scale =     50000; *scale_char = 'E'; break;         // E
+            case 6: scale =     20000; *scale_char = 'F'; break;         // F
+            case 7: scale =      7500; *scale_char = 'G'; break;         // G
+            default: scale = 20000000; *scale_char = ' '; break;
+      }
+      return scale;
+}
+
+//    Create an array of CellIndexes covering a lat/lon box, at a given native scale
+ArrayOfInts Get_CM93_CellIndexArray(double ll_lat, double ll_lon, double ur_lat, double ur_lon, int native_scale)
+{
+      //    Adjust to always positive for easier cell calculations
+      if(ll_lon < 0)
+      {
+            ll_lon += 360;
+            ur_lon += 360;
+      }
+
+      int dval = get_dval(native_scale);
+
+      ArrayOfInts vpcells;
+
+      int lower_left_cell = Get_CM93_CellIndex(ll_lat, ll_lon, native_scale);
+      vpcells.Add(lower_left_cell);                   // always add the lower left cell
+
+      if(g_bDebugCM93)
+            printf("Get_CM93_CellIndexArray   Adding %d\n", lower_left_cell);
+
+      double rlat, rlon;
+      Get_CM93_Cell_Origin(lower_left_cell, native_scale, &rlat, &rlon);
+
+
+      // Use exact integer math here
+      //    It is more obtuse, but it removes dependency on FP rounding policy
+
+      int loni_0 = (int)wxRound(rlon * 3);
+      int loni_20 = loni_0 + dval;               // already added the lower left cell
+      int lati_20 = (int)wxRound(rlat * 3);
+
+
+      while(lati_20 < (ur_lat * 3.))
+      {
+            while(loni_20 < (ur_lon * 3.))
+            {
+                  unsigned int next_lon = loni_20 + 1080;
+                  while(next_lon >= 1080)
+                        next_lon -= 1080;
+
+                  unsigned int next_cell = next_lon;
+
+                  next_cell += (lati_20 + 270) * 10000;
+
+                  vpcells.Add((int)next_cell);
+                  if(g_bDebugCM93)
+                        printf("Get_CM93_CellIndexArray   Adding %d\n", next_cell);
+
+                  loni_20 += dval;
+            }
+            lati_20 += dval;
+            loni_20 = loni_0;
+      }
+
+      return vpcells;
+}
+
+//    Find the file holding a (sub)cell, allowing for either case of the scale character.
+//    Returns an empty string if there is no such file.
+wxString Find_CM93_Cell_File(const wxString &prefix, int cellindex, double dval, const wxString &scalechar, wxChar sub_char)
+{
+      int ilat = cellindex / 10000;
+      int ilon = cellindex % 10000;
+
+      int jlat = (int)(((ilat - 30) / dval) * dval) + 30;              // normalize
+      int jlon = (int)((ilon / dval) * dval);
+
+      int ilatroot = (((ilat - 30) / 60) * 60) + 30;
+      int ilonroot = (ilon / 60) * 60;
+
+      for(int icase = 0 ; icase < 2 ; icase++)
+      {
+            wxString sc = scalechar;
+            if(icase)
+                  sc = scalechar.Lower();             // try with alternate case of scalechar
+
+            wxString file;
+            file.Printf(_T("%04d%04d."), jlat, jlon);
+            file += sc;
+
+            wxString fileroot;
+            fileroot.Printf(_T("%04d%04d/"), ilatroot, ilonroot);
+            fileroot += sc;
+            fileroot += _T("/");
+            fileroot.Prepend(prefix);
+
+            file[0] = sub_char;
+            file.Prepend(fileroot);
+
+            if(g_bDebugCM93)
+            {
+                  char sfile[200];
+                  strncpy(sfile, file.mb_str(), 199);
+                  printf("    %sfilename: %s\n", icase ? "alternate " : "", sfile);
+            }
+
+            if(::wxFileExists(file))
+                  return file;
+      }
+
+      return wxEmptyString;
+}
+
 
-bool read_header_and_populate_cib(FILE *stream, Cell_Info_Block *pCIB)
+bool read_header_and_populate_cib(cm93_cell_cursor *stream, Cell_Info_Block *pCIB)
 {
       //    Read header, populate Cell_Info_Block
 
@@ -1323,40 +1494,40 @@ bool read_header_and_populate_cib(FILE *stream, Cell_Info_Block *pCIB)
 
       memset((void *)&header, 0, sizeof(header));
 
-      read_and_decode_double(stream,&header.lon_min);
-      read_and_decode_double(stream,&header.lat_min);
-      read_and_decode_double(stream,&header.lon_max);
-      read_and_decode_double(stream,&header.lat_max);
-
-      read_and_decode_double(stream,&header.easting_min);
-      read_and_decode_double(stream,&header.northing_min);
-      read_and_decode_double(stream,&header.easting_max);
-      read_and_decode_double(stream,&header.northing_max);
-
-      read_and_decode_ushort(stream,&header.usn_vector_records);
-      read_and_decode_int(stream,&header.n_vector_record_points);
-      read_and_decode_int(stream,&header.m_46);
-      read_and_decode_int(stream,&header.m_4a);
-      read_and_decode_ushort(stream,&header.usn_point3d_records);
-      read_and_decode_int (stream,&header.m_50);
-      read_and_decode_int(stream,&header.m_54);
-      read_and_decode_ushort(stream,&header.usn_point2d_records);
-      read_and_decode_ushort(stream,&header.m_5a);
-      read_and_decode_ushort(stream,&header.m_5c);
-      read_and_decode_ushort(stream,&header.usn_feature_records);
-
-      read_and_decode_int(stream,&header.m_60);
-      read_and_decode_int(stream,&header.m_64);
-      read_and_decode_ushort(stream,&header.m_68);
-      read_and_decode_ushort(stream,&header.m_6a);
-      read_and_decode_ushort(stream,&header.m_6c);
-      read_and_decode_int(stream,&header.m_nrelated_object_pointers);
-
-      read_and_decode_int(stream,&header.m_72);
-      read_and_decode_ushort(stream,&header.m_76);
-
-      read_and_decode_int(stream,&header.m_78);
-      read_and_decode_int(stream,&header.m_7c);
+      read_cell_double(stream,&header.lon_min);
+      read_cell_double(stream,&header.lat_min);
+      read_cell_double(stream,&header.lon_max);
+      read_cell_double(stream,&header.lat_max);
+
+      read_cell_double(stream,&header.easting_min);
+      read_cell_double(stream,&header.northing_min);
+      read_cell_double(stream,&header.easting_max);
+      read_cell_double(stream,&header.northing_max);
+
+      read_cell_ushort(stream,&header.usn_vector_records);
+      read_cell_int(stream,&header.n_vector_record_points);
+      read_cell_int(stream,&header.m_46);
+      read_cell_int(stream,&header.m_4a);
+      read_cell_ushort(stream,&header.usn_point3d_records);
+      read_cell_int(stream,&header.m_50);
+      read_cell_int(stream,&header.m_54);
+      read_cell_ushort(stream,&header.usn_point2d_records);
+      read_cell_ushort(stream,&header.m_5a);
+      read_cell_ushort(stream,&header.m_5c);
+      read_cell_ushort(stream,&header.usn_feature_records);
+
+      read_cell_int(stream,&header.m_60);
+      read_cell_int(stream,&header.m_64);
+      read_cell_ushort(stream,&header.m_68);
+      read_cell_ushort(stream,&header.m_6a);
+      read_cell_ushort(stream,&header.m_6c);
+      read_cell_int(stream,&header.m_nrelated_object_pointers);
+
+      read_cell_int(stream,&header.m_72);
+      read_cell_ushort(stream,&header.m_76);
+
+      read_cell_int(stream,&header.m_78);
+      read_cell_int(stream,&header.m_7c);
 
 
       //    Calculate and record the cell coordinate transform coefficients
@@ -1390,6 +1561,7 @@ bool read_header_and_populate_cib(FILE *stream, Cell_Info_Block *pCIB)
 
       pCIB->object_vector_record_descriptor_block = (vector_record_descriptor *)malloc((header.m_4a + header.m_46) * sizeof(vector_record_descriptor));
 
+      pCIB->m_nattribute_bytes = header.m_78;
       pCIB->attribute_block_top = (unsigned char *)calloc(header.m_78, 1);
 
       pCIB->m_nvector_records = header.usn_vector_records;
@@ -1405,7 +1577,7 @@ bool read_header_and_populate_cib(FILE *stream, Cell_Info_Block *pCIB)
       return true;
 }
 
-bool read_vector_record_table(FILE *stream, int count, Cell_Info_Block *pCIB)
+bool read_vector_record_table(cm93_cell_cursor *stream, int count, Cell_Info_Block *pCIB)
 {
       bool brv;
 
@@ -1418,23 +1590,23 @@ bool read_vector_record_table(FILE *stream, int count, Cell_Info_Block *pCIB)
             p->index = iedge;
 
             unsigned short npoints;
-            brv = !(read_and_decode_ushort(stream, &npoints) == 0);
+            brv = !(read_cell_ushort(stream, &npoints) == 0);
             if(!brv)
                   return false;
 
             p->n_points = npoints;
             p->p_points = q;
 
-//           brv = read_and_decode_bytes(stream, q, p->n_points * sizeof(cm93_point));
+//           brv = read_cell_bytes(stream, q, p->n_points * sizeof(cm93_point));
 //            if(!brv)
 //                  return false;
 
             unsigned short x, y;
             for(int index = 0 ; index <  p->n_points ; index++)
             {
-                  if(!read_and_decode_ushort(stream, &x))
+                  if(!read_cell_ushort(stream, &x))
                         return false;
-                  if(!read_and_decode_ushort(stream, &y))
+                  if(!read_cell_ushort(stream, &y))
                         return false;
 
                   q[index].x = x;
@@ -1481,7 +1653,7 @@ bool read_vector_record_table(FILE *stream, int count, Cell_Info_Block *pCIB)
 }
 
 
-bool read_3dpoint_table(FILE *stream, int count, Cell_Info_Block *pCIB)
+bool read_3dpoint_table(cm93_cell_cursor *stream, int count, Cell_Info_Block *pCIB)
 {
       geometry_descriptor *p = pCIB->point3d_descriptor_block;
       cm93_point_3d *q = pCIB->p3dpoint_array;
@@ -1489,7 +1661,7 @@ bool read_3dpoint_table(FILE *stream, int count, Cell_Info_Block *pCIB)
       for(int i = 0 ; i < count ; i++)
       {
             unsigned short npoints;
-            if(!read_and_decode_ushort(stream, &npoints))
+            if(!read_cell_ushort(stream, &npoints))
                   return false;
 
             p->n_points = npoints;
@@ -1497,17 +1669,17 @@ bool read_3dpoint_table(FILE *stream, int count, Cell_Info_Block *pCIB)
 
 //            unsigned short t = p->n_points;
 
-//            if(!read_and_decode_bytes(stream, q, t*6))
+//            if(!read_cell_bytes(stream, q, t*6))
 //                  return false;
 
             unsigned short x, y, z;
             for(int index = 0 ; index < p->n_points ; index++)
             {
-                  if(!read_and_decode_ushort(stream, &x))
+                  if(!read_cell_ushort(stream, &x))
                         return false;
-                  if(!read_and_decode_ushort(stream, &y))
+                  if(!read_cell_ushort(stream, &y))
                         return false;
-                  if(!read_and_decode_ushort(stream, &z))
+                  if(!read_cell_ushort(stream, &z))
                         return false;
 
                   q[index].x = x;
@@ -1524,17 +1696,17 @@ bool read_3dpoint_table(FILE *stream, int count, Cell_Info_Block *pCIB)
 }
 
 
-bool read_2dpoint_table(FILE *stream, int count, Cell_Info_Block *pCIB)
+bool read_2dpoint_table(cm93_cell_cursor *stream, int count, Cell_Info_Block *pCIB)
 {
 
-//      int rv = read_and_decode_bytes(stream, pCIB->p2dpoint_array, count * 4);
+//      int rv = read_cell_bytes(stream, pCIB->p2dpoint_array, count * 4);
 
       unsigned short x, y;
       for(int index = 0 ; index < count ; index++)
       {
-            if(!read_and_decode_ushort(stream, &x))
+            if(!read_cell_ushort(stream, &x))
                 return false;
-            if(!read_and_decode_ushort(stream, &y))
+            if(!read_cell_ushort(stream, &y))
                 return false;
 
             pCIB->p2dpoint_array[index].x = x;
@@ -1546,7 +1718,7 @@ bool read_2dpoint_table(FILE *stream, int count, Cell_Info_Block *pCIB)
 }
 
 
-bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pCIB)
+bool read_feature_record_table(cm93_cell_cursor *stream, int n_features, Cell_Info_Block *pCIB)
 {
 	try
 	{
@@ -1573,9 +1745,9 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
       {
 
             // read the object definition
-            read_and_decode_bytes(stream, &object_type, 1);              // read the object type
-            read_and_decode_bytes(stream, &geom_prim, 1);                // read the object geometry primitive type
-            read_and_decode_ushort(stream, &obj_desc_bytes);             // read the object byte count
+            read_cell_bytes(stream, &object_type, 1);              // read the object type
+            read_cell_bytes(stream, &geom_prim, 1);                // read the object geometry primitive type
+            read_cell_ushort(stream, &obj_desc_bytes);             // read the object byte count
 
             pobj->otype = object_type;
             pobj->geotype = geom_prim;
@@ -1587,7 +1759,7 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
                   {
 
 
-                        if(!read_and_decode_ushort(stream, &n_elements))
+                        if(!read_cell_ushort(stream, &n_elements))
                               return false;
 
                         pobj->n_geom_elements = n_elements;
@@ -1598,7 +1770,7 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
 
                         for(unsigned short i = 0 ; i < pobj->n_geom_elements ; i++)
                         {
-                              if(!read_and_decode_ushort(stream, &index))
+                              if(!read_cell_ushort(stream, &index))
                                      return false;
 
                               if((index & 0x1fff) > pCIB->m_nvector_records)
@@ -1621,7 +1793,7 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
                   case 2:                                         // LINE geometry
                   {
 
-                        if(!read_and_decode_ushort(stream, &n_elements))      // read geometry element count
+                        if(!read_cell_ushort(stream, &n_elements))      // read geometry element count
                               return false;
 
                         pobj->n_geom_elements = n_elements;
@@ -1634,7 +1806,7 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
                         {
                               unsigned short geometry_index;
 
-                              if(!read_and_decode_ushort(stream, &geometry_index))
+                              if(!read_cell_ushort(stream, &geometry_index))
                                return false;
 
 
@@ -1657,7 +1829,7 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
 
                   case 1:
                   {
-                        if(!read_and_decode_ushort(stream, &index))
+                        if(!read_cell_ushort(stream, &index))
                               return false;
 
                         obj_desc_bytes -= 2;
@@ -1671,7 +1843,7 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
 
                   case 8:
                   {
-                        if(!read_and_decode_ushort(stream, &index))
+                        if(!read_cell_ushort(stream, &index))
                               return false;
                         obj_desc_bytes -= 2;
 
@@ -1689,7 +1861,7 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
             if((pobj->geotype & 0x10) == 0x10)             // children/related
             {
                   unsigned char nrelated;
-                  if(!read_and_decode_bytes(stream, &nrelated, 1))
+                  if(!read_cell_bytes(stream, &nrelated, 1))
                         return false;
 
                   pobj->n_related_objects = nrelated;
@@ -1702,7 +1874,7 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
                   Object **w = (Object **)pobj->p_related_object_pointer_array;
                   for(unsigned char j = 0 ; j < pobj->n_related_objects ; j++)
                   {
-                        if(!read_and_decode_ushort(stream, &index))
+                        if(!read_cell_ushort(stream, &index))
                               return false;
 
                         if(index > pCIB->m_nfeature_records)
@@ -1725,7 +1897,7 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
 //                   *(int *)(0) = 0;                              // cause break error
 
                   unsigned short nrelated;
-                  if(!read_and_decode_ushort(stream, &nrelated))
+                  if(!read_cell_ushort(stream, &nrelated))
                         return false;
 
                   pobj->n_related_objects = (unsigned char)(nrelated & 0xFF);
@@ -1743,7 +1915,7 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
 //                      _asm int 3;                               // just after loc_408DE2
 
                   unsigned char nattr;
-                  if(!read_and_decode_bytes(stream, &nattr, 1))
+                  if(!read_cell_bytes(stream, &nattr, 1))
                         return false;        //m_od
 
                   pobj->n_attributes = nattr;
@@ -1755,7 +1927,7 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
                   puc10count += obj_desc_bytes;
 
 
-                  if(!read_and_decode_bytes(stream, pobj->attributes_block, obj_desc_bytes))
+                  if(!read_cell_bytes(stream, pobj->attributes_block, obj_desc_bytes))
                         return false;           // the attributes....
 
                   if((pobj->geotype & 0x0f) == 1)
@@ -1789,27 +1961,17 @@ bool read_feature_record_table(FILE *stream, int n_features, Cell_Info_Block *pC
 
 
 
-bool Ingest_CM93_Cell(const char * cell_file_name, Cell_Info_Block *pCIB)
+//    Ingest a decoded cell image, as served by CM93CellCache
+bool Ingest_CM93_Cell(unsigned char *pimage, int nbytes, Cell_Info_Block *pCIB)
 {
 
   try
   {
+      cm93_cell_cursor cursor;
+      cursor.p = pimage;
+      cursor.pend = pimage + nbytes;
 
-      int file_length;
-
-      //    Get the file length
-      FILE *flstream = fopen(cell_file_name, "rb");
-      if(!flstream)
-            return false;
-
-      fseek(flstream, 0, SEEK_END);
-      file_length = ftell(flstream);
-      fclose(flstream);
-
-      //    Open the file
-      FILE *stream = fopen(cell_file_name, "rb");
-      if(!stream)
-            return false;
+      cm93_cell_cursor *stream = &cursor;
 
       //    Validate the integrity of the cell file
 
@@ -1817,57 +1979,31 @@ bool Ingest_CM93_Cell(const char * cell_file_name, Cell_Info_Block *pCIB)
       int int0 = 0;
       int int1 = 0;;
 
-      read_and_decode_ushort(stream, &word0);        // length of prolog + header (10 + 128)
-      read_and_decode_int(stream, &int0);            // length of table 1
-      read_and_decode_int(stream, &int1);            // length of table 2
+      read_cell_ushort(stream, &word0);        // length of prolog + header (10 + 128)
+      read_cell_int(stream, &int0);            // length of table 1
+      read_cell_int(stream, &int1);            // length of table 2
 
       int test = word0 + int0 + int1;
-      if(test != file_length)
-      {
-            fclose(stream);
+      if(test != nbytes)
             return false;                           // file is corrupt
-      }
 
       //    Cell is OK, proceed to ingest
 
 
       if(!read_header_and_populate_cib(stream, pCIB))
-      {
-            fclose(stream);
             return false;
-      }
-
 
       if(!read_vector_record_table(stream, pCIB->m_nvector_records, pCIB))
-      {
-            fclose(stream);
             return false;
-      }
 
       if(!read_3dpoint_table(stream, pCIB->m_n_point3d_records, pCIB))
-      {
-            fclose(stream);
             return false;
-      }
 
       if(!read_2dpoint_table(stream, pCIB->m_n_point2d_records, pCIB))
-      {
-            fclose(stream);
             return false;
-      }
 
       if(!read_feature_record_table(stream, pCIB->m_nfeature_records, pCIB))
-      {
-            fclose(stream);
             return false;
-      }
-
-//      int file_end = ftell(stream);
-
-//      wxASSERT(file_end == file_length);
-
-      fclose(stream);
-
 
       return true;
   }
@@ -1882,144 +2018,1170 @@ catch ( ... )
 }
 
 
-
-
 //----------------------------------------------------------------------------------
-//      cm93chart Implementation
+//      Geometry cells
 //----------------------------------------------------------------------------------
 
-cm93chart::cm93chart()
+//    The block pointers of a cell which has not been ingested
+static void Clear_CM93_CIB(Cell_Info_Block *pCIB)
 {
-      m_ChartType = CHART_TYPE_CM93;
+      pCIB->pobject_block = NULL;
+      pCIB->p2dpoint_array = NULL;
+      pCIB->pprelated_object_block = NULL;
+      pCIB->object_vector_record_descriptor_block = NULL;
+      pCIB->attribute_block_top = NULL;
+      pCIB->edge_vector_descriptor_block = NULL;
+      pCIB->pvector_record_block_top = NULL;
+      pCIB->point3d_descriptor_block = NULL;
+      pCIB->p3dpoint_array = NULL;
+
+      pCIB->m_nvector_records = 0;
+      pCIB->m_nfeature_records = 0;
+      pCIB->m_nattribute_bytes = 0;
+}
 
-//    Create the decode table once, if needed
-      if(!cm93_decode_table_created)
+static void Free_CM93_CIB(Cell_Info_Block *pCIB)
+{
+      free(pCIB->pobject_block);
+      free(pCIB->p2dpoint_array);
+      free(pCIB->pprelated_object_block);
+      free(pCIB->object_vector_record_descriptor_block);
+      free(pCIB->attribute_block_top);
+      free(pCIB->edge_vector_descriptor_block);
+      free(pCIB->pvector_record_block_top);
+      free(pCIB->point3d_descriptor_block);
+      free(pCIB->p3dpoint_array);
+
+      Clear_CM93_CIB(pCIB);
+}
+
+//    The geometry type of a cm93 object, as cm93chart builds it
+static int Get_CM93_Geomtype(int geotype)
+{
+      switch(geotype){
+            case 1:    return 1;
+            case 2:    return 2;
+            case 4:    return 3;
+            case 129:  return 1;
+            case 130:  return 2;
+            case 132:  return 3;
+            case 8:    return 8;
+            case 16:   return 16;
+            case 161:  return 1;    // lighthouse first child
+            case 33:   return 1;
+            default:   return -1;
+      }
+}
+
+//    A geometry cell under construction
+typedef struct
+{
+      unsigned char     *p;
+      int               nbytes;
+      int               nalloc;
+}cm93_geom_buffer;
+
+//    Reserve n zeroed bytes at the end of the cell, keeping records int aligned.
+//    Returns their offset, or -1.  Any pointer into the cell is invalid afterwards.
+static int geom_reserve(cm93_geom_buffer *pbuf, int n)
+{
+      if(n < 0)
+            return -1;
+
+      n = (n + 3) & ~3;
+      if(n > pbuf->nalloc - pbuf->nbytes)
       {
-            CreateDecodeTable();
-            cm93_decode_table_created = true;
+            int nalloc = wxMax(pbuf->nalloc * 2, pbuf->nbytes + n);
+            unsigned char *p = (unsigned char *)realloc(pbuf->p, nalloc);
+            if(!p)
+                  return -1;
+
+            memset(p + pbuf->nalloc, 0, nalloc - pbuf->nalloc);
+            pbuf->p = p;
+            pbuf->nalloc = nalloc;
       }
 
- //    Create a global instance of the cm93 manager
-      if(!s_pcm93mgr)
-          s_pcm93mgr = new cm93manager();
+      int offset = pbuf->nbytes;
+      pbuf->nbytes += n;
+      return offset;
+}
 
-      m_pDict = NULL;
+//    Area (geomtype 3) and line (geomtype 2) objects.
+//    Areas are assembled into closed rings from their edge segments.
+static int geom_resolve_poly(cm93_geom_buffer *pbuf, Object *pobject, int geomtype)
+{
+      vector_record_descriptor *psegs = (vector_record_descriptor *)pobject->pGeometry;
+      int nsegs = pobject->n_geom_elements;
 
-      m_current_cell_vearray_offset = 0;
+      int n_maxvertex = 0;
+      for(int i=0 ; i < nsegs ; i++)
+            n_maxvertex += psegs[i].pGeom_Description->n_points;
 
-      m_ncontour_alloc = 100;                   // allocate inital vertex count container array
-      m_pcontour_array = (int *)malloc(m_ncontour_alloc * sizeof(int));
+      if(geomtype == 3)
+            n_maxvertex += 1;                   // rings start at vertex 1
 
-    //  Establish a common reference point for the cell
-      ref_lat = 0.;
-      ref_lon = 0.;
+      //    There can be no more rings than segments
+      int n_contour_max = (geomtype == 3) ? nsegs : 0;
 
+      int offset = geom_reserve(pbuf, sizeof(cm93_geom_poly) + ((nsegs + n_maxvertex + n_contour_max) * sizeof(int)));
+      if(offset < 0)
+            return -1;
 
+      cm93_geom_poly *ppoly = (cm93_geom_poly *)(pbuf->p + offset);
+      int *pedge = (int *)(ppoly + 1);
+      cm93_point *pPoints = (cm93_point *)(pedge + nsegs);
+      int *pcontour = (int *)(pPoints + n_maxvertex);
 
-    //  Need a covr_set
-      m_pcovr_set = new covr_set(this);
+      int lon_max, lat_max, lon_min, lat_min;
+      lon_max = 0; lon_min = 65536; lat_max = 0; lat_min = 65536;
 
+      int n_max_points = -1;
+      int ncontours = 0;
 
-      //    Make initial allocation of shared outline drawing buffer
-      m_pDrawBuffer = (wxPoint *)malloc(4 * sizeof(wxPoint));
-      m_nDrawBufferSize = 1;
+      int ip = (geomtype == 3) ? 1 : 0;
+      int n_prev_vertex_index = 1;
+      bool bnew_ring = true;
 
+      cm93_point start_point;
+      start_point.x = 0; start_point.y = 0;
 
-/*
-      ooFILE *flstreamt = fopen("/home/dsr/Desktop/Charts/CM93_May2009/03300060/03300060.INF", "rb");
-      if(flstreamt)
+      cm93_point cur_end_point;
+      cur_end_point.x = 1; cur_end_point.y = 1;
+
+      for(int iseg = 0 ; iseg < nsegs ; iseg++)
       {
-            void *p = calloc(10000, 1);
-            read_and_decode_bytes(flstreamt, p, 10000);
-            FILE *flstreamo = fopen("/home/dsr/03300060.info", "wb");
-            fwrite ( p, 1, 10000, flstreamo );
-            fclose(flstreamo);
-      }
-*/
+            int type_seg = psegs[iseg].segment_usage;
 
-}
+            geometry_descriptor *pgd = psegs[iseg].pGeom_Description;
 
-cm93chart::~cm93chart()
-{
-      free(m_pcontour_array);
+            int npoints = pgd->n_points;
+            cm93_point *rseg = pgd->p_points;
 
-      delete m_pcovr_set;
+            n_max_points = wxMax(n_max_points, npoints);
 
-      free(m_pDrawBuffer);
+            pedge[iseg] = pgd->index;
 
-}
+            if(!npoints)
+                  continue;
 
-void  cm93chart::Unload_CM93_Cell(void)
-{
-      free(m_CIB.pobject_block);
-//      free(m_CIB.m_2a);
-      free(m_CIB.p2dpoint_array);
-      free(m_CIB.pprelated_object_block);
-      free(m_CIB.object_vector_record_descriptor_block);
-      free(m_CIB.attribute_block_top);
-      free(m_CIB.edge_vector_descriptor_block);
-      free(m_CIB.pvector_record_block_top);
-      free(m_CIB.point3d_descriptor_block);
-      free(m_CIB.p3dpoint_array);
-}
+            //    Establish ring starting conditions
+            if((geomtype == 3) && bnew_ring)
+            {
+                  bnew_ring = false;
 
+                  if((type_seg & 4) == 0)
+                        start_point = rseg[0];
+                  else
+                        start_point = rseg[npoints-1];
+            }
 
-//    The idea here is to suggest to upper layers the appropriate scale values to be used with this chart
-//    If max is too large, performance suffers, and the charts are very cluttered onscreen.
-//    If the min is too small, then the chart rendereding will be over-scaled, and accuracy suffers.
-//    In some ways, this is subjective.....
+            if((type_seg & 4) == 0)
+            {
+                  cur_end_point = rseg[npoints-1];
+                  for(int j=0 ; j<npoints  ; j++)
+                  {
+                        lon_max = wxMax(lon_max, rseg[j].x);
+                        lon_min = wxMin(lon_min, rseg[j].x);
+                        lat_max = wxMax(lat_max, rseg[j].y);
+                        lat_min = wxMin(lat_min, rseg[j].y);
 
-double cm93chart::GetNormalScaleMin(double canvas_scale_factor, bool b_allow_overzoom)
-{
-      switch(GetNativeScale())
-      {
-            case 20000000: return 3000000.;           // Z
-            case  3000000: return 1000000.;           // A
-            case  1000000: return 200000.;            // B
-            case   200000: return 40000.;             // C
-            case   100000: return 20000.;             // D
-            case    50000: return 10000.;             // E
-            case    20000: return 5000.;              // F
-            case     7500: return 3500.;              // G
+                        pPoints[ip++] = rseg[j];
+                  }
+            }
+            else                                      // backwards
+            {
+                  cur_end_point = rseg[0];
+                  for(int j=npoints-1 ; j>= 0  ; j--)
+                  {
+                        lon_max = wxMax(lon_max, rseg[j].x);
+                        lon_min = wxMin(lon_min, rseg[j].x);
+                        lat_max = wxMax(lat_max, rseg[j].y);
+                        lat_min = wxMin(lat_min, rseg[j].y);
+
+                        pPoints[ip++] = rseg[j];
+                  }
+            }
+
+            if(geomtype == 3)
+            {
+                  ip--;                                     // skip the last point in each segment
+
+                  if((cur_end_point.x == start_point.x) && (cur_end_point.y == start_point.y))
+                  {
+                        // done with a ring
+
+                        ip++;                                     // leave in ring closure point
+
+                        pcontour[ncontours++] = ip - n_prev_vertex_index;     // the vertex count
+
+                        bnew_ring = true;                         // set for next ring
+                        n_prev_vertex_index = ip;
+                  }
+            }
       }
 
-      return 1.0;
+      ppoly->n_vector_indices = nsegs;
+      ppoly->n_contours = ncontours;
+      ppoly->n_max_vertex = n_maxvertex;
+      ppoly->n_max_edge_points = n_max_points;
+      ppoly->xmin = lon_min;
+      ppoly->xmax = lon_max;
+      ppoly->ymin = lat_min;
+      ppoly->ymax = lat_max;
+
+      return offset;
 }
 
-double cm93chart::GetNormalScaleMax(double canvas_scale_factor)
+//    Resolve the geometry of an ingested cell into a newly allocated geometry cell
+bool Resolve_CM93_Cell(Cell_Info_Block *pCIB, int cell_file_size, int cell_file_time, unsigned char **ppdata, int *pnbytes)
 {
-      switch(GetNativeScale())
-      {
-            case 20000000: return 50000000.;          // Z
-            case  3000000: return 6000000.;           // A
-            case  1000000: return 2000000.;           // B
-            case   200000: return 400000.;            // C
-            case   100000: return 200000.;            // D
-            case    50000: return 100000.;            // E
-            case    20000: return 40000.;             // F
-            case     7500: return 15000.;             // G
-      }
+      cm93_geom_buffer buf;
+      buf.p = NULL;
+      buf.nbytes = 0;
+      buf.nalloc = 0;
 
-      return 1.0e7;
-}
+      int n_edges = pCIB->m_nvector_records;
+      int n_objects = pCIB->m_nfeature_records;
+      int n_attribute_bytes = pCIB->attribute_block_top ? wxMax(pCIB->m_nattribute_bytes, 0) : 0;
 
+      int header = geom_reserve(&buf, sizeof(cm93_geom_header));
+      int edge_table = geom_reserve(&buf, n_edges * sizeof(cm93_geom_edge));
+      int object_table = geom_reserve(&buf, n_objects * sizeof(cm93_geom_object));
+      int attribute_block = geom_reserve(&buf, n_attribute_bytes);
 
-void cm93chart::GetPointPix(ObjRazRules *rzRules, float north, float east, wxPoint *r)
-{
-      S57Obj *obj = rzRules->obj;
+      bool bok = (header == 0) && (edge_table >= 0) && (object_table >= 0) && (attribute_block >= 0);
 
-      double valx = (east * obj->x_rate)  + obj->x_origin;
-      double valy = (north * obj->y_rate) + obj->y_origin;
+      if(bok && n_attribute_bytes)
+            memcpy(buf.p + attribute_block, pCIB->attribute_block_top, n_attribute_bytes);
 
-            //    Crossing Greenwich right
-      if(m_vp_current.GetBBox().GetMaxX() > 360.)
+      //    The edges, as vector records
+      geometry_descriptor *pgd = pCIB->edge_vector_descriptor_block;
+      for(int iedge = 0 ; bok && (iedge < n_edges) ; iedge++)
       {
-            wxBoundingBox bbRight(0., m_vp_current.GetBBox().GetMinY(), m_vp_current.GetBBox().GetMaxX() - 360., m_vp_current.GetBBox().GetMaxY());
-            if ( bbRight.Intersect ( rzRules->obj->BBObj, 0 ) != _OUT )
+            int points = geom_reserve(&buf, pgd->n_points * sizeof(cm93_point));
+            if(points < 0)
             {
-                  valx += mercator_k0 * WGS84_semimajor_axis_meters * 2.0 * PI;      //6375586.0;
+                  bok = false;
+                  break;
             }
-      }
+            memcpy(buf.p + points, pgd->p_points, pgd->n_points * sizeof(cm93_point));
+
+            cm93_geom_edge *pedge = (cm93_geom_edge *)(buf.p + edge_table) + iedge;
+            pedge->n_points = pgd->n_points;
+            pedge->points = points;
+
+            pgd++;
+      }
+
+      //    The objects, each with its geometry resolved
+      Object *pobject = pCIB->pobject_block;
+      for(int iobject = 0 ; bok && (iobject < n_objects) ; iobject++)
+      {
+            int geomtype = Get_CM93_Geomtype(pobject->geotype);
+            int geometry = 0;
+
+            switch(geomtype){
+                  case 3:
+                  case 2:
+                        geometry = geom_resolve_poly(&buf, pobject, geomtype);
+                        break;
+
+                  case 1:
+                        geometry = geom_reserve(&buf, sizeof(cm93_point));
+                        if(geometry >= 0)
+                              memcpy(buf.p + geometry, pobject->pGeometry, sizeof(cm93_point));
+                        break;
+
+                  case 8:
+                  {
+                        geometry_descriptor *p3d = (geometry_descriptor *)pobject->pGeometry;
+                        int npoints = p3d->n_points;
+
+                        geometry = geom_reserve(&buf, sizeof(int) + (npoints * sizeof(cm93_point_3d)));
+                        if(geometry >= 0)
+                        {
+                              memcpy(buf.p + geometry, &npoints, sizeof(int));
+                              memcpy(buf.p + geometry + sizeof(int), p3d->p_points, npoints * sizeof(cm93_point_3d));
+                        }
+                        break;
+                  }
+
+                  default:                            // no geometry of its own
+                        break;
+            }
+
+            if(geometry < 0)
+            {
+                  bok = false;
+                  break;
+            }
+
+            cm93_geom_object *pgo = (cm93_geom_object *)(buf.p + object_table) + iobject;
+            pgo->otype = pobject->otype;
+            pgo->geotype = pobject->geotype;
+            pgo->geomtype = geomtype;
+            pgo->geometry = geometry;
+
+            pgo->attributes = -1;
+            pgo->n_attributes = 0;
+            if(pobject->attributes_block && pobject->n_attributes)
+            {
+                  int attributes = pobject->attributes_block - pCIB->attribute_block_top;
+                  if((attributes >= 0) && (attributes < n_attribute_bytes))
+                  {
+                        pgo->attributes = attributes;
+                        pgo->n_attributes = pobject->n_attributes;
+                  }
+            }
+
+            pobject++;
+      }
+
+      if(!bok)
+      {
+            free(buf.p);
+            return false;
+      }
+
+      cm93_geom_header *phdr = (cm93_geom_header *)buf.p;
+      memcpy(phdr->magic, CM93_GEOM_CACHE_MAGIC, 8);
+      phdr->cell_file_size = cell_file_size;
+      phdr->cell_file_time = cell_file_time;
+      phdr->nbytes = buf.nbytes;
+      phdr->n_edges = n_edges;
+      phdr->n_objects = n_objects;
+      phdr->n_attribute_bytes = n_attribute_bytes;
+      phdr->transform_x_rate = pCIB->transform_x_rate;
+      phdr->transform_y_rate = pCIB->transform_y_rate;
+      phdr->transform_x_origin = pCIB->transform_x_origin;
+      phdr->transform_y_origin = pCIB->transform_y_origin;
+      phdr->edge_table = edge_table;
+      phdr->object_table = object_table;
+      phdr->attribute_block = attribute_block;
+
+      *ppdata = buf.p;
+      *pnbytes = buf.nbytes;
+
+      return true;
+}
+
+//    True if size bytes at offset lie within the cell.
+//    Everything in a geometry cell starts on a 4 byte boundary.
+static bool geom_in_cell(int offset, double size, int nbytes)
+{
+      return (offset >= 0) && !(offset & 3) && (size >= 0) && ((double)offset + size <= (double)nbytes);
+}
+
+//    Check that a geometry cell read from the cache can be walked safely
+bool Validate_CM93_Geom_Cell(unsigned char *pdata, int nbytes)
+{
+      if(nbytes < (int)sizeof(cm93_geom_header))
+            return false;
+
+      cm93_geom_header *phdr = (cm93_geom_header *)pdata;
+
+      if(strncmp(phdr->magic, CM93_GEOM_CACHE_MAGIC, 8) || (phdr->nbytes != nbytes))
+            return false;
+
+      if(!geom_in_cell(phdr->edge_table, (double)phdr->n_edges * sizeof(cm93_geom_edge), nbytes) ||
+          !geom_in_cell(phdr->object_table, (double)phdr->n_objects * sizeof(cm93_geom_object), nbytes) ||
+          !geom_in_cell(phdr->attribute_block, phdr->n_attribute_bytes, nbytes))
+            return false;
+
+      cm93_geom_edge *pedge = (cm93_geom_edge *)(pdata + phdr->edge_table);
+      for(int iedge = 0 ; iedge < phdr->n_edges ; iedge++)
+      {
+            if(!geom_in_cell(pedge->points, (double)pedge->n_points * sizeof(cm93_point), nbytes))
+                  return false;
+            pedge++;
+      }
+
+      cm93_geom_object *pgo = (cm93_geom_object *)(pdata + phdr->object_table);
+      for(int iobject = 0 ; iobject < phdr->n_objects ; iobject++)
+      {
+            if((pgo->attributes != -1) && ((pgo->attributes < 0) || (pgo->attributes >= phdr->n_attribute_bytes)))
+                  return false;
+
+            if(pgo->geomtype != Get_CM93_Geomtype(pgo->geotype))
+                  return false;
+
+            switch(pgo->geomtype){
+                  case 3:
+                  case 2:
+                  {
+                        if(!geom_in_cell(pgo->geometry, sizeof(cm93_geom_poly), nbytes))
+                              return false;
+
+                        cm93_geom_poly *ppoly = (cm93_geom_poly *)(pdata + pgo->geometry);
+                        if((ppoly->n_vector_indices < 0) || (ppoly->n_contours < 0) || (ppoly->n_max_vertex < 0))
+                              return false;
+
+                        double size = sizeof(cm93_geom_poly) + ((double)ppoly->n_vector_indices + ppoly->n_max_vertex + ppoly->n_contours) * sizeof(int);
+                        if(!geom_in_cell(pgo->geometry, size, nbytes))
+                              return false;
+
+                        int *pindex = (int *)(ppoly + 1);
+                        for(int i=0 ; i < ppoly->n_vector_indices ; i++)
+                        {
+                              if((pindex[i] < 0) || (pindex[i] >= phdr->n_edges))
+                                    return false;
+                        }
+
+                        int *pcontour = (int *)((cm93_point *)(pindex + ppoly->n_vector_indices) + ppoly->n_max_vertex);
+                        double nvertex = 0;
+                        for(int i=0 ; i < ppoly->n_contours ; i++)
+                        {
+                              if(pcontour[i] < 0)
+                                    return false;
+                              nvertex += pcontour[i];
+                        }
+                        if(nvertex > ppoly->n_max_vertex)
+                              return false;
+                        break;
+                  }
+
+                  case 1:
+                        if(!geom_in_cell(pgo->geometry, sizeof(cm93_point), nbytes))
+                              return false;
+                        break;
+
+                  case 8:
+                  {
+                        if(!geom_in_cell(pgo->geometry, sizeof(int), nbytes))
+                              return false;
+
+                        int npoints;
+                        memcpy(&npoints, pdata + pgo->geometry, sizeof(int));
+                        if(!geom_in_cell(pgo->geometry + (int)sizeof(int), (double)npoints * sizeof(cm93_point_3d), nbytes))
+                              return false;
+                        break;
+                  }
+
+                  default:
+                        break;
+            }
+
+            pgo++;
+      }
+
+      return true;
+}
+
+
+//----------------------------------------------------------------------------------
+//      CM93CellCache Implementation
+//----------------------------------------------------------------------------------
+
+CM93CellCache::CM93CellCache()
+{
+      m_cache_dir = g_PrivateDataDir;
+      appendOSDirSep(&m_cache_dir);
+      m_cache_dir += _T("cm93");
+      appendOSDirSep(&m_cache_dir);
+      m_cache_dir += _T("geom");
+
+      if(!wxFileName::DirExists(m_cache_dir))
+            wxFileName::Mkdir(m_cache_dir, 0755, wxPATH_MKDIR_FULL);
+
+      m_pwriter = NULL;
+      m_pprefetcher = NULL;
+      m_bstop = false;
+      m_cache_bytes = 0;
+
+      m_nhits = 0;
+      m_nmisses = 0;
+
+      m_nprefetch_hits = 0;
+      m_nprefetch_misses = 0;
+      m_nprefetch_unused = 0;
+
+      //    Without a writer nothing is cached, but cached cells are still used
+      m_pwriter = new CM93CacheWriterThread(this);
+      if((m_pwriter->Create() != wxTHREAD_NO_ERROR) || (m_pwriter->Run() != wxTHREAD_NO_ERROR))
+      {
+            delete m_pwriter;
+            m_pwriter = NULL;
+      }
+      else
+            m_pwriter->SetPriority(WXTHREAD_MIN_PRIORITY);
+}
+
+CM93CellCache::~CM93CellCache()
+{
+      //    Stop the threads; cells still queued for writing are simply not cached
+      {
+            wxMutexLocker lock(m_mutex);
+            m_bstop = true;
+      }
+
+      if(m_pwriter)
+      {
+            m_semaphore.Post();
+            m_pwriter->Wait();
+            delete m_pwriter;
+      }
+
+      if(m_pprefetcher)
+      {
+            m_prefetch_semaphore.Post();
+            m_pprefetcher->Wait();
+            delete m_pprefetcher;
+      }
+
+      for(unsigned int i=0 ; i < m_jobs.GetCount() ; i++)
+      {
+            free(m_jobs.Item(i)->m_pdata);
+            delete m_jobs.Item(i);
+      }
+
+      for(unsigned int i=0 ; i < m_prefetched.GetCount() ; i++)
+      {
+            ReleaseCell(m_prefetched.Item(i));
+            delete m_prefetched.Item(i);
+      }
+
+      if(m_nhits + m_nmisses)
+      {
+            wxString msg;
+            msg.Printf(_T("CM93 geometry cache: %d hits, %d misses"), m_nhits, m_nmisses);
+            wxLogMessage(msg);
+      }
+
+      if(m_nprefetch_hits + m_nprefetch_misses)
+      {
+            wxString msg;
+            msg.Printf(_T("CM93 cell prefetch: %d hits, %d misses, %d unused"),
+                       m_nprefetch_hits, m_nprefetch_misses, m_nprefetch_unused);
+            wxLogMessage(msg);
+      }
+}
+
+//    The cache file name is the whole cell path, flattened, so that several
+//    cm93 data sets can share the cache directory.
+//    This is called from the worker threads too, so nothing here may share
+//    string data with a string owned by another thread.
+wxString CM93CellCache::GetCacheFileName(const wxString &cell_file)
+{
+      wxString name(cell_file.c_str());
+      wxString sep(wxFileName::GetPathSeparator());
+      name.Replace(sep, _T("_"));
+      name.Replace(_T(":"), _T("_"));                // for Windows
+
+      wxString cache_file(m_cache_dir.c_str());
+      appendOSDirSep(&cache_file);
+      cache_file += name;
+      cache_file += _T(".gcl");
+
+      return cache_file;
+}
+
+//    Load a cell for ingestion, taking it from the prefetched cells if it is there
+bool CM93CellCache::LoadCell(const wxString &cell_file, cm93_cell_image *pimg)
+{
+      {
+            wxMutexLocker lock(m_mutex);
+
+            for(unsigned int i=0 ; i < m_prefetched.GetCount() ; i++)
+            {
+                  cm93_cell_image *pcell = m_prefetched.Item(i);
+                  if(pcell->cell_file == cell_file)
+                  {
+                        *pimg = *pcell;
+                        delete pcell;
+                        m_prefetched.RemoveAt(i);
+
+                        m_nprefetch_hits++;
+                        return true;
+                  }
+            }
+
+            m_nprefetch_misses++;
+      }
+
+      return LoadCellImage(cell_file, pimg);
+}
+
+//    Map the geometry cell from the cache, or else read the whole cell,
+//    decode it in one pass and resolve its geometry
+bool CM93CellCache::LoadCellImage(const wxString &cell_file, cm93_cell_image *pimg)
+{
+      pimg->pdata = NULL;
+      pimg->nbytes = 0;
+      pimg->pmap = NULL;
+      pimg->map_size = 0;
+      pimg->b_from_cache = false;
+      pimg->cell_file = cell_file;
+
+      wxFileName fn(cell_file);
+      int file_size = (int)fn.GetSize().GetLo();
+      int file_time = (int)fn.GetModificationTime().GetTicks();
+
+      if(ReadCacheFile(GetCacheFileName(cell_file), file_size, file_time, pimg))
+      {
+            wxMutexLocker lock(m_mutex);
+            m_nhits++;
+            pimg->b_from_cache = true;
+            return true;
+      }
+
+      {
+            wxMutexLocker lock(m_mutex);
+            m_nmisses++;
+      }
+
+      FILE *stream = fopen((const char *)cell_file.mb_str(), "rb");
+      if(!stream)
+            return false;
+
+      fseek(stream, 0, SEEK_END);
+      int file_length = ftell(stream);
+      fseek(stream, 0, SEEK_SET);
+
+      unsigned char *pcell = NULL;
+      if(file_length > 0)
+            pcell = (unsigned char *)malloc(file_length);
+
+      if(!pcell || !fread(pcell, file_length, 1, stream))
+      {
+            free(pcell);
+            fclose(stream);
+            return false;
+      }
+      fclose(stream);
+
+      decode_cm93_bytes(pcell, file_length);
+
+      Cell_Info_Block cib;
+      Clear_CM93_CIB(&cib);
+
+      bool bok = Ingest_CM93_Cell(pcell, file_length, &cib);
+      free(pcell);
+
+      if(bok)
+            bok = Resolve_CM93_Cell(&cib, file_size, file_time, &pimg->pdata, &pimg->nbytes);
+
+      Free_CM93_CIB(&cib);
+
+      return bok;
+}
+
+//    Map (or read) the cache file, if it is there and was made from this very cell file
+bool CM93CellCache::ReadCacheFile(const wxString &cache_file, int file_size, int file_time, cm93_cell_image *pimg)
+{
+      if(!wxFileName::FileExists(cache_file))
+            return false;
+
+#ifdef ocpnUSE_CM93_MMAP
+      int fd = open(cache_file.fn_str(), O_RDONLY);
+      if(fd == -1)
+            return false;
+
+      struct stat st;
+      if((fstat(fd, &st) != 0) || (st.st_size < (off_t)sizeof(cm93_geom_header)) || (st.st_size > INT_MAX))
+      {
+            close(fd);
+            return false;
+      }
+
+      void *pmap = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);                                      // the mapping holds its own reference
+      if(pmap == MAP_FAILED)
+            return false;
+
+      unsigned char *pbuf = (unsigned char *)pmap;
+      size_t buf_size = st.st_size;
+#else
+      wxFile cf(cache_file);
+      if(!cf.IsOpened())
+            return false;
+
+      size_t buf_size = cf.Length();
+      if((buf_size < sizeof(cm93_geom_header)) || (buf_size > INT_MAX))
+            return false;
+
+      unsigned char *pbuf = (unsigned char *)malloc(buf_size);
+      if(!pbuf)
+            return false;
+
+      if(cf.Read(pbuf, buf_size) != (ssize_t)buf_size)
+      {
+            free(pbuf);
+            return false;
+      }
+#endif
+
+      cm93_geom_header *phdr = (cm93_geom_header *)pbuf;
+
+      if((phdr->cell_file_size != file_size) || (phdr->cell_file_time != file_time)
+         || !Validate_CM93_Geom_Cell(pbuf, (int)buf_size))
+      {
+#ifdef ocpnUSE_CM93_MMAP
+            munmap(pbuf, buf_size);
+#else
+            free(pbuf);
+#endif
+            return false;
+      }
+
+      pimg->pdata = pbuf;
+      pimg->nbytes = (int)buf_size;
+#ifdef ocpnUSE_CM93_MMAP
+      pimg->pmap = pbuf;
+      pimg->map_size = buf_size;
+#endif
+
+      return true;
+}
+
+//    Done with an image.  A freshly resolved cell is handed to the writer
+//    thread; anything else is released here.
+void CM93CellCache::ReleaseCell(cm93_cell_image *pimg)
+{
+      if(pimg->pmap)
+      {
+#ifdef ocpnUSE_CM93_MMAP
+            munmap(pimg->pmap, pimg->map_size);
+#endif
+      }
+      else if(!pimg->b_from_cache && pimg->pdata)
+      {
+            CM93CacheWriteJob *pjob = new CM93CacheWriteJob;
+            pjob->m_cache_file = GetCacheFileName(pimg->cell_file);
+            pjob->m_pdata = pimg->pdata;
+            pjob->m_nbytes = pimg->nbytes;
+
+            if(!QueueWrite(pjob))
+            {
+                  free(pjob->m_pdata);
+                  delete pjob;
+            }
+      }
+      else
+            free(pimg->pdata);
+
+      pimg->pdata = NULL;
+      pimg->pmap = NULL;
+}
+
+//    Called from the prefetch thread too
+bool CM93CellCache::QueueWrite(CM93CacheWriteJob *pjob)
+{
+      if(!m_pwriter)
+            return false;
+
+      {
+            wxMutexLocker lock(m_mutex);
+
+            //    Bound the memory held by pending writes
+            if(m_bstop || (m_jobs.GetCount() >= CM93_GEOM_CACHE_MAX_PENDING))
+                  return false;
+
+            m_jobs.Add(pjob);
+      }
+
+      m_semaphore.Post();
+      return true;
+}
+
+//    Writer interface.  Blocks until there is a job, or returns NULL when stopping.
+CM93CacheWriteJob *CM93CellCache::WaitForJob()
+{
+      m_semaphore.Wait();
+
+      wxMutexLocker lock(m_mutex);
+      if(m_bstop || !m_jobs.GetCount())
+            return NULL;
+
+      CM93CacheWriteJob *pjob = m_jobs.Item(0);
+      m_jobs.RemoveAt(0);
+      return pjob;
+}
+
+//    Write to a temporary file first, so a half written cache file is never seen
+bool CM93CellCache::WriteCacheFile(CM93CacheWriteJob *pjob)
+{
+      wxString tmp_file = pjob->m_cache_file;
+      tmp_file += _T(".tmp");
+
+      bool bok;
+      {
+            wxFile cf;
+            if(!cf.Create(tmp_file, true))
+                  return false;
+
+            bok = (cf.Write(pjob->m_pdata, pjob->m_nbytes) == (size_t)pjob->m_nbytes);
+      }
+
+      if(bok)
+            bok = wxRenameFile(tmp_file, pjob->m_cache_file, true);
+
+      if(!bok)
+            wxRemoveFile(tmp_file);
+      else
+            m_cache_bytes += pjob->m_nbytes;
+
+      if(m_cache_bytes > CM93_GEOM_CACHE_MAX_BYTES)
+            TrimCacheDir();
+
+      return bok;
+}
+
+//    Keep the cache directory within CM93_GEOM_CACHE_MAX_BYTES, removing the
+//    least recently written cells first.  Called on the writer thread only.
+void CM93CellCache::TrimCacheDir()
+{
+      wxArrayString files;
+      wxDir::GetAllFiles(wxString(m_cache_dir.c_str()), &files, _T("*.gcl*"), wxDIR_FILES);
+
+      m_cache_bytes = 0;
+      wxArrayInt times;
+      wxArrayInt sizes;
+      for(unsigned int i=0 ; i < files.GetCount() ; i++)
+      {
+            wxFileName fn(files.Item(i));
+            times.Add((int)fn.GetModificationTime().GetTicks());
+            sizes.Add((int)fn.GetSize().GetLo());
+            m_cache_bytes += sizes.Last();
+      }
+
+      //    Trim well below the limit, so as not to do this on every write
+      while((m_cache_bytes > CM93_GEOM_CACHE_MAX_BYTES * 3. / 4.) && files.GetCount())
+      {
+            unsigned int iold = 0;
+            for(unsigned int i=1 ; i < files.GetCount() ; i++)
+            {
+                  if(times.Item(i) < times.Item(iold))
+                        iold = i;
+            }
+
+            wxRemoveFile(files.Item(iold));
+            m_cache_bytes -= sizes.Item(iold);
+
+            files.RemoveAt(iold);
+            times.RemoveAt(iold);
+            sizes.RemoveAt(iold);
+      }
+}
+
+
+//    Prefetching
+
+void CM93CellCache::RequestPrefetch(const wxString &prefix, const ArrayOfInts &keys)
+{
+      {
+            wxMutexLocker lock(m_mutex);
+            if(m_bstop)
+                  return;
+
+            //    Newer predictions supersede older ones
+            m_prefetch_prefix = wxString(prefix.c_str());
+            m_prefetch_requests.Clear();
+            for(unsigned int i=0 ; i < keys.GetCount() ; i++)
+                  m_prefetch_requests.Add(keys.Item(i));
+      }
+
+      if(!keys.GetCount())
+            return;
+
+      if(!m_pprefetcher)
+      {
+            m_pprefetcher = new CM93PrefetchThread(this);
+            if((m_pprefetcher->Create() != wxTHREAD_NO_ERROR) || (m_pprefetcher->Run() != wxTHREAD_NO_ERROR))
+            {
+                  delete m_pprefetcher;
+                  m_pprefetcher = NULL;
+
+                  wxMutexLocker lock(m_mutex);
+                  m_prefetch_requests.Clear();
+                  return;
+            }
+            m_pprefetcher->SetPriority(WXTHREAD_MIN_PRIORITY);
+      }
+
+      m_prefetch_semaphore.Post();
+}
+
+void CM93CellCache::GetPrefetchStats(int *hits, int *misses, int *unused)
+{
+      wxMutexLocker lock(m_mutex);
+      *hits = m_nprefetch_hits;
+      *misses = m_nprefetch_misses;
+      *unused = m_nprefetch_unused;
+}
+
+//    Prefetch thread interface.  Returns false when the thread should exit.
+bool CM93CellCache::WaitForPrefetch()
+{
+      m_prefetch_semaphore.Wait();
+
+      wxMutexLocker lock(m_mutex);
+      return !m_bstop;
+}
+
+bool CM93CellCache::IsPrefetched(const wxString &cell_file)
+{
+      wxMutexLocker lock(m_mutex);
+
+      for(unsigned int i=0 ; i < m_prefetched.GetCount() ; i++)
+      {
+            if(m_prefetched.Item(i)->cell_file == cell_file)
+                  return true;
+      }
+      return false;
+}
+
+//    Take ownership of a prefetched image, making room by dropping the oldest one
+void CM93CellCache::StorePrefetched(cm93_cell_image *pimg)
+{
+      cm93_cell_image *pdrop = NULL;
+      {
+            wxMutexLocker lock(m_mutex);
+
+            if(!m_bstop)
+            {
+                  if(m_prefetched.GetCount() >= CM93_PREFETCH_MAX_CELLS)
+                  {
+                        pdrop = m_prefetched.Item(0);
+                        m_prefetched.RemoveAt(0);
+                        m_nprefetch_unused++;
+                  }
+                  m_prefetched.Add(pimg);
+                  pimg = NULL;
+            }
+      }
+
+      if(pdrop)
+      {
+            ReleaseCell(pdrop);
+            delete pdrop;
+      }
+
+      if(pimg)
+      {
+            ReleaseCell(pimg);
+            delete pimg;
+      }
+}
+
+//    Load every (sub)cell of the outstanding requests, until they run out or are replaced
+void CM93CellCache::ServicePrefetchRequests()
+{
+      while(true)
+      {
+            int key;
+            wxString prefix;
+            {
+                  wxMutexLocker lock(m_mutex);
+                  if(m_bstop || !m_prefetch_requests.GetCount())
+                        return;
+
+                  key = m_prefetch_requests.Item(0);
+                  m_prefetch_requests.RemoveAt(0);
+                  prefix = wxString(m_prefetch_prefix.c_str());
+            }
+
+            int cellindex = key / 8;
+            int scale_index = key % 8;
+
+            wxChar scale_char;
+            int dval = get_dval(Get_CM93_Native_Scale(scale_index, &scale_char));
+            wxString scalechar(scale_char);
+
+            wxChar sub_char = '0';
+            while(true)
+            {
+                  wxString file = Find_CM93_Cell_File(prefix, cellindex, dval, scalechar, sub_char);
+
+                  if(file.IsEmpty())
+                  {
+                        if(sub_char != '0')
+                              break;                        // no more subcells
+                  }
+                  else if(!IsPrefetched(file))
+                  {
+                        cm93_cell_image *pimg = new cm93_cell_image;
+                        if(LoadCellImage(file, pimg))
+                        {
+                              pimg->cell_file = wxString(file.c_str());         // owned by the main thread from here on
+                              StorePrefetched(pimg);
+                        }
+                        else
+                              delete pimg;
+                  }
+
+                  sub_char = (sub_char == '0') ? 'A' : sub_char + 1;
+            }
+      }
+}
+
+
+CM93CacheWriterThread::CM93CacheWriterThread(CM93CellCache *pcache)
+      : wxThread(wxTHREAD_JOINABLE)
+{
+      m_pcache = pcache;
+}
+
+void *CM93CacheWriterThread::Entry()
+{
+      //    Bring a cache left over from earlier sessions within its limit
+      m_pcache->TrimCacheDir();
+
+      CM93CacheWriteJob *pjob;
+      while((pjob = m_pcache->WaitForJob()) != NULL)
+      {
+            m_pcache->WriteCacheFile(pjob);
+            free(pjob->m_pdata);
+            delete pjob;
+      }
+
+      return 0;
+}
+
+
+CM93PrefetchThread::CM93PrefetchThread(CM93CellCache *pcache)
+      : wxThread(wxTHREAD_JOINABLE)
+{
+      m_pcache = pcache;
+}
+
+void *CM93PrefetchThread::Entry()
+{
+      while(m_pcache->WaitForPrefetch())
+            m_pcache->ServicePrefetchRequests();
+
+      return 0;
+}
+
+
+//----------------------------------------------------------------------------------
+//      cm93chart Implementation
+//----------------------------------------------------------------------------------
+
+cm93chart::cm93chart()
+{
+      m_ChartType = CHART_TYPE_CM93;
+
+//    Create the decode table once, if needed
+      if(!cm93_decode_table_created)
+      {
+            CreateDecodeTable();
+            cm93_decode_table_created = true;
+      }
+
+ //    Create a global instance of the cm93 manager
+      if(!s_pcm93mgr)
+          s_pcm93mgr = new cm93manager();
+
+      m_pDict = NULL;
+
+      m_current_cell_vearray_offset = 0;
+
+      m_cell_image.pdata = NULL;
+      m_cell_image.nbytes = 0;
+      m_cell_image.pmap = NULL;
+      m_cell_image.map_size = 0;
+      m_cell_image.b_from_cache = false;
+
+    //  Establish a common reference point for the cell
+      ref_lat = 0.;
+      ref_lon = 0.;
+
+
+
+    //  Need a covr_set
+      m_pcovr_set = new covr_set(this);
+
+
+      //    Make initial allocation of shared outline drawing buffer
+      m_pDrawBuffer = (wxPoint *)malloc(4 * sizeof(wxPoint));
+      m_nDrawBufferSize = 1;
+
+
+/*
+      ooFILE *flstreamt = fopen("/home/dsr/Desktop/Charts/CM93_May2009/03300060/03300060.INF", "rb");
+      if(flstreamt)
+      {
+            void *p = calloc(10000, 1);
+            read_and_decode_bytes(flstreamt, p, 10000);
+            FILE *flstreamo = fopen("/home/dsr/03300060.info", "wb");
+            fwrite ( p, 1, 10000, flstreamo );
+            fclose(flstreamo);
+      }
+*/
+
+}
+
+cm93chart::~cm93chart()
+{
+      delete m_pcovr_set;
+
+      free(m_pDrawBuffer);
+
+}
+
+void  cm93chart::Unload_CM93_Cell(void)
+{
+      if(m_cell_image.pdata)
+            s_pcm93mgr->GetCellCache()->ReleaseCell(&m_cell_image);
+}
+
+
+//    The idea here is to suggest to upper layers the appropriate scale values to be used with this chart
+//    If max is too large, performance suffers, and the charts are very cluttered onscreen.
+//    If the min is too small, then the chart rendereding will be over-scaled, and accuracy suffers.
+//    In some ways, this is subjective.....
+
+double cm93chart::GetNormalScaleMin(double canvas_scale_factor, bool b_allow_overzoom)
+{
+      switch(GetNativeScale())
+      {
+            case 20000000: return 3000000.;           // Z
+            case  3000000: return 1000000.;           // A
+            case  1000000: return 200000.;            // B
+            case   200000: return 40000.;             // C
+            case   100000: return 20000.;             // D
+            case    50000: return 10000.;             // E
+            case    20000: return 5000.;              // F
+            case     7500: return 3500.;              // G
+      }
+
+      return 1.0;
+}
+
+double cm93chart::GetNormalScaleMax(double canvas_scale_factor)
+{
+      switch(GetNativeScale())
+      {
+            case 20000000: return 50000000.;          // Z
+            case  3000000: return 6000000.;           // A
+            case  1000000: return 2000000.;           // B
+            case   200000: return 400000.;            // C
+            case   100000: return 200000.;            // D
+            case    50000: return 100000.;            // E
+            case    20000: return 40000.;             // F
+            case     7500: return 15000.;             // G
+      }
+
+      return 1.0e7;
+}
+
+
+void cm93chart::GetPointPix(ObjRazRules *rzRules, float north, float east, wxPoint *r)
+{
+      S57Obj *obj = rzRules->obj;
+
+      double valx = (east * obj->x_rate)  + obj->x_origin;
+      double valy = (north * obj->y_rate) + obj->y_origin;
+
+            //    Crossing Greenwich right
+      if(m_vp_current.GetBBox().GetMaxX() > 360.)
+      {
+            wxBoundingBox bbRight(0., m_vp_current.GetBBox().GetMinY(), m_vp_current.GetBBox().GetMaxX() - 360., m_vp_current.GetBBox().GetMaxY());
+            if ( bbRight.Intersect ( rzRules->obj->BBObj, 0 ) != _OUT )
+            {
+                  valx += mercator_k0 * WGS84_semimajor_axis_meters * 2.0 * PI;      //6375586.0;
+            }
+      }
 
       r->x = (int)wxRound(((valx - m_easting_vp_center) * m_view_scale_ppm) + m_pixx_vp_center);
       r->y = (int)wxRound(m_pixy_vp_center - ((valy - m_northing_vp_center) * m_view_scale_ppm));
@@ -2178,65 +3340,14 @@ ArrayOfInts cm93chart::GetVPCellArray(const ViewPort &vpt)
       //    Fetch the lat/lon of the screen corner points
       ViewPort vptl = vpt;
       LLBBox box = vptl.GetBBox();
-      double ll_lon = box.GetMinX();
-      double ll_lat = box.GetMinY();
-
-      double ur_lon = box.GetMaxX();
-      double ur_lat = box.GetMaxY();
-
-      //    Adjust to always positive for easier cell calculations
-      if(ll_lon < 0)
-      {
-            ll_lon += 360;
-            ur_lon += 360;
-      }
 
      //    Create an array of CellIndexes covering the current viewport
-      ArrayOfInts vpcells;
-
-      vpcells.Clear();
-
-      int lower_left_cell = Get_CM93_CellIndex(ll_lat, ll_lon, GetNativeScale());
-      vpcells.Add(lower_left_cell);                   // always add the lower left cell
-
-      if(g_bDebugCM93)
-            printf("cm93chart::GetVPCellArray   Adding %d\n", lower_left_cell);
-
-      double rlat, rlon;
-      Get_CM93_Cell_Origin(lower_left_cell, GetNativeScale(), &rlat, &rlon);
-
-
-      // Use exact integer math here
-      //    It is more obtuse, but it removes dependency on FP rounding policy
-
-      int loni_0 = (int)wxRound(rlon * 3);
-      int loni_20 = loni_0 + (int)m_dval;               // already added the lower left cell
-      int lati_20 = (int)wxRound(rlat * 3);
-
-
-      while(lati_20 < (ur_lat * 3.))
-      {
-            while(loni_20 < (ur_lon * 3.))
-            {
-                  unsigned int next_lon = loni_20 + 1080;
-                  while(next_lon >= 1080)
-                        next_lon -= 1080;
-
-                  unsigned int next_cell = next_lon;
-
-                  next_cell += (lati_20 + 270) * 10000;
-
-                  vpcells.Add((int)next_cell);
-                  if(g_bDebugCM93)
-                        printf("cm93chart::GetVPCellArray   Adding %d\n", next_cell);
-
-                  loni_20 += (int)m_dval;
-            }
-            lati_20 += (int)m_dval;
-            loni_20 = loni_0;
-      }
+      return Get_CM93_CellIndexArray(box.GetMinY(), box.GetMinX(), box.GetMaxY(), box.GetMaxX(), GetNativeScale());
+}
 
-      return vpcells;
+bool cm93chart::IsCellLoaded(int cellindex)
+{
+      return (wxNOT_FOUND != m_cells_loaded_array.Index(cellindex));
 }
 
 
@@ -2288,23 +3399,24 @@ void cm93chart::ProcessVectorEdges(void)
       VE_Hash &vehash = Get_ve_hash();
 
       m_current_cell_vearray_offset = vehash.size();           // keys start at the current size
-      geometry_descriptor *pgd = m_CIB.edge_vector_descriptor_block;
+      cm93_geom_header *phdr = (cm93_geom_header *)m_cell_image.pdata;
+      cm93_geom_edge *pedge = (cm93_geom_edge *)(m_cell_image.pdata + phdr->edge_table);
 
-      for(int iedge = 0 ; iedge < m_CIB.m_nvector_records ; iedge++)
+      for(int iedge = 0 ; iedge < phdr->n_edges ; iedge++)
       {
             VE_Element *vep = new VE_Element;
             vep->index = iedge + m_current_cell_vearray_offset;
-            vep->nCount = pgd->n_points;
+            vep->nCount = pedge->n_points;
             vep->pPoints = NULL;
             vep->max_priority = -99;            // Default
 
-            if(pgd->n_points)
+            if(pedge->n_points)
             {
-                  double *pPoints = (double *)malloc(pgd->n_points * 2 * sizeof(double));
+                  double *pPoints = (double *)malloc(pedge->n_points * 2 * sizeof(double));
                   vep->pPoints = pPoints;
 
-                  cm93_point *ppt = pgd->p_points;
-                  for(int ip = 0 ; ip < pgd->n_points ; ip++)
+                  cm93_point *ppt = (cm93_point *)(m_cell_image.pdata + pedge->points);
+                  for(int ip = 0 ; ip < pedge->n_points ; ip++)
                   {
                         *pPoints++ = ppt->x;
                         *pPoints++ = ppt->y;
@@ -2314,7 +3426,7 @@ void cm93chart::ProcessVectorEdges(void)
 
             vehash[vep->index] = vep;
 
-            pgd++;                              // next geometry descriptor
+            pedge++;                            // next edge
       }
 
 
@@ -2335,7 +3447,8 @@ int cm93chart::CreateObjChain(int cell_index, int subcell)
 
  //     CALLGRIND_START_INSTRUMENTATION
 
-      Object *pobjectDef = m_CIB.pobject_block;           // head of object array
+      Object objectDef;
+      Object *pobjectDef = &objectDef;
       m_CIB.b_have_offsets = false;                       // will be set if any M_COVRs in this cell have defined, non-zero WGS84 offsets
       m_CIB.b_have_user_offsets = false;                  // will be set if any M_COVRs in this cell have user defined offsets
 
@@ -2344,13 +3457,15 @@ int cm93chart::CreateObjChain(int cell_index, int subcell)
 
       while(iObj < m_CIB.m_nfeature_records)
       {
+            GetCellObject(iObj, pobjectDef);
+
             if((pobjectDef != NULL))
             {
 
 //                  if(pobjectDef->n_related_objects)
 //                        int yyp = 5;
 
-                  Extended_Geometry *xgeom = BuildGeom(pobjectDef, NULL, iObj);
+                  Extended_Geometry *xgeom = BuildGeom(iObj);
 
                   obj = NULL;
                   if(NULL != xgeom)
@@ -2457,8 +3572,6 @@ int cm93chart::CreateObjChain(int cell_index, int subcell)
             else                    // objectdef == NULL
                   break;
 
-            pobjectDef++;
-
             iObj++;
       }
 
@@ -2565,300 +3678,107 @@ InitReturn cm93chart::Init( const wxString& name, ChartInitFlag flags )
 
 }
 
-Extended_Geometry *cm93chart::BuildGeom(Object *pobject, wxFileOutputStream *postream, int iobject)
+//    The object record of the loaded cell, as CreateS57Obj() expects it.
+//    The geometry is not filled in; it comes from BuildGeom().
+void cm93chart::GetCellObject(int iobject, Object *pobject)
+{
+      cm93_geom_header *phdr = (cm93_geom_header *)m_cell_image.pdata;
+      cm93_geom_object *pgo = (cm93_geom_object *)(m_cell_image.pdata + phdr->object_table) + iobject;
+
+      memset(pobject, 0, sizeof(Object));
+
+      pobject->otype = pgo->otype;
+      pobject->geotype = pgo->geotype;
+      pobject->n_attributes = pgo->n_attributes;
+
+      if(pgo->attributes >= 0)
+            pobject->attributes_block = m_cell_image.pdata + phdr->attribute_block + pgo->attributes;
+}
 
+//    Build the Extended_Geometry of an object from its resolved geometry
+Extended_Geometry *cm93chart::BuildGeom(int iobject)
 {
-      wxString s;
-      int geomtype;
-
-      int geom_type_maybe = pobject->geotype;
-
-      switch(geom_type_maybe){
-            case 1:    geomtype = 1; break;
-            case 2:    geomtype = 2; break;
-            case 4:    geomtype = 3; break;
-            case 129:  geomtype = 1; break;
-            case 130:  geomtype = 2; break;
-            case 132:  geomtype = 3; break;
-            case 8:    geomtype = 8; break;
-            case 16:   geomtype = 16; break;
-            case 161:  geomtype = 1; break;    // lighthouse first child
-            case 33:   geomtype = 1; break;
-            default:
-                  geomtype = -1; break;
-      }
+      unsigned char *pdata = m_cell_image.pdata;
+      cm93_geom_header *phdr = (cm93_geom_header *)pdata;
+      cm93_geom_object *pgo = (cm93_geom_object *)(pdata + phdr->object_table) + iobject;
 
-      int iseg;
+      int geomtype = pgo->geomtype;
+      if(geomtype < 0)
+      {
+            wxPrintf(_T("Unexpected geomtype %d for Feature %d\n"), pgo->geotype, iobject);
+            return NULL;
+      }
 
       Extended_Geometry *ret_ptr = new Extended_Geometry;
-
-      int lon_max, lat_max, lon_min, lat_min;
-      lon_max = 0; lon_min = 65536; lat_max = 0; lat_min = 65536;
+      memset(ret_ptr, 0, sizeof(Extended_Geometry));
 
       switch(geomtype){
 
             case 3:                               // Areas
+            case 2:                               // LINE geometry
             {
-                  vector_record_descriptor *psegs = (vector_record_descriptor *)pobject->pGeometry;
+                  cm93_geom_poly *ppoly = (cm93_geom_poly *)(pdata + pgo->geometry);
+                  int *pedge = (int *)(ppoly + 1);
+                  cm93_point *ppt = (cm93_point *)(pedge + ppoly->n_vector_indices);
+                  int *pcontour = (int *)(ppt + ppoly->n_max_vertex);
 
-                  int nsegs = pobject->n_geom_elements;
+                  int nsegs = ppoly->n_vector_indices;
 
                   ret_ptr->n_vector_indices = nsegs;
                   ret_ptr->pvector_index = (int *)malloc(nsegs * 3 * sizeof(int));
-
-                  //Traverse the object once to get a maximum polygon vertex count
-                  int n_maxvertex = 0;
-                  for(int i=0 ; i < nsegs ; i++)
-                  {
-                        geometry_descriptor *pgd = (geometry_descriptor*)(psegs[i].pGeom_Description);
-                        n_maxvertex += pgd->n_points;
-                  }
-
-                  //TODO  May not need this fluff adder....
-                  n_maxvertex += 1;       // fluff
-
-                  wxPoint2DDouble *pPoints = (wxPoint2DDouble *)calloc((n_maxvertex) * sizeof(wxPoint2DDouble), 1);
-
-                  int ip = 1;
-                  int n_prev_vertex_index = 1;
-                  bool bnew_ring = true;
-                  int ncontours = 0;
-                  iseg = 0;
-
-                  cm93_point start_point;
-                  start_point.x = 0; start_point.y = 0;
-
-                  cm93_point cur_end_point;
-                  cur_end_point.x = 1; cur_end_point.y = 1;
-
-                  int n_max_points = -1;
-                  while(iseg < nsegs)
+                  for(int iseg = 0 ; iseg < nsegs ; iseg++)
                   {
-                        int type_seg = psegs[iseg].segment_usage;
-
-                        geometry_descriptor *pgd = (geometry_descriptor*)(psegs[iseg].pGeom_Description);
-
-                        int npoints = pgd->n_points;
-                        cm93_point *rseg = pgd->p_points;
-
-                        n_max_points = wxMax(n_max_points, npoints);
-
-                        //    Establish ring starting conditions
-                        if(bnew_ring)
-                        {
-                              bnew_ring = false;
-
-                              if((type_seg & 4) == 0)
-                                    start_point = rseg[0];
-                              else
-                                    start_point = rseg[npoints-1];
-                        }
-
-
-
-                        if(((type_seg & 4) == 0))
-                        {
-                              cur_end_point = rseg[npoints-1];
-                              for(int j=0 ; j<npoints  ; j++)
-                              {
-//                                    if(ncontours == 0)                             // outer ring describes envelope
-                                    {
-                                          lon_max = wxMax(lon_max, rseg[j].x);
-                                          lon_min = wxMin(lon_min, rseg[j].x);
-                                          lat_max = wxMax(lat_max, rseg[j].y);
-                                          lat_min = wxMin(lat_min, rseg[j].y);
-                                    }
-
-                                    pPoints[ip].m_x = rseg[j].x;
-                                    pPoints[ip].m_y = rseg[j].y;
-                                    ip++;
-                              }
-                       }
-                        else if((type_seg & 4) == 4)        // backwards
-                        {
-                              cur_end_point = rseg[0];
-                              for(int j=npoints-1 ; j>= 0  ; j--)
-                              {
-//                                    if(ncontours == 0)                             // outer ring describes envelope
-                                    {
-                                          lon_max = wxMax(lon_max, rseg[j].x);
-                                          lon_min = wxMin(lon_min, rseg[j].x);
-                                          lat_max = wxMax(lat_max, rseg[j].y);
-                                          lat_min = wxMin(lat_min, rseg[j].y);
-                                    }
-
-                                    pPoints[ip].m_x = rseg[j].x;
-                                    pPoints[ip].m_y = rseg[j].y;
-                                    ip++;
-                              }
-                        }
-
-                        ip--;                                                 // skip the last point in each segment
-
                         ret_ptr->pvector_index[iseg * 3 + 0] = -1;                 // first connected node
-                        ret_ptr->pvector_index[iseg * 3 + 1] = pgd->index + m_current_cell_vearray_offset;         // edge index
+                        ret_ptr->pvector_index[iseg * 3 + 1] = pedge[iseg] + m_current_cell_vearray_offset;         // edge index
                         ret_ptr->pvector_index[iseg * 3 + 2] = -2;                 // last connected node
+                  }
 
-                        if((cur_end_point.x == start_point.x) && (cur_end_point.y == start_point.y))
-                        {
-                              // done with a ring
-
-                              ip++;                                                 // leave in ring closure point
-
-                              int nRingVertex = ip - n_prev_vertex_index;
-
-                              //    possibly increase contour array size
-                              if(ncontours > m_ncontour_alloc - 1)
-                              {
-                                    m_ncontour_alloc *= 2;
-                                    m_pcontour_array = (int *)realloc(m_pcontour_array, m_ncontour_alloc * sizeof(int));
-                              }
-                              m_pcontour_array[ncontours] = nRingVertex;               // store the vertex count
-
-                              bnew_ring = true;                                               // set for next ring
-                              n_prev_vertex_index = ip;
-                              ncontours++;
-
-                        }
-                        iseg++;
-                  }           // while iseg
-
-
-                  ret_ptr->n_max_edge_points = n_max_points;
-
-                  ret_ptr->n_contours = ncontours;                          // parameters passed to trapezoid tesselator
-
-                  ret_ptr->contour_array = (int *)malloc(ncontours * sizeof(int));
-                  memcpy(ret_ptr->contour_array, m_pcontour_array, ncontours * sizeof(int));
+                  int n_maxvertex = ppoly->n_max_vertex;
+                  wxPoint2DDouble *pPoints = (wxPoint2DDouble *)malloc(n_maxvertex * sizeof(wxPoint2DDouble));
+                  for(int ip = 0 ; ip < n_maxvertex ; ip++)
+                  {
+                        pPoints[ip].m_x = ppt[ip].x;
+                        pPoints[ip].m_y = ppt[ip].y;
+                  }
 
                   ret_ptr->vertex_array = pPoints;
                   ret_ptr->n_max_vertex = n_maxvertex;
+                  ret_ptr->n_max_edge_points = ppoly->n_max_edge_points;
 
-                  ret_ptr->pogrGeom = NULL;
+                  if(geomtype == 3)
+                  {
+                        ret_ptr->n_contours = ppoly->n_contours;          // parameters passed to trapezoid tesselator
+                        ret_ptr->contour_array = (int *)malloc(ppoly->n_contours * sizeof(int));
+                        memcpy(ret_ptr->contour_array, pcontour, ppoly->n_contours * sizeof(int));
+                  }
 
-                  ret_ptr->xmin = lon_min;
-                  ret_ptr->xmax = lon_max;
-                  ret_ptr->ymin = lat_min;
-                  ret_ptr->ymax = lat_max;
+                  ret_ptr->xmin = ppoly->xmin;
+                  ret_ptr->xmax = ppoly->xmax;
+                  ret_ptr->ymin = ppoly->ymin;
+                  ret_ptr->ymax = ppoly->ymax;
 
                   break;
-            }           // case 3
-
-
+            }
 
             case 1:     //single points
             {
-                  cm93_point *pt = (cm93_point *)pobject->pGeometry;
-                  ret_ptr->pogrGeom = NULL; //t;
+                  cm93_point *pt = (cm93_point *)(pdata + pgo->geometry);
 
                   ret_ptr->pointx = pt->x;
                   ret_ptr->pointy = pt->y;
                   break;
             }
 
-            case 2:                                               // LINE geometry
+            case 8:
             {
-                  vector_record_descriptor *psegs = (vector_record_descriptor *)pobject->pGeometry;
-
-                  int nsegs = pobject->n_geom_elements;
-
-                  ret_ptr->n_vector_indices = nsegs;
-                  ret_ptr->pvector_index = (int *)malloc(nsegs * 3 * sizeof(int));
-
-                  //    Calculate the number of points
-                  int n_maxvertex = 0;
-                  for(int imseg = 0 ; imseg < nsegs ; imseg++)
-                  {
-                        geometry_descriptor *pgd = (geometry_descriptor*)psegs->pGeom_Description;
-
-                        n_maxvertex += pgd->n_points;
-                        psegs++;
-                  }
+                  int npoints;
+                  memcpy(&npoints, pdata + pgo->geometry, sizeof(int));
+                  cm93_point_3d *rseg = (cm93_point_3d *)(pdata + pgo->geometry + sizeof(int));
 
+                  OGRMultiPoint *pSMP = new OGRMultiPoint;
 
-                  wxPoint2DDouble *pPoints = (wxPoint2DDouble *)malloc(n_maxvertex * sizeof(wxPoint2DDouble));
-
-                  psegs = (vector_record_descriptor *)pobject->pGeometry;
-
-                  int ip = 0;
                   int lon_max, lat_max, lon_min, lat_min;
                   lon_max = 0; lon_min = 65536; lat_max = 0; lat_min = 65536;
-                  int n_max_points = -1;
-
-                  for(int iseg = 0 ; iseg < nsegs ; iseg++)
-                  {
-
-                        int type_seg = psegs->segment_usage;
-
-                        geometry_descriptor *pgd = (geometry_descriptor*)psegs->pGeom_Description;
-
-                        psegs++;          // next segment
-
-                        int npoints = pgd->n_points;
-                        cm93_point *rseg = pgd->p_points;
-
-                        n_max_points = wxMax(n_max_points, npoints);
-
-                        if(((type_seg & 4) != 4))
-                        {
-                              for(int j=0 ; j<npoints  ; j++)
-                              {
-                                    lon_max = wxMax(lon_max, rseg[j].x);
-                                    lon_min = wxMin(lon_min, rseg[j].x);
-                                    lat_max = wxMax(lat_max, rseg[j].y);
-                                    lat_min = wxMin(lat_min, rseg[j].y);
-
-                                    pPoints[ip].m_x = rseg[j].x;
-                                    pPoints[ip].m_y = rseg[j].y;
-                                    ip++;
-
-                              }
-                        }
-
-                        else if((type_seg & 4) == 4)        // backwards
-                        {
-                              for(int j=npoints-1 ; j>= 0  ; j--)
-                              {
-                                     lon_max = wxMax(lon_max, rseg[j].x);
-                                     lon_min = wxMin(lon_min, rseg[j].x);
-                                     lat_max = wxMax(lat_max, rseg[j].y);
-                                     lat_min = wxMin(lat_min, rseg[j].y);
-
-                                     pPoints[ip].m_x = rseg[j].x;
-                                     pPoints[ip].m_y = rseg[j].y;
-                                     ip++;
-                              }
-                        }
-
-                        ret_ptr->pvector_index[iseg * 3 + 0] = -1;                 // first connected node
-                        ret_ptr->pvector_index[iseg * 3 + 1] = pgd->index + m_current_cell_vearray_offset;         // edge index
-                        ret_ptr->pvector_index[iseg * 3 + 2] = -2;                 // last connected node
-
-                  }           //for
-
-                  ret_ptr->n_max_edge_points = n_max_points;
-
-                  ret_ptr->vertex_array = pPoints;
-                  ret_ptr->n_max_vertex = n_maxvertex;
-
-                  ret_ptr->pogrGeom = NULL;
-
-                  ret_ptr->xmin = lon_min;
-                  ret_ptr->xmax = lon_max;
-                  ret_ptr->ymin = lat_min;
-                  ret_ptr->ymax = lat_max;
-
-                  break;
-            }           //case 2  (lines)
-
-            case 8:
-            {
-                  geometry_descriptor *pgd = (geometry_descriptor*)pobject->pGeometry;
-
-                  int npoints = pgd->n_points;
-                  cm93_point_3d *rseg = (cm93_point_3d *)pgd->p_points;
-
-                  OGRMultiPoint *pSMP = new OGRMultiPoint;
 
                   int z;
                   double zp;
@@ -2889,21 +3809,13 @@ Extended_Geometry *cm93chart::BuildGeom(Object *pobject, wxFileOutputStream *pos
                   ret_ptr->ymin = lat_min;
                   ret_ptr->ymax = lat_max;
 
-
                   break;
             }
 
-
             case 16:
+            default:
                   break;                        // this is the case of objects with children
                                                       // the parent has no geometry.....
-
-            default:
-            {
-                  wxPrintf(_T("Unexpected geomtype %d for Feature %d\n"), geomtype,iobject);
-                  break;
-            }
-
       }     // switch
 
 
@@ -4241,11 +5153,14 @@ void cm93chart::ProcessMCOVRObjects(int cell_index, char subcell)
 {
       //Extract the m_covr structures inline
 
-      Object *pobject = m_CIB.pobject_block;           // head of object array
+      Object object;
+      Object *pobject = &object;
 
       int iObj = 0;
       while(iObj < m_CIB.m_nfeature_records)
       {
+            GetCellObject(iObj, pobject);
+
             if((pobject != NULL) )
             {
                                     //    Look for and process m_covr object(s)
@@ -4258,7 +5173,7 @@ void cm93chart::ProcessMCOVRObjects(int cell_index, char subcell)
                         M_COVR_Desc *pmcd = m_pcovr_set->Find_MCD(cell_index, iObj, (int)subcell);
                         if(NULL == pmcd)
                         {
-                              Extended_Geometry *xgeom = BuildGeom(pobject, NULL, iObj);
+                              Extended_Geometry *xgeom = BuildGeom(iObj);
 
                               //    Decode the attributes, specifically looking for _wgsox, _wgsoy
 
@@ -4357,7 +5272,6 @@ void cm93chart::ProcessMCOVRObjects(int cell_index, char subcell)
             else                    // objectdef == NULL
                   break;
 
-            pobject++;
             iObj++;
       }
 }
@@ -4428,13 +5342,6 @@ int cm93chart::loadcell_in_sequence(int cellindex, char subcell)
 
 int cm93chart::loadsubcell(int cellindex, wxChar sub_char)
 {
-
-      //    Create the file name
-
-      int ilat = cellindex / 10000;
-      int ilon = cellindex % 10000;
-
-
       if(g_bDebugCM93)
       {
             double dlat = m_dval / 3.;
@@ -4444,75 +5351,21 @@ int cm93chart::loadsubcell(int cellindex, wxChar sub_char)
             printf("\n   Attempting loadcell %d scale %c, sub_char %c at lat: %g/%g lon:%g/%g\n", cellindex, wxChar(m_scalechar[0]), sub_char, lat, lat + dlat, lon, lon+dlon);
       }
 
-      int jlat = (int)(((ilat - 30) / m_dval) * m_dval) + 30;              // normalize
-      int jlon = (int)((ilon / m_dval) * m_dval);
-
-      int ilatroot = (((ilat - 30) / 60) * 60) + 30;
-      int ilonroot = (ilon / 60) * 60;
-
-      wxString file;
-      file.Printf(_T("%04d%04d."), jlat, jlon);
-      file += m_scalechar;
-
-
-
-      wxString fileroot;
-      fileroot.Printf(_T("%04d%04d/"), ilatroot, ilonroot);
-      fileroot += m_scalechar;
-      fileroot += _T("/");
-      fileroot.Prepend(m_prefix);
-
-      file[0] = sub_char;
-      file.Prepend(fileroot);
-
-      if(g_bDebugCM93)
-      {
-            char sfile[200];
-            strncpy(sfile, file.mb_str(), 199);
-            printf("    filename: %s\n", sfile);
-      }
+      //    Create the file name
+      wxString file = Find_CM93_Cell_File(m_prefix, cellindex, m_dval, m_scalechar, sub_char);
 
-      if(!::wxFileExists(file))
+      if(file.IsEmpty())
       {
-            //    Try with alternate case of m_scalechar
-            wxString new_scalechar = m_scalechar.Lower();
-
-            wxString file1;
-            file1.Printf(_T("%04d%04d."), jlat, jlon);
-            file1 += new_scalechar;
-
-            file1[0] = sub_char;
-
-            fileroot.Printf(_T("%04d%04d/"), ilatroot, ilonroot);
-            fileroot += new_scalechar;
-            fileroot += _T("/");
-            fileroot.Prepend(m_prefix);
-
-            file1.Prepend(fileroot);
-
+            //    This is not really an error if the sub_char is not '0'.  It just means there are no more subcells....
             if(g_bDebugCM93)
             {
-                  char sfile[200];
-                  strncpy(sfile, file1.mb_str(), 199);
-                  printf("    alternate filename: %s\n", sfile);
+                  if(sub_char == '0')
+                        printf("   Tried to load non-existent CM93 cell\n");
+                  else
+                        printf("   No sub_cells of scale(%c) found\n", sub_char);
             }
 
-            if(!::wxFileExists(file1))
-            {
-
-            //    This is not really an error if the sub_char is not '0'.  It just means there are no more subcells....
-                  if(g_bDebugCM93)
-                  {
-                        if(sub_char == '0')
-                             printf("   Tried to load non-existent CM93 cell\n");
-                        else
-                              printf("   No sub_cells of scale(%c) found\n", sub_char);
-                  }
-
-                  return 0;
-            }
-            else
-                  file = file1;                       // found the file as lowercase, substitute the name
+            return 0;
       }
 
       //    File is known to exist
@@ -4528,15 +5381,27 @@ int cm93chart::loadsubcell(int cellindex, wxChar sub_char)
             printf("   %s\n", str);
       }
 
-      //    Ingest it
-      if(!Ingest_CM93_Cell((const char *)file.mb_str(), &m_CIB))
+      //    Ingest it, from the geometry cache or the prefetched cells if possible
+      CM93CellCache *pcache = s_pcm93mgr->GetCellCache();
+      if(!pcache->LoadCell(file, &m_cell_image))
       {
+            m_cell_image.pdata = NULL;
+
             wxString msg(_T("   cm93chart  Error ingesting "));
             msg.Append(file);
             wxLogMessage(msg);
             return 0;
       }
 
+      cm93_geom_header *phdr = (cm93_geom_header *)m_cell_image.pdata;
+
+      m_CIB.transform_x_rate = phdr->transform_x_rate;
+      m_CIB.transform_y_rate = phdr->transform_y_rate;
+      m_CIB.transform_x_origin = phdr->transform_x_origin;
+      m_CIB.transform_y_origin = phdr->transform_y_origin;
+
+      m_CIB.m_nvector_records = phdr->n_edges;
+      m_CIB.m_nfeature_records = phdr->n_objects;
 
       return 1;
 }
@@ -4572,6 +5437,7 @@ cm93manager::cm93manager(void)
 {
 
     m_pcm93Dict = NULL;
+    m_pCellCache = NULL;
 
 
     m_bfoundA = false;
@@ -4588,6 +5454,14 @@ cm93manager::cm93manager(void)
 cm93manager::~cm93manager(void)
 {
       delete m_pcm93Dict;
+      delete m_pCellCache;
+}
+
+CM93CellCache *cm93manager::GetCellCache(void)
+{
+      if(!m_pCellCache)
+            m_pCellCache = new CM93CellCache;
+      return m_pCellCache;
 }
 
 bool cm93manager::Loadcm93Dictionary(wxString name)
@@ -4708,6 +5582,13 @@ cm93compchart::cm93compchart()
 
       m_pDummyBM = NULL;
 
+      m_prefetch_time = wxLongLong(0);
+      m_prefetch_lat = 0.;
+      m_prefetch_lon = 0.;
+      m_prefetch_ppm = 0.;
+      m_pan_vlat = 0.;
+      m_pan_vlon = 0.;
+
       SetSpecialOutlineCellIndex(0, 0, 0);
       m_pOffsetDialog = NULL;
 
@@ -4946,6 +5827,121 @@ void cm93compchart::SetVPParms(const ViewPort &vpt)
             if(m_pcm93chart_array[cmscale]->GetEditionDate().IsLaterThan(m_EdDate))
                   m_EdDate = m_pcm93chart_array[cmscale]->GetEditionDate();
       }
+
+      PrefetchCells(vpt, m_cmscale);
+}
+
+//    Predict the cells about to be needed, from the way the viewport is moving,
+//    and ask the cell cache to load them in the background
+void cm93compchart::PrefetchCells(const ViewPort &vpt, int cmscale)
+{
+      if((cmscale < 0) || (cmscale > 7))
+            return;
+
+      //    Track the panning velocity, smoothed over a few viewport changes
+      wxLongLong now = wxGetLocalTimeMillis();
+      double dt = (now - m_prefetch_time).ToDouble() / 1000.;
+
+      double zoom = 1.0;
+      if((m_prefetch_time != 0) && (dt > 0.) && (dt < 5.))
+      {
+            double dlon = vpt.clon - m_prefetch_lon;
+            if(dlon > 180.)
+                  dlon -= 360.;
+            else if(dlon < -180.)
+                  dlon += 360.;
+
+            m_pan_vlat = (m_pan_vlat + ((vpt.clat - m_prefetch_lat) / dt)) / 2.;
+            m_pan_vlon = (m_pan_vlon + (dlon / dt)) / 2.;
+
+            if(m_prefetch_ppm > 0.)
+                  zoom = vpt.view_scale_ppm / m_prefetch_ppm;
+      }
+      else
+      {
+            m_pan_vlat = 0.;
+            m_pan_vlon = 0.;
+      }
+
+      m_prefetch_time = now;
+      m_prefetch_lat = vpt.clat;
+      m_prefetch_lon = vpt.clon;
+      m_prefetch_ppm = vpt.view_scale_ppm;
+
+      ViewPort vptl = vpt;
+      LLBBox vp_box = vptl.GetBBox();
+      if(!vp_box.GetValid())
+            return;
+
+      ArrayOfInts keys;
+
+      //    Panning
+      if((m_pan_vlat != 0.) || (m_pan_vlon != 0.))
+      {
+            LLBBox box = vp_box;
+            wxPoint2DDouble delta(m_pan_vlon * CM93_PREFETCH_PAN_LEAD, m_pan_vlat * CM93_PREFETCH_PAN_LEAD);
+            box.Translate(delta);
+            AddPrefetchCells(keys, box, cmscale);
+      }
+
+      //    Ownship, if it is on the screen and under way
+      if((gSog > 0.5) && vp_box.PointInBox(gLon, gLat, 0.))
+      {
+            double dist = gSog * CM93_PREFETCH_SHIP_LEAD / 60.;              // NMi
+            double dlat = dist * cos(gCog * PI / 180.) / 60.;
+            double dlon = dist * sin(gCog * PI / 180.) / (60. * wxMax(cos(gLat * PI / 180.), 0.01));
+
+            LLBBox box = vp_box;
+            wxPoint2DDouble delta(dlon, dlat);
+            box.Translate(delta);
+            AddPrefetchCells(keys, box, cmscale);
+      }
+
+      //    Zooming, toward the next scale.  The box shrinks or grows in proportion.
+      if((zoom > 1.01) && (cmscale < 7))
+      {
+            LLBBox box = vp_box;
+            box.Shrink(wxMin(box.GetWidth(), box.GetHeight()) / 4.);
+            AddPrefetchCells(keys, box, cmscale + 1);
+      }
+      else if((zoom < 0.99) && (cmscale > 0))
+      {
+            LLBBox box = vp_box;
+            box.EnLarge(wxMax(box.GetWidth(), box.GetHeight()) / 2.);
+            AddPrefetchCells(keys, box, cmscale - 1);
+      }
+
+      s_pcm93mgr->GetCellCache()->RequestPrefetch(m_prefix, keys);
+
+      if(g_bDebugCM93)
+      {
+            int hits, misses, unused;
+            s_pcm93mgr->GetCellCache()->GetPrefetchStats(&hits, &misses, &unused);
+            printf(" Prefetch requested %d cells, stats: %d hits, %d misses, %d unused\n",
+                   (int)keys.GetCount(), hits, misses, unused);
+      }
+}
+
+void cm93compchart::AddPrefetchCells(ArrayOfInts &keys, LLBBox &box, int cmscale)
+{
+      wxChar scale_char;
+      int native_scale = Get_CM93_Native_Scale(cmscale, &scale_char);
+
+      ArrayOfInts cells = Get_CM93_CellIndexArray(box.GetMinY(), box.GetMinX(), box.GetMaxY(), box.GetMaxX(), native_scale);
+
+      for(unsigned int i=0 ; i < cells.GetCount() ; i++)
+      {
+            if(keys.GetCount() >= CM93_PREFETCH_MAX_REQUESTS)
+                  return;
+
+            //    Cells already in the single scale chart need no loading
+            if(m_pcm93chart_array[cmscale] && m_pcm93chart_array[cmscale]->IsCellLoaded(cells.Item(i)))
+                  continue;
+
+            int key = CM93_PREFETCH_KEY(cells.Item(i), cmscale);
+            if(wxNOT_FOUND == keys.Index(key))
+                  keys.Add(key);
+      }
 }
 
 int cm93compchart::PrepareChartScale(const ViewPort &vpt, int cmscale)
@@ -5797,6 +6793,18 @@ void cm93compchart::InvalidateCache()
       }
 }
 
+size_t cm93compchart::GetMemoryFootprint()
+{
+      //    The composite owns one cm93chart per loaded scale, each holding its own cells
+      size_t size = s57chart::GetMemoryFootprint();
+      for(int i = 0 ; i < 8 ; i++)
+      {
+            if(m_pcm93chart_array[i])
+                  size += m_pcm93chart_array[i]->GetMemoryFootprint();
+      }
+      return size;
+}
+
 void cm93compchart::ForceEdgePriorityEvaluate(void)
 {
       for(int i = 0 ; i < 8 ; i++)
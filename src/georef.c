@@ -65,6 +65,20 @@ static char *cvsid_aw() { return( cvsid_aw() ? ((char *) NULL) : cpl_cvsid ); }
 
 #endif
 
+//      Fix up CPL_THREADLOCAL if not available
+//      This code block taken directly from <cpl_port.h>
+#ifndef CPL_THREADLOCAL
+#if defined(_MSC_VER)
+#  define CPL_THREADLOCAL       __declspec(thread)
+#  define CPL_HAVE_THREADLOCAL
+#elif defined(__GNUC__) && !defined(__APPLE__)
+#  define CPL_THREADLOCAL       __thread
+#  define CPL_HAVE_THREADLOCAL
+#else
+#  define CPL_THREADLOCAL
+#endif
+#endif
+
 #ifdef __MSVC__
 #define snprintf mysnprintf
 #endif
@@ -843,19 +857,21 @@ void MolodenskyTransform (double lat, double lon, double *to_lat, double *to_lon
 #define ONEPI   3.14159265358979323846
 #define MERI_TOL 1e-9
 
-static double th1,costh1,sinth1,sina12,cosa12,M,N,c1,c2,D,P,s1;
-static int merid, signS;
+/*   Working state is per thread, so the geodesic functions may be called */
+/*   from worker threads where the compiler supports thread local storage */
+static CPL_THREADLOCAL double th1,costh1,sinth1,sina12,cosa12,M,N,c1,c2,D,P,s1;
+static CPL_THREADLOCAL int merid, signS;
 
 /*   Input/Output from geodesic functions   */
-static double al12;           /* Forward azimuth */
-static double al21;           /* Back azimuth    */
-static double geod_S;         /* Distance        */
-static double phi1, lam1, phi2, lam2;
-
-static int ellipse;
-static double geod_f;
-static double geod_a;
-static double es, onef, f, f64, f2, f4;
+static CPL_THREADLOCAL double al12;           /* Forward azimuth */
+static CPL_THREADLOCAL double al21;           /* Back azimuth    */
+static CPL_THREADLOCAL double geod_S;         /* Distance        */
+static CPL_THREADLOCAL double phi1, lam1, phi2, lam2;
+
+static CPL_THREADLOCAL int ellipse;
+static CPL_THREADLOCAL double geod_f;
+static CPL_THREADLOCAL double geod_a;
+static CPL_THREADLOCAL double es, onef, f, f64, f2, f4;
 
 double adjlon (double lon) {
       if (fabs(lon) <= SPI) return( lon );
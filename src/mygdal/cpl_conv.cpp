@@ -461,8 +461,8 @@ char *CPLFGets( char *pszBuffer, int nBufferSize, FILE * fp )
 const char *CPLReadLine( FILE * fp )
 
 {
-    static char *pszRLBuffer = NULL;
-    static int  nRLBufferSize = 0;
+    static CPL_THREADLOCAL char *pszRLBuffer = NULL;
+    static CPL_THREADLOCAL int  nRLBufferSize = 0;
     int         nReadSoFar = 0;
 
 /* -------------------------------------------------------------------- */
@@ -1214,7 +1214,7 @@ const char *CPLDecToDMS( double dfAngle, const char * pszAxis,
     int         nDegrees, nMinutes;
     double      dfSeconds, dfABSAngle, dfEpsilon;
     char        szFormat[30];
-    static char szBuffer[50];
+    static CPL_THREADLOCAL char szBuffer[50];
     const char  *pszHemisphere;
     
     dfEpsilon = (0.5/3600.0) * pow(0.1,nPrecision);
@@ -130,11 +130,14 @@ CPL_CVSID("$Id: cpl_error.cpp,v 1.1.1.1 2006/08/21 05:52:20 dsr Exp $");
  * messages cannot be longer than 2000 chars... which is quite reasonable
  * (that's 25 lines of 80 chars!!!)
  */
-static char gszCPLLastErrMsg[2000] = "";
-static int  gnCPLLastErrNo = 0;
-static CPLErr geCPLLastErrType = CE_None;
+static CPL_THREADLOCAL char gszCPLLastErrMsg[2000] = "";
+static CPL_THREADLOCAL int  gnCPLLastErrNo = 0;
+static CPL_THREADLOCAL CPLErr geCPLLastErrType = CE_None;
 
-static CPLErrorHandler gpfnCPLErrorHandler = CPLDefaultErrorHandler;
+/* The installed handler and the handler stack are both per thread.     */
+/* A new thread starts out with CPLDefaultErrorHandler(), and must       */
+/* install its own handler to report anywhere else.                      */
+static CPL_THREADLOCAL CPLErrorHandler gpfnCPLErrorHandler = CPLDefaultErrorHandler;
 
 typedef struct errHandler
 {
@@ -142,7 +145,7 @@ typedef struct errHandler
     CPLErrorHandler     pfnHandler;
 } CPLErrorHandlerNode;
 
-static CPLErrorHandlerNode * psHandlerStack = NULL;
+static CPL_THREADLOCAL CPLErrorHandlerNode * psHandlerStack = NULL;
 
 /**********************************************************************
  *                          CPLError()
@@ -545,6 +548,9 @@ void CPLLoggingErrorHandler( CPLErr eErrClass, int nError,
  * Pass NULL to come back to the default behavior.  The default behaviour
  * (CPLDefaultErrorHandler()) is to write the message to stderr. 
  *
+ * Where CPL_HAVE_THREADLOCAL is defined the handler applies only to the
+ * calling thread.
+ *
  * The msg will be a partially formatted error message not containing the
  * "ERROR %d:" portion emitted by the default handler.  Message formatting
  * is handled by CPLError() before calling the handler.  If the error
@@ -87,7 +87,7 @@ CPL_CVSID("$Id: cpl_path.cpp,v 1.1.1.1 2006/08/21 05:52:20 dsr Exp $");
 
 /* should be size of larged possible filename */
 #define CPL_PATH_BUF_SIZE 2048
-static char     szStaticResult[CPL_PATH_BUF_SIZE]; 
+static CPL_THREADLOCAL char szStaticResult[CPL_PATH_BUF_SIZE]; 
 
 #ifdef WIN32        
 #define SEP_CHAR '\\'
@@ -244,6 +244,24 @@ typedef unsigned long    GUIntBig;
 #endif
 
 
+/* -------------------------------------------------------------------- */
+/*      Thread local storage, for the few static result buffers that    */
+/*      concurrent readers (e.g. parallel SENC builds) must not share.  */
+/*      CPL_HAVE_THREADLOCAL is left undefined where the compiler has   */
+/*      no support, and callers must then stay single threaded.         */
+/* -------------------------------------------------------------------- */
+#ifndef CPL_THREADLOCAL
+#if defined(_MSC_VER)
+#  define CPL_THREADLOCAL       __declspec(thread)
+#  define CPL_HAVE_THREADLOCAL
+#elif defined(__GNUC__) && !defined(__APPLE__)
+#  define CPL_THREADLOCAL       __thread
+#  define CPL_HAVE_THREADLOCAL
+#else
+#  define CPL_THREADLOCAL
+#endif
+#endif
+
 #ifndef NULL
 #  define NULL  0
 #endif
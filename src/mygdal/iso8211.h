@@ -125,6 +125,15 @@ char *DDFFetchVariable( const char *pszString, int nMaxChars,
 #define DDF_FIELD_TERMINATOR    30
 #define DDF_UNIT_TERMINATOR     31
 
+/* -------------------------------------------------------------------- */
+/*      Modules opened for reading are memory mapped where the          */
+/*      platform allows, and records then reference the mapped bytes    */
+/*      instead of reading them into private buffers.                   */
+/* -------------------------------------------------------------------- */
+#if !defined(WIN32) && !defined(_WIN32)
+#define DDF_USE_MMAP
+#endif
+
 /************************************************************************/
 /*                           Predeclarations                            */
 /************************************************************************/
@@ -151,7 +160,8 @@ class DDFModule
                 DDFModule();
                 ~DDFModule();
                 
-    int         Open( const char * pszFilename, int bFailQuietly = FALSE );
+    int         Open( const char * pszFilename, int bFailQuietly = FALSE,
+                      int bMapFile = TRUE );
     int         Create( const char *pszFilename );
     void        Close();
 
@@ -186,12 +196,24 @@ class DDFModule
     
     // This is just for DDFRecord.
     FILE        *GetFP() { return fpDDF; }
+
+    // Mapped module access, also just for DDFRecord.
+    int         IsMapped() { return pachMap != NULL; }
+    const char  *GetMapPtr() { return pachMap + nMapOffset; }
+    long        GetMapBytesLeft() { return nMapSize - nMapOffset; }
+    long        GetMapOffset() { return nMapOffset; }
+    void        AdvanceMap( long nBytes ) { nMapOffset += nBytes; }
+    void        SetMapOffset( long nOffset ) { nMapOffset = nOffset; }
     
   private:
     FILE        *fpDDF;
     int         bReadOnly;
     long        nFirstRecordOffset;
 
+    const char  *pachMap;       // whole file, if mapped
+    long        nMapSize;
+    long        nMapOffset;     // read position within the mapping
+
     char        _interchangeLevel;
     char        _inlineCodeExtensionIndicator;
     char        _versionNumber;
@@ -515,6 +537,9 @@ class DDFRecord
   private:
 
     int         ReadHeader();
+    int         ReadMappedHeader();
+    int         BuildFieldList( int _fieldAreaStart );
+    void        DetachMappedData();
     
     DDFModule   *poModule;
 
@@ -528,6 +553,7 @@ class DDFRecord
 
     int         nDataSize;      // Whole record except leader with header
     char        *pachData;
+    int         bMappedData;    // pachData points into the module mapping
 
     int         nFieldCount;
     DDFField    *paoFields;
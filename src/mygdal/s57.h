@@ -244,6 +244,16 @@ public:
     char        GetClassCode();
     char      **GetPrimitives();
 
+    // reentrant class table methods.  These do not move the current
+    // class, so concurrent readers may share one loaded registrar.
+    // Returned lists are owned by the caller (CSLDestroy()).
+    int         FindClassIndex( int nOBJL );
+    int         GetOBJL( int iClass );
+    const char *GetDescription( int iClass );
+    const char *GetAcronym( int iClass );
+    char      **GetClassAttributeList( int iClass, const char * = NULL );
+    char      **GetClassPrimitives( int iClass );
+
     // attribute table methods.
     int         GetMaxAttrIndex() { return nAttrMax; }
     const char *GetAttrName( int i ) { return papszAttrNames[i]; }
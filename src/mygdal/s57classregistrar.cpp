@@ -553,6 +553,126 @@ char **S57ClassRegistrar::GetPrimitives()
         return NULL;
 }
 
+/************************************************************************/
+/*                           FindClassIndex()                           */
+/*                                                                      */
+/*      The reentrant methods below take a class index from here,       */
+/*      and do not touch iCurrentClass or papszTempResult.              */
+/************************************************************************/
+
+int S57ClassRegistrar::FindClassIndex( int nOBJL )
+
+{
+    for( int i = 0; i < nClasses; i++ )
+    {
+        if( pnClassesOBJL[i] == nOBJL )
+            return i;
+    }
+
+    return -1;
+}
+
+/************************************************************************/
+/*                          GetOBJL( iClass )                           */
+/************************************************************************/
+
+int S57ClassRegistrar::GetOBJL( int iClass )
+
+{
+    if( iClass >= 0 && iClass < nClasses )
+        return pnClassesOBJL[iClass];
+    else
+        return -1;
+}
+
+/************************************************************************/
+/*                       GetDescription( iClass )                       */
+/************************************************************************/
+
+const char * S57ClassRegistrar::GetDescription( int iClass )
+
+{
+    if( iClass >= 0 && iClass < nClasses
+        && CSLCount(papapszClassesTokenized[iClass]) > 1 )
+        return papapszClassesTokenized[iClass][1];
+    else
+        return NULL;
+}
+
+/************************************************************************/
+/*                         GetAcronym( iClass )                         */
+/************************************************************************/
+
+const char * S57ClassRegistrar::GetAcronym( int iClass )
+
+{
+    if( iClass >= 0 && iClass < nClasses
+        && CSLCount(papapszClassesTokenized[iClass]) > 2 )
+        return papapszClassesTokenized[iClass][2];
+    else
+        return NULL;
+}
+
+/************************************************************************/
+/*                       GetClassAttributeList()                        */
+/*                                                                      */
+/*      As GetAttributeList(), but the returned list is owned by the    */
+/*      caller.                                                         */
+/************************************************************************/
+
+char **S57ClassRegistrar::GetClassAttributeList( int iClass,
+                                                 const char * pszType )
+
+{
+    if( iClass < 0 || iClass >= nClasses )
+        return NULL;
+
+    char **papszFields = papapszClassesTokenized[iClass];
+    char **papszResult = NULL;
+
+    for( int iColumn = 3; iColumn < 6; iColumn++ )
+    {
+        if( pszType != NULL && iColumn == 3 && !EQUAL(pszType,"a") )
+            continue;
+
+        if( pszType != NULL && iColumn == 4 && !EQUAL(pszType,"b") )
+            continue;
+
+        if( pszType != NULL && iColumn == 5 && !EQUAL(pszType,"c") )
+            continue;
+
+        char    **papszTokens;
+
+        papszTokens =
+            CSLTokenizeStringComplex( papszFields[iColumn], ";",
+                                      TRUE, FALSE );
+
+        papszResult = CSLInsertStrings( papszResult, -1, papszTokens );
+
+        CSLDestroy( papszTokens );
+    }
+
+    return papszResult;
+}
+
+/************************************************************************/
+/*                         GetClassPrimitives()                         */
+/*                                                                      */
+/*      As GetPrimitives(), but the returned list is owned by the       */
+/*      caller.                                                         */
+/************************************************************************/
+
+char **S57ClassRegistrar::GetClassPrimitives( int iClass )
+
+{
+    if( iClass >= 0 && iClass < nClasses
+        && CSLCount(papapszClassesTokenized[iClass]) > 7 )
+        return CSLTokenizeStringComplex( papapszClassesTokenized[iClass][7],
+                                         ";", TRUE, FALSE );
+    else
+        return NULL;
+}
+
 /************************************************************************/
 /*                         FindAttrByAcronym()                          */
 /************************************************************************/
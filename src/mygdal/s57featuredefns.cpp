@@ -204,25 +204,28 @@ OGRFeatureDefn *S57GenerateObjectClassDefn( S57ClassRegistrar *poCR,
     OGRFeatureDefn      *poFDefn = NULL;
     char               **papszGeomPrim;
 
-    if( !poCR->SelectClass( nOBJL ) )
+    // Use the reentrant registrar methods, so the registrar is not
+    // modified and may be shared by concurrent readers.
+    int iClass = poCR->FindClassIndex( nOBJL );
+    if( iClass < 0 )
         return NULL;
     
 /* -------------------------------------------------------------------- */
 /*      Create the feature definition based on the object class         */
 /*      acronym.                                                        */
 /* -------------------------------------------------------------------- */
-    poFDefn = new OGRFeatureDefn( poCR->GetAcronym() );
-
-/* -------------------------------------------------------------------- */
-/*      Set the nOBJL Class Code as a convenience                       */
-/* -------------------------------------------------------------------- */
+    poFDefn = new OGRFeatureDefn( poCR->GetAcronym(iClass) );
+
+/* -------------------------------------------------------------------- */
+/*      Set the nOBJL Class Code as a convenience                       */
+/* -------------------------------------------------------------------- */
     poFDefn->SetOBJL(nOBJL);
 
 /* -------------------------------------------------------------------- */
 /*      Try and establish the geometry type.  If more than one          */
 /*      geometry type is allowed we just fall back to wkbUnknown.       */
 /* -------------------------------------------------------------------- */
-    papszGeomPrim = poCR->GetPrimitives();
+    papszGeomPrim = poCR->GetClassPrimitives( iClass );
     if( CSLCount(papszGeomPrim) == 0 )
     {
         poFDefn->SetGeomType( wkbNone );
@@ -233,7 +236,7 @@ OGRFeatureDefn *S57GenerateObjectClassDefn( S57ClassRegistrar *poCR,
     }
     else if( EQUAL(papszGeomPrim[0],"Point") )
     {
-        if( EQUAL(poCR->GetAcronym(),"SOUNDG") )
+        if( EQUAL(poCR->GetAcronym(iClass),"SOUNDG") )
         {
             if( nOptionFlags & S57M_SPLIT_MULTIPOINT )
                 poFDefn->SetGeomType( wkbPoint25D );
@@ -251,6 +254,8 @@ OGRFeatureDefn *S57GenerateObjectClassDefn( S57ClassRegistrar *poCR,
     {
         poFDefn->SetGeomType( wkbLineString );
     }
+
+    CSLDestroy( papszGeomPrim );
     
 /* -------------------------------------------------------------------- */
 /*      Add the standard attributes.                                    */
@@ -260,7 +265,7 @@ OGRFeatureDefn *S57GenerateObjectClassDefn( S57ClassRegistrar *poCR,
 /* -------------------------------------------------------------------- */
 /*      Add the attributes specific to this object class.               */
 /* -------------------------------------------------------------------- */
-    char        **papszAttrList = poCR->GetAttributeList();
+    char        **papszAttrList = poCR->GetClassAttributeList( iClass );
 
     for( int iAttr = 0;
          papszAttrList != NULL && papszAttrList[iAttr] != NULL;
@@ -272,8 +277,8 @@ OGRFeatureDefn *S57GenerateObjectClassDefn( S57ClassRegistrar *poCR,
         {
             CPLDebug( "S57", "Can't find attribute %s from class %s:%s.\n",
                       papszAttrList[iAttr],
-                      poCR->GetAcronym(),
-                      poCR->GetDescription() );
+                      poCR->GetAcronym(iClass),
+                      poCR->GetDescription(iClass) );
             continue;
         }
 
@@ -303,11 +308,13 @@ OGRFeatureDefn *S57GenerateObjectClassDefn( S57ClassRegistrar *poCR,
         poFDefn->AddFieldDefn( &oField );
     }
 
+    CSLDestroy( papszAttrList );
+
 
 /* -------------------------------------------------------------------- */
 /*      Do we need to add DEPTH attributes to soundings?                */
 /* -------------------------------------------------------------------- */
-    if( EQUAL(poCR->GetAcronym(),"SOUNDG") 
+    if( EQUAL(poCR->GetAcronym(iClass),"SOUNDG") 
         && (nOptionFlags & S57M_ADD_SOUNDG_DEPTH) )
     {
         OGRFieldDefn    oField( "DEPTH", OFTReal );
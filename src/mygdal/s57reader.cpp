@@ -1871,8 +1871,9 @@ OGRFeatureDefn * S57Reader::FindFDefn( DDFRecord * poRecord )
     if( poRegistrar != NULL )
     {
         int     nOBJL = poRecord->GetIntSubfield( "FRID", 0, "OBJL", 0 );
+        int     iClass = poRegistrar->FindClassIndex( nOBJL );
 
-        if( !poRegistrar->SelectClass( nOBJL ) )
+        if( iClass < 0 )
         {
             for( int i = 0; i < nFDefnCount; i++ )
             {
@@ -1885,7 +1886,7 @@ OGRFeatureDefn * S57Reader::FindFDefn( DDFRecord * poRecord )
         for( int i = 0; i < nFDefnCount; i++ )
         {
             if( EQUAL(papoFDefnList[i]->GetName(),
-                      poRegistrar->GetAcronym()) )
+                      poRegistrar->GetAcronym(iClass)) )
                 return papoFDefnList[i];
         }
 
@@ -88,6 +88,7 @@
 #include "dychart.h"
 
 #include "mygeom.h"
+#include "sencparser.h"
 #include "georef.h"
 
 #include "triangulate.h"
@@ -190,24 +191,28 @@ typedef void GLvoid;
 //      Module Internal Prototypes
 
 
+//      The tesselator callback state is per thread, so that SENC files
+//      may be built concurrently (see SENCBuildPool)
 #ifdef USE_GLU_TESS
-static int            s_nvcall;
-static int            s_nvmax;
-static double         *s_pwork_buf;
-static int            s_buf_len;
-static int            s_buf_idx;
-static unsigned int   s_gltri_type;
-TriPrim               *s_pTPG_Head;
-TriPrim               *s_pTPG_Last;
-static GLUtesselator  *GLUtessobj;
-static double         s_ref_lat;
-static double         s_ref_lon;
-static bool           s_bSENC_SM;
+static CPL_THREADLOCAL int            s_nvcall;
+static CPL_THREADLOCAL int            s_nvmax;
+static CPL_THREADLOCAL double         *s_pwork_buf;
+static CPL_THREADLOCAL int            s_buf_len;
+static CPL_THREADLOCAL int            s_buf_idx;
+static CPL_THREADLOCAL unsigned int   s_gltri_type;
+static CPL_THREADLOCAL TriPrim        *s_pTPG_Head;
+static CPL_THREADLOCAL TriPrim        *s_pTPG_Last;
+static CPL_THREADLOCAL GLUtesselator  *GLUtessobj;
+static CPL_THREADLOCAL double         s_ref_lat;
+static CPL_THREADLOCAL double         s_ref_lon;
+static CPL_THREADLOCAL bool           s_bSENC_SM;
 #endif
 
-static int            tess_orient;
-static wxMemoryOutputStream *ostream1;
-static wxMemoryOutputStream *ostream2;
+static CPL_THREADLOCAL int            tess_orient;
+
+//      The internal trapezator (tri.c) works in global tables,
+//      so calls into it are serialized
+static wxCriticalSection s_TriCritSect;
 
 
 
@@ -324,129 +329,69 @@ PolyTessGeo::PolyTessGeo(OGRPolygon *poly, bool bSENC_SM, double ref_lat, double
 
 
 
-//      Build PolyGeo Object from SENC file record
-PolyTessGeo::PolyTessGeo(unsigned char *polybuf, int nrecl, int index)
+//      Build PolyGeo Object from binary SENC file record block,
+//      checked by SENCParseTess()
+PolyTessGeo::PolyTessGeo(SENCTess *ptess, int index)
 {
-#define POLY_LINE_HDR_MAX 1000
-//      Todo Add a try/catch set here, in case SENC file is corrupted??
-
-    char hdr_buf[POLY_LINE_HDR_MAX];
-    int twkb_len;
-
-    m_buf_head = (char *) polybuf;                      // buffer beginning
-    m_buf_ptr = m_buf_head;
-    m_nrecl = nrecl;
+    ErrorCode = 0;
+    m_ppg_head = NULL;
+    m_nvertex_max = 0;
 
+    SENCPolyTessHeader *phdr = &ptess->hdr;
 
-    my_bufgets( hdr_buf, POLY_LINE_HDR_MAX );
-    //  Read the s57obj extents as lat/lon
-    sscanf(hdr_buf, "  POLYTESSGEOPROP %lf %lf %lf %lf",
-           &xmin, &ymin, &xmax, &ymax);
+    //  The s57obj extents as lat/lon
+    xmin = phdr->xmin;
+    ymin = phdr->ymin;
+    xmax = phdr->xmax;
+    ymax = phdr->ymax;
+    m_ref_lat = phdr->ref_lat;
+    m_ref_lon = phdr->ref_lon;
 
+    ncnt = phdr->n_contours;
+    nwkb = phdr->n_geom_bytes;
 
     PolyTriGroup *ppg = new PolyTriGroup;
-    int nctr;
-    my_bufgets( hdr_buf, POLY_LINE_HDR_MAX );
-    sscanf(hdr_buf, "Contours/nWKB %d %d", &nctr, &twkb_len);
-    ppg->nContours = nctr;
-    ppg->pn_vertex = (int *)malloc(nctr * sizeof(int));
-    int *pctr = ppg->pn_vertex;
-
-    char *buf = (char *)malloc(twkb_len + 2);        // allocate a buffer guaranteed big enough
-
-    my_bufgets( buf, twkb_len + 2 );                       // contour nVert, plus geometry
-
-    wxString ivc_str(buf + 10,  wxConvUTF8);
-    wxStringTokenizer tkc(ivc_str, wxT(" ,\n"));
-    long icv = 0;
-
-    while ( tkc.HasMoreTokens() )
-    {
-        wxString token = tkc.GetNextToken();
-        if(token.ToLong(&icv))
-        {
-            if(icv)
-            {
-                *pctr = icv;
-                pctr++;
-            }
-        }
-    }
-
+    ppg->nContours = ncnt;
+    ppg->pn_vertex = (int *)malloc(ncnt * sizeof(int));
+    memcpy(ppg->pn_vertex, ptess->pcontours, ncnt * sizeof(int));
 
     //  Read Raw Geometry
-
-    float *ppolygeo = (float *)malloc(twkb_len + 1);    // allow for crlf
-    memmove(ppolygeo,  m_buf_ptr, twkb_len + 1);
-    m_buf_ptr += twkb_len + 1;
-    ppg->pgroup_geom = ppolygeo;
-
-
+    ppg->pgroup_geom = (float *)malloc(nwkb);
+    memcpy(ppg->pgroup_geom, ptess->pgeom, nwkb);
 
     TriPrim **p_prev_triprim = &(ppg->tri_prim_head);
 
-    //  Read the PTG_Triangle Geometry in a loop
-    unsigned int tri_type;
-    int nvert;
+    //  Read the PTG_Triangle Geometry
+    unsigned char *ptp_buf = ptess->ptriprims;
     int nvert_max = 0;
-    bool not_finished = true;
-    while(not_finished)
+    for(int itp = 0 ; itp < phdr->n_triprims ; itp++)
     {
-        if((m_buf_ptr - m_buf_head) != m_nrecl)
-        {
-            int *pi = (int *)m_buf_ptr;
-            tri_type = *pi++;
-            nvert = *pi;
-            m_buf_ptr += 2 * sizeof(int);
-
-            //    Here is the usual stop condition, which results from
-            //    interpreting the string "POLYEND" as an int
-            if(tri_type == 0x594c4f50)
-            {
-                  not_finished = false;
-                  break;
-            }
+        int type, nvert;
+        double bb[4];                                   // triangle primitive bounding box as lat/lon
+        unsigned char *pvert = SENCNextTriPrim(&ptp_buf, &type, &nvert, bb);
 
-            TriPrim *tp = new TriPrim;
-            *p_prev_triprim = tp;                               // make the link
-            p_prev_triprim = &(tp->p_next);
-            tp->p_next = NULL;
+        TriPrim *tp = new TriPrim;
+        *p_prev_triprim = tp;                               // make the link
+        p_prev_triprim = &(tp->p_next);
+        tp->p_next = NULL;
 
-            tp->type = tri_type;
-            tp->nVert = nvert;
+        tp->type = type;
+        tp->nVert = nvert;
 
-            if(nvert > nvert_max )                          // Keep a running tab of largest vertex count
-                  nvert_max = nvert;
-
-            int byte_size = nvert * 2 * sizeof(double);
-
-            tp->p_vertex = (double *)malloc(byte_size);
-            memmove(tp->p_vertex, m_buf_ptr, byte_size);
-            m_buf_ptr += byte_size;
-
-            //  Read the triangle primitive bounding box as lat/lon
-            tp->p_bbox = new wxBoundingBox;
-            double *pbb = (double *)m_buf_ptr;
-            double minx = *pbb++;
-            double maxx = *pbb++;
-            double miny = *pbb++;
-            double maxy = *pbb++;
-            tp->p_bbox->SetMin(minx, miny);
-            tp->p_bbox->SetMax(maxx, maxy);
-
-            m_buf_ptr += 4 * sizeof(double);
-
-        }
-        else                                    // got end of poly
-            not_finished = false;
-    }                   // while
+        if(nvert > nvert_max )                          // Keep a running tab of largest vertex count
+              nvert_max = nvert;
 
+        int byte_size = nvert * 2 * sizeof(double);
+        tp->p_vertex = (double *)malloc(byte_size);
+        memcpy(tp->p_vertex, pvert, byte_size);
 
+        tp->p_bbox = new wxBoundingBox;
+        tp->p_bbox->SetMin(bb[0], bb[2]);
+        tp->p_bbox->SetMax(bb[1], bb[3]);
+    }
 
     m_ppg_head = ppg;
     m_nvertex_max = nvert_max;
-
-    free(buf);
 }
 
 
@@ -601,7 +546,9 @@ int PolyTessGeo::PolyTessGeoTri(OGRPolygon *poly, bool bSENC_SM, double ref_lat,
         }
     }
 
+    s_TriCritSect.Enter();
     polyout *polys = triangulate_polygon(ncnt, cntr, (double (*)[2])geoPt);
+    s_TriCritSect.Leave();
 
 
 //  Check the triangles
@@ -840,242 +787,83 @@ int PolyTessGeo::PolyTessGeoTri(OGRPolygon *poly, bool bSENC_SM, double ref_lat,
 
 int PolyTessGeo::Write_PolyTriGroup( FILE *ofs)
 {
-    wxString    sout;
-    wxString    sout1;
-    wxString    stemp;
-
-    PolyTriGroup *pPTG = m_ppg_head;
-
-
-//  Begin creating the output record
-//      Use a wxMemoryStream for temporary record output.
-//      When all finished, we'll touch up a few items before
-//      committing to disk.
-
-
-    ostream1 = new wxMemoryOutputStream(NULL, 0);                      // auto buffer creation
-    ostream2 = new wxMemoryOutputStream(NULL, 0);                      // auto buffer creation
-
-//  Create initial known part of the output record
-
-
-    stemp.sprintf( _T("  POLYTESSGEOPROP %f %f %f %f\n"),
-                   xmin, ymin, xmax, ymax);            // PolyTessGeo Properties
-    sout += stemp;
-
-//  Transcribe the true number of  contours, and the raw geometry wkb size
-    stemp.sprintf( _T("Contours/nWKB %d %d\n"),  ncnt, nwkb);
-    sout += stemp;
-
-
-//  Transcribe the contour counts
-    stemp.sprintf(_T("Contour nV"));
-    sout += stemp;
-    for(int i=0 ; i<ncnt ; i++)
-    {
-        stemp.sprintf( _T(" %d"), pPTG->pn_vertex[i]);
-        sout += stemp;
-    }
-    stemp.sprintf( _T("\n"));
-    sout += stemp;
-    ostream1->Write(sout.mb_str(), sout.Len());
-
-//  Transcribe the raw geometry buffer
-    ostream1->Write(pPTG->pgroup_geom,nwkb);
-    stemp.sprintf( _T("\n"));
-    ostream1->Write(stemp.mb_str(), stemp.Len());
-
-
-//  Transcribe the TriPrim chain
-
-    TriPrim *pTP = pPTG->tri_prim_head;         // head of linked list of TriPrims
-
-
-    while(pTP)
-    {
-        ostream2->Write(&pTP->type, sizeof(int));
-        ostream2->Write(&pTP->nVert, sizeof(int));
-
-        ostream2->Write( pTP->p_vertex, pTP->nVert * 2 * sizeof(double));
-
-        //  Write out the object bounding box as lat/lon
-        double minx = pTP->p_bbox->GetMinX();
-        double maxx = pTP->p_bbox->GetMaxX();
-        double miny = pTP->p_bbox->GetMinY();
-        double maxy = pTP->p_bbox->GetMaxY();
-        ostream2->Write(&minx, sizeof(double));
-        ostream2->Write(&maxx, sizeof(double));
-        ostream2->Write(&miny, sizeof(double));
-        ostream2->Write(&maxy, sizeof(double));
-
-
-        pTP = pTP->p_next;
-    }
-
-
-    stemp.sprintf( _T("POLYEND\n"));
-    ostream2->Write(stemp.mb_str(), stemp.Len());
-
-    int nrecl = ostream1->GetSize() + ostream2->GetSize();
-    stemp.sprintf( _T("  POLYTESSGEO  %08d %g %g\n"), nrecl, m_ref_lat, m_ref_lon);
-
-    fwrite(stemp.mb_str(), 1, stemp.Len(), ofs);                 // Header, + record length
-
-    char *tb = (char *)malloc(ostream1->GetSize());
-    ostream1->CopyTo(tb, ostream1->GetSize());
-    fwrite(tb, 1, ostream1->GetSize(), ofs);
+//  Build the block in memory, then commit to disk
+    wxMemoryOutputStream ostream;
+    Write_PolyTriGroup(ostream);
+
+    int nrecl = ostream.GetSize();
+    char *tb = (char *)malloc(nrecl);
+    ostream.CopyTo(tb, nrecl);
+    fwrite(tb, 1, nrecl, ofs);
     free(tb);
 
-    tb = (char *)malloc(ostream2->GetSize());
-    ostream2->CopyTo(tb, ostream2->GetSize());
-    fwrite(tb, 1, ostream2->GetSize(), ofs);
-    free(tb);
-
-    delete ostream1;
-    delete ostream2;
-
     return 0;
 }
 
 int PolyTessGeo::Write_PolyTriGroup( wxOutputStream &out_stream)
 {
-      wxString    sout;
-      wxString    sout1;
-      wxString    stemp;
-
       PolyTriGroup *pPTG = m_ppg_head;
 
-
-//  Begin creating the output record
-//      Use a wxMemoryStream for temporary record output.
-//      When all finished, we'll touch up a few items before
-//      committing to disk.
-
-
-      ostream1 = new wxMemoryOutputStream(NULL, 0);                      // auto buffer creation
-      ostream2 = new wxMemoryOutputStream(NULL, 0);                      // auto buffer creation
-
-//  Create initial known part of the output record
-
-
-      stemp.sprintf( _T("  POLYTESSGEOPROP %f %f %f %f\n"),
-                     xmin, ymin, xmax, ymax);            // PolyTessGeo Properties
-      sout += stemp;
-
-//  Transcribe the true number of  contours, and the raw geometry wkb size
-      stemp.sprintf( _T("Contours/nWKB %d %d\n"),  ncnt, nwkb);
-      sout += stemp;
-
-
-//  Transcribe the contour counts
-      stemp.sprintf(_T("Contour nV"));
-      sout += stemp;
-      for(int i=0 ; i<ncnt ; i++)
+//  Count the TriPrim chain
+      int n_triprims = 0;
+      TriPrim *pTP = pPTG->tri_prim_head;         // head of linked list of TriPrims
+      while(pTP)
       {
-            stemp.sprintf( _T(" %d"), pPTG->pn_vertex[i]);
-            sout += stemp;
+            n_triprims++;
+            pTP = pTP->p_next;
       }
-      stemp.sprintf( _T("\n"));
-      sout += stemp;
-      ostream1->Write(sout.mb_str(), sout.Len());
-
-//  Transcribe the raw geometry buffer
-      ostream1->Write(pPTG->pgroup_geom,nwkb);
-      stemp.sprintf( _T("\n"));
-      ostream1->Write(stemp.mb_str(), stemp.Len());
 
+//  Fixed header, PolyTessGeo Properties
+      SENCPolyTessHeader hdr;
+      memset(&hdr, 0, sizeof(SENCPolyTessHeader));
+      hdr.xmin = xmin;
+      hdr.ymin = ymin;
+      hdr.xmax = xmax;
+      hdr.ymax = ymax;
+      hdr.ref_lat = m_ref_lat;
+      hdr.ref_lon = m_ref_lon;
+      hdr.n_contours = ncnt;
+      hdr.n_geom_bytes = nwkb;
+      hdr.n_triprims = n_triprims;
+      out_stream.Write(&hdr, sizeof(SENCPolyTessHeader));
+
+//  Transcribe the contour counts, and the raw geometry buffer
+//  Each is padded to 8 bytes, keeping the TriPrim doubles aligned
+      char zero[8] = {0};
+
+      int contour_bytes = ncnt * sizeof(int);
+      out_stream.Write(pPTG->pn_vertex, contour_bytes);
+      out_stream.Write(zero, ((contour_bytes + 7) & ~7) - contour_bytes);
+
+      out_stream.Write(pPTG->pgroup_geom, nwkb);
+      out_stream.Write(zero, ((nwkb + 7) & ~7) - nwkb);
 
 //  Transcribe the TriPrim chain
-
-      TriPrim *pTP = pPTG->tri_prim_head;         // head of linked list of TriPrims
-
-
+      pTP = pPTG->tri_prim_head;
       while(pTP)
       {
-            ostream2->Write(&pTP->type, sizeof(int));
-            ostream2->Write(&pTP->nVert, sizeof(int));
+            out_stream.Write(&pTP->type, sizeof(int));
+            out_stream.Write(&pTP->nVert, sizeof(int));
 
-            ostream2->Write( pTP->p_vertex, pTP->nVert * 2 * sizeof(double));
+            out_stream.Write( pTP->p_vertex, pTP->nVert * 2 * sizeof(double));
 
         //  Write out the object bounding box as lat/lon
-            double minx = pTP->p_bbox->GetMinX();
-            double maxx = pTP->p_bbox->GetMaxX();
-            double miny = pTP->p_bbox->GetMinY();
-            double maxy = pTP->p_bbox->GetMaxY();
-            ostream2->Write(&minx, sizeof(double));
-            ostream2->Write(&maxx, sizeof(double));
-            ostream2->Write(&miny, sizeof(double));
-            ostream2->Write(&maxy, sizeof(double));
-
+            double bb[4];
+            bb[0] = pTP->p_bbox->GetMinX();
+            bb[1] = pTP->p_bbox->GetMaxX();
+            bb[2] = pTP->p_bbox->GetMinY();
+            bb[3] = pTP->p_bbox->GetMaxY();
+            out_stream.Write(bb, sizeof(bb));
 
             pTP = pTP->p_next;
       }
 
-
-      stemp.sprintf( _T("POLYEND\n"));
-      ostream2->Write(stemp.mb_str(), stemp.Len());
-
-      int nrecl = ostream1->GetSize() + ostream2->GetSize();
-      stemp.sprintf( _T("  POLYTESSGEO  %08d %g %g\n"), nrecl, m_ref_lat, m_ref_lon);
-
-      out_stream.Write(stemp.mb_str(), stemp.Len());                 // Header, + record length
-
-      char *tb = (char *)malloc(ostream1->GetSize());
-      ostream1->CopyTo(tb, ostream1->GetSize());
-
-      out_stream.Write(tb, ostream1->GetSize());
-      free(tb);
-
-      tb = (char *)malloc(ostream2->GetSize());
-      ostream2->CopyTo(tb, ostream2->GetSize());
-      out_stream.Write(tb, ostream2->GetSize());
-
-      free(tb);
-
-
-      delete ostream1;
-      delete ostream2;
-
       return 0;
 }
 
 
 
 
-int PolyTessGeo::my_bufgets( char *buf, int buf_len_max )
-{
-    char        chNext;
-    int         nLineLen = 0;
-    char        *lbuf;
-
-    lbuf = buf;
-
-
-    while( (nLineLen < buf_len_max) &&((m_buf_ptr - m_buf_head) < m_nrecl) )
-    {
-        chNext = *m_buf_ptr++;
-
-        /* each CR/LF (or LF/CR) as if just "CR" */
-        if( chNext == 10 || chNext == 13 )
-        {
-            chNext = '\n';
-        }
-
-        *lbuf = chNext; lbuf++, nLineLen++;
-
-        if( chNext == '\n' )
-        {
-            *lbuf = '\0';
-            return nLineLen;
-        }
-    }
-
-    *(lbuf) = '\0';
-    return nLineLen;
-}
-
-
-
 PolyTessGeo::~PolyTessGeo()
 {
 
@@ -1698,7 +1486,9 @@ void PolyTessGeoTrap::BuildTess()
       isegment_t *iseg;
       int n_traps;
 
+      s_TriCritSect.Enter();
       int trap_err = int_trapezate_polygon(m_ptg_head->nContours, m_ptg_head->pn_vertex, (double (*)[2])m_ptg_head->ptrapgroup_geom, &itr, &iseg, &n_traps);
+      s_TriCritSect.Leave();
 
      m_ptg_head->m_trap_error = trap_err;
 
@@ -84,6 +84,12 @@
 #include "iso8211.h"
 #include "cpl_conv.h"
 
+#ifdef DDF_USE_MMAP
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
 CPL_CVSID("$Id: ddfmodule.cpp,v 1.1.1.1 2006/08/21 05:52:20 dsr Exp $");
 
 /************************************************************************/
@@ -107,6 +113,10 @@ DDFModule::DDFModule()
     fpDDF = NULL;
     bReadOnly = TRUE;
 
+    pachMap = NULL;
+    nMapSize = 0;
+    nMapOffset = 0;
+
     _interchangeLevel = '\0';
     _inlineCodeExtensionIndicator = '\0';
     _versionNumber = '\0';
@@ -175,6 +185,17 @@ void DDFModule::Close()
     while( nCloneCount > 0 )
         delete papoClones[0];
 
+/* -------------------------------------------------------------------- */
+/*      Release the mapping, now that no record can refer to it.        */
+/* -------------------------------------------------------------------- */
+#ifdef DDF_USE_MMAP
+    if( pachMap != NULL )
+        munmap( (void *) pachMap, nMapSize );
+#endif
+    pachMap = NULL;
+    nMapSize = 0;
+    nMapOffset = 0;
+
     nMaxCloneCount = 0;
     CPLFree( papoClones );
     papoClones = NULL;
@@ -207,12 +228,17 @@ void DDFModule::Close()
  * @param pszFilename   The name of the file to open.
  * @param bFailQuietly If FALSE a CPL Error is issued for non-8211 files, 
  * otherwise quietly return NULL.
+ * @param bMapFile If TRUE, and the platform supports it, the file is memory
+ * mapped and the records read refer to the mapped data rather than to
+ * private copies.  Records copied with DDFRecord::Copy() then also refer
+ * to the mapping, and must not outlive the module.
  *
  * @return FALSE if the open fails or TRUE if it succeeds.  Errors messages
  * are issued internally with CPLError().
  */
 
-int DDFModule::Open( const char * pszFilename, int bFailQuietly )
+int DDFModule::Open( const char * pszFilename, int bFailQuietly,
+                     int bMapFile )
 
 {
     static const size_t nLeaderSize = 24;
@@ -387,6 +413,31 @@ int DDFModule::Open( const char * pszFilename, int bFailQuietly )
 /*      data record.                                                    */
 /* -------------------------------------------------------------------- */
     nFirstRecordOffset = VSIFTell( fpDDF );
+
+/* -------------------------------------------------------------------- */
+/*      Map the file, so that records can be read without copying.      */
+/*      If this fails we just carry on reading through the FILE.        */
+/* -------------------------------------------------------------------- */
+#ifdef DDF_USE_MMAP
+    struct stat sStat;
+
+    if( bMapFile && fstat( fileno( fpDDF ), &sStat ) == 0
+        && sStat.st_size > nFirstRecordOffset )
+    {
+        void *pMap = mmap( NULL, sStat.st_size, PROT_READ, MAP_PRIVATE,
+                           fileno( fpDDF ), 0 );
+        if( pMap != MAP_FAILED )
+        {
+            madvise( pMap, sStat.st_size, MADV_SEQUENTIAL );
+
+            pachMap = (const char *) pMap;
+            nMapSize = sStat.st_size;
+            nMapOffset = nFirstRecordOffset;
+        }
+    }
+#else
+    (void) bMapFile;
+#endif
     
     return TRUE;
 }
@@ -754,6 +805,9 @@ void DDFModule::Rewind( long nOffset )
     
     VSIFSeek( fpDDF, nOffset, SEEK_SET );
 
+    if( pachMap != NULL )
+        nMapOffset = nOffset;
+
     if( nOffset == nFirstRecordOffset && poRecord != NULL )
         poRecord->Clear();
         
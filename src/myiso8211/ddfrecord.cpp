@@ -144,6 +144,7 @@ DDFRecord::DDFRecord( DDFModule * poModuleIn )
 
     nDataSize = 0;
     pachData = NULL;
+    bMappedData = FALSE;
 
     nFieldCount = 0;
     paoFields = NULL;
@@ -219,7 +220,10 @@ int DDFRecord::Read()
 /* -------------------------------------------------------------------- */
     if( !nReuseHeader )
     {
-        return( ReadHeader() );
+        if( poModule->IsMapped() )
+            return( ReadMappedHeader() );
+        else
+            return( ReadHeader() );
     }
 
 /* -------------------------------------------------------------------- */
@@ -229,6 +233,27 @@ int DDFRecord::Read()
 /* -------------------------------------------------------------------- */
     size_t      nReadBytes;
 
+    if( poModule->IsMapped() )
+    {
+        long    nBytesLeft = poModule->GetMapBytesLeft();
+
+        if( nBytesLeft == 0 )
+            return FALSE;
+        else if( nBytesLeft < nDataSize - nFieldOffset )
+        {
+            CPLError( CE_Failure, CPLE_FileIO,
+                      "Data record is short on DDF file.\n" );
+            return FALSE;
+        }
+
+        DetachMappedData();
+        memcpy( pachData + nFieldOffset, poModule->GetMapPtr(),
+                nDataSize - nFieldOffset );
+        poModule->AdvanceMap( nDataSize - nFieldOffset );
+
+        return TRUE;
+    }
+
     nReadBytes = VSIFRead( pachData + nFieldOffset, 1,
                            nDataSize - nFieldOffset,
                            poModule->GetFP() );
@@ -325,14 +350,45 @@ void DDFRecord::Clear()
     paoFields = NULL;
     nFieldCount = 0;
 
-    if( pachData != NULL )
+    if( pachData != NULL && !bMappedData )
         CPLFree( pachData );
 
     pachData = NULL;
+    bMappedData = FALSE;
     nDataSize = 0;
     nReuseHeader = FALSE;
 }
 
+/************************************************************************/
+/*                          DetachMappedData()                          */
+/*                                                                      */
+/*      Give a record that refers to the module mapping its own copy    */
+/*      of the data, before anything modifies it.                       */
+/************************************************************************/
+
+void DDFRecord::DetachMappedData()
+
+{
+    if( !bMappedData )
+        return;
+
+    char *pachNewData = (char *) CPLMalloc(nDataSize);
+    memcpy( pachNewData, pachData, nDataSize );
+
+    for( int i = 0; i < nFieldCount; i++ )
+    {
+        int     nOffset;
+
+        nOffset = (paoFields[i].GetData() - pachData);
+        paoFields[i].Initialize( paoFields[i].GetFieldDefn(),
+                                 pachNewData + nOffset,
+                                 paoFields[i].GetDataSize() );
+    }
+
+    pachData = pachNewData;
+    bMappedData = FALSE;
+}
+
 /************************************************************************/
 /*                             ReadHeader()                             */
 /*                                                                      */
@@ -451,67 +507,7 @@ int DDFRecord::ReadHeader()
                       "Didn't find field terminator, read one more byte." );
         }
 
-/* -------------------------------------------------------------------- */
-/*      Loop over the directory entries, making a pass counting them.   */
-/* -------------------------------------------------------------------- */
-        int         i;
-        int         nFieldEntryWidth;
-      
-        nFieldEntryWidth = _sizeFieldLength + _sizeFieldPos + _sizeFieldTag;
-        nFieldCount = 0;
-        for( i = 0; i < nDataSize; i += nFieldEntryWidth )
-        {
-            if( pachData[i] == DDF_FIELD_TERMINATOR )
-                break;
-          
-            nFieldCount++;
-        }
-    
-/* -------------------------------------------------------------------- */
-/*      Allocate, and read field definitions.                           */
-/* -------------------------------------------------------------------- */
-        paoFields = new DDFField[nFieldCount];
-    
-        for( i = 0; i < nFieldCount; i++ )
-        {
-            char    szTag[128];
-            int     nEntryOffset = i*nFieldEntryWidth;
-            int     nFieldLength, nFieldPos;
-          
-/* -------------------------------------------------------------------- */
-/*      Read the position information and tag.                          */
-/* -------------------------------------------------------------------- */
-            strncpy( szTag, pachData+nEntryOffset, _sizeFieldTag );
-            szTag[_sizeFieldTag] = '\0';
-          
-            nEntryOffset += _sizeFieldTag;
-            nFieldLength = DDFScanInt( pachData+nEntryOffset, _sizeFieldLength );
-          
-            nEntryOffset += _sizeFieldLength;
-            nFieldPos = DDFScanInt( pachData+nEntryOffset, _sizeFieldPos );
-          
-/* -------------------------------------------------------------------- */
-/*      Find the corresponding field in the module directory.           */
-/* -------------------------------------------------------------------- */
-            DDFFieldDefn    *poFieldDefn = poModule->FindFieldDefn( szTag );
-          
-            if( poFieldDefn == NULL )
-            {
-                CPLError( CE_Failure, CPLE_AppDefined,
-                          "Undefined field `%s' encountered in data record.",
-                          szTag );
-                return FALSE;
-            }
-
-/* -------------------------------------------------------------------- */
-/*      Assign info the DDFField.                                       */
-/* -------------------------------------------------------------------- */
-            paoFields[i].Initialize( poFieldDefn, 
-                                     pachData + _fieldAreaStart + nFieldPos - nLeaderSize,
-                                     nFieldLength );
-        }
-      
-        return TRUE;
+        return BuildFieldList( _fieldAreaStart );
     }
 /* ==================================================================== */
 /*      Handle the exceptional case where the record length is          */
@@ -651,6 +647,209 @@ int DDFRecord::ReadHeader()
     }
 }
 
+/************************************************************************/
+/*                           BuildFieldList()                           */
+/*                                                                      */
+/*      Build the field list from the directory at the start of         */
+/*      pachData.                                                       */
+/************************************************************************/
+
+int DDFRecord::BuildFieldList( int _fieldAreaStart )
+
+{
+/* -------------------------------------------------------------------- */
+/*      Loop over the directory entries, making a pass counting them.   */
+/* -------------------------------------------------------------------- */
+    int         i;
+    int         nFieldEntryWidth;
+  
+    nFieldEntryWidth = _sizeFieldLength + _sizeFieldPos + _sizeFieldTag;
+    nFieldCount = 0;
+    for( i = 0; i < nDataSize; i += nFieldEntryWidth )
+    {
+        if( pachData[i] == DDF_FIELD_TERMINATOR )
+            break;
+      
+        nFieldCount++;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Allocate, and read field definitions.                           */
+/* -------------------------------------------------------------------- */
+    paoFields = new DDFField[nFieldCount];
+
+    for( i = 0; i < nFieldCount; i++ )
+    {
+        char    szTag[128];
+        int     nEntryOffset = i*nFieldEntryWidth;
+        int     nFieldLength, nFieldPos;
+      
+/* -------------------------------------------------------------------- */
+/*      Read the position information and tag.                          */
+/* -------------------------------------------------------------------- */
+        strncpy( szTag, pachData+nEntryOffset, _sizeFieldTag );
+        szTag[_sizeFieldTag] = '\0';
+      
+        nEntryOffset += _sizeFieldTag;
+        nFieldLength = DDFScanInt( pachData+nEntryOffset, _sizeFieldLength );
+      
+        nEntryOffset += _sizeFieldLength;
+        nFieldPos = DDFScanInt( pachData+nEntryOffset, _sizeFieldPos );
+      
+/* -------------------------------------------------------------------- */
+/*      Find the corresponding field in the module directory.           */
+/* -------------------------------------------------------------------- */
+        DDFFieldDefn    *poFieldDefn = poModule->FindFieldDefn( szTag );
+      
+        if( poFieldDefn == NULL )
+        {
+            CPLError( CE_Failure, CPLE_AppDefined,
+                      "Undefined field `%s' encountered in data record.",
+                      szTag );
+            return FALSE;
+        }
+
+/* -------------------------------------------------------------------- */
+/*      Assign info the DDFField.                                       */
+/* -------------------------------------------------------------------- */
+        paoFields[i].Initialize( poFieldDefn, 
+                                 pachData + _fieldAreaStart + nFieldPos - nLeaderSize,
+                                 nFieldLength );
+    }
+  
+    return TRUE;
+}
+
+/************************************************************************/
+/*                          ReadMappedHeader()                          */
+/*                                                                      */
+/*      ReadHeader() for a memory mapped module.  The record data is    */
+/*      left in the mapping, and the fields refer to it there.          */
+/************************************************************************/
+
+int DDFRecord::ReadMappedHeader()
+
+{
+/* -------------------------------------------------------------------- */
+/*      Clear any existing information.                                 */
+/* -------------------------------------------------------------------- */
+    Clear();
+    
+/* -------------------------------------------------------------------- */
+/*      Locate the 24 byte leader.                                      */
+/* -------------------------------------------------------------------- */
+    long        nBytesLeft = poModule->GetMapBytesLeft();
+    const char  *achLeader = poModule->GetMapPtr();
+
+    if( nBytesLeft == 0 )
+    {
+        return FALSE;
+    }
+    else if( nBytesLeft < (long) nLeaderSize )
+    {
+        CPLError( CE_Failure, CPLE_FileIO,
+                  "Leader is short on DDF file." );
+        
+        return FALSE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Extract information from leader.                                */
+/* -------------------------------------------------------------------- */
+    int         _recLength, _fieldAreaStart;
+    char        _leaderIden;
+    
+    _recLength                    = DDFScanInt( achLeader+0, 5 );
+    _leaderIden                   = achLeader[6];
+    _fieldAreaStart               = DDFScanInt(achLeader+12,5);
+    
+/* -------------------------------------------------------------------- */
+/*      Records of zero length are rare enough to leave to the          */
+/*      stdio reader.                                                   */
+/* -------------------------------------------------------------------- */
+    if( _recLength == 0 )
+    {
+        FILE    *fp = poModule->GetFP();
+        int     bSuccess;
+
+        VSIFSeek( fp, poModule->GetMapOffset(), SEEK_SET );
+        bSuccess = ReadHeader();
+        poModule->SetMapOffset( VSIFTell( fp ) );
+
+        return bSuccess;
+    }
+
+    _sizeFieldLength = achLeader[20] - '0';
+    _sizeFieldPos = achLeader[21] - '0';
+    _sizeFieldTag = achLeader[23] - '0';
+
+    if( _sizeFieldLength < 0 || _sizeFieldLength > 9 
+        || _sizeFieldPos < 0 || _sizeFieldPos > 9
+        || _sizeFieldTag < 0 || _sizeFieldTag > 9 )
+    {
+        CPLError( CE_Failure, CPLE_AppDefined, 
+                  "ISO8211 record leader appears to be corrupt." );
+        return FALSE;
+    }
+
+    if( _leaderIden == 'R' )
+        nReuseHeader = TRUE;
+
+    nFieldOffset = _fieldAreaStart - nLeaderSize;
+
+/* -------------------------------------------------------------------- */
+/*      Is there anything seemly screwy about this record?              */
+/* -------------------------------------------------------------------- */
+    if( _recLength < 24 || _recLength > 100000000
+        || _fieldAreaStart < 24 || _fieldAreaStart > 100000 )
+    {
+        CPLError( CE_Failure, CPLE_FileIO, 
+                  "Data record appears to be corrupt on DDF file.\n"
+                  " -- ensure that the files were uncompressed without modifying\n"
+                  "carriage return/linefeeds (by default WINZIP does this)." );
+        
+        return FALSE;
+    }
+
+    if( nBytesLeft < _recLength )
+    {
+        CPLError( CE_Failure, CPLE_FileIO, 
+                  "Data record is short on DDF file." );
+        
+        return FALSE;
+    }
+
+/* -------------------------------------------------------------------- */
+/*      Point at the remainder of the record.                           */
+/* -------------------------------------------------------------------- */
+    nDataSize = _recLength - nLeaderSize;
+    pachData = (char *) achLeader + nLeaderSize;
+    bMappedData = TRUE;
+
+/* -------------------------------------------------------------------- */
+/*      If we don't find a field terminator at the end of the record    */
+/*      we take extra bytes till we get to it.                          */
+/* -------------------------------------------------------------------- */
+    while( pachData[nDataSize-1] != DDF_FIELD_TERMINATOR )
+    {
+        if( (long) nLeaderSize + nDataSize >= nBytesLeft )
+        {
+            CPLError( CE_Failure, CPLE_FileIO, 
+                      "Data record is short on DDF file." );
+            
+            return FALSE;
+        }
+
+        nDataSize++;
+        CPLDebug( "ISO8211", 
+                  "Didn't find field terminator, read one more byte." );
+    }
+
+    poModule->AdvanceMap( nLeaderSize + nDataSize );
+
+    return BuildFieldList( _fieldAreaStart );
+}
+
 /************************************************************************/
 /*                             FindField()                              */
 /************************************************************************/
@@ -1041,7 +1240,9 @@ DDFRecord *DDFRecord::CloneOn( DDFModule *poTargetModule )
  * the properly of application.  
  *
  * @return A new copy of the DDFRecord.  This can be delete'd by the
- * application when no longer needed.
+ * application when no longer needed.  If the module is memory mapped the
+ * copy shares the mapped data, and must be deleted before the module is
+ * closed.
  */
 
 DDFRecord * DDFRecord::Copy()
@@ -1055,8 +1256,21 @@ DDFRecord * DDFRecord::Copy()
     poNR->nFieldOffset = nFieldOffset;
     
     poNR->nDataSize = nDataSize;
-    poNR->pachData = (char *) CPLMalloc(nDataSize);
-    memcpy( poNR->pachData, pachData, nDataSize );
+
+/* -------------------------------------------------------------------- */
+/*      A record read from a mapped module can go on referring to the   */
+/*      mapping.  It gets its own data only if it is modified.          */
+/* -------------------------------------------------------------------- */
+    if( bMappedData )
+    {
+        poNR->pachData = pachData;
+        poNR->bMappedData = TRUE;
+    }
+    else
+    {
+        poNR->pachData = (char *) CPLMalloc(nDataSize);
+        memcpy( poNR->pachData, pachData, nDataSize );
+    }
     
     poNR->nFieldCount = nFieldCount;
     poNR->paoFields = new DDFField[nFieldCount];
@@ -1099,6 +1313,8 @@ DDFRecord * DDFRecord::Copy()
 int DDFRecord::DeleteField( DDFField *poTarget )
 
 {
+    DetachMappedData();
+
     int         iTarget, i;
 
 /* -------------------------------------------------------------------- */
@@ -1156,6 +1372,8 @@ int DDFRecord::DeleteField( DDFField *poTarget )
 int DDFRecord::ResizeField( DDFField *poField, int nNewDataSize )
 
 {
+    DetachMappedData();
+
     int         iTarget, i;
     int         nBytesToMove;
 
@@ -1278,6 +1496,8 @@ int DDFRecord::ResizeField( DDFField *poField, int nNewDataSize )
 DDFField *DDFRecord::AddField( DDFFieldDefn *poDefn )
 
 {
+    DetachMappedData();
+
 /* -------------------------------------------------------------------- */
 /*      Reallocate the fields array larger by one, and initialize       */
 /*      the new field.                                                  */
@@ -1339,6 +1559,8 @@ DDFRecord::SetFieldRaw( DDFField *poField, int iIndexWithinField,
                         const char *pachRawData, int nRawDataSize )
 
 {
+    DetachMappedData();
+
     int         iTarget, nRepeatCount;
 
 /* -------------------------------------------------------------------- */
@@ -1446,6 +1668,8 @@ DDFRecord::UpdateFieldRaw( DDFField *poField, int iIndexWithinField,
                            const char *pachRawData, int nRawDataSize )
 
 {
+    DetachMappedData();
+
     int         iTarget, nRepeatCount;
 
 /* -------------------------------------------------------------------- */
@@ -1531,6 +1755,8 @@ DDFRecord::UpdateFieldRaw( DDFField *poField, int iIndexWithinField,
 int DDFRecord::ResetDirectory()
 
 {
+    DetachMappedData();
+
     int iField;
 
 /* -------------------------------------------------------------------- */
@@ -1669,6 +1895,8 @@ int DDFRecord::SetStringSubfield( const char *pszField, int iFieldIndex,
                                   const char *pszValue, int nValueLength )
 
 {
+    DetachMappedData();
+
 /* -------------------------------------------------------------------- */
 /*      Fetch the field. If this fails, return zero.                    */
 /* -------------------------------------------------------------------- */
@@ -1781,6 +2009,8 @@ int DDFRecord::SetIntSubfield( const char *pszField, int iFieldIndex,
                                int nNewValue )
 
 {
+    DetachMappedData();
+
 /* -------------------------------------------------------------------- */
 /*      Fetch the field. If this fails, return zero.                    */
 /* -------------------------------------------------------------------- */
@@ -1892,6 +2122,8 @@ int DDFRecord::SetFloatSubfield( const char *pszField, int iFieldIndex,
                                  double dfNewValue )
 
 {
+    DetachMappedData();
+
 /* -------------------------------------------------------------------- */
 /*      Fetch the field. If this fails, return zero.                    */
 /* -------------------------------------------------------------------- */
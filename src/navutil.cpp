@@ -182,6 +182,9 @@ extern bool             g_bTrackDistance;
 extern int              gps_watchdog_timeout_ticks;
 
 extern int              g_nCacheLimit;
+extern int              g_nCacheMemLimitMB;
+extern int              g_nSENCBuildThreads;
+extern int              g_nS57TileCacheMB;
 
 extern bool             g_bGDAL_Debug;
 extern bool             g_bDebugCM93;
@@ -272,6 +275,11 @@ WX_DEFINE_LIST ( LayerList );
 
 SelectItem::SelectItem()
 {
+      m_nseq = 0;
+      m_grid_x0 = m_grid_y0 = 0;
+      m_grid_x1 = m_grid_y1 = -1;
+      m_pnode = NULL;
+      m_pnext_same_data = NULL;
 }
 
 SelectItem::~SelectItem()
@@ -289,6 +297,39 @@ void  SelectItem::SetUserData ( int data )
       m_Data4 = data;
 }
 
+//-----------------------------------------------------------------------------
+//          Select Type Index
+//-----------------------------------------------------------------------------
+
+SelectTypeIndex::SelectTypeIndex()
+{
+}
+
+SelectTypeIndex::~SelectTypeIndex()
+{
+      SelectGridHash::iterator it;
+      for ( it = m_grid.begin(); it != m_grid.end(); ++it )
+            delete it->second;
+}
+
+//    Grid cell coordinates are not wrapped, so the index matches the plain
+//    lat/lon comparisons of the hit tests
+static int SelectGridCell ( float deg )
+{
+      double cell = floor ( deg / SELECT_GRID_DEG );
+      return ( int ) wxMax ( wxMin ( cell, 32767. ), -32768. );
+}
+
+static int SelectGridKey ( int gx, int gy )
+{
+      return ( gy * 65536 ) + ( gx + 32768 );
+}
+
+static int wxCMPFUNC_CONV CompareSelectItemSeq ( void **p1, void **p2 )
+{
+      return ( ( SelectItem * ) *p1 )->m_nseq - ( ( SelectItem * ) *p2 )->m_nseq;
+}
+
 //-----------------------------------------------------------------------------
 //          Select
 //-----------------------------------------------------------------------------
@@ -296,6 +337,7 @@ void  SelectItem::SetUserData ( int data )
 Select::Select()
 {
       pSelectList = new SelectableItemList;
+      m_nseq_next = 0;
 }
 
 Select::~Select()
@@ -304,7 +346,169 @@ Select::~Select()
       pSelectList->Clear();
       delete pSelectList;
 
+      SelectTypeIndexHash::iterator it;
+      for ( it = m_type_index.begin(); it != m_type_index.end(); ++it )
+            delete it->second;
+}
+
+SelectTypeIndex *Select::GetTypeIndex ( int seltype, bool bcreate )
+{
+      SelectTypeIndexHash::iterator it = m_type_index.find ( seltype );
+      if ( it != m_type_index.end() )
+            return it->second;
+
+      if ( !bcreate )
+            return NULL;
+
+      SelectTypeIndex *pidx = new SelectTypeIndex;
+      m_type_index[seltype] = pidx;
+      return pidx;
+}
+
+void Select::GridInsert ( SelectTypeIndex *pidx, SelectItem *pSelItem )
+{
+      float lat0 = pSelItem->m_slat;
+      float lat1 = pSelItem->m_slat;
+      float lon0 = pSelItem->m_slon;
+      float lon1 = pSelItem->m_slon;
+
+      if ( ( pSelItem->m_seltype == SELTYPE_ROUTESEGMENT ) || ( pSelItem->m_seltype == SELTYPE_TRACKSEGMENT ) )
+      {
+            //    IsSegmentSelected() unwraps segments crossing the prime meridian or the date line,
+            //    so their raw bounding box cannot be trusted
+            if ( ( pSelItem->m_slon * pSelItem->m_slon2 ) < 0. )
+            {
+                  pSelItem->m_grid_x0 = 1;
+                  pSelItem->m_grid_x1 = 0;
+                  pidx->m_unindexed.Add ( pSelItem );
+                  return;
+            }
+
+            lat0 = fmin ( pSelItem->m_slat, pSelItem->m_slat2 );
+            lat1 = fmax ( pSelItem->m_slat, pSelItem->m_slat2 );
+            lon0 = fmin ( pSelItem->m_slon, pSelItem->m_slon2 );
+            lon1 = fmax ( pSelItem->m_slon, pSelItem->m_slon2 );
+      }
+
+      int gx0 = SelectGridCell ( lon0 );
+      int gx1 = SelectGridCell ( lon1 );
+      int gy0 = SelectGridCell ( lat0 );
+      int gy1 = SelectGridCell ( lat1 );
+
+      //    Long segments are simply always tested
+      if ( ( ( gx1 - gx0 + 1 ) * ( gy1 - gy0 + 1 ) ) > SELECT_GRID_MAX_ITEM_CELLS )
+      {
+            pSelItem->m_grid_x0 = 1;
+            pSelItem->m_grid_x1 = 0;
+            pidx->m_unindexed.Add ( pSelItem );
+            return;
+      }
+
+      pSelItem->m_grid_x0 = gx0;
+      pSelItem->m_grid_x1 = gx1;
+      pSelItem->m_grid_y0 = gy0;
+      pSelItem->m_grid_y1 = gy1;
+
+      for ( int gy = gy0 ; gy <= gy1 ; gy++ )
+      {
+            for ( int gx = gx0 ; gx <= gx1 ; gx++ )
+            {
+                  int key = SelectGridKey ( gx, gy );
+
+                  wxArrayPtrVoid *pcell;
+                  SelectGridHash::iterator it = pidx->m_grid.find ( key );
+                  if ( it != pidx->m_grid.end() )
+                        pcell = it->second;
+                  else
+                  {
+                        pcell = new wxArrayPtrVoid;
+                        pidx->m_grid[key] = pcell;
+                  }
+
+                  pcell->Add ( pSelItem );
+            }
+      }
+}
+
+void Select::GridRemove ( SelectTypeIndex *pidx, SelectItem *pSelItem )
+{
+      if ( pSelItem->m_grid_x0 > pSelItem->m_grid_x1 )
+      {
+            pidx->m_unindexed.Remove ( pSelItem );
+            return;
+      }
+
+      for ( int gy = pSelItem->m_grid_y0 ; gy <= pSelItem->m_grid_y1 ; gy++ )
+      {
+            for ( int gx = pSelItem->m_grid_x0 ; gx <= pSelItem->m_grid_x1 ; gx++ )
+            {
+                  SelectGridHash::iterator it = pidx->m_grid.find ( SelectGridKey ( gx, gy ) );
+                  if ( it != pidx->m_grid.end() )
+                  {
+                        wxArrayPtrVoid *pcell = it->second;
+                        pcell->Remove ( pSelItem );
+                        if ( pcell->IsEmpty() )
+                        {
+                              delete pcell;
+                              pidx->m_grid.erase ( it );
+                        }
+                  }
+            }
+      }
+}
+
+void Select::AddItem ( SelectItem *pSelItem )
+{
+      pSelItem->m_nseq = m_nseq_next++;
+      pSelItem->m_pnode = pSelectList->Append ( pSelItem );
+      pSelItem->m_pnext_same_data = NULL;
+
+      SelectTypeIndex *pidx = GetTypeIndex ( pSelItem->m_seltype, true );
+      GridInsert ( pidx, pSelItem );
+
+      //    Keep items with the same data in the order they were added
+      SelectDataHash::iterator it = pidx->m_data.find ( pSelItem->m_pData1 );
+      if ( it == pidx->m_data.end() )
+            pidx->m_data[pSelItem->m_pData1] = pSelItem;
+      else
+      {
+            SelectItem *pitem = it->second;
+            while ( pitem->m_pnext_same_data )
+                  pitem = pitem->m_pnext_same_data;
+            pitem->m_pnext_same_data = pSelItem;
+      }
+}
+
+void Select::RemoveItem ( SelectItem *pSelItem )
+{
+      SelectTypeIndex *pidx = GetTypeIndex ( pSelItem->m_seltype, false );
+      if ( pidx )
+      {
+            GridRemove ( pidx, pSelItem );
+
+            SelectDataHash::iterator it = pidx->m_data.find ( pSelItem->m_pData1 );
+            if ( it != pidx->m_data.end() )
+            {
+                  if ( it->second == pSelItem )
+                  {
+                        if ( pSelItem->m_pnext_same_data )
+                              it->second = pSelItem->m_pnext_same_data;
+                        else
+                              pidx->m_data.erase ( it );
+                  }
+                  else
+                  {
+                        SelectItem *pitem = it->second;
+                        while ( pitem->m_pnext_same_data && ( pitem->m_pnext_same_data != pSelItem ) )
+                              pitem = pitem->m_pnext_same_data;
+                        if ( pitem->m_pnext_same_data == pSelItem )
+                              pitem->m_pnext_same_data = pSelItem->m_pnext_same_data;
+                  }
+            }
+      }
 
+      delete ( wxSelectableItemListNode * ) pSelItem->m_pnode;
+      delete pSelItem;
 }
 
 bool Select::AddSelectableRoutePoint ( float slat, float slon, RoutePoint *pRoutePointAdd )
@@ -316,7 +520,7 @@ bool Select::AddSelectableRoutePoint ( float slat, float slon, RoutePoint *pRout
       pSelItem->m_bIsSelected = false;
       pSelItem->m_pData1 = pRoutePointAdd;
 
-      pSelectList->Append ( pSelItem );
+      AddItem ( pSelItem );
 
       return true;
 }
@@ -336,7 +540,7 @@ bool Select::AddSelectableRouteSegment ( float slat1, float slon1, float slat2,
       pSelItem->m_pData2 = pRoutePointAdd2;
       pSelItem->m_pData3 = pRoute;
 
-      pSelectList->Append ( pSelItem );
+      AddItem ( pSelItem );
 
       return true;
 }
@@ -351,26 +555,13 @@ bool Select::DeleteAllSelectableRouteSegments ( Route *pr )
       while ( node )
       {
             pFindSel = node->GetData();
+            node = node->GetNext();                   // before the current node goes away
+
             if ( pFindSel->m_seltype == SELTYPE_ROUTESEGMENT )
             {
-
-//                  RoutePoint *ps1 = (RoutePoint *)pFindSel->m_pData1;
-//                  RoutePoint *ps2 = (RoutePoint *)pFindSel->m_pData2;
-
                   if ( ( Route * ) pFindSel->m_pData3  == pr )
-                  {
-                        delete pFindSel;
-                        pSelectList->DeleteNode ( node );   //delete node;
-
-                        node = pSelectList->GetFirst();     // reset the top node
-
-                        goto got_next_outer_node;
-                  }
+                        RemoveItem ( pFindSel );
             }
-
-            node = node->GetNext();
-      got_next_outer_node:
-            continue;
       }
 
 
@@ -380,39 +571,21 @@ bool Select::DeleteAllSelectableRouteSegments ( Route *pr )
 
 bool Select::DeleteAllSelectableRoutePoints ( Route *pr )
 {
-      SelectItem *pFindSel;
-
-//    Iterate on the select list
-      wxSelectableItemListNode *node = pSelectList->GetFirst();
+      SelectTypeIndex *pidx = GetTypeIndex ( SELTYPE_ROUTEPOINT, false );
+      if ( !pidx )
+            return true;
 
-      while ( node )
+      //    Iterate on the route's point list, removing every item for each point
+      wxRoutePointListNode *pnode = ( pr->pRoutePointList )->GetFirst();
+      while ( pnode )
       {
-            pFindSel = node->GetData();
-            if ( pFindSel->m_seltype == SELTYPE_ROUTEPOINT )
-            {
-                  RoutePoint *ps = ( RoutePoint * ) pFindSel->m_pData1;
-
-                  //    inner loop iterates on the route's point list
-                  wxRoutePointListNode *pnode = ( pr->pRoutePointList )->GetFirst();
-                  while ( pnode )
-                  {
-                        RoutePoint *prp = pnode->GetData();
-
-                        if ( prp == ps )
-                        {
-                              delete pFindSel;
-                              pSelectList->DeleteNode ( node );   //delete node;
-                              node = pSelectList->GetFirst();
+            RoutePoint *prp = pnode->GetData();
 
-                              goto got_next_outer_node;
-                        }
-                        pnode = pnode->GetNext();
-                  }
-            }
+            SelectDataHash::iterator it;
+            while ( ( it = pidx->m_data.find ( prp ) ) != pidx->m_data.end() )
+                  RemoveItem ( it->second );
 
-            node = node->GetNext();
-      got_next_outer_node:
-            continue;
+            pnode = pnode->GetNext();
       }
       return true;
 }
@@ -511,6 +684,10 @@ bool Select::UpdateSelectableRouteSegments ( RoutePoint *prp )
       SelectItem *pFindSel;
       bool ret = false;
 
+      SelectTypeIndex *pidx = GetTypeIndex ( SELTYPE_ROUTESEGMENT, false );
+      if ( !pidx )
+            return false;
+
 //    Iterate on the select list
       wxSelectableItemListNode *node = pSelectList->GetFirst();
 
@@ -521,15 +698,19 @@ bool Select::UpdateSelectableRouteSegments ( RoutePoint *prp )
             {
                   if ( pFindSel->m_pData1 == prp )
                   {
+                        GridRemove ( pidx, pFindSel );
                         pFindSel->m_slat = prp->m_lat;
                         pFindSel->m_slon = prp->m_lon;
+                        GridInsert ( pidx, pFindSel );
                         ret = true;;
                   }
 
                   else if ( pFindSel->m_pData2 == prp )
                   {
+                        GridRemove ( pidx, pFindSel );
                         pFindSel->m_slat2 = prp->m_lat;
                         pFindSel->m_slon2 = prp->m_lon;
+                        GridInsert ( pidx, pFindSel );
                         ret = true;
                   }
             }
@@ -540,7 +721,18 @@ bool Select::UpdateSelectableRouteSegments ( RoutePoint *prp )
       return ret;
 }
 
+void Select::ModifySelectableItem ( SelectItem *pFindSel, float slat, float slon )
+{
+      SelectTypeIndex *pidx = GetTypeIndex ( pFindSel->m_seltype, false );
+      if ( pidx )
+            GridRemove ( pidx, pFindSel );
 
+      pFindSel->m_slat = slat;
+      pFindSel->m_slon = slon;
+
+      if ( pidx )
+            GridInsert ( pidx, pFindSel );
+}
 
 
 
@@ -559,7 +751,7 @@ SelectItem *Select::AddSelectablePoint ( float slat, float slon, void *pdata, in
             pSelItem->m_bIsSelected = false;
             pSelItem->m_pData1 = pdata;
 
-            pSelectList->Append ( pSelItem );
+            AddItem ( pSelItem );
       }
 
       return pSelItem;
@@ -569,32 +761,30 @@ bool Select::DeleteAllPoints ( void )
 {
       pSelectList->DeleteContents ( true );
       pSelectList->Clear();
+      pSelectList->DeleteContents ( false );
+
+      SelectTypeIndexHash::iterator it;
+      for ( it = m_type_index.begin(); it != m_type_index.end(); ++it )
+            delete it->second;
+      m_type_index.clear();
+
       return true;
 }
 
 
 bool Select::DeleteSelectablePoint ( void *pdata, int SeltypeToDelete )
 {
-      SelectItem *pFindSel;
-
       if ( NULL != pdata )
       {
-//    Iterate on the list
-            wxSelectableItemListNode *node = pSelectList->GetFirst();
-
-            while ( node )
+            SelectTypeIndex *pidx = GetTypeIndex ( SeltypeToDelete, false );
+            if ( pidx )
             {
-                  pFindSel = node->GetData();
-                  if ( pFindSel->m_seltype == SeltypeToDelete )
+                  SelectDataHash::iterator it = pidx->m_data.find ( pdata );
+                  if ( it != pidx->m_data.end() )
                   {
-                        if ( pdata == pFindSel->m_pData1 )
-                        {
-                              delete pFindSel;
-                              delete node;
-                              return true;
-                        }
+                        RemoveItem ( it->second );
+                        return true;
                   }
-                  node = node->GetNext();
             }
       }
       return false;
@@ -611,42 +801,25 @@ bool Select::DeleteAllSelectableTypePoints ( int SeltypeToDelete )
       while ( node )
       {
             pFindSel = node->GetData();
-            if ( pFindSel->m_seltype == SeltypeToDelete )
-            {
-                  delete pFindSel;
-                  delete node;
-                  node = pSelectList->GetFirst();
-                  goto got_next_node;
-            }
-
             node = node->GetNext();
-      got_next_node:
-            continue;
+
+            if ( pFindSel->m_seltype == SeltypeToDelete )
+                  RemoveItem ( pFindSel );
       }
       return true;
 }
 
 bool Select::ModifySelectablePoint ( float lat, float lon, void *data, int SeltypeToModify )
 {
-      SelectItem *pFindSel;
-
-//    Iterate on the list
-      wxSelectableItemListNode *node = pSelectList->GetFirst();
-
-      while ( node )
+      SelectTypeIndex *pidx = GetTypeIndex ( SeltypeToModify, false );
+      if ( pidx )
       {
-            pFindSel = node->GetData();
-            if ( pFindSel->m_seltype == SeltypeToModify )
+            SelectDataHash::iterator it = pidx->m_data.find ( data );
+            if ( it != pidx->m_data.end() )
             {
-                  if ( data == pFindSel->m_pData1 )
-                  {
-                        pFindSel->m_slat = lat;
-                        pFindSel->m_slon = lon;
-                        return true;
-                  }
+                  ModifySelectableItem ( it->second, lat, lon );
+                  return true;
             }
-
-            node = node->GetNext();
       }
       return false;
 }
@@ -667,7 +840,7 @@ bool Select::AddSelectableTrackSegment ( float slat1, float slon1, float slat2,
       pSelItem->m_pData2 = pRoutePointAdd2;
       pSelItem->m_pData3 = pRoute;
 
-      pSelectList->Append ( pSelItem );
+      AddItem ( pSelItem );
 
       return true;
 }
@@ -684,26 +857,13 @@ bool Select::DeleteAllSelectableTrackSegments ( Route *pr )
       while ( node )
       {
             pFindSel = node->GetData();
+            node = node->GetNext();                   // before the current node goes away
+
             if ( pFindSel->m_seltype == SELTYPE_TRACKSEGMENT )
             {
-
-//                  RoutePoint *ps1 = (RoutePoint *)pFindSel->m_pData1;
-//                  RoutePoint *ps2 = (RoutePoint *)pFindSel->m_pData2;
-
                   if ( ( Route * ) pFindSel->m_pData3  == pr )
-                  {
-                        delete pFindSel;
-                        pSelectList->DeleteNode ( node );   //delete node;
-
-                        node = pSelectList->GetFirst();     // reset the top node
-
-                        goto got_next_outer_node;
-                  }
+                        RemoveItem ( pFindSel );
             }
-
-            node = node->GetNext();
-      got_next_outer_node:
-                  continue;
       }
 
 
@@ -763,56 +923,103 @@ bool IsSegmentSelected(float a,float b, float c, float d,float slat, float slon,
 
 
 
-SelectItem *Select::FindSelection ( float slat, float slon, int fseltype, float SelectRadius )
+bool Select::GetCandidates ( float slat, float slon, int fseltype, float SelectRadius, wxArrayPtrVoid &candidates )
 {
-      float a,b,c,d;
-      SelectItem *pFindSel;
+      int gx0 = SelectGridCell ( slon - SelectRadius );
+      int gx1 = SelectGridCell ( slon + SelectRadius );
+      int gy0 = SelectGridCell ( slat - SelectRadius );
+      int gy1 = SelectGridCell ( slat + SelectRadius );
 
-//    Iterate on the list
-      wxSelectableItemListNode *node = pSelectList->GetFirst();
+      if ( ( ( double ) ( gx1 - gx0 + 1 ) * ( double ) ( gy1 - gy0 + 1 ) ) > SELECT_GRID_MAX_QUERY_CELLS )
+            return false;
 
-      while ( node )
+      SelectTypeIndex *pidx = GetTypeIndex ( fseltype, false );
+      if ( !pidx )
+            return true;
+
+      for ( int gy = gy0 ; gy <= gy1 ; gy++ )
       {
-            pFindSel = node->GetData();
-            if ( pFindSel->m_seltype == fseltype )
+            for ( int gx = gx0 ; gx <= gx1 ; gx++ )
             {
-                  switch ( fseltype )
+                  SelectGridHash::iterator it = pidx->m_grid.find ( SelectGridKey ( gx, gy ) );
+                  if ( it != pidx->m_grid.end() )
                   {
-                        case SELTYPE_ROUTEPOINT:
-                        case SELTYPE_TIDEPOINT:
-                        case SELTYPE_CURRENTPOINT:
-                        case SELTYPE_AISTARGET:
-                              a = fabs ( slat - pFindSel->m_slat );
-                              b = fabs ( slon - pFindSel->m_slon );
-
-                              if ( ( fabs ( slat - pFindSel->m_slat ) < SelectRadius ) &&
-                                      ( fabs ( slon - pFindSel->m_slon ) < SelectRadius ) )
-                                    goto find_ok;
-                              break;
-                        case SELTYPE_ROUTESEGMENT:
-                        case SELTYPE_TRACKSEGMENT:
-                        {
-                              a = pFindSel->m_slat;
-                              b = pFindSel->m_slat2;
-                              c = pFindSel->m_slon;
-                              d = pFindSel->m_slon2;
-
-                              if(IsSegmentSelected(a,b,c,d,slat,slon, SelectRadius))
-                                    goto find_ok;
-                              break;
-                        }
-                        default:
-                              break;
+                        wxArrayPtrVoid *pcell = it->second;
+                        for ( unsigned int i = 0 ; i < pcell->GetCount() ; i++ )
+                              candidates.Add ( pcell->Item ( i ) );
                   }
             }
+      }
+
+      for ( unsigned int i = 0 ; i < pidx->m_unindexed.GetCount() ; i++ )
+            candidates.Add ( pidx->m_unindexed.Item ( i ) );
+
+      //    Report in select list order, each item once
+      candidates.Sort ( CompareSelectItemSeq );
+
+      unsigned int n = 0;
+      for ( unsigned int i = 0 ; i < candidates.GetCount() ; i++ )
+      {
+            if ( ( n == 0 ) || ( candidates.Item ( n - 1 ) != candidates.Item ( i ) ) )
+                  candidates[n++] = candidates.Item ( i );
+      }
+      if ( n < candidates.GetCount() )
+            candidates.RemoveAt ( n, candidates.GetCount() - n );
+
+      return true;
+}
+
+bool Select::IsItemSelected ( SelectItem *pFindSel, float slat, float slon, float SelectRadius )
+{
+      switch ( pFindSel->m_seltype )
+      {
+            case SELTYPE_ROUTEPOINT:
+            case SELTYPE_TIDEPOINT:
+            case SELTYPE_CURRENTPOINT:
+            case SELTYPE_AISTARGET:
+                  if ( ( fabs ( slat - pFindSel->m_slat ) < SelectRadius ) &&
+                         ( fabs ( slon - pFindSel->m_slon ) < SelectRadius ) )
+                        return true;
+                  break;
+            case SELTYPE_ROUTESEGMENT:
+            case SELTYPE_TRACKSEGMENT:
+                  return IsSelectableSegmentSelected ( slat, slon, SelectRadius, pFindSel );
+            default:
+                  break;
+      }
+      return false;
+}
+
 
+SelectItem *Select::FindSelection ( float slat, float slon, int fseltype, float SelectRadius )
+{
+      SelectItem *pFindSel;
+      wxArrayPtrVoid candidates;
+
+      if ( GetCandidates ( slat, slon, fseltype, SelectRadius, candidates ) )
+      {
+            for ( unsigned int i = 0 ; i < candidates.GetCount() ; i++ )
+            {
+                  pFindSel = ( SelectItem * ) candidates.Item ( i );
+                  if ( IsItemSelected ( pFindSel, slat, slon, SelectRadius ) )
+                        return pFindSel;
+            }
+            return NULL;
+      }
+
+//    Search area too wide for the grid, iterate on the list
+      wxSelectableItemListNode *node = pSelectList->GetFirst();
+
+      while ( node )
+      {
+            pFindSel = node->GetData();
+            if ( ( pFindSel->m_seltype == fseltype ) && IsItemSelected ( pFindSel, slat, slon, SelectRadius ) )
+                  return pFindSel;
 
             node = node->GetNext();
       }
 
       return NULL;
-find_ok:
-      return pFindSel;
 }
 
 bool Select::IsSelectableSegmentSelected(float slat, float slon, float SelectRadius, SelectItem *pFindSel)
@@ -828,53 +1035,33 @@ bool Select::IsSelectableSegmentSelected(float slat, float slon, float SelectRad
 
 SelectableItemList Select::FindSelectionList(float slat, float slon, int fseltype, float SelectRadius)
 {
-      float a,b,c,d;
       SelectItem *pFindSel;
       SelectableItemList ret_list;
+      wxArrayPtrVoid candidates;
 
-//    Iterate on the list
+      if ( GetCandidates ( slat, slon, fseltype, SelectRadius, candidates ) )
+      {
+            for ( unsigned int i = 0 ; i < candidates.GetCount() ; i++ )
+            {
+                  pFindSel = ( SelectItem * ) candidates.Item ( i );
+                  if ( IsItemSelected ( pFindSel, slat, slon, SelectRadius ) )
+                        ret_list.Append(pFindSel);
+            }
+            return ret_list;
+      }
+
+//    Search area too wide for the grid, iterate on the list
       wxSelectableItemListNode *node = pSelectList->GetFirst();
 
       while ( node )
       {
             pFindSel = node->GetData();
-            if ( pFindSel->m_seltype == fseltype )
-            {
-                  switch ( fseltype )
-                  {
-                        case SELTYPE_ROUTEPOINT:
-                        case SELTYPE_TIDEPOINT:
-                        case SELTYPE_CURRENTPOINT:
-                        case SELTYPE_AISTARGET:
-                              if ( ( fabs ( slat - pFindSel->m_slat ) < SelectRadius ) &&
-                                     ( fabs ( slon - pFindSel->m_slon ) < SelectRadius ) )
-                              {
-                                    ret_list.Append(pFindSel);
-                              }
-                              break;
-                        case SELTYPE_ROUTESEGMENT:
-                        case SELTYPE_TRACKSEGMENT:
-                        {
-                              a = pFindSel->m_slat;
-                              b = pFindSel->m_slat2;
-                              c = pFindSel->m_slon;
-                              d = pFindSel->m_slon2;
-
-                              if(IsSegmentSelected(a,b,c,d,slat,slon, SelectRadius))
-                                    ret_list.Append(pFindSel);
-
-                              break;
-                        }
-                        default:
-                              break;
-                  }
-            }
-
+            if ( ( pFindSel->m_seltype == fseltype ) && IsItemSelected ( pFindSel, slat, slon, SelectRadius ) )
+                  ret_list.Append(pFindSel);
 
             node = node->GetNext();
       }
 
-
       return ret_list;
 }
 
@@ -1581,6 +1768,25 @@ void Route::Draw ( wxDC& dc, ViewPort &VP )
             //Both off, need to check shortest distance
             else if ( !b_1_on && !b_2_on )
             {
+                  //    Cull segments lying wholly to one side of the viewport.
+                  //    Longitude is only trusted away from the date line.
+                  LLBBox &vpbox = VP.GetBBox();
+                  bool b_off = ( ( prp1->m_lat > vpbox.GetMaxY() ) && ( prp2->m_lat > vpbox.GetMaxY() ) ) ||
+                               ( ( prp1->m_lat < vpbox.GetMinY() ) && ( prp2->m_lat < vpbox.GetMinY() ) );
+
+                  if ( !b_off && ( vpbox.GetMinX() >= -180. ) && ( vpbox.GetMaxX() <= 180. ) &&
+                        ( fabs ( prp1->m_lon - prp2->m_lon ) < 180. ) )
+                        b_off = ( ( prp1->m_lon > vpbox.GetMaxX() ) && ( prp2->m_lon > vpbox.GetMaxX() ) ) ||
+                                ( ( prp1->m_lon < vpbox.GetMinX() ) && ( prp2->m_lon < vpbox.GetMinX() ) );
+
+                  if ( b_off )
+                  {
+                        rpt1 = rpt2;
+                        prp1 = prp2;
+                        node = node->GetNext();
+                        continue;
+                  }
+
                   if ( rpt1.x < rpt2.x )
                         adder = ( int ) pix_full_circle;
                   else
@@ -2210,30 +2416,220 @@ bool Route::IsEqualTo ( Route *ptargetroute )
       if ( NULL == pthisnode )
             return false;
 
-      if (this->m_bIsInLayer || ptargetroute->m_bIsInLayer) return false;
+      if (this->m_bIsInLayer || ptargetroute->m_bIsInLayer) return false;
+
+      if (this->GetnPoints() != ptargetroute->GetnPoints())
+           return false;
+
+      while ( pthisnode )
+      {
+            if ( NULL == pthatnode )
+                  return false;
+
+            RoutePoint *pthisrp = pthisnode->GetData();
+            RoutePoint *pthatrp = pthatnode->GetData();
+
+            if ( ( fabs ( pthisrp->m_lat - pthatrp->m_lat ) > 1.0e-6 ) || ( fabs ( pthisrp->m_lon - pthatrp->m_lon ) > 1.0e-6 ) )
+                  return false;
+
+            if ( !pthisrp->GetName().IsSameAs ( pthatrp->GetName() ) )
+                  return false;
+
+            pthisnode = pthisnode->GetNext();
+            pthatnode = pthatnode->GetNext();
+      }
+
+      return true;                              // success, they are the same
+}
+
+//---------------------------------------------------------------------------------
+//    Track Point Store Implementation
+//---------------------------------------------------------------------------------
+TrackPointChunk::TrackPointChunk()
+{
+      m_nPoints = 0;
+      m_plod_index = NULL;
+      m_lod_nPoints = -1;
+}
+
+TrackPointChunk::~TrackPointChunk()
+{
+      free ( m_plod_index );
+}
+
+//    Weight each fix by the Douglas-Peucker tolerance at which it would be dropped,
+//    then list the surviving fixes for each level.
+//    Only the chunk being appended to ever needs rebuilding.
+void TrackPointChunk::BuildLOD ( void )
+{
+      int n = m_nPoints;
+      if ( n == 0 )
+            return;
+
+      const float keep = ( float ) TRACK_LOD_KEEP;
+
+      double x[TRACK_CHUNK_POINTS], y[TRACK_CHUNK_POINTS];
+      for ( int i = 0 ; i < n ; i++ )
+      {
+            toSM ( m_lat[i], m_lon[i], 0., 0., &x[i], &y[i] );
+            m_lod_weight[i] = 0.;
+      }
+
+      //    Chunk ends, and fixes either side of a segment or colour change, are always kept
+      m_lod_weight[0] = keep;
+      m_lod_weight[n - 1] = keep;
+      for ( int i = 1 ; i < n ; i++ )
+      {
+            if ( ( m_segno[i] != m_segno[i - 1] ) || ( m_style[i] != m_style[i - 1] ) )
+            {
+                  m_lod_weight[i - 1] = keep;
+                  m_lod_weight[i] = keep;
+            }
+      }
+
+      //    Simplify each run between kept fixes, without recursion
+      int stack_a[TRACK_CHUNK_POINTS], stack_b[TRACK_CHUNK_POINTS];
+      float stack_w[TRACK_CHUNK_POINTS];
+      int nstack = 0;
+
+      int a = 0;
+      for ( int i = 1 ; i < n ; i++ )
+      {
+            if ( m_lod_weight[i] == keep )
+            {
+                  stack_a[nstack] = a;
+                  stack_b[nstack] = i;
+                  stack_w[nstack] = keep;
+                  nstack++;
+                  a = i;
+            }
+      }
+
+      while ( nstack )
+      {
+            nstack--;
+            int ia = stack_a[nstack];
+            int ib = stack_b[nstack];
+            float w = stack_w[nstack];
+
+            if ( ib - ia < 2 )
+                  continue;
+
+            //    Farthest fix from the chord
+            double dx = x[ib] - x[ia];
+            double dy = y[ib] - y[ia];
+            double len2 = ( dx * dx ) + ( dy * dy );
+
+            double dmax = -1.;
+            int imax = ia + 1;
+            for ( int i = ia + 1 ; i < ib ; i++ )
+            {
+                  double px = x[i] - x[ia];
+                  double py = y[i] - y[ia];
+                  double t = 0.;
+                  if ( len2 > 0. )
+                        t = wxMax ( 0., wxMin ( 1., ( ( px * dx ) + ( py * dy ) ) / len2 ) );
+                  double ex = px - ( t * dx );
+                  double ey = py - ( t * dy );
+                  double d = ( ex * ex ) + ( ey * ey );
+                  if ( d > dmax )
+                  {
+                        dmax = d;
+                        imax = i;
+                  }
+            }
+
+            //    Nested levels: a fix never outlives the one that split its run
+            float wk = wxMin ( ( float ) sqrt ( dmax ), w );
+            m_lod_weight[imax] = wk;
+
+            stack_a[nstack] = ia;
+            stack_b[nstack] = imax;
+            stack_w[nstack] = wk;
+            nstack++;
+            stack_a[nstack] = imax;
+            stack_b[nstack] = ib;
+            stack_w[nstack] = wk;
+            nstack++;
+      }
+
+      //    Index the fixes kept at each level
+      int ntotal = 0;
+      double tol = TRACK_LOD_BASE_TOL;
+      for ( int level = 0 ; level < TRACK_LOD_LEVELS ; level++ )
+      {
+            for ( int i = 0 ; i < n ; i++ )
+                  if ( m_lod_weight[i] > tol )
+                        ntotal++;
+            tol *= TRACK_LOD_LEVEL_STEP;
+      }
+
+      m_plod_index = ( unsigned short * ) realloc ( m_plod_index, ntotal * sizeof ( unsigned short ) );
+
+      int pos = 0;
+      tol = TRACK_LOD_BASE_TOL;
+      for ( int level = 0 ; level < TRACK_LOD_LEVELS ; level++ )
+      {
+            m_lod_start[level] = pos;
+            for ( int i = 0 ; i < n ; i++ )
+                  if ( m_lod_weight[i] > tol )
+                        m_plod_index[pos++] = ( unsigned short ) i;
+            tol *= TRACK_LOD_LEVEL_STEP;
+      }
+      m_lod_start[TRACK_LOD_LEVELS] = pos;
+
+      m_lod_nPoints = n;
+}
+
+TrackPointStore::TrackPointStore()
+{
+      m_nPoints = 0;
+}
+
+TrackPointStore::~TrackPointStore()
+{
+      Clear();
+}
+
+void TrackPointStore::Clear(void)
+{
+      for ( unsigned int i = 0 ; i < m_chunks.GetCount() ; i++ )
+            delete m_chunks.Item ( i );
+      m_chunks.Clear();
+
+      m_nPoints = 0;
+}
 
-      if (this->GetnPoints() != ptargetroute->GetnPoints())
-           return false;
+void TrackPointStore::Append ( double lat, double lon, time_t t, int segno, int style )
+{
+      TrackPointChunk *pchunk = NULL;
+      int nchunks = m_chunks.GetCount();
+      if ( nchunks )
+            pchunk = m_chunks.Item ( nchunks - 1 );
 
-      while ( pthisnode )
+      if ( ( NULL == pchunk ) || ( pchunk->m_nPoints == TRACK_CHUNK_POINTS ) )
       {
-            if ( NULL == pthatnode )
-                  return false;
+            TrackPointChunk *pnew = new TrackPointChunk;
 
-            RoutePoint *pthisrp = pthisnode->GetData();
-            RoutePoint *pthatrp = pthatnode->GetData();
+            //    The segment joining the chunks belongs to the new one
+            if ( pchunk )
+                  pnew->m_bbox.Expand ( pchunk->m_lon[TRACK_CHUNK_POINTS - 1], pchunk->m_lat[TRACK_CHUNK_POINTS - 1] );
 
-            if ( ( fabs ( pthisrp->m_lat - pthatrp->m_lat ) > 1.0e-6 ) || ( fabs ( pthisrp->m_lon - pthatrp->m_lon ) > 1.0e-6 ) )
-                  return false;
+            m_chunks.Add ( pnew );
+            pchunk = pnew;
+      }
 
-            if ( !pthisrp->GetName().IsSameAs ( pthatrp->GetName() ) )
-                  return false;
+      int i = pchunk->m_nPoints;
+      pchunk->m_lat[i] = lat;
+      pchunk->m_lon[i] = lon;
+      pchunk->m_time[i] = t;
+      pchunk->m_segno[i] = ( unsigned short ) segno;
+      pchunk->m_style[i] = ( unsigned char ) style;
+      pchunk->m_nPoints++;
 
-            pthisnode = pthisnode->GetNext();
-            pthatnode = pthatnode->GetNext();
-      }
+      pchunk->m_bbox.Expand ( lon, lat );
 
-      return true;                              // success, they are the same
+      m_nPoints++;
 }
 
 //---------------------------------------------------------------------------------
@@ -2264,6 +2660,7 @@ Track::Track ( void )
       m_ConfigRouteNum = now.GetTicks();        // a unique number....
 
       m_track_run = 0;
+      m_prev_pTrackPoint = NULL;
 }
 
 Track::~Track()
@@ -2296,31 +2693,32 @@ void Track::Stop ( bool do_add_point )
 
 bool Track::DoExtendDaily()
 {
-            Route *pExtendRoute = NULL;
-            RoutePoint *pExtendPoint = NULL;
+            Track *pExtendTrack = NULL;
+            wxDateTime extend_time;
 
-            RoutePoint *pLastPoint = this->GetPoint(1);
+            wxDateTime first_time = GetStartTime();
 
             wxRouteListNode *route_node = pRouteList->GetFirst();
             while(route_node) {
                   Route *proute = route_node->GetData();
-                  if (proute->m_bIsTrack) {
-                        RoutePoint *track_node = proute->GetLastPoint();
-                              if(track_node->m_CreateTime <= pLastPoint->m_CreateTime)
-                                    if (!pExtendPoint || track_node->m_CreateTime > pExtendPoint->m_CreateTime) {
-                                          pExtendPoint = track_node;
-                                          pExtendRoute = proute;
+                  if (proute->m_bIsTrack && (proute != this) && proute->GetnPoints()) {
+                        Track *ptrack = (Track *)proute;
+                        wxDateTime last_time = ptrack->GetEndTime();
+                              if(last_time <= first_time)
+                                    if (!pExtendTrack || last_time > extend_time) {
+                                          extend_time = last_time;
+                                          pExtendTrack = ptrack;
                                     }
                   }
                   route_node = route_node->GetNext();                         // next route
             }
-            if (pExtendRoute
-                  && pExtendRoute->GetPoint(1)->m_CreateTime.FromTimezone(wxDateTime::GMT0).IsSameDate(pLastPoint->m_CreateTime.FromTimezone(wxDateTime::GMT0))){
+            if (pExtendTrack
+                  && pExtendTrack->GetStartTime().FromTimezone(wxDateTime::GMT0).IsSameDate(first_time.FromTimezone(wxDateTime::GMT0))){
                         int begin = 1;
-                        if (pLastPoint->m_CreateTime == pExtendPoint->m_CreateTime) begin = 2;
-                        pSelect->DeleteAllSelectableTrackSegments(pExtendRoute);
-                        pExtendRoute->CloneTrack(this, begin, this->GetnPoints(), _T(""));
-                        pSelect->AddAllSelectableTrackSegments ( pExtendRoute );
+                        if (first_time == extend_time) begin = 2;
+                        pExtendTrack->ExtendTrack(this, begin, _T(""));
+                        pSelect->DeleteAllSelectableTrackSegments(pExtendTrack);
+                        pExtendTrack->AddSelectableTrackSegments();
                         pSelect->DeleteAllSelectableTrackSegments(this);
                         this->ClearHighlights();
                         return true;
@@ -2331,11 +2729,19 @@ bool Track::DoExtendDaily()
 
 void Track::FixMidnight(Track *pPreviousTrack)
 {
-      RoutePoint *pMidnightPoint = pPreviousTrack->GetLastPoint();
-      CloneAddedTrackPoint(m_pLastAddedPoint, pMidnightPoint);
-      m_prev_glat = pMidnightPoint->m_lat;
-      m_prev_glon = pMidnightPoint->m_lon;
-      m_prev_time = pMidnightPoint->m_CreateTime.FromUTC();
+      TrackPointStore *pprev = pPreviousTrack->GetTrackPoints();
+      int ilast = pprev->GetCount() - 1;
+      if ( ( ilast < 0 ) || ( GetnPoints() == 0 ) )
+            return;
+
+      //    The first fix of the new day takes the time of the last one of the old day
+      m_TrackPoints.SetTime ( GetnPoints() - 1, pprev->GetTime ( ilast ) );
+      if ( IsRealized() )
+            m_pLastAddedPoint->m_CreateTime = wxDateTime ( pprev->GetTime ( ilast ) );
+
+      m_prev_glat = pprev->GetLat ( ilast );
+      m_prev_glon = pprev->GetLon ( ilast );
+      m_prev_time = wxDateTime ( pprev->GetTime ( ilast ) ).FromUTC();
 }
 
 void Track::OnTimerTrack ( wxTimerEvent& event )
@@ -2359,7 +2765,10 @@ void Track::OnTimerTrack ( wxTimerEvent& event )
       else if ( ( GetnPoints() < 2 ) && (delta < m_DeltaDistance) && !g_bTrackDaily)  //continuously update track beginning point timestamp if no movement.
       {
             wxDateTime now = wxDateTime::Now();
-            pRoutePointList->GetFirst()->GetData()->m_CreateTime = now.ToUTC();
+            if ( IsRealized() )
+                  pRoutePointList->GetFirst()->GetData()->m_CreateTime = now.ToUTC();
+            if ( m_TrackPoints.GetCount() )
+                  m_TrackPoints.SetTime ( 0, now.ToUTC().GetTicks() );
       }
 
       m_TimerTrack.Start ( 1000, wxTIMER_CONTINUOUS );
@@ -2383,22 +2792,40 @@ void Track::AddPointNow(bool do_add_point)
         //imsg = now.FormatISODate()+now.FormatISOTime()+_T("Adding Point Now");
         //wxLogMessage(imsg);
 
-      RoutePoint *pTrackPoint = new RoutePoint ( gLat, gLon, wxString ( _T ( "empty" ) ), wxString ( _T ( "" ) ), GPX_EMPTY_STRING );
-      pTrackPoint->m_bShowName = false;
-      pTrackPoint->m_bIsVisible  = true;                    // pjotrc 2010.02.11
-      pTrackPoint->m_GPXTrkSegNo = 1;                       // pjotrc 2010.02.28
+      //    A plain fix goes to the point store only, unless the track
+      //    has already been realized for the properties dialog
+      if ( IsRealized() )
+      {
+            RoutePoint *pTrackPoint = new RoutePoint ( gLat, gLon, wxString ( _T ( "empty" ) ), wxString ( _T ( "" ) ), GPX_EMPTY_STRING );
+            pTrackPoint->m_bShowName = false;
+            pTrackPoint->m_bIsVisible  = true;                    // pjotrc 2010.02.11
+            pTrackPoint->m_GPXTrkSegNo = 1;                       // pjotrc 2010.02.28
+
+            pTrackPoint->m_CreateTime = now.ToUTC();
+
+            AddPoint ( pTrackPoint );
 
-      pTrackPoint->m_CreateTime = now.ToUTC();
+            //    This is a hack, need to undo the action of Route::AddPoint
+            pTrackPoint->m_bIsInRoute = false;
+            pTrackPoint->m_bIsInTrack = true;
+
+            if ( GetnPoints() > 1 )
+                  pSelect->AddSelectableTrackSegment ( m_prev_glat, m_prev_glon, gLat, gLon,
+                                                       m_prev_pTrackPoint, pTrackPoint, this );
 
-      AddPoint ( pTrackPoint );
+            //    Keep the point store current, if it was
+            if ( m_TrackPoints.GetCount() == GetnPoints() - 1 )
+                  AppendTrackPoint ( pTrackPoint );
 
-      //    This is a hack, need to undo the action of Route::AddPoint
-      pTrackPoint->m_bIsInRoute = false;
-      pTrackPoint->m_bIsInTrack = true;
+            m_prev_pTrackPoint = pTrackPoint;
+      }
+      else
+      {
+            AddFix ( gLat, gLon, now.ToUTC().GetTicks(), 1 );
 
-      if ( GetnPoints() > 1 )
-            pSelect->AddSelectableTrackSegment ( m_prev_glat, m_prev_glon, gLat, gLon,
-                                                 m_prev_pTrackPoint, pTrackPoint, this );
+            if ( GetnPoints() > 1 )
+                  pSelect->AddSelectableTrackSegment ( m_prev_glat, m_prev_glon, gLat, gLon, NULL, NULL, this );
+      }
 
       m_prev_glon = gLon;
       m_prev_glat = gLat;
@@ -2406,74 +2833,378 @@ void Track::AddPointNow(bool do_add_point)
       m_prev_time = now;
 }
 
+//    Track colours by point style, pjotrc 2010.02.26
+static int TrackPointStyle ( RoutePoint *prp )
+{
+      if ( prp->m_IconName == _T ( "empty" ) )
+            return TRACK_STYLE_DEFAULT;
+      else if ( prp->m_IconName.StartsWith ( _T ( "xmred" ) ) )
+            return TRACK_STYLE_RED;
+      else if ( prp->m_IconName.StartsWith ( _T ( "xmblue" ) ) )
+            return TRACK_STYLE_BLUE;
+      else if ( prp->m_IconName.StartsWith ( _T ( "xmgreen" ) ) )
+            return TRACK_STYLE_GREEN;
+
+      return TRACK_STYLE_DEFAULT;
+}
+
+void Track::AppendTrackPoint ( RoutePoint *prp )
+{
+      time_t t = 0;
+      if ( prp->m_CreateTime.IsValid() )
+            t = prp->m_CreateTime.GetTicks();
+
+      m_TrackPoints.Append ( prp->m_lat, prp->m_lon, t, prp->m_GPXTrkSegNo, TrackPointStyle ( prp ) );
+}
+
+//    Add a fix to an unrealized track.
+//    prp is given only for fixes carrying a mark, the track then holds on to it.
+void Track::AddFix ( double lat, double lon, time_t t, int segno, RoutePoint *prp )
+{
+      int style = TRACK_STYLE_DEFAULT;
+      if ( prp )
+      {
+            style = TrackPointStyle ( prp );
+            m_IconPoints.Add ( prp );
+            m_IconPointIndex.Add ( m_TrackPoints.GetCount() );
+      }
+
+      int n = m_TrackPoints.GetCount();
+      if ( n )
+            m_route_length += DistGreatCircle ( m_TrackPoints.GetLat ( n - 1 ), m_TrackPoints.GetLon ( n - 1 ), lat, lon );
+
+      m_TrackPoints.Append ( lat, lon, t, segno, style );
+      RBBox.Expand ( lon, lat );
+      m_nPoints++;
+}
+
+//    Give every fix its own RoutePoint, for the properties dialog and
+//    everything else that works on the RoutePoint list.
+//    From here on the list is the master copy, and the store follows it.
+void Track::RealizeTrackPoints ( void )
+{
+      if ( IsRealized() || ( m_TrackPoints.GetCount() == 0 ) )
+            return;
+
+      m_nPoints = 0;
+      m_route_length = 0.;
+      m_pLastAddedPoint = NULL;
+
+      unsigned int imark = 0;
+      int n = m_TrackPoints.GetCount();
+      for ( int i = 0 ; i < n ; i++ )
+      {
+            RoutePoint *prp;
+            if ( ( imark < m_IconPoints.GetCount() ) && ( m_IconPointIndex.Item ( imark ) == i ) )
+                  prp = ( RoutePoint * ) m_IconPoints.Item ( imark++ );
+            else
+            {
+                  prp = new RoutePoint ( m_TrackPoints.GetLat ( i ), m_TrackPoints.GetLon ( i ), wxString ( _T ( "empty" ) ), wxString ( _T ( "" ) ), GPX_EMPTY_STRING );
+                  prp->m_bShowName = false;
+                  prp->m_bIsVisible  = true;
+                  prp->m_GPXTrkSegNo = m_TrackPoints.GetSegNo ( i );
+                  prp->m_CreateTime = wxDateTime ( m_TrackPoints.GetTime ( i ) );
+            }
+
+            AddPoint ( prp, false );
+
+            //    This is a hack, need to undo the action of Route::AddPoint
+            prp->m_bIsInRoute = false;
+            prp->m_bIsInTrack = true;
+      }
+
+      m_IconPoints.Clear();
+      m_IconPointIndex.Clear();
+      m_prev_pTrackPoint = m_pLastAddedPoint;
+
+      //    Select items of an unrealized track carry no points
+      pSelect->DeleteAllSelectableTrackSegments ( this );
+      pSelect->AddAllSelectableTrackSegments ( this );
+}
+
+//    Append psource's fixes from the begin'th one, the way Route::CloneTrack() extends a track
+void Track::ExtendTrack ( Track *psource, int begin, wxString suffix )
+{
+      if ( IsRealized() || psource->IsRealized() || ( GetnPoints() == 0 ) )
+      {
+            RealizeTrackPoints();
+            psource->RealizeTrackPoints();
+            CloneTrack ( psource, begin, psource->GetnPoints(), suffix );
+            return;
+      }
+
+      if ( psource->m_bIsInLayer )
+            return;
+
+      m_RouteNameString = psource->m_RouteNameString + suffix;
+      m_RouteStartString = psource->m_RouteStartString;
+      m_RouteEndString = psource->m_RouteEndString;
+
+      int startTrkSegNo = m_TrackPoints.GetSegNo ( m_TrackPoints.GetCount() - 1 );
+
+      TrackPointStore &src = psource->m_TrackPoints;
+      unsigned int imark = 0;
+      for ( int i = begin - 1 ; i < src.GetCount() ; i++ )
+      {
+            int segment_shift = src.GetSegNo ( i );
+            if ( begin == 2 )
+                  segment_shift = src.GetSegNo ( i ) - 1;  // continue first segment if tracks share the first point
+
+            while ( ( imark < psource->m_IconPoints.GetCount() ) && ( psource->m_IconPointIndex.Item ( imark ) < i ) )
+                  imark++;
+
+            RoutePoint *ptargetpoint = NULL;
+            if ( ( imark < psource->m_IconPoints.GetCount() ) && ( psource->m_IconPointIndex.Item ( imark ) == i ) )
+            {
+                  RoutePoint *psourcepoint = ( RoutePoint * ) psource->m_IconPoints.Item ( imark );
+                  ptargetpoint = new RoutePoint ( psourcepoint->m_lat, psourcepoint->m_lon, psourcepoint->m_IconName, psourcepoint->GetName(), GPX_EMPTY_STRING, false );
+                  CloneAddedTrackPoint ( ptargetpoint, psourcepoint );
+                  ptargetpoint->m_GPXTrkSegNo = startTrkSegNo + segment_shift;
+            }
+
+            AddFix ( src.GetLat ( i ), src.GetLon ( i ), src.GetTime ( i ), startTrkSegNo + segment_shift, ptargetpoint );
+      }
+}
+
+void Track::AddSelectableTrackSegments ( void )
+{
+      if ( IsRealized() )
+      {
+            pSelect->AddAllSelectableTrackSegments ( this );
+            return;
+      }
+
+      for ( int i = 1 ; i < m_TrackPoints.GetCount() ; i++ )
+            pSelect->AddSelectableTrackSegment ( m_TrackPoints.GetLat ( i - 1 ), m_TrackPoints.GetLon ( i - 1 ),
+                                                 m_TrackPoints.GetLat ( i ), m_TrackPoints.GetLon ( i ), NULL, NULL, this );
+}
+
+//    Delete the marked fixes of an unrealized track, the way
+//    Routeman::DeleteTrack() deletes the points of a realized one
+void Track::DeleteIconPoints ( void )
+{
+      for ( unsigned int i = 0 ; i < m_IconPoints.GetCount() ; i++ )
+      {
+            RoutePoint *prp = ( RoutePoint * ) m_IconPoints.Item ( i );
+            prp->m_bIsInTrack = false;
+            if ( !prp->m_bKeepXRoute )
+            {
+                  pConfig->DeleteWayPoint ( prp );
+                  delete prp;
+            }
+      }
+
+      m_IconPoints.Clear();
+      m_IconPointIndex.Clear();
+}
+
+bool Track::IsSameTrack ( Track *ptrack )
+{
+      if ( m_bIsInLayer || ptrack->m_bIsInLayer )
+            return false;
+
+      TrackPointStore *pthis = GetTrackPoints();
+      TrackPointStore *pthat = ptrack->GetTrackPoints();
+
+      if ( ( pthis->GetCount() == 0 ) || ( pthis->GetCount() != pthat->GetCount() ) )
+            return false;
+
+      for ( int i = 0 ; i < pthis->GetCount() ; i++ )
+      {
+            if ( ( fabs ( pthis->GetLat ( i ) - pthat->GetLat ( i ) ) > 1.0e-6 ) || ( fabs ( pthis->GetLon ( i ) - pthat->GetLon ( i ) ) > 1.0e-6 ) )
+                  return false;
+      }
+
+      return true;                              // success, they are the same
+}
+
+wxDateTime Track::GetStartTime ( void )
+{
+      SyncTrackPoints();
+      if ( m_TrackPoints.GetCount() == 0 )
+            return wxInvalidDateTime;
+
+      return wxDateTime ( m_TrackPoints.GetTime ( 0 ) );
+}
+
+wxDateTime Track::GetEndTime ( void )
+{
+      SyncTrackPoints();
+      if ( m_TrackPoints.GetCount() == 0 )
+            return wxInvalidDateTime;
+
+      return wxDateTime ( m_TrackPoints.GetTime ( m_TrackPoints.GetCount() - 1 ) );
+}
+
+//    Bring the store in line with the RoutePoint list of a realized track.
+//    The points can be edited from the properties dialog, so each one is checked.
+void Track::SyncTrackPoints ( void )
+{
+      if ( !IsRealized() )
+            return;                                         // the store is the only copy
+
+      bool b_current = ( ( int ) pRoutePointList->GetCount() == m_TrackPoints.GetCount() );
+
+      int i = 0;
+      wxRoutePointListNode *node = pRoutePointList->GetFirst();
+      while ( node && b_current )
+      {
+            RoutePoint *prp = node->GetData();
+            TrackPointChunk *pchunk = m_TrackPoints.GetChunk ( i / TRACK_CHUNK_POINTS );
+            int j = i % TRACK_CHUNK_POINTS;
+
+            if ( ( pchunk->m_lat[j] != prp->m_lat ) || ( pchunk->m_lon[j] != prp->m_lon ) ||
+                 ( pchunk->m_segno[j] != prp->m_GPXTrkSegNo ) || ( pchunk->m_style[j] != TrackPointStyle ( prp ) ) )
+                  b_current = false;
+
+            i++;
+            node = node->GetNext();
+      }
+
+      if ( b_current )
+            return;
+
+      m_TrackPoints.Clear();
+
+      node = pRoutePointList->GetFirst();
+      while ( node )
+      {
+            AppendTrackPoint ( node->GetData() );
+            node = node->GetNext();
+      }
+}
 
 void Track::Draw ( wxDC& dc, ViewPort &VP )
 {
       if ( !IsVisible() || GetnPoints() == 0 )
             return;
 
-      if (m_bRunning) {                                       // pjotrc 2010.02.26
-            dc.SetBrush ( wxBrush ( GetGlobalColor ( _T ( "URED" ) ) ) );
-            wxPen dPen ( GetGlobalColor ( _T ( "URED" ) ), 3 ) ;
-            dc.SetPen ( dPen );
-      } else {
-            dc.SetBrush ( wxBrush ( GetGlobalColor ( _T ( "CHMGD" ) ) ) );
-            wxPen dPen ( GetGlobalColor ( _T ( "CHMGD" ) ), 3 ) ;
-            dc.SetPen ( dPen );
-      }
+      SyncTrackPoints();
 
       double radius_meters = 20;//Current_Ch->GetNativeScale() * .0015;         // 1.5 mm at original scale
       double radius = radius_meters * VP.view_scale_ppm;
 
-      unsigned short int FromSegNo = 1;
+      //    Track colours by point style, pjotrc 2010.02.26
+      wxColour style_colour[4];
+      style_colour[TRACK_STYLE_DEFAULT] = GetGlobalColor ( _T ( "CHMGD" ) );
+      style_colour[TRACK_STYLE_RED] = GetGlobalColor ( _T ( "URED" ) );
+      style_colour[TRACK_STYLE_BLUE] = GetGlobalColor ( _T ( "BLUE3" ) );
+      style_colour[TRACK_STYLE_GREEN] = GetGlobalColor ( _T ( "UGREN" ) );
 
-      wxPoint rpt, rptn;
-      DrawPointWhich ( dc, 1, &rpt );
+      int current_style = -1;
 
-      wxRoutePointListNode *node = pRoutePointList->GetFirst();
-      node = node->GetNext();
+      //    Chunks are culled against the viewport, unless it wraps the date line
+      LLBBox &vpbox = VP.GetBBox();
+      bool b_cull = ( vpbox.GetMinX() >= -180. ) && ( vpbox.GetMaxX() <= 180. );
 
-      while ( node )
+      //    Coarsest level of detail whose tolerance stays below TRACK_DRAW_MIN_PIX, -1 for every fix
+      double tol_meters = TRACK_DRAW_MIN_PIX / VP.view_scale_ppm;
+      int lod_level = -1;
+      double lod_tol = TRACK_LOD_BASE_TOL;
+      while ( ( lod_level < TRACK_LOD_LEVELS - 1 ) && ( lod_tol <= tol_meters ) )
       {
-            RoutePoint *prp = node->GetData();
-            unsigned short int ToSegNo = prp->m_GPXTrkSegNo;
-
-            if (m_bRunning || prp->m_IconName.StartsWith(_T("xmred"))){              // pjotrc 2010.02.26
-                  dc.SetBrush ( wxBrush ( GetGlobalColor ( _T ( "URED" ) ) ) );
-                  wxPen dPen ( GetGlobalColor ( _T ( "URED" ) ), 3 ) ;
-                  dc.SetPen ( dPen );
-            } else
-                  if (prp->m_IconName.StartsWith(_T("xmblue"))){                     // pjotrc 2010.02.26
-                        dc.SetBrush ( wxBrush ( GetGlobalColor ( _T ( "BLUE3" ) ) ) );
-                        wxPen dPen ( GetGlobalColor ( _T ( "BLUE3" ) ), 3 ) ;
-                        dc.SetPen ( dPen );
-                  } else
-                        if (prp->m_IconName.StartsWith(_T("xmgreen"))){               // pjotrc 2010.02.26
-                              dc.SetBrush ( wxBrush ( GetGlobalColor ( _T ( "UGREN" ) ) ) );
-                              wxPen dPen ( GetGlobalColor ( _T ( "UGREN" ) ), 3 ) ;
-                              dc.SetPen ( dPen );
-                        } else {                                                      // pjotrc 2010.03.02
-                              dc.SetBrush ( wxBrush ( GetGlobalColor ( _T ( "CHMGD" ) ) ) );
-                              wxPen dPen ( GetGlobalColor ( _T ( "CHMGD" ) ), 3 ) ;
-                              dc.SetPen ( dPen );
-                        }
+            lod_level++;
+            lod_tol *= TRACK_LOD_LEVEL_STEP;
+      }
+
+      wxPoint rpt, rptn;
+      bool b_have_prev = false;
+      int FromSegNo = 0;                                          // pjotrc 2010.02.27
+
+      int nchunks = m_TrackPoints.GetChunkCount();
+      for ( int ic = 0 ; ic < nchunks ; ic++ )
+      {
+            TrackPointChunk *pchunk = m_TrackPoints.GetChunk ( ic );
 
-            prp->Draw ( dc, &rptn );
+            if ( b_cull && ( vpbox.Intersect ( pchunk->m_bbox, 0 ) == _OUT ) )
+            {
+                  b_have_prev = false;
+                  continue;
+            }
 
-            if (ToSegNo == FromSegNo)                                        // pjotrc 2010.02.27
-                  RenderSegment ( dc, rpt.x, rpt.y, rptn.x, rptn.y, VP, false, ( int ) radius );      // no arrows, with hilite
+            //    Pick up the segment leading into this chunk
+            if ( !b_have_prev && ( ic > 0 ) )
+            {
+                  TrackPointChunk *pprev = m_TrackPoints.GetChunk ( ic - 1 );
+                  int jprev = pprev->m_nPoints - 1;
+                  cc1->GetCanvasPointPix ( pprev->m_lat[jprev], pprev->m_lon[jprev], &rpt );
+                  FromSegNo = pprev->m_segno[jprev];
+                  b_have_prev = true;
+            }
 
-            rpt = rptn;
+            int npts = pchunk->m_nPoints;
+            unsigned short *plod = NULL;
+            if ( lod_level >= 0 )
+            {
+                  if ( !pchunk->IsLODValid() )
+                        pchunk->BuildLOD();
+                  npts = pchunk->GetLODCount ( lod_level );
+                  plod = pchunk->GetLODIndex ( lod_level );
+            }
 
-            node = node->GetNext();
-            FromSegNo = ToSegNo;                                  // pjotrc 2010.02.27
+            int jend = pchunk->m_nPoints - 1;
+            for ( int ip = 0 ; ip < npts ; ip++ )
+            {
+                  int j = plod ? plod[ip] : ip;
+
+                  cc1->GetCanvasPointPix ( pchunk->m_lat[j], pchunk->m_lon[j], &rptn );
+                  int ToSegNo = pchunk->m_segno[j];
+
+                  if ( b_have_prev && ( ToSegNo == FromSegNo ) )
+                  {
+                        //    At small scales many fixes land on the same pixels,
+                        //    so skip those closer than TRACK_DRAW_MIN_PIX to the last one drawn.
+                        //    The final fix is always drawn, to meet the running segment.
+                        if ( ( abs ( rptn.x - rpt.x ) < TRACK_DRAW_MIN_PIX ) && ( abs ( rptn.y - rpt.y ) < TRACK_DRAW_MIN_PIX ) &&
+                             !( ( ic == nchunks - 1 ) && ( j == jend ) ) )
+                              continue;
+
+                        int style = m_bRunning ? TRACK_STYLE_RED : pchunk->m_style[j];
+                        if ( style != current_style )
+                        {
+                              dc.SetBrush ( wxBrush ( style_colour[style] ) );
+                              wxPen dPen ( style_colour[style], 3 ) ;
+                              dc.SetPen ( dPen );
+                              current_style = style;
+                        }
+
+                        RenderSegment ( dc, rpt.x, rpt.y, rptn.x, rptn.y, VP, false, ( int ) radius );      // no arrows, with hilite
+                  }
+
+                  rpt = rptn;
+                  FromSegNo = ToSegNo;
+                  b_have_prev = true;
+            }
+      }
 
+      //    Draw the track's own points, which skip themselves unless they carry a visible icon
+      if ( IsRealized() )
+      {
+            wxRoutePointListNode *node = pRoutePointList->GetFirst();
+            while ( node )
+            {
+                  node->GetData()->Draw ( dc );
+                  node = node->GetNext();
+            }
+      }
+      else
+      {
+            for ( unsigned int i = 0 ; i < m_IconPoints.GetCount() ; i++ )
+                  ( ( RoutePoint * ) m_IconPoints.Item ( i ) )->Draw ( dc );
       }
 
       //    Draw last segment, dynamically, maybe.....
 
       if ( m_bRunning )
       {
+            TrackPointChunk *plast = m_TrackPoints.GetChunk ( nchunks - 1 );
+            int jlast = plast->m_nPoints - 1;
+            cc1->GetCanvasPointPix ( plast->m_lat[jlast], plast->m_lon[jlast], &rpt );
+
+            dc.SetBrush ( wxBrush ( style_colour[TRACK_STYLE_RED] ) );
+            wxPen dPen ( style_colour[TRACK_STYLE_RED], 3 ) ;
+            dc.SetPen ( dPen );
+
             wxPoint r;
             cc1->GetCanvasPointPix ( gLat, gLon, &r );
             RenderSegment ( dc, rpt.x, rpt.y, r.x, r.y, VP, false, ( int ) radius );      // no arrows, with hilite
@@ -2485,15 +3216,13 @@ Route *Track::RouteFromTrack(wxProgressDialog *pprog)
 
       Route *route = new Route();
       RoutePoint *pWP_src = NULL;
-      wxRoutePointListNode *prpnode = pRoutePointList->GetFirst();
-      int ic = 0;
-      int nPoints = pRoutePointList->GetCount();
 
-      while ( prpnode )
-      {
-            RoutePoint *prp = prpnode->GetData();
+      SyncTrackPoints();
+      int nPoints = m_TrackPoints.GetCount();
 
-            RoutePoint *pWP_dst = new RoutePoint ( prp->m_lat, prp->m_lon,  _T ( "xmblue" ) , _T ( "" ) , GPX_EMPTY_STRING );
+      for ( int ic = 0 ; ic < nPoints ; ic++ )
+      {
+            RoutePoint *pWP_dst = new RoutePoint ( m_TrackPoints.GetLat ( ic ), m_TrackPoints.GetLon ( ic ),  _T ( "xmblue" ) , _T ( "" ) , GPX_EMPTY_STRING );
             route->AddPoint(pWP_dst);
 
             pWP_dst->m_bShowName = false;
@@ -2504,11 +3233,8 @@ Route *Track::RouteFromTrack(wxProgressDialog *pprog)
                   pSelect->AddSelectableRouteSegment ( pWP_src->m_lat, pWP_src->m_lon, pWP_dst->m_lat, pWP_dst->m_lon, pWP_src, pWP_dst, route );
             pWP_src = pWP_dst;
 
-            prpnode = prpnode->GetNext(); //RoutePoint
-
-            ic++;
             if(pprog)
-                pprog->Update((ic * 100) /nPoints);
+                pprog->Update(((ic + 1) * 100) /nPoints);
       }
 
       route->m_RouteNameString = m_RouteNameString;
@@ -2605,6 +3331,9 @@ int MyConfig::LoadMyConfig ( int iteration )
       }
 
       Read ( _T ( "nCacheLimit" ), &g_nCacheLimit, CACHE_N_LIMIT_DEFAULT );
+      Read ( _T ( "CacheMemoryLimitMB" ), &g_nCacheMemLimitMB, CACHE_MEM_LIMIT_DEFAULT );
+      Read ( _T ( "SENCBuildThreads" ), &g_nSENCBuildThreads, -1 );   // 0 = build SENC on first open only, -1 = auto
+      Read ( _T ( "S57TileCacheMB" ), &g_nS57TileCacheMB, S57_TILE_CACHE_MB_DEFAULT );   // 0 = no tile cache
       Read ( _T ( "DebugGDAL" ), &g_bGDAL_Debug, 0 );
       Read ( _T ( "DebugNMEA" ), &g_nNMEADebug, 0 );
       Read ( _T ( "GPSDogTimeout" ),  &gps_watchdog_timeout_ticks, GPS_TIMEOUT_SECONDS );
@@ -3630,7 +4359,7 @@ bool MyConfig::UpdateRoute ( Route *pr )
       {
             if (!m_bIsImporting)
             {
-                  GpxTrkElement * trk = ::CreateGPXTrk( pr );
+                  GpxTrkElement * trk = ::CreateGPXTrk( pr, false );
                   trk->SetSimpleExtension(wxString(_T("opencpn:action")), wxString(_T("update")));
                   GpxRootElement * rt = (GpxRootElement *) m_pNavObjectChangesSet->RootElement();
                   rt->AddTrack(trk);
@@ -3684,7 +4413,7 @@ bool MyConfig::DeleteConfigRoute ( Route *pr )
             }
             else
             {
-                  GpxTrkElement * trk = ::CreateGPXTrk( pr );
+                  GpxTrkElement * trk = ::CreateGPXTrk( pr, false );
                   trk->SetSimpleExtension(wxString(_T("opencpn:action")), wxString(_T("delete")));
                   GpxRootElement * rt = (GpxRootElement *) m_pNavObjectChangesSet->RootElement();
                   rt->AddTrack(trk);
@@ -4356,7 +5085,7 @@ GpxRteElement *CreateGPXRte ( Route *pRoute )
       return rte;
 }
 
-GpxTrkElement *CreateGPXTrk ( Route *pRoute )
+GpxTrkElement *CreateGPXTrk ( Route *pRoute, bool b_points )
 {
       GpxExtensionsElement *exts = new GpxExtensionsElement();
       exts->LinkEndChild(new GpxSimpleElement(wxString(_T("opencpn:start")), pRoute->m_RouteStartString));
@@ -4366,6 +5095,44 @@ GpxTrkElement *CreateGPXTrk ( Route *pRoute )
 
       GpxTrkElement *trk = new GpxTrkElement(pRoute->m_RouteNameString, GPX_EMPTY_STRING, GPX_EMPTY_STRING, GPX_EMPTY_STRING, NULL, -1, GPX_EMPTY_STRING, exts, NULL);
 
+      //    Change set entries only need to identify the track
+      if ( !b_points )
+            return trk;
+
+      //    An unrealized track writes its plain fixes as bare trkpts
+      Track *ptrack = ( Track * ) pRoute;
+      if ( !ptrack->IsRealized() )
+      {
+            TrackPointStore *pstore = ptrack->GetTrackPoints();
+            wxArrayPtrVoid *picons = ptrack->GetIconPoints();
+            wxArrayInt *pindex = ptrack->GetIconPointIndex();
+            unsigned int imark = 0;
+
+            GpxTrksegElement *trkseg = NULL;
+            int segno = -1;
+            for ( int i = 0 ; i < pstore->GetCount() ; i++ )
+            {
+                  if ( !trkseg || ( pstore->GetSegNo ( i ) != segno ) )
+                  {
+                        trkseg = new GpxTrksegElement();
+                        trk->AppendTrkSegment(trkseg);
+                        segno = pstore->GetSegNo ( i );
+                  }
+
+                  if ( ( imark < picons->GetCount() ) && ( pindex->Item ( imark ) == i ) )
+                        trkseg->AppendTrkPoint(::CreateGPXWpt ( ( RoutePoint * ) picons->Item ( imark++ ), GPX_WPT_TRACKPOINT, true));
+                  else
+                  {
+                        wxDateTime dt ( pstore->GetTime ( i ) );
+                        trkseg->AppendTrkPoint(new GpxWptElement(GPX_WPT_TRACKPOINT, pstore->GetLat ( i ), pstore->GetLon ( i ),
+                              0, &dt, 0, -1, GPX_EMPTY_STRING, GPX_EMPTY_STRING, GPX_EMPTY_STRING, GPX_EMPTY_STRING, NULL,
+                              GPX_EMPTY_STRING, GPX_EMPTY_STRING, fix_undefined, -1, -1, -1, -1, -1, -1, NULL));
+                  }
+            }
+
+            return trk;
+      }
+
       RoutePointList *pRoutePointList = pRoute->pRoutePointList;
       wxRoutePointListNode *node2 = pRoutePointList->GetFirst();
       RoutePoint *prp;
@@ -5384,11 +6151,51 @@ void GPXLoadTrack ( GpxTrkElement* trknode, bool b_fullviz )
                               wxString tpChildName = wxString::FromUTF8(tpchild->Value());
                               if(tpChildName == _T("trkpt"))
                               {
+                                    //    Bare fixes, as written for unrealized tracks, go straight to the point store
+                                    TiXmlNode *fchild = tpchild->FirstChild();
+                                    TiXmlNode *time_child = NULL;
+                                    if( fchild && ( fchild->NextSibling() == NULL ) && ( wxString::FromUTF8(fchild->Value()) == _T("time") ) )
+                                          time_child = fchild;
+
+                                    if( ( fchild == NULL ) || time_child )
+                                    {
+                                          double rlat = 0., rlon = 0.;
+                                          wxString::FromUTF8 ( ((TiXmlElement *)tpchild)->Attribute( "lat" ) ).ToDouble ( &rlat );
+                                          wxString::FromUTF8 ( ((TiXmlElement *)tpchild)->Attribute( "lon" ) ).ToDouble ( &rlon );
+                                          if ( rlon < -180. )
+                                                rlon += 360.;
+                                          else if ( rlon > 180. )
+                                                rlon -= 360.;
+
+                                          wxDateTime dt = wxDateTime::Now().ToUTC();
+                                          TiXmlNode *child1 = time_child ? time_child->FirstChild() : NULL;
+                                          if ( child1 != NULL )
+                                          {
+                                                wxString TimeString = wxString::FromUTF8( child1->ToText()->Value() );
+                                                if ( TimeString.Len() )
+                                                      ParseGPXDateTime(dt, TimeString);
+                                          }
+
+                                          pTentTrack->AddFix ( rlat, rlon, dt.GetTicks(), GPXSeg );
+                                          continue;
+                                    }
+
                                     pWp = ::LoadGPXWaypoint ( (GpxWptElement *)tpchild, _T("empty"), false/*b_fullviz*/ );
-						pTentTrack->AddPoint ( pWp, false );
+
+                                    //    Older files carry the full waypoint for every fix, only marked ones are kept
+                                    if ( ( pWp->m_IconName == _T("empty") ) && pWp->GetName().IsEmpty() &&
+                                         pWp->m_MarkDescription.IsEmpty() && pWp->m_HyperlinkList->IsEmpty() )
+                                    {
+                                          pTentTrack->AddFix ( pWp->m_lat, pWp->m_lon, pWp->m_CreateTime.GetTicks(), GPXSeg );
+                                          delete pWp;
+                                          pWp = NULL;
+                                          continue;
+                                    }
+
                                     pWp->m_bIsInRoute = false;                      // Hack
                                     pWp->m_bIsInTrack = true;
                                     pWp->m_GPXTrkSegNo = GPXSeg;
+                                    pTentTrack->AddFix ( pWp->m_lat, pWp->m_lon, pWp->m_CreateTime.GetTicks(), GPXSeg, pWp );
                                     pWayPointMan->m_pWayPointList->Append ( pWp );
                                }
                         }
@@ -5449,13 +6256,10 @@ void GPXLoadTrack ( GpxTrkElement* trknode, bool b_fullviz )
             {
                   Route *proute = route_node->GetData();
 
-                  if ( proute->IsEqualTo ( pTentTrack ) )
+                  if ( proute->m_bIsTrack && ((Track *)proute)->IsSameTrack ( pTentTrack ) )
                   {
-                        if(proute->m_bIsTrack)
-                        {
-                              bAddtrack = false;
-                              break;
-                        }
+                        bAddtrack = false;
+                        break;
                   }
                   route_node = route_node->GetNext();                         // next route
             }
@@ -5471,11 +6275,10 @@ void GPXLoadTrack ( GpxTrkElement* trknode, bool b_fullviz )
                   if (::RouteExists(pTentTrack->m_GUID)) { //We are importing a different route with the same guid, so let's generate it a new guid
                         pTentTrack->m_GUID = pWayPointMan->CreateGUID ( NULL );
                         //Now also change guids for the routepoints
-                        wxRoutePointListNode *pthisnode = ( pTentTrack->pRoutePointList )->GetFirst();
-                        while ( pthisnode )
+                        wxArrayPtrVoid *picons = pTentTrack->GetIconPoints();
+                        for ( unsigned int i = 0 ; i < picons->GetCount() ; i++ )
                         {
-                              pthisnode->GetData()->m_GUID = pWayPointMan->CreateGUID ( NULL );
-                              pthisnode = pthisnode->GetNext();
+                              ( ( RoutePoint * ) picons->Item ( i ) )->m_GUID = pWayPointMan->CreateGUID ( NULL );
                               //FIXME: !!!!!! the shared waypoint gets part of both the routes -> not  goood at all
                         }
                   }
@@ -5486,54 +6289,13 @@ void GPXLoadTrack ( GpxTrkElement* trknode, bool b_fullviz )
                   else if(b_fullviz)
                         pTentTrack->SetVisible();
 
-                  //    Add the selectable points and segments
-
-                  int ip = 0;
-                  float prev_rlat = 0., prev_rlon = 0.;
-                  RoutePoint *prev_pConfPoint = NULL;
-
-                  wxRoutePointListNode *node = pTentTrack->pRoutePointList->GetFirst();
-                  while ( node )
-                  {
-
-                        RoutePoint *prp = node->GetData();
-
-                        if ( ip )
-                              pSelect->AddSelectableTrackSegment ( prev_rlat, prev_rlon, prp->m_lat, prp->m_lon,prev_pConfPoint, prp, pTentTrack );
-
-                        prev_rlat = prp->m_lat;
-                        prev_rlon = prp->m_lon;
-                        prev_pConfPoint = prp;
-
-                        ip++;
-
-                        node = node->GetNext();
-                  }
+                  //    Add the selectable segments
+                  pTentTrack->AddSelectableTrackSegments();
             }
             else
             {
-
-                  // walk the route, deleting points used only by this route
-                  wxRoutePointListNode *pnode = ( pTentTrack->pRoutePointList )->GetFirst();
-                  while ( pnode )
-                  {
-                        RoutePoint *prp = pnode->GetData();
-
-                        // check all other routes to see if this point appears in any other route
-                        Route *pcontainer_route = g_pRouteMan->FindRouteContainingWaypoint ( prp );
-
-                        if ( pcontainer_route == NULL )
-                        {
-                              prp->m_bIsInRoute = false;          // Take this point out of this (and only) track/route
-                              if ( !prp->m_bKeepXRoute )
-                              {
-                                    pConfig->DeleteWayPoint ( prp );
-                                    delete prp;
-                              }
-                        }
-
-                        pnode = pnode->GetNext();
-                  }
+                  // delete the marked points, which no other route can hold
+                  pTentTrack->DeleteIconPoints();
 
                   delete pTentTrack;
             }
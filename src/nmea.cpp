@@ -97,6 +97,7 @@ const wxEventType wxEVT_OCPN_NMEA = wxNewEventType();
 OCPN_NMEAEvent::OCPN_NMEAEvent( wxEventType commandType, int id )
       :wxEvent(id, commandType)
 {
+      m_pRing = NULL;
 }
 
 
@@ -104,6 +105,17 @@ OCPN_NMEAEvent::OCPN_NMEAEvent( wxEventType commandType, int id )
 
 OCPN_NMEAEvent::~OCPN_NMEAEvent( )
 {
+      if(m_pRing)
+            m_pRing->Unref();
+}
+
+void OCPN_NMEAEvent::SetRing(OCP_SerialRing *pRing)
+{
+      if(pRing)
+            pRing->Ref();
+      if(m_pRing)
+            m_pRing->Unref();
+      m_pRing = pRing;
 }
 
 wxEvent* OCPN_NMEAEvent::Clone() const
@@ -1657,6 +1669,8 @@ OCP_NMEA_Thread::OCP_NMEA_Thread(NMEAHandler *Launcher, wxWindow *MessageTarget,
       put_ptr = rx_buffer;                            // local circular queue
       tak_ptr = rx_buffer;
 
+      m_pRing = new OCP_SerialRing;                   // delivery to the GUI thread
+
       m_pShareMutex = pMutex;                         // IPC buffer
       rx_share_buffer_state = RX_BUFFER_EMPTY;
 
@@ -1677,6 +1691,8 @@ OCP_NMEA_Thread::~OCP_NMEA_Thread(void)
 {
       delete[] rx_buffer;
       delete[] temp_buf;
+
+      m_pRing->Unref();                               // pending events may still hold it
 }
 
 void OCP_NMEA_Thread::OnExit(void)
@@ -1695,7 +1711,6 @@ void *OCP_NMEA_Thread::Entry()
       m_launcher->SetSecThreadActive();               // I am alive
 
       bool not_done = true;
-      bool nl_found;
       wxString msg;
 
 
@@ -1747,21 +1762,25 @@ void *OCP_NMEA_Thread::Entry()
 
         }
 
-      //    Blocking, timeout protected read of one character at a time
-      //    Timeout value is set by c_cc[VTIME]
-      //    Storing incoming characters in circular buffer
-      //    And watching for new line character
-      //     On new line character, send notification to parent
+      //    Wait for input with select(), then read whatever is available in one block
+      //    Incoming characters go to the ring, and the GUI thread is notified
+      //    once for however many sentences are completed
 
-            char next_byte = 0;
-            ssize_t newdata;
-            newdata = read(m_gps_fd, &next_byte, 1);            // read of one char
-                                                                  // return (-1) if no data available, timeout
+            char read_buf[SERIAL_READ_CHUNK];
+            ssize_t newdata = 0;
 
-      #ifdef __WXOSX__
-            if (newdata < 0 )
-                  wxThread::Sleep(100) ;
-      #endif
+            fd_set rfds;
+            struct timeval tv;
+
+            FD_ZERO(&rfds);
+            FD_SET(m_gps_fd, &rfds);
+            tv.tv_sec = 1;                                      // Wait up to 1 second
+            tv.tv_usec = 0;
+
+            int retval = select(m_gps_fd + 1, &rfds, NULL, NULL, &tv);
+            if((retval > 0) && FD_ISSET(m_gps_fd, &rfds))
+                  newdata = read(m_gps_fd, read_buf, sizeof(read_buf));
+                                                                  // return (-1) or 0 if no data available
 
 
       // Fulup patch for handling hot-plug or wakeup events
@@ -1777,7 +1796,9 @@ void *OCP_NMEA_Thread::Entry()
                   else
                   {
             // no need to retry every 1ms when on error
-                        sleep (1);
+            // a select() timeout has already waited
+                        if (retval != 0)
+                              sleep (1);
 
             // if we have more no character for 5 second then try to reopen the port
                         if (maxErrorLoop++ > 5)
@@ -1809,65 +1830,10 @@ void *OCP_NMEA_Thread::Entry()
             } // end Fulup hack
 
 
-            //  And process any character
+            //  And process any characters
 
             if(newdata > 0)
-            {
-      //              printf("%c", next_byte);
-
-                  nl_found = false;
-
-                  *put_ptr++ = next_byte;
-                  if((put_ptr - rx_buffer) > RX_BUFFER_SIZE)
-                  put_ptr = rx_buffer;
-
-                  if(0x0a == next_byte)
-                  nl_found = true;
-
-
-      //    Found a NL char, thus end of message?
-                  if(nl_found)
-                  {
-                  char *tptr;
-                  char *ptmpbuf;
-
-
-      //    Copy the message into a temporary _buffer
-
-                  tptr = tak_ptr;
-                  ptmpbuf = temp_buf;
-
-                  while((*tptr != 0x0a) && (tptr != put_ptr))
-                  {
-                        *ptmpbuf++ = *tptr++;
-
-                        if((tptr - rx_buffer) > RX_BUFFER_SIZE)
-                        tptr = rx_buffer;
-
-                        wxASSERT_MSG((ptmpbuf - temp_buf) < RX_BUFFER_SIZE, (const wxChar *)"temp_buf overrun1");
-
-                  }
-
-                  if((*tptr == 0x0a) && (tptr != put_ptr))    // well formed sentence
-                  {
-                        *ptmpbuf++ = *tptr++;
-                        if((tptr - rx_buffer) > RX_BUFFER_SIZE)
-                        tptr = rx_buffer;
-
-                        wxASSERT_MSG((ptmpbuf - temp_buf) < RX_BUFFER_SIZE, (const wxChar *)"temp_buf overrun2");
-
-                        *ptmpbuf = 0;
-
-                        tak_ptr = tptr;
-
-      //    Message is ready to parse and send out
-                        wxString str_temp_buf(temp_buf, wxConvUTF8);
-                        Parse_And_Send_Posn(str_temp_buf);
-                  }
-
-                  }                   //if nl
-            }                       // if newdata > 0
-      //              ThreadMessage(_T("Timeout 1"));
+                  HandleRead(read_buf, newdata);
 
     }                          // the big while...
 
@@ -2385,6 +2351,17 @@ void OCP_NMEA_Thread::Parse_And_Send_Posn(wxString &str_temp_buf)
 }
 
 
+void OCP_NMEA_Thread::HandleRead(char *buf, int character_count)
+{
+      if(m_pRing->Put(buf, character_count))
+      {
+            OCPN_NMEAEvent Nevent(wxEVT_OCPN_NMEA, 0);
+            Nevent.SetRing(m_pRing);
+            m_pMainEventHandler->AddPendingEvent(Nevent);
+      }
+}
+
+
 void OCP_NMEA_Thread::ThreadMessage(const wxString &msg)
 {
 
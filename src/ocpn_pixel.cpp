@@ -117,6 +117,9 @@
 #include "wx/math.h"
 #include "wx/gdicmn.h"
 #include "wx/palette.h"
+#include "wx/thread.h"
+
+#include <string.h>
 
 
 // missing from mingw32 header
@@ -1546,4 +1549,126 @@ wxImage Image_Rotate(wxImage &base_image, double angle, const wxPoint & centre_o
 
 
 
+void ocpnFillPixelRect(unsigned char *pdest, int pitch, int width, int height, int depth,
+                       unsigned char r, unsigned char g, unsigned char b)
+{
+      if((width <= 0) || (height <= 0))
+            return;
+
+      //    Build the first row, then copy it down
+      if(depth == 24)
+            ocpnFillPixelRun24(pdest, r | (g << 8) | (b << 16), width);
+      else
+      {
+            int color_int = ( ( r ) << 16 ) + ( ( g ) << 8 ) + ( b );
+            int *p = (int *)pdest;
+            for(int j=0 ; j < width ; j++)
+                  *p++ = color_int;
+      }
+
+      int row_bytes = width * depth / 8;
+      for(int i=1 ; i < height ; i++)
+            memcpy(pdest + (i * pitch), pdest, row_bytes);
+}
+
+
+// ============================================================================
+// Render buffer pool
+// ============================================================================
+
+//    Stored immediately below each aligned buffer
+typedef struct
+{
+      void        *palloc;                // as returned by malloc()
+      size_t      capacity;
+} ocpnPixBufHeader;
+
+static unsigned char    *s_pixbuf_pool[OCPN_PIXBUF_POOL_MAX];
+static int              s_npixbuf_pool;
+static wxCriticalSection s_pixbuf_crit;
+
+static ocpnPixBufHeader *GetPixBufHeader(unsigned char *pbuf)
+{
+      return (ocpnPixBufHeader *)(pbuf - sizeof(ocpnPixBufHeader));
+}
+
+unsigned char *ocpnGetPixelBuffer(size_t size)
+{
+      {
+            wxCriticalSectionLocker lock(s_pixbuf_crit);
+
+            //    Best fit from the pool
+            int ibest = -1;
+            for(int i=0 ; i < s_npixbuf_pool ; i++)
+            {
+                  size_t cap = GetPixBufHeader(s_pixbuf_pool[i])->capacity;
+                  if((cap >= size) && ((ibest < 0) || (cap < GetPixBufHeader(s_pixbuf_pool[ibest])->capacity)))
+                        ibest = i;
+            }
+
+            if(ibest >= 0)
+            {
+                  unsigned char *pbuf = s_pixbuf_pool[ibest];
+                  s_pixbuf_pool[ibest] = s_pixbuf_pool[--s_npixbuf_pool];
+                  return pbuf;
+            }
+      }
+
+      //    Round up, so that slightly different canvas sizes can share buffers
+      size_t capacity = (size + 0xffff) & ~(size_t)0xffff;
+
+      void *palloc = malloc(capacity + OCPN_PIXBUF_ALIGN + sizeof(ocpnPixBufHeader));
+      if(NULL == palloc)
+            return NULL;
+
+      wxUIntPtr addr = (wxUIntPtr)palloc + sizeof(ocpnPixBufHeader);
+      addr = (addr + OCPN_PIXBUF_ALIGN - 1) & ~(wxUIntPtr)(OCPN_PIXBUF_ALIGN - 1);
+
+      unsigned char *pbuf = (unsigned char *)addr;
+      ocpnPixBufHeader *phdr = GetPixBufHeader(pbuf);
+      phdr->palloc = palloc;
+      phdr->capacity = capacity;
+
+      return pbuf;
+}
+
+void ocpnReleasePixelBuffer(unsigned char *pbuf)
+{
+      if(NULL == pbuf)
+            return;
+
+      wxCriticalSectionLocker lock(s_pixbuf_crit);
+
+      if(s_npixbuf_pool < OCPN_PIXBUF_POOL_MAX)
+      {
+            s_pixbuf_pool[s_npixbuf_pool++] = pbuf;
+            return;
+      }
+
+      //    Pool is full, so keep the larger buffers
+      int ismall = 0;
+      for(int i=1 ; i < s_npixbuf_pool ; i++)
+      {
+            if(GetPixBufHeader(s_pixbuf_pool[i])->capacity < GetPixBufHeader(s_pixbuf_pool[ismall])->capacity)
+                  ismall = i;
+      }
+
+      if(GetPixBufHeader(s_pixbuf_pool[ismall])->capacity < GetPixBufHeader(pbuf)->capacity)
+      {
+            unsigned char *pfree = s_pixbuf_pool[ismall];
+            s_pixbuf_pool[ismall] = pbuf;
+            pbuf = pfree;
+      }
 
+      free(GetPixBufHeader(pbuf)->palloc);
+}
+
+void ocpnFreePixelBufferPool(void)
+{
+      wxCriticalSectionLocker lock(s_pixbuf_crit);
+
+      for(int i=0 ; i < s_npixbuf_pool ; i++)
+            free(GetPixBufHeader(s_pixbuf_pool[i])->palloc);
+
+      s_npixbuf_pool = 0;
+}
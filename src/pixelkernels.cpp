@@ -0,0 +1,167 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenCPN
+ * Purpose:  Pixel kernels, with SSE2 versions
+ * Author:   David Register
+ *
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register   *
+ *   $EMAIL$   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ *
+ *
+ *
+ *
+ */
+
+#include "pixelkernels.h"
+
+#ifdef ocpnUSE_SSE2
+#include <emmintrin.h>
+#ifdef __GNUC__
+#include <cpuid.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+
+// ============================================================================
+// Raster scaling kernels
+//
+//    The _C versions are the reference implementations.
+//    The dispatching versions must produce identical results.
+// ============================================================================
+
+bool ocpnCPUHasSSE2(void)
+{
+#ifdef ocpnUSE_SSE2
+      static int s_has_sse2 = -1;
+
+      if(s_has_sse2 < 0)
+      {
+            unsigned int edx = 0;
+#ifdef _MSC_VER
+            int regs[4];
+            __cpuid(regs, 1);
+            edx = regs[3];
+#else
+            unsigned int eax, ebx, ecx;
+            if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+                  edx = 0;
+#endif
+            s_has_sse2 = (edx & (1 << 26)) ? 1 : 0;
+      }
+
+      return (s_has_sse2 == 1);
+#else
+      return false;
+#endif
+}
+
+
+void ocpnFillPixelRun24_C(unsigned char *pdest, int rgbval, int count)
+{
+      unsigned char r = rgbval & 0xff;
+      unsigned char g = (rgbval >> 8) & 0xff;
+      unsigned char b = (rgbval >> 16) & 0xff;
+
+      while(count-- > 0)
+      {
+            *pdest++ = r;
+            *pdest++ = g;
+            *pdest++ = b;
+      }
+}
+
+void ocpnFillPixelRun24(unsigned char *pdest, int rgbval, int count)
+{
+#ifdef ocpnUSE_SSE2
+      if((count >= 16) && ocpnCPUHasSSE2())
+      {
+            //    16 pixels make 48 bytes, three full registers
+            unsigned char pattern[48];
+            ocpnFillPixelRun24_C(pattern, rgbval, 16);
+
+            __m128i p0 = _mm_loadu_si128((const __m128i *)pattern);
+            __m128i p1 = _mm_loadu_si128((const __m128i *)(pattern + 16));
+            __m128i p2 = _mm_loadu_si128((const __m128i *)(pattern + 32));
+
+            while(count >= 16)
+            {
+                  _mm_storeu_si128((__m128i *)pdest, p0);
+                  _mm_storeu_si128((__m128i *)(pdest + 16), p1);
+                  _mm_storeu_si128((__m128i *)(pdest + 32), p2);
+                  pdest += 48;
+                  count -= 16;
+            }
+      }
+#endif
+
+      ocpnFillPixelRun24_C(pdest, rgbval, count);
+}
+
+
+void ocpnColumnSum8_C(const unsigned char *psrc, int row_bytes, int n_rows, int n_bytes, unsigned short *psum)
+{
+      for(int i=0 ; i < n_bytes ; i++)
+      {
+            unsigned int sum = 0;
+            const unsigned char *ps = psrc + i;
+            for(int r=0 ; r < n_rows ; r++)
+            {
+                  sum += *ps;
+                  ps += row_bytes;
+            }
+            psum[i] = sum;
+      }
+}
+
+void ocpnColumnSum8(const unsigned char *psrc, int row_bytes, int n_rows, int n_bytes, unsigned short *psum)
+{
+      int i = 0;
+
+#ifdef ocpnUSE_SSE2
+      if(ocpnCPUHasSSE2())
+      {
+            __m128i zero = _mm_setzero_si128();
+
+            for( ; i + 16 <= n_bytes ; i += 16)
+            {
+                  __m128i sum_lo = zero;
+                  __m128i sum_hi = zero;
+                  const unsigned char *ps = psrc + i;
+
+                  for(int r=0 ; r < n_rows ; r++)
+                  {
+                        __m128i v = _mm_loadu_si128((const __m128i *)ps);
+                        sum_lo = _mm_add_epi16(sum_lo, _mm_unpacklo_epi8(v, zero));
+                        sum_hi = _mm_add_epi16(sum_hi, _mm_unpackhi_epi8(v, zero));
+                        ps += row_bytes;
+                  }
+
+                  _mm_storeu_si128((__m128i *)(psum + i), sum_lo);
+                  _mm_storeu_si128((__m128i *)(psum + i + 8), sum_hi);
+            }
+      }
+#endif
+
+      ocpnColumnSum8_C(psrc + i, row_bytes, n_rows, n_bytes - i, psum + i);
+}
@@ -793,6 +793,11 @@ void Routeman::DeleteTrack(Route *pRoute)
             pSelect->DeleteAllSelectableTrackSegments(pRoute);
             pRouteList->DeleteObject(pRoute);
 
+            //    An unrealized track holds RoutePoints only for its marked fixes
+            pConfig->m_bIsImporting = true;
+            ((Track *)pRoute)->DeleteIconPoints();
+            pConfig->m_bIsImporting = false;
+
             // walk the route, tentatively deleting/marking points used only by this route
             wxRoutePointListNode *pnode = (pRoute->pRoutePointList)->GetFirst();
             while(pnode)
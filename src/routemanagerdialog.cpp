@@ -1329,9 +1329,9 @@ void RouteManagerDialog::UpdateTrkListCtrl()
             wxString name = trk->m_RouteNameString;
             if (name.IsEmpty())
             {
-                  RoutePoint *rp = trk->GetPoint(1);
-                  if (rp)
-                        name = rp->m_CreateTime.FormatISODate() + _T(" ") + rp->m_CreateTime.FormatISOTime();   //name = rp->m_CreateTime.Format();
+                  wxDateTime start_time = ((Track *)trk)->GetStartTime();
+                  if (start_time.IsValid())
+                        name = start_time.FormatISODate() + _T(" ") + start_time.FormatISOTime();   //name = rp->m_CreateTime.Format();
                   else
                         name = _("(Unnamed Track)");
             }
@@ -2138,7 +2138,7 @@ void RouteManagerDialog::ToggleLayerContentsNames (Layer *layer)
                   Route *pRoute = node1->GetData();
                   if ( pRoute->m_bIsInLayer && (pRoute->m_LayerID == layer->m_LayerID)) {
                         wxRoutePointListNode *node = pRoute->pRoutePointList->GetFirst();
-                        RoutePoint *prp1 = node->GetData();
+                        RoutePoint *prp1 = node ? node->GetData() : NULL;      // unrealized tracks have no list
                         while ( node )
                         {
                               prp1->m_bShowName = layer->HasVisibleNames();
@@ -406,14 +406,15 @@ void RouteProp::OnRoutepropExtendClick( wxCommandEvent& event )
             }
       } // end route extend
       else {  // start track extend
-            RoutePoint *pLastPoint = m_pRoute->GetPoint(1);
+            wxDateTime first_time = ((Track *)m_pRoute)->GetStartTime();
 
             if (IsThisTrackExtendable()) {
+                        Track *pExtendTrack = (Track *)m_pExtendRoute;
                         int begin = 1;
-                        if (pLastPoint->m_CreateTime == m_pExtendPoint->m_CreateTime) begin = 2;
+                        if (first_time == pExtendTrack->GetEndTime()) begin = 2;
+                        pExtendTrack->ExtendTrack((Track *)m_pRoute, begin, _("_plus"));
                         pSelect->DeleteAllSelectableTrackSegments(m_pExtendRoute);
-                        m_pExtendRoute->CloneTrack(m_pRoute, begin, m_pRoute->GetnPoints(), _("_plus"));
-                        pSelect->AddAllSelectableTrackSegments ( m_pExtendRoute );
+                        pExtendTrack->AddSelectableTrackSegments();
                         pSelect->DeleteAllSelectableTrackSegments(m_pRoute);
                         m_pRoute->ClearHighlights();
                         g_pRouteMan->DeleteTrack(m_pRoute);
@@ -487,16 +488,17 @@ bool RouteProp::IsThisTrackExtendable()
             m_pExtendPoint = NULL;
             if(m_pRoute == g_pActiveTrack || m_pRoute->m_bIsInLayer) return false;
 
-            RoutePoint *pLastPoint = m_pRoute->GetPoint(1);
+            wxDateTime first_time = ((Track *)m_pRoute)->GetStartTime();
+            wxDateTime extend_time;
 
             wxRouteListNode *route_node = pRouteList->GetFirst();
             while(route_node) {
                   Route *proute = route_node->GetData();
-                  if (proute->m_bIsTrack && proute->IsVisible() && (proute->m_GUID != m_pRoute->m_GUID)) {
-                        RoutePoint *track_node = proute->GetLastPoint();
-                              if(track_node->m_CreateTime <= pLastPoint->m_CreateTime)
-                                    if (!m_pExtendPoint || track_node->m_CreateTime > m_pExtendPoint->m_CreateTime) {
-                                          m_pExtendPoint = track_node;
+                  if (proute->m_bIsTrack && proute->IsVisible() && (proute->m_GUID != m_pRoute->m_GUID) && proute->GetnPoints()) {
+                        wxDateTime last_time = ((Track *)proute)->GetEndTime();
+                              if(last_time <= first_time)
+                                    if (!m_pExtendRoute || last_time > extend_time) {
+                                          extend_time = last_time;
                                           m_pExtendRoute = proute;
                                     }
                   }
@@ -838,6 +840,9 @@ void RouteProp::SetRouteAndUpdate(Route *pR)
             {
                   m_PlanSpeedLabel->SetLabel(_("Avg. speed (Kts)"));
                         m_PlanSpeedCtl->SetEditable(false);
+
+                  //    The dialog lists and edits every fix
+                  ((Track *)pR)->RealizeTrackPoints();
             }
             else
             {
@@ -147,6 +147,10 @@ s52plib::s52plib ( const wxString& PLib )
       pointPaperLUPArray = NULL;      // points: PAPER_CHART
       condSymbolLUPArray = NULL;      // Dynamic Conditional Symbology
 
+      for ( int i = 0 ; i < LUPNAME_NUM ; i++ )
+            m_pLUPIndex[i] = NULL;
+      m_pCSLUPHash = NULL;
+
       m_bOK = !(S52_load_Plib ( PLib ) == 0);
 
       m_bShowS57Text = false;
@@ -164,8 +168,10 @@ s52plib::s52plib ( const wxString& PLib )
 
       UpdateMarinerParams();
 
-      ledge = new int[2000];
-      redge = new int[2000];
+      ledge = new int[PLIB_EDGE_ARRAY_SIZE];
+      redge = new int[PLIB_EDGE_ARRAY_SIZE];
+
+      m_pAreaFillList = NULL;
 
       //    Defaults
       m_VersionMajor = 3;
@@ -627,262 +633,241 @@ extern Cond condTable[];
 
 
 
-// get LUP with "best" Object attribute match
-LUPrec *s52plib::FindBestLUP ( wxArrayPtrVoid *nameMatch, char *objAtt,
-                               wxArrayOfS57attVal *objAttVal, bool bStrict )
+//-----------------------------------------------------------------------------
+//    LUP resolution index
+//-----------------------------------------------------------------------------
+
+S52AttcPredicate::S52AttcPredicate ( const wxString& attc )
 {
-      LUPrec *LUP = NULL;
-      int nATTMatch = 0;
-      int i = 0;
-      int   countATT = 0;
-//   double current_best_score = 0;
-      bool bmatch_found = false;
+      memset ( m_acronym, 0, sizeof ( m_acronym ) );
+      strncpy ( m_acronym, attc.Left ( 6 ).mb_str(), 6 );
 
+      wxString value ( attc.Mid ( 6 ) );
+      char ss[40];
+      strncpy ( ss, value.mb_str(), 39 );
+      ss[39] = 0;
 
-      // setup default to the first LUP
-      LUP = ( LUPrec* ) nameMatch->Item ( 0 );
+      // special case (i)
+      m_bAnyValue = ( attc.Mid ( 6,1 ) == _T ( " " ) );       // use any value
 
-      int nLUPCandidates = nameMatch->GetCount();
+      m_bIntValid = ( 1 == sscanf ( ss, "%d", &m_ival ) );
 
-      for ( i=0; i< nLUPCandidates; ++i )
-      {
-            LUPrec *LUPCandidate = NULL;
-            wxString *ATTC  = NULL;
-            countATT = 0;
-            char *currATT  = objAtt;
-            int   attIdx   = 0;
+      m_bRealValid = false;
+      if ( ( attc.Mid ( 6,1 ) != _T ( "?" ) ) && value.Len() )
+            m_bRealValid = ( 1 == sscanf ( ss, "%f", &m_fval ) );
 
-            LUPCandidate = ( LUPrec* ) nameMatch->Item ( i );
-            ATTC   = ( wxString* ) LUPCandidate->ATTC;
+      //    Strings must be exact match
+      wxCharBuffer sbuf = value.mb_str ( wxConvUTF8 );
+      const char *sv = sbuf.data() ? sbuf.data() : "";
+      m_pStrValue = ( char * ) malloc ( strlen ( sv ) + 1 );
+      strcpy ( m_pStrValue, sv );
+}
 
+S52AttcPredicate::~S52AttcPredicate()
+{
+      free ( m_pStrValue );
+}
 
-//      if (0 == strncmp(LUPtmp->OBCL, "BOYLAT", 6))
-//         int eert = 8;
+bool S52AttcPredicate::Match ( S57attVal *v )
+{
+      if ( m_bAnyValue )
+            return true;
 
+      switch ( v->valType )
+      {
+            case OGR_INT:           // S57 attribute type 'E' enumerated, 'I' integer
+            case OGR_INT_LST:       // S57 attribute type 'L', first element only
+                  return m_bIntValid && ( m_ival == * ( int* ) ( v->value ) );
 
-            if ( ATTC == NULL )
-                  continue;
+            case OGR_REAL:          // S57 attribute type'F' float, stored as double
+                  return m_bRealValid && ( m_fval == ( float ) * ( double* ) ( v->value ) );
 
-            if ( objAtt == NULL )
-                  return LUP;                    // att match
+            case OGR_STR:           // S57 attribute type'A' code string, 'S' free text
+                  return !strcmp ( m_pStrValue, ( char * ) v->value );
 
+            default:
+                  return false;
+      }
+}
 
-            for ( unsigned int iLUPAtt = 0 ; iLUPAtt < LUPCandidate->ATTCArray->GetCount() ; iLUPAtt++ )
-            {
+S52LUPCandidate::S52LUPCandidate ( LUPrec *pLUP )
+{
+      m_pLUP = pLUP;
 
-                  wxString LATTC = LUPCandidate->ATTCArray->Item ( iLUPAtt );
-                  wxString LATTValue(LATTC.Mid(6));
+      if ( pLUP->ATTCArray )
+      {
+            for ( unsigned int i = 0 ; i < pLUP->ATTCArray->GetCount() ; i++ )
+                  m_predicates.Add ( new S52AttcPredicate ( pLUP->ATTCArray->Item ( i ) ) );
+      }
+}
 
-                  // debug
-//                        char *lupatt = ( char * ) ( LATTC.mb_str() + 6);
-//                        int luprec = LUPCandidate->RCID;
+S52LUPCandidate::~S52LUPCandidate()
+{
+      for ( unsigned int i = 0 ; i < m_predicates.GetCount() ; i++ )
+            delete m_predicates.Item ( i );
+}
 
-                  while ( *currATT != '\0' )
-                  {
-                        if ( 0 == strncmp ( LATTC.mb_str(), currATT,6 ) )
-                        {
-                              //OK we have an attribute match
-                              //checking attribute value
-                              S57attVal *v;
-#define BOOL bool
-                              BOOL attValMatch = FALSE;
-
-                              // special case (i)
-                              if ( LATTC.Mid(6,1) == ' ' )  // use any value
-                                    attValMatch = TRUE;
-
-                              // special case (ii)
-                              //TODO  Find an ENC with "UNKNOWN" DRVAL1 or DRVAL2 and debug this code
-                              /*
-                                                                      if ( !strncmp ( LUPCandidate->OBCL, "DEPARE", 6 ) )
-                                                                      {
-                                                                              if ( LATTC[6] == '?' )  // match if value is unknown
-                                                                                      attValMatch = TRUE;
-                                                                      }
-                              */
-                              v = ( objAttVal->Item ( attIdx ) );
-
-
-                              switch ( v->valType )
-                              {
-                                    case OGR_INT:     // S57 attribute type 'E' enumerated, 'I' integer
-                                    {
-                                          int a;
-                                          char ss[40];
-                                          strncpy(ss, LATTValue.mb_str(), 39);
-                                          sscanf ( ss, "%d", &a );
-//                                          sscanf ( LATTC.mb_str() + 6, "%d", &a );
-                                          if ( a == * ( int* ) ( v->value ) )
-                                                attValMatch = TRUE;
-                                          break;
-                                    }
+S52LUPClassIndex::~S52LUPClassIndex()
+{
+      for ( unsigned int i = 0 ; i < m_candidates.GetCount() ; i++ )
+            delete m_candidates.Item ( i );
+}
 
-                                    case OGR_INT_LST:    // S57 attribute type 'L' list: comma separated integer
-                                    {
-                                          int a;
-                                          char ss[40];
-                                          strncpy(ss, LATTValue.mb_str(), 39);
-                                          char *s = &ss[0];
 
-//                                          char *s = ( char * ) ( LATTC.mb_str() + 6 );
-                                          int *b = ( int* ) v->value;
-                                          sscanf ( s, "%d", &a );
+//    Find the value of an attribute in an object's '\037' separated attribute list
+static S57attVal *FindObjAttVal ( const char *objAtt, wxArrayOfS57attVal *objAttVal, const char *acronym )
+{
+      const char *currATT = objAtt;
+      int attIdx = 0;
 
-                                          while ( *s != '\0' )
-                                          {
-                                                if ( a == *b )
-                                                {
-                                                      sscanf ( ++s, "%d", &a );
-                                                      b++;
-                                                      attValMatch = TRUE;
-
-                                                }
-                                                else
-                                                      attValMatch = FALSE;
-                                          }
-                                          break;
-                                    }
-                                    case OGR_REAL:               // S57 attribute type'F' float
-                                    {
-                                          float a;
-                                          if ( LATTC.Mid(6,1) != '?' )
-                                          {
-                                                if(LATTValue.Len())
-                                                {
-                                                    char ss[40];
-                                                    strncpy(ss, LATTValue.mb_str(), 39);
-                                                    sscanf ( ss, "%f", &a );
-//                                                sscanf ( LATTC.mb_str() + 6, "%f", &a );
-                                                    if ( a == * ( float* ) ( v->value ) )
-                                                      attValMatch = TRUE;
-                                                }
-                                          }
-                                          break;
-                                    }
+      while ( *currATT != '\0' )
+      {
+            if ( 0 == strncmp ( acronym, currATT, 6 ) )
+                  return objAttVal->Item ( attIdx );
 
-                                    case OGR_STR:    // S57 attribute type'A' code string, 'S' free text
-                                    {
+            while ( *currATT != '\037' )
+                  currATT++;
+            currATT++;
 
-                                          //    Strings must be exact match
-                                          //    n.b. OGR_STR is used for S-57 attribute type 'L', comma-separated list
+            ++attIdx;
+      }
 
-                                          wxString cs(( char * ) v->value, wxConvUTF8);                // Attribute from object
-                                          if ( LATTValue.Len() == cs.Len() )
-                                                if ( LATTValue == cs )
-                                                      attValMatch = TRUE;
-/*
-                                          char *s = ( char * ) ( LATTC.mb_str() + 6 );   // attribute from LUP candidate
-                                          char *c = ( char * ) v->value;                // Attribute from object
-                                          if ( strlen ( s ) == strlen ( c ) )
-                                                if ( !strcmp ( s,c ) )
-                                                      attValMatch = TRUE;
-*/
+      return NULL;
+}
 
-                                          break;
-                                    }
 
-                                    default:
-//                                                printf("S52:_findFromATT(): unknown attribute type\n");
-                                          break;
-                              }   //switch
+LUPClassHash *s52plib::GetLUPIndex ( LUPname TNAM )
+{
+      int islot;
+      switch ( TNAM )
+      {
+            case SIMPLIFIED:                  islot = 0; break;
+            case PAPER_CHART:                 islot = 1; break;
+            case LINES:                       islot = 2; break;
+            case PLAIN_BOUNDARIES:            islot = 3; break;
+            case SYMBOLIZED_BOUNDARIES:       islot = 4; break;
+            default:                          return NULL;
+      }
 
-                              // value match
-                              if ( attValMatch )
-                                    ++countATT;
+      if ( NULL == m_pLUPIndex[islot] )
+      {
+            wxArrayOfLUPrec *la = SelectLUPARRAY ( TNAM );
+            if ( NULL == la )
+                  return NULL;
 
-                              goto next_LUP_Attr;
-                        }  // if attribute match
+            //    Group the LUPs by object class, keeping table order within each class
+            LUPClassHash *pindex = new LUPClassHash;
 
-                        while ( *currATT != '\037' )
-                              currATT++;
-                        currATT++;
+            for ( unsigned int i = 0 ; i < la->GetCount() ; i++ )
+            {
+                  LUPrec *pLUP = la->Item ( i );
+                  wxString obcl ( pLUP->OBCL, wxConvUTF8 );
 
-                        ++attIdx;
+                  S52LUPClassIndex *pci;
+                  LUPClassHash::iterator it = pindex->find ( obcl );
+                  if ( it == pindex->end() )
+                  {
+                        pci = new S52LUPClassIndex;
+                        ( *pindex ) [obcl] = pci;
+                  }
+                  else
+                        pci = it->second;
 
-                  }  //while
+                  S52LUPCandidate *pc = new S52LUPCandidate ( pLUP );
+                  pci->m_candidates.Add ( pc );
 
-            next_LUP_Attr:
-//                        continue;
+                  //    Remember each attribute the class is sensitive to, once
+                  for ( unsigned int ip = 0 ; ip < pc->m_predicates.GetCount() ; ip++ )
+                  {
+                        char *acronym = pc->m_predicates.Item ( ip )->m_acronym;
 
-                  currATT  = objAtt;            // restart the object attribute list
-                  attIdx = 0;
-            }             // for iLUPAtt
+                        bool bknown = false;
+                        for ( unsigned int ia = 0 ; ia < pci->m_acronyms.GetCount() ; ia++ )
+                        {
+                              if ( !strncmp ( ( char * ) pci->m_acronyms.Item ( ia ), acronym, 6 ) )
+                              {
+                                    bknown = true;
+                                    break;
+                              }
+                        }
+                        if ( !bknown )
+                              pci->m_acronyms.Add ( acronym );
+                  }
+            }
 
-            //      Create a "match score", defined as fraction of candidate LUP attributes
-            //      actually matched by feature.
-            //      Used later for resolving "ties"
+            m_pLUPIndex[islot] = pindex;
+      }
 
-            int nattr_matching_on_candidate = countATT;
-            int nattrs_on_candidate = LUPCandidate->ATTCArray->GetCount();
-            double candidate_score = ( 1. * nattr_matching_on_candidate ) / ( 1. * nattrs_on_candidate );
+      return m_pLUPIndex[islot];
+}
 
+void s52plib::DestroyLUPIndex ( void )
+{
+      for ( int i = 0 ; i < LUPNAME_NUM ; i++ )
+      {
+            if ( m_pLUPIndex[i] )
+            {
+                  LUPClassHash::iterator it;
+                  for ( it = m_pLUPIndex[i]->begin(); it != m_pLUPIndex[i]->end(); ++it )
+                        delete it->second;
 
-            //       Use some "fuzzy" logic to chack for a match
-            //       This method is not S52 compliant
-            /*
-                     //       If the number of attributes matched on this LUP candidate
-                     //       is larger than the best acheived so far, adopt this candidate
-                  if (countATT > nATTMatch){
-                     nATTMatch = countATT;
-                     current_best_score = candidate_score;
-                     bmatch_found = true;
-                     LUP = LUPCandidate;
-                  }
+                  delete m_pLUPIndex[i];
+                  m_pLUPIndex[i] = NULL;
+            }
+      }
+}
 
-                  //       Else, if the number of attributes matched on this candidate is
-                  //       equal to the best obtained so far, then use the "match score" value to
-                  //       resolve the tie.  Best match wins....
 
-                  else if (countATT == nATTMatch){
+// get LUP with "best" Object attribute match
+LUPrec *s52plib::FindBestLUP ( S52LUPClassIndex *pci, const char *objAtt,
+                               wxArrayOfS57attVal *objAttVal, bool bStrict )
+{
+      bool bany_att_match = false;
 
-                     if(candidate_score > current_best_score){
-                        nATTMatch = countATT;
-                        current_best_score = candidate_score;
-                        bmatch_found = true;
-                        LUP = LUPCandidate;
-                     }
+      for ( unsigned int i = 0 ; i < pci->m_candidates.GetCount() ; i++ )
+      {
+            S52LUPCandidate *pc = pci->m_candidates.Item ( i );
 
-                  }
-            */
+            if ( ( NULL == pc->m_pLUP->ATTC ) || ( 0 == pc->m_predicates.GetCount() ) )
+                  continue;
 
             //       According to S52 specs, match must be perfect,
             //         and the first 100% match is selected
-            if ( candidate_score == 1.0 )
+            int countATT = 0;
+            for ( unsigned int ip = 0 ; ip < pc->m_predicates.GetCount() ; ip++ )
             {
-                  LUP = LUPCandidate;
-                  bmatch_found = true;
-                  break;                        // selects the first 100% match
-            }
-
+                  S52AttcPredicate *pp = pc->m_predicates.Item ( ip );
+                  S57attVal *v = FindObjAttVal ( objAtt, objAttVal, pp->m_acronym );
 
+                  if ( v && pp->Match ( v ) )
+                        ++countATT;
+                  else if ( !bStrict )
+                        break;
+            }
 
-      }  //for loop
+            if ( countATT )
+                  bany_att_match = true;
 
+            if ( countATT == ( int ) pc->m_predicates.GetCount() )
+                  return pc->m_pLUP;
+      }
 
 //  In strict mode, we require at least one attribute to match exactly
 
       if ( bStrict )
       {
-            if ( nATTMatch == 0 )               // nothing matched
-                  LUP = NULL;
+            if ( !bany_att_match )               // nothing matched
+                  return NULL;
       }
-      else
-      {
-//      If no match found, return the first LUP in the list which has no attributes
-            if ( !bmatch_found )
-            {
-                  for ( i=0; i< ( int ) nameMatch->GetCount(); ++i )
-                  {
-                        LUPrec *LUPtmp = NULL;
 
-                        LUPtmp = ( LUPrec* ) nameMatch->Item ( i );
-                        if ( LUPtmp->ATTCArray == NULL )
-                              return LUPtmp;
-                  }
-            }
+//      If no match found, return the first LUP in the list which has no attributes
+      for ( unsigned int i = 0 ; i < pci->m_candidates.GetCount() ; i++ )
+      {
+            if ( NULL == pci->m_candidates.Item ( i )->m_pLUP->ATTCArray )
+                  return pci->m_candidates.Item ( i )->m_pLUP;
       }
 
-      return LUP;
+      return pci->m_candidates.Item ( 0 )->m_pLUP;
 }
 
 
@@ -1634,6 +1619,7 @@ int s52plib::S52_load_Plib ( const wxString& PLib )
       areaPlaineLUPArray    = new wxArrayOfLUPrec ( CompareLUPObjects );   // area plain boundary
       areaSymbolLUPArray    = new wxArrayOfLUPrec ( CompareLUPObjects );   // area symbolized boundary
       condSymbolLUPArray    = new wxArrayOfLUPrec ( CompareLUPObjects );   // dynamic Cond Sym LUPs
+      m_pCSLUPHash          = new CSLUPHash;
 
 
       m_LUPSequenceNumber = 0;
@@ -1881,6 +1867,7 @@ void s52plib::ClearCNSYLUPArray ( void )
             DestroyLUP ( condSymbolLUPArray->Item ( i ) );
 
       condSymbolLUPArray->Clear();
+      m_pCSLUPHash->clear();
 }
 
 
@@ -1930,6 +1917,9 @@ bool s52plib::S52_flush_Plib()
       DestroyLUPArray ( areaSymbolLUPArray );
       DestroyLUPArray ( condSymbolLUPArray );
 
+      DestroyLUPIndex();
+      delete m_pCSLUPHash;
+
 //      Destroy Rules
       DestroyRules ( _line_sym );
       DestroyPattRules ( _patt_sym );
@@ -1965,77 +1955,77 @@ bool s52plib::S52_flush_Plib()
 LUPrec *s52plib::S52_LUPLookup ( LUPname LUP_Name, const char * objectName, S57Obj *pObj, bool bStrict )
 
 {
-      LUPrec *LUP = NULL;
-      LUPrec *LUPCandidate;
-
-      wxArrayOfLUPrec *la = SelectLUPARRAY ( LUP_Name );
+      LUPClassHash *pindex = GetLUPIndex ( LUP_Name );
 
-      if ( NULL == la )                 // S52PLIB probably did not load
+      if ( NULL == pindex )                 // S52PLIB probably did not load
             return NULL;
 
-      wxArrayPtrVoid *nameMatch = new wxArrayPtrVoid;
-
+      LUPClassHash::iterator it = pindex->find ( wxString ( objectName, wxConvUTF8 ) );
+      if ( it == pindex->end() )
+            return NULL;
 
-      int ocnt = 0;
+      S52LUPClassIndex *pci = it->second;
 
-      int first_match = 0;
-      int index = 0;
-      int index_max = la->GetCount();
+      char *temp = ( char * ) calloc ( pObj->attList->Len() +1, 1 );
+      strncpy ( temp, pObj->attList->mb_str(), pObj->attList->Len() );
 
-      //        This technique of extracting proper LUPs depends on the fact that
-      //        the LUPs have been sorted in their array, by OBCL.
-      //        Thus, all the LUPS with the same OBCL will be grouped together
+      //    Build a signature from the values of just those attributes
+      //    which the LUPs for this class test.
+      //    Objects with the same signature always resolve to the same LUP.
+      bool bcacheable = !bStrict;
+      wxString sig;
 
-      while ( !first_match && ( index < index_max ) )
+      for ( unsigned int ia = 0 ; bcacheable && ( ia < pci->m_acronyms.GetCount() ) ; ia++ )
       {
-            LUPCandidate = la->Item ( index );
-            if ( !strcmp ( objectName, LUPCandidate->OBCL ) )
+            S57attVal *v = FindObjAttVal ( temp, pObj->attVal, ( char * ) pci->m_acronyms.Item ( ia ) );
+            if ( NULL == v )
+                  sig += _T ( "-" );
+            else
             {
-                  first_match = 1;
-                  ocnt++;
-                  nameMatch->Add ( LUPCandidate );
-                  index++;
-                  break;
+                  switch ( v->valType )
+                  {
+                        case OGR_INT:
+                              sig += wxString::Format ( _T ( "i%d" ), * ( int* ) ( v->value ) );
+                              break;
+                        case OGR_REAL:
+                              sig += wxString::Format ( _T ( "r%.17g" ), * ( double* ) ( v->value ) );
+                              break;
+                        case OGR_STR:
+                        {
+                              wxString cs ( ( char * ) v->value, wxConvUTF8 );
+                              if ( cs.IsEmpty() && * ( char * ) v->value )      // not valid UTF-8
+                                    bcacheable = false;
+                              sig += _T ( "s" );
+                              sig += cs;
+                              break;
+                        }
+                        default:
+                              bcacheable = false;
+                              break;
+                  }
             }
-            index++;
+            sig += _T ( "\037" );
       }
 
+      LUPrec *LUP = NULL;
 
-      while ( first_match && ( index < index_max ) )
+      if ( bcacheable )
       {
-            LUPCandidate = la->Item ( index );
-            if ( !strcmp ( objectName, LUPCandidate->OBCL ) )
-            {
-                  ocnt++;
-                  nameMatch->Add ( LUPCandidate );
-            }
-            else
-            {
-                  break;
-            }
-
-            index++;
+            LUPSignatureHash::iterator its = pci->m_resolved.find ( sig );
+            if ( its != pci->m_resolved.end() )
+                  LUP = its->second;
       }
 
+      if ( NULL == LUP )
+      {
+            LUP = FindBestLUP ( pci, temp, pObj->attVal, bStrict );
 
-      char *temp;
-
-      if ( ocnt == 0 )
-            goto BAILOUT;
-
-      temp = ( char * ) calloc ( pObj->attList->Len() +1, 1 );
-      strncpy ( temp, pObj->attList->mb_str(), pObj->attList->Len() );
-
-      LUP = FindBestLUP ( nameMatch,temp, pObj->attVal, bStrict );
+            if ( bcacheable && LUP && ( pci->m_resolved.size() < LUP_SIGNATURE_CACHE_MAX ) )
+                  pci->m_resolved[sig] = LUP;
+      }
 
       free ( temp );
 
-
-BAILOUT:
-      nameMatch->Clear();
-
-      delete nameMatch;
-
       return LUP;
 }
 
@@ -4713,7 +4703,24 @@ char *s52plib::RenderCS ( ObjRazRules *rzRules, Rules *rules )
 }
 
 
-int s52plib::_draw ( wxDC *pdcin, ObjRazRules *rzRules, ViewPort *vp )
+//    The S52_DRAW_ class of a rule
+static int GetRuleDrawClass ( int rule_type )
+{
+      switch ( rule_type )
+      {
+            case RUL_SIM_LN:
+            case RUL_COM_LN:
+                  return S52_DRAW_LINES;
+
+            case RUL_CND_SY:
+                  return S52_DRAW_ALL;                      // the expanded rules are classed one by one
+
+            default:
+                  return S52_DRAW_SYMBOLS;
+      }
+}
+
+int s52plib::_draw ( wxDC *pdcin, ObjRazRules *rzRules, ViewPort *vp, int draw_rules )
 {
       //  Debug Hook
 //   if(!strncmp(rzRules->LUP->OBCL, "SOUNDG", 6))
@@ -4742,6 +4749,12 @@ int s52plib::_draw ( wxDC *pdcin, ObjRazRules *rzRules, ViewPort *vp )
 
       while ( rules != NULL )
       {
+            if ( !( draw_rules & GetRuleDrawClass ( rules->ruleType ) ) )
+            {
+                  rules = rules->next;
+                  continue;
+            }
+
             switch ( rules->ruleType )
             {
                   case RUL_TXT_TX:       if(ObjectRenderCheckCat ( rzRules, vp )) { RenderTX ( rzRules,rules, vp );} break;          // TX
@@ -4782,6 +4795,13 @@ int s52plib::_draw ( wxDC *pdcin, ObjRazRules *rzRules, ViewPort *vp )
                                                 break;
                                     }
 
+                                    if ( !( draw_rules & GetRuleDrawClass ( rules->ruleType ) ) )
+                                    {
+                                          rules_last = rules;
+                                          rules = rules->next;
+                                          continue;
+                                    }
+
                                     switch ( rules->ruleType )
                                     {
       //                                        case RUL_ARE_CO:       RenderAC(rzRules,rules, vp);break;
@@ -5157,6 +5177,10 @@ int s52plib::dda_tri ( wxPoint *ptp, S52color *c, render_canvas_parms *pb_spec,
 {
       unsigned char r, g, b;
 
+      //    Banded renders supply their own edge arrays
+      int *ledge = pb_spec->pledge ? pb_spec->pledge : this->ledge;
+      int *redge = pb_spec->predge ? pb_spec->predge : this->redge;
+
       if(!inter_tri_rect(ptp, pb_spec))
             return 0;
 
@@ -5649,6 +5673,10 @@ __asm__ __volatile__ ( \
 //----------------------------------------------------------------------------------
 inline int s52plib::dda_trap ( wxPoint *segs, int lseg, int rseg, int ytop, int ybot, S52color *c, render_canvas_parms *pb_spec, render_canvas_parms *pPatt_spec )
 {
+      //    Banded renders supply their own edge arrays
+      int *ledge = pb_spec->pledge ? pb_spec->pledge : this->ledge;
+      int *redge = pb_spec->predge ? pb_spec->predge : this->redge;
+
       unsigned char r = 0, g = 0, b = 0;
 
       if ( NULL != c )
@@ -6070,36 +6098,77 @@ inline int s52plib::dda_trap ( wxPoint *segs, int lseg, int rseg, int ytop, int
 
 
 
+S52AreaFill::S52AreaFill()
+{
+      rzRules = NULL;
+      bpattern = false;
+      ppoints = NULL;
+      pprim_start = NULL;
+      ptrap_y = NULL;
+      ymin = 1;
+      ymax = 0;
+}
+
+S52AreaFill::~S52AreaFill()
+{
+      free ( ppoints );
+      free ( pprim_start );
+      free ( ptrap_y );
+}
+
+
 void s52plib::RenderToBufferFilledPolygon ( ObjRazRules *rzRules, S57Obj *obj, S52color *c, wxBoundingBox &BBView,
         render_canvas_parms *pb_spec, render_canvas_parms *pPatt_spec )
 {
-      S52color cp;
-      if ( NULL != c )
-      {
-            cp.R = c->R;
-            cp.G = c->G;
-            cp.B = c->B;
-      }
+      S52AreaFill fill;
+
+      ProjectFilledPolygon ( rzRules, obj, BBView, &fill );
+      RenderProjectedPolygon ( obj, &fill, c, pb_spec, pPatt_spec );
+}
+
+
+//----------------------------------------------------------------------------------
+//    Convert the fill geometry of an area object to screen co-ordinates
+//    Only the triangle primitives near the view are converted.
+//----------------------------------------------------------------------------------
+void s52plib::ProjectFilledPolygon ( ObjRazRules *rzRules, S57Obj *obj, wxBoundingBox &BBView, S52AreaFill *pfill )
+{
+      bool bfirst = true;
 
       if ( obj->pPolyTessGeo )
       {
-            wxPoint *pp3 = ( wxPoint * ) malloc ( 3 * sizeof ( wxPoint ) );
-            wxPoint *ptp = ( wxPoint * ) malloc ( ( obj->pPolyTessGeo->GetnVertexMax() + 1 ) * sizeof ( wxPoint ) );
-
             //  Allow a little slop in calculating whether a triangle
             //  is within the requested Viewport
             double margin = BBView.GetWidth() * .05;
 
             PolyTriGroup *ppg = obj->pPolyTessGeo->Get_PolyTriGroup_head();
 
+            //  Count the primitives, and the vertices of those in view
+            int nprim = 0;
+            int nvert = 0;
             TriPrim *p_tp = ppg->tri_prim_head;
             while ( p_tp )
+            {
+                  if ( BBView.Intersect ( * ( p_tp->p_bbox ), margin ) != _OUT )
+                        nvert += p_tp->nVert;
+                  nprim++;
+                  p_tp = p_tp->p_next;
+            }
+
+            pfill->ppoints = ( wxPoint * ) malloc ( ( nvert + 1 ) * sizeof ( wxPoint ) );
+            pfill->pprim_start = ( int * ) malloc ( ( nprim + 1 ) * sizeof ( int ) );
+
+            wxPoint *pr = pfill->ppoints;
+            int iprim = 0;
+
+            p_tp = ppg->tri_prim_head;
+            while ( p_tp )
             {
                   if ( BBView.Intersect ( * ( p_tp->p_bbox ), margin ) != _OUT )
                   {
-                        //      Get and convert the points
-                        wxPoint *pr = ptp;
+                        pfill->pprim_start[iprim] = pr - pfill->ppoints;
 
+                        //      Get and convert the points
                         double *pvert_list = p_tp->p_vertex;
 
                         for ( int iv =0 ; iv < p_tp->nVert ; iv++ )
@@ -6108,10 +6177,107 @@ void s52plib::RenderToBufferFilledPolygon ( ObjRazRules *rzRules, S57Obj *obj, S
                               double lat = *pvert_list++;
                               rzRules->chart->GetPointPix ( rzRules, lat, lon, pr );
 
+                              if ( bfirst )
+                              {
+                                    pfill->ymin = pfill->ymax = pr->y;
+                                    bfirst = false;
+                              }
+                              else
+                              {
+                                    pfill->ymin = wxMin ( pfill->ymin, pr->y );
+                                    pfill->ymax = wxMax ( pfill->ymax, pr->y );
+                              }
+
                               pr++;
                         }
+                  }
+                  else
+                        pfill->pprim_start[iprim] = -1;
+
+                  iprim++;
+                  p_tp = p_tp->p_next;                // pick up the next in chain
+            }
+      }       // if pPolyTessGeo
+
+      else if ( obj->pPolyTrapGeo )
+      {
+            if(!rzRules->obj->pPolyTrapGeo->IsOk())
+                  rzRules->obj->pPolyTrapGeo->BuildTess();
+
+            if ( obj->pPolyTrapGeo->IsOk() )
+            {
+                  PolyTrapGroup *ptg = obj->pPolyTrapGeo->Get_PolyTrapGroup_head();
+
+                  //  Convert the segment array to screen coordinates
+                  int nVertex = obj->pPolyTrapGeo->GetnVertexMax();
+                  pfill->ppoints = ( wxPoint * ) malloc ( ( nVertex + 1 ) * sizeof ( wxPoint ) );
+
+                  rzRules->chart->GetPointPix ( rzRules, ptg->ptrapgroup_geom, pfill->ppoints, nVertex );
+
+                  //    Get the screen co-ordinates of top and bottom of each trapezoid,
+                  //    understanding that ptraps->hiy is the upper line
+                  int ntraps = ptg->ntrap_count;
+                  trapz_t *ptraps = ptg->trap_array;
+                  pfill->ptrap_y = ( int * ) malloc ( ( 2 * ntraps + 1 ) * sizeof ( int ) );
+
+                  for ( int i=0 ; i < ntraps ; i++ )
+                  {
+                        wxPoint pr;
+                        rzRules->chart->GetPointPix ( rzRules, ptraps->hiy, 0., &pr );
+                        int trap_y_top = pr.y;
+
+                        rzRules->chart->GetPointPix ( rzRules, ptraps->loy, 0., &pr );
+                        int trap_y_bot = pr.y;
+
+                        pfill->ptrap_y[2 * i] = trap_y_top;
+                        pfill->ptrap_y[(2 * i) + 1] = trap_y_bot;
+
+                        if ( bfirst )
+                        {
+                              pfill->ymin = pfill->ymax = trap_y_top;
+                              bfirst = false;
+                        }
+                        pfill->ymin = wxMin ( pfill->ymin, wxMin ( trap_y_top, trap_y_bot ) );
+                        pfill->ymax = wxMax ( pfill->ymax, wxMax ( trap_y_top, trap_y_bot ) );
+
+                        ptraps++;
+                  }
+            }   // if OK
+      }       // if pPolyTrapGeo
+}
 
 
+//----------------------------------------------------------------------------------
+//    Rasterize an area object, from the geometry made by ProjectFilledPolygon()
+//----------------------------------------------------------------------------------
+void s52plib::RenderProjectedPolygon ( S57Obj *obj, S52AreaFill *pfill, S52color *c,
+        render_canvas_parms *pb_spec, render_canvas_parms *pPatt_spec )
+{
+      S52color cp;
+      if ( NULL != c )
+      {
+            cp.R = c->R;
+            cp.G = c->G;
+            cp.B = c->B;
+      }
+
+      if ( obj->pPolyTessGeo )
+      {
+            if ( NULL == pfill->pprim_start )
+                  return;
+
+            wxPoint *pp3 = ( wxPoint * ) malloc ( 3 * sizeof ( wxPoint ) );
+
+            PolyTriGroup *ppg = obj->pPolyTessGeo->Get_PolyTriGroup_head();
+
+            TriPrim *p_tp = ppg->tri_prim_head;
+            int iprim = 0;
+            while ( p_tp )
+            {
+                  if ( pfill->pprim_start[iprim] >= 0 )
+                  {
+                        wxPoint *ptp = pfill->ppoints + pfill->pprim_start[iprim];
+
                         switch ( p_tp->type )
                         {
                               case PTG_TRIANGLE_FAN:
@@ -6168,90 +6334,58 @@ void s52plib::RenderToBufferFilledPolygon ( ObjRazRules *rzRules, S57Obj *obj, S
 
                               }
                         }
-                  }   // if bbox
+                  }   // if in view
+                  iprim++;
                   p_tp = p_tp->p_next;                // pick up the next in chain
             }       // while
-            free ( ptp );
             free ( pp3 );
       }       // if pPolyTessGeo
 
       else if ( obj->pPolyTrapGeo )
       {
-            if(!rzRules->obj->pPolyTrapGeo->IsOk())
-                  rzRules->obj->pPolyTrapGeo->BuildTess();
+            if ( NULL == pfill->ptrap_y )
+                  return;
 
             S52color cs;
             cs.R = 255;
             cs.G = 0;
             cs.B = 0;
 
+            PolyTrapGroup *ptg = obj->pPolyTrapGeo->Get_PolyTrapGroup_head();
+            wxPoint *ptp = pfill->ppoints;
 
-            if ( obj->pPolyTrapGeo->IsOk()  /*&& (obj->Index == 7) && ( obj->pPolyTrapGeo->GetnVertexMax() < 1000)*/)
-            {
-                  PolyTrapGroup *ptg = obj->pPolyTrapGeo->Get_PolyTrapGroup_head();
-
-                  //  Convert the segment array to screen coordinates
-                  int nVertex = obj->pPolyTrapGeo->GetnVertexMax();
-                  wxPoint *ptp = ( wxPoint * ) malloc ( ( nVertex + 1 ) * sizeof ( wxPoint ) );
-
-                  rzRules->chart->GetPointPix ( rzRules, obj->pPolyTrapGeo->Get_PolyTrapGroup_head()->ptrapgroup_geom, ptp, nVertex );
-
-                  //  Render the trapezoids
-                  int ntraps = ptg->ntrap_count;
-                  trapz_t *ptraps = ptg->trap_array;
-
-                  for ( int i=0 ; i < ntraps ; i++ )
-                  {
-                        cs.R = 0;
-                        cs.G = 255;
-                        cs.B = 0;
-
-                        int lseg = ptraps->ilseg;
-                        int rseg = ptraps->irseg;
-
-                        //    Get the screen co-ordinates of top and bottom of trapezoid,
-                        //    understanding that ptraps->hiy is the upper line
-                        wxPoint pr;
-                        rzRules->chart->GetPointPix ( rzRules, ptraps->hiy, 0., &pr );
-                        int trap_y_top = pr.y;
-
-                        rzRules->chart->GetPointPix ( rzRules, ptraps->loy, 0., &pr );
-                        int trap_y_bot = pr.y;
-
-                        S52color *cd = &cp;
-                        if ( ptg->m_trap_error )
-                              cd = &cs;
+            //  Render the trapezoids
+            int ntraps = ptg->ntrap_count;
+            trapz_t *ptraps = ptg->trap_array;
 
+            for ( int i=0 ; i < ntraps ; i++ )
+            {
+                  cs.R = 0;
+                  cs.G = 255;
+                  cs.B = 0;
 
-                        int trap_height = trap_y_bot - trap_y_top;
+                  int lseg = ptraps->ilseg;
+                  int rseg = ptraps->irseg;
 
-                        //    Clip the trapezoid array to the render_canvas_parms dimensions
-                        if ( ( trap_y_top >= pb_spec->y - trap_height ) && ( trap_y_bot <= pb_spec->y + pb_spec->height + trap_height ) )
-                        {
-/*
-                              if(obj->Index == 7)
-                              {
-                                    int clip_top =  pb_spec->y - trap_height;
-                                    int clip_bot = pb_spec->y + pb_spec->height + trap_height;
-                                    printf("Trap %d pb_spec-> %d clip_top %d clip_bot %d\n", i, pb_spec->y, clip_top, clip_bot);
-                                    printf("Trap %d  lseg: %d   rseg: %d   loy: %d   hiy: %d\n", i, lseg, rseg, trap_y_top, trap_y_bot);
-                              }
-*/
-//                              if((lseg == 66) && (trap_y_top < 0))
-  //                                    cs.B = 128;
+                  int trap_y_top = pfill->ptrap_y[2 * i];
+                  int trap_y_bot = pfill->ptrap_y[(2 * i) + 1];
 
-                              dda_trap ( ptp, lseg, rseg, trap_y_top, trap_y_bot, cd, pb_spec, pPatt_spec );
+                  S52color *cd = &cp;
+                  if ( ptg->m_trap_error )
+                        cd = &cs;
 
 
-                        }
+                  int trap_height = trap_y_bot - trap_y_top;
 
-                        ptraps++;
+                  //    Clip the trapezoid array to the render_canvas_parms dimensions
+                  if ( ( trap_y_top >= pb_spec->y - trap_height ) && ( trap_y_bot <= pb_spec->y + pb_spec->height + trap_height ) )
+                  {
+                        dda_trap ( ptp, lseg, rseg, trap_y_top, trap_y_bot, cd, pb_spec, pPatt_spec );
                   }
-                  free ( ptp );
-            }   // if OK
-      }       // if pPolyTrapGeo
-
 
+                  ptraps++;
+            }
+      }       // if pPolyTrapGeo
 }
 
 
@@ -6429,6 +6563,12 @@ int s52plib::RenderToBufferAP ( ObjRazRules *rzRules, Rules *rules, ViewPort *vp
       ppatt_spec->x = r.x - 2000000;                  // bias way down to avoid zero-crossing logic in dda
       ppatt_spec->y = r.y - 2000000;
 
+      if ( m_pAreaFillList )
+      {
+            AddAreaFill ( rzRules, vp, NULL, ppatt_spec );
+            return 1;
+      }
+
       RenderToBufferFilledPolygon ( rzRules, rzRules->obj, NULL, vp->GetBBox(), pb_spec, ppatt_spec );
 
       return 1;
@@ -6443,6 +6583,13 @@ int s52plib::RenderToBufferAC ( ObjRazRules *rzRules, Rules *rules, ViewPort *vp
 
       c = ps52plib->S52_getColor ( str );
 
+      //    Deferred fills are only recorded at scales where the wraparound case below cannot occur
+      if ( m_pAreaFillList )
+      {
+            AddAreaFill ( rzRules, vp, c, NULL );
+            return 1;
+      }
+
       RenderToBufferFilledPolygon ( rzRules, rzRules->obj, c, vp->GetBBox(), pb_spec, NULL );
 
 
@@ -6470,6 +6617,61 @@ int s52plib::RenderToBufferAC ( ObjRazRules *rzRules, Rules *rules, ViewPort *vp
 }
 
 
+void s52plib::BeginAreaFillList ( ArrayOfAreaFills *plist )
+{
+      m_pAreaFillList = plist;
+}
+
+void s52plib::EndAreaFillList ( void )
+{
+      m_pAreaFillList = NULL;
+}
+
+void s52plib::AddAreaFill ( ObjRazRules *rzRules, ViewPort *vp, S52color *c, render_canvas_parms *ppatt_spec )
+{
+      S52AreaFill *pfill = new S52AreaFill;
+      pfill->rzRules = rzRules;
+
+      if ( c )
+            pfill->color = *c;
+
+      pfill->bpattern = ( NULL != ppatt_spec );
+      if ( ppatt_spec )
+            pfill->patt_spec = *ppatt_spec;
+
+      //    Project the geometry now, while still single threaded, and once only,
+      //    rather than once in every band.  This also builds lazy trapezoid tesselations.
+      ProjectFilledPolygon ( rzRules, rzRules->obj, vp->GetBBox(), pfill );
+
+      m_pAreaFillList->Add ( pfill );
+}
+
+void s52plib::RenderAreaFillList ( ArrayOfAreaFills *plist, ViewPort *vp, render_canvas_parms *pb_spec )
+{
+      //    Fills are rendered in the order recorded, which preserves display priority.
+      //    Those not reaching the rows of this canvas are skipped.
+      for ( unsigned int i=0 ; i < plist->GetCount() ; i++ )
+      {
+            S52AreaFill *pfill = plist->Item ( i );
+            if ( ( pfill->ymax < pb_spec->y ) || ( pfill->ymin >= pb_spec->y + pb_spec->height ) )
+                  continue;
+
+            if ( pfill->bpattern )
+                  RenderProjectedPolygon ( pfill->rzRules->obj, pfill, NULL, pb_spec, &pfill->patt_spec );
+            else
+                  RenderProjectedPolygon ( pfill->rzRules->obj, pfill, &pfill->color, pb_spec, NULL );
+      }
+}
+
+void s52plib::ClearAreaFillList ( ArrayOfAreaFills *plist )
+{
+      for ( unsigned int i=0 ; i < plist->GetCount() ; i++ )
+            delete plist->Item ( i );
+
+      plist->Clear();
+}
+
+
 int s52plib::RenderArea ( wxDC *pdcin, ObjRazRules *rzRules, ViewPort *vp,
                           render_canvas_parms *pb_spec )
 {
@@ -6558,7 +6760,6 @@ void s52plib::GetAndAddCSRules ( ObjRazRules *rzRules, Rules *rules )
 
       LUPrec  *NewLUP;
       LUPrec  *LUP;
-      LUPrec  *LUPCandidate;
 
       char *rule_str1 = RenderCS ( rzRules, rules );
       wxString cs_string ( rule_str1, wxConvUTF8 );
@@ -6572,31 +6773,15 @@ void s52plib::GetAndAddCSRules ( ObjRazRules *rzRules, Rules *rules )
 //  b) was LUP created earlier by exactly the same INSTruction string?
 //  c) does LUP have same Display Category and Priority?
 
-      wxArrayOfLUPrec *la = condSymbolLUPArray;
-      int index = 0;
-      int index_max = la->GetCount();
-      LUP = NULL;
-
-      while ( ( index < index_max ) )
-      {
-            LUPCandidate = la->Item ( index );
-            if ( !strcmp ( rzRules->LUP->OBCL, LUPCandidate->OBCL ) )
-            {
-                  if ( LUPCandidate->INST->IsSameAs ( cs_string ) )
-                  {
-                        if( LUPCandidate->DISC == rzRules->LUP->DISC)
-                        {
-                              LUP = LUPCandidate;
-                              break;
-                        }
-                  }
-            }
-            index++;
-      }
-
-
-
+//  The dynamic LUPs are indexed by this triple
+      wxString cs_key ( rzRules->LUP->OBCL, wxConvUTF8 );
+      cs_key += wxString::Format ( _T ( "\037%d\037" ), ( int ) rzRules->LUP->DISC );
+      cs_key += cs_string;
 
+      LUP = NULL;
+      CSLUPHash::iterator it = m_pCSLUPHash->find ( cs_key );
+      if ( it != m_pCSLUPHash->end() )
+            LUP = it->second;
 
 
 //  If not found, need to create a dynamic LUP and add to CS LUP Table
@@ -6680,6 +6865,7 @@ void s52plib::GetAndAddCSRules ( ObjRazRules *rzRules, Rules *rules )
             wxArrayOfLUPrec *pLUPARRAYtyped = condSymbolLUPArray;
 
             pLUPARRAYtyped->Add ( NewLUP );
+            ( *m_pCSLUPHash ) [cs_key] = NewLUP;
 
 
             LUP = NewLUP;
@@ -47,6 +47,7 @@
 //#include "nmea.h"                               // for Pause/UnPause
 
 #include "mygeom.h"
+#include "sencparser.h"
 #include "cutil.h"
 #include "georef.h"
 #include "navutil.h"                            // for LogMessageOnce
@@ -57,6 +58,15 @@
 
 #include "mygdal/ogr_s57.h"
 
+#include <wx/mstream.h>
+
+#ifndef __WXMSW__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #ifdef __MSVC__
 #define _CRTDBG_MAP_ALLOC
 #include <stdlib.h>
@@ -91,8 +101,11 @@ extern wxString          g_SENCPrefix;
 extern FILE              *s_fpdebug;
 extern bool              g_bGDAL_Debug;
 extern bool              g_bDebugS57;
+extern S57TileCache      *g_pS57TileCache;
+
+extern "C" void MyCPLErrorHandler( CPLErr eErrClass, int nError, const char * pszErrorMsg );
 
-static jmp_buf env_ogrf;                    // the context saved by setjmp();
+static CPL_THREADLOCAL jmp_buf env_ogrf;    // the context saved by setjmp(), one per SENC build thread
 
 
 #include <wx/arrimpl.cpp>                   // Implement an array of S57 Objects
@@ -117,8 +130,26 @@ static int              s_bInS57;         // Exclusion flag to prvent recursion
 wxProgressDialog *s_ProgDialog;
 int s_cnt;
 
+//    Returns true if the SENC build in progress on the calling (pool) thread should be abandoned
+static bool s_IsSENCBuildCancelled(void)
+{
+      if(wxThread::IsMain())
+            return false;
+
+      SENCBuildThread *pt = dynamic_cast<SENCBuildThread *>(wxThread::This());
+      if(pt)
+            return pt->GetPool()->IsCancelled();
+
+      return false;
+}
+
 static bool s_ProgressCallBack(void)
 {
+      //    The progress dialog belongs to the GUI thread.
+      //    SENC builds on pool threads poll the pool cancel flag instead.
+      if(!wxThread::IsMain())
+            return !s_IsSENCBuildCancelled();
+
       bool ret = true;
       s_cnt++;
       if((s_cnt % 100) == 0)
@@ -129,6 +160,172 @@ static bool s_ProgressCallBack(void)
       return ret;
 }
 
+//----------------------------------------------------------------------------------
+//      SENCFileBuffer
+//      Whole-file read access to a binary SENC file.
+//      The file is memory mapped where possible, else read into memory.
+//----------------------------------------------------------------------------------
+class SENCFileBuffer
+{
+public:
+      SENCFileBuffer();
+      ~SENCFileBuffer();
+
+      bool Open(const wxString &path);
+      void Close();
+
+      unsigned char *GetData(){ return m_pData; }
+      size_t GetSize(){ return m_nSize; }
+
+private:
+      unsigned char     *m_pData;
+      size_t            m_nSize;
+      bool              m_bMapped;
+};
+
+SENCFileBuffer::SENCFileBuffer()
+{
+      m_pData = NULL;
+      m_nSize = 0;
+      m_bMapped = false;
+}
+
+SENCFileBuffer::~SENCFileBuffer()
+{
+      Close();
+}
+
+bool SENCFileBuffer::Open(const wxString &path)
+{
+      Close();
+
+#ifndef __WXMSW__
+      int fd = open(path.fn_str(), O_RDONLY);
+      if(fd != -1)
+      {
+            struct stat st;
+            if((fstat(fd, &st) == 0) && (st.st_size > 0))
+            {
+                  void *pmap = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                  if(pmap != MAP_FAILED)
+                  {
+                        madvise(pmap, st.st_size, MADV_SEQUENTIAL);
+                        m_pData = (unsigned char *)pmap;
+                        m_nSize = st.st_size;
+                        m_bMapped = true;
+                  }
+            }
+            close(fd);
+
+            if(m_bMapped)
+                  return true;
+      }
+#endif
+
+      wxFile f;
+      if(!f.Open(path))
+            return false;
+
+      wxFileOffset len = f.Length();
+      if(len <= 0)
+            return false;
+
+      m_pData = (unsigned char *)malloc(len);
+      if(!m_pData)
+            return false;
+
+      if(f.Read(m_pData, len) != len)
+      {
+            Close();
+            return false;
+      }
+
+      m_nSize = len;
+      return true;
+}
+
+void SENCFileBuffer::Close()
+{
+#ifndef __WXMSW__
+      if(m_bMapped)
+            munmap(m_pData, m_nSize);
+      else
+#endif
+            free(m_pData);
+
+      m_pData = NULL;
+      m_nSize = 0;
+      m_bMapped = false;
+}
+
+//----------------------------------------------------------------------------------
+//      Read and check the fixed header of a binary SENC file
+//      Returns false for a missing, short, or pre-binary (text) SENC file
+//----------------------------------------------------------------------------------
+static bool ReadSENCFileHeader(const wxString &path, SENCFileHeader *phdr)
+{
+      wxFile f;
+      if(!f.Open(path))
+            return false;
+
+      memset(phdr, 0, sizeof(SENCFileHeader));
+      if(f.Read(phdr, sizeof(SENCFileHeader)) != (int)sizeof(SENCFileHeader))
+            return false;
+
+      if(strncmp(phdr->magic, SENC_FILE_MAGIC, 8))
+            return false;
+
+      if(phdr->header_size < (int)sizeof(SENCFileHeader))
+            return false;
+
+      //    Guard the strings
+      phdr->name[sizeof(phdr->name) - 1] = 0;
+      phdr->date000[sizeof(phdr->date000) - 1] = 0;
+      phdr->edtn000[sizeof(phdr->edtn000) - 1] = 0;
+      phdr->filemod000[sizeof(phdr->filemod000) - 1] = 0;
+      phdr->dateupd[sizeof(phdr->dateupd) - 1] = 0;
+
+      return true;
+}
+
+//----------------------------------------------------------------------------------
+//      Append one record, header plus padded payload, to a SENC file
+//----------------------------------------------------------------------------------
+static void WriteSENCRecord(FILE *fpOut, int record_type, wxMemoryOutputStream &payload)
+{
+      int length = payload.GetSize();
+      char *tb = NULL;
+      if(length)
+      {
+            tb = (char *)malloc(length);
+            payload.CopyTo(tb, length);
+      }
+
+      SENCWriteRecord(fpOut, record_type, tb, length);
+      free(tb);
+}
+
+//----------------------------------------------------------------------------------
+//      Append the contents of a memory stream to another stream
+//----------------------------------------------------------------------------------
+static void AppendSENCStream(wxOutputStream &dest, wxMemoryOutputStream &src)
+{
+      size_t len = src.GetSize();
+      if(len)
+      {
+            char *tb = (char *)malloc(len);
+            src.CopyTo(tb, len);
+            dest.Write(tb, len);
+            free(tb);
+      }
+}
+
+static void SetSENCHeaderString(char *dest, size_t dest_size, const wxString &str)
+{
+      memset(dest, 0, dest_size);
+      strncpy(dest, str.mb_str(wxConvUTF8), dest_size - 1);
+}
+
 //----------------------------------------------------------------------------------
 //      S57Obj CTOR
 //----------------------------------------------------------------------------------
@@ -209,10 +406,11 @@ S57Obj::~S57Obj()
 }
 
 //----------------------------------------------------------------------------------
-//      S57Obj CTOR from SENC file
+//      S57Obj CTOR from binary SENC feature record
+//      The record has been checked by SENCParseFeature()
 //----------------------------------------------------------------------------------
 
-S57Obj::S57Obj(char *first_line, wxInputStream *pfpx, double dummy, double dummy2)
+S57Obj::S57Obj(SENCFeature *pfeature)
 {
     attList = NULL;
     attVal = NULL;
@@ -232,6 +430,8 @@ S57Obj::S57Obj(char *first_line, wxInputStream *pfpx, double dummy, double dummy
     bIsAton = false;
     m_n_lsindex = 0;
     m_lsindex_array = NULL;
+    m_n_edge_max_points = 0;
+    bBBObj_valid = false;
 
     //        Set default (unity) auxiliary transform coefficients
     x_rate   = 1.0;
@@ -239,687 +439,295 @@ S57Obj::S57Obj(char *first_line, wxInputStream *pfpx, double dummy, double dummy
     x_origin = 0.0;
     y_origin = 0.0;
 
+    attList = new wxString();
+    attVal =  new wxArrayOfS57attVal();
 
-    if(strlen(first_line) == 0)
-          return;
+    SENCFeatureHeader *pfh = &pfeature->hdr;
 
-    int FEIndex;
+    int FEIndex = pfh->fid;
 
-    int MAX_LINE = 499999;
-    char *buf = (char *)malloc(MAX_LINE + 1);
-    int llmax = 0;
+    strncpy(FeatureName, pfh->feature_name, 6);
+    FeatureName[6] = 0;
 
-    char szFeatureName[20];
-
-    char *br;
-    char szAtt[20];
-    char geoMatch[20];
-
-    bool bMulti = false;
-
-    char *hdr_buf = (char *)malloc(1);
+    //      Build/Maintain a list of found OBJL types for later use
+    //      And back-reference the appropriate list index in S57Obj for Display Filtering
 
-    strcpy(buf, first_line);
+    bool bNeedNew = true;
+    OBJLElement *pOLE;
 
-//    while(!dun)
+    for(unsigned int iPtr = 0 ; iPtr < ps52plib->pOBJLArray->GetCount() ; iPtr++)
     {
-
-        if(!strncmp(buf, "OGRF", 4))
+        pOLE = (OBJLElement *)(ps52plib->pOBJLArray->Item(iPtr));
+        if(!strncmp(pOLE->OBJLName, FeatureName, 6))
         {
-            attList = new wxString();
-            attVal =  new wxArrayOfS57attVal();
+            iOBJL = iPtr;
+            bNeedNew = false;
+            break;
+        }
+    }
 
-            FEIndex = atoi(buf+19);
+    if(bNeedNew)
+    {
+        pOLE = (OBJLElement *)malloc(sizeof(OBJLElement));
+        strcpy(pOLE->OBJLName, FeatureName);
+        pOLE->nViz = 1;
 
- // Debug hooks
- //       if(!strncmp(obj->FeatureName, "DEPCNT", 6))
- //           int ffl = 4;
- //       if(FEIndex == 91)
- //           int rrt = 5;
+        ps52plib->pOBJLArray->Add((void *)pOLE);
+        iOBJL  = ps52plib->pOBJLArray->GetCount() - 1;
+    }
 
-            strncpy(szFeatureName, buf+11, 6);
-            szFeatureName[6] = 0;
-            strcpy(FeatureName, szFeatureName);
+    //      Walk thru the attributes
+    unsigned char *pa = pfeature->pattributes;
 
-    //      Build/Maintain a list of found OBJL types for later use
-    //      And back-reference the appropriate list index in S57Obj for Display Filtering
+    for(int iatt = 0 ; iatt < pfh->n_attributes ; iatt++)
+    {
+        SENCAttributeHeader ah;
+        unsigned char *pvalue = SENCNextAttribute(&pa, &ah);
 
-            bool bNeedNew = true;
-            OBJLElement *pOLE;
+        char szAtt[9];
+        strncpy(szAtt, ah.name, 8);
+        szAtt[8] = 0;
 
-            for(unsigned int iPtr = 0 ; iPtr < ps52plib->pOBJLArray->GetCount() ; iPtr++)
-            {
-                pOLE = (OBJLElement *)(ps52plib->pOBJLArray->Item(iPtr));
-                if(!strncmp(pOLE->OBJLName, szFeatureName, 6))
-                {
-                    iOBJL = iPtr;
-                    bNeedNew = false;
-                    break;
-                }
-            }
+        S57attVal *pattValTmp = new S57attVal;
 
-            if(bNeedNew)
+        switch(ah.value_type)
+        {
+            case OGR_INT:
             {
-                pOLE = (OBJLElement *)malloc(sizeof(OBJLElement));
-                strcpy(pOLE->OBJLName, szFeatureName);
-                pOLE->nViz = 1;
+                int *pAVI = (int *)malloc(sizeof(int));
+                memcpy(pAVI, pvalue, sizeof(int));
+                pattValTmp->valType = OGR_INT;
+                pattValTmp->value   = pAVI;
 
-                ps52plib->pOBJLArray->Add((void *)pOLE);
-                iOBJL  = ps52plib->pOBJLArray->GetCount() - 1;
+    //      Capture SCAMIN on the fly during load
+                if(!strcmp(szAtt, "SCAMIN"))
+                    Scamin = *pAVI;
+                break;
             }
 
-
-    //      Walk thru the attributes, adding interesting ones
-            int hdr_len = 0;
-            char *mybuf_ptr = NULL;
-            char *hdr_end = NULL;
-
-            int prim = -1;
-            int attdun = 0;
-
-            strcpy(geoMatch, "Dummy");
-
-            while(!attdun)
+            case OGR_REAL:
             {
-                if(hdr_len)
-                {
-                    int nrl = my_bufgetl( mybuf_ptr, hdr_end, buf, MAX_LINE );
-                    mybuf_ptr += nrl;
-                    if(0 == nrl)
-                    {
-                        attdun = 1;
-                        my_fgets(buf, MAX_LINE, *pfpx);     // this will be PolyGeo
-                        break;
-                    }
-                }
-
-                else
-                    my_fgets(buf, MAX_LINE, *pfpx);
-
-
-                if(!strncmp(buf, "HDRLEN", 6))
-                {
-                    hdr_len = atoi(buf+7);
-                    hdr_buf = (char *)realloc(hdr_buf, hdr_len);
-                    pfpx->Read(hdr_buf, hdr_len);
-                    mybuf_ptr = hdr_buf;
-                    hdr_end = hdr_buf + hdr_len;
-                }
-
-                else if(!strncmp(buf, geoMatch, 6))
-                {
-                    attdun =1;
-                    break;
-                }
-
-                else if(!strncmp(buf, "  MULT", 6))         // Special multipoint
-                {
-                    bMulti = true;
-                    attdun =1;
-                    break;
-                }
-
-
-
-                else if(!strncmp(buf, "  PRIM", 6))
-                {
-                    prim = atoi(buf+13);
-                    switch(prim)
-                    {
-                        case 1:
-                        {
-                            strcpy(geoMatch, "  POIN");
-                            break;
-                        }
-
-                        case 2:                            // linestring
-                        {
-                            strcpy(geoMatch, "  LINE");
-                            break;
-                        }
-
-                        case 3:                            // area as polygon
-                        {
-                            strcpy(geoMatch, "  POLY");
-                            break;
-                        }
-
-                        default:                            // unrecognized
-                        {
-                            break;
-                        }
-
-                    }       //switch
-                }               // if PRIM
-
-
-                bool iua = IsUsefulAttribute(buf);
-
-                szAtt[0] = 0;
-
-                if(iua)
-                {
-                    S57attVal *pattValTmp = new S57attVal;
-
-                    if(buf[10] == 'I')
-                    {
-                        br = buf+2;
-                        int i=0;
-                        while(*br != ' ')
-                        {
-                            szAtt[i++] = *br;
-                            br++;
-                        }
-
-                        szAtt[i] = 0;
-
-                        while(*br != '=')
-                            br++;
-
-                        br += 2;
-
-                        int AValInt = atoi(br);
-                        int *pAVI = (int *)malloc(sizeof(int));         //new int;
-                        *pAVI = AValInt;
-                        pattValTmp->valType = OGR_INT;
-                        pattValTmp->value   = pAVI;
-
-    //      Capture SCAMIN on the fly during load
-                        if(!strcmp(szAtt, "SCAMIN"))
-                            Scamin = AValInt;
-                    }
-
-
-                    else if(buf[10] == 'S')
-                    {
-                        strncpy(szAtt, &buf[2], 6);
-                        szAtt[6] = 0;
-
-                        br = buf + 15;
-
-                        int nlen = strlen(br);
-                        br[nlen-1] = 0;                                 // dump the NL char
-                        char *pAVS = (char *)malloc(nlen + 1);          ;
-                        strcpy(pAVS, br);
-
-                        pattValTmp->valType = OGR_STR;
-                        pattValTmp->value   = pAVS;
-                    }
-
-
-                    else if(buf[10] == 'R')
-                    {
-                        br = buf+2;
-                        int i=0;
-                        while(*br != ' ')
-                        {
-                            szAtt[i++] = *br;
-                            br++;
-                        }
-
-                        szAtt[i] = 0;
-
-                        while(*br != '=')
-                            br++;
-
-                        br += 2;
-
-                        float AValfReal;
-                        sscanf(br, "%f", &AValfReal);
-
-                        double AValReal = AValfReal;        //FIXME this cast leaves trash in double
-
-                        double *pAVR = (double *)malloc(sizeof(double));   //new double;
-                        *pAVR = AValReal;
-
-                        pattValTmp->valType = OGR_REAL;
-                        pattValTmp->value   = pAVR;
-                    }
-
-                    else
-                    {
-                              // unknown attribute type
-    //                        CPLError((CPLErr)0, 0,"Unknown Attribute Type %s", buf);
-                    }
-
-
-                    if(strlen(szAtt))
-                    {
-                        attList->Append(wxString(szAtt, wxConvUTF8));
-                        attList->Append('\037');
-
-                        attVal->Add(pattValTmp);
-                    }
-                    else
-                        delete pattValTmp;
-
-                }        //useful
-            }               // while attdun
-
-
-
-    //              Develop Geometry
+                double *pAVR = (double *)malloc(sizeof(double));
+                memcpy(pAVR, pvalue, sizeof(double));
+                pattValTmp->valType = OGR_REAL;
+                pattValTmp->value   = pAVR;
+                break;
+            }
 
-            switch(prim)
+            default:                                    // OGR_STR, stored NUL terminated
             {
-                case 1:
-                {
-                    if(!bMulti)
-                    {
-                        Primitive_type = GEO_POINT;
-
-                        char tbuf[40];
-                        float point_ref_lat, point_ref_lon;
-                        sscanf(buf, "%s %f %f", tbuf, &point_ref_lat, &point_ref_lon);
-
-                        my_fgets(buf, MAX_LINE, *pfpx);
-                        int wkb_len = atoi(buf+2);
-                        pfpx->Read(buf,  wkb_len);
-
-                        npt  = 1;
-                        float *pfs = (float *)(buf + 5);                // point to the point
-
-                        float easting, northing;
-                        easting = *pfs++;
-                        northing = *pfs;
-
-                        x = easting;                                    // and save as SM
-                        y = northing;
-
-                        //  Convert from SM to lat/lon for bbox
-                        double xll, yll;
-                        fromSM(easting, northing, point_ref_lat, point_ref_lon, &yll, &xll);
-
-//                        BBObj.SetMin(xll, yll);
-//                        BBObj.SetMax(xll, yll);
-                        m_lon = xll;
-                        m_lat = yll;
-                        BBObj.SetMin(m_lon -.25, m_lat - .25);
-                        BBObj.SetMax(m_lon +.25, m_lat + .25);
-
-
-                    }
-                    else
-                    {
-                        Primitive_type = GEO_POINT;
-
-                        char tbuf[40];
-                        float point_ref_lat, point_ref_lon;
-                        sscanf(buf, "%s %f %f", tbuf, &point_ref_lat, &point_ref_lon);
-
-                        my_fgets(buf, MAX_LINE, *pfpx);
-                        int wkb_len = atoi(buf+2);
-                        pfpx->Read(buf,  wkb_len);
-
-                        npt = *((int *)(buf + 5));
-
-                        geoPtz = (double *)malloc(npt * 3 * sizeof(double));
-                        geoPtMulti = (double *)malloc(npt * 2 * sizeof(double));
-
-                        double *pdd = geoPtz;
-                        double *pdl = geoPtMulti;
-
-                        float *pfs = (float *)(buf + 9);                 // start of data
-                        for(int ip=0 ; ip<npt ; ip++)
-                        {
-                            float easting, northing;
-                            easting = *pfs++;
-                            northing = *pfs++;
-                            float depth = *pfs++;
-
-                            *pdd++ = easting;
-                            *pdd++ = northing;
-                            *pdd++ = depth;
-
-                        //  Convert point from SM to lat/lon for later use in decomposed bboxes
-                            double xll, yll;
-                            fromSM(easting, northing, point_ref_lat, point_ref_lon, &yll, &xll);
-
-                            *pdl++ = xll;
-                            *pdl++ = yll;
-                        }
-
-                        // Capture bbox limits recorded in SENC record as lon/lat
-                        float xmax = *pfs++;
-                        float xmin = *pfs++;
-                        float ymax = *pfs++;
-                        float ymin = *pfs;
-
-                        BBObj.SetMin(xmin, ymin);
-                        BBObj.SetMax(xmax, ymax);
-
-                    }
-                    break;
-                }
-
-                case 2:                                                // linestring
-                {
-                    Primitive_type = GEO_LINE;
-
-                    if(!strncmp(buf, "  LINESTRING", 12))
-                    {
-
-                          char tbuf[40];
-                          float line_ref_lat, line_ref_lon;
-                          sscanf(buf, "%s %f %f", tbuf, &line_ref_lat, &line_ref_lon);
-
-                          my_fgets(buf, MAX_LINE, *pfpx);
-                          int sb_len = atoi(buf+2);
-
-                          unsigned char *buft = (unsigned char *)malloc(sb_len);
-                          pfpx->Read(buft,  sb_len);
-
-                          npt = *((int *)(buft + 5));
-
-                          geoPt = (pt*)malloc((npt) * sizeof(pt));
-                          pt *ppt = geoPt;
-                          float *pf = (float *)(buft + 9);
-
-                              // Capture SM points
-                          for(int ip = 0 ; ip < npt ; ip++)
-                          {
-                              ppt->x = *pf++;
-                              ppt->y = *pf++;
-                              ppt++;
-                          }
-
-                          // Capture bbox limits recorded as lon/lat
-                          float xmax = *pf++;
-                          float xmin = *pf++;
-                          float ymax = *pf++;
-                          float ymin = *pf;
-
-                          delete buft;
-
-                          // set s57obj bbox as lat/lon
-                          BBObj.SetMin(xmin, ymin);
-                          BBObj.SetMax(xmax, ymax);
-                          bBBObj_valid = true;
-
-                          //  and declare x/y of the object to be average east/north of all points
-                          double e1, e2, n1, n2;
-                          toSM(ymax, xmax, line_ref_lat, line_ref_lon, &e1, &n1);
-                          toSM(ymin, xmin, line_ref_lat, line_ref_lon, &e2, &n2);
-
-                          x = (e1 + e2) / 2.;
-                          y = (n1 + n2) / 2.;
-
-                          //  Set the object base point
-                          double xll, yll;
-                          fromSM(x, y, line_ref_lat, line_ref_lon, &yll, &xll);
-                          m_lon = xll;
-                          m_lat = yll;
-
-                          //  Capture the edge and connected node table indices
-                          my_fgets(buf, MAX_LINE, *pfpx);     // this will be "\n"
-                          my_fgets(buf, MAX_LINE, *pfpx);     // this will be "LSINDEXLIST nnn"
+                char *pAVS = (char *)malloc(ah.value_bytes + 1);
+                memcpy(pAVS, pvalue, ah.value_bytes);
+                pAVS[ah.value_bytes] = 0;
+                pattValTmp->valType = OGR_STR;
+                pattValTmp->value   = pAVS;
+                break;
+            }
+        }
 
-//                          char test[100];
-//                          strncpy(test, buf, 98);
-//                          strcat(test, "\n");
-//                          printf("%s", test);
+        attList->Append(wxString(szAtt, wxConvUTF8));
+        attList->Append('\037');
 
-                          sscanf(buf, "%s %d ", tbuf, &m_n_lsindex);
+        attVal->Add(pattValTmp);
+    }
 
-                          m_lsindex_array = (int *)malloc(3 * m_n_lsindex * sizeof(int));
-                          pfpx->Read(m_lsindex_array,  3 * m_n_lsindex * sizeof(int));
-                          m_n_edge_max_points = 0;                //TODO this could be precalulated and added to next SENC format
+    //              Develop Geometry
 
-                          my_fgets(buf, MAX_LINE, *pfpx);     // this should be \n
+    float ftmp[4];
 
-                    }
+    float ref_lat = pfh->ref_lat;
+    float ref_lon = pfh->ref_lon;
 
-                   break;
-                }
+    switch(pfh->prim)
+    {
+        case 1:
+            Primitive_type = GEO_POINT;
+            break;
+        case 2:
+            Primitive_type = GEO_LINE;
+            break;
+        case 3:
+            Primitive_type = GEO_AREA;
+            break;
+        default:
+            break;
+    }
 
-                case 3:                                                                 // area as polygon
-                {
-// Debug hook
-//       if(!strncmp(obj->FeatureName, "DEPCNT", 6))
-//           int ffl = 4;
-//        if(FEIndex == 1226)
-//            int rrt = 5;
-                 Primitive_type = GEO_AREA;
+    switch(pfh->geom_type)
+    {
+        case SENC_GEOM_POINT:
+        {
+            npt  = 1;
 
-                    int ll = strlen(buf);
-                    if(ll > llmax)
-                        llmax = ll;
+            float easting, northing;
+            memcpy(ftmp, pfeature->ppoints, 2 * sizeof(float));
+            easting = ftmp[0];
+            northing = ftmp[1];
 
-                    my_fgets(buf, MAX_LINE, *pfpx);     // this will be "  POLYTESSGEO"
+            x = easting;                                    // and save as SM
+            y = northing;
 
-                    if(!strncmp(buf, "  POLYTESSGEO", 13))
-                    {
-                        float area_ref_lat, area_ref_lon;
-                        int nrecl;
-                        char tbuf[40];
+            //  Convert from SM to lat/lon for bbox
+            double xll, yll;
+            fromSM(easting, northing, ref_lat, ref_lon, &yll, &xll);
 
-                        sscanf(buf, " %s %d %f %f", tbuf, &nrecl, &area_ref_lat, &area_ref_lon);
+            m_lon = xll;
+            m_lat = yll;
+            BBObj.SetMin(m_lon -.25, m_lat - .25);
+            BBObj.SetMax(m_lon +.25, m_lat + .25);
 
-                        if (nrecl)
-                        {
-                            unsigned char *polybuf = (unsigned char *)malloc(nrecl + 1);
-                            pfpx->Read(polybuf,  nrecl);
-                            polybuf[nrecl] = 0;                     // endit
-                            PolyTessGeo *ppg = new PolyTessGeo(polybuf, nrecl, FEIndex);
-                            free(polybuf);
+            break;
+        }
 
-                            pPolyTessGeo = ppg;
+        case SENC_GEOM_MULTIPOINT:
+        {
+            if(!pfeature->npt)
+                break;
+            npt = pfeature->npt;
 
-                            //  Set the s57obj bounding box as lat/lon
-                            BBObj.SetMin(ppg->Get_xmin(), ppg->Get_ymin());
-                            BBObj.SetMax(ppg->Get_xmax(), ppg->Get_ymax());
-                            bBBObj_valid = true;
+            geoPtz = (double *)malloc(npt * 3 * sizeof(double));
+            geoPtMulti = (double *)malloc(npt * 2 * sizeof(double));
 
-                            //  and declare x/y of the object to be average east/north of all points
-                            double e1, e2, n1, n2;
-                            toSM(ppg->Get_ymax(), ppg->Get_xmax(), area_ref_lat, area_ref_lon, &e1, &n1);
-                            toSM(ppg->Get_ymin(), ppg->Get_xmin(), area_ref_lat, area_ref_lon, &e2, &n2);
+            double *pdd = geoPtz;
+            double *pdl = geoPtMulti;
 
-                            x = (e1 + e2) / 2.;
-                            y = (n1 + n2) / 2.;
+            float *pfs = (float *)malloc(npt * 3 * sizeof(float));
+            memcpy(pfs, pfeature->ppoints, npt * 3 * sizeof(float));
 
-                          //  Set the object base point
-                            double xll, yll;
-                            fromSM(x, y, area_ref_lat, area_ref_lon, &yll, &xll);
-                            m_lon = xll;
-                            m_lat = yll;
+            float *pf = pfs;
+            for(int ip=0 ; ip<npt ; ip++)
+            {
+                float easting, northing;
+                easting = *pf++;
+                northing = *pf++;
+                float depth = *pf++;
 
-                          //  Capture the edge and connected node table indices
-//                            my_fgets(buf, MAX_LINE, *pfpx);     // this will be "\n"
-                            my_fgets(buf, MAX_LINE, *pfpx);     // this will be "LSINDEXLIST nnn"
+                *pdd++ = easting;
+                *pdd++ = northing;
+                *pdd++ = depth;
 
-                            sscanf(buf, "%s %d ", tbuf, &m_n_lsindex);
+            //  Convert point from SM to lat/lon for later use in decomposed bboxes
+                double xll, yll;
+                fromSM(easting, northing, ref_lat, ref_lon, &yll, &xll);
 
-                            m_lsindex_array = (int *)malloc(3 * m_n_lsindex * sizeof(int));
-                            pfpx->Read(m_lsindex_array,  3 * m_n_lsindex * sizeof(int));
-                            m_n_edge_max_points = 0;                //TODO this could be precalulated and added to next SENC format
+                *pdl++ = xll;
+                *pdl++ = yll;
+            }
+            free(pfs);
 
-                            my_fgets(buf, MAX_LINE, *pfpx);     // this should be \n
+            // Capture bbox limits recorded in SENC record as lon/lat
+            memcpy(ftmp, pfeature->pbbox, 4 * sizeof(float));
 
-                        }
-                    }
+            BBObj.SetMin(ftmp[1], ftmp[3]);
+            BBObj.SetMax(ftmp[0], ftmp[2]);
 
-                    break;
-                }
-            }       //switch
+            break;
+        }
 
+        case SENC_GEOM_LINE:
+        {
+            npt = pfeature->npt;
 
+            geoPt = (pt*)malloc((npt) * sizeof(pt));
+            pt *ppt = geoPt;
 
+            float *pfs = (float *)malloc(npt * 2 * sizeof(float));
+            memcpy(pfs, pfeature->ppoints, npt * 2 * sizeof(float));
 
-            if(prim > 0)
+                  // Capture SM points
+            float *pf = pfs;
+            for(int ip = 0 ; ip < npt ; ip++)
             {
-               Index = FEIndex;
+                ppt->x = *pf++;
+                ppt->y = *pf++;
+                ppt++;
             }
-        }               //OGRF
-    }                       //while(!dun)
-
-    free( buf );
-    free(hdr_buf);
-
-}
-
-//-------------------------------------------------------------------------------------------
-//      Attributes in SENC file may not be needed, and can be safely ignored when creating S57Obj
-//      Look at a buffer, and return true or false according to a (default) definition
-//-------------------------------------------------------------------------------------------
-
-bool S57Obj::IsUsefulAttribute(char *buf)
-{
-
-    if(!strncmp(buf, "HDRLEN", 6))
-        return false;
-
-//      Dump the first 8 standard attributes
-    /* -------------------------------------------------------------------- */
-    /*      RCID                                                            */
-    /* -------------------------------------------------------------------- */
-    if(!strncmp(buf+2, "RCID", 4))
-        return false;
-
-    /* -------------------------------------------------------------------- */
-    /*      LNAM                                                            */
-    /* -------------------------------------------------------------------- */
-    if(!strncmp(buf+2, "LNAM", 4))
-        return false;
-
-    /* -------------------------------------------------------------------- */
-    /*      PRIM                                                            */
-    /* -------------------------------------------------------------------- */
-    else if(!strncmp(buf+2, "PRIM", 4))
-        return false;
-
-    /* -------------------------------------------------------------------- */
-    /*      SORDAT                                                          */
-    /* -------------------------------------------------------------------- */
-    else if(!strncmp(buf+2, "SORDAT", 6))
-        return false;
-
-    /* -------------------------------------------------------------------- */
-    /*      SORIND                                                          */
-    /* -------------------------------------------------------------------- */
-    else if(!strncmp(buf+2, "SORIND", 6))
-        return false;
-
-    //      All others are "Useful"
-    else
-        return true;
+            free(pfs);
 
-#if (0)
-    /* -------------------------------------------------------------------- */
-    /*      GRUP                                                            */
-    /* -------------------------------------------------------------------- */
-    else if(!strncmp(buf, "  GRUP", 6))
-        return false;
-
-    /* -------------------------------------------------------------------- */
-    /*      OBJL                                                            */
-    /* -------------------------------------------------------------------- */
-    else if(!strncmp(buf, "  OBJL", 6))
-        return false;
-
-    /* -------------------------------------------------------------------- */
-    /*      RVER                                                            */
-    /* -------------------------------------------------------------------- */
-    else if(!strncmp(buf, "  RVER", 6))
-        return false;
-
-    /* -------------------------------------------------------------------- */
-    /*      AGEN                                                            */
-    /* -------------------------------------------------------------------- */
-    else if(!strncmp(buf, "  AGEN", 6))
-        return false;
-
-    /* -------------------------------------------------------------------- */
-    /*      FIDN                                                            */
-    /* -------------------------------------------------------------------- */
-    else if(!strncmp(buf, "  FIDN", 6))
-        return false;
-
-    /* -------------------------------------------------------------------- */
-    /*      FIDS                                                            */
-    /* -------------------------------------------------------------------- */
-    else if(!strncmp(buf, "  FIDS", 6))
-        return false;
-
-//      UnPresent data
-    else if(strstr(buf, "(null)"))
-        return false;
+            // Capture bbox limits recorded as lon/lat
+            memcpy(ftmp, pfeature->pbbox, 4 * sizeof(float));
 
-    else
-        return true;
-#endif
-}
+            float xmax = ftmp[0];
+            float xmin = ftmp[1];
+            float ymax = ftmp[2];
+            float ymin = ftmp[3];
 
-//------------------------------------------------------------------------------
-//      Local version of fgets for Binary Mode (SENC) file
-//------------------------------------------------------------------------------
- int S57Obj::my_fgets( char *buf, int buf_len_max, wxInputStream& ifs )
+            // set s57obj bbox as lat/lon
+            BBObj.SetMin(xmin, ymin);
+            BBObj.SetMax(xmax, ymax);
+            bBBObj_valid = true;
 
-{
-    char        chNext;
-    int         nLineLen = 0;
-    char            *lbuf;
+            //  and declare x/y of the object to be average east/north of all points
+            double e1, e2, n1, n2;
+            toSM(ymax, xmax, ref_lat, ref_lon, &e1, &n1);
+            toSM(ymin, xmin, ref_lat, ref_lon, &e2, &n2);
 
-    lbuf = buf;
+            x = (e1 + e2) / 2.;
+            y = (n1 + n2) / 2.;
 
+            //  Set the object base point
+            double xll, yll;
+            fromSM(x, y, ref_lat, ref_lon, &yll, &xll);
+            m_lon = xll;
+            m_lat = yll;
 
-    while( !ifs.Eof() && nLineLen < buf_len_max )
-    {
-        chNext = (char)ifs.GetC();
+            //  Capture the edge and connected node table indices
+            if(pfeature->n_lsindex)
+            {
+                m_n_lsindex = pfeature->n_lsindex;
+                m_lsindex_array = (int *)malloc(3 * m_n_lsindex * sizeof(int));
+                memcpy(m_lsindex_array, pfeature->plsindex, 3 * m_n_lsindex * sizeof(int));
+            }
+            m_n_edge_max_points = 0;                //TODO this could be precalulated and added to next SENC format
 
-        /* each CR/LF (or LF/CR) as if just "CR" */
-        if( chNext == 10 || chNext == 13 )
-        {
-            chNext = '\n';
+            break;
         }
 
-        *lbuf = chNext; lbuf++, nLineLen++;
-
-        if( chNext == '\n' )
+        case SENC_GEOM_AREA:
         {
-            *lbuf = '\0';
-            return nLineLen;
-        }
-    }
+            if(!pfeature->btess)                    // the area failed to tesselate when the SENC was made
+                break;
 
-    *(lbuf) = '\0';
+            PolyTessGeo *ppg = new PolyTessGeo(&pfeature->tess, FEIndex);
+            pPolyTessGeo = ppg;
 
-    return nLineLen;
-}
+            //  Set the s57obj bounding box as lat/lon
+            BBObj.SetMin(ppg->Get_xmin(), ppg->Get_ymin());
+            BBObj.SetMax(ppg->Get_xmax(), ppg->Get_ymax());
+            bBBObj_valid = true;
 
-//------------------------------------------------------------------------------
-//      Local version of bufgetl for Binary Mode (SENC) file
-//------------------------------------------------------------------------------
- int S57Obj::my_bufgetl( char *ib_read, char *ib_end, char *buf, int buf_len_max )
-{
-    char        chNext;
-    int         nLineLen = 0;
-    char        *lbuf;
-    char        *ibr = ib_read;
+            //  and declare x/y of the object to be average east/north of all points
+            double e1, e2, n1, n2;
+            toSM(ppg->Get_ymax(), ppg->Get_xmax(), ref_lat, ref_lon, &e1, &n1);
+            toSM(ppg->Get_ymin(), ppg->Get_xmin(), ref_lat, ref_lon, &e2, &n2);
 
-    lbuf = buf;
+            x = (e1 + e2) / 2.;
+            y = (n1 + n2) / 2.;
 
+            //  Set the object base point
+            double xll, yll;
+            fromSM(x, y, ref_lat, ref_lon, &yll, &xll);
+            m_lon = xll;
+            m_lat = yll;
 
-    while( (nLineLen < buf_len_max) && (ibr < ib_end))
-    {
-        chNext = *ibr++;
-
-        /* each CR/LF (or LF/CR) as if just "CR" */
-        if( chNext == 10 || chNext == 13 )
-            chNext = '\n';
-
-        *lbuf++ = chNext;
-        nLineLen++;
+            //  Capture the edge and connected node table indices
+            if(pfeature->n_lsindex)
+            {
+                m_n_lsindex = pfeature->n_lsindex;
+                m_lsindex_array = (int *)malloc(3 * m_n_lsindex * sizeof(int));
+                memcpy(m_lsindex_array, pfeature->plsindex, 3 * m_n_lsindex * sizeof(int));
+            }
+            m_n_edge_max_points = 0;                //TODO this could be precalulated and added to next SENC format
 
-        if( chNext == '\n' )
-        {
-            *lbuf = '\0';
-            return nLineLen;
+            break;
         }
+
+        default:                                    // no geometry was recorded
+            break;
     }
 
-    *(lbuf) = '\0';
-    return nLineLen;
+    if(pfh->prim > 0)
+        Index = FEIndex;
 }
 
 wxString S57Obj::GetAttrValueAsString ( char *AttrName )
@@ -993,6 +801,8 @@ wxString S57Obj::GetAttrValueAsString ( char *AttrName )
 
 render_canvas_parms::render_canvas_parms()
 {
+      pledge = NULL;
+      predge = NULL;
 }
 
 render_canvas_parms::render_canvas_parms(int xr, int yr, int widthr, int heightr, wxColour color)
@@ -1006,6 +816,8 @@ render_canvas_parms::render_canvas_parms(int xr, int yr, int widthr, int heightr
       height = heightr;
       x = xr;
       y = yr;
+      pledge = NULL;
+      predge = NULL;
 
       unsigned char r, g, b;
       if(color.IsOk())
@@ -1105,6 +917,11 @@ s57chart::s57chart()
     else
           m_plib_state_hash = 0;
 
+    m_object_mem_size = 0;
+    m_bobject_mem_valid = false;
+
+    m_tile_x0 = 0;
+    m_tile_y0 = 0;
 
 }
 
@@ -1115,6 +932,9 @@ s57chart::~s57chart()
 
     delete pDIB;
 
+    if(g_pS57TileCache)
+          g_pS57TileCache->PurgeChart(this);
+
     delete m_pCloneBM;
 //    delete pFullPath;
 
@@ -1324,8 +1144,89 @@ void s57chart::FreeObjectsAndRules()
             }
         }
     }
+
+    m_bobject_mem_valid = false;
  }
 
+//    Estimate the heap memory used by one S57Obj and its geometry
+static size_t GetS57ObjMemorySize(S57Obj *obj)
+{
+      size_t size = sizeof(S57Obj);
+
+      if(obj->geoPt)
+            size += obj->npt * sizeof(pt);
+      if(obj->geoPtz)
+            size += obj->npt * 3 * sizeof(double);
+      if(obj->geoPtMulti)
+            size += obj->npt * 2 * sizeof(double);
+      if(obj->m_lsindex_array)
+            size += obj->m_n_lsindex * 3 * sizeof(int);
+
+      if(obj->attList)
+            size += obj->attList->Len() * sizeof(wxChar);
+      if(obj->attVal)
+            size += obj->attVal->GetCount() * sizeof(S57attVal);
+
+      if(obj->pPolyTessGeo)
+      {
+            PolyTriGroup *ppg = obj->pPolyTessGeo->Get_PolyTriGroup_head();
+            if(ppg)
+            {
+                  for(int ic = 0 ; ic < ppg->nContours ; ic++)
+                        size += ppg->pn_vertex[ic] * 2 * sizeof(float);
+
+                  TriPrim *p_tp = ppg->tri_prim_head;
+                  while(p_tp)
+                  {
+                        size += sizeof(TriPrim) + (p_tp->nVert * 2 * sizeof(double));
+                        p_tp = p_tp->p_next;
+                  }
+            }
+      }
+
+      return size;
+}
+
+size_t s57chart::GetMemoryFootprint()
+{
+      //    The object list only changes on load, so walk it once and remember the result
+      if(!m_bobject_mem_valid)
+      {
+            size_t size = 0;
+            for (int i=0; i<PRIO_NUM; ++i)
+            {
+                  for(int j=0 ; j<LUPNAME_NUM ; j++)
+                  {
+                        ObjRazRules *top = razRules[i][j];
+                        while ( top != NULL)
+                        {
+                              //    Objects are shared between rule lists, so charge each list a share
+                              size += sizeof(ObjRazRules);
+                              if(top->obj->nRef > 0)
+                                    size += GetS57ObjMemorySize(top->obj) / top->obj->nRef;
+
+                              top = top->next;
+                        }
+                  }
+            }
+
+            VE_Hash::iterator itve;
+            for( itve = m_ve_hash.begin(); itve != m_ve_hash.end(); ++itve )
+                  size += sizeof(VE_Element) + (itve->second->nCount * 2 * sizeof(double));
+
+            size += m_vc_hash.size() * (sizeof(VC_Element) + 2 * sizeof(double));
+
+            m_object_mem_size = size;
+            m_bobject_mem_valid = true;
+      }
+
+      size_t size = m_object_mem_size;
+      if(pDIB)
+            size += pDIB->GetLinePitch() * pDIB->GetHeight();
+
+      return size;
+}
+
  void s57chart::ClearRenderedTextCache()
  {
        ObjRazRules *top;
@@ -1746,6 +1647,12 @@ bool s57chart::RenderViewOnDC(wxMemoryDC& dc, const ViewPort& VPoint)
 
 bool s57chart::DoRenderViewOnDC(wxMemoryDC& dc, const ViewPort& VPoint, RenderTypeEnum option, bool force_new_view)
 {
+    //      Compose the view from cached tiles where possible.
+    //      cm93 charts load cells and rebase objects as the viewport moves, so they keep the single view cache.
+    //      Very small scales are also excluded, as for the view cache below.
+    if(g_pS57TileCache && (m_ChartType == CHART_TYPE_S57) && (VPoint.chart_scale <= 1e8))
+          return DoRenderTiledViewOnDC(dc, VPoint, force_new_view);
+
     bool bnewview = false;
     wxPoint rul, rlr;
     bool bNewVP = false;
@@ -1894,74 +1801,290 @@ bool s57chart::DoRenderViewOnDC(wxMemoryDC& dc, const ViewPort& VPoint, RenderTy
         {
             wxRect rect = upd.GetRect();
 
-//      Build temp ViewPort on this region
+//      Build temp ViewPort on this region
+
+            ViewPort temp_vp = VPoint;
+            double temp_lon_left, temp_lat_bot, temp_lon_right, temp_lat_top;
+
+            double temp_northing_ul = prev_northing_ul - (rul.y / m_view_scale_ppm) - (rect.y / m_view_scale_ppm);
+            double temp_easting_ul = prev_easting_ul + (rul.x / m_view_scale_ppm) + (rect.x / m_view_scale_ppm);
+            fromSM(temp_easting_ul, temp_northing_ul, ref_lat, ref_lon, &temp_lat_top, &temp_lon_left);
+
+            double temp_northing_lr = temp_northing_ul - (rect.height / m_view_scale_ppm);
+            double temp_easting_lr = temp_easting_ul + (rect.width / m_view_scale_ppm);
+            fromSM(temp_easting_lr, temp_northing_lr, ref_lat, ref_lon, &temp_lat_bot, &temp_lon_right);
+
+            temp_vp.GetBBox().SetMin(temp_lon_left, temp_lat_bot);
+            temp_vp.GetBBox().SetMax(temp_lon_right, temp_lat_top);
+
+            //      Allow some slop in the viewport
+            //    TODO Investigate why this fails if greater than 5 percent
+            double margin = wxMin(temp_vp.GetBBox().GetWidth(), temp_vp.GetBBox().GetHeight()) * 0.05;
+            temp_vp.GetBBox().EnLarge(margin);
+
+//      And Render it new piece on the target dc
+//     printf("New Render, rendering %d %d %d %d \n", rect.x, rect.y, rect.width, rect.height);
+
+            DCRenderRect(dc, temp_vp, &rect, S52_DRAW_ALL);
+
+            upd ++ ;
+        }
+
+        dc.SelectObject(wxNullBitmap);
+
+        bnewview = true;
+
+//      Update last_vp to reflect the current cached bitmap
+        m_last_vp = VPoint;
+
+    }
+
+    else if(bNewVP || (NULL == pDIB))
+    {
+        delete pDIB;
+        pDIB = new PixelCache(VPoint.pix_width, VPoint.pix_height, BPP);     // destination
+
+        wxRect full_rect(0, 0,VPoint.pix_width, VPoint.pix_height);
+        pDIB->SelectIntoDC(dc);
+
+        //        Clear the text declutter list
+        ps52plib->ClearTextList();
+
+        DCRenderRect(dc, VPoint, &full_rect, S52_DRAW_ALL);
+
+        dc.SelectObject(wxNullBitmap);
+
+        bnewview = true;
+
+//      Update last_vp to reflect the current cached bitmap
+        m_last_vp = VPoint;
+
+    }
+
+
+        return bnewview;
+
+
+}
+
+
+//-----------------------------------------------------------------------------------------------
+//    Build pDIB from S57_TILE_SIZE square tiles, rendering only those not found in the tile cache.
+//    Tiles are aligned to a pixel grid whose origin is the chart reference point, so a tile
+//    rendered for one viewport is reused unchanged by any other viewport at the same scale.
+//    Assumes SetVPParms(VPoint) has been called.
+//-----------------------------------------------------------------------------------------------
+bool s57chart::DoRenderTiledViewOnDC(wxMemoryDC& dc, const ViewPort& VPoint, bool force_new_view)
+{
+    bool bReallyNew = false;
+
+    if(ps52plib->GetShowS57Text() != m_blastS57TextRender)
+          bReallyNew = true;
+    m_blastS57TextRender = ps52plib->GetShowS57Text();
+
+    if(ps52plib->GetPLIBColorScheme() != m_lastColorScheme)
+          bReallyNew = true;
+    m_lastColorScheme = ps52plib->GetPLIBColorScheme();
+
+    if(VPoint.view_scale_ppm != m_last_vp.view_scale_ppm)
+          bReallyNew = true;
 
-            ViewPort temp_vp = VPoint;
-            double temp_lon_left, temp_lat_bot, temp_lon_right, temp_lat_top;
+    wxRect dest(0,0,VPoint.pix_width, VPoint.pix_height);
+    if(m_last_vprect != dest)
+          bReallyNew = true;
+    m_last_vprect = dest;
 
-            double temp_northing_ul = prev_northing_ul - (rul.y / m_view_scale_ppm) - (rect.y / m_view_scale_ppm);
-            double temp_easting_ul = prev_easting_ul + (rul.x / m_view_scale_ppm) + (rect.x / m_view_scale_ppm);
-            fromSM(temp_easting_ul, temp_northing_ul, ref_lat, ref_lon, &temp_lat_top, &temp_lon_left);
+    if(m_plib_state_hash != ps52plib->GetStateHash())
+    {
+          bReallyNew = true;
+          m_plib_state_hash = ps52plib->GetStateHash();
+    }
 
-            double temp_northing_lr = temp_northing_ul - (rect.height / m_view_scale_ppm);
-            double temp_easting_lr = temp_easting_ul + (rect.width / m_view_scale_ppm);
-            fromSM(temp_easting_lr, temp_northing_lr, ref_lat, ref_lon, &temp_lat_bot, &temp_lon_right);
+    //      Position of the viewport origin on the tile pixel grid
+    int x0 = (int)floor((m_easting_vp_center * m_view_scale_ppm) - m_pixx_vp_center + 0.5);
+    int y0 = (int)floor((-m_northing_vp_center * m_view_scale_ppm) - m_pixy_vp_center + 0.5);
 
-            temp_vp.GetBBox().SetMin(temp_lon_left, temp_lat_bot);
-            temp_vp.GetBBox().SetMax(temp_lon_right, temp_lat_top);
+    if(!bReallyNew && !force_new_view && pDIB && m_last_vp.IsValid() && (x0 == m_tile_x0) && (y0 == m_tile_y0))
+          return false;
 
-            //      Allow some slop in the viewport
-            //    TODO Investigate why this fails if greater than 5 percent
-            double margin = wxMin(temp_vp.GetBBox().GetWidth(), temp_vp.GetBBox().GetHeight()) * 0.05;
-            temp_vp.GetBBox().EnLarge(margin);
+    if(pDIB && ((pDIB->GetWidth() != VPoint.pix_width) || (pDIB->GetHeight() != VPoint.pix_height)))
+    {
+          delete pDIB;
+          pDIB = NULL;
+    }
+    if(NULL == pDIB)
+          pDIB = new PixelCache(VPoint.pix_width, VPoint.pix_height, BPP);
 
-//      And Render it new piece on the target dc
-//     printf("New Render, rendering %d %d %d %d \n", rect.x, rect.y, rect.width, rect.height);
+    S57TileKey key;
+    key.pChart = this;
+    key.scale_ppm = VPoint.view_scale_ppm;
+    key.plib_state_hash = m_plib_state_hash;
+    key.palette_hash = wxStringHash::stringHash(m_lastColorScheme.c_str());
 
-            DCRenderRect(dc, temp_vp, &rect);
+    int tx0 = (int)floor((double)x0 / S57_TILE_SIZE);
+    int ty0 = (int)floor((double)y0 / S57_TILE_SIZE);
+    int tx1 = (int)floor((double)(x0 + VPoint.pix_width - 1) / S57_TILE_SIZE);
+    int ty1 = (int)floor((double)(y0 + VPoint.pix_height - 1) / S57_TILE_SIZE);
 
-            upd ++ ;
-        }
+    bool brendered = false;
 
-        dc.SelectObject(wxNullBitmap);
+    pDIB->SelectIntoDC(dc);
 
-        bnewview = true;
+    for(int ty = ty0 ; ty <= ty1 ; ty++)
+    {
+          for(int tx = tx0 ; tx <= tx1 ; tx++)
+          {
+                key.tx = tx;
+                key.ty = ty;
 
-//      Update last_vp to reflect the current cached bitmap
-        m_last_vp = VPoint;
+                PixelCache *ptile = g_pS57TileCache->Find(key);
+                if(NULL == ptile)
+                {
+                      ptile = RenderTile(VPoint, tx, ty);
+                      g_pS57TileCache->Add(key, ptile);
+                      brendered = true;
+                }
 
+                ocpnMemDC dc_tile;
+                ptile->SelectIntoDC(dc_tile);
+                dc.Blit((tx * S57_TILE_SIZE) - x0, (ty * S57_TILE_SIZE) - y0, S57_TILE_SIZE, S57_TILE_SIZE,
+                        (wxDC *)&dc_tile, 0, 0);
+                dc_tile.SelectObject(wxNullBitmap);
+          }
     }
 
-    else if(bNewVP || (NULL == pDIB))
-    {
-        delete pDIB;
-        pDIB = new PixelCache(VPoint.pix_width, VPoint.pix_height, BPP);     // destination
+    //    RenderTile() moved the rendering constants
+    if(brendered)
+          SetVPParms(VPoint);
 
-        wxRect full_rect(0, 0,VPoint.pix_width, VPoint.pix_height);
-        pDIB->SelectIntoDC(dc);
+    //    Symbols and text over the whole view, decluttered together
+    ps52plib->ClearTextList();
+    wxRect full_rect(0, 0, VPoint.pix_width, VPoint.pix_height);
+    DCRenderLPB(dc, VPoint, &full_rect, S52_DRAW_SYMBOLS);
 
-        //        Clear the text declutter list
-        ps52plib->ClearTextList();
+    dc.SelectObject(wxNullBitmap);
 
-        DCRenderRect(dc, VPoint, &full_rect);
+    m_tile_x0 = x0;
+    m_tile_y0 = y0;
 
-        dc.SelectObject(wxNullBitmap);
+//      Update last_vp to reflect the current cached bitmap
+    m_last_vp = VPoint;
 
-        bnewview = true;
+    return true;
+}
 
-//      Update last_vp to reflect the current cached bitmap
-        m_last_vp = VPoint;
+//-----------------------------------------------------------------------------------------------
+//    Render one tile of the tile grid at VPoint's scale.
+//    Only the area fills and the lines of line and area features are drawn.
+//    The tile is drawn with an S57_TILE_GUTTER margin all around, and the margin then discarded,
+//    so that lines just outside the tile are still drawn where their width overlaps it.
+//-----------------------------------------------------------------------------------------------
+PixelCache *s57chart::RenderTile(const ViewPort& VPoint, int tx, int ty)
+{
+    int size = S57_TILE_SIZE + (2 * S57_TILE_GUTTER);
+    double ppm = VPoint.view_scale_ppm;
+
+    //      Set the SM rendering constants so that pixel S57_TILE_GUTTER of the render
+    //      falls exactly on the first pixel of the tile
+    m_view_scale_ppm = ppm;
+    m_pixx_vp_center = size / 2;
+    m_pixy_vp_center = size / 2;
+    m_easting_vp_center = ((tx * S57_TILE_SIZE) + (S57_TILE_SIZE / 2)) / ppm;
+    m_northing_vp_center = -((ty * S57_TILE_SIZE) + (S57_TILE_SIZE / 2)) / ppm;
+
+    //      Build a ViewPort for the whole render area
+    ViewPort tile_vp = VPoint;
+    tile_vp.pix_width = size;
+    tile_vp.pix_height = size;
+    fromSM(m_easting_vp_center, m_northing_vp_center, ref_lat, ref_lon, &tile_vp.clat, &tile_vp.clon);
+
+    double half = (size / 2) / ppm;
+    double lat_top, lon_left, lat_bot, lon_right;
+    fromSM(m_easting_vp_center - half, m_northing_vp_center + half, ref_lat, ref_lon, &lat_top, &lon_left);
+    fromSM(m_easting_vp_center + half, m_northing_vp_center - half, ref_lat, ref_lon, &lat_bot, &lon_right);
+
+    tile_vp.GetBBox().SetMin(lon_left, lat_bot);
+    tile_vp.GetBBox().SetMax(lon_right, lat_top);
+
+    PixelCache *pRender = new PixelCache(size, size, BPP);
+    ocpnMemDC dc_render;
+    pRender->SelectIntoDC(dc_render);
+
+    wxRect rect(0, 0, size, size);
+    DCRenderRect(dc_render, tile_vp, &rect, S52_DRAW_LINES);
+
+    //      Keep only the tile proper
+    PixelCache *pTile = new PixelCache(S57_TILE_SIZE, S57_TILE_SIZE, BPP);
+    ocpnMemDC dc_tile;
+    pTile->SelectIntoDC(dc_tile);
+    dc_tile.Blit(0, 0, S57_TILE_SIZE, S57_TILE_SIZE, (wxDC *)&dc_render, S57_TILE_GUTTER, S57_TILE_GUTTER);
+
+    dc_tile.SelectObject(wxNullBitmap);
+    dc_render.SelectObject(wxNullBitmap);
+
+    delete pRender;
+
+    return pTile;
+}
 
-    }
 
+//-----------------------------------------------------------------------
+//    Number of row bands to use for the area fills of an n_rows render
+//-----------------------------------------------------------------------
+static int GetAreaFillThreadCount(int n_rows)
+{
+      int n_cpu = wxThread::GetCPUCount();
+      if(n_cpu < 2)
+            return 1;
+
+      int n_threads = wxMin(n_cpu, MAX_AREA_FILL_THREADS);
+      n_threads = wxMin(n_threads, n_rows / MIN_AREA_FILL_BAND);
 
-        return bnewview;
+      return wxMax(n_threads, 1);
+}
 
+//-----------------------------------------------------------------------
+//    Background fill and area fills for one row band of s57chart::DCRenderRect()
+//-----------------------------------------------------------------------
+static void RenderAreaFillBand(ArrayOfAreaFills *plist, ViewPort *pvp, render_canvas_parms *pb_spec,
+                               unsigned char r, unsigned char g, unsigned char b)
+{
+      ocpnFillPixelRect(pb_spec->pix_buff, pb_spec->pb_pitch, pb_spec->width, pb_spec->height, pb_spec->depth,
+                        r, g, b);
 
+      ps52plib->RenderAreaFillList(plist, pvp, pb_spec);
 }
 
+class S57AreaFillThread: public wxThread
+{
+public:
+      S57AreaFillThread(ArrayOfAreaFills *plist, ViewPort *pvp, render_canvas_parms& band_spec,
+                        unsigned char r, unsigned char g, unsigned char b)
+            : wxThread(wxTHREAD_JOINABLE)
+      {
+            m_plist = plist;
+            m_pvp = pvp;
+            m_band_spec = band_spec;
+            m_r = r;
+            m_g = g;
+            m_b = b;
+      }
+
+      void *Entry()
+      {
+            RenderAreaFillBand(m_plist, m_pvp, &m_band_spec, m_r, m_g, m_b);
+            return 0;
+      }
+
+private:
+      ArrayOfAreaFills        *m_plist;
+      ViewPort                *m_pvp;
+      render_canvas_parms     m_band_spec;
+      unsigned char           m_r, m_g, m_b;
+};
 
-int s57chart::DCRenderRect(wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect)
+
+int s57chart::DCRenderRect(wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect, int draw_rules)
 {
 
     int i;
@@ -1980,13 +2103,13 @@ int s57chart::DCRenderRect(wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect
     pb_spec.pb_pitch = ((rect->width * pb_spec.depth / 8 ));
     pb_spec.lclip = rect->x;
     pb_spec.rclip = rect->x + rect->width - 1;
-    pb_spec.pix_buff = (unsigned char *)malloc(rect->height * pb_spec.pb_pitch);
+    pb_spec.pix_buff = ocpnGetPixelBuffer(rect->height * pb_spec.pb_pitch);
     pb_spec.width = rect->width;
     pb_spec.height = rect->height;
     pb_spec.x = rect->x;
     pb_spec.y = rect->y;
 
-    // Preset background
+    // Background color
     wxColour color = GetGlobalColor ( _T ( "NODTA" ) );
     unsigned char r, g, b;
     if(color.IsOk())
@@ -1998,49 +2121,116 @@ int s57chart::DCRenderRect(wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect
     else
           r=g=b=0;
 
-
-    if(pb_spec.depth == 24)
+//      Render the areas quickly
+//      Where there is more than one CPU, the fills are first collected in priority order,
+//      then rasterized in row bands concurrently.
+//      At very small scales, area fills may wrap around the world, and are done serially.
+    int n_threads = 1;
+    if(vp.chart_scale <= 5e7)
+          n_threads = GetAreaFillThreadCount(pb_spec.height);
+
+    ArrayOfAreaFills fill_list;
+    if(n_threads > 1)
     {
-          for(int i=0 ; i < pb_spec.height ; i++)
+          ps52plib->BeginAreaFillList(&fill_list);
+
+          for (i=0; i<PRIO_NUM; ++i)
           {
-                unsigned char *p = pb_spec.pix_buff + (i * pb_spec.pb_pitch);
-                for(int j=0 ; j < pb_spec.width ; j++)
+                if(ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES)
+                      top = razRules[i][4];           // Area Symbolized Boundaries
+                else
+                      top = razRules[i][3];           // Area Plain Boundaries
+
+                while ( top != NULL)
                 {
-                      *p++ = r;
-                      *p++ = g;
-                      *p++ = b;
+                      crnt = top;
+                      top  = top->next;               // next object
+                      ps52plib->RenderArea(&dcinput, crnt, &tvp, &pb_spec);
                 }
           }
+
+          ps52plib->EndAreaFillList();
     }
-    else
+
+    if(fill_list.GetCount())
     {
-          int  color_int = ( ( r ) << 16 ) + ( ( g ) << 8 ) + ( b );
+          //    Split the canvas into row bands, one per thread.
+          //    Each band has its own edge arrays, and clips to its own rows,
+          //    so the result is the same as the serial path, pixel for pixel.
+          S57AreaFillThread *pthreads[MAX_AREA_FILL_THREADS];
+          render_canvas_parms band_specs[MAX_AREA_FILL_THREADS];
+
+          int band_height = (pb_spec.height + n_threads - 1) / n_threads;
+
+          for(int it=0 ; it < n_threads ; it++)
+          {
+                pthreads[it] = NULL;
 
-          for(int i=0 ; i < pb_spec.height ; i++)
+                int y_start = it * band_height;
+                int y_end = wxMin(y_start + band_height, pb_spec.height);
+
+                band_specs[it] = pb_spec;
+                band_specs[it].y = pb_spec.y + y_start;
+                band_specs[it].height = wxMax(y_end - y_start, 0);
+                band_specs[it].pix_buff = pb_spec.pix_buff + (y_start * pb_spec.pb_pitch);
+                band_specs[it].pledge = (int *)malloc(PLIB_EDGE_ARRAY_SIZE * sizeof(int));
+                band_specs[it].predge = (int *)malloc(PLIB_EDGE_ARRAY_SIZE * sizeof(int));
+          }
+
+          //    The calling thread takes the first band
+          for(int it=1 ; it < n_threads ; it++)
           {
-                int *p = (int *) (pb_spec.pix_buff + (i * pb_spec.pb_pitch));
-                for(int j=0 ; j < pb_spec.width ; j++)
+                if(0 == band_specs[it].height)
+                      break;
+
+                S57AreaFillThread *pt = new S57AreaFillThread(&fill_list, &tvp, band_specs[it], r, g, b);
+
+                if((pt->Create() != wxTHREAD_NO_ERROR) || (pt->Run() != wxTHREAD_NO_ERROR))
                 {
-                      *p++ = color_int;
+                      delete pt;                    // do it here instead
+                      RenderAreaFillBand(&fill_list, &tvp, &band_specs[it], r, g, b);
                 }
+                else
+                      pthreads[it] = pt;
           }
-    }
 
+          RenderAreaFillBand(&fill_list, &tvp, &band_specs[0], r, g, b);
 
+          for(int it=0 ; it < n_threads ; it++)
+          {
+                if(pthreads[it])
+                {
+                      pthreads[it]->Wait();
+                      delete pthreads[it];
+                }
+                free(band_specs[it].pledge);
+                free(band_specs[it].predge);
+          }
 
-//      Render the areas quickly
-    for (i=0; i<PRIO_NUM; ++i)
+          ps52plib->ClearAreaFillList(&fill_list);
+    }
+    else
     {
-          if(ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES)
-                top = razRules[i][4];           // Area Symbolized Boundaries
-          else
-                top = razRules[i][3];           // Area Plain Boundaries
+          // Preset background
+          ocpnFillPixelRect(pb_spec.pix_buff, pb_spec.pb_pitch, pb_spec.width, pb_spec.height, pb_spec.depth,
+                            r, g, b);
 
-          while ( top != NULL)
+          if(n_threads == 1)
           {
-                crnt = top;
-                top  = top->next;               // next object
-                ps52plib->RenderArea(&dcinput, crnt, &tvp, &pb_spec);
+                for (i=0; i<PRIO_NUM; ++i)
+                {
+                      if(ps52plib->m_nBoundaryStyle == SYMBOLIZED_BOUNDARIES)
+                            top = razRules[i][4];           // Area Symbolized Boundaries
+                      else
+                            top = razRules[i][3];           // Area Plain Boundaries
+
+                      while ( top != NULL)
+                      {
+                            crnt = top;
+                            top  = top->next;               // next object
+                            ps52plib->RenderArea(&dcinput, crnt, &tvp, &pb_spec);
+                      }
+                }
           }
     }
 
@@ -2051,7 +2241,7 @@ int s57chart::DCRenderRect(wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect
         ocpnBitmap *pREN = new ocpnBitmap(pb_spec.pix_buff, pb_spec.width, pb_spec.height, pb_spec.depth);
 #else
         wxImage *prender_image = new wxImage(pb_spec.width, pb_spec.height, false);
-        prender_image->SetData((unsigned char*)pb_spec.pix_buff);
+        prender_image->SetData((unsigned char*)pb_spec.pix_buff, true);       // the buffer belongs to the pool
         wxBitmap *pREN = new wxBitmap(*prender_image);
 
 #endif
@@ -2068,22 +2258,20 @@ int s57chart::DCRenderRect(wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect
         dc_ren.SelectObject(wxNullBitmap);
 
 
-#ifdef ocpnUSE_ocpnBitmap
-        free(pb_spec.pix_buff);
-#else
-        delete prender_image;           // the image owns the data
-                                        // and so will free it in due course
+#ifndef ocpnUSE_ocpnBitmap
+        delete prender_image;
 #endif
+        ocpnReleasePixelBuffer(pb_spec.pix_buff);
 
         delete pREN;
 
 //      Render the rest of the objects/primitives
-        DCRenderLPB(dcinput, vp, rect);
+        DCRenderLPB(dcinput, vp, rect, draw_rules);
 
         return 1;
 }
 
-bool s57chart::DCRenderLPB(wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect)
+bool s57chart::DCRenderLPB(wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect, int draw_rules)
 {
     int i;
     ObjRazRules *top;
@@ -2110,7 +2298,7 @@ bool s57chart::DCRenderLPB(wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect
         {
               crnt = top;
               top  = top->next;               // next object
-              ps52plib->_draw(&dcinput, crnt, &tvp);
+              ps52plib->_draw(&dcinput, crnt, &tvp, draw_rules);
         }
 
         top = razRules[i][2];           //LINES
@@ -2118,11 +2306,13 @@ bool s57chart::DCRenderLPB(wxMemoryDC& dcinput, const ViewPort& vp, wxRect* rect
         {
             ObjRazRules *crnt = top;
             top  = top->next;
-            ps52plib->_draw(&dcinput, crnt, &tvp);
+            ps52plib->_draw(&dcinput, crnt, &tvp, draw_rules);
         }
 
-
-        if(ps52plib->m_nSymbolStyle == SIMPLIFIED)
+        //      Point features go with the symbols, sector legs and all
+        if(!(draw_rules & S52_DRAW_SYMBOLS))
+              top = NULL;
+        else if(ps52plib->m_nSymbolStyle == SIMPLIFIED)
               top = razRules[i][0];           //SIMPLIFIED Points
         else
               top = razRules[i][1];           //Paper Chart Points Points
@@ -2284,7 +2474,8 @@ InitReturn s57chart::FindOrCreateSenc( const wxString& name )
     m_SENCFileName.SetExt(_T("S57"));
 
     //      Set the proper directory for the SENC files
-    wxString SENCdir = g_SENCPrefix;
+    //      Deep copy, as this may run on a SENCBuildThread
+    wxString SENCdir(g_SENCPrefix.c_str());
 
     if(SENCdir.Last() != m_SENCFileName.GetPathSeparator())
          SENCdir.Append(m_SENCFileName.GetPathSeparator());
@@ -2319,93 +2510,32 @@ InitReturn s57chart::FindOrCreateSenc( const wxString& name )
                         }
                         else                                      // file exists, non-zero
                         {                                         // so check for new updates
+                                f.Close();
 
-                                f.Seek(0);
-                                wxFileInputStream *pfpx_u = new wxFileInputStream(f);
-                                wxBufferedInputStream *pfpx = new wxBufferedInputStream(*pfpx_u);
-                                int dun = 0;
                                 int last_update = 0;
                                 int senc_file_version = 0;
                                 int force_make_senc = 0;
-                                char buf[256];
-                                char *pbuf = buf;
                                 wxDateTime ModTime000;
                                 int size000 = 0;
                                 wxString senc_base_edtn;
 
-                                while( !dun )
+                                //  A short or pre-binary SENC file shows up as version 0, and is rebuilt
+                                SENCFileHeader hdr;
+                                if(ReadSENCFileHeader(m_SENCFileName.GetFullPath(), &hdr))
                                 {
-                                        if(my_fgets(pbuf, 256, *pfpx) == 0)
-                                        {
-                                                dun = 1;
-                                                force_make_senc = 1;
-                                                break;
-                                        }
-                                        else
-                                        {
-                                                if(!strncmp(pbuf, "OGRF", 4))
-                                                {
-                                                        dun = 1;
-                                                        break;
-                                                }
-
-                                                wxString str_buf(pbuf, wxConvUTF8);
-                                                wxStringTokenizer tkz(str_buf, _T("="));
-                                                wxString token = tkz.GetNextToken();
-
-                                                if(token.IsSameAs(_T("UPDT"), TRUE))
-                                                {
-                                                      int i;
-                                                      i = tkz.GetPosition();
-                                                      last_update = atoi(&pbuf[i]);
-                                                }
-
-                                                else if(token.IsSameAs(_T("SENC Version"), TRUE))
-                                                {
-                                                      int i;
-                                                      i = tkz.GetPosition();
-                                                      senc_file_version = atoi(&pbuf[i]);
-                                                }
-
-
-
-                                                else if(token.IsSameAs(_T("FILEMOD000"), TRUE))
-                                                {
-                                                      int i;
-                                                      i = tkz.GetPosition();
-                                                      wxString str(&pbuf[i],  wxConvUTF8);
-                                                      str.Trim();                               // gets rid of newline, etc...
-                                                      if(!ModTime000.ParseFormat(str, _T("%Y%m%d")/*(const wxChar *)"%Y%m%d"*/))
-                                                            ModTime000.SetToCurrent();
-                                                      ModTime000.ResetTime();                   // to midnight
-                                                }
-
-                                                else if(token.IsSameAs(_T("FILESIZE000"), TRUE))
-                                                {
-                                                      int i;
-                                                      i = tkz.GetPosition();
-                                                      size000 = atoi(&pbuf[i]);
-                                                }
-
-                                                else if(token.IsSameAs(_T("EDTN000"), TRUE))
-                                                {
-                                                      int i;
-                                                      i = tkz.GetPosition();
-                                                      wxString str(&pbuf[i],  wxConvUTF8);
-                                                      str.Trim();                               // gets rid of newline, etc...
-                                                      senc_base_edtn = str;
-                                                }
-
-
-
-                                        }
+                                      senc_file_version = hdr.version;
+                                      last_update = hdr.last_update;
+                                      size000 = hdr.size000;
+                                      senc_base_edtn = wxString(hdr.edtn000, wxConvUTF8);
+
+                                      wxString str(hdr.filemod000, wxConvUTF8);
+                                      if(!ModTime000.ParseFormat(str, _T("%Y%m%d")))
+                                            ModTime000.SetToCurrent();
+                                      ModTime000.ResetTime();                   // to midnight
                                 }
+                                else
+                                      force_make_senc = 1;
 
-                                delete pfpx;
-                                delete pfpx_u;
-                                f.Close();
-//              Anything to do?
-// force_make_senc = 1;
                                 //  SENC file version has to be correct for other tests to make sense
                                 if(senc_file_version != CURRENT_SENC_FORMAT_VERSION)
                                       bbuild_new_senc = true;
@@ -2468,6 +2598,27 @@ InitReturn s57chart::FindOrCreateSenc( const wxString& name )
         return INIT_OK;
 }
 
+//-----------------------------------------------------------------------------------------------
+//    Create or refresh the SENC file for a given .000 ENC file, without loading the chart.
+//    Used by SENCBuildPool, so does not touch the busy cursor or the s_bInS57 semaphore.
+//    The caller is expected to have set the native scale and full extent
+//-----------------------------------------------------------------------------------------------
+InitReturn s57chart::PrebuildSENC( const wxString& name )
+{
+    m_FullPath = name;
+    m_Description = m_FullPath;
+
+    //  Establish a common reference point for the chart
+    ref_lat = (m_FullExtent.NLAT + m_FullExtent.SLAT) /2.;
+    ref_lon = (m_FullExtent.WLON + m_FullExtent.ELON) /2.;
+
+    wxFileName fn(name);
+    if(!GetBaseFileAttr(fn))
+          return INIT_FAIL_REMOVE;
+
+    return FindOrCreateSenc(name);
+}
+
 
 
 InitReturn s57chart::PostInit( ChartInitFlag flags, ColorScheme cs )
@@ -2481,6 +2632,11 @@ InitReturn s57chart::PostInit( ChartInitFlag flags, ColorScheme cs )
               msg.Append(m_SENCFileName.GetFullPath());
               wxLogMessage(msg);
 
+              //    A SENC made from a .000 cell is only a cache, so have the retry rebuild it
+              wxFileName fn(m_FullPath);
+              if(fn.GetExt() == _T("000"))
+                    ::wxRemoveFile(m_SENCFileName.GetFullPath());
+
               return INIT_FAIL_RETRY;
         }
 
@@ -2600,6 +2756,9 @@ void s57chart::InvalidateCache()
 {
         delete pDIB;
         pDIB = NULL;
+
+        if(g_pS57TileCache)
+              g_pS57TileCache->PurgeChart(this);
 }
 
 bool s57chart::BuildThumbnail(const wxString &bmpname)
@@ -2983,86 +3142,34 @@ bool s57chart::CreateHeaderDataFromSENC(void)
             return 1;
       }
 
-      wxString ifs(m_SENCFileName.GetFullPath());
-
-      wxFileInputStream fpx_u(ifs);
-      wxBufferedInputStream fpx(fpx_u);
-
-      int MAX_LINE = 499999;
-      char *buf = (char *)malloc(MAX_LINE + 1);
-
-      int dun = 0;
-
-      hdr_buf = (char *)malloc(1);
       wxString date_000, date_upd;
 
-      while(!dun)
+      SENCFileHeader hdr;
+      if(!ReadSENCFileHeader(m_SENCFileName.GetFullPath(), &hdr) ||
+          (hdr.version != CURRENT_SENC_FORMAT_VERSION))
       {
+            wxString msg(_T("   Wrong version on SENC file "));
+            msg.Append(m_SENCFileName.GetFullPath());
+            wxLogMessage(msg);
 
-            if(my_fgets(buf, MAX_LINE, fpx) == 0)
-            {
-                  dun = 1;
-                  break;
-            }
-
-            if(!strncmp(buf, "OGRF", 4))
-            {
-                  dun = 1;
-                  break;
-            }               //OGRF
-
-
-            else if(!strncmp(buf, "SENC", 4))
-            {
-                  int senc_file_version;
-                  sscanf(buf, "SENC Version=%i", &senc_file_version);
-                  if(senc_file_version != CURRENT_SENC_FORMAT_VERSION)
-                  {
-                        wxString msg(_T("   Wrong version on SENC file "));
-                        msg.Append(m_SENCFileName.GetFullPath());
-                        wxLogMessage(msg);
-
-                        dun = 1;
-                        ret_val = false;                   // error
-                        break;
-                  }
-            }
-
-            else if(!strncmp(buf, "DATEUPD", 7))
-            {
-                  date_upd.Append(wxString(&buf[8], wxConvUTF8).BeforeFirst('\n'));
-            }
-
-            else if(!strncmp(buf, "DATE000", 7))
-            {
-                  date_000.Append(wxString(&buf[8], wxConvUTF8).BeforeFirst('\n'));
-            }
-
-            else if(!strncmp(buf, "SCALE", 5))
-            {
-                  int ins;
-                  sscanf(buf, "SCALE=%d", &ins);
-                  m_Chart_Scale = ins;
-
-            }
-
-            else if(!strncmp(buf, "NAME", 4))
-            {
-                  m_Name = wxString(&buf[5], wxConvUTF8).BeforeFirst('\n');
-            }
+            ret_val = false;                   // error
+      }
+      else
+      {
+            date_upd = wxString(hdr.dateupd, wxConvUTF8);
+            date_000 = wxString(hdr.date000, wxConvUTF8);
+            m_Chart_Scale = hdr.native_scale;
+            m_Name = wxString(hdr.name, wxConvUTF8);
 
-            else if(!strncmp(buf, "Chart Extents:", 14))
+            if(hdr.extent_valid)
             {
-                  float elon, wlon, nlat, slat;
-                  sscanf(buf, "Chart Extents: %g %g %g %g", &elon, &wlon, &nlat, &slat);
-                  m_FullExtent.ELON = elon;
-                  m_FullExtent.WLON = wlon;
-                  m_FullExtent.NLAT = nlat;
-                  m_FullExtent.SLAT = slat;
+                  m_FullExtent.ELON = hdr.extent_elon;
+                  m_FullExtent.WLON = hdr.extent_wlon;
+                  m_FullExtent.NLAT = hdr.extent_nlat;
+                  m_FullExtent.SLAT = hdr.extent_slat;
                   m_bExtentSet = true;
             }
-
-      }                       //while(!dun)
+      }
 
 
       //    Populate COVR structures
@@ -3094,9 +3201,6 @@ bool s57chart::CreateHeaderDataFromSENC(void)
             }
       }
 
-      free(buf);
-
-      free(hdr_buf);
 
  //   Decide on pub date to show
 
@@ -3725,36 +3829,41 @@ int s57chart::BuildSENCFile(const wxString& FullPath000, const wxString& SENCFil
         return 0;
     }
 
-    char temp[200];
-
-    fprintf(fps57, "SENC Version= %d\n", CURRENT_SENC_FORMAT_VERSION);
+    //      Fill in what is known of the file header now.
+    //      It is rewritten with the update and feature counts when the build is done.
+    SENCFileHeader hdr;
+    memset(&hdr, 0, sizeof(SENCFileHeader));
+    memcpy(hdr.magic, SENC_FILE_MAGIC, 8);
+    hdr.version = CURRENT_SENC_FORMAT_VERSION;
+    hdr.header_size = sizeof(SENCFileHeader);
+    hdr.n_geo_records = m_nGeoRecords;
+    hdr.native_scale = m_native_scale;
+
+    if(m_bExtentSet)
+    {
+          hdr.extent_valid = 1;
+          hdr.extent_elon = m_FullExtent.ELON;
+          hdr.extent_wlon = m_FullExtent.WLON;
+          hdr.extent_nlat = m_FullExtent.NLAT;
+          hdr.extent_slat = m_FullExtent.SLAT;
+    }
 
-    strncpy(temp, nice_name.mb_str(), 200);
-    fprintf(fps57, "NAME=%s\n", temp);
+    SetSENCHeaderString(hdr.name, sizeof(hdr.name), nice_name);
 
     wxString date000 = m_date000.Format(_T("%Y%m%d"));
-    strncpy(temp, date000.mb_str(), 200);
-    fprintf(fps57, "DATE000=%s\n", temp);
-
-    strncpy(temp, m_edtn000.mb_str(), 200);
-    fprintf(fps57, "EDTN000=%s\n", temp);
+    SetSENCHeaderString(hdr.date000, sizeof(hdr.date000), date000);
+    SetSENCHeaderString(hdr.edtn000, sizeof(hdr.edtn000), m_edtn000);
 
     //      Record .000 file date and size for primitive detection of updates to .000 file
     wxDateTime ModTime000;
     wxString mt = _T("20000101");
     if(file000.GetTimes(NULL, &ModTime000, NULL))
           mt = ModTime000.Format(_T("%Y%m%d"));
-    strncpy(temp, mt.mb_str(), 200);
-    fprintf(fps57, "FILEMOD000=%s\n", temp);
-
-    int size000 = file000.GetSize().GetHi();
-    int size000l = file000.GetSize().GetLo();
-    fprintf(fps57, "FILESIZE000=%d%d\n", size000, size000l);
+    SetSENCHeaderString(hdr.filemod000, sizeof(hdr.filemod000), mt);
 
+    hdr.size000 = file000.GetSize().GetLo();
 
-
-    fprintf(fps57, "NOGR=%d\n", m_nGeoRecords);
-    fprintf(fps57, "SCALE=%d\n", m_native_scale);
+    fwrite(&hdr, 1, sizeof(SENCFileHeader), fps57);
 
     wxString Message = SENCfile.GetFullPath();
     Message.Append(_T("...Ingesting"));
@@ -3764,7 +3873,10 @@ int s57chart::BuildSENCFile(const wxString& FullPath000, const wxString& SENCFil
 
 
 //    wxProgressDialog    *SENC_prog;
-    s_ProgDialog = new wxProgressDialog(  Title, Message, m_nGeoRecords, NULL,
+    //    Only the GUI thread gets a progress dialog, pool threads report through the SENCBuildPool
+    bool bmain_thread = wxThread::IsMain();
+    if(bmain_thread)
+          s_ProgDialog = new wxProgressDialog(  Title, Message, m_nGeoRecords, NULL,
                                        wxPD_AUTO_HIDE | wxPD_ELAPSED_TIME |
                                        wxPD_ESTIMATED_TIME |
                                        wxPD_REMAINING_TIME  | wxPD_SMOOTH);
@@ -3781,11 +3893,8 @@ int s57chart::BuildSENCFile(const wxString& FullPath000, const wxString& SENCFil
     last_applied_update = ValidateAndCountUpdates( file000.GetPath((int)(wxPATH_GET_SEPARATOR | wxPATH_GET_VOLUME)),
                                                    SENCfile.GetPath(), LastUpdateDate);
 
-    fprintf(fps57, "UPDT=%d\n", last_applied_update);
-
-
-    strncpy(temp, LastUpdateDate.mb_str(), 200);
-    fprintf(fps57, "DATEUPD=%s\n", temp);
+    hdr.last_update = last_applied_update;
+    SetSENCHeaderString(hdr.dateupd, sizeof(hdr.dateupd), LastUpdateDate);
 
 
     //      Insert my local error handler to catch OGR errors,
@@ -3799,7 +3908,8 @@ int s57chart::BuildSENCFile(const wxString& FullPath000, const wxString& SENCFil
     OGRwkbGeometryType geoType;
     wxString sobj;
 
-    bcont = s_ProgDialog->Update(1, _T(""));
+    if(bmain_thread)
+          bcont = s_ProgDialog->Update(1, _T(""));
 
 
     //  Here comes the actual ISO8211 file reading
@@ -3821,7 +3931,10 @@ int s57chart::BuildSENCFile(const wxString& FullPath000, const wxString& SENCFil
     if(open_return == BAD_UPDATE)         ///172
           bbad_update = true;
 
-    bcont = s_ProgDialog->Update(2, _T(""));
+    if(bmain_thread)
+          bcont = s_ProgDialog->Update(2, _T(""));
+    else
+          bcont = !s_IsSENCBuildCancelled();
     if(!bcont)
           goto abort_point;
 
@@ -3930,8 +4043,13 @@ int s57chart::BuildSENCFile(const wxString& FullPath000, const wxString& SENCFil
 
 //                            if(0 == (nProg % 1000))
 //                                  bcont = s_ProgDialog->Update(nProg, sobj);
-                            if(s_ProgDialog)
-                              bcont = s_ProgDialog->Update(nProg, sobj);
+                            if(bmain_thread)
+                            {
+                                  if(s_ProgDialog)
+                                        bcont = s_ProgDialog->Update(nProg, sobj);
+                            }
+                            else
+                                  bcont = !s_IsSENCBuildCancelled();
 
 
                             geoType = wkbUnknown;
@@ -4000,6 +4118,7 @@ int s57chart::BuildSENCFile(const wxString& FullPath000, const wxString& SENCFil
                             if( geoType != wkbUnknown )                                // Write only if has wkbGeometry
                             {
                                   CreateSENCRecord( objectDef, fps57, 1, poReader );
+                                  hdr.n_features++;
                             }
 
                             delete objectDef;
@@ -4018,6 +4137,13 @@ int s57chart::BuildSENCFile(const wxString& FullPath000, const wxString& SENCFil
 
     //      Create and write the Connected NodeTable
       CreateSENCConnNodeTable(fps57, poReader);
+
+    //      Terminate the record stream, and finalize the header
+      wxMemoryOutputStream empty;
+      WriteSENCRecord(fps57, SENC_RECORD_END, empty);
+
+      fseek(fps57, 0, SEEK_SET);
+      fwrite(&hdr, 1, sizeof(SENCFileHeader), fps57);
     }
 
 
@@ -4026,7 +4152,11 @@ abort_point:
 
 //    VSIFClose( s_fpdebug);
 
-    delete s_ProgDialog;
+    if(bmain_thread)
+    {
+          delete s_ProgDialog;
+          s_ProgDialog = NULL;
+    }
 
     fclose(fps57);
 
@@ -4083,8 +4213,13 @@ abort_point:
 */
 
        if(bbad_update)
-             wxMessageBox(_T("Errors encountered processing ENC update file(s).\nENC features may be incomplete or inaccurate."),
-                          _T("OpenCPN Create SENC"), wxOK | wxICON_EXCLAMATION);
+       {
+             if(bmain_thread)
+                   wxMessageBox(_T("Errors encountered processing ENC update file(s).\nENC features may be incomplete or inaccurate."),
+                                _T("OpenCPN Create SENC"), wxOK | wxICON_EXCLAMATION);
+             else
+                   wxLogMessage(_T("   Errors encountered processing ENC update file(s) for ") + FullPath000);
+       }
 
       return ret_code;
 }
@@ -4106,327 +4241,263 @@ int s57chart::BuildRAZFromSENCFile( const wxString& FullPath )
 
         int nProg = 0;
 
-        wxString ifs(FullPath);
+        LUPrec           *LUP;
+        LUPname          LUP_Name = PAPER_CHART;
 
-        wxFileInputStream fpx_u(ifs);
-        wxBufferedInputStream fpx(fpx_u);
+        int object_count = 0;
 
-        int MAX_LINE = 499999;
-        char *buf = (char *)malloc(MAX_LINE + 1);
+        wxProgressDialog    *SENC_prog = NULL;
+        int nGeo1000 = 0;
+        wxString date_000, date_upd;
 
-        LUPrec           *LUP;
-        LUPname          LUP_Name = PAPER_CHART;
+        //    Map (or read) the whole file, and walk the records in place
+        SENCFileBuffer senc_buffer;
+        if(!senc_buffer.Open(FullPath) || (senc_buffer.GetSize() < sizeof(SENCFileHeader)))
+        {
+              wxString msg(_T("   Cannot read SENC file "));
+              msg.Append(SENCFileName.GetFullPath());
+              wxLogMessage(msg);
 
-        int     nGeoFeature;
+              return 1;
+        }
 
-        int object_count = 0;
+        SENCReader reader;
+        SENCFileHeader hdr;
+        if(!SENCReaderOpen(&reader, senc_buffer.GetData(), senc_buffer.GetSize(), &hdr))
+        {
+              wxString msg(_T("   Wrong version on SENC file "));
+              msg.Append(SENCFileName.GetFullPath());
+              wxLogMessage(msg);
 
-        OGREnvelope     Envelope;
+              return 1;                   // error
+        }
 
-        int dun = 0;
+        m_Chart_Scale = hdr.native_scale;
+        m_Name = wxString(hdr.name, wxConvUTF8);
+        date_000 = wxString(hdr.date000, wxConvUTF8);
+        date_upd = wxString(hdr.dateupd, wxConvUTF8);
 
-        hdr_buf = (char *)malloc(1);
-        wxProgressDialog    *SENC_prog = NULL;
-        int nGeo1000;
-        wxString date_000, date_upd;
+        nGeo1000 = hdr.n_geo_records / 500;
 
-//        if(my_fgets(buf, MAX_LINE, fpx) == 0)
-//           dun = 1;
+#ifdef __WXMSW__
+        SENC_prog = new wxProgressDialog(  _("OpenCPN S57 SENC File Load"), FullPath, nGeo1000, NULL,
+                    wxPD_AUTO_HIDE | wxPD_CAN_ABORT | wxPD_ELAPSED_TIME | wxPD_ESTIMATED_TIME | wxPD_REMAINING_TIME | wxPD_SMOOTH);
+
+#endif
+
+        int dun = 0;
+        bool bcorrupt = false;
 
+        while(!dun && !bcorrupt)
+        {
+            SENCRecordHeader rh;
+            unsigned char *payload;
+            int status = SENCReaderNext(&reader, &rh, &payload);
+            if(status == SENC_READ_ERROR)
+            {
+                  bcorrupt = true;                        // truncated, or no END record
+                  break;
+            }
 
-        while(!dun)
-        {
+            switch(rh.record_type)
+            {
+            case SENC_RECORD_END:
+                  dun = 1;
+                  break;
 
-                if(my_fgets(buf, MAX_LINE, fpx) == 0)
-                {
-                        dun = 1;
+            case SENC_RECORD_FEATURE:
+            {
+                  SENCFeature feature;
+                  if(!SENCParseFeature(payload, rh.record_length, &feature))
+                  {
+                        bcorrupt = true;
                         break;
-                }
-
-                if(!strncmp(buf, "OGRF", 4))
-                {
-                      //  Debug Hook
-//                      if(!strncmp(buf, "OGRFeature(SOUNDG)", 16))
-//                            int yyo = 6;
+                  }
 
-                    S57Obj *obj = new S57Obj(buf, &fpx, 0, 0);
-                    if(obj)
-                    {
+                  S57Obj *obj = new S57Obj(&feature);
+                  if(obj)
+                  {
 
 //      Build/Maintain the ATON floating/rigid arrays
-                         if (GEO_POINT == obj->Primitive_type)
-                         {
+                       if (GEO_POINT == obj->Primitive_type)
+                       {
 
 // set floating platform
-                            if ((!strncmp(obj->FeatureName, "LITFLT", 6)) ||
-                                (!strncmp(obj->FeatureName, "LITVES", 6)) ||
-                                (!strncmp(obj->FeatureName, "BOY",    3)))
-                            {
-                                pFloatingATONArray->Add(obj);
-                            }
+                          if ((!strncmp(obj->FeatureName, "LITFLT", 6)) ||
+                              (!strncmp(obj->FeatureName, "LITVES", 6)) ||
+                              (!strncmp(obj->FeatureName, "BOY",    3)))
+                          {
+                              pFloatingATONArray->Add(obj);
+                          }
 
 // set rigid platform
-                            if (!strncmp(obj->FeatureName, "BCN",    3))
-                            {
-                                pRigidATONArray->Add(obj);
-                            }
+                          if (!strncmp(obj->FeatureName, "BCN",    3))
+                          {
+                              pRigidATONArray->Add(obj);
+                          }
 
 
-                        //    Mark the object as an ATON
-                            if ((!strncmp(obj->FeatureName,   "LIT",    3)) ||
-                               (!strncmp(obj->FeatureName, "LIGHTS", 6)) ||
-                               (!strncmp(obj->FeatureName, "BCN",    3)) ||
-                               (!strncmp(obj->FeatureName, "BOY",    3)))
-                            {
-                               obj->bIsAton = true;
-                            }
+                      //    Mark the object as an ATON
+                          if ((!strncmp(obj->FeatureName,   "LIT",    3)) ||
+                             (!strncmp(obj->FeatureName, "LIGHTS", 6)) ||
+                             (!strncmp(obj->FeatureName, "BCN",    3)) ||
+                             (!strncmp(obj->FeatureName, "BOY",    3)))
+                          {
+                             obj->bIsAton = true;
+                          }
 
-                         }
+                       }
 
 
 //      This is where Simplified or Paper-Type point features are selected
-                         switch(obj->Primitive_type)
-                         {
-                            case GEO_POINT:
-                            case GEO_META:
-                            case GEO_PRIM:
-
-                                if(PAPER_CHART == ps52plib->m_nSymbolStyle)
-                                    LUP_Name = PAPER_CHART;
-                                else
-                                    LUP_Name = SIMPLIFIED;
+                       switch(obj->Primitive_type)
+                       {
+                          case GEO_POINT:
+                          case GEO_META:
+                          case GEO_PRIM:
+
+                              if(PAPER_CHART == ps52plib->m_nSymbolStyle)
+                                  LUP_Name = PAPER_CHART;
+                              else
+                                  LUP_Name = SIMPLIFIED;
 
-                                break;
+                              break;
 
-                             case GEO_LINE:
-                                 LUP_Name = LINES;
-                                 break;
+                           case GEO_LINE:
+                               LUP_Name = LINES;
+                               break;
 
-                             case GEO_AREA:
-                                 if(PLAIN_BOUNDARIES == ps52plib->m_nBoundaryStyle)
-                                     LUP_Name = PLAIN_BOUNDARIES;
-                                 else
-                                     LUP_Name = SYMBOLIZED_BOUNDARIES;
+                           case GEO_AREA:
+                               if(PLAIN_BOUNDARIES == ps52plib->m_nBoundaryStyle)
+                                   LUP_Name = PLAIN_BOUNDARIES;
+                               else
+                                   LUP_Name = SYMBOLIZED_BOUNDARIES;
 
-                                 break;
-                         }
+                               break;
+                       }
 
- // Debug hooks
+     // Debug hooks
 //        if(!strncmp(obj->FeatureName, "_m_sor", 6))
 //            int ffl = 4;
 //    if(obj->Index == 311)
 //        int rrt = 5;
 
-                         LUP = ps52plib->S52_LUPLookup(LUP_Name, obj->FeatureName, obj);
-
-                         if(NULL == LUP)
-                         {
-                               if(g_bDebugS57)
-                               {
-                                    wxString msg(obj->FeatureName, wxConvUTF8);
-                                    msg.Prepend(_T("   Could not find LUP for "));
-                                    LogMessageOnce(msg);
-                               }
-                               delete obj;
-                         }
-                         else
-                         {
+                       LUP = ps52plib->S52_LUPLookup(LUP_Name, obj->FeatureName, obj);
+
+                       if(NULL == LUP)
+                       {
+                             if(g_bDebugS57)
+                             {
+                                  wxString msg(obj->FeatureName, wxConvUTF8);
+                                  msg.Prepend(_T("   Could not find LUP for "));
+                                  LogMessageOnce(msg);
+                             }
+                             delete obj;
+                       }
+                       else
+                       {
 //              Convert LUP to rules set
-                            ps52plib->_LUP2rules(LUP, obj);
+                          ps52plib->_LUP2rules(LUP, obj);
 
 //              Add linked object/LUP to the working set
-                            _insertRules(obj,LUP, this);
+                          _insertRules(obj,LUP, this);
 
 //              Establish Object's Display Category
-                            obj->m_DisplayCat = LUP->DISC;
-                         }
-                    }
-
-
-                    object_count++;
-
-                    if((object_count % 500) == 0)
-                    {
-                        nProg = object_count / 500;
-                        if(nProg > nGeo1000 - 1)
-                                nProg = nGeo1000 - 1;
-
-                        if(SENC_prog)
-                            SENC_prog->Update(nProg);
-                    }
+                          obj->m_DisplayCat = LUP->DISC;
+                       }
+                  }
 
 
-                    continue;
+                  object_count++;
 
+                  if((object_count % 500) == 0)
+                  {
+                      nProg = object_count / 500;
+                      if(nProg > nGeo1000 - 1)
+                              nProg = nGeo1000 - 1;
 
-                }               //OGRF
+                      if(SENC_prog)
+                          SENC_prog->Update(nProg);
+                  }
 
+                  break;
+            }
 
-            else if(!strncmp(buf, "VETableStart", 12))
+            case SENC_RECORD_VE_TABLE:
             {
-                  //    Use a wxArray for temp storage
-                  //    then transfer to a simple linear array
-                  ArrayOfVE_Elements ve_array;
-
-                  int index = -1;
-                  int index_max = -1;
-                  int count;
-
-                  fpx.Read(&index, sizeof(int));
+                  int n_ve_elements;
+                  unsigned char *pt;
+                  if(!SENCCheckEdgeTable(payload, rh.record_length, &n_ve_elements, &pt))
+                  {
+                        bcorrupt = true;
+                        break;
+                  }
 
-                  while(-1 != index)
+                  //    Create a hash map of VE_Element pointers as a chart class member
+                  for(int i = 0 ; i < n_ve_elements ; i++)
                   {
-                        fpx.Read(&count, sizeof(int));
+                        int index, count;
+                        unsigned char *ppts = SENCNextEdge(&pt, &index, &count);
 
                         double *pPoints = NULL;
                         if(count)
                         {
                               pPoints = (double *)malloc(count * 2 * sizeof(double));
-                              fpx.Read(pPoints, count * 2 * sizeof(double));
+                              memcpy(pPoints, ppts, count * 2 * sizeof(double));
                         }
 
-                        VE_Element vee;
-                        vee.index = index;
-                        vee.nCount = count;
-                        vee.pPoints = pPoints;
-
-                        ve_array.Add(vee);
-
-                        if(index > index_max)
-                              index_max = index;
-
-                        //    Next element
-                        fpx.Read(&index, sizeof(int));
-                  }
-
-                  //    Create a hash map of VE_Element pointers as a chart class member
-                  int n_ve_elements = ve_array.GetCount();
-
-                  for(int i = 0 ; i < n_ve_elements ; i++)
-                  {
-                        VE_Element ve_from_array = ve_array.Item(i);
                         VE_Element *vep = new VE_Element;
-                        vep->index = ve_from_array.index;
-                        vep->nCount = ve_from_array.nCount;
-                        vep->pPoints = ve_from_array.pPoints;
+                        vep->index = index;
+                        vep->nCount = count;
+                        vep->pPoints = pPoints;
 
-//                        m_pve_array[vep->index] = vep;
                         m_ve_hash[vep->index] = vep;
-
                   }
 
-
-
-
+                  break;
             }
 
-
-            else if(!strncmp(buf, "VCTableStart", 12))
+            case SENC_RECORD_VC_TABLE:
             {
-                  //    Use a wxArray for temp storage
-                  //    then transfer to a simple linear array
-                  ArrayOfVC_Elements vc_array;
-
-                  int index = -1;
-                  int index_max = -1;
-
-                  fpx.Read(&index, sizeof(int));
-
-                  while(-1 != index)
+                  int n_vc_elements;
+                  unsigned char *pt;
+                  if(!SENCCheckNodeTable(payload, rh.record_length, &n_vc_elements, &pt))
                   {
-
-                        double *pPoint = NULL;
-                        pPoint = (double *)malloc(2 * sizeof(double));
-                        fpx.Read(pPoint, 2 * sizeof(double));
-
-
-                        VC_Element vce;
-                        vce.index = index;
-                        vce.pPoint = pPoint;
-
-                        vc_array.Add(vce);
-
-                        if(index > index_max)
-                              index_max = index;
-
-                        //    Next element
-                        fpx.Read(&index, sizeof(int));
+                        bcorrupt = true;
+                        break;
                   }
 
                   //    Create a hash map VC_Element pointers as a chart class member
-                  int n_vc_elements = vc_array.GetCount();
-
                   for(int i = 0 ; i < n_vc_elements ; i++)
                   {
-                        VC_Element vc_from_array = vc_array.Item(i);
                         VC_Element *vcp = new VC_Element;
-                        vcp->index = vc_from_array.index;
-                        vcp->pPoint = vc_from_array.pPoint;
+                        unsigned char *ppoint = SENCNextNode(&pt, &vcp->index);
+
+                        vcp->pPoint = (double *)malloc(2 * sizeof(double));
+                        memcpy(vcp->pPoint, ppoint, 2 * sizeof(double));
 
                         m_vc_hash[vcp->index] = vcp;
                   }
-            }
-
-
-            else if(!strncmp(buf, "SENC", 4))
-            {
-                 int senc_file_version;
-                 sscanf(buf, "SENC Version=%i", &senc_file_version);
-                 if(senc_file_version != CURRENT_SENC_FORMAT_VERSION)
-                 {
-                       wxString msg(_T("   Wrong version on SENC file "));
-                       msg.Append(SENCFileName.GetFullPath());
-                       wxLogMessage(msg);
-
-                       dun = 1;
-                       ret_val = 1;                   // error
-                 }
-            }
-
-            else if(!strncmp(buf, "DATEUPD", 7))
-            {
-                date_upd.Append(wxString(&buf[8], wxConvUTF8).BeforeFirst('\n'));
-            }
 
-            else if(!strncmp(buf, "DATE000", 7))
-            {
-                date_000.Append(wxString(&buf[8], wxConvUTF8).BeforeFirst('\n'));
-            }
-
-            else if(!strncmp(buf, "SCALE", 5))
-                {
-                        int ins;
-                        sscanf(buf, "SCALE=%d", &ins);
-                        m_Chart_Scale = ins;
-                }
-
-            else if(!strncmp(buf, "NAME", 4))
-            {
-                m_Name = wxString(&buf[5], wxConvUTF8).BeforeFirst('\n');
+                  break;
             }
 
-            else if(!strncmp(buf, "NOGR", 4))
-            {
-                 sscanf(buf, "NOGR=%d", &nGeoFeature);
-
-                 nGeo1000 = nGeoFeature / 500;
-
-#ifdef __WXMSW__
-                 SENC_prog = new wxProgressDialog(  _("OpenCPN S57 SENC File Load"), FullPath, nGeo1000, NULL,
-                             wxPD_AUTO_HIDE | wxPD_CAN_ABORT | wxPD_ELAPSED_TIME | wxPD_ESTIMATED_TIME | wxPD_REMAINING_TIME | wxPD_SMOOTH);
-
-#endif
+            default:                      // unknown record type, skip it
+                  break;
             }
         }                       //while(!dun)
 
+        delete SENC_prog;
 
-//      fclose(fpx);
-
-        free(buf);
-
-        free(hdr_buf);
+        //    A truncated file, or a damaged record, fails the load so that the SENC is rebuilt
+        if(!dun || bcorrupt)
+        {
+              wxString msg(_T("   Truncated or damaged SENC file "));
+              msg.Append(SENCFileName.GetFullPath());
+              wxLogMessage(msg);
 
-        delete SENC_prog;
+              return 1;
+        }
 
  //   Decide on pub date to show
 
@@ -4455,45 +4526,6 @@ int s57chart::BuildRAZFromSENCFile( const wxString& FullPath )
       return ret_val;
 }
 
-//------------------------------------------------------------------------------
-//      Local version of fgets for Binary Mode (SENC) file
-//------------------------------------------------------------------------------
- int s57chart::my_fgets( char *buf, int buf_len_max, wxInputStream& ifs )
-
-{
-    char        chNext;
-    int         nLineLen = 0;
-    char            *lbuf;
-
-    lbuf = buf;
-
-
-    while( !ifs.Eof() && nLineLen < buf_len_max )
-    {
-        chNext = (char)ifs.GetC();
-
-        /* each CR/LF (or LF/CR) as if just "CR" */
-        if( chNext == 10 || chNext == 13 )
-        {
-            chNext = '\n';
-        }
-
-        *lbuf = chNext; lbuf++, nLineLen++;
-
-        if( chNext == '\n' )
-        {
-            *lbuf = '\0';
-            return nLineLen;
-        }
-    }
-
-    *(lbuf) = '\0';
-
-    return nLineLen;
-}
-
-
-
 int s57chart::_insertRules(S57Obj *obj, LUPrec *LUP, s57chart *pOwner)
 {
    ObjRazRules   *rzRules = NULL;
@@ -4533,6 +4565,8 @@ int s57chart::_insertRules(S57Obj *obj, LUPrec *LUP, s57chart *pOwner)
          printf("SEQuencer:_insertRules():ERROR no look up type !!!\n");
    }
 
+   m_bobject_mem_valid = false;
+
    // insert rules
    rzRules = (ObjRazRules *)malloc(sizeof(ObjRazRules));
    rzRules->obj   = obj;
@@ -4741,18 +4775,16 @@ void s57chart::UpdateLUPs(s57chart *pOwner)
 
 void s57chart::CreateSENCRecord( OGRFeature *pFeature, FILE * fpOut, int mode, S57Reader *poReader  )
 {
+        wxMemoryOutputStream att_stream;
+        wxMemoryOutputStream geo_stream;
 
-#define MAX_HDR_LINE    400
-
-        char line[MAX_HDR_LINE + 1];
-        wxString sheader;
-
-        fprintf( fpOut, "OGRFeature(%s):%ld\n", pFeature->GetDefnRef()->GetName(),
-                  pFeature->GetFID() );
-
-// DEBUG
-//        if(pFeature->GetFID() == 549)
-//          int hhl = 5;
+        SENCFeatureHeader fh;
+        memset(&fh, 0, sizeof(SENCFeatureHeader));
+        strncpy(fh.feature_name, pFeature->GetDefnRef()->GetName(), 8);
+        fh.fid = pFeature->GetFID();
+        fh.prim = pFeature->GetFieldAsInteger( "PRIM" );
+        fh.ref_lat = ref_lat;
+        fh.ref_lon = ref_lon;
 
 //      In the interests of output file size, DO NOT report fields that are not set.
         for( int iField = 0; iField < pFeature->GetFieldCount(); iField++ )
@@ -4762,16 +4794,58 @@ void s57chart::CreateSENCRecord( OGRFeature *pFeature, FILE * fpOut, int mode, S
                         if( (iField == 1) || (iField > 7))
                         {
                                 OGRFieldDefn *poFDefn = pFeature->GetDefnRef()->GetFieldDefn(iField);
+                                const char *pName = poFDefn->GetNameRef();
 
-                                const char *pType = OGRFieldDefn::GetFieldTypeName(poFDefn->GetType()) ;
+                                //  Dump the standard attributes not used by the renderer
+                                if(!strncmp(pName, "RCID", 4) || !strncmp(pName, "LNAM", 4) ||
+                                    !strncmp(pName, "PRIM", 4) || !strncmp(pName, "SORDAT", 6) ||
+                                    !strncmp(pName, "SORIND", 6))
+                                      continue;
 
-                                snprintf( line, MAX_HDR_LINE - 2, "  %s (%c) = %s",
-                                         poFDefn->GetNameRef(),
-                                         *pType,
-                                         pFeature->GetFieldAsString( iField ));
+                                SENCAttributeHeader ah;
+                                memset(&ah, 0, sizeof(SENCAttributeHeader));
+                                strncpy(ah.name, pName, 8);
+
+                                switch(poFDefn->GetType())
+                                {
+                                      case OFTInteger:
+                                      case OFTIntegerList:
+                                      {
+                                            int ival = pFeature->GetFieldAsInteger( iField );
+                                            ah.value_type = OGR_INT;
+                                            ah.value_bytes = sizeof(int);
+                                            att_stream.Write(&ah, sizeof(SENCAttributeHeader));
+                                            att_stream.Write(&ival, sizeof(int));
+                                            break;
+                                      }
+
+                                      case OFTReal:
+                                      case OFTRealList:
+                                      {
+                                            double dval = pFeature->GetFieldAsDouble( iField );
+                                            ah.value_type = OGR_REAL;
+                                            ah.value_bytes = sizeof(double);
+                                            att_stream.Write(&ah, sizeof(SENCAttributeHeader));
+                                            att_stream.Write(&dval, sizeof(double));
+                                            break;
+                                      }
+
+                                      default:
+                                      {
+                                            const char *pval = pFeature->GetFieldAsString( iField );
+                                            int slen = strlen(pval) + 1;
+                                            ah.value_type = OGR_STR;
+                                            ah.value_bytes = SENC_PAD4(slen);
+                                            att_stream.Write(&ah, sizeof(SENCAttributeHeader));
+                                            att_stream.Write(pval, slen);
+
+                                            char zero[4] = {0};
+                                            att_stream.Write(zero, ah.value_bytes - slen);
+                                            break;
+                                      }
+                                }
 
-                        sheader += wxString(line, wxConvUTF8);
-                        sheader += '\n';
+                                fh.n_attributes++;
                         }
                 }
         }
@@ -4787,85 +4861,55 @@ void s57chart::CreateSENCRecord( OGRFeature *pFeature, FILE * fpOut, int mode, S
               int nqual = pp->getnQual();
               if(10 != nqual)                         // only add attribute if nQual is not "precisely known"
               {
-                    snprintf( line, MAX_HDR_LINE - 2, "  %s (%c) = %d","QUALTY", 'I', nqual);
-                    sheader += wxString(line, wxConvUTF8);
-                    sheader += '\n';
+                    SENCAttributeHeader ah;
+                    memset(&ah, 0, sizeof(SENCAttributeHeader));
+                    strncpy(ah.name, "QUALTY", 8);
+                    ah.value_type = OGR_INT;
+                    ah.value_bytes = sizeof(int);
+                    att_stream.Write(&ah, sizeof(SENCAttributeHeader));
+                    att_stream.Write(&nqual, sizeof(int));
+
+                    fh.n_attributes++;
               }
 
         }
 
-        if(mode == 1)
-        {
-            sprintf( line, "  %s %g %g\n", pGeo->getGeometryName(), ref_lat, ref_lon);
-            sheader += wxString(line, wxConvUTF8);
-        }
-
-        fprintf( fpOut, "HDRLEN=%d\n", sheader.Len());
-        fwrite(sheader.mb_str(wxConvUTF8), 1, sheader.Len(), fpOut);
-
-        if(( pGeo != NULL ) /*&& (mode == 1)*/)
+        if(( pGeo != NULL ) && (mode == 1))
         {
-            int wkb_len = pGeo->WkbSize();
-            unsigned char *pwkb_buffer = (unsigned char *)malloc(wkb_len);
-
-//  Get the GDAL data representation
-            pGeo->exportToWkb(wkbNDR, pwkb_buffer);
-
-    //  Convert to opencpn SENC representation
-
     //  Set absurd bbox starting limits
             float lonmax = -1000;
             float lonmin = 1000;
             float latmax = -1000;
             float latmin = 1000;
 
-            int i, ip, sb_len;
-            float *pdf;
-            double *psd;
-            unsigned char *ps;
-            unsigned char *pd;
-            unsigned char *psb_buffer;
-            double lat, lon;
+            float fbuf[3];
             int nPoints;
             wxString msg;
 
-
-
             OGRwkbGeometryType gType = pGeo->getGeometryType();
             switch(gType)
             {
                 case wkbLineString:
                 {
-                    sb_len = ((wkb_len - 9) / 2) + 9 + 16;                // data will be 4 byte float, not double
-                                                                          // and bbox limits are tacked on end
-                    fprintf( fpOut, "  %d\n", sb_len);
-
-
-                    psb_buffer = (unsigned char *)malloc(sb_len);
-                    pd = psb_buffer;
-                    ps = pwkb_buffer;
-
-                    memcpy(pd, ps, 9);                                    // byte order, type, and count
+                    OGRLineString *pLS = (OGRLineString *)pGeo;
+                    nPoints = pLS->getNumPoints();
 
-                    ip = *((int *)(ps + 5));                              // point count
+                    fh.geom_type = SENC_GEOM_LINE;
+                    geo_stream.Write(&nPoints, sizeof(int));
 
-                    pd += 9;
-                    ps += 9;
-                    psd = (double *)ps;
-                    pdf = (float *)pd;
-
-                    for(i = 0 ; i < ip ; i++)                           // convert doubles to floats
+                    for(int i = 0 ; i < nPoints ; i++)                  // convert doubles to floats
                     {                                                   // computing bbox as we go
 
-                        float lon = (float)*psd++;
-                        float lat = (float)*psd++;
+                        float lon = (float)pLS->getX(i);
+                        float lat = (float)pLS->getY(i);
 
                         //  Calculate SM from chart common reference point
                         double easting, northing;
                         toSM(lat, lon, ref_lat, ref_lon, &easting, &northing);
 
-                        *pdf++ = easting;
-                        *pdf++ = northing;
+                        fbuf[0] = easting;
+                        fbuf[1] = northing;
+                        geo_stream.Write(fbuf, 2 * sizeof(float));
 
                         lonmax = fmax(lon, lonmax);
                         lonmin = fmin(lon, lonmin);
@@ -4875,183 +4919,39 @@ void s57chart::CreateSENCRecord( OGRFeature *pFeature, FILE * fpOut, int mode, S
                     }
 
                     //      Store the Bounding Box as lat/lon
-                    *pdf++ = lonmax;
-                    *pdf++ = lonmin;
-                    *pdf++ = latmax;
-                    *pdf =   latmin;
-
-                    fwrite(psb_buffer, 1, sb_len, fpOut);
-                    fprintf( fpOut, "\n" );
-                    free(psb_buffer);
-
-
-//    Capture the Vector Table geometry indices
-                    int *pNAME_RCID;
-                    int *pORNT;
-                    int nEdgeVectorRecords;
-                    OGRFeature *pEdgeVectorRecordFeature;
-
-                    pNAME_RCID = (int *)pFeature->GetFieldAsIntegerList( "NAME_RCID", &nEdgeVectorRecords );
-
-                    pORNT = (int *)pFeature->GetFieldAsIntegerList( "ORNT", NULL );
-
-
-                    fprintf( fpOut, "LSINDEXLIST %d\n", nEdgeVectorRecords);
-//                    fwrite(pNAME_RCID, 1, nEdgeVectorRecords * sizeof(int), fpOut);
-
-                        //  Set up the options, adding RETURN_PRIMITIVES
-                    char ** papszReaderOptions = NULL;
-                    papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_UPDATES, "ON");
-                    papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_RETURN_LINKAGES, "ON");
-                    papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_RETURN_PRIMITIVES, "ON");
-                    poReader->SetOptions(papszReaderOptions);
-
-
-
-//    Capture the beginning and end point connected nodes for each edge vector record
-                    for(i=0 ; i < nEdgeVectorRecords ; i++)
-                    {
-                          int start_rcid, end_rcid;
-/*
-                          //  Filter out absurd RCIDs, found first on cell IT300017.000
-                          if((pNAME_RCID[i] >= 0) && (pNAME_RCID[i] <= m_nvector_table_size))
-                          {
-                                int target_record_feid = m_pVectorEdgeHelperTable[pNAME_RCID[i]];
-                                pEdgeVectorRecordFeature = poReader->ReadVector( target_record_feid, RCNM_VE );
-                          }
-                          else
-                                pEdgeVectorRecordFeature = NULL;
-*/
-                          int target_record_feid = m_vector_helper_hash[pNAME_RCID[i]];
-                          pEdgeVectorRecordFeature = poReader->ReadVector( target_record_feid, RCNM_VE );
-
-
-// Debug
-//                          int yypo = pNAME_RCID[i];
-//                          int ttt = pEdgeVectorRecordFeature-> GetFieldAsInteger( "RCID" );
-
-                          if(NULL != pEdgeVectorRecordFeature)
-                          {
-                              start_rcid = pEdgeVectorRecordFeature->GetFieldAsInteger( "NAME_RCID_0");
-                              end_rcid = pEdgeVectorRecordFeature->GetFieldAsInteger( "NAME_RCID_1");
-
-                              int edge_ornt = 1; //pORNT[i]; //pEdgeVectorRecordFeature->GetFieldAsInteger( "ORNT");
-
-//think about pOrnt... Do we need it at all?
-                    //  Allocate some storage for converted points
-
-
-                              if(edge_ornt == 1)                                    // forward
-                              {
-                                    fwrite(&start_rcid, 1, sizeof(int), fpOut);
-                                    fwrite(&pNAME_RCID[i], 1, sizeof(int), fpOut);
-                                    fwrite(&end_rcid, 1, sizeof(int), fpOut);
-                              }
-                              else                                                  // reverse
-                              {
-                                    fwrite(&end_rcid, 1, sizeof(int), fpOut);
-                                    fwrite(&pNAME_RCID[i], 1, sizeof(int), fpOut);
-                                    fwrite(&start_rcid, 1, sizeof(int), fpOut);
-                              }
-
-                              delete pEdgeVectorRecordFeature;
-                          }
-                          else
-                          {
-                                start_rcid = -1;                                    // error indication
-                                end_rcid = -2;
-
-                                fwrite(&start_rcid, 1, sizeof(int), fpOut);
-                                fwrite(&pNAME_RCID[i], 1, sizeof(int), fpOut);
-                                fwrite(&end_rcid, 1, sizeof(int), fpOut);
-                          }
-                    }
-
-                    fprintf( fpOut, "\n" );
+                    float bbox[4] = { lonmax, lonmin, latmax, latmin };
+                    geo_stream.Write(bbox, 4 * sizeof(float));
 
-                        //  Reset the options
-                    papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_RETURN_PRIMITIVES, "OFF");
-                    poReader->SetOptions(papszReaderOptions);
-
-//                    free(pVectorEdgeHelperTable);
+                    CreateSENCEdgeIndexList(pFeature, poReader, geo_stream);
 
                     break;
                 }
-                case wkbMultiLineString:
-                    msg = _T("   Warning: Unimplemented SENC wkbMultiLineString record in file ");
-                    msg.Append(m_SENCFileName.GetFullPath());
-                    wxLogMessage(msg);
-
-                      wkb_len = pGeo->WkbSize();
-                      fprintf( fpOut, "  %d\n", wkb_len);
-                      fwrite(pwkb_buffer, 1, wkb_len, fpOut);
-
-                      break;
 
                 case wkbPoint:
-                    {
-                    int nq_len = 4;                                     // nQual length
-//                    int nqual = *(int *)(pwkb_buffer + 5);              // fetch nqual
-
-                    sb_len = ((wkb_len - (5 + nq_len)) / 2) + 5;        // data will be 4 byte float, not double
-                                                                        // and skipping nQual
-
-                    fprintf( fpOut, "  %d\n", sb_len);
-
-                    psb_buffer = (unsigned char *)malloc(sb_len);
-                    pd = psb_buffer;
-                    ps = pwkb_buffer;
-
-                    memcpy(pd, ps, 5);                                 // byte order, type
-
-                    pd += 5;
-                    ps += 5 + nq_len;
-                    psd = (double *)ps;
-                    pdf = (float *)pd;
-
-                    lon = *psd++;                                      // fetch the point
-                    lat = *psd;
-
-//                    if(314 == pFeature->GetFID())
-//                          int yyp = 4;
+                {
+                    OGRPoint *pp = (OGRPoint *)pGeo;
 
                     //  Calculate SM from chart common reference point
                     double easting, northing;
-                    toSM(lat, lon, ref_lat, ref_lon, &easting, &northing);
-
-                    *pdf++ = easting;
-                    *pdf   = northing;
+                    toSM(pp->getY(), pp->getX(), ref_lat, ref_lon, &easting, &northing);
 
-                    //  And write it out
-                    fwrite(psb_buffer, 1, sb_len, fpOut);
-                    fprintf( fpOut, "\n" );
-
-                    free(psb_buffer);
+                    fh.geom_type = SENC_GEOM_POINT;
+                    fbuf[0] = easting;
+                    fbuf[1] = northing;
+                    geo_stream.Write(fbuf, 2 * sizeof(float));
 
                     break;
-                    }
+                }
 
                 case wkbMultiPoint25D:
-                    ps = pwkb_buffer;
-                    ps += 5;
-                    nPoints = *((int *)ps);                     // point count
-
-                    sb_len = (9 + nPoints * 3 * sizeof(float)) + 16;     // GTYPE and count, points as floats
-                                                                         // and trailing bbox
-                    fprintf( fpOut, "  %d\n", sb_len);
-
-                    psb_buffer = (unsigned char *)malloc(sb_len);
-                    pd = psb_buffer;
-                    ps = pwkb_buffer;
-
-                    memcpy(pd, ps, 9);                                  // byte order, type, count
-
-                    ps += 9;
-                    pd += 9;
+                {
+                    OGRGeometryCollection *temp_geometry_collection = (OGRGeometryCollection *)pGeo;
+                    nPoints = temp_geometry_collection->getNumGeometries();
 
-                    pdf = (float *)pd;
+                    fh.geom_type = SENC_GEOM_MULTIPOINT;
+                    geo_stream.Write(&nPoints, sizeof(int));
 
-                    for(ip=0 ; ip < nPoints ; ip++)
+                    for(int ip=0 ; ip < nPoints ; ip++)
                     {
 
                         // Workaround a bug?? in OGRGeometryCollection
@@ -5059,34 +4959,22 @@ void s57chart::CreateSENCRecord( OGRFeature *pFeature, FILE * fpOut, int mode, S
                         // if Z is identically 0, then the point must be a 2D point only.
                         // So, the collection Wkb is corrupted with some 3D, and some 2D points.
                         // Workaround:  Get reference to the points serially, and explicitly read X,Y,Z
-                        // Ignore the previously read Wkb buffer
 
-                        OGRGeometryCollection *temp_geometry_collection = (OGRGeometryCollection *)pGeo;
                         OGRGeometry *temp_geometry = temp_geometry_collection->getGeometryRef( ip );
                         OGRPoint *pt_geom = (OGRPoint *)temp_geometry;
 
-                        lon = pt_geom->getX();
-                        lat = pt_geom->getY();
+                        double lon = pt_geom->getX();
+                        double lat = pt_geom->getY();
                         double depth = pt_geom->getZ();
 
-                        /*
-                        ps += 5;
-                        psd = (double *)ps;
-
-                        lon = *psd++;
-                        lat = *psd++;
-                        double depth = *psd;
-                        */
-
                         //  Calculate SM from chart common reference point
                         double easting, northing;
                         toSM(lat, lon, ref_lat, ref_lon, &easting, &northing);
 
-                        *pdf++ = easting;
-                        *pdf++ = northing;
-                        *pdf++ = (float)depth;
-
-//                        ps += 3 * sizeof(double);
+                        fbuf[0] = easting;
+                        fbuf[1] = northing;
+                        fbuf[2] = (float)depth;
+                        geo_stream.Write(fbuf, 3 * sizeof(float));
 
                         //  Keep a running calculation of min/max
                         lonmax = fmax(lon, lonmax);
@@ -5096,18 +4984,11 @@ void s57chart::CreateSENCRecord( OGRFeature *pFeature, FILE * fpOut, int mode, S
                     }
 
                     //      Store the Bounding Box as lat/lon
-                    *pdf++ = lonmax;
-                    *pdf++ = lonmin;
-                    *pdf++ = latmax;
-                    *pdf =   latmin;
-
-                    //  And write it out
-                    fwrite(psb_buffer, 1, sb_len, fpOut);
-                    free(psb_buffer);
-                    fprintf( fpOut, "\n" );
-
+                    float bbox[4] = { lonmax, lonmin, latmax, latmin };
+                    geo_stream.Write(bbox, 4 * sizeof(float));
 
                     break;
+                }
 
                     //      Special case, polygons are handled separately
                 case wkbPolygon:
@@ -5125,114 +5006,123 @@ void s57chart::CreateSENCRecord( OGRFeature *pFeature, FILE * fpOut, int mode, S
                       {
                             if(!bGLUWarningSent)
                             {
-                                  wxLogMessage(_T("   Warning...Could not find glu32.dll, trying internal tess."));
-                                  bGLUWarningSent = true;
-                            }
-
-                            delete ppg;
-                                //  Try with internal tesselator
-                            ppg = new PolyTessGeo(poly, true, ref_lat, ref_lon, 1);
-                            error_code = ppg->ErrorCode;
-                      }
-
-
-                      if(error_code)
-                            wxLogMessage(_T("   Error: S57 SENC Create Error %d"), ppg->ErrorCode);
-
-                      else
-                            ppg->Write_PolyTriGroup( fpOut );
-                      delete ppg;
-
- //    Capture the Vector Table geometry indices
-
-                      int *pNAME_RCID;
-                      int nEdgeVectorRecords;
-                      OGRFeature *pEdgeVectorRecordFeature;
-
-                      pNAME_RCID = (int *)pFeature->GetFieldAsIntegerList( "NAME_RCID", &nEdgeVectorRecords );
-
-                      fprintf( fpOut, "LSINDEXLIST %d\n", nEdgeVectorRecords);
-
-                        //  Set up the options, adding RETURN_PRIMITIVES
-                      char ** papszReaderOptions = NULL;
-                      papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_UPDATES, "ON");
-                      papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_RETURN_LINKAGES, "ON");
-                      papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_RETURN_PRIMITIVES, "ON");
-                      poReader->SetOptions(papszReaderOptions);
-
-//    Capture the beginning and end point connected nodes for each edge vector record
-                      for(i=0 ; i < nEdgeVectorRecords ; i++)
-                      {
-                            int start_rcid, end_rcid;
-/*
-                            //  Filter out absurd RCIDs, found first on cell IT300017.000
-                            if((pNAME_RCID[i] >= 0) && (pNAME_RCID[i] <= m_nvector_table_size))
-                            {
-                                 int target_record_feid = m_pVectorEdgeHelperTable[pNAME_RCID[i]];
-                                 pEdgeVectorRecordFeature = poReader->ReadVector( target_record_feid, RCNM_VE );
+                                  wxLogMessage(_T("   Warning...Could not find glu32.dll, trying internal tess."));
+                                  bGLUWarningSent = true;
                             }
-                            else
-                                  pEdgeVectorRecordFeature = NULL;
-*/
-                            int target_record_feid = m_vector_helper_hash[pNAME_RCID[i]];
-                            pEdgeVectorRecordFeature = poReader->ReadVector( target_record_feid, RCNM_VE );
 
-                            if(NULL != pEdgeVectorRecordFeature)
-                            {
-                                  start_rcid = pEdgeVectorRecordFeature->GetFieldAsInteger( "NAME_RCID_0");
-                                  end_rcid = pEdgeVectorRecordFeature->GetFieldAsInteger( "NAME_RCID_1");
-
-                                  fwrite(&start_rcid, 1, sizeof(int), fpOut);
-                                  fwrite(&pNAME_RCID[i], 1, sizeof(int), fpOut);
-                                  fwrite(&end_rcid, 1, sizeof(int), fpOut);
+                            delete ppg;
+                                //  Try with internal tesselator
+                            ppg = new PolyTessGeo(poly, true, ref_lat, ref_lon, 1);
+                            error_code = ppg->ErrorCode;
+                      }
 
-                                  delete pEdgeVectorRecordFeature;
-                            }
-                            else
-                            {
-                                  start_rcid = -1;                                    // error indication
-                                  end_rcid = -2;
+                      fh.geom_type = SENC_GEOM_AREA;
 
-                                  fwrite(&start_rcid, 1, sizeof(int), fpOut);
-                                  fwrite(&pNAME_RCID[i], 1, sizeof(int), fpOut);
-                                  fwrite(&end_rcid, 1, sizeof(int), fpOut);
-                            }
+                      //  The tesselation block is length prefixed, zero length on error
+                      int tess_bytes = 0;
+                      if(error_code)
+                      {
+                            wxLogMessage(_T("   Error: S57 SENC Create Error %d"), ppg->ErrorCode);
+                            geo_stream.Write(&tess_bytes, sizeof(int));
                       }
+                      else
+                      {
+                            wxMemoryOutputStream tess_stream;
+                            ppg->Write_PolyTriGroup( tess_stream );
 
-                      fprintf( fpOut, "\n" );
-
-                        //  Reset the options
-                      papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_RETURN_PRIMITIVES, "OFF");
-                      poReader->SetOptions(papszReaderOptions);
+                            tess_bytes = tess_stream.GetSize();
+                            geo_stream.Write(&tess_bytes, sizeof(int));
+                            AppendSENCStream(geo_stream, tess_stream);
+                      }
+                      delete ppg;
 
+                      CreateSENCEdgeIndexList(pFeature, poReader, geo_stream);
 
                       break;
                 }
 
+                case wkbMultiLineString:
+                    msg = _T("   Warning: Unimplemented SENC wkbMultiLineString record in file ");
+                    msg.Append(m_SENCFileName.GetFullPath());
+                    wxLogMessage(msg);
+                    break;
 
                     //      All others
                 default:
                     msg = _T("   Warning: Unimplemented ogr geotype record in file ");
                     msg.Append(m_SENCFileName.GetFullPath());
                     wxLogMessage(msg);
-
-                    wkb_len = pGeo->WkbSize();
-                      fprintf( fpOut, "  %d\n", wkb_len);
-                      fwrite(pwkb_buffer, 1, wkb_len, fpOut);
-                      break;
+                    break;
             }       // switch
+        }
 
+        fh.attribute_bytes = att_stream.GetSize();
+        fh.geometry_bytes = geo_stream.GetSize();
 
+        //  Assemble the feature record
+        wxMemoryOutputStream rec_stream;
+        rec_stream.Write(&fh, sizeof(SENCFeatureHeader));
+        AppendSENCStream(rec_stream, att_stream);
+        AppendSENCStream(rec_stream, geo_stream);
 
-            free(pwkb_buffer);
-        }
+        WriteSENCRecord(fpOut, SENC_RECORD_FEATURE, rec_stream);
+}
+
+//    Write the count and the (start node, edge, end node) RCID triplets
+//    for the edge vector records making up a line or area feature
+void s57chart::CreateSENCEdgeIndexList( OGRFeature *pFeature, S57Reader *poReader, wxOutputStream &ostream )
+{
+      int *pNAME_RCID;
+      int nEdgeVectorRecords;
+      OGRFeature *pEdgeVectorRecordFeature;
+
+      pNAME_RCID = (int *)pFeature->GetFieldAsIntegerList( "NAME_RCID", &nEdgeVectorRecords );
+
+      ostream.Write(&nEdgeVectorRecords, sizeof(int));
+
+      //  Set up the options, adding RETURN_PRIMITIVES
+      char ** papszReaderOptions = NULL;
+      papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_UPDATES, "ON");
+      papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_RETURN_LINKAGES, "ON");
+      papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_RETURN_PRIMITIVES, "ON");
+      poReader->SetOptions(papszReaderOptions);
+
+//    Capture the beginning and end point connected nodes for each edge vector record
+      for(int i=0 ; i < nEdgeVectorRecords ; i++)
+      {
+            int triplet[3];
+
+            int target_record_feid = m_vector_helper_hash[pNAME_RCID[i]];
+            pEdgeVectorRecordFeature = poReader->ReadVector( target_record_feid, RCNM_VE );
+
+            if(NULL != pEdgeVectorRecordFeature)
+            {
+                  triplet[0] = pEdgeVectorRecordFeature->GetFieldAsInteger( "NAME_RCID_0");
+                  triplet[2] = pEdgeVectorRecordFeature->GetFieldAsInteger( "NAME_RCID_1");
+
+                  delete pEdgeVectorRecordFeature;
+            }
+            else
+            {
+                  triplet[0] = -1;                                    // error indication
+                  triplet[2] = -2;
+            }
+
+            triplet[1] = pNAME_RCID[i];
+            ostream.Write(triplet, 3 * sizeof(int));
+      }
+
+      //  Reset the options
+      papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_RETURN_PRIMITIVES, "OFF");
+      poReader->SetOptions(papszReaderOptions);
 }
 
 
 
 void  s57chart::CreateSENCVectorEdgeTable(FILE * fpOut, S57Reader *poReader)
 {
-      fprintf( fpOut, "VETableStart\n" );
+      wxMemoryOutputStream table_stream;
+      int n_records = 0;
 
       //  Set up the options, adding RETURN_PRIMITIVES
       char ** papszReaderOptions = NULL;
@@ -5250,7 +5140,7 @@ void  s57chart::CreateSENCVectorEdgeTable(FILE * fpOut, S57Reader *poReader)
       while(NULL != pEdgeVectorRecordFeature)
       {
             int record_id = pEdgeVectorRecordFeature-> GetFieldAsInteger( "RCID" );
-            fwrite(&record_id, 1, sizeof(int), fpOut);
+            table_stream.Write(&record_id, sizeof(int));
 
             int nPoints = 0;
             if (pEdgeVectorRecordFeature->GetGeometryRef() != NULL)
@@ -5265,7 +5155,7 @@ void  s57chart::CreateSENCVectorEdgeTable(FILE * fpOut, S57Reader *poReader)
                         nPoints = 0;
             }
 
-            fwrite(&nPoints, 1, sizeof(int), fpOut);
+            table_stream.Write(&nPoints, sizeof(int));
 
             for(int i=0 ; i < nPoints ; i++)
             {
@@ -5279,18 +5169,23 @@ void  s57chart::CreateSENCVectorEdgeTable(FILE * fpOut, S57Reader *poReader)
                   MyPoint pd;
                   pd.x = easting;
                   pd.y = northing;
-                  fwrite(&pd, 1, sizeof(MyPoint), fpOut);
+                  table_stream.Write(&pd, sizeof(MyPoint));
             }
 
+            n_records++;
+
             //    Next vector record
+            delete pEdgeVectorRecordFeature;
             feid++;
             pEdgeVectorRecordFeature = poReader->ReadVector( feid, RCNM_VE );
       }
 
-      //    Write a finishing record
-      int last_rcid = -1;
-      fwrite(&last_rcid, 1, sizeof(int), fpOut);
-      fprintf( fpOut, "\nVETableEnd\n" );
+      //    Write the table record, prefixed by the record count
+      wxMemoryOutputStream rec_stream;
+      rec_stream.Write(&n_records, sizeof(int));
+      AppendSENCStream(rec_stream, table_stream);
+
+      WriteSENCRecord(fpOut, SENC_RECORD_VE_TABLE, rec_stream);
 
       //  Reset the options
       papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_RETURN_PRIMITIVES, "OFF");
@@ -5299,7 +5194,8 @@ void  s57chart::CreateSENCVectorEdgeTable(FILE * fpOut, S57Reader *poReader)
 
 void  s57chart::CreateSENCConnNodeTable(FILE * fpOut, S57Reader *poReader)
 {
-      fprintf( fpOut, "VCTableStart\n" );
+      wxMemoryOutputStream table_stream;
+      int n_records = 0;
 
       //  Set up the options, adding RETURN_PRIMITIVES
       char ** papszReaderOptions = NULL;
@@ -5325,7 +5221,7 @@ void  s57chart::CreateSENCConnNodeTable(FILE * fpOut, S57Reader *poReader)
 
                         int record_id = pConnNodeRecordFeature-> GetFieldAsInteger( "RCID" );
 
-                        fwrite(&record_id, 1, sizeof(int), fpOut);
+                        table_stream.Write(&record_id, sizeof(int));
 
            //  Calculate SM from chart common reference point
                         double easting, northing;
@@ -5334,23 +5230,24 @@ void  s57chart::CreateSENCConnNodeTable(FILE * fpOut, S57Reader *poReader)
                         MyPoint pd;
                         pd.x = easting;
                         pd.y = northing;
-                        fwrite(&pd, 1, sizeof(MyPoint), fpOut);
+                        table_stream.Write(&pd, sizeof(MyPoint));
+
+                        n_records++;
                   }
-//                  else
-//                        int yyp = 5;
             }
-//            else
-//                  int eep = 4;
 
             //    Next vector record
+            delete pConnNodeRecordFeature;
             feid++;
             pConnNodeRecordFeature = poReader->ReadVector( feid, RCNM_VC );
       }
 
-      //    Write a finishing record
-      int last_rcid = -1;
-      fwrite(&last_rcid, 1, sizeof(int), fpOut);
-      fprintf( fpOut, "\nVCTableEnd\n" );
+      //    Write the table record, prefixed by the record count
+      wxMemoryOutputStream rec_stream;
+      rec_stream.Write(&n_records, sizeof(int));
+      AppendSENCStream(rec_stream, table_stream);
+
+      WriteSENCRecord(fpOut, SENC_RECORD_VC_TABLE, rec_stream);
 
       //  Reset the options
       papszReaderOptions = CSLSetNameValue( papszReaderOptions, S57O_RETURN_PRIMITIVES, "OFF");
@@ -6239,94 +6136,27 @@ bool s57chart::InitFromSENCMinimal(const wxString &FullPath)
             return false;
 
 
-    wxFile f;
-    if(f.Open(S57FileName.GetFullPath()))
+    SENCFileHeader hdr;
+    if(ReadSENCFileHeader(S57FileName.GetFullPath(), &hdr) &&
+       (hdr.version == CURRENT_SENC_FORMAT_VERSION))
     {
-            if(f.Length() == 0)
-            {
-                    f.Close();
-                    ret_val = false;
-            }
-            else                                      // file exists, non-zero
-            {                                         // so check for new updates
-
-                    f.Seek(0);
-                    wxFileInputStream *pfpx_u = new wxFileInputStream(f);
-                    wxBufferedInputStream *pfpx = new wxBufferedInputStream(*pfpx_u);
-                    int dun = 0;
-                    int last_update = 0;
-                    int senc_file_version = 0;
-                    char buf[256];
-                    char *pbuf = buf;
-
-                    while( !dun )
-                    {
-                            if(my_fgets(pbuf, 256, *pfpx) == 0)
-                            {
-                                    dun = 1;
-                                    ret_val = false;
-                                    break;
-                            }
-                            else
-                            {
-                                    if(!strncmp(pbuf, "OGRF", 4))
-                                    {
-                                            dun = 1;
-                                            break;
-                                    }
-                                    else if(!strncmp(pbuf, "UPDT", 4))
-                                    {
-                                            sscanf(pbuf, "UPDT=%i", &last_update);
-                                    }
-                                    else if(!strncmp(pbuf, "SENC", 4))
-                                    {
-                                        sscanf(pbuf, "SENC Version=%i", &senc_file_version);
-                                    }
-                                    else if(!strncmp(pbuf, "Chart Extents:", 13))
-                                    {
-                                        double xmin, ymin, xmax, ymax;
-                                        wxString l(pbuf, wxConvUTF8);
-
-                                        wxStringTokenizer tkz(l, _T(" "));
-                                        wxString token = tkz.GetNextToken();  //Chart
-                                        token = tkz.GetNextToken();           //Extents:
-
-                                        token = tkz.GetNextToken();
-                                        token.ToDouble(&xmax);
-                                        token = tkz.GetNextToken();
-                                        token.ToDouble(&xmin);
-                                        token = tkz.GetNextToken();
-                                        token.ToDouble(&ymax);
-                                        token = tkz.GetNextToken();
-                                        token.ToDouble(&ymin);
-
-                                        Extent ext;
-                                        ext.WLON = xmin;
-                                        ext.SLAT = ymin;
-                                        ext.ELON = xmax;
-                                        ext.NLAT = ymax;
-                                        SetFullExtent(ext);
-
-                                        check_val |= 1;
-                                    }
-                                    else if(!strncmp(pbuf, "SCALE=", 6))
-                                    {
-                                        int scale;
-                                        sscanf(pbuf, "SCALE=%i",  &scale);
-                                        m_Chart_Scale = scale;
-                                        check_val |= 2;
-                                    }
-
-                            }
-                    }
+          if(hdr.extent_valid)
+          {
+                Extent ext;
+                ext.WLON = hdr.extent_wlon;
+                ext.SLAT = hdr.extent_slat;
+                ext.ELON = hdr.extent_elon;
+                ext.NLAT = hdr.extent_nlat;
+                SetFullExtent(ext);
+
+                check_val |= 1;
+          }
 
-                    delete pfpx;
-                    delete pfpx_u;
-                    f.Close();
-            }
+          m_Chart_Scale = hdr.native_scale;
+          check_val |= 2;
     }
     else
-          ret_val = false;                // file did not open
+          ret_val = false;                // file did not open, or is not a current SENC
 
 
     if(false == ret_val)
@@ -6563,6 +6393,393 @@ s57RegistrarMgr::~s57RegistrarMgr()
 }
 
 
+//------------------------------------------------------------------------
+//  S57TileCache Implementation
+//------------------------------------------------------------------------
+
+S57TileCache::S57TileCache(size_t budget_bytes)
+{
+      m_pMRU = NULL;
+      m_pLRU = NULL;
+      m_MemBytes = 0;
+      m_BudgetBytes = budget_bytes;
+      m_nHits = 0;
+      m_nMisses = 0;
+}
+
+S57TileCache::~S57TileCache()
+{
+      wxString msg;
+      msg.Printf(_T("S57 tile cache: %lu hits, %lu misses"), m_nHits, m_nMisses);
+      wxLogMessage(msg);
+
+      Clear();
+}
+
+void S57TileCache::Unlink(S57TileEntry *pte)
+{
+      if(pte->pLRUPrev)
+            pte->pLRUPrev->pLRUNext = pte->pLRUNext;
+      else
+            m_pMRU = pte->pLRUNext;
+
+      if(pte->pLRUNext)
+            pte->pLRUNext->pLRUPrev = pte->pLRUPrev;
+      else
+            m_pLRU = pte->pLRUPrev;
+
+      pte->pLRUPrev = NULL;
+      pte->pLRUNext = NULL;
+}
+
+void S57TileCache::Remove(S57TileEntry *pte)
+{
+      Unlink(pte);
+      m_TileHash.erase(pte->key);
+      m_MemBytes -= pte->MemBytes;
+
+      delete pte->pTile;
+      delete pte;
+}
+
+PixelCache *S57TileCache::Find(const S57TileKey &key)
+{
+      S57TileHash::iterator it = m_TileHash.find(key);
+      if(it == m_TileHash.end())
+      {
+            m_nMisses++;
+            return NULL;
+      }
+
+      m_nHits++;
+
+      S57TileEntry *pte = it->second;
+      if(pte != m_pMRU)
+      {
+            Unlink(pte);
+            pte->pLRUNext = m_pMRU;
+            if(m_pMRU)
+                  m_pMRU->pLRUPrev = pte;
+            m_pMRU = pte;
+            if(NULL == m_pLRU)
+                  m_pLRU = pte;
+      }
+
+      return pte->pTile;
+}
+
+void S57TileCache::Add(const S57TileKey &key, PixelCache *pTile)
+{
+      S57TileHash::iterator it = m_TileHash.find(key);
+      if(it != m_TileHash.end())
+            Remove(it->second);
+
+      S57TileEntry *pte = new S57TileEntry;
+      pte->key = key;
+      pte->pTile = pTile;
+      pte->MemBytes = pTile->GetLinePitch() * pTile->GetHeight();
+
+      pte->pLRUPrev = NULL;
+      pte->pLRUNext = m_pMRU;
+      if(m_pMRU)
+            m_pMRU->pLRUPrev = pte;
+      m_pMRU = pte;
+      if(NULL == m_pLRU)
+            m_pLRU = pte;
+
+      m_TileHash[key] = pte;
+      m_MemBytes += pte->MemBytes;
+
+      //    Trim to budget, but never drop the tile just added, as the caller is about to use it
+      while((m_MemBytes > m_BudgetBytes) && m_pLRU && (m_pLRU != pte))
+            Remove(m_pLRU);
+}
+
+void S57TileCache::PurgeChart(s57chart *pChart)
+{
+      S57TileEntry *pte = m_pMRU;
+      while(pte)
+      {
+            S57TileEntry *pnext = pte->pLRUNext;
+            if(pte->key.pChart == pChart)
+                  Remove(pte);
+            pte = pnext;
+      }
+}
+
+void S57TileCache::Clear()
+{
+      while(m_pLRU)
+            Remove(m_pLRU);
+}
+
+
+//------------------------------------------------------------------------
+//  SENCBuildPool Implementation
+//------------------------------------------------------------------------
+
+SENCBuildPool::SENCBuildPool(int max_threads)
+{
+      m_next_job = 0;
+      m_ndone = 0;
+      m_max_threads = max_threads;
+      m_bcancel = false;
+}
+
+SENCBuildPool::~SENCBuildPool()
+{
+      for(unsigned int i=0 ; i < m_jobs.GetCount() ; i++)
+      {
+            delete m_jobs.Item(i)->m_pchart;
+            delete m_jobs.Item(i);
+      }
+}
+
+void SENCBuildPool::AddCell(const wxString& FullPath000, int native_scale, Extent &ext)
+{
+      //    The chart shell shares wxString data with globals (e.g. g_pcsv_locn),
+      //    so it is constructed here rather than on a worker thread
+      SENCBuildJob *pjob = new SENCBuildJob;
+      pjob->m_FullPath000 = FullPath000.c_str();          // unshared copy
+      pjob->m_pchart = new s57chart;
+      pjob->m_pchart->SetNativeScale(native_scale);
+      pjob->m_pchart->SetFullExtent(ext);
+      pjob->m_result = INIT_FAIL_RETRY;
+
+      m_jobs.Add(pjob);
+}
+
+int SENCBuildPool::GetThreadCount()
+{
+      int nthreads = m_max_threads;
+      if(nthreads <= 0)
+            nthreads = wxThread::GetCPUCount();
+
+      if(nthreads > MAX_SENC_BUILD_THREADS)
+            nthreads = MAX_SENC_BUILD_THREADS;
+      if(nthreads > (int)m_jobs.GetCount())
+            nthreads = m_jobs.GetCount();
+      if(nthreads < 1)
+            nthreads = 1;
+
+      return nthreads;
+}
+
+SENCBuildJob *SENCBuildPool::GetNextJob()
+{
+      wxMutexLocker lock(m_mutex);
+
+      if(m_bcancel || (m_next_job >= m_jobs.GetCount()))
+            return NULL;
+
+      return m_jobs.Item(m_next_job++);
+}
+
+void SENCBuildPool::JobDone(SENCBuildJob *pjob)
+{
+      wxMutexLocker lock(m_mutex);
+      m_ndone++;
+}
+
+void SENCBuildPool::BuildCell(SENCBuildJob *pjob)
+{
+      pjob->m_result = pjob->m_pchart->PrebuildSENC(pjob->m_FullPath000);
+}
+
+int SENCBuildPool::Run(wxProgressDialog *pprog)
+{
+      int njobs = m_jobs.GetCount();
+      if(!njobs)
+            return 0;
+
+      //    Nothing can be built until the presentation library and the object class registrar are up
+      if(!ps52plib || !ps52plib->m_bOK || !g_poRegistrar)
+            return 0;
+
+      wxArrayPtrVoid threads;
+      SENCBuildLog *plog = NULL;
+
+#ifdef CPL_HAVE_THREADLOCAL
+      //    GDAL/OGR and the tesselator keep per-thread state only where the compiler supports it.
+      //    Otherwise, all builds happen serially on this thread below.
+      int nthreads = GetThreadCount();
+      if(nthreads > 1)
+      {
+            plog = new SENCBuildLog;
+
+            for(int i=0 ; i < nthreads ; i++)
+            {
+                  SENCBuildThread *pt = new SENCBuildThread(this);
+                  if(pt->Create() != wxTHREAD_NO_ERROR)
+                  {
+                        delete pt;
+                        break;
+                  }
+                  pt->Run();
+                  threads.Add(pt);
+            }
+      }
+#endif
+
+      if(threads.GetCount())
+      {
+            int ndone = 0;
+            while(ndone < njobs)
+            {
+                  if(plog)
+                        plog->FlushThreadMessages();
+
+                  {
+                        wxMutexLocker lock(m_mutex);
+                        ndone = m_ndone;
+                        if(m_bcancel && (ndone >= (int)m_next_job))
+                              break;
+                  }
+
+                  if(pprog && !m_bcancel)
+                  {
+                        wxString msg(_("Building SENC files..."));
+                        msg.Append(wxString::Format(_T("  %d/%d"), ndone, njobs));
+                        if(!pprog->Update((ndone * 100) / njobs, msg))
+                              m_bcancel = true;
+                  }
+
+                  wxMilliSleep(100);
+            }
+
+            for(unsigned int i=0 ; i < threads.GetCount() ; i++)
+            {
+                  SENCBuildThread *pt = (SENCBuildThread *)threads.Item(i);
+                  pt->Wait();
+                  delete pt;
+            }
+      }
+      else
+      {
+            SENCBuildJob *pjob;
+            while((pjob = GetNextJob()) != NULL)
+            {
+                  if(pprog)
+                  {
+                        wxFileName fn(pjob->m_FullPath000);
+                        wxString msg(_("Building SENC file for "));
+                        msg.Append(fn.GetFullName());
+                        if(!pprog->Update((m_ndone * 100) / njobs, msg))
+                        {
+                              m_bcancel = true;
+                              break;
+                        }
+                  }
+
+                  BuildCell(pjob);
+                  JobDone(pjob);
+            }
+      }
+
+      delete plog;                                    // passes on the last messages, and restores the log target
+
+      int nok = 0;
+      for(int i=0 ; i < njobs ; i++)
+      {
+            SENCBuildJob *pjob = m_jobs.Item(i);
+            if(pjob->m_result == INIT_OK)
+                  nok++;
+            else
+                  wxLogMessage(_T("   SENC build failed or deferred for ") + pjob->m_FullPath000);
+      }
+
+      wxString msg;
+      msg.Printf(_T("   Built %d of %d SENC files"), nok, njobs);
+      if(m_bcancel)
+            msg.Append(_T(", cancelled"));
+      wxLogMessage(msg);
+
+      return nok;
+}
+
+
+//------------------------------------------------------------------------
+//  SENCBuildLog Implementation
+//------------------------------------------------------------------------
+
+SENCBuildLog::SENCBuildLog()
+{
+      m_pOldLog = wxLog::SetActiveTarget(this);
+}
+
+SENCBuildLog::~SENCBuildLog()
+{
+      FlushThreadMessages();
+      wxLog::SetActiveTarget(m_pOldLog);
+}
+
+void SENCBuildLog::DoLog(wxLogLevel level, const wxChar *szString, time_t t)
+{
+      if(!wxThread::IsMain())
+      {
+            wxMutexLocker lock(m_mutex);
+            m_messages.Add(szString);
+            m_levels.Add(level);
+            m_times.Add(t);
+            return;
+      }
+
+      FlushThreadMessages();
+
+      //    The same cast as wxLogChain uses, to reach the protected DoLog()
+      if(m_pOldLog)
+            ((SENCBuildLog *)m_pOldLog)->DoLog(level, szString, t);
+}
+
+void SENCBuildLog::FlushThreadMessages()
+{
+      wxArrayString messages;
+      wxArrayInt levels;
+      wxArrayLong times;
+      {
+            wxMutexLocker lock(m_mutex);
+            messages = m_messages;
+            levels = m_levels;
+            times = m_times;
+            m_messages.Clear();
+            m_levels.Clear();
+            m_times.Clear();
+      }
+
+      if(!m_pOldLog)
+            return;
+
+      for(unsigned int i=0 ; i < messages.GetCount() ; i++)
+            ((SENCBuildLog *)m_pOldLog)->DoLog(levels.Item(i), messages.Item(i).c_str(), times.Item(i));
+}
+
+
+//------------------------------------------------------------------------
+//  SENCBuildThread Implementation
+//------------------------------------------------------------------------
+
+SENCBuildThread::SENCBuildThread(SENCBuildPool *pool)
+      : wxThread(wxTHREAD_JOINABLE)
+{
+      m_pool = pool;
+}
+
+void *SENCBuildThread::Entry()
+{
+      //    The CPL error handler is per thread, report through the application one
+      CPLSetErrorHandler( MyCPLErrorHandler );
+
+      SENCBuildJob *pjob;
+      while((pjob = m_pool->GetNextJob()) != NULL)
+      {
+            m_pool->BuildCell(pjob);
+            m_pool->JobDone(pjob);
+      }
+
+      return 0;
+}
+
+
 //------------------------------------------------------------------------
 //  Initialize GDAL/OGR S57ENC support
 //------------------------------------------------------------------------
@@ -0,0 +1,366 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenCPN
+ * Purpose:  Binary SENC record reader and parser
+ * Author:   OpenCPN developers
+ *
+ ***************************************************************************
+ *   Copyright (C) by the OpenCPN developers                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ *
+ *
+ *
+ *
+ */
+
+#include <string.h>
+
+#include "sencparser.h"
+
+
+// ============================================================================
+// Binary SENC records
+//
+//    A check never forms a pointer past the end of its buffer.  Each count
+//    is bounded by the bytes remaining before it is multiplied up.
+// ============================================================================
+
+void SENCWriteRecord(FILE *fpOut, int record_type, const void *payload, int length)
+{
+      SENCRecordHeader rh;
+      rh.record_type = record_type;
+      rh.record_length = length;
+      fwrite(&rh, 1, sizeof(SENCRecordHeader), fpOut);
+
+      if(length)
+            fwrite(payload, 1, length, fpOut);
+
+      char zero[8] = {0};
+      fwrite(zero, 1, SENC_PAD8(length) - length, fpOut);
+}
+
+bool SENCReaderOpen(SENCReader *pr, unsigned char *pbuf, size_t size, SENCFileHeader *phdr)
+{
+      if(size < sizeof(SENCFileHeader))
+            return false;
+
+      memcpy(phdr, pbuf, sizeof(SENCFileHeader));
+
+      if(strncmp(phdr->magic, SENC_FILE_MAGIC, 8) || (phdr->version != CURRENT_SENC_FORMAT_VERSION) ||
+         (phdr->header_size < (int)sizeof(SENCFileHeader)) || ((size_t)phdr->header_size > size))
+            return false;
+
+      //    Guard the strings
+      phdr->name[sizeof(phdr->name) - 1] = 0;
+      phdr->date000[sizeof(phdr->date000) - 1] = 0;
+      phdr->edtn000[sizeof(phdr->edtn000) - 1] = 0;
+      phdr->filemod000[sizeof(phdr->filemod000) - 1] = 0;
+      phdr->dateupd[sizeof(phdr->dateupd) - 1] = 0;
+
+      pr->pbuf_end = pbuf + size;
+      pr->prec = pbuf + phdr->header_size;
+      return true;
+}
+
+int SENCReaderNext(SENCReader *pr, SENCRecordHeader *prh, unsigned char **ppayload)
+{
+      if(pr->pbuf_end - pr->prec < (int)sizeof(SENCRecordHeader))
+            return SENC_READ_ERROR;                     // no END record
+
+      memcpy(prh, pr->prec, sizeof(SENCRecordHeader));
+      unsigned char *payload = pr->prec + sizeof(SENCRecordHeader);
+
+      if((prh->record_length < 0) || (prh->record_length > pr->pbuf_end - payload))
+            return SENC_READ_ERROR;
+
+      *ppayload = payload;
+
+      //    The padding of the last record may be missing, so stop at the end
+      if(SENC_PAD8(prh->record_length) > pr->pbuf_end - payload)
+            pr->prec = pr->pbuf_end;
+      else
+            pr->prec = payload + SENC_PAD8(prh->record_length);
+
+      if(prh->record_type == SENC_RECORD_END)
+            return SENC_READ_END;
+
+      return SENC_READ_RECORD;
+}
+
+bool SENCParseTess(unsigned char *polybuf, int nrecl, SENCTess *pt)
+{
+      if(nrecl < (int)sizeof(SENCPolyTessHeader))
+            return false;
+
+      memcpy(&pt->hdr, polybuf, sizeof(SENCPolyTessHeader));
+
+      int ncnt = pt->hdr.n_contours;
+      int nwkb = pt->hdr.n_geom_bytes;
+      int rest = nrecl - (int)sizeof(SENCPolyTessHeader);
+
+      if((ncnt < 0) || (nwkb < 0) || (pt->hdr.n_triprims < 0) ||
+         (ncnt > rest / (int)sizeof(int)) || (nwkb > rest))
+            return false;
+
+      int contour_bytes_padded = SENC_PAD8(ncnt * (int)sizeof(int));
+      int geom_bytes_padded = SENC_PAD8(nwkb);
+      if(contour_bytes_padded > rest - geom_bytes_padded)
+            return false;
+
+      unsigned char *p = polybuf + sizeof(SENCPolyTessHeader);
+      unsigned char *pend = polybuf + nrecl;
+
+      pt->pcontours = p;
+      p += contour_bytes_padded;
+      pt->pgeom = p;
+      p += geom_bytes_padded;
+      pt->ptriprims = p;
+
+      for(int itp = 0 ; itp < pt->hdr.n_triprims ; itp++)
+      {
+            int tp_hdr[2];
+            if(pend - p < (int)sizeof(tp_hdr))
+                  return false;
+            memcpy(tp_hdr, p, sizeof(tp_hdr));
+            p += sizeof(tp_hdr);
+
+            int nvert = tp_hdr[1];
+            if((nvert < 0) || (nvert > (pend - p) / (2 * (int)sizeof(double))))
+                  return false;
+            p += nvert * 2 * sizeof(double);
+
+            if(pend - p < 4 * (int)sizeof(double))
+                  return false;
+            p += 4 * sizeof(double);
+      }
+
+      return true;
+}
+
+unsigned char *SENCNextTriPrim(unsigned char **pp, int *ptype, int *pnvert, double *pbbox)
+{
+      int tp_hdr[2];
+      memcpy(tp_hdr, *pp, sizeof(tp_hdr));
+      *ptype = tp_hdr[0];
+      *pnvert = tp_hdr[1];
+
+      unsigned char *pvert = *pp + sizeof(tp_hdr);
+      memcpy(pbbox, pvert + tp_hdr[1] * 2 * sizeof(double), 4 * sizeof(double));
+
+      *pp = pvert + (tp_hdr[1] + 2) * 2 * sizeof(double);
+      return pvert;
+}
+
+//    The edge index list ending line and area geometry
+static bool ParseEdgeIndexList(unsigned char *pg, unsigned char *pg_end, SENCFeature *pf)
+{
+      if(pg_end - pg < (int)sizeof(int))
+            return false;
+      memcpy(&pf->n_lsindex, pg, sizeof(int));
+      pg += sizeof(int);
+
+      if((pf->n_lsindex < 0) || (pf->n_lsindex > (pg_end - pg) / (3 * (int)sizeof(int))))
+            return false;
+
+      if(pf->n_lsindex)
+            pf->plsindex = pg;
+
+      return true;
+}
+
+bool SENCParseFeature(unsigned char *pRecord, int nRecordLength, SENCFeature *pf)
+{
+      memset(pf, 0, sizeof(SENCFeature));
+
+      if(nRecordLength < (int)sizeof(SENCFeatureHeader))
+            return false;
+      memcpy(&pf->hdr, pRecord, sizeof(SENCFeatureHeader));
+
+      SENCFeatureHeader *pfh = &pf->hdr;
+      int body_bytes = nRecordLength - (int)sizeof(SENCFeatureHeader);
+      if((pfh->n_attributes < 0) || (pfh->attribute_bytes < 0) || (pfh->geometry_bytes < 0) ||
+         (pfh->attribute_bytes > body_bytes) || (pfh->geometry_bytes > body_bytes - pfh->attribute_bytes))
+            return false;
+
+      //    Attributes
+      unsigned char *pa = pRecord + sizeof(SENCFeatureHeader);
+      unsigned char *pa_end = pa + pfh->attribute_bytes;
+      pf->pattributes = pa;
+
+      for(int iatt = 0 ; iatt < pfh->n_attributes ; iatt++)
+      {
+            SENCAttributeHeader ah;
+            if(pa_end - pa < (int)sizeof(SENCAttributeHeader))
+                  return false;
+            memcpy(&ah, pa, sizeof(SENCAttributeHeader));
+            pa += sizeof(SENCAttributeHeader);
+
+            if((ah.value_bytes < 0) || (ah.value_bytes > pa_end - pa))
+                  return false;
+
+            //    Fixed size values must be all there
+            if(((ah.value_type == OGR_INT) && (ah.value_bytes < (int)sizeof(int))) ||
+               ((ah.value_type == OGR_REAL) && (ah.value_bytes < (int)sizeof(double))))
+                  return false;
+
+            pa += ah.value_bytes;
+      }
+
+      //    Geometry
+      unsigned char *pg = pa_end;
+      unsigned char *pg_end = pg + pfh->geometry_bytes;
+      int geom_bytes = pfh->geometry_bytes;
+
+      switch(pfh->geom_type)
+      {
+            case SENC_GEOM_NONE:
+                  return true;
+
+            case SENC_GEOM_POINT:
+                  if(geom_bytes < 2 * (int)sizeof(float))
+                        return false;
+                  pf->npt = 1;
+                  pf->ppoints = pg;
+                  return true;
+
+            case SENC_GEOM_MULTIPOINT:
+            case SENC_GEOM_LINE:
+            {
+                  int dim = (pfh->geom_type == SENC_GEOM_MULTIPOINT) ? 3 : 2;
+
+                  if(geom_bytes < (int)sizeof(int))
+                        return false;
+                  memcpy(&pf->npt, pg, sizeof(int));
+                  pg += sizeof(int);
+
+                  if((pf->npt < 0) || (pf->npt > (pg_end - pg) / (dim * (int)sizeof(float))))
+                        return false;
+                  pf->ppoints = pg;
+                  pg += pf->npt * dim * sizeof(float);
+
+                  if(pg_end - pg < 4 * (int)sizeof(float))
+                        return false;
+                  pf->pbbox = pg;
+                  pg += 4 * sizeof(float);
+
+                  if(pfh->geom_type == SENC_GEOM_LINE)
+                        return ParseEdgeIndexList(pg, pg_end, pf);
+
+                  return true;
+            }
+
+            case SENC_GEOM_AREA:
+            {
+                  int tess_bytes;
+                  if(geom_bytes < (int)sizeof(int))
+                        return false;
+                  memcpy(&tess_bytes, pg, sizeof(int));
+                  pg += sizeof(int);
+
+                  if((tess_bytes < 0) || (tess_bytes > pg_end - pg))
+                        return false;
+
+                  //    Zero length if the tesselation failed when the SENC was made
+                  if(tess_bytes)
+                  {
+                        if(!SENCParseTess(pg, tess_bytes, &pf->tess))
+                              return false;
+                        pf->btess = true;
+                  }
+                  pg += tess_bytes;
+
+                  return ParseEdgeIndexList(pg, pg_end, pf);
+            }
+
+            default:
+                  return false;
+      }
+}
+
+unsigned char *SENCNextAttribute(unsigned char **pp, SENCAttributeHeader *pah)
+{
+      memcpy(pah, *pp, sizeof(SENCAttributeHeader));
+
+      unsigned char *pvalue = *pp + sizeof(SENCAttributeHeader);
+      *pp = pvalue + pah->value_bytes;
+      return pvalue;
+}
+
+bool SENCCheckEdgeTable(unsigned char *payload, int length, int *pn, unsigned char **ppfirst)
+{
+      if(length < (int)sizeof(int))
+            return false;
+      memcpy(pn, payload, sizeof(int));
+
+      unsigned char *p = payload + sizeof(int);
+      unsigned char *pend = payload + length;
+      *ppfirst = p;
+
+      if((*pn < 0) || (*pn > (pend - p) / (2 * (int)sizeof(int))))
+            return false;
+
+      for(int i = 0 ; i < *pn ; i++)
+      {
+            int index_count[2];
+            if(pend - p < (int)sizeof(index_count))
+                  return false;
+            memcpy(index_count, p, sizeof(index_count));
+            p += sizeof(index_count);
+
+            int count = index_count[1];
+            if((count < 0) || (count > (pend - p) / (2 * (int)sizeof(double))))
+                  return false;
+            p += count * 2 * sizeof(double);
+      }
+
+      return true;
+}
+
+unsigned char *SENCNextEdge(unsigned char **pp, int *pindex, int *pnpt)
+{
+      int index_count[2];
+      memcpy(index_count, *pp, sizeof(index_count));
+      *pindex = index_count[0];
+      *pnpt = index_count[1];
+
+      unsigned char *ppoints = *pp + sizeof(index_count);
+      *pp = ppoints + index_count[1] * 2 * sizeof(double);
+      return ppoints;
+}
+
+bool SENCCheckNodeTable(unsigned char *payload, int length, int *pn, unsigned char **ppfirst)
+{
+      if(length < (int)sizeof(int))
+            return false;
+      memcpy(pn, payload, sizeof(int));
+
+      *ppfirst = payload + sizeof(int);
+
+      int node_bytes = sizeof(int) + 2 * sizeof(double);
+      return (*pn >= 0) && (*pn <= (length - (int)sizeof(int)) / node_bytes);
+}
+
+unsigned char *SENCNextNode(unsigned char **pp, int *pindex)
+{
+      memcpy(pindex, *pp, sizeof(int));
+
+      unsigned char *ppoint = *pp + sizeof(int);
+      *pp = ppoint + 2 * sizeof(double);
+      return ppoint;
+}
@@ -0,0 +1,242 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenCPN
+ * Purpose:  Serial input ring, from port threads to the GUI thread
+ * Author:   David Register
+ *
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register   *
+ *   $EMAIL$   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ *
+ *
+ *
+ *
+ */
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+  #include "wx/wx.h"
+#endif //precompiled headers
+
+#ifdef __WXMSW__
+#include <windows.h>                      // for MemoryBarrier()
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "serialring.h"
+
+
+//------------------------------------------------------------------------------
+//    OCP_SerialRing Implementation
+//------------------------------------------------------------------------------
+
+//    Full memory fence, ordering the ring data against the head and tail indices
+#if !defined(__GNUC__) && !defined(__WXMSW__)
+static wxCriticalSection      s_SerialRingFenceLock;
+#endif
+
+static inline void SerialRingFence(void)
+{
+#if defined(__GNUC__)
+      __sync_synchronize();
+#elif defined(__WXMSW__)
+      MemoryBarrier();
+#else
+      wxCriticalSectionLocker lock(s_SerialRingFenceLock);
+#endif
+}
+
+OCP_SerialRing::OCP_SerialRing(void)
+{
+      m_buf = (char *)malloc(SERIAL_RING_SIZE);
+      m_head = 0;
+      m_put_head = 0;
+      m_bdropping = false;
+      m_ndropped = 0;
+      m_ndropped_seen = 0;
+      m_tail = 0;
+      m_bnotify_pending = 0;
+      m_nref = 1;
+}
+
+OCP_SerialRing::~OCP_SerialRing(void)
+{
+      free(m_buf);
+}
+
+void OCP_SerialRing::Ref(void)
+{
+      wxCriticalSectionLocker lock(m_ref_lock);
+      m_nref++;
+}
+
+void OCP_SerialRing::Unref(void)
+{
+      bool bdelete;
+      {
+            wxCriticalSectionLocker lock(m_ref_lock);
+            bdelete = (--m_nref == 0);
+      }
+
+      if(bdelete)
+            delete this;
+}
+
+bool OCP_SerialRing::Put(const char *buf, int len)
+{
+      unsigned int tail = m_tail;
+      SerialRingFence();                              // the consumer is done with space before tail
+
+      unsigned int head = m_head;
+      unsigned int put = m_put_head;
+      bool bcomplete = false;
+
+      const char *p = buf;
+      const char *pend = buf + len;
+      while(p < pend)
+      {
+            //    Take the input a sentence (or the start of one) at a time
+            const char *peol = (const char *)memchr(p, 0x0a, pend - p);
+            const char *pseg_end = peol ? peol + 1 : pend;
+            unsigned int n = pseg_end - p;
+
+            if(m_bdropping)
+            {
+                  m_bdropping = (NULL == peol);
+                  p = pseg_end;
+                  continue;
+            }
+
+            //    The consumer has fallen behind, so drop the whole sentence,
+            //    along with any start of it stored by an earlier Put()
+            if(n > SERIAL_RING_SIZE - (put - tail))
+            {
+                  put = head;
+                  m_ndropped++;
+                  m_bdropping = (NULL == peol);
+                  p = pseg_end;
+                  continue;
+            }
+
+            unsigned int index = put & (SERIAL_RING_SIZE - 1);
+            unsigned int n_first = wxMin(n, SERIAL_RING_SIZE - index);
+            memcpy(m_buf + index, p, n_first);
+            if(n > n_first)
+                  memcpy(m_buf, p + n_first, n - n_first);
+
+            put += n;
+            if(peol)
+            {
+                  head = put;
+                  bcomplete = true;
+            }
+            p = pseg_end;
+      }
+
+      m_put_head = put;
+
+      //    Only a complete sentence is worth waking the consumer for
+      if(!bcomplete)
+            return false;
+
+      SerialRingFence();                              // publish the data before the head
+      m_head = head;
+
+      SerialRingFence();                              // head is visible before the flag is tested
+      if(m_bnotify_pending)
+            return false;
+
+      m_bnotify_pending = 1;
+      return true;
+}
+
+//    A partial sentence not yet published is counted as free, so a producer
+//    waiting for space can never wait on itself
+int OCP_SerialRing::GetFreeSpace(void)
+{
+      unsigned int tail = m_tail;
+      SerialRingFence();
+
+      return SERIAL_RING_SIZE - (m_head - tail);
+}
+
+int OCP_SerialRing::GetNewDropCount(void)
+{
+      int ndropped = m_ndropped;
+      int nnew = ndropped - m_ndropped_seen;
+      m_ndropped_seen = ndropped;
+      return nnew;
+}
+
+void OCP_SerialRing::BeginDrain(void)
+{
+      //    Any data put from now on raises a fresh notification
+      m_bnotify_pending = 0;
+      SerialRingFence();
+}
+
+int OCP_SerialRing::GetSentence(char *dest, int max_len)
+{
+      unsigned int head = m_head;
+      SerialRingFence();                              // read the data only after the head
+      unsigned int tail = m_tail;
+
+      int len = 0;
+      bool btoo_long = false;
+
+      while(tail != head)
+      {
+            char c = m_buf[tail & (SERIAL_RING_SIZE - 1)];
+            tail++;
+
+            if(len < max_len - 1)
+                  dest[len++] = c;
+            else
+                  btoo_long = true;
+
+            if(0x0a == c)
+            {
+                  SerialRingFence();                  // done with the data before releasing it
+                  m_tail = tail;
+
+                  if(!btoo_long)
+                  {
+                        dest[len] = 0;
+                        return len;
+                  }
+
+                  //    Skip the over length sentence, and try the next
+                  len = 0;
+                  btoo_long = false;
+            }
+      }
+
+      //    A long run with no sentence end is noise, so discard it
+      if(btoo_long)
+      {
+            SerialRingFence();
+            m_tail = tail;
+      }
+
+      return 0;
+}
@@ -193,7 +193,6 @@ TCMgr::TCMgr(const wxString &data_dir, const wxString &home_dir)
       num_csts = 0;
       cst_nodes = NULL;
       cst_epochs = NULL;
-      work = NULL;
       cst_speeds = NULL;
 
       index_in_memory=0;
@@ -336,6 +335,10 @@ TCMgr::~TCMgr()
    free_abbreviation_list();
    free_station_index();
 
+   for(unsigned int i=0 ; i < m_retired_states.GetCount() ; i++)
+      FreeStationState((tide_station_state *)m_retired_states.Item(i));
+   m_retired_states.Clear();
+
    if(paIDX)
       free(paIDX);
 
@@ -591,12 +594,9 @@ int TCMgr::GetNextBigEvent (time_t *tm, int idx)
 }
 
 
-bool TCMgr::GetTideOrCurrent15(time_t t, int idx, float &tcvalue, float& dir, bool &bnew_val)
+//    Quarter hour of "now" at the station, as GetTideOrCurrent15() caches it
+int TCMgr::GetTideOrCurrent15Time(IDX_entry *pIDX)
 {
-      int ret;
-      IDX_entry *pIDX = paIDX[idx];             // point to the index entry
-
-
 //    Figure out this computer timezone minute offset
       wxDateTime this_now = wxDateTime::Now();
       wxDateTime this_gmt = this_now.ToGMT();
@@ -617,26 +617,36 @@ bool TCMgr::GetTideOrCurrent15(time_t t, int idx, float &tcvalue, float& dir, bo
       int t_mins = (t_at_station - t_today_00_at_station) / 60;
       int t_15s = t_mins / 15;
 
+      return t_today_00_at_station + t_15s * 15 * 60;
+}
+
+bool TCMgr::GetTideOrCurrent15(time_t t, int idx, float &tcvalue, float& dir, bool &bnew_val)
+{
+      int ret;
+      IDX_entry *pIDX = paIDX[idx];             // point to the index entry
+
+      int tref = GetTideOrCurrent15Time(pIDX);
+
       if(pIDX->Valid15)                               // valid data available
       {
 
-            int tref1 = t_today_00_at_station + t_15s * 15 * 60;
-            if(tref1 == pIDX->Valid15)
+            if(tref == pIDX->Valid15)
             {
                   tcvalue = pIDX->Value15;
                   dir = pIDX->Dir15;
-                  bnew_val = false;
+                  bnew_val = pIDX->New15;               // new if it came from UpdateTideOrCurrent15()
+                  pIDX->New15 = false;
                   return pIDX->Ret15;
             }
             else
             {
-                  int tref = t_today_00_at_station + t_15s * 15 * 60;
                   ret = GetTideOrCurrent(tref, idx, tcvalue, dir);
 
                   pIDX->Valid15 = tref;
                   pIDX->Value15 = tcvalue;
                   pIDX->Dir15 = dir;
                   pIDX->Ret15 = !(ret == 0);
+                  pIDX->New15 = false;
                   bnew_val = true;
 
                   return !(ret == 0);
@@ -647,13 +657,13 @@ bool TCMgr::GetTideOrCurrent15(time_t t, int idx, float &tcvalue, float& dir, bo
       {
 
 
-            int tref = t_today_00_at_station + t_15s * 15 * 60;
             ret = GetTideOrCurrent(tref, idx, tcvalue, dir);
 
             pIDX->Valid15 = tref;
             pIDX->Value15 = tcvalue;
             pIDX->Dir15 = dir;
             pIDX->Ret15 = !(ret == 0);
+            pIDX->New15 = false;
             bnew_val = true;
 
       }
@@ -662,6 +672,52 @@ bool TCMgr::GetTideOrCurrent15(time_t t, int idx, float &tcvalue, float& dir, bo
 
 }
 
+//    Evaluate the stale quarter hour values of the stations in one batch.
+//    GetTideOrCurrent15() then hands them out as new values.
+void TCMgr::UpdateTideOrCurrent15(const wxArrayInt &stations)
+{
+      int n = stations.GetCount();
+      if(!n)
+            return;
+
+      int *pidx = new int[n];
+      time_t *pt = new time_t[n];
+      float *pval = new float[n];
+      float *pdir = new float[n];
+      bool *pok = new bool[n];
+
+      int n_stale = 0;
+      for(int i=0 ; i < n ; i++)
+      {
+            IDX_entry *pIDX = paIDX[stations.Item(i)];
+            int tref = GetTideOrCurrent15Time(pIDX);
+            if(!pIDX->Valid15 || (tref != pIDX->Valid15))
+            {
+                  pidx[n_stale] = stations.Item(i);
+                  pt[n_stale] = tref;
+                  n_stale++;
+            }
+      }
+
+      GetTideOrCurrentBatch(n_stale, pidx, pt, pval, pdir, pok);
+
+      for(int i=0 ; i < n_stale ; i++)
+      {
+            IDX_entry *pIDX = paIDX[pidx[i]];
+            pIDX->Valid15 = pt[i];
+            pIDX->Value15 = pval[i];
+            pIDX->Dir15 = pdir[i];
+            pIDX->Ret15 = pok[i];
+            pIDX->New15 = true;
+      }
+
+      delete[] pidx;
+      delete[] pt;
+      delete[] pval;
+      delete[] pdir;
+      delete[] pok;
+}
+
 bool TCMgr::GetTideFlowSens(time_t t, int sch_step, int idx, float &tcvalue_now, float &tcvalue_prev, bool &w_t)
 {
 
@@ -674,35 +730,19 @@ bool TCMgr::GetTideFlowSens(time_t t, int sch_step, int idx, float &tcvalue_now,
 //    Load up this location data
 
       IDX_entry *pIDX = paIDX[idx];             // point to the index entry
-      if(   !pIDX->IDX_Useable )
-            return false;                                        // no error, but unuseable
-
-	  pmsd = find_or_load_harm_data(pIDX);
-      if(!pmsd)                           // Master station not found
-            return false;                      // Error
-
-	  have_offsets = 0;
-//    fudge_constituents(pmsd, pIDX);
-	  if(       pIDX->IDX_ht_time_off ||
-                pIDX->IDX_ht_off != 0.0 ||
-                pIDX->IDX_lt_off != 0.0 ||
-                pIDX->IDX_ht_mpy != 1.0 ||
-                pIDX->IDX_lt_mpy != 1.0)
-	  have_offsets = 1;
-
-      amplitude = 0.0;                // Force multiplier re-compute
-      time_t tt = time(NULL);
-      int yott = ((gmtime (&tt))->tm_year) + 1900;
-
-      happy_new_year (yott);//Force new multipliers
+      tide_station_state *ps = GetStationState(pIDX, t);
+      if(!ps)
+            return false;                      // unuseable, or master station not found
 
 //    Finally, process the tide flow sens
 
-	  tcvalue_now = time2asecondary (t , pIDX);
-	  tcvalue_prev = time2asecondary (t + sch_step , pIDX);
+	  tcvalue_now = time2asecondary (t , ps, &ps->secondary);
+	  tcvalue_prev = time2asecondary (t + sch_step , ps, &ps->secondary);
 
 	  w_t = tcvalue_now > tcvalue_prev;		// w_t = true --> flood , w_t = false --> ebb
 
+      ReleaseStationState(ps);
+
 	  return true;
 
 }
@@ -720,54 +760,98 @@ void TCMgr::GetHightOrLowTide(time_t t, int sch_step_1, int sch_step_2, float ti
 
       IDX_entry *pIDX = paIDX[idx];             // point to the index entry
 
-      if(   !pIDX->IDX_Useable )
-            return;                                        // no error, but unuseable
+      tide_station_state *ps = GetStationState(pIDX, t);
+      if(!ps)
+            return;                            // unuseable, or master station not found
+
+// Finally, calculate the Hight and low tides
+//    Searching in the direction of sch_step_1, w_t asks for a high tide, !w_t for a low.
+//    The extremum is bracketed and refined on the tide slope, rather than stepped
+//    through at sch_step_1 and then sch_step_2.
+      int dir = ( sch_step_1 < 0 ) ? -1 : 1;
+      time_t t_ext;
+      double level;
+      if(FindTideExtremum(t, dir, w_t, ps, t_ext, level))
+      {
+            tcvalue = level;
+            tctime = t_ext;
+      }
 
-	  pmsd = find_or_load_harm_data(pIDX);
+      ReleaseStationState(ps);
+}
 
-      if(!pmsd)                           // Master station not found
-            return;                      // Error
+//    Level and HW/LW either side of t, for the tide icons.
+//    Served from the station's cached tide table, which is rebuilt once a day.
+bool TCMgr::GetTideNearExtremes(time_t t, int idx, float &nowlev, float &ltlevel, time_t &lttime, float &htlevel, time_t &httime)
+{
+      nowlev = 0;
+      ltlevel = htlevel = 0;
+      lttime = httime = 0;
 
-	  have_offsets = 0;
-//    fudge_constituents(pmsd, pIDX);
-	  if(       pIDX->IDX_ht_time_off ||
-                pIDX->IDX_ht_off != 0.0 ||
-                pIDX->IDX_lt_off != 0.0 ||
-                pIDX->IDX_ht_mpy != 1.0 ||
-                pIDX->IDX_lt_mpy != 1.0)
-	  have_offsets = 1;
+      IDX_entry *pIDX = paIDX[idx];             // point to the index entry
 
+      tide_station_state *ps = GetStationState(pIDX, t);
+      if(!ps)
+            return false;
 
+      tide_day_table *ptable = GetTideDayTable(t, ps);
+      ReleaseStationState(ps);                  // the table is the station's, not the state's
+      if(!ptable)
+            return false;
 
-      amplitude = 0.0;                // Force multiplier re-compute
-      time_t tt = time(NULL);
-      int yott = ((gmtime (&tt))->tm_year) + 1900;
+      nowlev = TideTableLevel(ptable, t);
 
-      happy_new_year (yott);//Force new multipliers
+//    Flood or ebb over the last ten minutes
+      bool b_rising = nowlev > TideTableLevel(ptable, t - 600);
 
-// Finally, calculate the Hight and low tides
-	  double newval = tide_val;
-	  double oldval = ( w_t ) ? newval - 1: newval + 1 ;
-	  int j = 0 ;
-	  int k = 0 ;
-	  int ttt = 0 ;
-        while ( newval > oldval == w_t )			//searching each ten minute
-	  {
-		j++;
-		oldval = newval;
-		ttt = t + ( sch_step_1 * j );
-		newval = time2asecondary (ttt, pIDX);
-	  }
-	  oldval = ( w_t ) ? newval - 1: newval + 1 ;
-	  while ( newval > oldval == w_t )			// searching back each minute
-	  {
-		oldval = newval ;
-		k++;
-		ttt = t +  ( sch_step_1 * j ) - ( sch_step_2 * k ) ;
-		newval = time2asecondary (ttt, pIDX);
-	  }
-        tcvalue = newval;
-	  tctime = ttt + sch_step_2 ;
+//    First the extremum we are heading for, counted from ten minutes back...
+      int i1 = -1;
+      for(int i=0 ; i < ptable->n_extremes ; i++)
+      {
+            if((ptable->extreme_time[i] >= t - 600) && (ptable->extreme_high[i] == b_rising))
+            {
+                  i1 = i;
+                  break;
+            }
+      }
+      if(i1 < 0)
+            return false;
+
+//    ...then the opposite one, behind "now" if the first is still ahead
+      int i2 = -1;
+      if(ptable->extreme_time[i1] > t)
+      {
+            for(int i = ptable->n_extremes - 1 ; i >= 0 ; i--)
+            {
+                  if((ptable->extreme_time[i] <= t) && (ptable->extreme_high[i] != b_rising))
+                  {
+                        i2 = i;
+                        break;
+                  }
+            }
+      }
+      else
+      {
+            for(int i=0 ; i < ptable->n_extremes ; i++)
+            {
+                  if((ptable->extreme_time[i] > t) && (ptable->extreme_high[i] != b_rising))
+                  {
+                        i2 = i;
+                        break;
+                  }
+            }
+      }
+      if(i2 < 0)
+            return false;
+
+      int ih = b_rising ? i1 : i2;
+      int il = b_rising ? i2 : i1;
+      httime = ptable->extreme_time[ih];
+      htlevel = ptable->extreme_level[ih];
+      lttime = ptable->extreme_time[il];
+      ltlevel = ptable->extreme_level[il];
+
+      return true;
 }
 
 bool TCMgr::GetTideOrCurrent(time_t t, int idx, float &tcvalue, float& dir)
@@ -852,33 +936,10 @@ bool TCMgr::GetTideOrCurrent(time_t t, int idx, float &tcvalue, float& dir)
          else ltleveloff = htleveloff;
 */
 
-      pmsd = find_or_load_harm_data(pIDX);
-
-      if(!pmsd)                           // Master station not found
+      tide_station_state *ps = GetStationState(pIDX, t);
+      if(!ps)                             // Master station not found
             return(false);                      // Error
 
-
-
-
-
-
-      have_offsets = 0;
-//    fudge_constituents(pmsd, pIDX);
-  if(             pIDX->IDX_ht_time_off ||
-                  pIDX->IDX_ht_off != 0.0 ||
-                  pIDX->IDX_lt_off != 0.0 ||
-                  pIDX->IDX_ht_mpy != 1.0 ||
-                  pIDX->IDX_lt_mpy != 1.0)
-            have_offsets = 1;
-
-
-
-      amplitude = 0.0;                // Force multiplier re-compute
-      time_t tt = time(NULL);
-      int yott = ((gmtime (&tt))->tm_year) + 1900;
-
-      happy_new_year (yott);//Force new multipliers
-
 /*
       if (Usetadjust == 2) {
       change_time_zone (tadjust_tzname); // User forced tz
@@ -924,7 +985,7 @@ bool TCMgr::GetTideOrCurrent(time_t t, int idx, float &tcvalue, float& dir)
 
 //    Finally, calculate the tide/current
 
-      double level = time2asecondary (t, pIDX);
+      double level = time2asecondary (t, ps, &ps->secondary);
       if(level >= 0)
             dir = pIDX->IDX_flood_dir;
       else
@@ -932,6 +993,8 @@ bool TCMgr::GetTideOrCurrent(time_t t, int idx, float &tcvalue, float& dir)
 
       tcvalue = level;
 
+      ReleaseStationState(ps);
+
       return(true); // Got it!
 }
 
@@ -948,6 +1011,445 @@ int TCMgr::GetStationTimeOffset(IDX_entry *pIDX)
 
 
 
+//    time_t of 00:00 UTC, January 1st of year (1970 on).
+//    Unlike tm2gmt(), it does not go through gmtime().
+static time_t tide_new_year_gmt(int year)
+{
+      long y = year - 1;
+      long days = (365L * (year - 1970)) + (y / 4) - (y / 100) + (y / 400) - 477;    // 477 leap days before 1970
+      return (time_t)days * 86400;
+}
+
+//    UTC year of t, as yearoftimet(), but reentrant
+static int tide_year_of_time(time_t t)
+{
+      int year = 1970 + (int)(t / 31556952);                // mean Gregorian year, in seconds
+      while(tide_new_year_gmt(year) > t)
+            year--;
+      while(tide_new_year_gmt(year + 1) <= t)
+            year++;
+      return year;
+}
+
+//    Return the prediction state for pIDX in the year of t, building it on first use.
+//    Each station keeps the states of its TIDE_STATE_CACHE most recently used years.
+//    Safe to call from any thread.  The caller holds the state until ReleaseStationState().
+tide_station_state *TCMgr::GetStationState(IDX_entry *pIDX, time_t t)
+{
+      if(   !pIDX->IDX_Useable )
+            return NULL;                                        // no error, but unuseable
+
+      int yott = tide_year_of_time(t);
+
+      wxCriticalSectionLocker locker(m_state_lock);
+
+      int n_states = 0;
+      tide_station_state *ps_prev = NULL;
+      for(tide_station_state *ps = pIDX->pstate ; ps ; ps = ps->pnext)
+      {
+            if(ps->coeffs[1].year == yott)
+            {
+                  if(ps_prev)                                   // move it to the front
+                  {
+                        ps_prev->pnext = ps->pnext;
+                        ps->pnext = pIDX->pstate;
+                        pIDX->pstate = ps;
+                  }
+                  ps->n_users++;
+                  return ps;
+            }
+            ps_prev = ps;
+            n_states++;
+      }
+
+      Station_Data *psd = find_or_load_harm_data(pIDX);
+      if(!psd)                           // Master station not found
+            return NULL;                      // Error
+
+      tide_station_state *ps_new = BuildStationState(pIDX, psd, yott);
+      if(!ps_new)
+            return NULL;
+
+//    Make room by dropping the least recently used year
+      if(n_states >= TIDE_STATE_CACHE)
+      {
+            tide_station_state *ps = pIDX->pstate;
+            while(ps->pnext->pnext)
+                  ps = ps->pnext;
+            RetireStationState(ps->pnext);
+            ps->pnext = NULL;
+      }
+
+      ps_new->pnext = pIDX->pstate;
+      pIDX->pstate = ps_new;
+      ps_new->n_users = 1;
+
+      return ps_new;
+}
+
+//    Done with a state from GetStationState().  The last holder of a retired state frees it.
+void TCMgr::ReleaseStationState(tide_station_state *ps)
+{
+      wxCriticalSectionLocker locker(m_state_lock);
+
+      ps->n_users--;
+      if(ps->b_retired && !ps->n_users)
+      {
+            m_retired_states.Remove(ps);
+            FreeStationState(ps);
+      }
+}
+
+//    Take a state out of use, freeing it now if nobody holds it.
+//    m_state_lock must be held.
+void TCMgr::RetireStationState(tide_station_state *ps)
+{
+      ps->pnext = NULL;
+      if(!ps->n_users)
+            FreeStationState(ps);
+      else
+      {
+            ps->b_retired = true;
+            m_retired_states.Add(ps);
+      }
+}
+
+//    Retire all the states of a station, whose data is changing or going away
+void TCMgr::RetireStationStates(IDX_entry *pIDX)
+{
+      wxCriticalSectionLocker locker(m_state_lock);
+
+      tide_station_state *ps = pIDX->pstate;
+      while(ps)
+      {
+            tide_station_state *ps_next = ps->pnext;
+            RetireStationState(ps);
+            ps = ps_next;
+      }
+      pIDX->pstate = NULL;
+}
+
+//    Figure the amplitude, and the multipliers and phases for this_year and the years
+//    either side of it.  Returns NULL if this_year is not covered by the harmonic tables.
+tide_station_state *TCMgr::BuildStationState(IDX_entry *pIDX, Station_Data *psd, int this_year)
+{
+      tide_station_state *ps = (tide_station_state *)calloc(1, sizeof(tide_station_state));
+      if(!ps)
+            return NULL;
+
+      ps->pIDX = pIDX;
+      ps->pmsd = psd;
+      ps->num_csts = num_csts;
+      ps->cst_speeds = cst_speeds;
+
+      ps->have_offsets = 0;
+//    fudge_constituents(pmsd, pIDX);
+      if(         pIDX->IDX_ht_time_off ||
+                  pIDX->IDX_ht_off != 0.0 ||
+                  pIDX->IDX_lt_off != 0.0 ||
+                  pIDX->IDX_ht_mpy != 1.0 ||
+                  pIDX->IDX_lt_mpy != 1.0)
+            ps->have_offsets = 1;
+
+      /* Figure out max amplitude over all the years in the node factors table. */
+      /* This function by Geoffrey T. Dairiki */
+      for (int i = 0; i < num_nodes; i++) {
+            double year_amp = 0.0;
+
+            for (int a=0; a < num_csts; a++)
+                  year_amp += psd->amplitude[a] * cst_nodes[a][i];
+            if (year_amp > ps->amplitude)
+                  ps->amplitude = year_amp;
+      }
+
+      /* Figure out normalized multipliers for constituents for each year,
+         and fold the station meridian and epochs into one phase. */
+      for(int iy=0 ; iy < TIDE_STATE_YEARS ; iy++)
+      {
+            tide_year_coeffs *pc = &ps->coeffs[iy];
+            pc->year = this_year - 1 + iy;
+            pc->epoch = tide_new_year_gmt(pc->year);
+
+            int y = pc->year - first_year;
+            if((y < 0) || (y >= num_epochs) || (y >= num_nodes))
+                  continue;                                    // No tables, so no blending into this year
+
+            pc->work = (double *)malloc(num_csts * sizeof(double));
+            pc->phase = (double *)malloc(num_csts * sizeof(double));
+            if(!pc->work || !pc->phase)
+            {
+                  free(pc->work);
+                  free(pc->phase);
+                  pc->work = pc->phase = NULL;
+                  continue;
+            }
+
+            for (int a = 0; a < num_csts; a++)
+            {
+                  pc->work[a] = psd->amplitude[a] * cst_nodes[a][y] / ps->amplitude;  // BOGUS_amplitude?
+                  pc->phase[a] = (cst_speeds[a] * psd->meridian) + cst_epochs[a][y] - psd->epoch[a];
+            }
+      }
+
+      if(!ps->coeffs[1].work)
+      {
+            FreeStationState(ps);
+            return NULL;
+      }
+
+      return ps;
+}
+
+void TCMgr::FreeStationState(tide_station_state *ps)
+{
+      if(!ps)
+            return;
+
+      for(int iy=0 ; iy < TIDE_STATE_YEARS ; iy++)
+      {
+            free(ps->coeffs[iy].work);
+            free(ps->coeffs[iy].phase);
+      }
+      free(ps);
+}
+
+//    Thread safe evaluation of n (station, time) pairs.
+//    Runs of pairs for one station and year share the station lookup and the secondary station search.
+int TCMgr::GetTideOrCurrentBatch(int n, const int *idx, const time_t *t, float *tcvalue, float *dir, bool *ok)
+{
+      int n_ok = 0;
+      int idx_last = -1;
+      int year_last = 0;
+      tide_station_state *ps = NULL;
+      tide_secondary_cache cache;
+
+      for(int i=0 ; i < n ; i++)
+      {
+            int year = tide_year_of_time(t[i]);
+            if((i == 0) || (idx[i] != idx_last) || (year != year_last))
+            {
+                  if(ps)
+                        ReleaseStationState(ps);
+
+                  idx_last = idx[i];
+                  year_last = year;
+                  ps = GetStationState(paIDX[idx_last], t[i]);
+                  memset(&cache, 0, sizeof(cache));
+            }
+
+            if(!ps)
+            {
+                  tcvalue[i] = 0;
+                  if(dir)
+                        dir[i] = 0;
+                  if(ok)
+                        ok[i] = false;
+                  continue;
+            }
+
+            double level = time2asecondary (t[i], ps, &cache);
+            tcvalue[i] = level;
+            if(dir)
+                  dir[i] = (level >= 0) ? ps->pIDX->IDX_flood_dir : ps->pIDX->IDX_ebb_dir;
+            if(ok)
+                  ok[i] = true;
+            n_ok++;
+      }
+
+      if(ps)
+            ReleaseStationState(ps);
+
+      return n_ok;
+}
+
+//    Thread safe evaluation of one station at t0, t0 + step, ... t0 + (n - 1) * step
+bool TCMgr::GetTideOrCurrentSeries(time_t t0, int step, int n, int idx, float *tcvalue)
+{
+      tide_station_state *ps = GetStationState(paIDX[idx], t0);
+      if(!ps)
+      {
+            for(int i=0 ; i < n ; i++)
+                  tcvalue[i] = 0;
+            return false;
+      }
+
+      tide_secondary_cache cache;
+      memset(&cache, 0, sizeof(cache));
+      time2asecondary_series(t0, step, n, ps, &cache, tcvalue);
+
+      ReleaseStationState(ps);
+
+      return true;
+}
+
+//    Slope of the denormalized tide at t, in units per second.
+//    Reference stations use the harmonic derivative directly; its sign is all
+//    the extremum search needs, and BOGUS_amplitude() preserves it.
+//    Secondary stations fall back to a central difference.
+double TCMgr::time2aslope(time_t t, tide_station_state *ps)
+{
+      if(!ps->have_offsets)
+            return time2dt_tide(t, 1, ps);
+
+      return (time2asecondary(t + 60, ps, &ps->secondary) - time2asecondary(t - 60, ps, &ps->secondary)) / 120.;
+}
+
+//    Refine the extremum between ta and tb (ta < tb), which must have slopes of
+//    opposite sign, to TIDE_TIME_PREC by false position (Illinois variant).
+bool TCMgr::RefineTideExtremum(time_t ta, time_t tb, tide_station_state *ps, time_t &t_ext)
+{
+      double ga = time2aslope(ta, ps);
+      double gb = time2aslope(tb, ps);
+
+      if(ga == 0.)
+      {
+            t_ext = ta;
+            return true;
+      }
+      if(gb == 0.)
+      {
+            t_ext = tb;
+            return true;
+      }
+      if((ga > 0.) == (gb > 0.))
+            return false;
+
+      int side = 0;
+      int n_iter = 0;
+      while((tb - ta > TIDE_TIME_PREC) && (n_iter++ < 50))
+      {
+            time_t tc = ta + (time_t)((tb - ta) * ga / (ga - gb));
+            if(tc <= ta)
+                  tc = ta + 1;
+            if(tc >= tb)
+                  tc = tb - 1;
+
+            double gc = time2aslope(tc, ps);
+            if(gc == 0.)
+            {
+                  ta = tb = tc;
+                  break;
+            }
+
+            if((gc > 0.) == (ga > 0.))
+            {
+                  ta = tc;
+                  ga = gc;
+                  if(side == -1)
+                        gb /= 2.;
+                  side = -1;
+            }
+            else
+            {
+                  tb = tc;
+                  gb = gc;
+                  if(side == 1)
+                        ga /= 2.;
+                  side = 1;
+            }
+      }
+
+      t_ext = ta + (tb - ta) / 2;
+      return true;
+}
+
+//    Find the first high (b_high) or low tide from t, going forward (dir > 0)
+//    or backward in time.  Returns false if none is found within a day.
+bool TCMgr::FindTideExtremum(time_t t, int dir, bool b_high, tide_station_state *ps, time_t &t_ext, double &level)
+{
+      //    Slope along the direction of travel: heading for a high while it is
+      //    positive, for a low while it is negative
+      double g = dir * time2aslope(t, ps);
+      bool b_heading = b_high ? (g > 0.) : (g < 0.);
+
+      time_t tp = t;
+      for(int i=0 ; i < TIDE_EXTREMUM_MAX_STEPS ; i++)
+      {
+            time_t tn = tp + (dir * TIDE_EXTREMUM_STEP);
+            double gn = dir * time2aslope(tn, ps);
+            bool b_heading_n = b_high ? (gn > 0.) : (gn < 0.);
+
+            if(b_heading && !b_heading_n)
+            {
+                  if(!RefineTideExtremum(wxMin(tp, tn), wxMax(tp, tn), ps, t_ext))
+                        t_ext = tn;
+                  level = time2asecondary(t_ext, ps, &ps->secondary);
+                  return true;
+            }
+
+            b_heading = b_heading_n;
+            tp = tn;
+      }
+
+      return false;
+}
+
+//    Return the tide table of t's UTC day for the current station, building it if needed.
+tide_day_table *TCMgr::GetTideDayTable(time_t t, tide_station_state *ps)
+{
+      IDX_entry *pIDX = ps->pIDX;
+      time_t t_day = t - (t % 86400);
+
+      tide_day_table *ptable = pIDX->pday_table;
+      if(ptable && (ptable->t_day == t_day))
+            return ptable;
+
+      if(!ptable)
+      {
+            ptable = (tide_day_table *)malloc(sizeof(tide_day_table));
+            if(!ptable)
+                  return NULL;
+            pIDX->pday_table = ptable;
+      }
+
+      ptable->t_day = t_day;
+      ptable->t0 = t_day - TIDE_TABLE_MARGIN;
+
+      time2asecondary_series(ptable->t0, TIDE_TABLE_STEP, TIDE_TABLE_SAMPLES, ps, &ps->secondary, ptable->level);
+
+//    Extremes show up as local maxima and minima of the samples,
+//    and are then refined on the slope between the neighbouring samples
+      ptable->n_extremes = 0;
+      for(int i=1 ; i < TIDE_TABLE_SAMPLES - 1 ; i++)
+      {
+            float *plev = &ptable->level[i];
+            bool b_high = (plev[0] >= plev[-1]) && (plev[0] > plev[1]);
+            bool b_low = (plev[0] <= plev[-1]) && (plev[0] < plev[1]);
+            if(!b_high && !b_low)
+                  continue;
+
+            if(ptable->n_extremes == TIDE_TABLE_MAX_EXTREMES)
+                  break;
+
+            time_t t_ext;
+            if(!RefineTideExtremum(ptable->t0 + ((i - 1) * TIDE_TABLE_STEP),
+                                   ptable->t0 + ((i + 1) * TIDE_TABLE_STEP), ps, t_ext))
+                  t_ext = ptable->t0 + (i * TIDE_TABLE_STEP);
+
+            int n = ptable->n_extremes++;
+            ptable->extreme_time[n] = t_ext;
+            ptable->extreme_level[n] = time2asecondary(t_ext, ps, &ps->secondary);
+            ptable->extreme_high[n] = b_high;
+      }
+
+      return ptable;
+}
+
+//    Tide level at t, interpolated between the table's 15 minute samples
+double TCMgr::TideTableLevel(tide_day_table *ptable, time_t t)
+{
+      double x = (double)(t - ptable->t0) / TIDE_TABLE_STEP;
+      int i = (int)floor(x);
+      if(i < 0)
+            i = 0;
+      if(i > TIDE_TABLE_SAMPLES - 2)
+            i = TIDE_TABLE_SAMPLES - 2;
+
+      double f = x - i;
+      return ptable->level[i] + (ptable->level[i + 1] - ptable->level[i]) * f;
+}
+
+
 Station_Data *TCMgr::find_or_load_harm_data(IDX_entry *pIDX)
 {
       Station_Data *psd = NULL;
@@ -1224,82 +1726,9 @@ void TCMgr::fudge_constituents (Station_Data *psd, IDX_entry *pIDX)
     have_offsets = 1;
 */
 
-  if(       pIDX->IDX_ht_time_off ||
-                  pIDX->IDX_ht_time_off ||
-                  pIDX->IDX_ht_off != 0.0 ||
-                  pIDX->IDX_lt_off != 0.0 ||
-                  pIDX->IDX_ht_mpy != 1.0 ||
-                  pIDX->IDX_lt_mpy != 1.0)
-            have_offsets = 1;
-
-}
-
-
-/* Figure out max amplitude over all the years in the node factors table. */
-/* This function by Geoffrey T. Dairiki */
-void TCMgr::figure_amplitude ()
-{
-  int       i, a;
-
-  if (amplitude == 0.0) {
-      for (i = 0; i < num_nodes; i++) {
-         double year_amp = 0.0;
-
-         for (a=0; a < num_csts; a++)
-               year_amp += pmsd->amplitude[a] * cst_nodes[a][i];
-         if (year_amp > amplitude)
-               amplitude = year_amp;
-      }
-
-/*
-      // Figure other, related global values (DWF)
-      absmax = DATUM + BOGUS_amplitude(1.0);
-      absmin = DATUM - BOGUS_amplitude(1.0);
-
-      absmax = htleveloff + hlevelmult * absmax;
-      absmin = ltleveloff + llevelmult * absmin;
-      if (absmax <= absmin)
-      barf (MAXBELOWMIN);
-      fakedatum = (absmax + absmin) / 2.0;
-      fakeamplitude = (absmax - absmin) / 2.0;
-      if (fabs (fakedatum) >= 100.0 || fakeamplitude >= 100.0)
-        fprintf (stderr, "Tidelib warning:  tidal range out of normal bounds\n");
-*/
-    }
-}
-
-/* Figure out normalized multipliers for constituents for a particular
-   year.  Save amplitude for drawing unit lines. */
-void TCMgr::figure_multipliers ()
-{
-  int a;
-
-  figure_amplitude();
-  for (a = 0; a < num_csts; a++)
-      work[a] = pmsd->amplitude[a] * cst_nodes[a][year-first_year] / amplitude;  // BOGUS_amplitude?
-//  if (hincmagic)
-//      pick_hinc ();
+//   have_offsets is now held per station, see BuildStationState()
 }
 
-/* Re-initialize for a different year */
-void TCMgr::happy_new_year (int new_year)
-{
-  year = new_year;
-  figure_multipliers ();
-  set_epoch (year, num_epochs, first_year);
-}
-
-
-/* Calculate time_t of the epoch. */
-void TCMgr::set_epoch (int year, int num_epochs, int first_year)
-{
-  struct tm ht;
-
-  ht.tm_year = year - 1900;
-  ht.tm_sec = ht.tm_min = ht.tm_hour = ht.tm_mon = 0;
-  ht.tm_mday = 1;
-  epoch = tm2gmt (&ht);
-}
 
 /* This idiotic function is needed by the new tm2gmt. */
 #define compare_int(a,b) (((int)(a))-((int)(b)))
@@ -1401,7 +1830,6 @@ void TCMgr::allocate_cst ()
   cst_speeds = (double *) malloc (num_csts * sizeof (double));
 //  loc_amp = (double *) malloc (num_csts * sizeof (double));
 //  loc_epoch = (double *) malloc (num_csts * sizeof (double));
-  work = (double *) malloc (num_csts * sizeof (double));
 }
 
 
@@ -1440,7 +1868,6 @@ void TCMgr::free_cst()
   free(cst_speeds);
 //  free(loc_amp);
 //  free(loc_epoch);
-  free(work);
 }
 void TCMgr::free_nodes()
  {
@@ -1626,6 +2053,8 @@ IDX_entry *pIDX, *pIDX_next;
 
          if (pIDX->IDX_tzname != NULL)
              free(pIDX->IDX_tzname);
+         free(pIDX->pday_table);
+         RetireStationStates(pIDX);
          free(pIDX);
 
          pIDX = pIDX_next;
@@ -1744,8 +2173,15 @@ IDX_entry *pIDX, *pIDX_prev;
         pIDX->IDX_rec_num   = pIDX_prev->IDX_rec_num+1;
         pIDX->IDX_next      = NULL;
         pIDX->IDX_tzname    = NULL;
+        pIDX->Valid15       = 0;
+        pIDX->New15         = false;
+        pIDX->pday_table    = NULL;
+        pIDX->pstate        = NULL;
       }
       if (pIDX != NULL) {
+        free(pIDX->pday_table);              // Offsets change, so the tide table is stale
+        pIDX->pday_table    = NULL;
+        RetireStationStates(pIDX);           // and so do the states, which may still be in use
         strcpy(pIDX->IDX_station_name,   custom_name);
         strcpy(pIDX->IDX_reference_name, IDX_reference_name);
         strcpy(pIDX->IDX_zone,           Izone);
@@ -2060,6 +2496,9 @@ harmonic_file_entry *pHarmonic, *pHarmonic_prev;
                   pIDX->IDX_rec_num = num_IDX;
                   pIDX->IDX_tried_once = 0;               // master station search control
                   pIDX->Valid15 = 0;
+                  pIDX->New15 = false;
+                  pIDX->pday_table = NULL;                // no tide table yet
+                  pIDX->pstate = NULL;
 
                   if (build_IDX_entry(pIDX))
                      printf("Index file error at entry %d!\n", num_IDX);
@@ -2403,9 +2842,9 @@ load_data ()
 //-----------------------------------------------------------------------------------
 
 
-double TCMgr::time2tide (time_t t)
+double TCMgr::time2tide (time_t t, tide_station_state *ps)
 {
-  return time2dt_tide(t, 0);
+  return time2dt_tide(t, 0, ps);
 }
 
 
@@ -2414,11 +2853,11 @@ double TCMgr::time2tide (time_t t)
  * For knots^2 current stations, returns square root of (value * amplitude),
  * For normal stations, returns value * amplitude */
 
-double TCMgr::BOGUS_amplitude(double mpy, IDX_entry *pIDX)
+double TCMgr::BOGUS_amplitude(double mpy, tide_station_state *ps)
 {
-       Station_Data *pmsd = pIDX->pref_sta_data;
+      double amplitude = ps->amplitude;
 
-      if (!pmsd->have_BOGUS)                                // || !convert_BOGUS)   // Added mgh
+      if (!ps->pmsd->have_BOGUS)                                // || !convert_BOGUS)   // Added mgh
         return(mpy * amplitude);
   else {
      if (mpy >= 0.0)
@@ -2429,9 +2868,9 @@ double TCMgr::BOGUS_amplitude(double mpy, IDX_entry *pIDX)
 }
 
 /* Calculate the denormalized tide. */
-double TCMgr::time2atide (time_t t, IDX_entry *pIDX)
+double TCMgr::time2atide (time_t t, tide_station_state *ps)
 {
-  return BOGUS_amplitude(time2tide(t), pIDX) + pmsd->DATUM;
+  return BOGUS_amplitude(time2tide(t, ps), ps) + ps->pmsd->DATUM;
 }
 
 
@@ -2444,13 +2883,13 @@ double TCMgr::time2atide (time_t t, IDX_entry *pIDX)
         2       falling transition
         3       rising transition
 */
-int TCMgr::next_big_event (time_t *tm, IDX_entry *pIDX)
+int TCMgr::next_big_event (time_t *tm, tide_station_state *ps)
 {
   double p, q;
   int flags = 0, slope = 0;
-  p = time2atide (*tm, pIDX);
+  p = time2atide (*tm, ps);
   *tm += 60;
-  q = time2atide (*tm, pIDX);
+  q = time2atide (*tm, ps);
   *tm += 60;
   if (p < q)
     slope = 1;
@@ -2487,7 +2926,7 @@ int TCMgr::next_big_event (time_t *tm, IDX_entry *pIDX)
                       .           .
           */
           p = q;
-          q = time2atide (*tm, pIDX);
+          q = time2atide (*tm, ps);
           if ((slope == 1 && q < p) || (slope == 0 && p < q)) {
             /* Tide event */
             flags |= (1 << slope);
@@ -2507,7 +2946,7 @@ int TCMgr::next_big_event (time_t *tm, IDX_entry *pIDX)
       return flags;
     }
     p = q;
-    q = time2atide (*tm, pIDX);
+    q = time2atide (*tm, ps);
     *tm += 60;
   }
 }
@@ -2518,17 +2957,20 @@ int TCMgr::next_big_event (time_t *tm, IDX_entry *pIDX)
    summing only the long-term constituents. */
 /* Does not do any blending around year's end. */
 /* This is used only by time2asecondary for finding the mean tide level */
-double TCMgr::time2mean (time_t t)
+/* Uses the coefficients of t's year, or of the nearest year the state holds. */
+double TCMgr::time2mean (time_t t, tide_station_state *ps)
 {
   double tide = 0.0;
-  int a, new_year = yearoftimet (t);
-  if (new_year != year)
-    happy_new_year (new_year);
-  for (a=0;a<num_csts;a++) {
-    if (cst_speeds[a] < 6e-6)
-      tide += work[a] *
-        cos (cst_speeds[a] * ((long)(t - epoch) + pmsd->meridian) +
-        cst_epochs[a][year-first_year] - pmsd->epoch[a]);
+  int a;
+  tide_year_coeffs *pc = &ps->coeffs[1];
+  if (t < pc->epoch && ps->coeffs[0].work)
+    pc = &ps->coeffs[0];
+  else if (t >= ps->coeffs[2].epoch && ps->coeffs[2].work)
+    pc = &ps->coeffs[2];
+  for (a=0;a<ps->num_csts;a++) {
+    if (ps->cst_speeds[a] < 6e-6)
+      tide += pc->work[a] *
+        cos (ps->cst_speeds[a] * (long)(t - pc->epoch) + pc->phase[a]);
   }
   return tide;
 }
@@ -2539,11 +2981,13 @@ double TCMgr::time2mean (time_t t)
 tide.  The normalized is derived from this, instead of the other way
 around, because the application of height offsets requires the
 denormalized tide. */
-double TCMgr::time2asecondary (time_t t, IDX_entry *pIDX) {
+double TCMgr::time2asecondary (time_t t, tide_station_state *ps, tide_secondary_cache *pcache) {
+
+  IDX_entry *pIDX = ps->pIDX;
 
   /* Get rid of the normals. */
-  if (!(have_offsets))
-    return time2atide (t, pIDX);
+  if (!(ps->have_offsets))
+    return time2atide (t, ps);
 
   {
 /* Intervalwidth of 14 (was originally 13) failed on this input:
@@ -2552,8 +2996,10 @@ double TCMgr::time2asecondary (time_t t, IDX_entry *pIDX) {
 #define intervalwidth 15
 #define stretchfactor 3
 
-    static time_t lowtime=0, hightime=0;
-    static double lowlvl, highlvl; /* Normalized tide levels for MIN, MAX */
+    time_t &lowtime = pcache->lowtime;    /* Kept by the caller from one call to the next */
+    time_t &hightime = pcache->hightime;
+    double &lowlvl = pcache->lowlvl;      /* Normalized tide levels for MIN, MAX */
+    double &highlvl = pcache->highlvl;
     time_t T;  /* Adjusted t */
     double S, Z, HI, HS, magicnum;
     time_t interval = 3600 * intervalwidth;
@@ -2572,8 +3018,8 @@ double TCMgr::time2asecondary (time_t t, IDX_entry *pIDX) {
        the zero of the tide function as the mean, but this gave bad
        results around summer and winter for locations with large seasonal
        variations. */
-    Z = time2mean(T);
-    S = time2tide(T) - Z;
+    Z = time2mean(T, ps);
+    S = time2tide(T, ps) - Z;
 
     /* Find MAX and MIN.  I use the highest high tide and the lowest
        low tide over a 26 hour period, but I allow the interval to stretch
@@ -2609,12 +3055,12 @@ double TCMgr::time2asecondary (time_t t, IDX_entry *pIDX) {
       time_t tt;
       double tl;
       tt = T - interval;
-      next_big_event (&tt, pIDX);
-      lowlvl = time2tide (tt);
+      next_big_event (&tt, ps);
+      lowlvl = time2tide (tt, ps);
       lowtime = tt;
       while (tt < T + interval) {
-        next_big_event (&tt, pIDX);
-        tl = time2tide (tt);
+        next_big_event (&tt, ps);
+        tl = time2tide (tt, ps);
         if (tl < lowlvl && tt < T + interval) {
           lowlvl = tl;
           lowtime = tt;
@@ -2628,12 +3074,12 @@ double TCMgr::time2asecondary (time_t t, IDX_entry *pIDX) {
       time_t tt;
       double tl;
       tt = T - interval;
-      next_big_event (&tt, pIDX);
-      highlvl = time2tide (tt);
+      next_big_event (&tt, ps);
+      highlvl = time2tide (tt, ps);
       hightime = tt;
       while (tt < T + interval) {
-        next_big_event (&tt, pIDX);
-        tl = time2tide (tt);
+        next_big_event (&tt, ps);
+        tl = time2tide (tt, ps);
         if (tl > highlvl && tt < T + interval) {
           highlvl = tl;
           hightime = tt;
@@ -2660,11 +3106,11 @@ double TCMgr::time2asecondary (time_t t, IDX_entry *pIDX) {
       magicnum = 0.5 * S / fabs(lowlvl - Z);
 //    T = T - magicnum * (httimeoff - lttimeoff);
     T = T - (time_t)(magicnum * ((pIDX->IDX_ht_time_off * 60) - (pIDX->IDX_lt_time_off * 60)));
-      HI = time2tide(T);
+      HI = time2tide(T, ps);
 
 //    Correct the amplitude offsets for BOGUS knot^2 units
       double ht_off, lt_off;
-      if (pmsd->have_BOGUS)
+      if (ps->pmsd->have_BOGUS)
       {
             ht_off = pIDX->IDX_ht_off * pIDX->IDX_ht_off;         // Square offset in kts to adjust for kts^2
             lt_off = pIDX->IDX_lt_off * pIDX->IDX_lt_off;
@@ -2677,7 +3123,7 @@ double TCMgr::time2asecondary (time_t t, IDX_entry *pIDX) {
 
 
     /* Denormalize and apply the height offsets. */
-    HI = BOGUS_amplitude(HI, pIDX) + pmsd->DATUM;
+    HI = BOGUS_amplitude(HI, ps) + ps->pmsd->DATUM;
     {
       double RH=1.0, RL=1.0, HH=0.0, HL=0.0;
       RH = pIDX->IDX_ht_mpy;
@@ -2748,21 +3194,20 @@ double TCMgr::time2asecondary (time_t t, IDX_entry *pIDX) {
  *  Except for this detail, time2dt_tide(t,0) should return a value
  *  identical to time2tide(t).
  */
- double TCMgr::_time2dt_tide (time_t t, int deriv)
+ double TCMgr::_time2dt_tide (time_t t, int deriv, tide_year_coeffs *pc, tide_station_state *ps)
 {
   double dt_tide = 0.0;
   int a, b;
   double term, tempd;
+  long dt = (long)(t - pc->epoch);
 
   tempd = M_PI / 2.0 * deriv;
-  for (a=0;a<num_csts;a++)
+  for (a=0;a<ps->num_csts;a++)
     {
-      term = work[a] *
-          cos(tempd +
-              cst_speeds[a] * ((long)(t - epoch) + pmsd->meridian) +
-              cst_epochs[a][year-first_year] - pmsd->epoch[a]);
+      term = pc->work[a] *
+          cos(tempd + ps->cst_speeds[a] * dt + pc->phase[a]);
       for (b = deriv; b > 0; b--)
-          term *= cst_speeds[a];
+          term *= ps->cst_speeds[a];
       dt_tide += term;
     }
   return dt_tide;
@@ -2809,11 +3254,10 @@ blend_weight (double x, int deriv)
  * This function does the actual "blending" of the tide
  * and its derivatives.
  */
-double TCMgr::blend_tide (time_t t, int deriv, int first_year, double blend)
+double TCMgr::blend_tide (time_t t, int deriv, tide_year_coeffs *pc_first, tide_station_state *ps, double blend)
 {
   double        fl[TIDE_MAX_DERIV + 1];
   double        fr[TIDE_MAX_DERIV + 1];
-  double *      fp      = fl;
   double        w[TIDE_MAX_DERIV + 1];
   double        fact = 1.0;
   double        f;
@@ -2821,33 +3265,13 @@ double TCMgr::blend_tide (time_t t, int deriv, int first_year, double blend)
 
 
   /*
-   * If we are already happy_new_year()ed into one of the two years
-   * of interest, compute that years tide values first.
-   */
-  if (year == first_year + 1)
-      fp = fr;
-  else if (year != first_year)
-      happy_new_year(first_year);
-  for (n = 0; n <= deriv; n++)
-      fp[n] = _time2dt_tide(t, n);
-
-  /*
-   * Compute tide values for the other year of interest,
+   * Compute the tide values for the two years of interest,
    *  and the needed values of w(x) and its derivatives.
    */
-  if (fp == fl)
-    {
-      happy_new_year(first_year + 1);
-      fp = fr;
-    }
-  else
-    {
-      happy_new_year(first_year);
-      fp = fl;
-    }
   for (n = 0; n <= deriv; n++)
     {
-      fp[n] = _time2dt_tide(t, n);
+      fl[n] = _time2dt_tide(t, n, pc_first, ps);
+      fr[n] = _time2dt_tide(t, n, pc_first + 1, ps);
       w[n] = blend_weight(blend, n);
     }
 
@@ -2863,52 +3287,134 @@ double TCMgr::blend_tide (time_t t, int deriv, int first_year, double blend)
   return f;
 }
 
-double TCMgr::time2dt_tide (time_t t, int deriv)
+/*
+ * The years' coefficients are those of the state: this year (by the clock,
+ * not by t) and the years either side of it, for the blending.
+ */
+double TCMgr::time2dt_tide (time_t t, int deriv, tide_station_state *ps)
 {
-  static time_t next_epoch      = TIDE_BAD_TIME; /* next years newyears */
-  static time_t this_epoch      = TIDE_BAD_TIME; /* this years newyears */
-  static int    this_year       = -1;
-  int           new_year;
-      time_t tt = time(NULL);
-      int yott = ((gmtime (&tt))->tm_year) + 1900;
-      new_year = yott;                    //= yearoftimet(t);
-
-  /* Make sure our values of next_epoch and epoch are up to date. */
-  if (new_year != this_year)
-    {
-      if (new_year + 1 < first_year + num_epochs)
-        {
-          set_epoch(new_year + 1, num_epochs, first_year);
-          next_epoch = epoch;
-        }
-      else
-          next_epoch = TIDE_BAD_TIME;
-
-      happy_new_year(this_year = new_year);
-      this_epoch = epoch;
-    }
-
+  tide_year_coeffs *pc = ps->coeffs;
+  time_t this_epoch = pc[1].epoch;              /* this years newyears */
+  time_t next_epoch = pc[2].epoch;              /* next years newyears */
 
   /*
    * If we're close to either the previous or the next
    * new years we must blend the two years tides.
    */
-  if (t - this_epoch <= TIDE_BLEND_TIME && this_year > first_year)
-      return blend_tide(t, deriv,
-                        this_year - 1,
+  if (t - this_epoch <= TIDE_BLEND_TIME && pc[0].work)
+      return blend_tide(t, deriv, &pc[0], ps,
                         (double)(t - this_epoch)/TIDE_BLEND_TIME);
-  else if (next_epoch - t <= TIDE_BLEND_TIME
-           && this_year + 1 < first_year + num_epochs)
-      return blend_tide(t, deriv,
-                        this_year,
+  else if (next_epoch - t <= TIDE_BLEND_TIME && pc[2].work)
+      return blend_tide(t, deriv, &pc[1], ps,
                         -(double)(next_epoch - t)/TIDE_BLEND_TIME);
 
   /*
    * Else, we're far enough from newyears to ignore the blending.
    */
-  if (this_year != year)
-      happy_new_year(this_year);
-  return _time2dt_tide(t, deriv);
+  return _time2dt_tide(t, deriv, &pc[1], ps);
+}
+
+/*
+ * Index of the year whose coefficients alone give the tide at t,
+ * or -1 if t is in a new year blend.  Follows time2dt_tide().
+ */
+static int tide_unblended_year (time_t t, tide_station_state *ps)
+{
+  tide_year_coeffs *pc = ps->coeffs;
+
+  if (t - pc[1].epoch <= TIDE_BLEND_TIME && pc[0].work)
+      return (t <= pc[1].epoch - TIDE_BLEND_TIME) ? 0 : -1;
+  else if (pc[2].epoch - t <= TIDE_BLEND_TIME && pc[2].work)
+      return (t >= pc[2].epoch + TIDE_BLEND_TIME) ? 2 : -1;
+
+  return 1;
+}
+
+/*
+ * Denormalized tide at t0, t0 + step, ... t0 + (n - 1) * step, into pval.
+ *
+ * For a reference station, over a span that needs no new year blending,
+ * each constituent is advanced from one step to the next by rotation,
+ *
+ *   cos(x + d) = cos(x) cos(d) - sin(x) sin(d)
+ *   sin(x + d) = sin(x) cos(d) + cos(x) sin(d)
+ *
+ * which turns n * num_csts cos() calls into multiply-adds down contiguous
+ * arrays, a loop the compiler can vectorize.  The exact phases are taken
+ * again every TIDE_SERIES_RESEED steps, so that rounding does not build up.
+ * Anything else is evaluated point by point.
+ */
+void TCMgr::time2asecondary_series (time_t t0, int step, int n, tide_station_state *ps,
+                                    tide_secondary_cache *pcache, float *pval)
+{
+  int k, a;
+
+  if (n <= 0)
+      return;
+
+  int iy = -1;
+  if (!ps->have_offsets)
+    {
+      int iy0 = tide_unblended_year (t0, ps);
+      int iy1 = tide_unblended_year (t0 + (time_t)(n - 1) * step, ps);
+      if (iy0 == iy1)
+          iy = iy0;
+    }
+
+  double *pbuf = NULL;
+  if (iy >= 0)
+      pbuf = (double *) malloc (4 * ps->num_csts * sizeof (double));
+
+  if (!pbuf)
+    {
+      for (k = 0; k < n; k++)
+          pval[k] = time2asecondary (t0 + (time_t)k * step, ps, pcache);
+      return;
+    }
+
+  int nc = ps->num_csts;
+  tide_year_coeffs *pc = &ps->coeffs[iy];
+  double *work = pc->work;
+  double *pcos = pbuf;
+  double *psin = pbuf + nc;
+  double *pcosd = pbuf + (2 * nc);
+  double *psind = pbuf + (3 * nc);
+
+  for (a = 0; a < nc; a++)
+    {
+      double d = ps->cst_speeds[a] * step;
+      pcosd[a] = cos (d);
+      psind[a] = sin (d);
+    }
+
+  for (k = 0; k < n; k++)
+    {
+      if ((k % TIDE_SERIES_RESEED) == 0)
+        {
+          long dt = (long)(t0 + (time_t)k * step - pc->epoch);
+          for (a = 0; a < nc; a++)
+            {
+              double x = ps->cst_speeds[a] * dt + pc->phase[a];
+              pcos[a] = cos (x);
+              psin[a] = sin (x);
+            }
+        }
+
+      double tide = 0.0;
+      for (a = 0; a < nc; a++)
+          tide += work[a] * pcos[a];
+
+      pval[k] = BOGUS_amplitude (tide, ps) + ps->pmsd->DATUM;
+
+      for (a = 0; a < nc; a++)
+        {
+          double c = pcos[a];
+          pcos[a] = c * pcosd[a] - psin[a] * psind[a];
+          psin[a] = psin[a] * pcosd[a] + c * psind[a];
+        }
+    }
+
+  free (pbuf);
 }
 
 int TCMgr::GetStationIDXbyName(wxString prefix, double xlat, double xlon, TCMgr *ptcmgr)
@@ -0,0 +1,170 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenCPN
+ * Purpose:  Pixel kernels, SSE2 against the reference versions
+ * Author:   David Register
+ *
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register   *
+ *   $EMAIL$   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ *
+ *    Usage:  pixelkernels_test
+ *
+ *    ocpnFillPixelRun24() and ocpnColumnSum8() must give exactly what
+ *    their _C reference versions give.  Every length up to a few SSE2
+ *    blocks is tried, odd ones included, from every start offset within
+ *    a 16 byte line, so that both ends of the output fall unaligned.
+ *    Guard bytes around each output catch any overrun.
+ *
+ *    The exit status is non-zero on any mismatch.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pixelkernels.h"
+
+#define MAX_PIXELS      100               // more than six 16 pixel blocks
+#define MAX_BYTES       100               // more than six 16 byte blocks
+#define MAX_OFFSET      16
+#define GUARD           32
+#define GUARD_BYTE      0xa5
+
+static int s_nfailed;
+
+static void Fail(const char *what, int len, int offset, int extra)
+{
+      if(s_nfailed < 10)
+            printf("   %s mismatch: length %d, offset %d, %d\n", what, len, offset, extra);
+      s_nfailed++;
+}
+
+static bool GuardOK(const unsigned char *p, int n)
+{
+      for(int i=0 ; i < n ; i++)
+      {
+            if(p[i] != GUARD_BYTE)
+                  return false;
+      }
+      return true;
+}
+
+static void TestFillPixelRun24(void)
+{
+      static const int colors[] = { 0x000000, 0xffffff, 0x123456, 0xa5005a, 0x7f80ff };
+
+      unsigned char buf[GUARD + MAX_OFFSET + (MAX_PIXELS * 3) + GUARD];
+      unsigned char ref[GUARD + MAX_OFFSET + (MAX_PIXELS * 3) + GUARD];
+
+      for(unsigned int ic=0 ; ic < sizeof(colors) / sizeof(colors[0]) ; ic++)
+      {
+            for(int offset=0 ; offset < MAX_OFFSET ; offset++)
+            {
+                  for(int count=0 ; count <= MAX_PIXELS ; count++)
+                  {
+                        memset(buf, GUARD_BYTE, sizeof(buf));
+                        memset(ref, GUARD_BYTE, sizeof(ref));
+
+                        //    The high byte must be ignored
+                        int rgbval = colors[ic] | 0x5a000000;
+
+                        ocpnFillPixelRun24(buf + GUARD + offset, rgbval, count);
+                        ocpnFillPixelRun24_C(ref + GUARD + offset, rgbval, count);
+
+                        if(memcmp(buf, ref, sizeof(buf)))
+                              Fail("ocpnFillPixelRun24", count, offset, colors[ic]);
+
+                        int n_end = GUARD + offset + (count * 3);
+                        if(!GuardOK(buf, GUARD + offset) || !GuardOK(buf + n_end, sizeof(buf) - n_end))
+                              Fail("ocpnFillPixelRun24 guard", count, offset, colors[ic]);
+                  }
+            }
+      }
+}
+
+static void TestColumnSum8(void)
+{
+      static const int rows[] = { 1, 2, 3, 16, 255, 257 };
+
+      //    Rows are an odd number of bytes apart, so each row starts differently aligned
+      const int row_bytes = MAX_OFFSET + MAX_BYTES + 7;
+      const int max_rows = 257;
+
+      unsigned char *psrc = (unsigned char *)malloc(row_bytes * max_rows);
+      unsigned short sum[GUARD + MAX_OFFSET + MAX_BYTES + GUARD];
+      unsigned short ref[GUARD + MAX_OFFSET + MAX_BYTES + GUARD];
+
+      for(int pass=0 ; pass < 2 ; pass++)
+      {
+            //    Random data, then all 255, the largest sums allowed
+            srand(1234);
+            for(int i=0 ; i < row_bytes * max_rows ; i++)
+                  psrc[i] = pass ? 255 : (rand() & 0xff);
+
+            for(unsigned int ir=0 ; ir < sizeof(rows) / sizeof(rows[0]) ; ir++)
+            {
+                  for(int offset=0 ; offset < MAX_OFFSET ; offset++)
+                  {
+                        for(int n_bytes=0 ; n_bytes <= MAX_BYTES ; n_bytes++)
+                        {
+                              memset(sum, GUARD_BYTE, sizeof(sum));
+                              memset(ref, GUARD_BYTE, sizeof(ref));
+
+                              //    Source and destination both start at the offset
+                              ocpnColumnSum8(psrc + offset, row_bytes, rows[ir], n_bytes, sum + GUARD + offset);
+                              ocpnColumnSum8_C(psrc + offset, row_bytes, rows[ir], n_bytes, ref + GUARD + offset);
+
+                              if(memcmp(sum, ref, sizeof(sum)))
+                                    Fail("ocpnColumnSum8", n_bytes, offset, rows[ir]);
+
+                              int n_end = GUARD + offset + n_bytes;
+                              if(!GuardOK((unsigned char *)sum, (GUARD + offset) * sizeof(unsigned short))
+                                 || !GuardOK((unsigned char *)(sum + n_end), sizeof(sum) - (n_end * sizeof(unsigned short))))
+                                    Fail("ocpnColumnSum8 guard", n_bytes, offset, rows[ir]);
+                        }
+                  }
+            }
+      }
+
+      free(psrc);
+}
+
+int main(int argc, char **argv)
+{
+#ifdef ocpnUSE_SSE2
+      printf("SSE2 kernels built, CPU %s SSE2\n", ocpnCPUHasSSE2() ? "has" : "lacks");
+#else
+      printf("SSE2 kernels not built, checking the scalar path only\n");
+#endif
+
+      TestFillPixelRun24();
+      TestColumnSum8();
+
+      if(s_nfailed)
+      {
+            printf("%d mismatches\n", s_nfailed);
+            return 1;
+      }
+
+      printf("All kernels match\n");
+      return 0;
+}
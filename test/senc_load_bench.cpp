@@ -0,0 +1,1799 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenCPN
+ * Purpose:  SENC load time, text format against binary format
+ * Author:   OpenCPN developers
+ *
+ ***************************************************************************
+ *   Copyright (C) by the OpenCPN developers                               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ *
+ *    Usage:  senc_load_bench [-n features] [-r runs] [-d work_dir] [SENC file]
+ *
+ *    Compares the time to load one large ENC cell from the old text SENC
+ *    layout (version 122) and from the current binary layout.
+ *
+ *    Given a binary SENC file, as made by OpenCPN in its SENC directory,
+ *    that cell is used.  Otherwise a synthetic cell of n features is made,
+ *    with areas, lines, lights and sounding clusters in about the
+ *    proportions of a large harbour cell.  The cell is written out in both
+ *    layouts, and each file is then loaded the given number of times.
+ *    The best time for each is reported.
+ *
+ *    The binary file is written with SENCWriteRecord() and read with the
+ *    record reader and parser of src/sencparser.cpp, the same code that
+ *    s57chart::BuildRAZFromSENCFile uses.  The decoded data are copied out
+ *    as S57Obj and PolyTessGeo copy them.
+ *
+ *    The text loader is no longer in the tree.  The copy here follows the
+ *    version 122 s57chart, S57Obj and PolyTessGeo, as the baseline.  One
+ *    difference: the old contour count line was split with
+ *    wxStringTokenizer, here it is done with strtol, which flatters the
+ *    text layout a little.
+ *
+ *    Not measured: building S57Obj itself, and the S52 lookup and rule
+ *    building that follow.  Those need the whole application, and are the
+ *    same for either layout.
+ *
+ *    Both loads must decode the same data, compared by checksum, or the
+ *    exit status is non-zero.
+ *
+ */
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+  #include "wx/wx.h"
+#endif //precompiled headers
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#ifndef __WXMSW__
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include <vector>
+#include <string>
+
+#include "s52s57.h"
+#include "mygeom.h"                       // for the PTG_ primitive types
+#include "sencparser.h"
+
+#define OLD_SENC_FORMAT_VERSION     122
+#define MAX_LINE                    499999      // as the old loader
+
+//----------------------------------------------------------------------------
+//    A decoded cell, holding what S57Obj and PolyTessGeo hold after loading
+//----------------------------------------------------------------------------
+
+typedef struct
+{
+      char        name[9];
+      int         type;                   // OGR_INT, OGR_REAL or OGR_STR
+      void        *value;
+}BenchAttr;
+
+typedef struct _BenchTriPrim
+{
+      int         type;
+      int         nVert;
+      double      *p_vertex;
+      double      bbox[4];                // minx, maxx, miny, maxy
+      struct _BenchTriPrim *p_next;
+}BenchTriPrim;
+
+typedef struct
+{
+      double      xmin, ymin, xmax, ymax;
+      double      ref_lat, ref_lon;
+      int         n_contours;
+      int         *pn_vertex;
+      int         n_geom_bytes;
+      float       *pgroup_geom;
+      BenchTriPrim *tri_prim_head;
+}BenchTess;
+
+typedef struct
+{
+      char        name[9];
+      int         fid;
+      int         prim;
+      int         geom_type;              // SENCGeomType
+      float       ref_lat, ref_lon;
+
+      std::vector<BenchAttr> attrs;
+
+      int         npt;
+      double      *geoPt;                 // point, line or multipoint (with depth) as SM
+      float       bbox[4];                // lonmax, lonmin, latmax, latmin
+      BenchTess   *ptess;
+
+      int         n_lsindex;
+      int         *lsindex;
+}BenchFeature;
+
+typedef struct
+{
+      int         index;
+      int         nCount;
+      double      *pPoints;
+}BenchEdge;
+
+typedef struct
+{
+      int         index;
+      double      point[2];
+}BenchNode;
+
+typedef struct
+{
+      char                          name[128];
+      std::vector<BenchFeature *>   features;
+      std::vector<BenchEdge>        edges;
+      std::vector<BenchNode>        nodes;
+}BenchCell;
+
+static BenchFeature *NewFeature(void)
+{
+      BenchFeature *pf = new BenchFeature;
+      memset(pf->name, 0, sizeof(pf->name));
+      pf->fid = 0;
+      pf->prim = 0;
+      pf->geom_type = SENC_GEOM_NONE;
+      pf->ref_lat = pf->ref_lon = 0;
+      pf->npt = 0;
+      pf->geoPt = NULL;
+      memset(pf->bbox, 0, sizeof(pf->bbox));
+      pf->ptess = NULL;
+      pf->n_lsindex = 0;
+      pf->lsindex = NULL;
+      return pf;
+}
+
+static void FreeTess(BenchTess *pt)
+{
+      if(!pt)
+            return;
+
+      free(pt->pn_vertex);
+      free(pt->pgroup_geom);
+
+      BenchTriPrim *ptp = pt->tri_prim_head;
+      while(ptp)
+      {
+            BenchTriPrim *pnext = ptp->p_next;
+            free(ptp->p_vertex);
+            delete ptp;
+            ptp = pnext;
+      }
+      delete pt;
+}
+
+static void FreeCell(BenchCell *pc)
+{
+      for(unsigned int i=0 ; i < pc->features.size() ; i++)
+      {
+            BenchFeature *pf = pc->features[i];
+            for(unsigned int ia=0 ; ia < pf->attrs.size() ; ia++)
+                  free(pf->attrs[ia].value);
+            free(pf->geoPt);
+            FreeTess(pf->ptess);
+            free(pf->lsindex);
+            delete pf;
+      }
+      pc->features.clear();
+
+      for(unsigned int i=0 ; i < pc->edges.size() ; i++)
+            free(pc->edges[i].pPoints);
+      pc->edges.clear();
+      pc->nodes.clear();
+}
+
+//    Number of floats per point in geoPt
+static int PointDim(int geom_type)
+{
+      return (geom_type == SENC_GEOM_MULTIPOINT) ? 3 : 2;
+}
+
+//----------------------------------------------------------------------------
+//    Checksum of everything both layouts carry exactly
+//    Real attributes are compared as floats, since the text layout keeps
+//    only a float.  Tesselation extents and reference points are left out, since
+//    the text layout rounds them.
+//----------------------------------------------------------------------------
+
+typedef unsigned long long BenchHash;
+
+static void HashBytes(BenchHash *ph, const void *p, size_t n)
+{
+      const unsigned char *pc = (const unsigned char *)p;
+      for(size_t i=0 ; i < n ; i++)
+      {
+            *ph ^= pc[i];
+            *ph *= 1099511628211ULL;
+      }
+}
+
+static void HashInt(BenchHash *ph, int v)
+{
+      HashBytes(ph, &v, sizeof(int));
+}
+
+static BenchHash CellChecksum(BenchCell *pc)
+{
+      BenchHash h = 14695981039346656037ULL;
+
+      HashInt(&h, pc->features.size());
+      for(unsigned int i=0 ; i < pc->features.size() ; i++)
+      {
+            BenchFeature *pf = pc->features[i];
+            HashBytes(&h, pf->name, 6);
+            HashInt(&h, pf->fid);
+            HashInt(&h, pf->prim);
+            HashInt(&h, pf->geom_type);
+
+            HashInt(&h, pf->attrs.size());
+            for(unsigned int ia=0 ; ia < pf->attrs.size() ; ia++)
+            {
+                  BenchAttr *pa = &pf->attrs[ia];
+                  HashBytes(&h, pa->name, 6);
+                  HashInt(&h, pa->type);
+                  if(pa->type == OGR_INT)
+                        HashInt(&h, *(int *)pa->value);
+                  else if(pa->type == OGR_REAL)
+                  {
+                        float fv = *(double *)pa->value;
+                        HashBytes(&h, &fv, sizeof(float));
+                  }
+                  else
+                        HashBytes(&h, pa->value, strlen((char *)pa->value));
+            }
+
+            HashInt(&h, pf->npt);
+            if(pf->geoPt)
+                  HashBytes(&h, pf->geoPt, pf->npt * PointDim(pf->geom_type) * sizeof(double));
+            if((pf->geom_type == SENC_GEOM_LINE) || (pf->geom_type == SENC_GEOM_MULTIPOINT))
+                  HashBytes(&h, pf->bbox, sizeof(pf->bbox));
+
+            if(pf->ptess)
+            {
+                  BenchTess *pt = pf->ptess;
+                  HashInt(&h, pt->n_contours);
+                  HashBytes(&h, pt->pn_vertex, pt->n_contours * sizeof(int));
+                  HashInt(&h, pt->n_geom_bytes);
+                  HashBytes(&h, pt->pgroup_geom, pt->n_geom_bytes);
+
+                  BenchTriPrim *ptp = pt->tri_prim_head;
+                  while(ptp)
+                  {
+                        HashInt(&h, ptp->type);
+                        HashInt(&h, ptp->nVert);
+                        HashBytes(&h, ptp->p_vertex, ptp->nVert * 2 * sizeof(double));
+                        HashBytes(&h, ptp->bbox, sizeof(ptp->bbox));
+                        ptp = ptp->p_next;
+                  }
+            }
+
+            HashInt(&h, pf->n_lsindex);
+            HashBytes(&h, pf->lsindex, pf->n_lsindex * 3 * sizeof(int));
+      }
+
+      HashInt(&h, pc->edges.size());
+      for(unsigned int i=0 ; i < pc->edges.size() ; i++)
+      {
+            HashInt(&h, pc->edges[i].index);
+            HashInt(&h, pc->edges[i].nCount);
+            HashBytes(&h, pc->edges[i].pPoints, pc->edges[i].nCount * 2 * sizeof(double));
+      }
+
+      HashInt(&h, pc->nodes.size());
+      for(unsigned int i=0 ; i < pc->nodes.size() ; i++)
+      {
+            HashInt(&h, pc->nodes[i].index);
+            HashBytes(&h, pc->nodes[i].point, sizeof(pc->nodes[i].point));
+      }
+
+      return h;
+}
+
+//----------------------------------------------------------------------------
+//    Synthetic cell
+//----------------------------------------------------------------------------
+
+static unsigned int s_rand_state;
+
+static unsigned int BenchRand(void)
+{
+      s_rand_state = s_rand_state * 1103515245 + 12345;
+      return (s_rand_state >> 8) & 0xffffff;
+}
+
+static int RandRange(int lo, int hi)
+{
+      return lo + (BenchRand() % (hi - lo + 1));
+}
+
+static float RandCoord(float base, float spread)
+{
+      return base + spread * ((BenchRand() & 0xffff) / 65536.f);
+}
+
+static void AddIntAttr(BenchFeature *pf, const char *name, int v)
+{
+      BenchAttr a;
+      strncpy(a.name, name, 8);
+      a.name[8] = 0;
+      a.type = OGR_INT;
+      a.value = malloc(sizeof(int));
+      *(int *)a.value = v;
+      pf->attrs.push_back(a);
+}
+
+static void AddRealAttr(BenchFeature *pf, const char *name, double v)
+{
+      BenchAttr a;
+      strncpy(a.name, name, 8);
+      a.name[8] = 0;
+      a.type = OGR_REAL;
+      a.value = malloc(sizeof(double));
+      *(double *)a.value = v;
+      pf->attrs.push_back(a);
+}
+
+static void AddStrAttr(BenchFeature *pf, const char *name, const char *v)
+{
+      BenchAttr a;
+      strncpy(a.name, name, 8);
+      a.name[8] = 0;
+      a.type = OGR_STR;
+      a.value = malloc(strlen(v) + 1);
+      strcpy((char *)a.value, v);
+      pf->attrs.push_back(a);
+}
+
+static void MakeLsIndex(BenchFeature *pf, int n_edges)
+{
+      pf->n_lsindex = RandRange(1, 6);
+      pf->lsindex = (int *)malloc(pf->n_lsindex * 3 * sizeof(int));
+      for(int i=0 ; i < pf->n_lsindex ; i++)
+      {
+            pf->lsindex[3 * i] = RandRange(1, n_edges);
+            pf->lsindex[(3 * i) + 1] = RandRange(1, n_edges);
+            pf->lsindex[(3 * i) + 2] = RandRange(1, n_edges);
+      }
+}
+
+static void MakeSyntheticCell(BenchCell *pc, int n_features)
+{
+      static const char *area_names[] = { "DEPARE", "LNDARE", "DRGARE", "SEAARE", "BUAARE" };
+      static const char *line_names[] = { "DEPCNT", "COALNE", "SLCONS", "NAVLNE" };
+      static const char *point_names[] = { "LIGHTS", "BOYLAT", "BCNCAR", "LNDMRK" };
+
+      s_rand_state = 12345;
+      strcpy(pc->name, "SYNTHETIC");
+
+      const float ref_lat = 37.8f;
+      const float ref_lon = -122.4f;
+      int n_edges = wxMax(n_features / 2, 1);
+
+      for(int i=0 ; i < n_features ; i++)
+      {
+            BenchFeature *pf = NewFeature();
+            pf->fid = i + 1;
+            pf->ref_lat = ref_lat;
+            pf->ref_lon = ref_lon;
+
+            int kind = i % 10;
+            char text[64];
+
+            AddIntAttr(pf, "SCAMIN", RandRange(8000, 90000));
+
+            if(kind < 4)                                    // area
+            {
+                  strcpy(pf->name, area_names[i % 5]);
+                  pf->prim = 3;
+                  pf->geom_type = SENC_GEOM_AREA;
+                  AddRealAttr(pf, "DRVAL1", RandRange(0, 400) / 8.);
+                  AddRealAttr(pf, "DRVAL2", RandRange(0, 400) / 8.);
+                  if(kind == 0)
+                  {
+                        sprintf(text, "Anchorage area %d", i);
+                        AddStrAttr(pf, "OBJNAM", text);
+                  }
+
+                  BenchTess *pt = new BenchTess;
+                  pt->xmin = ref_lon;
+                  pt->xmax = ref_lon + 0.1;
+                  pt->ymin = ref_lat;
+                  pt->ymax = ref_lat + 0.1;
+                  pt->ref_lat = ref_lat;
+                  pt->ref_lon = ref_lon;
+
+                  int nv = RandRange(20, 300);
+                  pt->n_contours = RandRange(1, 3);
+                  pt->pn_vertex = (int *)malloc(pt->n_contours * sizeof(int));
+                  for(int ic=0 ; ic < pt->n_contours ; ic++)
+                        pt->pn_vertex[ic] = nv / pt->n_contours;
+
+                  pt->n_geom_bytes = nv * 2 * sizeof(float);
+                  pt->pgroup_geom = (float *)malloc(pt->n_geom_bytes);
+                  for(int iv=0 ; iv < nv * 2 ; iv++)
+                        pt->pgroup_geom[iv] = RandCoord(-5000.f, 10000.f);
+
+                  //    Mostly strips, a few fans and lists
+                  pt->tri_prim_head = NULL;
+                  BenchTriPrim **pprev = &pt->tri_prim_head;
+                  int n_prims = RandRange(1, 4);
+                  for(int ip=0 ; ip < n_prims ; ip++)
+                  {
+                        BenchTriPrim *ptp = new BenchTriPrim;
+                        ptp->type = (ip % 3 == 0) ? PTG_TRIANGLE_STRIP : ((ip % 3 == 1) ? PTG_TRIANGLE_FAN : PTG_TRIANGLES);
+                        ptp->nVert = (ptp->type == PTG_TRIANGLES) ? 3 * RandRange(1, 20) : RandRange(3, nv);
+                        ptp->p_vertex = (double *)malloc(ptp->nVert * 2 * sizeof(double));
+                        for(int iv=0 ; iv < ptp->nVert * 2 ; iv++)
+                              ptp->p_vertex[iv] = RandCoord(ref_lon, 0.1f);
+                        ptp->bbox[0] = ref_lon;
+                        ptp->bbox[1] = ref_lon + 0.1;
+                        ptp->bbox[2] = ref_lat;
+                        ptp->bbox[3] = ref_lat + 0.1;
+                        ptp->p_next = NULL;
+                        *pprev = ptp;
+                        pprev = &ptp->p_next;
+                  }
+                  pf->ptess = pt;
+
+                  MakeLsIndex(pf, n_edges);
+            }
+            else if(kind < 7)                               // line
+            {
+                  strcpy(pf->name, line_names[i % 4]);
+                  pf->prim = 2;
+                  pf->geom_type = SENC_GEOM_LINE;
+                  AddRealAttr(pf, "VALDCO", RandRange(0, 400) / 4.);
+
+                  pf->npt = RandRange(10, 250);
+                  pf->geoPt = (double *)malloc(pf->npt * 2 * sizeof(double));
+                  for(int ip=0 ; ip < pf->npt * 2 ; ip++)
+                        pf->geoPt[ip] = RandCoord(-5000.f, 10000.f);
+
+                  pf->bbox[0] = ref_lon + 0.1f;
+                  pf->bbox[1] = ref_lon;
+                  pf->bbox[2] = ref_lat + 0.1f;
+                  pf->bbox[3] = ref_lat;
+
+                  MakeLsIndex(pf, n_edges);
+            }
+            else if(kind < 9)                               // point
+            {
+                  strcpy(pf->name, point_names[i % 4]);
+                  pf->prim = 1;
+                  pf->geom_type = SENC_GEOM_POINT;
+                  AddIntAttr(pf, "COLOUR", RandRange(1, 12));
+                  AddRealAttr(pf, "VALNMR", RandRange(1, 200) / 2.);
+                  AddRealAttr(pf, "SIGPER", RandRange(1, 100) / 4.);
+                  sprintf(text, "Fl(%d) G %ds", RandRange(1, 4), RandRange(2, 10));
+                  AddStrAttr(pf, "SIGGRP", text);
+
+                  pf->npt = 1;
+                  pf->geoPt = (double *)malloc(2 * sizeof(double));
+                  pf->geoPt[0] = RandCoord(-5000.f, 10000.f);
+                  pf->geoPt[1] = RandCoord(-5000.f, 10000.f);
+            }
+            else                                            // soundings
+            {
+                  strcpy(pf->name, "SOUNDG");
+                  pf->prim = 1;
+                  pf->geom_type = SENC_GEOM_MULTIPOINT;
+
+                  pf->npt = RandRange(20, 400);
+                  pf->geoPt = (double *)malloc(pf->npt * 3 * sizeof(double));
+                  for(int ip=0 ; ip < pf->npt ; ip++)
+                  {
+                        pf->geoPt[3 * ip] = RandCoord(-5000.f, 10000.f);
+                        pf->geoPt[(3 * ip) + 1] = RandCoord(-5000.f, 10000.f);
+                        pf->geoPt[(3 * ip) + 2] = RandRange(0, 4000) / 8.f;
+                  }
+
+                  pf->bbox[0] = ref_lon + 0.1f;
+                  pf->bbox[1] = ref_lon;
+                  pf->bbox[2] = ref_lat + 0.1f;
+                  pf->bbox[3] = ref_lat;
+            }
+
+            pc->features.push_back(pf);
+      }
+
+      for(int i=0 ; i < n_edges ; i++)
+      {
+            BenchEdge e;
+            e.index = i + 1;
+            e.nCount = RandRange(2, 40);
+            e.pPoints = (double *)malloc(e.nCount * 2 * sizeof(double));
+            for(int ip=0 ; ip < e.nCount * 2 ; ip++)
+                  e.pPoints[ip] = RandCoord(-5000.f, 10000.f);
+            pc->edges.push_back(e);
+      }
+
+      for(int i=0 ; i < n_edges ; i++)
+      {
+            BenchNode n;
+            n.index = n_edges + i + 1;
+            n.point[0] = RandCoord(-5000.f, 10000.f);
+            n.point[1] = RandCoord(-5000.f, 10000.f);
+            pc->nodes.push_back(n);
+      }
+}
+
+//----------------------------------------------------------------------------
+//    Writers
+//----------------------------------------------------------------------------
+
+//    Geometry floats, as stored in either layout
+static void GetGeometryFloats(BenchFeature *pf, std::vector<float> &fv)
+{
+      int n = pf->npt * PointDim(pf->geom_type);
+      fv.resize(n);
+      for(int i=0 ; i < n ; i++)
+            fv[i] = (float)pf->geoPt[i];
+}
+
+static void PutBytes(std::vector<unsigned char> &v, const void *p, size_t n)
+{
+      const unsigned char *pc = (const unsigned char *)p;
+      v.insert(v.end(), pc, pc + n);
+}
+
+static void PadTo(std::vector<unsigned char> &v, size_t n)
+{
+      v.resize(n, 0);
+}
+
+static void WriteBinaryRecord(FILE *fp, int type, std::vector<unsigned char> &payload)
+{
+      SENCWriteRecord(fp, type, payload.size() ? &payload[0] : NULL, payload.size());
+}
+
+static bool WriteBinarySENC(BenchCell *pc, const char *path)
+{
+      FILE *fp = fopen(path, "wb");
+      if(!fp)
+            return false;
+
+      SENCFileHeader hdr;
+      memset(&hdr, 0, sizeof(hdr));
+      memcpy(hdr.magic, SENC_FILE_MAGIC, 8);
+      hdr.version = CURRENT_SENC_FORMAT_VERSION;
+      hdr.header_size = sizeof(SENCFileHeader);
+      hdr.n_geo_records = pc->features.size();
+      hdr.n_features = pc->features.size();
+      hdr.native_scale = 20000;
+      strncpy(hdr.name, pc->name, sizeof(hdr.name) - 1);
+      strcpy(hdr.date000, "20100101");
+      strcpy(hdr.dateupd, "20100601");
+      fwrite(&hdr, 1, sizeof(hdr), fp);
+
+      std::vector<unsigned char> rec;
+      for(unsigned int i=0 ; i < pc->features.size() ; i++)
+      {
+            BenchFeature *pf = pc->features[i];
+            rec.clear();
+
+            SENCFeatureHeader fh;
+            memset(&fh, 0, sizeof(fh));
+            strncpy(fh.feature_name, pf->name, 8);
+            fh.fid = pf->fid;
+            fh.prim = pf->prim;
+            fh.geom_type = pf->geom_type;
+            fh.n_attributes = pf->attrs.size();
+            fh.ref_lat = pf->ref_lat;
+            fh.ref_lon = pf->ref_lon;
+            PutBytes(rec, &fh, sizeof(fh));
+
+            size_t att_start = rec.size();
+            for(unsigned int ia=0 ; ia < pf->attrs.size() ; ia++)
+            {
+                  BenchAttr *pa = &pf->attrs[ia];
+                  SENCAttributeHeader ah;
+                  memset(&ah, 0, sizeof(ah));
+                  strncpy(ah.name, pa->name, 8);
+                  ah.value_type = pa->type;
+                  if(pa->type == OGR_INT)
+                        ah.value_bytes = sizeof(int);
+                  else if(pa->type == OGR_REAL)
+                        ah.value_bytes = sizeof(double);
+                  else
+                        ah.value_bytes = SENC_PAD4(strlen((char *)pa->value) + 1);
+                  PutBytes(rec, &ah, sizeof(ah));
+
+                  size_t vstart = rec.size();
+                  if(pa->type == OGR_STR)
+                        PutBytes(rec, pa->value, strlen((char *)pa->value) + 1);
+                  else
+                        PutBytes(rec, pa->value, ah.value_bytes);
+                  PadTo(rec, vstart + ah.value_bytes);
+            }
+            size_t geo_start = rec.size();
+
+            std::vector<float> fv;
+            switch(pf->geom_type)
+            {
+                  case SENC_GEOM_POINT:
+                        GetGeometryFloats(pf, fv);
+                        PutBytes(rec, &fv[0], 2 * sizeof(float));
+                        break;
+
+                  case SENC_GEOM_MULTIPOINT:
+                  case SENC_GEOM_LINE:
+                        GetGeometryFloats(pf, fv);
+                        PutBytes(rec, &pf->npt, sizeof(int));
+                        if(fv.size())
+                              PutBytes(rec, &fv[0], fv.size() * sizeof(float));
+                        PutBytes(rec, pf->bbox, sizeof(pf->bbox));
+                        if(pf->geom_type == SENC_GEOM_LINE)
+                        {
+                              PutBytes(rec, &pf->n_lsindex, sizeof(int));
+                              PutBytes(rec, pf->lsindex, pf->n_lsindex * 3 * sizeof(int));
+                        }
+                        break;
+
+                  case SENC_GEOM_AREA:
+                  {
+                        BenchTess *pt = pf->ptess;
+                        std::vector<unsigned char> tess;
+
+                        SENCPolyTessHeader th;
+                        memset(&th, 0, sizeof(th));
+                        th.xmin = pt->xmin;
+                        th.ymin = pt->ymin;
+                        th.xmax = pt->xmax;
+                        th.ymax = pt->ymax;
+                        th.ref_lat = pt->ref_lat;
+                        th.ref_lon = pt->ref_lon;
+                        th.n_contours = pt->n_contours;
+                        th.n_geom_bytes = pt->n_geom_bytes;
+                        BenchTriPrim *ptp = pt->tri_prim_head;
+                        while(ptp)
+                        {
+                              th.n_triprims++;
+                              ptp = ptp->p_next;
+                        }
+                        PutBytes(tess, &th, sizeof(th));
+
+                        PutBytes(tess, pt->pn_vertex, pt->n_contours * sizeof(int));
+                        PadTo(tess, SENC_PAD8(tess.size()));
+                        PutBytes(tess, pt->pgroup_geom, pt->n_geom_bytes);
+                        PadTo(tess, SENC_PAD8(tess.size()));
+
+                        ptp = pt->tri_prim_head;
+                        while(ptp)
+                        {
+                              PutBytes(tess, &ptp->type, sizeof(int));
+                              PutBytes(tess, &ptp->nVert, sizeof(int));
+                              PutBytes(tess, ptp->p_vertex, ptp->nVert * 2 * sizeof(double));
+                              PutBytes(tess, ptp->bbox, sizeof(ptp->bbox));
+                              ptp = ptp->p_next;
+                        }
+
+                        int tess_bytes = tess.size();
+                        PutBytes(rec, &tess_bytes, sizeof(int));
+                        PutBytes(rec, &tess[0], tess.size());
+                        PutBytes(rec, &pf->n_lsindex, sizeof(int));
+                        PutBytes(rec, pf->lsindex, pf->n_lsindex * 3 * sizeof(int));
+                        break;
+                  }
+
+                  default:
+                        break;
+            }
+
+            SENCFeatureHeader *pfh = (SENCFeatureHeader *)&rec[0];
+            pfh->attribute_bytes = geo_start - att_start;
+            pfh->geometry_bytes = rec.size() - geo_start;
+
+            WriteBinaryRecord(fp, SENC_RECORD_FEATURE, rec);
+      }
+
+      rec.clear();
+      int n = pc->edges.size();
+      PutBytes(rec, &n, sizeof(int));
+      for(unsigned int i=0 ; i < pc->edges.size() ; i++)
+      {
+            PutBytes(rec, &pc->edges[i].index, sizeof(int));
+            PutBytes(rec, &pc->edges[i].nCount, sizeof(int));
+            PutBytes(rec, pc->edges[i].pPoints, pc->edges[i].nCount * 2 * sizeof(double));
+      }
+      WriteBinaryRecord(fp, SENC_RECORD_VE_TABLE, rec);
+
+      rec.clear();
+      n = pc->nodes.size();
+      PutBytes(rec, &n, sizeof(int));
+      for(unsigned int i=0 ; i < pc->nodes.size() ; i++)
+      {
+            PutBytes(rec, &pc->nodes[i].index, sizeof(int));
+            PutBytes(rec, pc->nodes[i].point, 2 * sizeof(double));
+      }
+      WriteBinaryRecord(fp, SENC_RECORD_VC_TABLE, rec);
+
+      rec.clear();
+      WriteBinaryRecord(fp, SENC_RECORD_END, rec);
+
+      return (0 == fclose(fp));
+}
+
+//    The version 122 text layout, as written by the old s57chart::CreateSENCRecord
+static bool WriteTextSENC(BenchCell *pc, const char *path)
+{
+      FILE *fp = fopen(path, "wb");
+      if(!fp)
+            return false;
+
+      fprintf(fp, "SENC Version= %d\n", OLD_SENC_FORMAT_VERSION);
+      fprintf(fp, "NAME=%s\n", pc->name);
+      fprintf(fp, "DATE000=20100101\n");
+      fprintf(fp, "EDTN000=1\n");
+      fprintf(fp, "FILEMOD000=20100101\n");
+      fprintf(fp, "FILESIZE000=0\n");
+      fprintf(fp, "NOGR=%d\n", (int)pc->features.size());
+      fprintf(fp, "SCALE=20000\n");
+      fprintf(fp, "UPDT=0\n");
+      fprintf(fp, "DATEUPD=20100601\n");
+
+      char line[1000];
+      std::vector<float> fv;
+
+      for(unsigned int i=0 ; i < pc->features.size() ; i++)
+      {
+            BenchFeature *pf = pc->features[i];
+
+            fprintf(fp, "OGRFeature(%s):%d\n", pf->name, pf->fid);
+
+            //    PRIM and LNAM were written too, and skipped on reading
+            std::string header;
+            sprintf(line, "  PRIM (I) = %d\n", pf->prim);
+            header += line;
+            sprintf(line, "  LNAM (S) = 0226%08X0001\n", pf->fid);
+            header += line;
+
+            for(unsigned int ia=0 ; ia < pf->attrs.size() ; ia++)
+            {
+                  BenchAttr *pa = &pf->attrs[ia];
+                  if(pa->type == OGR_INT)
+                        sprintf(line, "  %s (I) = %d\n", pa->name, *(int *)pa->value);
+                  else if(pa->type == OGR_REAL)
+                        sprintf(line, "  %s (R) = %.15g\n", pa->name, *(double *)pa->value);
+                  else
+                        sprintf(line, "  %s (S) = %s\n", pa->name, (char *)pa->value);
+                  header += line;
+            }
+
+            const char *geo_name = "UNKNOWN";
+            switch(pf->geom_type)
+            {
+                  case SENC_GEOM_POINT:         geo_name = "POINT"; break;
+                  case SENC_GEOM_MULTIPOINT:    geo_name = "MULTIPOINT"; break;
+                  case SENC_GEOM_LINE:          geo_name = "LINESTRING"; break;
+                  case SENC_GEOM_AREA:          geo_name = "POLYGON"; break;
+            }
+            sprintf(line, "  %s %g %g\n", geo_name, pf->ref_lat, pf->ref_lon);
+            header += line;
+
+            fprintf(fp, "HDRLEN=%d\n", (int)header.size());
+            fwrite(header.c_str(), 1, header.size(), fp);
+
+            //    The OGR WKB head, byte order and geometry type, then the point count
+            unsigned char wkb_head[9];
+            memset(wkb_head, 0, sizeof(wkb_head));
+            wkb_head[0] = 1;
+            memcpy(wkb_head + 5, &pf->npt, sizeof(int));
+
+            switch(pf->geom_type)
+            {
+                  case SENC_GEOM_POINT:
+                  {
+                        GetGeometryFloats(pf, fv);
+                        fprintf(fp, "  %d\n", 5 + 2 * (int)sizeof(float));
+                        fwrite(wkb_head, 1, 5, fp);
+                        fwrite(&fv[0], sizeof(float), 2, fp);
+                        fprintf(fp, "\n");
+                        break;
+                  }
+
+                  case SENC_GEOM_MULTIPOINT:
+                  case SENC_GEOM_LINE:
+                  {
+                        GetGeometryFloats(pf, fv);
+                        fprintf(fp, "  %d\n", 9 + (int)(fv.size() * sizeof(float)) + 16);
+                        fwrite(wkb_head, 1, 9, fp);
+                        if(fv.size())
+                              fwrite(&fv[0], sizeof(float), fv.size(), fp);
+                        fwrite(pf->bbox, sizeof(float), 4, fp);
+                        fprintf(fp, "\n");
+
+                        if(pf->geom_type == SENC_GEOM_LINE)
+                        {
+                              fprintf(fp, "LSINDEXLIST %d\n", pf->n_lsindex);
+                              fwrite(pf->lsindex, sizeof(int), pf->n_lsindex * 3, fp);
+                              fprintf(fp, "\n");
+                        }
+                        break;
+                  }
+
+                  case SENC_GEOM_AREA:
+                  {
+                        //    As the old PolyTessGeo::Write_PolyTriGroup
+                        BenchTess *pt = pf->ptess;
+                        if(!pt)
+                        {
+                              fprintf(fp, "  POLYTESSGEO  %08d %g %g\n", 0, pf->ref_lat, pf->ref_lon);
+                              break;
+                        }
+
+                        std::string s1;
+                        sprintf(line, "  POLYTESSGEOPROP %f %f %f %f\n", pt->xmin, pt->ymin, pt->xmax, pt->ymax);
+                        s1 += line;
+                        sprintf(line, "Contours/nWKB %d %d\n", pt->n_contours, pt->n_geom_bytes);
+                        s1 += line;
+                        s1 += "Contour nV";
+                        for(int ic=0 ; ic < pt->n_contours ; ic++)
+                        {
+                              sprintf(line, " %d", pt->pn_vertex[ic]);
+                              s1 += line;
+                        }
+                        s1 += "\n";
+                        s1.append((const char *)pt->pgroup_geom, pt->n_geom_bytes);
+                        s1 += "\n";
+
+                        std::vector<unsigned char> s2;
+                        BenchTriPrim *ptp = pt->tri_prim_head;
+                        while(ptp)
+                        {
+                              PutBytes(s2, &ptp->type, sizeof(int));
+                              PutBytes(s2, &ptp->nVert, sizeof(int));
+                              PutBytes(s2, ptp->p_vertex, ptp->nVert * 2 * sizeof(double));
+                              PutBytes(s2, ptp->bbox, sizeof(ptp->bbox));
+                              ptp = ptp->p_next;
+                        }
+                        PutBytes(s2, "POLYEND\n", 8);
+
+                        fprintf(fp, "  POLYTESSGEO  %08d %g %g\n", (int)(s1.size() + s2.size()), pt->ref_lat, pt->ref_lon);
+                        fwrite(s1.c_str(), 1, s1.size(), fp);
+                        fwrite(&s2[0], 1, s2.size(), fp);
+
+                        fprintf(fp, "LSINDEXLIST %d\n", pf->n_lsindex);
+                        fwrite(pf->lsindex, sizeof(int), pf->n_lsindex * 3, fp);
+                        fprintf(fp, "\n");
+                        break;
+                  }
+
+                  default:
+                        break;
+            }
+      }
+
+      fprintf(fp, "VETableStart\n");
+      for(unsigned int i=0 ; i < pc->edges.size() ; i++)
+      {
+            fwrite(&pc->edges[i].index, sizeof(int), 1, fp);
+            fwrite(&pc->edges[i].nCount, sizeof(int), 1, fp);
+            fwrite(pc->edges[i].pPoints, sizeof(double), pc->edges[i].nCount * 2, fp);
+      }
+      int last_rcid = -1;
+      fwrite(&last_rcid, sizeof(int), 1, fp);
+      fprintf(fp, "\nVETableEnd\n");
+
+      fprintf(fp, "VCTableStart\n");
+      for(unsigned int i=0 ; i < pc->nodes.size() ; i++)
+      {
+            fwrite(&pc->nodes[i].index, sizeof(int), 1, fp);
+            fwrite(pc->nodes[i].point, sizeof(double), 2, fp);
+      }
+      fwrite(&last_rcid, sizeof(int), 1, fp);
+      fprintf(fp, "\nVCTableEnd\n");
+
+      return (0 == fclose(fp));
+}
+
+//----------------------------------------------------------------------------
+//    Text layout loader, a copy of the version 122 s57chart and S57Obj
+//    kept as the baseline.  The old loader read through a wxBufferedInputStream a byte at a time,
+//    getc() on a stdio stream does the same here.
+//----------------------------------------------------------------------------
+
+static int my_fgets(char *buf, int buf_len_max, FILE *ifs)
+{
+      int nLineLen = 0;
+      char *lbuf = buf;
+      int c;
+
+      while((nLineLen < buf_len_max) && ((c = getc(ifs)) != EOF))
+      {
+            char chNext = (char)c;
+
+            /* each CR/LF (or LF/CR) as if just "CR" */
+            if( chNext == 10 || chNext == 13 )
+                  chNext = '\n';
+
+            *lbuf = chNext; lbuf++, nLineLen++;
+
+            if( chNext == '\n' )
+            {
+                  *lbuf = '\0';
+                  return nLineLen;
+            }
+      }
+
+      *(lbuf) = '\0';
+      return nLineLen;
+}
+
+static int my_bufgetl(char *ib_read, char *ib_end, char *buf, int buf_len_max)
+{
+      int nLineLen = 0;
+      char *lbuf = buf;
+      char *ibr = ib_read;
+
+      while((nLineLen < buf_len_max) && (ibr < ib_end))
+      {
+            char chNext = *ibr++;
+
+            /* each CR/LF (or LF/CR) as if just "CR" */
+            if( chNext == 10 || chNext == 13 )
+                  chNext = '\n';
+
+            *lbuf++ = chNext;
+            nLineLen++;
+
+            if( chNext == '\n' )
+            {
+                  *lbuf = '\0';
+                  return nLineLen;
+            }
+      }
+
+      *(lbuf) = '\0';
+      return nLineLen;
+}
+
+static bool IsUsefulAttribute(char *buf)
+{
+      if(!strncmp(buf, "HDRLEN", 6))
+            return false;
+      if(!strncmp(buf+2, "RCID", 4) || !strncmp(buf+2, "LNAM", 4) || !strncmp(buf+2, "PRIM", 4) ||
+         !strncmp(buf+2, "SORDAT", 6) || !strncmp(buf+2, "SORIND", 6))
+            return false;
+      return true;
+}
+
+//    The old PolyTessGeo(unsigned char *polybuf, int nrecl, int index)
+static BenchTess *LoadTextTess(unsigned char *polybuf, int nrecl)
+{
+      char hdr_buf[1000];
+      int twkb_len;
+
+      char *m_buf_head = (char *)polybuf;
+      char *m_buf_ptr = m_buf_head;
+
+      BenchTess *pt = new BenchTess;
+      pt->tri_prim_head = NULL;
+
+      int nrl = my_bufgetl(m_buf_ptr, m_buf_head + nrecl, hdr_buf, sizeof(hdr_buf) - 1);
+      m_buf_ptr += nrl;
+      sscanf(hdr_buf, "  POLYTESSGEOPROP %lf %lf %lf %lf", &pt->xmin, &pt->ymin, &pt->xmax, &pt->ymax);
+
+      nrl = my_bufgetl(m_buf_ptr, m_buf_head + nrecl, hdr_buf, sizeof(hdr_buf) - 1);
+      m_buf_ptr += nrl;
+      sscanf(hdr_buf, "Contours/nWKB %d %d", &pt->n_contours, &twkb_len);
+      pt->n_geom_bytes = twkb_len;
+      pt->pn_vertex = (int *)malloc(pt->n_contours * sizeof(int));
+      int *pctr = pt->pn_vertex;
+
+      char *buf = (char *)malloc(twkb_len + 2);
+      nrl = my_bufgetl(m_buf_ptr, m_buf_head + nrecl, buf, twkb_len + 2);
+      m_buf_ptr += nrl;
+
+      char *pc = buf + 10;
+      char *pend;
+      long icv;
+      while((icv = strtol(pc, &pend, 10)), pend != pc)
+      {
+            if(icv)
+                  *pctr++ = icv;
+            pc = pend;
+      }
+
+      //  Read Raw Geometry
+      float *ppolygeo = (float *)malloc(twkb_len + 1);
+      memmove(ppolygeo, m_buf_ptr, twkb_len + 1);
+      m_buf_ptr += twkb_len + 1;
+      pt->pgroup_geom = ppolygeo;
+
+      //  Read the PTG_Triangle Geometry in a loop
+      BenchTriPrim **p_prev_triprim = &pt->tri_prim_head;
+      while((m_buf_ptr - m_buf_head) != nrecl)
+      {
+            int *pi = (int *)m_buf_ptr;
+            unsigned int tri_type = *pi++;
+            int nvert = *pi;
+            m_buf_ptr += 2 * sizeof(int);
+
+            //    "POLYEND" read as an int
+            if(tri_type == 0x594c4f50)
+                  break;
+
+            BenchTriPrim *tp = new BenchTriPrim;
+            *p_prev_triprim = tp;
+            p_prev_triprim = &tp->p_next;
+            tp->p_next = NULL;
+
+            tp->type = tri_type;
+            tp->nVert = nvert;
+
+            int byte_size = nvert * 2 * sizeof(double);
+            tp->p_vertex = (double *)malloc(byte_size);
+            memmove(tp->p_vertex, m_buf_ptr, byte_size);
+            m_buf_ptr += byte_size;
+
+            memmove(tp->bbox, m_buf_ptr, 4 * sizeof(double));
+            m_buf_ptr += 4 * sizeof(double);
+      }
+
+      free(buf);
+      return pt;
+}
+
+//    The old S57Obj(char *first_line, wxInputStream *pfpx, ...)
+static BenchFeature *LoadTextFeature(char *first_line, FILE *pfpx)
+{
+      BenchFeature *pf = NewFeature();
+
+      char *buf = (char *)malloc(MAX_LINE + 1);
+      char *hdr_buf = (char *)malloc(1);
+      char geoMatch[20];
+      char szAtt[20];
+      char *br;
+      bool bMulti = false;
+
+      strcpy(buf, first_line);
+
+      pf->fid = atoi(buf + 19);
+      strncpy(pf->name, buf + 11, 6);
+      pf->name[6] = 0;
+
+      int hdr_len = 0;
+      char *mybuf_ptr = NULL;
+      char *hdr_end = NULL;
+      int prim = -1;
+      strcpy(geoMatch, "Dummy");
+
+      while(true)
+      {
+            if(hdr_len)
+            {
+                  int nrl = my_bufgetl(mybuf_ptr, hdr_end, buf, MAX_LINE);
+                  mybuf_ptr += nrl;
+                  if(0 == nrl)
+                  {
+                        my_fgets(buf, MAX_LINE, pfpx);
+                        break;
+                  }
+            }
+            else
+                  my_fgets(buf, MAX_LINE, pfpx);
+
+            if(!strncmp(buf, "HDRLEN", 6))
+            {
+                  hdr_len = atoi(buf + 7);
+                  hdr_buf = (char *)realloc(hdr_buf, hdr_len);
+                  fread(hdr_buf, 1, hdr_len, pfpx);
+                  mybuf_ptr = hdr_buf;
+                  hdr_end = hdr_buf + hdr_len;
+            }
+            else if(!strncmp(buf, geoMatch, 6))
+                  break;
+            else if(!strncmp(buf, "  MULT", 6))
+            {
+                  bMulti = true;
+                  break;
+            }
+            else if(!strncmp(buf, "  PRIM", 6))
+            {
+                  prim = atoi(buf + 13);
+                  switch(prim)
+                  {
+                        case 1:     strcpy(geoMatch, "  POIN"); break;
+                        case 2:     strcpy(geoMatch, "  LINE"); break;
+                        case 3:     strcpy(geoMatch, "  POLY"); break;
+                        default:    break;
+                  }
+            }
+
+            if(IsUsefulAttribute(buf))
+            {
+                  BenchAttr a;
+                  a.value = NULL;
+                  szAtt[0] = 0;
+
+                  if((buf[10] == 'I') || (buf[10] == 'R'))
+                  {
+                        br = buf + 2;
+                        int i = 0;
+                        while(*br != ' ')
+                              szAtt[i++] = *br++;
+                        szAtt[i] = 0;
+
+                        while(*br != '=')
+                              br++;
+                        br += 2;
+
+                        if(buf[10] == 'I')
+                        {
+                              a.type = OGR_INT;
+                              a.value = malloc(sizeof(int));
+                              *(int *)a.value = atoi(br);
+                        }
+                        else
+                        {
+                              float AValfReal;
+                              sscanf(br, "%f", &AValfReal);
+                              a.type = OGR_REAL;
+                              a.value = malloc(sizeof(double));
+                              *(double *)a.value = AValfReal;
+                        }
+                  }
+                  else if(buf[10] == 'S')
+                  {
+                        strncpy(szAtt, &buf[2], 6);
+                        szAtt[6] = 0;
+
+                        br = buf + 15;
+                        int nlen = strlen(br);
+                        br[nlen - 1] = 0;                   // dump the NL char
+                        a.type = OGR_STR;
+                        a.value = malloc(nlen + 1);
+                        strcpy((char *)a.value, br);
+                  }
+
+                  if(strlen(szAtt))
+                  {
+                        strcpy(a.name, szAtt);
+                        pf->attrs.push_back(a);
+                  }
+                  else
+                        free(a.value);
+            }
+      }
+
+      pf->prim = prim;
+
+      char tbuf[40];
+      switch(prim)
+      {
+            case 1:
+            {
+                  sscanf(buf, "%s %f %f", tbuf, &pf->ref_lat, &pf->ref_lon);
+
+                  my_fgets(buf, MAX_LINE, pfpx);
+                  int wkb_len = atoi(buf + 2);
+                  fread(buf, 1, wkb_len, pfpx);
+
+                  if(!bMulti)
+                  {
+                        pf->geom_type = SENC_GEOM_POINT;
+                        pf->npt = 1;
+                        pf->geoPt = (double *)malloc(2 * sizeof(double));
+                        float *pfs = (float *)(buf + 5);
+                        pf->geoPt[0] = *pfs++;
+                        pf->geoPt[1] = *pfs;
+                  }
+                  else
+                  {
+                        pf->geom_type = SENC_GEOM_MULTIPOINT;
+                        pf->npt = *((int *)(buf + 5));
+                        pf->geoPt = (double *)malloc(pf->npt * 3 * sizeof(double));
+                        float *pfs = (float *)(buf + 9);
+                        for(int ip=0 ; ip < pf->npt * 3 ; ip++)
+                              pf->geoPt[ip] = *pfs++;
+                        memcpy(pf->bbox, pfs, 4 * sizeof(float));
+                  }
+                  break;
+            }
+
+            case 2:
+            {
+                  if(strncmp(buf, "  LINESTRING", 12))
+                        break;
+
+                  pf->geom_type = SENC_GEOM_LINE;
+                  sscanf(buf, "%s %f %f", tbuf, &pf->ref_lat, &pf->ref_lon);
+
+                  my_fgets(buf, MAX_LINE, pfpx);
+                  int sb_len = atoi(buf + 2);
+
+                  unsigned char *buft = (unsigned char *)malloc(sb_len);
+                  fread(buft, 1, sb_len, pfpx);
+
+                  pf->npt = *((int *)(buft + 5));
+                  pf->geoPt = (double *)malloc(pf->npt * 2 * sizeof(double));
+                  float *pfl = (float *)(buft + 9);
+                  for(int ip=0 ; ip < pf->npt * 2 ; ip++)
+                        pf->geoPt[ip] = *pfl++;
+                  memcpy(pf->bbox, pfl, 4 * sizeof(float));
+                  free(buft);
+
+                  my_fgets(buf, MAX_LINE, pfpx);      // "\n"
+                  my_fgets(buf, MAX_LINE, pfpx);      // "LSINDEXLIST nnn"
+                  sscanf(buf, "%s %d ", tbuf, &pf->n_lsindex);
+                  pf->lsindex = (int *)malloc(3 * pf->n_lsindex * sizeof(int));
+                  fread(pf->lsindex, sizeof(int), 3 * pf->n_lsindex, pfpx);
+                  my_fgets(buf, MAX_LINE, pfpx);      // "\n"
+                  break;
+            }
+
+            case 3:
+            {
+                  pf->geom_type = SENC_GEOM_AREA;
+                  sscanf(buf, "%s %f %f", tbuf, &pf->ref_lat, &pf->ref_lon);
+
+                  my_fgets(buf, MAX_LINE, pfpx);      // "  POLYTESSGEO"
+                  if(strncmp(buf, "  POLYTESSGEO", 13))
+                        break;
+
+                  float area_ref_lat, area_ref_lon;
+                  int nrecl;
+                  sscanf(buf, " %s %d %f %f", tbuf, &nrecl, &area_ref_lat, &area_ref_lon);
+                  if(!nrecl)
+                        break;
+
+                  unsigned char *polybuf = (unsigned char *)malloc(nrecl + 1);
+                  fread(polybuf, 1, nrecl, pfpx);
+                  polybuf[nrecl] = 0;
+                  pf->ptess = LoadTextTess(polybuf, nrecl);
+                  pf->ptess->ref_lat = area_ref_lat;
+                  pf->ptess->ref_lon = area_ref_lon;
+                  free(polybuf);
+
+                  my_fgets(buf, MAX_LINE, pfpx);      // "LSINDEXLIST nnn"
+                  sscanf(buf, "%s %d ", tbuf, &pf->n_lsindex);
+                  pf->lsindex = (int *)malloc(3 * pf->n_lsindex * sizeof(int));
+                  fread(pf->lsindex, sizeof(int), 3 * pf->n_lsindex, pfpx);
+                  my_fgets(buf, MAX_LINE, pfpx);      // "\n"
+                  break;
+            }
+      }
+
+      free(buf);
+      free(hdr_buf);
+
+      return pf;
+}
+
+static bool LoadTextSENC(const char *path, BenchCell *pc)
+{
+      FILE *fpx = fopen(path, "rb");
+      if(!fpx)
+            return false;
+
+      char *buf = (char *)malloc(MAX_LINE + 1);
+      bool bok = true;
+
+      while(my_fgets(buf, MAX_LINE, fpx))
+      {
+            if(!strncmp(buf, "OGRF", 4))
+                  pc->features.push_back(LoadTextFeature(buf, fpx));
+
+            else if(!strncmp(buf, "VETableStart", 12))
+            {
+                  int index = -1;
+                  fread(&index, sizeof(int), 1, fpx);
+                  while(-1 != index)
+                  {
+                        BenchEdge e;
+                        e.index = index;
+                        fread(&e.nCount, sizeof(int), 1, fpx);
+                        e.pPoints = NULL;
+                        if(e.nCount)
+                        {
+                              e.pPoints = (double *)malloc(e.nCount * 2 * sizeof(double));
+                              fread(e.pPoints, sizeof(double), e.nCount * 2, fpx);
+                        }
+                        pc->edges.push_back(e);
+
+                        if(1 != fread(&index, sizeof(int), 1, fpx))
+                              break;
+                  }
+            }
+
+            else if(!strncmp(buf, "VCTableStart", 12))
+            {
+                  int index = -1;
+                  fread(&index, sizeof(int), 1, fpx);
+                  while(-1 != index)
+                  {
+                        BenchNode n;
+                        n.index = index;
+                        fread(n.point, sizeof(double), 2, fpx);
+                        pc->nodes.push_back(n);
+
+                        if(1 != fread(&index, sizeof(int), 1, fpx))
+                              break;
+                  }
+            }
+
+            else if(!strncmp(buf, "SENC", 4))
+            {
+                  int senc_file_version = 0;
+                  sscanf(buf, "SENC Version=%i", &senc_file_version);
+                  if(senc_file_version != OLD_SENC_FORMAT_VERSION)
+                  {
+                        bok = false;
+                        break;
+                  }
+            }
+
+            else if(!strncmp(buf, "NAME", 4))
+            {
+                  strncpy(pc->name, buf + 5, sizeof(pc->name) - 1);
+                  pc->name[sizeof(pc->name) - 1] = 0;
+                  pc->name[strcspn(pc->name, "\n")] = 0;
+            }
+      }
+
+      free(buf);
+      fclose(fpx);
+      return bok;
+}
+
+//----------------------------------------------------------------------------
+//    Binary layout loader, on the sencparser.cpp reader and parser
+//    The copies out follow S57Obj(SENCFeature *) and PolyTessGeo(SENCTess *).
+//----------------------------------------------------------------------------
+
+static BenchTess *LoadBinaryTess(SENCTess *ptess)
+{
+      SENCPolyTessHeader *phdr = &ptess->hdr;
+
+      BenchTess *pt = new BenchTess;
+      pt->xmin = phdr->xmin;
+      pt->ymin = phdr->ymin;
+      pt->xmax = phdr->xmax;
+      pt->ymax = phdr->ymax;
+      pt->ref_lat = phdr->ref_lat;
+      pt->ref_lon = phdr->ref_lon;
+      pt->n_contours = phdr->n_contours;
+      pt->n_geom_bytes = phdr->n_geom_bytes;
+      pt->tri_prim_head = NULL;
+
+      pt->pn_vertex = (int *)malloc(phdr->n_contours * sizeof(int));
+      memcpy(pt->pn_vertex, ptess->pcontours, phdr->n_contours * sizeof(int));
+
+      pt->pgroup_geom = (float *)malloc(phdr->n_geom_bytes);
+      memcpy(pt->pgroup_geom, ptess->pgeom, phdr->n_geom_bytes);
+
+      BenchTriPrim **p_prev_triprim = &pt->tri_prim_head;
+      unsigned char *ptp_buf = ptess->ptriprims;
+      for(int itp = 0 ; itp < phdr->n_triprims ; itp++)
+      {
+            BenchTriPrim *tp = new BenchTriPrim;
+            *p_prev_triprim = tp;
+            p_prev_triprim = &tp->p_next;
+            tp->p_next = NULL;
+
+            unsigned char *pvert = SENCNextTriPrim(&ptp_buf, &tp->type, &tp->nVert, tp->bbox);
+
+            int byte_size = tp->nVert * 2 * sizeof(double);
+            tp->p_vertex = (double *)malloc(byte_size);
+            memcpy(tp->p_vertex, pvert, byte_size);
+      }
+
+      return pt;
+}
+
+static BenchFeature *LoadBinaryFeature(SENCFeature *psf)
+{
+      BenchFeature *pf = NewFeature();
+      SENCFeatureHeader *pfh = &psf->hdr;
+
+      strncpy(pf->name, pfh->feature_name, 6);
+      pf->name[6] = 0;
+      pf->fid = pfh->fid;
+      pf->prim = pfh->prim;
+      pf->geom_type = pfh->geom_type;
+      pf->ref_lat = pfh->ref_lat;
+      pf->ref_lon = pfh->ref_lon;
+
+      unsigned char *pa = psf->pattributes;
+      for(int iatt = 0 ; iatt < pfh->n_attributes ; iatt++)
+      {
+            SENCAttributeHeader ah;
+            unsigned char *pvalue = SENCNextAttribute(&pa, &ah);
+
+            BenchAttr a;
+            strncpy(a.name, ah.name, 8);
+            a.name[8] = 0;
+
+            switch(ah.value_type)
+            {
+                  case OGR_INT:
+                        a.type = OGR_INT;
+                        a.value = malloc(sizeof(int));
+                        memcpy(a.value, pvalue, sizeof(int));
+                        break;
+
+                  case OGR_REAL:
+                        a.type = OGR_REAL;
+                        a.value = malloc(sizeof(double));
+                        memcpy(a.value, pvalue, sizeof(double));
+                        break;
+
+                  default:
+                        a.type = OGR_STR;
+                        a.value = malloc(ah.value_bytes + 1);
+                        memcpy(a.value, pvalue, ah.value_bytes);
+                        ((char *)a.value)[ah.value_bytes] = 0;
+                        break;
+            }
+            pf->attrs.push_back(a);
+      }
+
+      switch(pfh->geom_type)
+      {
+            case SENC_GEOM_POINT:
+            case SENC_GEOM_MULTIPOINT:
+            case SENC_GEOM_LINE:
+            {
+                  int n = psf->npt * PointDim(pfh->geom_type);
+
+                  pf->npt = psf->npt;
+                  pf->geoPt = (double *)malloc(n * sizeof(double));
+                  float *pfs = (float *)malloc(n * sizeof(float) + 1);
+                  memcpy(pfs, psf->ppoints, n * sizeof(float));
+                  for(int ip=0 ; ip < n ; ip++)
+                        pf->geoPt[ip] = pfs[ip];
+                  free(pfs);
+
+                  if(psf->pbbox)
+                        memcpy(pf->bbox, psf->pbbox, 4 * sizeof(float));
+                  break;
+            }
+
+            case SENC_GEOM_AREA:
+                  if(psf->btess)
+                        pf->ptess = LoadBinaryTess(&psf->tess);
+                  break;
+
+            default:
+                  break;
+      }
+
+      if(psf->n_lsindex)
+      {
+            pf->n_lsindex = psf->n_lsindex;
+            pf->lsindex = (int *)malloc(3 * psf->n_lsindex * sizeof(int));
+            memcpy(pf->lsindex, psf->plsindex, 3 * psf->n_lsindex * sizeof(int));
+      }
+
+      return pf;
+}
+
+//    The whole file, mapped where possible, as SENCFileBuffer does
+static unsigned char *MapFile(const char *path, size_t *psize, bool *pbmapped)
+{
+      *pbmapped = false;
+
+#ifndef __WXMSW__
+      int fd = open(path, O_RDONLY);
+      if(fd != -1)
+      {
+            struct stat st;
+            if((fstat(fd, &st) == 0) && (st.st_size > 0))
+            {
+                  void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                  if(p != MAP_FAILED)
+                  {
+                        close(fd);
+                        *psize = st.st_size;
+                        *pbmapped = true;
+                        return (unsigned char *)p;
+                  }
+            }
+            close(fd);
+      }
+#endif
+
+      FILE *fp = fopen(path, "rb");
+      if(!fp)
+            return NULL;
+
+      fseek(fp, 0, SEEK_END);
+      long size = ftell(fp);
+      fseek(fp, 0, SEEK_SET);
+
+      unsigned char *pdata = NULL;
+      if(size > 0)
+            pdata = (unsigned char *)malloc(size);
+      if(pdata && (fread(pdata, 1, size, fp) != (size_t)size))
+      {
+            free(pdata);
+            pdata = NULL;
+      }
+      fclose(fp);
+
+      *psize = size;
+      return pdata;
+}
+
+static void UnmapFile(unsigned char *pdata, size_t size, bool bmapped)
+{
+#ifndef __WXMSW__
+      if(bmapped)
+      {
+            munmap(pdata, size);
+            return;
+      }
+#endif
+      free(pdata);
+}
+
+static bool LoadBinarySENC(const char *path, BenchCell *pc)
+{
+      size_t size = 0;
+      bool bmapped;
+      unsigned char *pbuf = MapFile(path, &size, &bmapped);
+      if(!pbuf)
+            return false;
+
+      SENCReader reader;
+      SENCFileHeader hdr;
+      bool bok = SENCReaderOpen(&reader, pbuf, size, &hdr);
+
+      if(bok)
+      {
+            strcpy(pc->name, hdr.name);
+
+            bool dun = false;
+            while(!dun && bok)
+            {
+                  SENCRecordHeader rh;
+                  unsigned char *payload;
+                  if(SENCReaderNext(&reader, &rh, &payload) == SENC_READ_ERROR)
+                  {
+                        bok = false;
+                        break;
+                  }
+
+                  switch(rh.record_type)
+                  {
+                        case SENC_RECORD_END:
+                              dun = true;
+                              break;
+
+                        case SENC_RECORD_FEATURE:
+                        {
+                              SENCFeature feature;
+                              bok = SENCParseFeature(payload, rh.record_length, &feature);
+                              if(bok)
+                                    pc->features.push_back(LoadBinaryFeature(&feature));
+                              break;
+                        }
+
+                        case SENC_RECORD_VE_TABLE:
+                        {
+                              int n;
+                              unsigned char *pt;
+                              bok = SENCCheckEdgeTable(payload, rh.record_length, &n, &pt);
+
+                              for(int i = 0 ; bok && (i < n) ; i++)
+                              {
+                                    BenchEdge e;
+                                    unsigned char *ppts = SENCNextEdge(&pt, &e.index, &e.nCount);
+                                    e.pPoints = NULL;
+                                    if(e.nCount)
+                                    {
+                                          e.pPoints = (double *)malloc(e.nCount * 2 * sizeof(double));
+                                          memcpy(e.pPoints, ppts, e.nCount * 2 * sizeof(double));
+                                    }
+                                    pc->edges.push_back(e);
+                              }
+                              break;
+                        }
+
+                        case SENC_RECORD_VC_TABLE:
+                        {
+                              int n;
+                              unsigned char *pt;
+                              bok = SENCCheckNodeTable(payload, rh.record_length, &n, &pt);
+
+                              for(int i = 0 ; bok && (i < n) ; i++)
+                              {
+                                    BenchNode nd;
+                                    unsigned char *ppoint = SENCNextNode(&pt, &nd.index);
+                                    memcpy(nd.point, ppoint, 2 * sizeof(double));
+                                    pc->nodes.push_back(nd);
+                              }
+                              break;
+                        }
+
+                        default:
+                              break;
+                  }
+            }
+      }
+
+      UnmapFile(pbuf, size, bmapped);
+      return bok;
+}
+
+//----------------------------------------------------------------------------
+//    Timing
+//----------------------------------------------------------------------------
+
+static double Now(void)
+{
+      struct timeval tv;
+      gettimeofday(&tv, NULL);
+      return tv.tv_sec + (tv.tv_usec * 1e-6);
+}
+
+static long FileSize(const char *path)
+{
+      FILE *fp = fopen(path, "rb");
+      if(!fp)
+            return 0;
+      fseek(fp, 0, SEEK_END);
+      long size = ftell(fp);
+      fclose(fp);
+      return size;
+}
+
+typedef bool (*BenchLoader)(const char *path, BenchCell *pc);
+
+//    Returns the best load time in seconds, or a negative value on failure
+static double TimeLoad(BenchLoader loader, const char *path, int n_runs, BenchHash *phash)
+{
+      double best = -1.;
+
+      for(int i=0 ; i < n_runs ; i++)
+      {
+            BenchCell cell;
+
+            double t0 = Now();
+            bool bok = loader(path, &cell);
+            double t = Now() - t0;
+
+            if(!bok)
+            {
+                  FreeCell(&cell);
+                  return -1.;
+            }
+
+            *phash = CellChecksum(&cell);
+            FreeCell(&cell);
+
+            if((best < 0.) || (t < best))
+                  best = t;
+      }
+
+      return best;
+}
+
+static void Usage(void)
+{
+      printf("Usage: senc_load_bench [-n features] [-r runs] [-d work_dir] [SENC file]\n");
+}
+
+int main(int argc, char **argv)
+{
+      int n_features = 30000;
+      int n_runs = 3;
+      const char *work_dir = ".";
+      const char *senc_file = NULL;
+
+      for(int i=1 ; i < argc ; i++)
+      {
+            if(!strcmp(argv[i], "-n") && (i + 1 < argc))
+                  n_features = atoi(argv[++i]);
+            else if(!strcmp(argv[i], "-r") && (i + 1 < argc))
+                  n_runs = atoi(argv[++i]);
+            else if(!strcmp(argv[i], "-d") && (i + 1 < argc))
+                  work_dir = argv[++i];
+            else if(argv[i][0] == '-')
+            {
+                  Usage();
+                  return 2;
+            }
+            else
+                  senc_file = argv[i];
+      }
+      if((n_features <= 0) || (n_runs <= 0))
+      {
+            Usage();
+            return 2;
+      }
+
+      BenchCell cell;
+      if(senc_file)
+      {
+            if(!LoadBinarySENC(senc_file, &cell))
+            {
+                  printf("Cannot read %s as a version %d SENC file\n", senc_file, CURRENT_SENC_FORMAT_VERSION);
+                  return 1;
+            }
+      }
+      else
+            MakeSyntheticCell(&cell, n_features);
+
+      char text_path[1024];
+      char binary_path[1024];
+      snprintf(text_path, sizeof(text_path), "%s/senc_load_bench_text.tmp", work_dir);
+      snprintf(binary_path, sizeof(binary_path), "%s/senc_load_bench_binary.tmp", work_dir);
+
+      BenchHash cell_hash = CellChecksum(&cell);
+      bool bwritten = WriteTextSENC(&cell, text_path) && WriteBinarySENC(&cell, binary_path);
+
+      printf("Cell %s: %d features, %d edges, %d nodes\n", cell.name,
+             (int)cell.features.size(), (int)cell.edges.size(), (int)cell.nodes.size());
+      FreeCell(&cell);
+
+      if(!bwritten)
+      {
+            printf("Cannot write the SENC files in %s\n", work_dir);
+            return 1;
+      }
+
+      long text_size = FileSize(text_path);
+      long binary_size = FileSize(binary_path);
+
+      //    Warm the file cache equally for both
+      BenchHash text_hash = 0, binary_hash = 0;
+      TimeLoad(LoadTextSENC, text_path, 1, &text_hash);
+      TimeLoad(LoadBinarySENC, binary_path, 1, &binary_hash);
+
+      double t_text = TimeLoad(LoadTextSENC, text_path, n_runs, &text_hash);
+      double t_binary = TimeLoad(LoadBinarySENC, binary_path, n_runs, &binary_hash);
+
+      remove(text_path);
+      remove(binary_path);
+
+      if((t_text < 0.) || (t_binary < 0.))
+      {
+            printf("A SENC file failed to load\n");
+            return 1;
+      }
+
+      printf("   text   (version %d): %8.1f KB, %8.1f msec, %7.1f MB/sec\n", OLD_SENC_FORMAT_VERSION,
+             text_size / 1024., t_text * 1000., text_size / (t_text * 1048576.));
+      printf("   binary (version %d): %8.1f KB, %8.1f msec, %7.1f MB/sec\n", CURRENT_SENC_FORMAT_VERSION,
+             binary_size / 1024., t_binary * 1000., binary_size / (t_binary * 1048576.));
+      printf("   binary loads %.1f times as fast, best of %d runs\n", t_text / t_binary, n_runs);
+
+      if((text_hash != cell_hash) || (binary_hash != cell_hash))
+      {
+            printf("Decoded data differ: cell %016llx, text %016llx, binary %016llx\n",
+                   cell_hash, text_hash, binary_hash);
+            return 1;
+      }
+
+      return 0;
+}
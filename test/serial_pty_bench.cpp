@@ -0,0 +1,371 @@
+/******************************************************************************
+ * $Id$
+ *
+ * Project:  OpenCPN
+ * Purpose:  Serial input throughput, over a pseudo-terminal
+ * Author:   David Register
+ *
+ ***************************************************************************
+ *   Copyright (C) 2010 by David S. Register   *
+ *   $EMAIL$   *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program; if not, write to the                         *
+ *   Free Software Foundation, Inc.,                                       *
+ *   59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.             *
+ ***************************************************************************
+ *
+ *    Usage:  serial_pty_bench [seconds per run]
+ *
+ *    A pty stands in for the serial port.  A writer thread plays NMEA and
+ *    AIS sentences into the master side, paced to the line rate at 10 bits
+ *    a byte.  A port thread reads the slave side the way OCP_NMEA_Thread and
+ *    OCP_AIS_Thread do, with select() and block reads into an OCP_SerialRing.
+ *    The main thread drains the ring as the GUI thread does, and checks
+ *    every sentence it gets.
+ *
+ *    Runs are made at 38400 and 115200 baud, and once more unpaced with a
+ *    slow consumer, so that the ring overflows and drops whole sentences.
+ *    Every sentence written must come out intact, or be counted as dropped;
+ *    the exit status is non-zero otherwise.
+ *
+ */
+
+#include "wx/wxprec.h"
+
+#ifndef  WX_PRECOMP
+  #include "wx/wx.h"
+#endif //precompiled headers
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "serialring.h"
+
+//    What a shore station and a GPS might send, multipart AIS included
+static const char *s_sentences[] =
+{
+      "!AIVDM,1,1,,A,13u?etPv2;0n:dDPwUM1U1Cb069D,0*24\r\n",
+      "!AIVDM,1,1,,B,15MgK45P3@G?fl0E`JbR0OwT0@MS,0*4D\r\n",
+      "!AIVDM,2,1,3,B,55P5TL01VIaAL@7WKO@mBplU@<PDhh000000001S;AJ::4A80?4i@E53,0*3E\r\n",
+      "!AIVDM,2,2,3,B,1@0000000000000,2*55\r\n",
+      "$GPRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n",
+      "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n"
+};
+
+#define N_SENTENCES     ((int)(sizeof(s_sentences) / sizeof(s_sentences[0])))
+
+typedef struct
+{
+      int               master_fd;
+      int               slave_fd;
+      int               baud;             // 0 for as fast as the pty takes it
+      OCP_SerialRing    *pring;
+
+      volatile int      bstop_writer;
+      volatile int      bstop_reader;
+
+      int               n_written;        // sentences, set by the writer when done
+      double            reader_cpu;       // seconds, set by the reader when done
+
+      pthread_mutex_t   mutex;
+      pthread_cond_t    cond;
+      int               n_notify;         // notifications not yet taken by the consumer
+}BenchState;
+
+static double Now(void)
+{
+      struct timeval tv;
+      gettimeofday(&tv, NULL);
+      return tv.tv_sec + (tv.tv_usec * 1e-6);
+}
+
+static double ProcessCPU(void)
+{
+      struct rusage ru;
+      getrusage(RUSAGE_SELF, &ru);
+      return ru.ru_utime.tv_sec + (ru.ru_utime.tv_usec * 1e-6) + ru.ru_stime.tv_sec + (ru.ru_stime.tv_usec * 1e-6);
+}
+
+static bool WriteAll(int fd, const char *buf, int len)
+{
+      while(len > 0)
+      {
+            ssize_t n = write(fd, buf, len);
+            if(n < 0)
+            {
+                  if(errno == EINTR)
+                        continue;
+                  return false;
+            }
+            buf += n;
+            len -= n;
+      }
+      return true;
+}
+
+static void *WriterEntry(void *arg)
+{
+      BenchState *ps = (BenchState *)arg;
+
+      double t0 = Now();
+      double bytes_written = 0;
+      int n = 0;
+
+      while(!ps->bstop_writer)
+      {
+            if(ps->baud)
+            {
+                  double bytes_due = (Now() - t0) * ps->baud / 10.;
+                  if(bytes_written >= bytes_due)
+                  {
+                        usleep(1000);
+                        continue;
+                  }
+            }
+
+            const char *s = s_sentences[n % N_SENTENCES];
+            int len = strlen(s);
+            if(!WriteAll(ps->master_fd, s, len))
+                  break;
+
+            bytes_written += len;
+            n++;
+      }
+
+      ps->n_written = n;
+      return NULL;
+}
+
+//    As the port threads do it
+static void *ReaderEntry(void *arg)
+{
+      BenchState *ps = (BenchState *)arg;
+      char read_buf[SERIAL_READ_CHUNK];
+
+      while(!ps->bstop_reader)
+      {
+            fd_set rfds;
+            FD_ZERO(&rfds);
+            FD_SET(ps->slave_fd, &rfds);
+
+            struct timeval tv;
+            tv.tv_sec = 0;
+            tv.tv_usec = 100000;
+
+            ssize_t newdata = 0;
+            int retval = select(ps->slave_fd + 1, &rfds, NULL, NULL, &tv);
+            if((retval > 0) && FD_ISSET(ps->slave_fd, &rfds))
+                  newdata = read(ps->slave_fd, read_buf, sizeof(read_buf));
+
+            if((newdata > 0) && ps->pring->Put(read_buf, newdata))
+            {
+                  pthread_mutex_lock(&ps->mutex);
+                  ps->n_notify++;
+                  pthread_cond_signal(&ps->cond);
+                  pthread_mutex_unlock(&ps->mutex);
+            }
+      }
+
+      struct timespec ts;
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+      ps->reader_cpu = ts.tv_sec + (ts.tv_nsec * 1e-9);
+
+      return NULL;
+}
+
+//    As the GUI thread does it.  Returns the number of bad sentences.
+static int Drain(BenchState *ps, int *pn_received)
+{
+      char sentence[SERIAL_SENTENCE_MAX];
+      int len;
+      int n_bad = 0;
+
+      ps->pring->BeginDrain();
+      while((len = ps->pring->GetSentence(sentence, sizeof(sentence))) > 0)
+      {
+            bool bok = false;
+            for(int i=0 ; i < N_SENTENCES ; i++)
+            {
+                  if(!strcmp(sentence, s_sentences[i]))
+                  {
+                        bok = true;
+                        break;
+                  }
+            }
+
+            if(!bok)
+            {
+                  if(n_bad < 5)
+                        printf("   bad sentence: %s", sentence);
+                  n_bad++;
+            }
+            (*pn_received)++;
+      }
+
+      return n_bad;
+}
+
+static bool OpenPty(int *pmaster, int *pslave, int baud)
+{
+      int master = posix_openpt(O_RDWR | O_NOCTTY);
+      if(master < 0)
+            return false;
+
+      if(grantpt(master) || unlockpt(master))
+      {
+            close(master);
+            return false;
+      }
+
+      int slave = open(ptsname(master), O_RDWR | O_NOCTTY | O_NDELAY);
+      if(slave < 0)
+      {
+            close(master);
+            return false;
+      }
+
+      //    Raw, as the port threads set up a real port.  A pty ignores the
+      //    speed, which is why the writer paces itself.
+      struct termios tty;
+      tcgetattr(slave, &tty);
+      cfmakeraw(&tty);
+      speed_t speed = (baud == 38400) ? B38400 : B115200;
+      cfsetispeed(&tty, speed);
+      cfsetospeed(&tty, speed);
+      tcsetattr(slave, TCSANOW, &tty);
+
+      *pmaster = master;
+      *pslave = slave;
+      return true;
+}
+
+//    Returns false if any sentence was lost or damaged
+static bool RunBench(int baud, double seconds, bool bslow_consumer)
+{
+      BenchState state;
+      BenchState *ps = &state;
+
+      if(!OpenPty(&ps->master_fd, &ps->slave_fd, baud))
+      {
+            printf("Cannot open a pty: %s\n", strerror(errno));
+            return false;
+      }
+
+      ps->baud = baud;
+      ps->pring = new OCP_SerialRing;
+      ps->bstop_writer = 0;
+      ps->bstop_reader = 0;
+      ps->n_written = 0;
+      ps->reader_cpu = 0;
+      ps->n_notify = 0;
+      pthread_mutex_init(&ps->mutex, NULL);
+      pthread_cond_init(&ps->cond, NULL);
+
+      double cpu0 = ProcessCPU();
+      double t0 = Now();
+
+      pthread_t reader, writer;
+      pthread_create(&reader, NULL, ReaderEntry, ps);
+      pthread_create(&writer, NULL, WriterEntry, ps);
+
+      int n_received = 0;
+      int n_bad = 0;
+
+      while(Now() - t0 < seconds)
+      {
+            pthread_mutex_lock(&ps->mutex);
+            if(!ps->n_notify)
+            {
+                  struct timespec ts;
+                  clock_gettime(CLOCK_REALTIME, &ts);
+                  ts.tv_nsec += 100000000;
+                  if(ts.tv_nsec >= 1000000000)
+                  {
+                        ts.tv_sec++;
+                        ts.tv_nsec -= 1000000000;
+                  }
+                  pthread_cond_timedwait(&ps->cond, &ps->mutex, &ts);
+            }
+            ps->n_notify = 0;
+            pthread_mutex_unlock(&ps->mutex);
+
+            n_bad += Drain(ps, &n_received);
+
+            if(bslow_consumer)
+                  usleep(50000);                    // a busy GUI thread
+      }
+
+      //    Stop writing, let the reader empty the pty, then stop it too
+      ps->bstop_writer = 1;
+      pthread_join(writer, NULL);
+      double elapsed = Now() - t0;
+
+      usleep(300000);
+      ps->bstop_reader = 1;
+      pthread_join(reader, NULL);
+
+      n_bad += Drain(ps, &n_received);
+      int n_dropped = ps->pring->GetNewDropCount();
+
+      double cpu = ProcessCPU() - cpu0;
+
+      if(baud)
+            printf("%6d baud:", baud);
+      else
+            printf("  unpaced, slow consumer:");
+
+      printf("  %d sentences in %.1f s, %.0f/s, %d dropped, %d bad\n",
+             n_received, elapsed, n_received / elapsed, n_dropped, n_bad);
+      printf("      port thread CPU %.2f%%, process CPU (writer included) %.2f%%\n",
+             100. * ps->reader_cpu / elapsed, 100. * cpu / elapsed);
+
+      bool bok = (n_bad == 0) && (n_received + n_dropped == ps->n_written);
+      if(n_received + n_dropped != ps->n_written)
+            printf("      %d sentences written, %d unaccounted for\n",
+                   ps->n_written, ps->n_written - (n_received + n_dropped));
+
+      ps->pring->Unref();
+      pthread_mutex_destroy(&ps->mutex);
+      pthread_cond_destroy(&ps->cond);
+      close(ps->slave_fd);
+      close(ps->master_fd);
+
+      return bok;
+}
+
+int main(int argc, char **argv)
+{
+      double seconds = 5.;
+      if(argc > 1)
+            seconds = atof(argv[1]);
+      if(seconds <= 0.)
+            seconds = 5.;
+
+      bool bok = true;
+      bok &= RunBench(38400, seconds, false);
+      bok &= RunBench(115200, seconds, false);
+      bok &= RunBench(0, seconds, true);
+
+      return bok ? 0 : 1;
+}